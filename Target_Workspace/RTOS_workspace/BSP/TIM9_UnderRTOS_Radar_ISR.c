@@ -4,12 +4,26 @@
  * All of the code here will be executing beneath the FreeRTOS tasks.
  * It's main purpose is to provide what appears to be an "external"
  * event for various examples.
+ *
+ * It's also the event source for the interrupt latency harness
+ * (TIM9LatencyStart).  Run at or below configMAX_SYSCALL_INTERRUPT_PRIORITY
+ * the ISR comes out from under the radar - it's masked by critical
+ * sections and wakes a task.
  */
 
 #include <TIM9_UnderRTOS_Radar_ISR.h>
 
 static TIM_HandleTypeDef htim9;
 
+static TIM9Latency_t* volatile results = NULL;
+static TaskHandle_t wakeTask = NULL;
+static uint32_t periodCounts;
+static uint32_t cyclesPerCount;
+
+//compare event (in cycles) the wake task hasn't taken yet
+static volatile uint32_t lastEvent;
+static volatile uint32_t eventPending;
+
 /**
  * Setup TIM9 to provide a simple repeating up counter with interrupts
  */
@@ -49,11 +63,138 @@ static void InitTIM9UnderRTOSRadar(void)
 
 }
 
+uint32_t TIM9LatencyCycles( void )
+{
+	return DWT->CYCCNT;
+}
+
+/**
+ * TIM9 is on APB2, its clock is PCLK2 doubled unless APB2 isn't divided
+ */
+static uint32_t tim9ClockHz( void )
+{
+	uint32_t pclk2 = HAL_RCC_GetPCLK2Freq();
+
+	if((RCC->CFGR & RCC_CFGR_PPRE2) == RCC_CFGR_PPRE2_DIV1)
+	{
+		return pclk2;
+	}
+	return pclk2 * 2;
+}
+
+void TIM9LatencyStart( TIM9Latency_t* Results, uint32_t PeriodUs, uint32_t NvicPriority, TaskHandle_t WakeTask )
+{
+	uint32_t timerHz = tim9ClockHz();
+
+	//only ISRs masked by critical sections may call the FreeRTOS API
+	configASSERT((WakeTask == NULL) || (NvicPriority >= configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY));
+	configASSERT((SystemCoreClock % timerHz) == 0);
+	cyclesPerCount = SystemCoreClock / timerHz;
+	periodCounts = PeriodUs * (timerHz / 1000000);
+	configASSERT((periodCounts > 0) && (periodCounts <= TIM9_LATENCY_MAX_PERIOD_COUNTS));
+
+	LatencyHistReset(&Results->Entry);
+	LatencyHistReset(&Results->Isr);
+	LatencyHistReset(&Results->Wake);
+	Results->Missed = 0;
+	wakeTask = WakeTask;
+	eventPending = 0;
+	results = Results;
+
+	//cycle counter for the timestamps
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->LAR = 0xC5ACCE55;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	//free running at the timer clock, compare interrupts on CC1
+	__HAL_RCC_TIM9_CLK_ENABLE();
+	TIM9->CR1 = 0;
+	TIM9->PSC = 0;
+	TIM9->ARR = 0xFFFF;
+	TIM9->EGR = TIM_EGR_UG;
+	TIM9->CCMR1 = 0;				//frozen output compare, timing only
+	TIM9->CCR1 = periodCounts;
+	TIM9->SR = 0;
+	TIM9->DIER = TIM_DIER_CC1IE;
+
+	NVIC_SetPriority(TIM1_BRK_TIM9_IRQn, NvicPriority);
+	NVIC_ClearPendingIRQ(TIM1_BRK_TIM9_IRQn);
+	NVIC_EnableIRQ(TIM1_BRK_TIM9_IRQn);
+	TIM9->CR1 = TIM_CR1_CEN;
+}
+
+void TIM9LatencyStop( void )
+{
+	NVIC_DisableIRQ(TIM1_BRK_TIM9_IRQn);
+	TIM9->CR1 = 0;
+	TIM9->DIER = 0;
+	TIM9->SR = 0;
+	results = NULL;
+	wakeTask = NULL;
+}
+
+BaseType_t TIM9LatencyWait( TickType_t Timeout )
+{
+	uint32_t now;
+
+	if(ulTaskNotifyTake(pdTRUE, Timeout) == 0)
+	{
+		return pdFALSE;
+	}
+	now = DWT->CYCCNT;
+	if(results != NULL)
+	{
+		LatencyHistRecord(&results->Wake, now - lastEvent);
+	}
+	eventPending = 0;
+	return pdTRUE;
+}
+
+/**
+ * the harness' half of the handler - the compare event is worked
+ * out backwards from how far TIM9 counted past CCR1, so no time
+ * is lost reading the counters before the entry timestamp
+ */
+static void latencyIrq( TIM9Latency_t* Results, uint32_t Entry )
+{
+	BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+	uint16_t sinceCompare = (uint16_t)(TIM9->CNT - TIM9->CCR1);
+	uint32_t event = Entry - (uint32_t)sinceCompare * cyclesPerCount;
+
+	TIM9->SR = ~TIM_SR_CC1IF;
+	TIM9->CCR1 = (uint16_t)(TIM9->CCR1 + periodCounts);
+
+	LatencyHistRecord(&Results->Entry, Entry - event);
+	if(wakeTask != NULL)
+	{
+		if(eventPending)
+		{
+			Results->Missed++;
+		}
+		else
+		{
+			lastEvent = event;
+			eventPending = 1;
+			vTaskNotifyGiveFromISR(wakeTask, &xHigherPriorityTaskWoken);
+		}
+	}
+	LatencyHistRecord(&Results->Isr, DWT->CYCCNT - Entry);
+	portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
 void TIM1_BRK_TIM9_IRQHandler(void)
 {
+  uint32_t entry = DWT->CYCCNT;
+  TIM9Latency_t* latency = results;
+
   /* USER CODE BEGIN TIM1_BRK_TIM9_IRQn 0 */
 
   /* USER CODE END TIM1_BRK_TIM9_IRQn 0 */
+  if(latency != NULL)
+  {
+    latencyIrq(latency, entry);
+    return;
+  }
   HAL_TIM_IRQHandler(&htim9);
   /* USER CODE BEGIN TIM1_BRK_TIM9_IRQn 1 */
 
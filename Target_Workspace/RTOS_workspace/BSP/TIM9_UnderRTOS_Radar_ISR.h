@@ -2,5 +2,58 @@
 #define TIM9_UNDERRTOS_RADAR_ISR_H_
 
 #include <stm32f7xx_hal.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#include <LatencyHistogram.h>
+
+/**
+ * Interrupt latency harness
+ *
+ * TIM9 free runs at the core clock and raises a CC1 compare interrupt
+ * every period.  Three latencies are recorded, in CPU cycles:
+ *	Entry:	compare event -> first line of TIM1_BRK_TIM9_IRQHandler
+ *			(read back from how far TIM9 counted past CCR1)
+ *	Isr:	handler entry -> handler exit, less the yield
+ *	Wake:	compare event -> the task blocked in TIM9LatencyWait
+ *			running again
+ *
+ * The NVIC priority is chosen per run, so the same build measures an
+ * ISR above configMAX_SYSCALL_INTERRUPT_PRIORITY (not masked by critical
+ * sections, but can't wake a task - pass a NULL WakeTask) and one at or
+ * below it (masked, wakes WakeTask with vTaskNotifyGiveFromISR).
+ */
+typedef struct
+{
+	LatencyHist_t Entry;
+	LatencyHist_t Isr;
+	LatencyHist_t Wake;
+	uint32_t Missed;		//events that came before WakeTask took the last one
+}TIM9Latency_t;
+
+//the longest period TIM9's 16 bit counter can time (303uS at 216MHz)
+#define TIM9_LATENCY_MAX_PERIOD_COUNTS 0xFFFF
+
+/**
+ * reset Results and start the compare interrupts
+ * @param PeriodUs time between compare events
+ * @param NvicPriority 0 - 15, numerically below
+ * 			configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY for an ISR
+ * 			that critical sections don't mask
+ * @param WakeTask task to notify from the ISR, NULL for none
+ */
+void TIM9LatencyStart( TIM9Latency_t* Results, uint32_t PeriodUs, uint32_t NvicPriority, TaskHandle_t WakeTask );
+void TIM9LatencyStop( void );
+
+/**
+ * block WakeTask until the next compare event and record how
+ * long it took to get here
+ * @returns pdFALSE on a timeout
+ */
+BaseType_t TIM9LatencyWait( TickType_t Timeout );
+
+/**
+ * read the cycle counter TIM9LatencyStart enables
+ */
+uint32_t TIM9LatencyCycles( void );
 
 #endif /* TIM9_UNDERRTOS_RADAR_ISR_H_ */
@@ -0,0 +1,263 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2019 Brian Amos
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "Uart4DmaTx.h"
+#include <task.h>
+#include <semphr.h>
+#include <stm32f7xx_hal.h>
+#include <UartQuickDirtyInit.h>
+#include <string.h>
+
+#if UART4_DMA_TX_MAX_TRANSFER > 0xFFFF
+#error UART4_DMA_TX_MAX_TRANSFER must fit in the 16 bit DMA_SxNDTR register
+#endif
+
+//must be at or below configMAX_SYSCALL_INTERRUPT_PRIORITY (numerically >=)
+//since the ISR uses the FromISR stream buffer API
+#define UART4_DMA_TX_IRQ_PRIORITY 6
+
+#define DMA_STREAM4_FLAGS (	DMA_HISR_HTIF4 | DMA_HISR_TCIF4 | DMA_HISR_TEIF4 | \
+							DMA_HISR_DMEIF4 | DMA_HISR_FEIF4 )
+
+static StreamBufferHandle_t txStream = NULL;
+//stream buffers only support a single writer at a time
+static SemaphoreHandle_t txMutex = NULL;
+//number of bytes the DMA controller is currently moving - 0 when idle
+static volatile size_t txInFlight = 0;
+static Uart4DmaTxStats_t stats;
+static DMA_HandleTypeDef uart4DmaTx;
+
+static void startNextTransfer( void );
+
+/**
+ * sets up DMA1_Stream4 and UART4 for DMA transmission
+ * and creates the stream buffer data is queued in
+ * @param Baudrate UART4 baudrate
+ */
+void Uart4DmaTxStart( uint32_t Baudrate )
+{
+	assert_param(txStream == NULL);
+	txStream = xStreamBufferCreate(UART4_DMA_TX_STREAM_LEN, 1);
+	assert_param(txStream != NULL);
+	txMutex = xSemaphoreCreateMutex();
+	assert_param(txMutex != NULL);
+	txInFlight = 0;
+	memset(&stats, 0, sizeof(stats));
+
+	__HAL_RCC_DMA1_CLK_ENABLE();
+
+	memset(&uart4DmaTx, 0, sizeof(uart4DmaTx));
+	uart4DmaTx.Instance = DMA1_Stream4;
+	uart4DmaTx.Init.Channel = DMA_CHANNEL_4;			//channel 4 is for UART4 Tx
+	uart4DmaTx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+	uart4DmaTx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+	uart4DmaTx.Init.MemBurst = DMA_MBURST_SINGLE;
+	uart4DmaTx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+	uart4DmaTx.Init.MemInc = DMA_MINC_ENABLE;
+	uart4DmaTx.Init.Mode = DMA_NORMAL;					//each transfer is started explicitly
+	uart4DmaTx.Init.PeriphBurst = DMA_PBURST_SINGLE;
+	uart4DmaTx.Init.PeriphInc = DMA_PINC_DISABLE;
+	uart4DmaTx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+	uart4DmaTx.Init.Priority = DMA_PRIORITY_HIGH;
+	assert_param(HAL_DMA_Init(&uart4DmaTx) == HAL_OK);
+
+	//HAL_DMA_Init leaves the stream disabled - each transfer
+	//only needs the memory address and length to be filled in
+	DMA1->HIFCR = DMA_STREAM4_FLAGS;
+	DMA1_Stream4->PAR = (uintptr_t)&UART4->TDR;
+	DMA1_Stream4->CR |= DMA_SxCR_TCIE | DMA_SxCR_TEIE;
+
+	NVIC_SetPriority(DMA1_Stream4_IRQn, UART4_DMA_TX_IRQ_PRIORITY);
+	NVIC_EnableIRQ(DMA1_Stream4_IRQn);
+
+	//GPIO pins are setup in STM_UartInit
+	STM_UartInit(UART4, Baudrate, &uart4DmaTx, NULL);
+	UART4->ICR = USART_ICR_TCCF;
+	UART4->CR3 |= USART_CR3_DMAT;
+}
+
+/**
+ * stops transmission and frees the stream buffer - anything
+ * still queued is discarded
+ */
+void Uart4DmaTxStop( void )
+{
+	NVIC_DisableIRQ(DMA1_Stream4_IRQn);
+	UART4->CR3 &= ~USART_CR3_DMAT;
+
+	DMA1_Stream4->CR &= ~DMA_SxCR_EN;
+	while(DMA1_Stream4->CR & DMA_SxCR_EN);
+	DMA1->HIFCR = DMA_STREAM4_FLAGS;
+	txInFlight = 0;
+
+	if(txStream != NULL)
+	{
+		vStreamBufferDelete(txStream);
+		txStream = NULL;
+	}
+	if(txMutex != NULL)
+	{
+		vSemaphoreDelete(txMutex);
+		txMutex = NULL;
+	}
+}
+
+/**
+ * queues data for transmission, starting a DMA transfer if one isn't
+ * already running.  Safe to call from any number of tasks - each call's
+ * data is sent contiguously
+ * @param Data bytes to send
+ * @param Len number of bytes to send
+ * @param TicksToWait maximum time to wait for room in the stream buffer
+ * @returns number of bytes queued (less than Len if TicksToWait expired)
+ */
+size_t Uart4DmaTxSend( uint8_t const* Data, size_t Len, TickType_t TicksToWait )
+{
+	TimeOut_t timeOut;
+	size_t totalQueued = 0;
+
+	assert_param(txStream != NULL);
+	assert_param(Data != NULL);
+
+	vTaskSetTimeOutState(&timeOut);
+	if(xSemaphoreTake(txMutex, TicksToWait) != pdPASS)
+	{
+		return 0;
+	}
+
+	while(totalQueued < Len)
+	{
+		size_t chunk = Len - totalQueued;
+		size_t numQueued;
+
+		//large writes are queued a transfer's worth at a time, so the
+		//DMA controller can drain one batch while the next is filled
+		if(chunk > UART4_DMA_TX_MAX_TRANSFER)
+		{
+			chunk = UART4_DMA_TX_MAX_TRANSFER;
+		}
+
+		(void) xTaskCheckForTimeOut(&timeOut, &TicksToWait);
+		numQueued = xStreamBufferSend(txStream, &Data[totalQueued], chunk, TicksToWait);
+		totalQueued += numQueued;
+
+		//only start a transfer if the DMA controller is idle, otherwise
+		//the transfer complete ISR will pick this data up as part of
+		//the next batch
+		taskENTER_CRITICAL();
+		if(txInFlight == 0)
+		{
+			startNextTransfer();
+		}
+		taskEXIT_CRITICAL();
+
+		if(numQueued < chunk)
+		{
+			//timed out waiting for room
+			break;
+		}
+	}
+
+	xSemaphoreGive(txMutex);
+	return totalQueued;
+}
+
+/**
+ * copies out a snapshot of the engine's counters
+ */
+void Uart4DmaTxGetStats( Uart4DmaTxStats_t* Stats )
+{
+	assert_param(Stats != NULL);
+	taskENTER_CRITICAL();
+	*Stats = stats;
+	taskEXIT_CRITICAL();
+}
+
+/**
+ * releases the bytes from the completed transfer and immediately
+ * starts the next one with everything queued since
+ */
+void Uart4DmaTxDmaIsr( BaseType_t* HigherPriorityTaskWoken )
+{
+	uint32_t flags = DMA1->HISR & DMA_STREAM4_FLAGS;
+
+	DMA1->HIFCR = flags;
+
+	if(flags & (DMA_HISR_DMEIF4 | DMA_HISR_FEIF4))
+	{
+		//FIFO/direct mode errors don't stop the stream (and have no
+		//interrupt enabled), they're picked up with the TC/TE event
+		stats.DmaErrors++;
+	}
+
+	if(flags & DMA_HISR_TEIF4)
+	{
+		//the stream disables itself on a transfer error - the data is
+		//released anyway, rather than stalling every producer
+		stats.DmaErrors++;
+	}
+	else if(flags & DMA_HISR_TCIF4)
+	{
+		stats.TxBytes += txInFlight;
+	}
+	else
+	{
+		return;
+	}
+
+	//wakes a producer waiting for room
+	xStreamBufferConsumeFromISR(txStream, txInFlight, HigherPriorityTaskWoken);
+	txInFlight = 0;
+	startNextTransfer();
+}
+
+/**
+ * starts a DMA transfer with everything queued up to the end of the
+ * stream buffer's storage (if the data wraps around the end, the
+ * remainder is picked up by the next transfer) or UART4_DMA_TX_MAX_TRANSFER
+ * bytes, whichever is less.  Must be called with the DMA ISR masked and
+ * the stream idle
+ */
+static void startNextTransfer( void )
+{
+	StreamBufferSpans_t spans;
+
+	if(xStreamBufferPeekFromISR(txStream, &spans, UART4_DMA_TX_MAX_TRANSFER) == 0)
+	{
+		return;
+	}
+
+	txInFlight = spans.xFirstLength;
+	stats.Transfers++;
+	if(txInFlight > stats.MaxTransferLen)
+	{
+		stats.MaxTransferLen = txInFlight;
+	}
+
+	DMA1->HIFCR = DMA_STREAM4_FLAGS;
+	DMA1_Stream4->M0AR = (uintptr_t)spans.pucFirst;
+	DMA1_Stream4->NDTR = txInFlight;
+	DMA1_Stream4->CR |= DMA_SxCR_EN;
+}
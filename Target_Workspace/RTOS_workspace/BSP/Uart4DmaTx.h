@@ -0,0 +1,84 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2019 Brian Amos
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef BSP_UART4DMATX_H_
+#define BSP_UART4DMATX_H_
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include <stdint.h>
+#include <FreeRTOS.h>
+#include <stream_buffer.h>
+
+/**
+ * UART4 transmit engine using DMA (DMA1_Stream4, channel 4)
+ *
+ * Any number of tasks write into a stream buffer with Uart4DmaTxSend.
+ * Whenever the DMA stream is idle, everything queued up to the end of
+ * the stream buffer's storage (or UART4_DMA_TX_MAX_TRANSFER bytes) is
+ * handed to the DMA controller as a single transfer, directly out of the
+ * stream buffer (no intermediate copy).
+ * The transfer complete ISR releases the bytes just sent and immediately
+ * starts the next transfer with whatever has been queued in the meantime,
+ * so no task is involved in keeping the line busy and the CPU cost is
+ * one interrupt per batch, rather than one per byte.
+ */
+
+//size of the stream buffer queued data is held in
+#ifndef UART4_DMA_TX_STREAM_LEN
+#define UART4_DMA_TX_STREAM_LEN 256
+#endif
+
+//largest single DMA transfer - transferred bytes are only released from
+//the stream buffer when the transfer completes, so capping transfers at
+//half the stream buffer leaves producers room to queue the next batch
+//while the current one is going out
+#ifndef UART4_DMA_TX_MAX_TRANSFER
+#define UART4_DMA_TX_MAX_TRANSFER (UART4_DMA_TX_STREAM_LEN / 2)
+#endif
+
+typedef struct
+{
+	uint32_t TxBytes;			//bytes the DMA controller has finished moving to UART4
+	uint32_t Transfers;			//DMA transfers started
+	uint32_t MaxTransferLen;	//largest single DMA transfer
+	uint32_t DmaErrors;			//DMA transfer/FIFO/direct mode errors
+}Uart4DmaTxStats_t;
+
+void Uart4DmaTxStart( uint32_t Baudrate );
+void Uart4DmaTxStop( void );
+size_t Uart4DmaTxSend( uint8_t const* Data, size_t Len, TickType_t TicksToWait );
+void Uart4DmaTxGetStats( Uart4DmaTxStats_t* Stats );
+
+/**
+ * This needs to be called from DMA1_Stream4_IRQHandler
+ */
+void Uart4DmaTxDmaIsr( BaseType_t* HigherPriorityTaskWoken );
+
+#ifdef __cplusplus
+ }
+#endif
+#endif /* BSP_UART4DMATX_H_ */
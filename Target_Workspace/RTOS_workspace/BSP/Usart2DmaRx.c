@@ -0,0 +1,257 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2019 Brian Amos
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "Usart2DmaRx.h"
+#include <task.h>
+#include <stm32f7xx_hal.h>
+#include <UartQuickDirtyInit.h>
+#include <string.h>
+
+#if (USART2_DMA_RX_RING_LEN % 2) != 0
+#error USART2_DMA_RX_RING_LEN must be even
+#endif
+
+//must be at or below configMAX_SYSCALL_INTERRUPT_PRIORITY (numerically >=)
+//since the ISR's use the FromISR stream buffer API
+#define USART2_DMA_RX_IRQ_PRIORITY 6
+
+#define DMA_STREAM5_FLAGS (	DMA_HISR_HTIF5 | DMA_HISR_TCIF5 | DMA_HISR_TEIF5 | \
+							DMA_HISR_DMEIF5 | DMA_HISR_FEIF5 )
+
+static uint8_t rxRing[USART2_DMA_RX_RING_LEN];
+//index of the first byte in rxRing that hasn't been pushed into rxStream yet
+static uint32_t rxTail = 0;
+static StreamBufferHandle_t rxStream = NULL;
+static Usart2DmaRxStats_t stats;
+static DMA_HandleTypeDef usart2DmaRx;
+
+static void pushBytes( uint8_t const* Data, size_t Len, BaseType_t* HigherPriorityTaskWoken );
+static void pushReceived( BaseType_t* HigherPriorityTaskWoken );
+
+/**
+ * sets up DMA1_Stream5 for circular reception into rxRing
+ * and USART2 to request DMA transfers, then starts
+ * reception
+ * @param RxStream stream buffer all received data is pushed into
+ * @param Baudrate USART2 baudrate
+ */
+void Usart2DmaRxStart( StreamBufferHandle_t RxStream, uint32_t Baudrate )
+{
+	assert_param(RxStream != NULL);
+	rxStream = RxStream;
+	rxTail = 0;
+	memset(&stats, 0, sizeof(stats));
+
+	__HAL_RCC_DMA1_CLK_ENABLE();
+
+	memset(&usart2DmaRx, 0, sizeof(usart2DmaRx));
+	usart2DmaRx.Instance = DMA1_Stream5;				//stream 5 is for USART2 Rx
+	usart2DmaRx.Init.Channel = DMA_CHANNEL_4;			//channel 4 is for USART2 Rx/Tx
+	usart2DmaRx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+	usart2DmaRx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;	//no fifo - NDTR always reflects what's in memory
+	usart2DmaRx.Init.MemBurst = DMA_MBURST_SINGLE;
+	usart2DmaRx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+	usart2DmaRx.Init.MemInc = DMA_MINC_ENABLE;
+	usart2DmaRx.Init.Mode = DMA_CIRCULAR;				//wrap back to the start of rxRing forever
+	usart2DmaRx.Init.PeriphBurst = DMA_PBURST_SINGLE;
+	usart2DmaRx.Init.PeriphInc = DMA_PINC_DISABLE;
+	usart2DmaRx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+	usart2DmaRx.Init.Priority = DMA_PRIORITY_HIGH;
+	assert_param(HAL_DMA_Init(&usart2DmaRx) == HAL_OK);
+
+	//HAL_DMA_Init leaves the stream disabled, so the remaining
+	//setup can go straight to the registers
+	DMA1->HIFCR = DMA_STREAM5_FLAGS;
+	DMA1_Stream5->PAR = (uintptr_t)&USART2->RDR;
+	DMA1_Stream5->M0AR = (uintptr_t)rxRing;
+	DMA1_Stream5->NDTR = USART2_DMA_RX_RING_LEN;
+	DMA1_Stream5->CR |= DMA_SxCR_HTIE | DMA_SxCR_TCIE | DMA_SxCR_TEIE;
+	DMA1_Stream5->CR |= DMA_SxCR_EN;
+
+	NVIC_SetPriority(DMA1_Stream5_IRQn, USART2_DMA_RX_IRQ_PRIORITY);
+	NVIC_EnableIRQ(DMA1_Stream5_IRQn);
+
+	STM_UartInit(USART2, Baudrate, NULL, &usart2DmaRx);
+
+	//clear anything left over from init, then enable DMA requests,
+	//error interrupts and idle line detection
+	USART2->ICR = (	USART_ICR_IDLECF | USART_ICR_FECF | USART_ICR_PECF |
+					USART_ICR_NCF | USART_ICR_ORECF);
+	USART2->CR3 |= USART_CR3_DMAR | USART_CR3_EIE;
+	USART2->CR1 |= USART_CR1_IDLEIE;
+
+	NVIC_SetPriority(USART2_IRQn, USART2_DMA_RX_IRQ_PRIORITY);
+	NVIC_EnableIRQ(USART2_IRQn);
+	USART2->CR1 |= USART_CR1_UE;
+}
+
+/**
+ * stops reception - anything in rxRing that hasn't
+ * been pushed to the stream buffer yet is discarded
+ */
+void Usart2DmaRxStop( void )
+{
+	NVIC_DisableIRQ(USART2_IRQn);
+	NVIC_DisableIRQ(DMA1_Stream5_IRQn);
+
+	USART2->CR1 &= ~USART_CR1_IDLEIE;
+	USART2->CR3 &= ~(USART_CR3_DMAR | USART_CR3_EIE);
+
+	DMA1_Stream5->CR &= ~DMA_SxCR_EN;
+	while(DMA1_Stream5->CR & DMA_SxCR_EN);
+	DMA1->HIFCR = DMA_STREAM5_FLAGS;
+}
+
+/**
+ * copies out a snapshot of the driver's counters
+ * (each counter is individually consistent)
+ */
+void Usart2DmaRxGetStats( Usart2DmaRxStats_t* Stats )
+{
+	assert_param(Stats != NULL);
+	taskENTER_CRITICAL();
+	*Stats = stats;
+	taskEXIT_CRITICAL();
+}
+
+/**
+ * services half transfer, transfer complete and error
+ * events for DMA1_Stream5
+ */
+void Usart2DmaRxDmaIsr( BaseType_t* HigherPriorityTaskWoken )
+{
+	uint32_t flags = DMA1->HISR & DMA_STREAM5_FLAGS;
+
+	DMA1->HIFCR = flags;
+
+	if(flags & DMA_HISR_HTIF5)
+	{
+		stats.HalfTransferEvents++;
+	}
+	if(flags & DMA_HISR_TCIF5)
+	{
+		stats.TransferCompleteEvents++;
+	}
+	if(flags & (DMA_HISR_TEIF5 | DMA_HISR_DMEIF5 | DMA_HISR_FEIF5))
+	{
+		stats.DmaErrors++;
+	}
+
+	pushReceived(HigherPriorityTaskWoken);
+}
+
+/**
+ * services idle line and error events for USART2
+ * (received data is moved by the DMA controller, so
+ * RXNE isn't used)
+ */
+void Usart2DmaRxUsartIsr( BaseType_t* HigherPriorityTaskWoken )
+{
+	uint32_t isr = USART2->ISR;
+	uint32_t clear = 0;
+
+	if(isr & USART_ISR_ORE)
+	{
+		stats.OverrunErrors++;
+		clear |= USART_ICR_ORECF;
+	}
+	if(isr & USART_ISR_NE)
+	{
+		stats.NoiseErrors++;
+		clear |= USART_ICR_NCF;
+	}
+	if(isr & USART_ISR_FE)
+	{
+		stats.FramingErrors++;
+		clear |= USART_ICR_FECF;
+	}
+	if(isr & USART_ISR_PE)
+	{
+		stats.ParityErrors++;
+		clear |= USART_ICR_PECF;
+	}
+	if(isr & USART_ISR_IDLE)
+	{
+		stats.IdleEvents++;
+		clear |= USART_ICR_IDLECF;
+	}
+	USART2->ICR = clear;
+
+	//the line has gone quiet - flush whatever has arrived
+	if(isr & USART_ISR_IDLE)
+	{
+		pushReceived(HigherPriorityTaskWoken);
+	}
+}
+
+/**
+ * pushes everything the DMA controller has written since the last
+ * call into the stream buffer.  NDTR counts down from the ring length,
+ * so the DMA controller's write position is (ring length - NDTR)
+ */
+static void pushReceived( BaseType_t* HigherPriorityTaskWoken )
+{
+	uint32_t head = USART2_DMA_RX_RING_LEN - DMA1_Stream5->NDTR;
+
+	//NDTR reloads to the ring length as soon as it
+	//reaches 0 in circular mode, but be safe
+	if(head >= USART2_DMA_RX_RING_LEN)
+	{
+		head = 0;
+	}
+
+	if(head == rxTail)
+	{
+		return;
+	}
+
+	if(head > rxTail)
+	{
+		pushBytes(&rxRing[rxTail], head - rxTail, HigherPriorityTaskWoken);
+	}
+	else
+	{
+		//the data wraps around the end of the ring
+		pushBytes(&rxRing[rxTail], USART2_DMA_RX_RING_LEN - rxTail, HigherPriorityTaskWoken);
+		pushBytes(rxRing, head, HigherPriorityTaskWoken);
+	}
+	rxTail = head;
+}
+
+static void pushBytes( uint8_t const* Data, size_t Len, BaseType_t* HigherPriorityTaskWoken )
+{
+	size_t numWritten;
+
+	//don't call xStreamBufferSendFromISR with a length of 0
+	if(Len == 0)
+	{
+		return;
+	}
+
+	//never wait for room here - whatever doesn't fit is dropped and counted
+	numWritten = xStreamBufferSendFromISR(rxStream, Data, Len, HigherPriorityTaskWoken);
+	stats.RxBytes += numWritten;
+	stats.DroppedBytes += Len - numWritten;
+}
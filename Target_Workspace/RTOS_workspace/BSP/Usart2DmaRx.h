@@ -0,0 +1,92 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2019 Brian Amos
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef BSP_USART2DMARX_H_
+#define BSP_USART2DMARX_H_
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include <stdint.h>
+#include <FreeRTOS.h>
+#include <stream_buffer.h>
+
+/**
+ * USART2 receive driver using circular DMA (DMA1_Stream5, channel 4)
+ *
+ * The DMA controller continuously fills a ring of USART2_DMA_RX_RING_LEN
+ * bytes.  Whenever the line goes idle, or the DMA controller reaches
+ * the half/end of the ring, everything received since the last event
+ * (however many bytes that is) is pushed into the stream buffer.
+ *
+ * Latency from the last byte of a message to the consumer being woken
+ * is bounded by one idle frame (10 bit times), since the IDLE interrupt
+ * flushes any partial ring contents.  The stream buffer's trigger level
+ * should be 1 for this bound to hold for messages shorter than the
+ * trigger level.  For continuous traffic, data is pushed at least every
+ * USART2_DMA_RX_RING_LEN/2 bytes.
+ *
+ * The ISR's never block: if the stream buffer is full, the bytes that
+ * don't fit are dropped and counted in Usart2DmaRxStats_t.DroppedBytes.
+ */
+
+//size of the DMA ring - must be even, so the half transfer
+//interrupt falls on a byte boundary
+#ifndef USART2_DMA_RX_RING_LEN
+#define USART2_DMA_RX_RING_LEN 64
+#endif
+
+typedef struct
+{
+	uint32_t RxBytes;			//bytes pushed into the stream buffer
+	uint32_t DroppedBytes;		//bytes lost because the stream buffer was full
+	uint32_t IdleEvents;		//USART idle line interrupts
+	uint32_t HalfTransferEvents;
+	uint32_t TransferCompleteEvents;
+	uint32_t OverrunErrors;		//USART ORE - a byte arrived before DMA read the last one
+	uint32_t NoiseErrors;
+	uint32_t FramingErrors;
+	uint32_t ParityErrors;
+	uint32_t DmaErrors;			//DMA transfer errors
+}Usart2DmaRxStats_t;
+
+void Usart2DmaRxStart( StreamBufferHandle_t RxStream, uint32_t Baudrate );
+void Usart2DmaRxStop( void );
+void Usart2DmaRxGetStats( Usart2DmaRxStats_t* Stats );
+
+/**
+ * These need to be called from DMA1_Stream5_IRQHandler and
+ * USART2_IRQHandler respectively (the handlers themselves are left
+ * to the application, since other examples use the same vectors).
+ * Both IRQ's are setup with the same priority so they
+ * can't preempt one another.
+ */
+void Usart2DmaRxDmaIsr( BaseType_t* HigherPriorityTaskWoken );
+void Usart2DmaRxUsartIsr( BaseType_t* HigherPriorityTaskWoken );
+
+#ifdef __cplusplus
+ }
+#endif
+#endif /* BSP_USART2DMARX_H_ */
@@ -38,9 +38,12 @@
 
  */
 
-#include <UartQuickDirtyInit.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#include <SEGGER_SYSVIEW.h>
+#include <Uart4DmaTx.h>
 #include <stdint.h>
-#include <string.h>
+#include <stm32f7xx_hal.h>
 
 // #####################################################################
 // Code for bug-fix:  START
@@ -57,89 +60,53 @@ const size_t uart4MsgSize = sizeof(uart4Msg);
 // #####################################################################
 
 
-static DMA_HandleTypeDef uart4DmaTx;
+#define UART4_SIM_STACK_SIZE 128
 
-static void uart4TxDmaStartRepeat( const uint8_t* Msg, uint16_t Len );
-static void uart4TxDmaSetup( void );
+static void uart4SimTask( void* NotUsed );
 
 /**
  * Setup UART4 to repeatedly transmit a message
- * via DMA (no CPU intervention required).  This simulates
- * what would happen if there was data flowing from an
- * external off-chip source and let's us concentrate on
- * what's going on with UART2
+ * via DMA.  This simulates what would happen if
+ * there was data flowing from an external off-chip
+ * source and let's us concentrate on what's going
+ * on with UART2
  *
- * @param Baudrate desired baudrate for the UART4
+ * The message is fed through the batched DMA transmit
+ * engine in BSP/Uart4DmaTx.c, which keeps the line busy
+ * (the sim task only runs briefly each time a DMA transfer
+ * completes and frees up room in the engine's stream buffer)
  *
- * This is a quick and dirty setup. . .
+ * @param Baudrate desired baudrate for the UART4
  */
 void SetupUart4ExternalSim( uint32_t BaudRate )
 {
-	//setup DMA
-	uart4TxDmaSetup();
-
-	//GPIO pins are setup in BSP/Nucleo_F767ZI_Init
-	STM_UartInit(UART4, BaudRate, &uart4DmaTx, NULL);
-
-	//also enable DMA for UART4 Transmits
-	UART4->CR3 |= USART_CR3_DMAT_Msk;
-
-	/**
-	 *	start the repeating DMA transfer.  Eventually, non-circular
-	 *	receivers will loose a character here or there at high baudrates.
-	 *	When this happens, SEGGER_SYSVIEW_Print() will stop printing when it hits
-	 *	the first NULL character.
-	 */
-	uart4TxDmaStartRepeat(uart4Msg, sizeof(uart4Msg));
-}
+	Uart4DmaTxStart(BaudRate);
 
-static void uart4TxDmaSetup( void )
-{
-	__HAL_RCC_DMA1_CLK_ENABLE();
-	//no need to enable any interrupts
-	HAL_NVIC_SetPriority(DMA1_Stream4_IRQn, 0, 0);
-	HAL_NVIC_EnableIRQ(DMA1_Stream4_IRQn);
-
-	//initialize the DMA peripheral to transfer uart4Msg
-	//to UART4 repeatedly
-	memset(&uart4DmaTx, 0, sizeof(uart4DmaTx));
-	uart4DmaTx.Instance = DMA1_Stream4;
-	uart4DmaTx.Init.Channel = DMA_CHANNEL_4;			//channel 4 is for UART4 Tx
-	uart4DmaTx.Init.Direction = DMA_MEMORY_TO_PERIPH;	//transfering out of memory and into the peripheral register
-	uart4DmaTx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;	//no fifo
-	uart4DmaTx.Init.MemBurst = DMA_MBURST_SINGLE;		//transfer 1 at a time
-	uart4DmaTx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
-	uart4DmaTx.Init.MemInc = DMA_MINC_ENABLE;			//increment 1 byte at a time
-	uart4DmaTx.Init.Mode = DMA_CIRCULAR;				//this will automatically restart the transfer at the beginning after it has finished
-	uart4DmaTx.Init.PeriphBurst = DMA_PBURST_SINGLE;	//write 1 at a time to the peripheral
-	uart4DmaTx.Init.PeriphInc = DMA_PINC_DISABLE;		//always keep the peripheral address the same (the Tx data register is always in the same location)
-	uart4DmaTx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
-	//we're setting low priority since this is meant to be simulated data - the DMA
-	//transfers of the active code should take priority
-	uart4DmaTx.Init.Priority = DMA_PRIORITY_VERY_HIGH;
-	assert_param(HAL_DMA_Init(&uart4DmaTx) == HAL_OK);
-	DMA1_Stream4->CR &= ~DMA_SxCR_EN;
-
-	//set the DMA transmit mode flag to enable DMA transfers
-	UART4->CR3 |= USART_CR3_DMAT_Msk;
+	//the highest priority makes sure the sim keeps up with
+	//the line, even when other tasks are polling
+	assert_param(xTaskCreate(uart4SimTask, "uart4Sim", UART4_SIM_STACK_SIZE, NULL, configMAX_PRIORITIES - 1, NULL) == pdPASS);
 }
 
 /**
- * starts a DMA transfer to the UART4 Tx register
- * that will automatically repeat after it is finished
- * @param Msg pointer to array to transfer
- * @param Len number of elements in the array
+ *	Eventually, non-circular receivers will loose a character here or
+ *	there at high baudrates.  When this happens, SEGGER_SYSVIEW_Print()
+ *	will stop printing when it hits the first NULL character.
  */
-static void uart4TxDmaStartRepeat( const uint8_t* Msg, uint16_t Len )
+static void uart4SimTask( void* NotUsed )
 {
-	//clear the transfer complete flag to make sure our transfer starts
-	UART4->ICR |= USART_ICR_TCCF;
-	assert_param(HAL_DMA_Start(&uart4DmaTx, (uint32_t) Msg, (uint32_t)&(UART4->TDR), Len) == HAL_OK);
+	while(1)
+	{
+		Uart4DmaTxSend(uart4Msg, uart4MsgSize, portMAX_DELAY);
+	}
 }
 
 void DMA1_Stream4_IRQHandler(void)
 {
-	//shouldn't ever get here - interrupts are not enabled
-	while(1);
-//  HAL_DMA_IRQHandler(&hdma_uart4_tx);
+	portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+	SEGGER_SYSVIEW_RecordEnterISR();
+
+	Uart4DmaTxDmaIsr(&xHigherPriorityTaskWoken);
+
+	SEGGER_SYSVIEW_RecordExitISR();
+	portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
 }
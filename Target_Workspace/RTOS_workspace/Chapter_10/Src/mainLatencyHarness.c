@@ -0,0 +1,160 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Brian Amos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <Nucleo_F767ZI_Init.h>
+#include <stm32f7xx_hal.h>
+#include <SEGGER_SYSVIEW.h>
+#include <TIM9_UnderRTOS_Radar_ISR.h>
+#include <LatencyHistogram.h>
+
+/*********************************************
+ * Interrupt latency sweep
+ *
+ * Runs the TIM9 latency harness (BSP/TIM9_UnderRTOS_Radar_ISR.c)
+ * with TIM9 above configMAX_SYSCALL_INTERRUPT_PRIORITY and at it,
+ * against a low priority task that spends half of its time in
+ * critical sections of each of the lengths in loadsUs.  The min,
+ * mean, p99 and max of every histogram go out to SystemView.
+ *
+ * Critical sections only mask ISRs at or below the syscall
+ * priority, so their length shows up in the entry latency of the
+ * second set of runs and not the first.
+ *
+ * TIM9_UnderRTOS_Radar_ISR.c and Drivers/HandsOnRTOS/LatencyHistogram.c
+ * need to be in the build along with this file, none of the Chapter_10
+ * configurations include them.
+ *********************************************/
+
+#define STACK_SIZE 256
+#define PERIOD_US 250
+#define RUN_MS 2000
+
+static const uint32_t priorities[] = { 0, configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY };
+static const uint32_t loadsUs[] = { 0, 1, 10, 50 };
+
+static TIM9Latency_t latency;
+static volatile uint32_t loadCycles;
+
+void sweepTask( void* NotUsed );
+void loadTask( void* NotUsed );
+
+int main(void)
+{
+	HWInit();
+	SEGGER_SYSVIEW_Conf();
+
+	//ensure proper priority grouping for freeRTOS
+	NVIC_SetPriorityGrouping(0);
+
+	assert_param(xTaskCreate(sweepTask, "sweep", STACK_SIZE, NULL, tskIDLE_PRIORITY + 3, NULL) == pdPASS);
+	assert_param(xTaskCreate(loadTask, "load", STACK_SIZE, NULL, tskIDLE_PRIORITY + 1, NULL) == pdPASS);
+
+	//start the scheduler - shouldn't return unless there's a problem
+	vTaskStartScheduler();
+
+	//if you've wound up here, there is likely an issue with overrunning the freeRTOS heap
+	while(1)
+	{
+	}
+}
+
+static void spin( uint32_t Cycles )
+{
+	uint32_t start = TIM9LatencyCycles();
+	while((TIM9LatencyCycles() - start) < Cycles);
+}
+
+/**
+ * critical sections of loadCycles, with as long again outside of them
+ */
+void loadTask( void* NotUsed )
+{
+	while(1)
+	{
+		uint32_t cycles = loadCycles;
+
+		taskENTER_CRITICAL();
+		spin(cycles);
+		taskEXIT_CRITICAL();
+		spin(cycles);
+	}
+}
+
+static void report( char const* Name, uint32_t Priority, uint32_t LoadUs, LatencyHist_t const* Hist )
+{
+	LatencyHistSummary_t sum;
+	uint32_t cyclesPerUs = SystemCoreClock / 1000000;
+
+	LatencyHistSummarize(Hist, &sum);
+	SEGGER_SYSVIEW_PrintfHost("prio %u load %uus %s: n %u min %u mean %u p99 %u max %u cycles",
+								Priority, LoadUs, Name, sum.Count, sum.Min, sum.Mean, sum.P99, sum.Max);
+	SEGGER_SYSVIEW_PrintfHost("  max %u.%02uus", sum.Max / cyclesPerUs, (sum.Max % cyclesPerUs) * 100 / cyclesPerUs);
+}
+
+void sweepTask( void* NotUsed )
+{
+	while(1)
+	{
+		for(uint32_t p = 0; p < sizeof(priorities) / sizeof(priorities[0]); p++)
+		{
+			//only an ISR masked by critical sections can wake the task
+			TaskHandle_t wake = (priorities[p] >= configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY) ?
+								xTaskGetCurrentTaskHandle() : NULL;
+
+			for(uint32_t l = 0; l < sizeof(loadsUs) / sizeof(loadsUs[0]); l++)
+			{
+				TickType_t start;
+
+				loadCycles = loadsUs[l] * (SystemCoreClock / 1000000);
+				TIM9LatencyStart(&latency, PERIOD_US, priorities[p], wake);
+				start = xTaskGetTickCount();
+				while((xTaskGetTickCount() - start) < pdMS_TO_TICKS(RUN_MS))
+				{
+					if(wake != NULL)
+					{
+						TIM9LatencyWait(pdMS_TO_TICKS(10));
+					}
+					else
+					{
+						vTaskDelay(pdMS_TO_TICKS(10));
+					}
+				}
+				TIM9LatencyStop();
+				//drop a notification given just before the stop
+				ulTaskNotifyTake(pdTRUE, 0);
+
+				report("entry", priorities[p], loadsUs[l], &latency.Entry);
+				report("isr", priorities[p], loadsUs[l], &latency.Isr);
+				if(wake != NULL)
+				{
+					report("wake", priorities[p], loadsUs[l], &latency.Wake);
+					SEGGER_SYSVIEW_PrintfHost("  missed %u", latency.Missed);
+				}
+			}
+		}
+	}
+}
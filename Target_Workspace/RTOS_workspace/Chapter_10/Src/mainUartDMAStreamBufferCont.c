@@ -31,7 +31,7 @@
 #include <SEGGER_SYSVIEW.h>
 #include <Nucleo_F767ZI_Init.h>
 #include <stm32f7xx_hal.h>
-#include <UartQuickDirtyInit.h>
+#include <Usart2DmaRx.h>
 #include "Uart4Setup.h"
 #include <stdbool.h>
 #include <string.h>
@@ -39,6 +39,11 @@
 /*********************************************
  * A demonstration of a receive-only stream buffer
  * UART driver implemented through DMA
+ *
+ * BSP/Usart2DmaRx.c receives into a circular DMA buffer
+ * and uses the USART idle line interrupt (along with the
+ * DMA half/full transfer interrupts) to pass along data as
+ * soon as it arrives, regardless of how much there is
  *********************************************/
 
 
@@ -56,18 +61,8 @@
 void uartPrintOutTask( void* NotUsed);
 void startUart4Traffic( TimerHandle_t xTimer );
 
-//NOTE: keep buffers < 1KB to simplify DMA implementation
-//see 8.3.12 for details
-#define RX_BUFF_LEN 16
-static uint8_t rxData1[RX_BUFF_LEN];
-static uint8_t rxData2[RX_BUFF_LEN];
-
 static StreamBufferHandle_t rxStream = NULL;
 
-static bool rxInProgress = false;
-
-static DMA_HandleTypeDef usart2DmaRx;
-
 int main(void)
 {
 	HWInit();
@@ -77,11 +72,10 @@ int main(void)
 	NVIC_SetPriorityGrouping(0);
 
 	//setup a timer to kick off UART traffic (flowing out of UART4 TX line
-	//and into USART2 RX line) 1 second after the scheduler starts
-	//this delay is only present since we're using a simple
-	//block-based buffer for receiving data - the transmission
-	//needs to start after the receiver is ready for data for the
-	//strings to start in the correct position in this simple setup
+	//and into USART2 RX line) 5 seconds after the scheduler starts
+	//since the driver doesn't rely on fixed size blocks, the traffic
+	//could start at any time - the delay just makes it easy to see
+	//the receiver timing out before any data arrives
 	TimerHandle_t oneShotHandle =
 	xTimerCreate(	"startUart4Traffic",
 					5000 /portTICK_PERIOD_MS,
@@ -92,7 +86,9 @@ int main(void)
 	xTimerStart(oneShotHandle, 0);
 
 	//setup tasks, making sure they have been properly created before moving on
-	rxStream = xStreamBufferCreate( 100, 2);
+	//a trigger level of 1 wakes uartPrintOutTask for any message,
+	//no matter how short
+	rxStream = xStreamBufferCreate( 100, 1);
 	assert_param(rxStream != NULL);
 
 	assert_param(xTaskCreate(uartPrintOutTask, "uartPrint", STACK_SIZE, NULL, tskIDLE_PRIORITY + 3, NULL) == pdPASS);
@@ -107,122 +103,25 @@ int main(void)
 }
 
 
-/**
- * sets up DMA for USART2 circular reception
- * NOTE: After returning from this function, the DMA stream
- * is enabled.  To perform additional configuration, the
- * stream might need to be disabled (i.e. when setting up
- * double buffer mode)
- */
-void setupUSART2DMA_circular( void )
-{
-	//disable UART so no bytes can be accepted, which could create an
-	//overrun if DMA isn't setup in time
-//	USART2->CR1 &= ~USART_CR1_UE;	//start with the USART disabled
-
-	__HAL_RCC_DMA1_CLK_ENABLE();
-	
-	NVIC_SetPriority(DMA1_Stream5_IRQn, 6);
-	NVIC_EnableIRQ(DMA1_Stream5_IRQn);
-
-	//initialize the DMA peripheral to transfer uart4Msg
-	//to UART4 repeatedly
-	memset(&usart2DmaRx, 0, sizeof(usart2DmaRx));
-	usart2DmaRx.Instance = DMA1_Stream5;				//stream 5 is for USART2 Rx
-	usart2DmaRx.Init.Channel = DMA_CHANNEL_4;			//channel 4 is for USART2 Rx/Tx
-	usart2DmaRx.Init.Direction = DMA_PERIPH_TO_MEMORY;	//transfering out of memory and into the peripheral register
-	usart2DmaRx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;	//no fifo
-	usart2DmaRx.Init.MemBurst = DMA_MBURST_SINGLE;		//transfer 1 at a time
-	usart2DmaRx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
-	usart2DmaRx.Init.MemInc = DMA_MINC_ENABLE;			//increment 1 byte at a time
-	usart2DmaRx.Init.Mode = DMA_CIRCULAR;				//circular mode restarts transfers
-														//after a buffer is filled (See REF 0041 8.3.9)
-	usart2DmaRx.Init.PeriphBurst = DMA_PBURST_SINGLE;	//write 1 at a time to the peripheral
-	usart2DmaRx.Init.PeriphInc = DMA_PINC_DISABLE;		//always keep the peripheral address the same (the RX data register is always in the same location)
-	usart2DmaRx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
-	usart2DmaRx.Init.Priority = DMA_PRIORITY_HIGH;
-	assert_param(HAL_DMA_Init(&usart2DmaRx) == HAL_OK);
-
-	DMA1_Stream5->CR |= DMA_SxCR_TCIE;	//enable transfer complete interrupts
-}
-
-/**
- * Start an interrupt driven receive.  This particular ISR is hard-coded
- * to give a semaphore when the reception is finished
- */
-int32_t startCircularReceiveDMA( void )
-{
-	rxInProgress = true;
-
-	//get the DMA peripheral ready to receive data immediately before enabling UART
-	__HAL_DMA_DISABLE(&usart2DmaRx);
-	setupUSART2DMA_circular();
-
-	//setup second address for double buffered mode
-	DMA1_Stream5->M1AR = (uint32_t) rxData2;
-
-	//NOTE: HAL_DMA_Start explicitly disables double buffer mode
-	//			so we'll explicitly enable double buffer mode later when
-	//			the actual transfer is started
-	if(HAL_DMA_Start(&usart2DmaRx, (uint32_t)&(USART2->RDR), (uint32_t)rxData1, RX_BUFF_LEN) != HAL_OK)
-	{
-		return -1;
-	}
-
-	//disable the stream and controller so we can setup dual buffers
-	__HAL_DMA_DISABLE(&usart2DmaRx);
-	//set the double buffer mode
-	DMA1_Stream5->CR |= DMA_SxCR_DBM;
-	//re-enable the stream and controller
-	__HAL_DMA_ENABLE(&usart2DmaRx);
-	DMA1_Stream5->CR |= DMA_SxCR_EN;
-
-	//for this specific instance, we'll avoid enabling UART interrupts for errors since
-	//we'll wind up with a lot of noise on the line (the way the ISR is written will
-	//cause a transfer to terminate if there are any errors are detected, rather than simply
-	//continue with what data it can).  In practice, most of the "errors" at baudrates below
-	//460800 are noise detection
-//		USART2->CR3 |= (USART_CR3_EIE);	//enable error interrupts
-	return 0;
-}
-
 void startUart4Traffic( TimerHandle_t xTimer )
 {
 	SetupUart4ExternalSim(BAUDRATE);
 }
 
-void stopReceiveDMA( void )
-{
-	rxInProgress = false;
-	HAL_DMA_Abort(&usart2DmaRx);
-}
-
 void uartPrintOutTask( void* NotUsed)
 {
 	static const uint8_t maxBytesReceived = 16;
-	uint8_t rxBufferedData[maxBytesReceived];
-
-	//setup double buffer mode for receiving via DMA into dual buffers
-	//that are automatically switched by the DMA hardware
-	startCircularReceiveDMA();
-	//next, setup USART2
-	STM_UartInit(USART2, BAUDRATE, NULL, &usart2DmaRx);
+	//leave room for a NULL terminator
+	uint8_t rxBufferedData[maxBytesReceived + 1];
 
-	//enable DMA reception mode
-	USART2->CR3 |= USART_CR3_DMAR;
-
-	//clear any error flags
-	USART2->ICR |= (USART_ICR_FECF | USART_ICR_PECF |
-					USART_ICR_NCF | USART_ICR_ORECF);
-
-	NVIC_SetPriority(USART2_IRQn, 6);
-	NVIC_EnableIRQ(USART2_IRQn);
-	USART2->CR1 |= (USART_CR1_UE);
+	//USART2 and DMA1_Stream5 are both setup by the driver, which
+	//immediately starts pushing received data into rxStream
+	Usart2DmaRxStart(rxStream, BAUDRATE);
 
 	while(1)
 	{
 		//fill a local buffer with 0's to make it easier to print
-		memset(rxBufferedData, 0, maxBytesReceived);
+		memset(rxBufferedData, 0, sizeof(rxBufferedData));
 		uint8_t numBytes = xStreamBufferReceive(	rxStream,
 													rxBufferedData,
 													maxBytesReceived,
@@ -240,78 +139,30 @@ void uartPrintOutTask( void* NotUsed)
 }
 
 /**
- * Given the DMA setup performed by setupUSART2DMA
- * this ISR will only execute when a DMA transfer is complete
- * Each time a transfer is completed, DMA peripheral will
- * automatically start writing to the opposite buffer (for example
- * the controller will initially be writing to the buffer
- * specified in DMA1_Stream5->M0AR.  After this buffer is filled
- * the DMA controller will start writing to the buffer i n
- * DMA1_Stream5->M1AR.
- *
+ * DMA1_Stream5 half/full transfer interrupts (continuous traffic)
+ * are handled by the driver
  */
 void DMA1_Stream5_IRQHandler(void)
 {
-	uint16_t numWritten = 0;
-	uint8_t* currBuffPtr = NULL;
 	portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
 	SEGGER_SYSVIEW_RecordEnterISR();
 
-	if(rxInProgress && (DMA1->HISR & DMA_HISR_TCIF5))
-	{
+	Usart2DmaRxDmaIsr(&xHigherPriorityTaskWoken);
 
-		//push data from the correct raw memory buffer into
-		//the freeRTOS stream buffer
-		//the DMA_SxCR_CT bit indicates the "Current Target"
-		//which is either DMA_SxM0AR or DMA_SxM1AR
-		//see section 8.5.5 for details on the CT bit of
-		//the DMA_SxCR register
-		if(DMA1_Stream5->CR & DMA_SxCR_CT)
-		{
-			currBuffPtr = rxData1;
-		}
-		else
-		{
-			currBuffPtr = rxData2;
-		}
-
-		//if there is something to add to the queue, do so
-		//(don't call xStreamBuferSendFromISR with a length of 0)
-		numWritten = xStreamBufferSendFromISR(	rxStream,
-												currBuffPtr,
-												RX_BUFF_LEN,
-												&xHigherPriorityTaskWoken);
-
-		//OH NO - not everything was written to the stream
-		//if this is catastrophic, do something drastic!
-		while(numWritten != RX_BUFF_LEN);
-
-			DMA1->HIFCR |= DMA_HIFCR_CTCIF5;
-	}
 	SEGGER_SYSVIEW_RecordExitISR();
 	portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
 }
 
 /**
- * This ISR should only execute when there is an error
+ * USART2 idle line (the end of a message) and error
+ * interrupts are also handled by the driver
  */
 void USART2_IRQHandler( void )
 {
 	portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
 	SEGGER_SYSVIEW_RecordEnterISR();
 
-	//first check for errors
-	if(	USART2->ISR & (	USART_ISR_ORE_Msk |
-						USART_ISR_NE_Msk |
-						USART_ISR_FE_Msk |
-						USART_ISR_PE_Msk ))
-	{
-		//clear error flags
-		USART2->ICR |= (USART_ICR_FECF |
-						USART_ICR_PECF |
-						USART_ICR_NCF |
-						USART_ICR_ORECF);
-	}
+	Usart2DmaRxUsartIsr(&xHigherPriorityTaskWoken);
 
 	SEGGER_SYSVIEW_RecordExitISR();
 	portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
@@ -0,0 +1,150 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Brian Amos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#include <FreeRTOS.h>
+#include <Nucleo_F767ZI_Init.h>
+#include <stm32f7xx_hal.h>
+#include <Nucleo_F767ZI_GPIO.h>
+#include <task.h>
+#include <SEGGER_SYSVIEW.h>
+#include <StaticArena.h>
+
+/**
+ * The tasks from main_taskCreation.c, with every TCB and stack
+ * carved out of one StaticArena.h arena instead of the FreeRTOS
+ * heap.  Nothing is allocated at startup, so unlike
+ * main_FailedStartup.c there is no creation order or heap size
+ * that can make a task fail to start - a stack that's too large
+ * fails the build at ARENA_ASSERT_FITS instead.
+ */
+
+/**
+ * 	function prototypes
+ */
+void GreenTask(void *argument);
+void BlueTask(void *argument);
+void RedTask(void *argument);
+void lookBusy( void );
+
+//the handle returned when creating BlueTask.
+//this global variable will be used by RedTask to delete BlueTask.
+TaskHandle_t blueTaskHandle;
+
+// some common variables to use for each task
+// 128 * 4 = 512 bytes
+//(recommended min stack size per task)
+#define STACK_SIZE 128
+
+//every task this main creates, along with its stack depth
+#define CHAPTER_ARENA(TASK, QUEUE, STREAM_BUFFER, POOL)	\
+	TASK(Green, STACK_SIZE)								\
+	TASK(Blue, STACK_SIZE)								\
+	TASK(Red, STACK_SIZE)
+
+ARENA_STATIC(taskArena, CHAPTER_ARENA);
+
+//the three tasks need about 2KB on the target
+ARENA_ASSERT_FITS(taskArena, 8 * 1024);
+
+int main(void)
+{
+	HWInit();
+	SEGGER_SYSVIEW_Conf();
+
+	SEGGER_SYSVIEW_PrintfHost("task arena: %u bytes\n", (unsigned)ARENA_FOOTPRINT(taskArena));
+
+	//creating a task from the arena always passes, the memory
+	//was set aside when the program was linked
+	ARENA_TASK_CREATE(taskArena, Green, GreenTask, "GreenTask", NULL, tskIDLE_PRIORITY + 2);
+	blueTaskHandle = ARENA_TASK_CREATE(taskArena, Blue, BlueTask, "BlueTask", NULL, tskIDLE_PRIORITY + 1);
+	ARENA_TASK_CREATE(taskArena, Red, RedTask, "RedTask", NULL, tskIDLE_PRIORITY + 1);
+
+	//start the scheduler - shouldn't return unless there's a problem
+	vTaskStartScheduler();
+
+	//the idle and timer tasks are statically allocated too, so this is never reached
+	while(1)
+	{
+	}
+}
+void GreenTask(void *argument)
+{
+	while(!ReadPushButton());
+	SEGGER_SYSVIEW_PrintfHost("Task1 running while Green LED is on\n");
+	GreenLed.On();
+	vTaskDelay(1500/ portTICK_PERIOD_MS);
+	GreenLed.Off();
+
+	//a task can delete itself by passing NULL to vTaskDelete
+	vTaskDelete(NULL);
+
+	//task never get's here
+	GreenLed.On();
+}
+
+void BlueTask( void* argument )
+{
+	while(1)
+	{
+		SEGGER_SYSVIEW_PrintfHost("BlueTaskRunning\n");
+		BlueLed.On();
+		vTaskDelay(200 / portTICK_PERIOD_MS);
+		BlueLed.Off();
+		vTaskDelay(200 / portTICK_PERIOD_MS);
+	}
+}
+
+void RedTask( void* argument )
+{
+	uint8_t firstRun = 1;
+
+	while(1)
+	{
+		lookBusy();
+
+		SEGGER_SYSVIEW_PrintfHost("RedTaskRunning\n");
+		RedLed.On();
+		vTaskDelay(500/ portTICK_PERIOD_MS);
+		RedLed.Off();
+		vTaskDelay(500/ portTICK_PERIOD_MS);
+
+		if(firstRun == 1)
+		{
+			//tasks can delete one-another by passing the desired
+			//TaskHandle_t to vTaskDelete
+			vTaskDelete(blueTaskHandle);
+			firstRun = 0;
+		}
+	}
+}
+
+void lookBusy( void )
+{
+	volatile uint32_t dontCare = 0;
+	for(int i = 0; i < 50E3; i++)
+	{
+		dontCare = i % 4;
+	}
+	SEGGER_SYSVIEW_PrintfHost("looking busy %d\n", dontCare);
+}
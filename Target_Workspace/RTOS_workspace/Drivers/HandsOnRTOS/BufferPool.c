@@ -0,0 +1,262 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Brian Amos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "BufferPool.h"
+
+#define BUF_POOL_IN_USE		( 0xFFFF )
+#define BUF_POOL_END		( 0xFFFE )	//terminates the free list
+
+static uint16_t blockIndex( BufPool_t const* Pool, void const* Block );
+static void* popFree( BufPool_t* Pool );
+static void pushFree( BufPool_t* Pool, uint16_t Index );
+
+/**
+ * initialize a pool of NumBlocks blocks, each BlockSize bytes long
+ * @param Pool pool to initialize
+ * @param Blocks storage for the blocks - NumBlocks * BlockSize bytes
+ * @param BlockSize length of each block.  Blocks are handed out at
+ * 			multiples of BlockSize from Blocks, so this should be a
+ * 			multiple of the alignment the blocks need (sizeof a struct is)
+ * @param Links NumBlocks entries used to track the free blocks
+ * @param NumBlocks number of blocks in the pool (< 0xFFFE)
+ */
+void BufPoolInit( BufPool_t* Pool, void* Blocks, size_t BlockSize, uint16_t* Links, uint16_t NumBlocks )
+{
+	configASSERT(Pool != NULL && Blocks != NULL && Links != NULL);
+	configASSERT(BlockSize != 0 && NumBlocks != 0 && NumBlocks < BUF_POOL_END);
+
+	Pool->Blocks = (uint8_t*)Blocks;
+	Pool->BlockSize = BlockSize;
+	Pool->Links = Links;
+	Pool->NumBlocks = NumBlocks;
+	Pool->InUse = 0;
+	Pool->HighWater = 0;
+
+	for(uint16_t i = 0; i < NumBlocks - 1; i++)
+	{
+		Links[i] = i + 1;
+	}
+	Links[NumBlocks - 1] = BUF_POOL_END;
+	Pool->FreeHead = 0;
+
+	Pool->FreeCount = xSemaphoreCreateCountingStatic(NumBlocks, NumBlocks, &Pool->FreeCountBuffer);
+	configASSERT(Pool->FreeCount != NULL);
+}
+
+/**
+ * take a block from the pool, waiting up to TicksToWait for one
+ * to be freed if the pool is empty
+ * @returns the block or NULL if none was available in time
+ */
+void* BufPoolAlloc( BufPool_t* Pool, TickType_t TicksToWait )
+{
+	void* block = NULL;
+
+	//once the semaphore has been taken there is guaranteed to be a
+	//block on the free list for this caller
+	if(xSemaphoreTake(Pool->FreeCount, TicksToWait) == pdPASS)
+	{
+		taskENTER_CRITICAL();
+		block = popFree(Pool);
+		taskEXIT_CRITICAL();
+	}
+	return block;
+}
+
+/**
+ * same as BufPoolAlloc, for use from an ISR (never blocks)
+ * @returns the block or NULL if the pool is empty
+ */
+void* BufPoolAllocFromISR( BufPool_t* Pool )
+{
+	void* block = NULL;
+
+	//taking a counting semaphore never wakes a task, so there's no need to yield
+	if(xSemaphoreTakeFromISR(Pool->FreeCount, NULL) == pdPASS)
+	{
+		UBaseType_t savedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+		block = popFree(Pool);
+		taskEXIT_CRITICAL_FROM_ISR(savedInterruptStatus);
+	}
+	return block;
+}
+
+/**
+ * give a block back to the pool.  Block must have come from
+ * BufPoolAlloc(FromISR) (or BufQueueReceive(FromISR)) on this pool
+ * and must not be used after it has been freed
+ */
+void BufPoolFree( BufPool_t* Pool, void* Block )
+{
+	uint16_t index = blockIndex(Pool, Block);
+
+	taskENTER_CRITICAL();
+	pushFree(Pool, index);
+	taskEXIT_CRITICAL();
+
+	xSemaphoreGive(Pool->FreeCount);
+}
+
+/**
+ * same as BufPoolFree, for use from an ISR
+ * @param HigherPriorityTaskWoken set to pdTRUE if a task waiting on
+ * 			BufPoolAlloc was woken (pass to portYIELD_FROM_ISR)
+ */
+void BufPoolFreeFromISR( BufPool_t* Pool, void* Block, BaseType_t* HigherPriorityTaskWoken )
+{
+	uint16_t index = blockIndex(Pool, Block);
+	UBaseType_t savedInterruptStatus;
+
+	savedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+	pushFree(Pool, index);
+	taskEXIT_CRITICAL_FROM_ISR(savedInterruptStatus);
+
+	xSemaphoreGiveFromISR(Pool->FreeCount, HigherPriorityTaskWoken);
+}
+
+uint16_t BufPoolNumFree( BufPool_t const* Pool )
+{
+	return (uint16_t)uxSemaphoreGetCount(Pool->FreeCount);
+}
+
+/**
+ * @returns the most blocks that have been allocated at once since
+ * 			the pool was initialized - if this reaches the pool's
+ * 			size, senders have been (or could have been) held up
+ * 			waiting for a block
+ */
+uint16_t BufPoolGetHighWaterMark( BufPool_t const* Pool )
+{
+	return Pool->HighWater;
+}
+
+/**
+ * initialize a queue of up to Length blocks from Pool
+ * @param Storage Length pointers worth of storage for the queue
+ */
+void BufQueueInit( BufQueue_t* Queue, BufPool_t* Pool, void** Storage, UBaseType_t Length )
+{
+	configASSERT(Queue != NULL && Pool != NULL && Storage != NULL);
+
+	Queue->Pool = Pool;
+	Queue->Queue = xQueueCreateStatic(Length, sizeof(void*), (uint8_t*)Storage, &Queue->QueueBuffer);
+	configASSERT(Queue->Queue != NULL);
+}
+
+/**
+ * send an allocated block, waiting up to TicksToWait for room in
+ * the queue.  Ownership of the block passes to the receiver if the
+ * block was queued - otherwise the caller still owns (and must
+ * eventually free) it
+ * @returns pdPASS if the block was queued
+ */
+BaseType_t BufQueueSend( BufQueue_t* Queue, void* Block, TickType_t TicksToWait )
+{
+	//catches sending a block that has already been freed
+	configASSERT(Queue->Pool->Links[blockIndex(Queue->Pool, Block)] == BUF_POOL_IN_USE);
+	return xQueueSend(Queue->Queue, &Block, TicksToWait);
+}
+
+BaseType_t BufQueueSendFromISR( BufQueue_t* Queue, void* Block, BaseType_t* HigherPriorityTaskWoken )
+{
+	configASSERT(Queue->Pool->Links[blockIndex(Queue->Pool, Block)] == BUF_POOL_IN_USE);
+	return xQueueSendFromISR(Queue->Queue, &Block, HigherPriorityTaskWoken);
+}
+
+/**
+ * wait up to TicksToWait for a block to arrive.  The caller owns
+ * the returned block and must give it back with BufPoolFree
+ * @returns the block or NULL if nothing arrived in time
+ */
+void* BufQueueReceive( BufQueue_t* Queue, TickType_t TicksToWait )
+{
+	void* block = NULL;
+
+	if(xQueueReceive(Queue->Queue, &block, TicksToWait) != pdPASS)
+	{
+		return NULL;
+	}
+	return block;
+}
+
+void* BufQueueReceiveFromISR( BufQueue_t* Queue, BaseType_t* HigherPriorityTaskWoken )
+{
+	void* block = NULL;
+
+	if(xQueueReceiveFromISR(Queue->Queue, &block, HigherPriorityTaskWoken) != pdPASS)
+	{
+		return NULL;
+	}
+	return block;
+}
+
+/**
+ * @returns the index of Block within the pool, asserting that it
+ * 			really is the start of one of the pool's blocks
+ */
+static uint16_t blockIndex( BufPool_t const* Pool, void const* Block )
+{
+	uint8_t const* block = (uint8_t const*)Block;
+	size_t offset;
+
+	configASSERT(block >= Pool->Blocks);
+	offset = (size_t)(block - Pool->Blocks);
+	configASSERT(offset % Pool->BlockSize == 0);
+	configASSERT(offset / Pool->BlockSize < Pool->NumBlocks);
+
+	return (uint16_t)(offset / Pool->BlockSize);
+}
+
+/**
+ * must be called from a critical section, with a block reserved
+ * by taking FreeCount
+ */
+static void* popFree( BufPool_t* Pool )
+{
+	uint16_t index = Pool->FreeHead;
+
+	configASSERT(index != BUF_POOL_END);
+	Pool->FreeHead = Pool->Links[index];
+	Pool->Links[index] = BUF_POOL_IN_USE;
+
+	if(++Pool->InUse > Pool->HighWater)
+	{
+		Pool->HighWater = Pool->InUse;
+	}
+	return &Pool->Blocks[(size_t)index * Pool->BlockSize];
+}
+
+/**
+ * must be called from a critical section
+ */
+static void pushFree( BufPool_t* Pool, uint16_t Index )
+{
+	//a block that is already on the free list has been freed twice
+	configASSERT(Pool->Links[Index] == BUF_POOL_IN_USE);
+
+	Pool->Links[Index] = Pool->FreeHead;
+	Pool->FreeHead = Index;
+	Pool->InUse--;
+}
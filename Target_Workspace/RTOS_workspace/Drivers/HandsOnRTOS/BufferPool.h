@@ -0,0 +1,127 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Brian Amos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef DRIVERS_HANDSONRTOS_BUFFERPOOL_H_
+#define DRIVERS_HANDSONRTOS_BUFFERPOOL_H_
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include <stdint.h>
+#include <FreeRTOS.h>
+#include <queue.h>
+#include <semphr.h>
+
+/**
+ * A pool of fixed size blocks and a queue of pointers to them, for
+ * passing large messages between tasks (and ISRs) by reference
+ * without using the heap.
+ *
+ * The sender takes a block from the pool, fills it in and sends it
+ * (only the pointer is copied into the queue).  The receiver owns the
+ * block once it has been received and gives it back to the pool when
+ * it's done with it:
+ *
+ *		LedStates_t* state = BufPoolAlloc(&ledPool, portMAX_DELAY);
+ *		state->msDelayTime = 1000;
+ *		BufQueueSend(&ledQueue, state, portMAX_DELAY);
+ *		...
+ *		LedStates_t* cmd = BufQueueReceive(&ledQueue, portMAX_DELAY);
+ *		...
+ *		BufPoolFree(&ledPool, cmd);
+ *
+ * Free blocks are kept on a singly linked free list of block indexes,
+ * so allocating and freeing are both O(1).  A counting semaphore tracks
+ * the number of free blocks, which is what allows a task to block until
+ * a block is returned to the pool.
+ *
+ * Every block is either on the free list or marked as in use, which
+ * lets BufPoolFree and BufQueueSend catch blocks that don't belong to
+ * the pool, double frees and blocks sent after they were freed.
+ */
+
+typedef struct
+{
+	uint8_t* Blocks;
+	size_t BlockSize;
+	//index of the next free block for blocks on the free list, BUF_POOL_IN_USE otherwise
+	uint16_t* Links;
+	uint16_t NumBlocks;
+	uint16_t FreeHead;
+	uint16_t InUse;
+	uint16_t HighWater;		//most blocks that have been in use at once
+	SemaphoreHandle_t FreeCount;
+	StaticSemaphore_t FreeCountBuffer;
+}BufPool_t;
+
+typedef struct
+{
+	BufPool_t* Pool;
+	QueueHandle_t Queue;
+	StaticQueue_t QueueBuffer;
+}BufQueue_t;
+
+/**
+ * define the static storage for a pool of Count BlockType's
+ * (pass to BufPoolInit with BUF_POOL_INIT)
+ */
+#define BUF_POOL_STATIC(Name, BlockType, Count)			\
+	static BlockType Name##Blocks[Count];				\
+	static uint16_t Name##Links[Count];					\
+	static BufPool_t Name
+
+#define BUF_POOL_INIT(Name)								\
+	BufPoolInit(&Name, Name##Blocks, sizeof(Name##Blocks[0]), Name##Links,	\
+				(uint16_t)(sizeof(Name##Blocks) / sizeof(Name##Blocks[0])))
+
+/**
+ * define the static storage for a queue holding up to Length blocks
+ */
+#define BUF_QUEUE_STATIC(Name, Length)					\
+	static void* Name##Storage[Length];					\
+	static BufQueue_t Name
+
+#define BUF_QUEUE_INIT(Name, Pool)						\
+	BufQueueInit(&Name, &Pool, Name##Storage,			\
+				(UBaseType_t)(sizeof(Name##Storage) / sizeof(Name##Storage[0])))
+
+void BufPoolInit( BufPool_t* Pool, void* Blocks, size_t BlockSize, uint16_t* Links, uint16_t NumBlocks );
+void* BufPoolAlloc( BufPool_t* Pool, TickType_t TicksToWait );
+void* BufPoolAllocFromISR( BufPool_t* Pool );
+void BufPoolFree( BufPool_t* Pool, void* Block );
+void BufPoolFreeFromISR( BufPool_t* Pool, void* Block, BaseType_t* HigherPriorityTaskWoken );
+uint16_t BufPoolNumFree( BufPool_t const* Pool );
+uint16_t BufPoolGetHighWaterMark( BufPool_t const* Pool );
+
+void BufQueueInit( BufQueue_t* Queue, BufPool_t* Pool, void** Storage, UBaseType_t Length );
+BaseType_t BufQueueSend( BufQueue_t* Queue, void* Block, TickType_t TicksToWait );
+BaseType_t BufQueueSendFromISR( BufQueue_t* Queue, void* Block, BaseType_t* HigherPriorityTaskWoken );
+void* BufQueueReceive( BufQueue_t* Queue, TickType_t TicksToWait );
+void* BufQueueReceiveFromISR( BufQueue_t* Queue, BaseType_t* HigherPriorityTaskWoken );
+
+#ifdef __cplusplus
+ }
+#endif
+#endif /* DRIVERS_HANDSONRTOS_BUFFERPOOL_H_ */
@@ -0,0 +1,438 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Brian Amos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "HeapProfiler.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+//the host unit tests run without the SystemView recorder
+#ifndef HEAP_PROFILER_USE_SYSVIEW
+#define HEAP_PROFILER_USE_SYSVIEW 1
+#endif
+
+#if HEAP_PROFILER_USE_SYSVIEW == 1
+#include <SEGGER_SYSVIEW.h>
+#endif
+
+#if ( HEAP_PROFILER_MAX_SITES & ( HEAP_PROFILER_MAX_SITES - 1 ) ) != 0
+	#error HEAP_PROFILER_MAX_SITES must be a power of two
+#endif
+#if ( HEAP_PROFILER_MAX_LIVE & ( HEAP_PROFILER_MAX_LIVE - 1 ) ) != 0
+	#error HEAP_PROFILER_MAX_LIVE must be a power of two
+#endif
+
+#define NO_SLOT ( 0xFFFF )
+
+//name reported for allocations made before the scheduler started
+#define STARTUP_TASK_NAME "-"
+
+typedef struct
+{
+	void* Address;			//NULL for an empty slot
+	TickType_t Allocated;
+	size_t Size;			//requested
+	uint16_t Site;
+}LiveBlock_t;
+
+//both tables are open addressed with linear probing.  Sites are never
+//removed (only by HeapProfilerReset), live blocks are removed by
+//shifting the rest of their probe sequence back
+static HeapProfilerSite_t sites[HEAP_PROFILER_MAX_SITES];
+static LiveBlock_t live[HEAP_PROFILER_MAX_LIVE];
+static HeapProfilerSummary_t summary;
+
+static uint32_t hashPointer( void const* Ptr );
+static uint8_t bucket( size_t Value );
+static bool siteUsed( HeapProfilerSite_t const* Site );
+static uint16_t findSite( void const* Caller, TaskHandle_t Task );
+static uint16_t findLive( void const* Address );
+static void removeLive( uint16_t Slot );
+
+/**
+ * traceHEAP_INIT - the allocator has set up its heap
+ */
+void HeapProfilerHeapInit( void* Start, size_t HeapSize, size_t BlockOverhead )
+{
+	summary.HeapStart = Start;
+	summary.HeapSize = HeapSize;
+	summary.BlockOverhead = BlockOverhead;
+	HeapProfilerSendHeapDefine();
+}
+
+void HeapProfilerSendHeapDefine( void )
+{
+#if HEAP_PROFILER_USE_SYSVIEW == 1
+	if(summary.HeapStart != NULL)
+	{
+		SEGGER_SYSVIEW_HeapDefine(summary.HeapStart, summary.HeapStart, summary.HeapSize, summary.BlockOverhead);
+	}
+#endif
+}
+
+/**
+ * traceMALLOC_FROM - called for failed allocations too (Address NULL)
+ */
+void HeapProfilerMalloc( void* Address, size_t WantedSize, size_t BlockSize, void const* Caller )
+{
+	TaskHandle_t task = NULL;
+	HeapProfilerSite_t* site;
+	uint16_t siteIndex;
+
+	if(Address != NULL)
+	{
+#if HEAP_PROFILER_USE_SYSVIEW == 1
+		SEGGER_SYSVIEW_HeapAllocEx(summary.HeapStart, Address, (unsigned)(BlockSize - summary.BlockOverhead), (unsigned)(uintptr_t)Caller);
+#else
+		(void)BlockSize;
+#endif
+		summary.Sizes[bucket(WantedSize)]++;
+	}
+
+	if(xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED)
+	{
+		task = xTaskGetCurrentTaskHandle();
+	}
+
+	siteIndex = findSite(Caller, task);
+	if(siteIndex == NO_SLOT)
+	{
+		summary.UntrackedAllocs++;
+		return;
+	}
+	site = &sites[siteIndex];
+	if(!siteUsed(site))
+	{
+		site->Caller = Caller;
+		site->Task = task;
+		strncpy(site->TaskName, (task != NULL) ? pcTaskGetName(task) : STARTUP_TASK_NAME, configMAX_TASK_NAME_LEN - 1);
+	}
+
+	if(Address == NULL)
+	{
+		site->Failed++;
+		return;
+	}
+
+	if(site->Allocs == 0 || WantedSize < site->MinSize)
+	{
+		site->MinSize = WantedSize;
+	}
+	if(WantedSize > site->MaxSize)
+	{
+		site->MaxSize = WantedSize;
+	}
+	site->Allocs++;
+	site->TotalBytes += WantedSize;
+
+	//only blocks with a slot count as live, so every one of them is
+	//taken off again when it's freed
+	for(uint32_t probe = 0, slot = hashPointer(Address); probe < HEAP_PROFILER_MAX_LIVE; probe++, slot++)
+	{
+		LiveBlock_t* block = &live[slot & (HEAP_PROFILER_MAX_LIVE - 1)];
+
+		if(block->Address == NULL)
+		{
+			block->Address = Address;
+			block->Allocated = xTaskGetTickCount();
+			block->Size = WantedSize;
+			block->Site = siteIndex;
+
+			site->Live++;
+			if(site->Live > site->PeakLive)
+			{
+				site->PeakLive = site->Live;
+			}
+			site->LiveBytes += WantedSize;
+			if(site->LiveBytes > site->PeakBytes)
+			{
+				site->PeakBytes = site->LiveBytes;
+			}
+			return;
+		}
+	}
+	summary.UntrackedAllocs++;
+}
+
+/**
+ * traceFREE
+ */
+void HeapProfilerFree( void* Address, size_t BlockSize )
+{
+	uint16_t slot;
+	LiveBlock_t* block;
+	HeapProfilerSite_t* site;
+	TickType_t lifetime;
+
+	(void)BlockSize;
+#if HEAP_PROFILER_USE_SYSVIEW == 1
+	SEGGER_SYSVIEW_HeapFree(summary.HeapStart, Address);
+#endif
+
+	slot = findLive(Address);
+	if(slot == NO_SLOT)
+	{
+		summary.UntrackedFrees++;
+		return;
+	}
+	block = &live[slot];
+	site = &sites[block->Site];
+	lifetime = xTaskGetTickCount() - block->Allocated;
+
+	site->Frees++;
+	site->Live--;
+	site->LiveBytes -= block->Size;
+	if(lifetime <= UINT32_MAX - site->LifetimeTotal)
+	{
+		site->LifetimeTotal += lifetime;
+	}
+	else
+	{
+		site->LifetimeTotal = UINT32_MAX;
+	}
+	if(lifetime > site->LifetimeMax)
+	{
+		site->LifetimeMax = lifetime;
+	}
+	summary.Lifetimes[bucket(lifetime)]++;
+
+	removeLive(slot);
+}
+
+void HeapProfilerReset( void )
+{
+	vTaskSuspendAll();
+	memset(sites, 0, sizeof(sites));
+	memset(live, 0, sizeof(live));
+	summary.UntrackedAllocs = 0;
+	summary.UntrackedFrees = 0;
+	memset(summary.Sizes, 0, sizeof(summary.Sizes));
+	memset(summary.Lifetimes, 0, sizeof(summary.Lifetimes));
+	xTaskResumeAll();
+}
+
+void HeapProfilerGetSummary( HeapProfilerSummary_t* Summary )
+{
+	vTaskSuspendAll();
+	*Summary = summary;
+	Summary->NumSites = 0;
+	for(uint16_t i = 0; i < HEAP_PROFILER_MAX_SITES; i++)
+	{
+		if(siteUsed(&sites[i]))
+		{
+			Summary->NumSites++;
+		}
+	}
+	xTaskResumeAll();
+}
+
+UBaseType_t HeapProfilerGetSites( HeapProfilerSite_t* Sites, UBaseType_t MaxSites )
+{
+	UBaseType_t numSites = 0;
+
+	vTaskSuspendAll();
+	for(uint16_t i = 0; i < HEAP_PROFILER_MAX_SITES && numSites < MaxSites; i++)
+	{
+		if(siteUsed(&sites[i]))
+		{
+			Sites[numSites++] = sites[i];
+		}
+	}
+	xTaskResumeAll();
+	return numSites;
+}
+
+/**
+ * writes, in this order (addresses in hex, everything else in decimal):
+ *	heapprof heap <start> <size> <block overhead> <sites> <untracked allocs> <untracked frees>
+ *	heapprof sizes <bucket counts>
+ *	heapprof lifetimes <bucket counts>
+ *	heapprof site <caller> <task> <allocs> <frees> <failed> <live> <peak live>
+ *		<live bytes> <peak bytes> <total bytes> <min size> <max size>
+ *		<lifetime total> <lifetime max>		(a line per site)
+ *	heapprof end
+ */
+void HeapProfilerDump( void (*Print)( char const* Line ) )
+{
+	HeapProfilerSummary_t sum;
+	char line[200];
+	int len;
+
+	HeapProfilerGetSummary(&sum);
+	snprintf(line, sizeof(line), "heapprof heap %lx %lu %lu %lu %lu %lu",
+			(unsigned long)(uintptr_t)sum.HeapStart, (unsigned long)sum.HeapSize,
+			(unsigned long)sum.BlockOverhead, (unsigned long)sum.NumSites,
+			(unsigned long)sum.UntrackedAllocs, (unsigned long)sum.UntrackedFrees);
+	Print(line);
+
+	len = snprintf(line, sizeof(line), "heapprof sizes");
+	for(int i = 0; i < HEAP_PROFILER_BUCKETS; i++)
+	{
+		len += snprintf(line + len, sizeof(line) - len, " %lu", (unsigned long)sum.Sizes[i]);
+	}
+	Print(line);
+
+	len = snprintf(line, sizeof(line), "heapprof lifetimes");
+	for(int i = 0; i < HEAP_PROFILER_BUCKETS; i++)
+	{
+		len += snprintf(line + len, sizeof(line) - len, " %lu", (unsigned long)sum.Lifetimes[i]);
+	}
+	Print(line);
+
+	//one site at a time, so Print isn't called with the scheduler suspended
+	for(uint16_t i = 0; i < HEAP_PROFILER_MAX_SITES; i++)
+	{
+		HeapProfilerSite_t site;
+
+		vTaskSuspendAll();
+		site = sites[i];
+		xTaskResumeAll();
+		if(!siteUsed(&site))
+		{
+			continue;
+		}
+
+		//task names can have spaces ("Tmr Svc"), the report splits on them
+		for(char* c = site.TaskName; *c != '\0'; c++)
+		{
+			if(*c == ' ')
+			{
+				*c = '_';
+			}
+		}
+		snprintf(line, sizeof(line), "heapprof site %lx %s %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu",
+				(unsigned long)(uintptr_t)site.Caller, site.TaskName,
+				(unsigned long)site.Allocs, (unsigned long)site.Frees, (unsigned long)site.Failed,
+				(unsigned long)site.Live, (unsigned long)site.PeakLive,
+				(unsigned long)site.LiveBytes, (unsigned long)site.PeakBytes, (unsigned long)site.TotalBytes,
+				(unsigned long)site.MinSize, (unsigned long)site.MaxSize,
+				(unsigned long)site.LifetimeTotal, (unsigned long)site.LifetimeMax);
+		Print(line);
+	}
+	Print("heapprof end");
+}
+
+static uint32_t hashPointer( void const* Ptr )
+{
+	uint32_t h = (uint32_t)(uintptr_t)Ptr;
+
+	//blocks and return addresses are aligned, mix the upper bits down
+	h ^= h >> 16;
+	h *= 0x45D9F3Bu;
+	h ^= h >> 16;
+	return h;
+}
+
+/**
+ * @returns 0 for 0, otherwise the number of bits in Value (capped
+ * 			to the last bucket) - 1 -> 1, 2-3 -> 2, 4-7 -> 3...
+ */
+static uint8_t bucket( size_t Value )
+{
+	uint8_t bits = 0;
+
+	while(Value != 0 && bits < HEAP_PROFILER_BUCKETS - 1)
+	{
+		Value >>= 1;
+		bits++;
+	}
+	return bits;
+}
+
+static bool siteUsed( HeapProfilerSite_t const* Site )
+{
+	return Site->Allocs != 0 || Site->Failed != 0;
+}
+
+/**
+ * @returns the site for this caller and task, or a free slot for it
+ */
+static uint16_t findSite( void const* Caller, TaskHandle_t Task )
+{
+	uint32_t slot = hashPointer(Caller) ^ hashPointer(Task);
+
+	for(uint32_t probe = 0; probe < HEAP_PROFILER_MAX_SITES; probe++, slot++)
+	{
+		HeapProfilerSite_t const* site = &sites[slot & (HEAP_PROFILER_MAX_SITES - 1)];
+
+		if(!siteUsed(site) || (site->Caller == Caller && site->Task == Task))
+		{
+			return (uint16_t)(slot & (HEAP_PROFILER_MAX_SITES - 1));
+		}
+	}
+	return NO_SLOT;
+}
+
+static uint16_t findLive( void const* Address )
+{
+	uint32_t slot = hashPointer(Address);
+
+	for(uint32_t probe = 0; probe < HEAP_PROFILER_MAX_LIVE; probe++, slot++)
+	{
+		LiveBlock_t const* block = &live[slot & (HEAP_PROFILER_MAX_LIVE - 1)];
+
+		if(block->Address == Address)
+		{
+			return (uint16_t)(slot & (HEAP_PROFILER_MAX_LIVE - 1));
+		}
+		if(block->Address == NULL)
+		{
+			break;
+		}
+	}
+	return NO_SLOT;
+}
+
+/**
+ * empty Slot, then move back any blocks after it that would no longer
+ * be found from their home slot
+ */
+static void removeLive( uint16_t Slot )
+{
+	uint32_t hole = Slot;
+	uint32_t next = Slot;
+
+	live[hole].Address = NULL;
+	while(1)
+	{
+		uint32_t home;
+
+		next = (next + 1) & (HEAP_PROFILER_MAX_LIVE - 1);
+		if(live[next].Address == NULL)
+		{
+			break;
+		}
+		home = hashPointer(live[next].Address) & (HEAP_PROFILER_MAX_LIVE - 1);
+
+		//the block stays if its home is cyclically in (hole, next]
+		if((hole <= next) ? (hole < home && home <= next) : (hole < home || home <= next))
+		{
+			continue;
+		}
+		live[hole] = live[next];
+		live[next].Address = NULL;
+		hole = next;
+	}
+}
@@ -0,0 +1,148 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Brian Amos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef DRIVERS_HANDSONRTOS_HEAPPROFILER_H_
+#define DRIVERS_HANDSONRTOS_HEAPPROFILER_H_
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <FreeRTOS.h>
+#include <task.h>
+
+/**
+ * Allocation tracing for the MemMang allocators (heap_4.c, heap_6.c).
+ *
+ * The allocators call traceHEAP_INIT, traceMALLOC_FROM and traceFREE
+ * (see FreeRTOS.h).  Setting SYSVIEW_FREERTOS_HEAP_PROFILER to 1 in
+ * FreeRTOSConfig.h points them at the functions below, which:
+ *	- send SystemView HeapDefine/HeapAllocEx/HeapFree events, tagged
+ *	  with the address pvPortMalloc was called from, so SystemView's
+ *	  heap view shows who owns each block
+ *	- keep statistics on the target for every call site and task
+ *	  that allocates - allocations, failures, live blocks and bytes
+ *	  (and their peaks), requested sizes and how long blocks live
+ *	- keep histograms of the requested sizes and the lifetimes of
+ *	  freed blocks (in ticks), in power of two buckets
+ *
+ * HeapProfilerDump writes all of it out as "heapprof" text lines, which
+ * Host/Tools/heapReport.c turns into a per call site report (with the
+ * call sites looked up in the ELF file).  Call sites that always ask for
+ * the same size are the ones to move into a BufferPool.h pool.
+ *
+ * The call site is the return address of pvPortMalloc, so objects the
+ * kernel allocates are reported against xTaskCreate, xQueueGenericCreate,
+ * etc. - the task that created them tells them apart.
+ *
+ * The hooks run with the scheduler suspended (as the allocators do),
+ * so they need no locking of their own.  Each allocation costs a hash
+ * of the caller and task and one of the block address.  Allocations
+ * that don't fit in the tables are counted, but not tracked.
+ */
+
+//call site + task combinations tracked - must be a power of two
+#ifndef HEAP_PROFILER_MAX_SITES
+#define HEAP_PROFILER_MAX_SITES 32
+#endif
+
+//blocks tracked while allocated - must be a power of two
+#ifndef HEAP_PROFILER_MAX_LIVE
+#define HEAP_PROFILER_MAX_LIVE 64
+#endif
+
+//histogram buckets: 0, 1, 2-3, 4-7 ... the last one is open ended
+#define HEAP_PROFILER_BUCKETS 16
+
+typedef struct
+{
+	void const* Caller;			//return address of the pvPortMalloc call
+	TaskHandle_t Task;			//NULL before the scheduler was started
+	char TaskName[configMAX_TASK_NAME_LEN];
+	uint32_t Allocs;
+	uint32_t Frees;
+	uint32_t Failed;
+	uint32_t Live;				//blocks still allocated
+	uint32_t PeakLive;
+	size_t LiveBytes;			//requested bytes still allocated
+	size_t PeakBytes;
+	size_t TotalBytes;			//requested bytes, all allocations
+	size_t MinSize;
+	size_t MaxSize;
+	uint32_t LifetimeTotal;		//ticks, summed over the freed blocks (saturates)
+	TickType_t LifetimeMax;
+}HeapProfilerSite_t;
+
+typedef struct
+{
+	void* HeapStart;
+	size_t HeapSize;
+	size_t BlockOverhead;
+	UBaseType_t NumSites;
+	uint32_t UntrackedAllocs;	//no room left for the site or the block
+	uint32_t UntrackedFrees;	//frees of blocks that weren't being tracked
+	uint32_t Sizes[HEAP_PROFILER_BUCKETS];
+	uint32_t Lifetimes[HEAP_PROFILER_BUCKETS];
+}HeapProfilerSummary_t;
+
+/**
+ * the allocator hooks
+ */
+void HeapProfilerHeapInit( void* Start, size_t HeapSize, size_t BlockOverhead );
+void HeapProfilerMalloc( void* Address, size_t WantedSize, size_t BlockSize, void const* Caller );
+void HeapProfilerFree( void* Address, size_t BlockSize );
+
+/**
+ * resend the heap definition to SystemView - from the system
+ * description callback, once a recording has started
+ */
+void HeapProfilerSendHeapDefine( void );
+
+/**
+ * forget all statistics and tracked blocks
+ * (blocks allocated before this are freed as untracked)
+ */
+void HeapProfilerReset( void );
+
+void HeapProfilerGetSummary( HeapProfilerSummary_t* Summary );
+
+/**
+ * copy out up to MaxSites call sites, in no particular order
+ * @returns the number of sites copied
+ */
+UBaseType_t HeapProfilerGetSites( HeapProfilerSite_t* Sites, UBaseType_t MaxSites );
+
+/**
+ * write the summary and every call site out as "heapprof" lines
+ * (without line endings) for Host/Tools/heapReport.c
+ * @param Print called once per line, outside of any critical section
+ */
+void HeapProfilerDump( void (*Print)( char const* Line ) );
+
+#ifdef __cplusplus
+ }
+#endif
+#endif /* DRIVERS_HANDSONRTOS_HEAPPROFILER_H_ */
@@ -0,0 +1,161 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Brian Amos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "LatencyHistogram.h"
+#include <stdio.h>
+#include <string.h>
+
+//values below this get a bucket each
+#define LINEAR_LIMIT ( 2 * LATENCY_HIST_SUB_BUCKETS )
+
+static inline uint32_t bucketOf( uint32_t Value )
+{
+	uint32_t shift;
+
+	if(Value < LINEAR_LIMIT)
+	{
+		return Value;
+	}
+	//position of the top bit, less the bits that pick the sub bucket
+	shift = (31 - (uint32_t)__builtin_clz(Value)) - LATENCY_HIST_SUB_BITS;
+	return ((shift + 1) << LATENCY_HIST_SUB_BITS) +
+			((Value >> shift) & (LATENCY_HIST_SUB_BUCKETS - 1));
+}
+
+uint32_t LatencyHistBucketLow( uint32_t Bucket )
+{
+	uint32_t shift;
+
+	if(Bucket < LINEAR_LIMIT)
+	{
+		return Bucket;
+	}
+	shift = (Bucket >> LATENCY_HIST_SUB_BITS) - 1;
+	return (LATENCY_HIST_SUB_BUCKETS + (Bucket & (LATENCY_HIST_SUB_BUCKETS - 1))) << shift;
+}
+
+uint32_t LatencyHistBucketHigh( uint32_t Bucket )
+{
+	if(Bucket < LINEAR_LIMIT)
+	{
+		return Bucket;
+	}
+	return LatencyHistBucketLow(Bucket) + ((1UL << ((Bucket >> LATENCY_HIST_SUB_BITS) - 1)) - 1);
+}
+
+void LatencyHistReset( LatencyHist_t* Hist )
+{
+	memset(Hist, 0, sizeof(*Hist));
+	Hist->Min = UINT32_MAX;
+}
+
+void LatencyHistRecord( LatencyHist_t* Hist, uint32_t Value )
+{
+	Hist->Buckets[bucketOf(Value)]++;
+	Hist->Count++;
+	Hist->Sum += Value;
+	if(Value < Hist->Min)
+	{
+		Hist->Min = Value;
+	}
+	if(Value > Hist->Max)
+	{
+		Hist->Max = Value;
+	}
+}
+
+uint32_t LatencyHistPercentile( LatencyHist_t const* Hist, uint32_t Permille )
+{
+	uint64_t rank;
+	uint32_t seen = 0;
+
+	if(Hist->Count == 0)
+	{
+		return 0;
+	}
+	if(Permille > 1000)
+	{
+		Permille = 1000;
+	}
+	//the value at position ceil(Count * Permille / 1000), counting from 1
+	rank = ((uint64_t)Hist->Count * Permille + 999) / 1000;
+	if(rank == 0)
+	{
+		rank = 1;
+	}
+
+	for(uint32_t i = 0; i < LATENCY_HIST_BUCKETS; i++)
+	{
+		seen += Hist->Buckets[i];
+		if(seen >= rank)
+		{
+			uint32_t high = LatencyHistBucketHigh(i);
+			return (high < Hist->Max) ? high : Hist->Max;
+		}
+	}
+	return Hist->Max;
+}
+
+uint32_t LatencyHistMean( LatencyHist_t const* Hist )
+{
+	if(Hist->Count == 0)
+	{
+		return 0;
+	}
+	return (uint32_t)(Hist->Sum / Hist->Count);
+}
+
+void LatencyHistSummarize( LatencyHist_t const* Hist, LatencyHistSummary_t* Summary )
+{
+	Summary->Count = Hist->Count;
+	Summary->Min = (Hist->Count != 0) ? Hist->Min : 0;
+	Summary->Mean = LatencyHistMean(Hist);
+	Summary->P50 = LatencyHistPercentile(Hist, 500);
+	Summary->P99 = LatencyHistPercentile(Hist, 990);
+	Summary->Max = Hist->Max;
+}
+
+void LatencyHistDump( LatencyHist_t const* Hist, char const* Name, void (*Print)( char const* Line ) )
+{
+	char line[96];
+	LatencyHistSummary_t sum;
+
+	LatencyHistSummarize(Hist, &sum);
+	snprintf(line, sizeof(line), "lathist %s %lu %lu %lu %lu %lu %lu", Name,
+			(unsigned long)sum.Count, (unsigned long)sum.Min, (unsigned long)sum.Mean,
+			(unsigned long)sum.P50, (unsigned long)sum.P99, (unsigned long)sum.Max);
+	Print(line);
+
+	for(uint32_t i = 0; i < LATENCY_HIST_BUCKETS; i++)
+	{
+		if(Hist->Buckets[i] != 0)
+		{
+			snprintf(line, sizeof(line), "lathist %s bucket %lu %lu %lu", Name,
+					(unsigned long)LatencyHistBucketLow(i), (unsigned long)LatencyHistBucketHigh(i),
+					(unsigned long)Hist->Buckets[i]);
+			Print(line);
+		}
+	}
+}
@@ -0,0 +1,110 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Brian Amos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef DRIVERS_HANDSONRTOS_LATENCYHISTOGRAM_H_
+#define DRIVERS_HANDSONRTOS_LATENCYHISTOGRAM_H_
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include <stdint.h>
+
+/**
+ * Fixed size histograms for latency measurements (in cycles, ns or any
+ * other unit that fits in 32 bits).
+ *
+ * The buckets are log-linear: values below 16 get a bucket each, above
+ * that every power of two is split into 8 equal buckets, so a bucket
+ * is never wider than 1/8th of the values in it.  Recording a value is
+ * a count leading zeros, a shift and a few adds, cheap enough to do
+ * from an ISR on every interrupt.  Percentiles are worked out from the
+ * buckets, so they are exact below 16 and within 12.5% above (always
+ * rounded up, and never more than the largest value recorded); the
+ * minimum, maximum and mean are exact.
+ *
+ * A histogram isn't locked - record into it from one context only
+ * (one ISR or one task) and read it once recording has stopped.
+ */
+
+#define LATENCY_HIST_SUB_BITS 3
+#define LATENCY_HIST_SUB_BUCKETS (1UL << LATENCY_HIST_SUB_BITS)
+#define LATENCY_HIST_BUCKETS ((32 - LATENCY_HIST_SUB_BITS + 1) * LATENCY_HIST_SUB_BUCKETS)
+
+typedef struct
+{
+	uint32_t Count;
+	uint32_t Min;
+	uint32_t Max;
+	uint64_t Sum;
+	uint32_t Buckets[LATENCY_HIST_BUCKETS];
+}LatencyHist_t;
+
+typedef struct
+{
+	uint32_t Count;
+	uint32_t Min;
+	uint32_t Mean;
+	uint32_t P50;
+	uint32_t P99;
+	uint32_t Max;
+}LatencyHistSummary_t;
+
+void LatencyHistReset( LatencyHist_t* Hist );
+
+void LatencyHistRecord( LatencyHist_t* Hist, uint32_t Value );
+
+/**
+ * @param Permille 0 - 1000 (990 for the 99th percentile)
+ * @returns the smallest bucket bound at least Permille/1000 of the
+ * 			values are at or below, 0 for an empty histogram
+ */
+uint32_t LatencyHistPercentile( LatencyHist_t const* Hist, uint32_t Permille );
+
+/**
+ * @returns the mean, rounded down (0 for an empty histogram)
+ */
+uint32_t LatencyHistMean( LatencyHist_t const* Hist );
+
+void LatencyHistSummarize( LatencyHist_t const* Hist, LatencyHistSummary_t* Summary );
+
+/**
+ * the range of values counted in a bucket
+ */
+uint32_t LatencyHistBucketLow( uint32_t Bucket );
+uint32_t LatencyHistBucketHigh( uint32_t Bucket );
+
+/**
+ * write the histogram out as "lathist" lines (without line endings):
+ *	lathist <Name> <count> <min> <mean> <p50> <p99> <max>
+ * followed by one line per non-empty bucket:
+ *	lathist <Name> bucket <low> <high> <count>
+ * @param Print called once per line
+ */
+void LatencyHistDump( LatencyHist_t const* Hist, char const* Name, void (*Print)( char const* Line ) );
+
+#ifdef __cplusplus
+ }
+#endif
+#endif /* DRIVERS_HANDSONRTOS_LATENCYHISTOGRAM_H_ */
@@ -0,0 +1,287 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Brian Amos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "MultiProducerRing.h"
+#include <task.h>
+#include <string.h>
+
+#if (MP_RING_MAX_RECORDS & (MP_RING_MAX_RECORDS - 1)) != 0
+#error MP_RING_MAX_RECORDS must be a power of two
+#endif
+
+#define MP_RING_DATA_BIT	( 1 << 0 )	//set when a record is committed while the reader is waiting
+#define MP_RING_SPACE_BIT	( 1 << 1 )	//set when data is consumed while a writer is waiting
+
+#define RECORD_COMMITTED	( 1UL << 16 )
+#define RECORD_SLOT(Seq)	( (Seq) & (MP_RING_MAX_RECORDS - 1) )
+
+static size_t committedBytes( MpRing_t const* Ring );
+static void getSpans( MpRing_t const* Ring, uint16_t Offset, size_t Len, StreamBufferSpans_t* Spans );
+
+/**
+ * initialize a ring using Len bytes of Storage
+ * @param Ring ring to initialize
+ * @param Storage memory the ring's data is held in
+ * @param Len length of Storage - must be a power of two <= 32768
+ */
+void MpRingInit( MpRing_t* Ring, uint8_t* Storage, uint16_t Len )
+{
+	configASSERT(Ring != NULL && Storage != NULL);
+	configASSERT(Len != 0 && (Len & (Len - 1)) == 0 && Len <= 32768);
+
+	memset(Ring, 0, sizeof(*Ring));
+	Ring->Storage = Storage;
+	Ring->Len = Len;
+	Ring->Events = xEventGroupCreate();
+	configASSERT(Ring->Events != NULL);
+}
+
+/**
+ * copy Len bytes into the ring as a single record, waiting up to
+ * TicksToWait for room.  Records are never split - either all of
+ * Data is queued or none of it is
+ * @returns Len if the data was queued, otherwise 0
+ */
+size_t MpRingSend( MpRing_t* Ring, void const* Data, size_t Len, TickType_t TicksToWait )
+{
+	MpRingReservation_t reservation;
+
+	if(MpRingReserve(Ring, Len, &reservation) != pdPASS)
+	{
+		TimeOut_t timeOut;
+		BaseType_t reserved = pdFAIL;
+
+		if(Len == 0 || Len > Ring->Len || TicksToWait == 0)
+		{
+			return 0;
+		}
+
+		//let the reader know someone needs to hear about freed space
+		//(this is a full barrier, so the retry below sees everything
+		//consumed before the reader checked WritersWaiting)
+		__atomic_add_fetch(&Ring->WritersWaiting, 1, __ATOMIC_SEQ_CST);
+		vTaskSetTimeOutState(&timeOut);
+		while(1)
+		{
+			//the bit is cleared before retrying so space freed after
+			//the retry still wakes this task up
+			xEventGroupClearBits(Ring->Events, MP_RING_SPACE_BIT);
+			reserved = MpRingReserve(Ring, Len, &reservation);
+			if(reserved == pdPASS || xTaskCheckForTimeOut(&timeOut, &TicksToWait) != pdFALSE)
+			{
+				break;
+			}
+			xEventGroupWaitBits(Ring->Events, MP_RING_SPACE_BIT, pdFALSE, pdFALSE, TicksToWait);
+		}
+		__atomic_sub_fetch(&Ring->WritersWaiting, 1, __ATOMIC_SEQ_CST);
+
+		if(reserved != pdPASS)
+		{
+			return 0;
+		}
+	}
+
+	memcpy(reservation.Spans.pucFirst, Data, reservation.Spans.xFirstLength);
+	if(reservation.Spans.xSecondLength > 0)
+	{
+		memcpy(reservation.Spans.pucSecond, (uint8_t const*)Data + reservation.Spans.xFirstLength,
+				reservation.Spans.xSecondLength);
+	}
+	MpRingCommit(Ring, &reservation);
+
+	return Len;
+}
+
+/**
+ * claim the next Len bytes of the ring without blocking.  The claimed
+ * region is described by Reservation->Spans and must be passed to
+ * MpRingCommit once it has been filled in
+ * @returns pdPASS if the region was claimed, pdFAIL if there isn't room
+ */
+BaseType_t MpRingReserve( MpRing_t* Ring, size_t Len, MpRingReservation_t* Reservation )
+{
+	uint16_t tail, tailSeq, seq, start;
+	uint32_t head, newHead;
+
+	if(Len == 0 || Len > Ring->Len)
+	{
+		return pdFAIL;
+	}
+
+	//the reader publishes TailSeq before Tail, and Tail is read before
+	//Head, so Head can never appear to be behind Tail.  Both only ever
+	//move forward, so if they're stale by the time the CAS succeeds the
+	//checks below were just conservative
+	tail = __atomic_load_n(&Ring->Tail, __ATOMIC_ACQUIRE);
+	tailSeq = __atomic_load_n(&Ring->TailSeq, __ATOMIC_ACQUIRE);
+	head = __atomic_load_n(&Ring->Head, __ATOMIC_ACQUIRE);
+	do
+	{
+		seq = (uint16_t)(head >> 16);
+		start = (uint16_t)head;
+
+		if((size_t)(uint16_t)(start - tail) + Len > Ring->Len ||
+			(uint16_t)(seq - tailSeq) >= MP_RING_MAX_RECORDS)
+		{
+			return pdFAIL;
+		}
+		newHead = ((uint32_t)(uint16_t)(seq + 1) << 16) | (uint16_t)(start + Len);
+	}while(!__atomic_compare_exchange_n(&Ring->Head, &head, newHead, pdTRUE,
+										__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
+	Reservation->Seq = seq;
+	Reservation->End = (uint16_t)(start + Len);
+	getSpans(Ring, start, Len, &Reservation->Spans);
+	return pdPASS;
+}
+
+/**
+ * make a filled in region visible to the reader.  Regions may be
+ * committed in any order, the reader only sees a region once every
+ * region claimed before it has also been committed
+ */
+void MpRingCommit( MpRing_t* Ring, MpRingReservation_t const* Reservation )
+{
+	__atomic_store_n(&Ring->Records[RECORD_SLOT(Reservation->Seq)],
+					RECORD_COMMITTED | Reservation->End, __ATOMIC_RELEASE);
+
+	//pairs with the barrier in MpRingPeek - either the reader sees this
+	//record, or this task sees the reader waiting
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if(Ring->ReaderWaiting)
+	{
+		xEventGroupSetBits(Ring->Events, MP_RING_DATA_BIT);
+	}
+}
+
+/**
+ * wait up to TicksToWait for committed data.  The committed data is
+ * described by Spans (Spans->pucSecond is used if the data wraps
+ * around the end of the storage) and stays in the ring until
+ * MpRingConsume is called
+ * @returns number of committed bytes
+ */
+size_t MpRingPeek( MpRing_t* Ring, StreamBufferSpans_t* Spans, TickType_t TicksToWait )
+{
+	size_t numBytes = committedBytes(Ring);
+
+	if(numBytes == 0 && TicksToWait != 0)
+	{
+		TimeOut_t timeOut;
+
+		vTaskSetTimeOutState(&timeOut);
+		do
+		{
+			xEventGroupClearBits(Ring->Events, MP_RING_DATA_BIT);
+			Ring->ReaderWaiting = 1;
+			__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+			numBytes = committedBytes(Ring);
+			if(numBytes == 0)
+			{
+				xEventGroupWaitBits(Ring->Events, MP_RING_DATA_BIT, pdTRUE, pdFALSE, TicksToWait);
+				numBytes = committedBytes(Ring);
+			}
+			Ring->ReaderWaiting = 0;
+		}while(numBytes == 0 && xTaskCheckForTimeOut(&timeOut, &TicksToWait) == pdFALSE);
+	}
+
+	getSpans(Ring, Ring->Tail, numBytes, Spans);
+	return numBytes;
+}
+
+/**
+ * release the first Len committed bytes back to the writers
+ */
+void MpRingConsume( MpRing_t* Ring, size_t Len )
+{
+	uint16_t tail = Ring->Tail;
+	uint16_t seq = Ring->TailSeq;
+
+	configASSERT(Len <= committedBytes(Ring));
+
+	//free every record that has now been read completely - a record
+	//that has only been partly read stays until the rest of it is
+	while(1)
+	{
+		uint32_t record = __atomic_load_n(&Ring->Records[RECORD_SLOT(seq)], __ATOMIC_ACQUIRE);
+
+		if(!(record & RECORD_COMMITTED) || (uint16_t)((uint16_t)record - tail) > Len)
+		{
+			break;
+		}
+		Ring->Records[RECORD_SLOT(seq)] = 0;
+		seq++;
+	}
+	//release, so a writer that sees the new TailSeq and reuses a
+	//slot can't have its commit overwritten by the clear above
+	__atomic_store_n(&Ring->TailSeq, seq, __ATOMIC_RELEASE);
+	__atomic_store_n(&Ring->Tail, (uint16_t)(tail + Len), __ATOMIC_RELEASE);
+
+	//pairs with the increment of WritersWaiting in MpRingSend
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if(Ring->WritersWaiting)
+	{
+		xEventGroupSetBits(Ring->Events, MP_RING_SPACE_BIT);
+	}
+}
+
+/**
+ * number of bytes at the front of the ring in committed records
+ */
+static size_t committedBytes( MpRing_t const* Ring )
+{
+	uint16_t tail = Ring->Tail;
+	uint16_t seq = Ring->TailSeq;
+	uint16_t end = tail;
+
+	for(uint32_t i = 0; i < MP_RING_MAX_RECORDS; i++, seq++)
+	{
+		uint32_t record = __atomic_load_n(&Ring->Records[RECORD_SLOT(seq)], __ATOMIC_ACQUIRE);
+
+		if(!(record & RECORD_COMMITTED))
+		{
+			break;
+		}
+		end = (uint16_t)record;
+	}
+	return (uint16_t)(end - tail);
+}
+
+static void getSpans( MpRing_t const* Ring, uint16_t Offset, size_t Len, StreamBufferSpans_t* Spans )
+{
+	size_t index = Offset & (Ring->Len - 1);
+	size_t firstLen = Ring->Len - index;
+
+	if(firstLen > Len)
+	{
+		firstLen = Len;
+	}
+
+	Spans->pucFirst = &Ring->Storage[index];
+	Spans->xFirstLength = firstLen;
+	Spans->pucSecond = (Len > firstLen) ? Ring->Storage : NULL;
+	Spans->xSecondLength = Len - firstLen;
+}
@@ -0,0 +1,100 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Brian Amos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef DRIVERS_HANDSONRTOS_MULTIPRODUCERRING_H_
+#define DRIVERS_HANDSONRTOS_MULTIPRODUCERRING_H_
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include <stdint.h>
+#include <FreeRTOS.h>
+#include <stream_buffer.h>
+#include <event_groups.h>
+
+/**
+ * A byte ring with any number of writers and a single reader.
+ *
+ * Writers never take a lock: each one claims the next Len bytes of the
+ * ring with a single compare-and-swap on the ring's head, copies its data
+ * into the claimed region and then marks the region as committed.  A
+ * low priority writer that is preempted while copying therefore can't
+ * hold up a high priority writer - the high priority writer simply
+ * claims the region after it.
+ *
+ * The reader only ever sees the committed regions at the front of the
+ * ring, so data from different writers is never interleaved and a
+ * region that is still being written is never read.  Regions are
+ * read in place (see MpRingPeek), the same as a stream buffer's
+ * zero copy API.
+ *
+ * Offsets and record sequence numbers are free running 16 bit counters,
+ * so the storage length must be a power of two no larger than 32768.
+ */
+
+//maximum number of regions (claimed + committed but not yet consumed)
+//the ring can hold at once - must be a power of two
+#ifndef MP_RING_MAX_RECORDS
+#define MP_RING_MAX_RECORDS 32
+#endif
+
+typedef struct
+{
+	uint8_t* Storage;
+	uint16_t Len;
+	//(record sequence number << 16) | write offset - advanced by writers with CAS
+	volatile uint32_t Head;
+	//read offset and sequence number of the oldest record not yet consumed
+	volatile uint16_t Tail;
+	volatile uint16_t TailSeq;
+	//(1 << 16) | end offset once a record is committed, 0 while free/claimed
+	volatile uint32_t Records[MP_RING_MAX_RECORDS];
+	volatile uint32_t WritersWaiting;
+	volatile uint32_t ReaderWaiting;
+	EventGroupHandle_t Events;
+}MpRing_t;
+
+typedef struct
+{
+	uint16_t Seq;
+	uint16_t End;
+	StreamBufferSpans_t Spans;
+}MpRingReservation_t;
+
+void MpRingInit( MpRing_t* Ring, uint8_t* Storage, uint16_t Len );
+
+//writers
+size_t MpRingSend( MpRing_t* Ring, void const* Data, size_t Len, TickType_t TicksToWait );
+BaseType_t MpRingReserve( MpRing_t* Ring, size_t Len, MpRingReservation_t* Reservation );
+void MpRingCommit( MpRing_t* Ring, MpRingReservation_t const* Reservation );
+
+//reader
+size_t MpRingPeek( MpRing_t* Ring, StreamBufferSpans_t* Spans, TickType_t TicksToWait );
+void MpRingConsume( MpRing_t* Ring, size_t Len );
+
+#ifdef __cplusplus
+ }
+#endif
+#endif /* DRIVERS_HANDSONRTOS_MULTIPRODUCERRING_H_ */
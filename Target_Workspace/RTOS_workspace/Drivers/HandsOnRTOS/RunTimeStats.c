@@ -0,0 +1,602 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Brian Amos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "RunTimeStats.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <timers.h>
+
+//the host unit tests run without the SystemView recorder
+#ifndef RUN_TIME_STATS_USE_SYSVIEW
+#define RUN_TIME_STATS_USE_SYSVIEW 1
+#endif
+
+#if RUN_TIME_STATS_USE_SYSVIEW == 1
+#include <SEGGER_SYSVIEW.h>
+#endif
+
+#if RUN_TIME_STATS_USE_CLI == 1
+#include <FreeRTOS_CLI.h>
+#endif
+
+#if ( RUN_TIME_STATS_MAX_TASKS & ( RUN_TIME_STATS_MAX_TASKS - 1 ) ) != 0
+	#error RUN_TIME_STATS_MAX_TASKS must be a power of two
+#endif
+
+#if defined(__ARM_ARCH_7EM__) || defined(__ARM_ARCH_7M__)
+	//DWT cycle counter, enabled through the debug monitor control register
+	//(the M7 also needs the DWT unlocked before it can be written)
+	#define DEMCR			(*(volatile uint32_t*)0xE000EDFCu)
+	#define DEMCR_TRCENA	(1u << 24)
+	#define DWT_CTRL		(*(volatile uint32_t*)0xE0001000u)
+	#define DWT_CTRL_CYCCNTENA	(1u << 0)
+	#define DWT_CYCCNT		(*(volatile uint32_t*)0xE0001004u)
+	#define DWT_LAR			(*(volatile uint32_t*)0xE0001FB0u)
+	#define DWT_LAR_KEY		(0xC5ACCE55u)
+	#define COUNTER_FREQUENCY ((uint32_t)configCPU_CLOCK_HZ)
+#else
+	#include <time.h>
+	#define COUNTER_FREQUENCY (1000000000u)
+#endif
+
+#define NO_SLOT ( 0xFFFF )
+
+typedef enum
+{
+	TASK_EMPTY = 0,		//slot not in use
+	TASK_READY,			//ReadySince is when it was readied
+	TASK_RUNNING,		//SwitchedIn is when it started running
+	TASK_OUT			//switched out at SwitchedOut - preempted, or blocked
+						//if it's readied again before it runs
+}TaskState_t;
+
+typedef struct
+{
+	RunTimeStatsTask_t Stats;
+	TaskState_t State;
+	uint64_t SwitchedIn;
+	uint64_t SwitchedOut;
+	uint64_t ReadySince;
+	uint64_t ReportedCpu;		//at the last SystemView record
+	uint32_t ReportedSwitches;
+}TaskEntry_t;
+
+//open addressed on the task handle, with linear probing.  Deleted tasks
+//are removed by shifting the rest of their probe sequence back
+static TaskEntry_t tasks[RUN_TIME_STATS_MAX_TASKS];
+static uint16_t outgoing = NO_SLOT;	//between the switched out and in hooks
+static uint32_t untrackedTasks = 0;
+static uint64_t resetTime;
+static uint64_t lastReport;
+static bool started = false;
+
+static uint64_t now( void );
+static uint32_t hashPointer( void const* Ptr );
+static uint16_t findTask( void const* Task );
+static uint16_t addTask( void* Task );
+static void removeTask( uint16_t Slot );
+static void copyStats( uint16_t Slot, uint64_t Now, RunTimeStatsTask_t* Stats );
+static void reportTimer( TimerHandle_t Timer );
+
+#if RUN_TIME_STATS_USE_SYSVIEW == 1
+static SEGGER_SYSVIEW_MODULE sysViewModule =
+{
+	"M=RunTimeStats, 0 TaskStats Task=%t CpuPermille=%u Switches=%u MaxLatencyUs=%u MaxBlockedUs=%u",
+	1,		//NumEvents
+	0,		//EventOffset, set by RegisterModule
+	NULL,	//pfSendModuleDesc
+	NULL	//pNext
+};
+#endif
+
+void RunTimeStatsInit( TickType_t ReportPeriod )
+{
+#if defined(DWT_CYCCNT)
+	DEMCR |= DEMCR_TRCENA;
+	DWT_LAR = DWT_LAR_KEY;
+	DWT_CTRL |= DWT_CTRL_CYCCNTENA;
+#endif
+#if RUN_TIME_STATS_USE_SYSVIEW == 1
+	SEGGER_SYSVIEW_RegisterModule(&sysViewModule);
+#endif
+
+	taskENTER_CRITICAL();
+	started = true;
+	resetTime = now();
+	lastReport = resetTime;
+	taskEXIT_CRITICAL();
+
+	if(ReportPeriod != 0)
+	{
+		TimerHandle_t timer = xTimerCreate("RunTimeStats", ReportPeriod, pdTRUE, NULL, reportTimer);
+
+		configASSERT(timer != NULL);
+		configASSERT(xTimerStart(timer, 0) == pdPASS);
+	}
+}
+
+/**
+ * traceTASK_SWITCHED_OUT - the running task is being switched out
+ * (it may be selected again)
+ */
+void RunTimeStatsSwitchedOut( void* Task )
+{
+	uint16_t slot;
+	TaskEntry_t* entry;
+	uint64_t time;
+
+	if(!started)
+	{
+		return;
+	}
+	outgoing = NO_SLOT;
+	slot = findTask(Task);
+	if(slot == NO_SLOT || tasks[slot].State != TASK_RUNNING)
+	{
+		return;
+	}
+	time = now();
+	entry = &tasks[slot];
+	entry->Stats.CpuTime += time - entry->SwitchedIn;
+	entry->SwitchedOut = time;
+	entry->State = TASK_OUT;
+	outgoing = slot;
+}
+
+/**
+ * traceTASK_SWITCHED_IN - Task has been selected to run
+ */
+void RunTimeStatsSwitchedIn( void* Task )
+{
+	uint16_t slot;
+	TaskEntry_t* entry;
+	uint64_t time;
+	uint64_t latency;
+
+	if(!started)
+	{
+		return;
+	}
+	slot = findTask(Task);
+	if(slot == NO_SLOT && (slot = addTask(Task)) == NO_SLOT)
+	{
+		return;
+	}
+	time = now();
+	entry = &tasks[slot];
+
+	//switched out and straight back in again isn't a switch
+	if(slot != outgoing || entry->State != TASK_OUT)
+	{
+		if(entry->State == TASK_READY)
+		{
+			latency = time - entry->ReadySince;
+		}
+		else if(entry->State == TASK_OUT)
+		{
+			//preempted, it's been ready since it was switched out
+			latency = time - entry->SwitchedOut;
+		}
+		else
+		{
+			//first seen running (started before RunTimeStatsInit)
+			latency = 0;
+		}
+		entry->Stats.Switches++;
+		entry->Stats.LatencyTotal += latency;
+		if(latency > entry->Stats.LatencyMax)
+		{
+			entry->Stats.LatencyMax = latency;
+		}
+	}
+	entry->State = TASK_RUNNING;
+	entry->SwitchedIn = time;
+	outgoing = NO_SLOT;
+}
+
+/**
+ * traceMOVED_TASK_TO_READY_STATE - Task has been created, unblocked
+ * or resumed.  (traceREADDED_TASK_TO_READY_STATE, for ready tasks
+ * moved between priorities, must not come here)
+ */
+void RunTimeStatsReady( void* Task )
+{
+	uint16_t slot;
+	TaskEntry_t* entry;
+	uint64_t time;
+	uint64_t blocked;
+
+	if(!started)
+	{
+		return;
+	}
+	slot = findTask(Task);
+	if(slot == NO_SLOT && (slot = addTask(Task)) == NO_SLOT)
+	{
+		return;
+	}
+	entry = &tasks[slot];
+	time = now();
+
+	//the running task is re-added when it disinherits a priority
+	if(entry->State == TASK_RUNNING)
+	{
+		return;
+	}
+	if(entry->State == TASK_OUT)
+	{
+		blocked = time - entry->SwitchedOut;
+		if(blocked > entry->Stats.BlockedMax)
+		{
+			entry->Stats.BlockedMax = blocked;
+		}
+		entry->ReadySince = time;
+	}
+	else if(entry->State == TASK_EMPTY)
+	{
+		entry->ReadySince = time;
+	}
+	entry->State = TASK_READY;
+}
+
+/**
+ * traceTASK_DELETE
+ */
+void RunTimeStatsTaskDeleted( void* Task )
+{
+	uint16_t slot;
+
+	if(!started)
+	{
+		return;
+	}
+	slot = findTask(Task);
+	if(slot != NO_SLOT)
+	{
+		removeTask(slot);
+	}
+}
+
+void RunTimeStatsReset( void )
+{
+	uint64_t time;
+
+	taskENTER_CRITICAL();
+	time = now();
+	for(uint16_t i = 0; i < RUN_TIME_STATS_MAX_TASKS; i++)
+	{
+		TaskEntry_t* entry = &tasks[i];
+
+		entry->Stats.CpuTime = 0;
+		entry->Stats.Switches = 0;
+		entry->Stats.LatencyTotal = 0;
+		entry->Stats.LatencyMax = 0;
+		entry->Stats.BlockedMax = 0;
+		entry->ReportedCpu = 0;
+		entry->ReportedSwitches = 0;
+		if(entry->State == TASK_RUNNING)
+		{
+			entry->SwitchedIn = time;
+		}
+	}
+	untrackedTasks = 0;
+	resetTime = time;
+	lastReport = time;
+	taskEXIT_CRITICAL();
+}
+
+uint64_t RunTimeStatsNow( void )
+{
+	uint64_t time;
+
+	taskENTER_CRITICAL();
+	time = now();
+	taskEXIT_CRITICAL();
+	return time;
+}
+
+uint64_t RunTimeStatsToUs( uint64_t Counts )
+{
+	return Counts / (COUNTER_FREQUENCY / 1000000u);
+}
+
+void RunTimeStatsGetSummary( RunTimeStatsSummary_t* Summary )
+{
+	taskENTER_CRITICAL();
+	Summary->Frequency = COUNTER_FREQUENCY;
+	Summary->Elapsed = now() - resetTime;
+	Summary->NumTasks = 0;
+	for(uint16_t i = 0; i < RUN_TIME_STATS_MAX_TASKS; i++)
+	{
+		if(tasks[i].State != TASK_EMPTY)
+		{
+			Summary->NumTasks++;
+		}
+	}
+	Summary->UntrackedTasks = untrackedTasks;
+	taskEXIT_CRITICAL();
+}
+
+UBaseType_t RunTimeStatsGetTasks( RunTimeStatsTask_t* Tasks, UBaseType_t MaxTasks )
+{
+	UBaseType_t numTasks = 0;
+
+	//a task at a time, to keep the critical sections short
+	for(uint16_t i = 0; i < RUN_TIME_STATS_MAX_TASKS && numTasks < MaxTasks; i++)
+	{
+		taskENTER_CRITICAL();
+		if(tasks[i].State != TASK_EMPTY)
+		{
+			copyStats(i, now(), &Tasks[numTasks++]);
+		}
+		taskEXIT_CRITICAL();
+	}
+	return numTasks;
+}
+
+BaseType_t RunTimeStatsGetTask( TaskHandle_t Task, RunTimeStatsTask_t* Stats )
+{
+	uint16_t slot;
+
+	taskENTER_CRITICAL();
+	slot = findTask(Task);
+	if(slot != NO_SLOT)
+	{
+		copyStats(slot, now(), Stats);
+	}
+	taskEXIT_CRITICAL();
+	return (slot != NO_SLOT) ? pdTRUE : pdFALSE;
+}
+
+void RunTimeStatsSendSysView( void )
+{
+	uint64_t period;
+	uint64_t time;
+
+	taskENTER_CRITICAL();
+	time = now();
+	period = time - lastReport;
+	lastReport = time;
+	taskEXIT_CRITICAL();
+
+	for(uint16_t i = 0; i < RUN_TIME_STATS_MAX_TASKS; i++)
+	{
+		RunTimeStatsTask_t stats;
+		uint64_t cpu;
+		uint32_t switches;
+
+		taskENTER_CRITICAL();
+		if(tasks[i].State == TASK_EMPTY)
+		{
+			taskEXIT_CRITICAL();
+			continue;
+		}
+		copyStats(i, time, &stats);
+		cpu = stats.CpuTime - tasks[i].ReportedCpu;
+		switches = stats.Switches - tasks[i].ReportedSwitches;
+		tasks[i].ReportedCpu = stats.CpuTime;
+		tasks[i].ReportedSwitches = stats.Switches;
+		taskEXIT_CRITICAL();
+
+#if RUN_TIME_STATS_USE_SYSVIEW == 1
+		SEGGER_SYSVIEW_RecordU32x5(sysViewModule.EventOffset,
+				SEGGER_SYSVIEW_ShrinkId((U32)(uintptr_t)stats.Task),
+				(U32)((period != 0) ? (cpu * 1000u) / period : 0), switches,
+				(U32)RunTimeStatsToUs(stats.LatencyMax), (U32)RunTimeStatsToUs(stats.BlockedMax));
+#else
+		(void)cpu;
+		(void)switches;
+		(void)period;
+#endif
+	}
+}
+
+#if RUN_TIME_STATS_USE_CLI == 1
+/**
+ * FreeRTOS+CLI calls this until it returns pdFALSE, for the header
+ * and then a line per task.  The tasks are copied out on the first call
+ */
+static BaseType_t taskStatsCommand( char* WriteBuffer, size_t WriteBufferLen, const char* CommandString )
+{
+	static RunTimeStatsTask_t snapshot[RUN_TIME_STATS_MAX_TASKS];
+	static RunTimeStatsSummary_t summary;
+	static UBaseType_t numTasks;
+	static UBaseType_t next = 0;
+	RunTimeStatsTask_t const* task;
+	uint64_t permille;
+
+	(void)CommandString;
+	if(next == 0 || next > numTasks)
+	{
+		RunTimeStatsGetSummary(&summary);
+		numTasks = RunTimeStatsGetTasks(snapshot, RUN_TIME_STATS_MAX_TASKS);
+		snprintf(WriteBuffer, WriteBufferLen,
+				"Task             CPU(us)  CPU%%   Switches LatAvg(us) LatMax(us) BlockMax(us)\r\n");
+		next = 1;
+		return (numTasks > 0) ? pdTRUE : pdFALSE;
+	}
+
+	task = &snapshot[next - 1];
+	permille = (summary.Elapsed != 0) ? (task->CpuTime * 1000u) / summary.Elapsed : 0;
+	snprintf(WriteBuffer, WriteBufferLen, "%-*s %10lu %3lu.%lu %10lu %10lu %10lu %12lu\r\n",
+			configMAX_TASK_NAME_LEN - 1, task->Name,
+			(unsigned long)RunTimeStatsToUs(task->CpuTime),
+			(unsigned long)(permille / 10), (unsigned long)(permille % 10),
+			(unsigned long)task->Switches,
+			(unsigned long)((task->Switches != 0) ? RunTimeStatsToUs(task->LatencyTotal / task->Switches) : 0),
+			(unsigned long)RunTimeStatsToUs(task->LatencyMax),
+			(unsigned long)RunTimeStatsToUs(task->BlockedMax));
+
+	if(next++ < numTasks)
+	{
+		return pdTRUE;
+	}
+	next = 0;
+	return pdFALSE;
+}
+
+static const CLI_Command_Definition_t taskStatsDefinition =
+{
+	"task-stats",
+	"\r\ntask-stats:\r\n CPU time, switches, scheduling latency and longest block of each task\r\n",
+	taskStatsCommand,
+	0
+};
+
+void RunTimeStatsRegisterCommand( void )
+{
+	FreeRTOS_CLIRegisterCommand(&taskStatsDefinition);
+}
+#endif
+
+static void reportTimer( TimerHandle_t Timer )
+{
+	(void)Timer;
+	RunTimeStatsSendSysView();
+}
+
+/**
+ * the counter - called with interrupts masked (from the hooks or a
+ * critical section)
+ */
+static uint64_t now( void )
+{
+#if defined(DWT_CYCCNT)
+	static uint32_t lastCycles = 0;
+	static uint64_t extended = 0;
+	uint32_t cycles = DWT_CYCCNT;
+
+	//correct as long as it's read at least once per wrap
+	extended += (uint32_t)(cycles - lastCycles);
+	lastCycles = cycles;
+	return extended;
+#else
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (uint64_t)t.tv_sec * 1000000000u + (uint64_t)t.tv_nsec;
+#endif
+}
+
+static uint32_t hashPointer( void const* Ptr )
+{
+	uint32_t h = (uint32_t)(uintptr_t)Ptr;
+
+	//TCBs are aligned, mix the upper bits down
+	h ^= h >> 16;
+	h *= 0x45D9F3Bu;
+	h ^= h >> 16;
+	return h;
+}
+
+static uint16_t findTask( void const* Task )
+{
+	uint32_t slot = hashPointer(Task);
+
+	for(uint32_t probe = 0; probe < RUN_TIME_STATS_MAX_TASKS; probe++, slot++)
+	{
+		TaskEntry_t const* entry = &tasks[slot & (RUN_TIME_STATS_MAX_TASKS - 1)];
+
+		if(entry->State == TASK_EMPTY)
+		{
+			break;
+		}
+		if(entry->Stats.Task == Task)
+		{
+			return (uint16_t)(slot & (RUN_TIME_STATS_MAX_TASKS - 1));
+		}
+	}
+	return NO_SLOT;
+}
+
+/**
+ * @returns the new task's slot (left TASK_EMPTY for the caller to set),
+ * 			NO_SLOT when the table is full
+ */
+static uint16_t addTask( void* Task )
+{
+	uint32_t slot = hashPointer(Task);
+
+	for(uint32_t probe = 0; probe < RUN_TIME_STATS_MAX_TASKS; probe++, slot++)
+	{
+		TaskEntry_t* entry = &tasks[slot & (RUN_TIME_STATS_MAX_TASKS - 1)];
+
+		if(entry->State == TASK_EMPTY)
+		{
+			memset(entry, 0, sizeof(TaskEntry_t));
+			entry->Stats.Task = (TaskHandle_t)Task;
+			strncpy(entry->Stats.Name, pcTaskGetName((TaskHandle_t)Task), configMAX_TASK_NAME_LEN - 1);
+			return (uint16_t)(slot & (RUN_TIME_STATS_MAX_TASKS - 1));
+		}
+	}
+	untrackedTasks++;
+	return NO_SLOT;
+}
+
+/**
+ * empty Slot and move back any entries after it that wouldn't be
+ * found past the gap (see HeapProfiler.c)
+ */
+static void removeTask( uint16_t Slot )
+{
+	uint16_t gap = Slot;
+
+	if(outgoing == Slot)
+	{
+		outgoing = NO_SLOT;
+	}
+	tasks[gap].State = TASK_EMPTY;
+	for(uint16_t i = (gap + 1) & (RUN_TIME_STATS_MAX_TASKS - 1); tasks[i].State != TASK_EMPTY;
+		i = (i + 1) & (RUN_TIME_STATS_MAX_TASKS - 1))
+	{
+		uint16_t home = hashPointer(tasks[i].Stats.Task) & (RUN_TIME_STATS_MAX_TASKS - 1);
+
+		//move i into the gap unless its home lies cyclically in (gap, i]
+		if(((i - home) & (RUN_TIME_STATS_MAX_TASKS - 1)) >= ((i - gap) & (RUN_TIME_STATS_MAX_TASKS - 1)))
+		{
+			tasks[gap] = tasks[i];
+			tasks[i].State = TASK_EMPTY;
+			if(outgoing == i)
+			{
+				outgoing = gap;
+			}
+			gap = i;
+		}
+	}
+}
+
+/**
+ * Stats for the task in Slot, with the running task's
+ * CPU time counted up to Now
+ */
+static void copyStats( uint16_t Slot, uint64_t Now, RunTimeStatsTask_t* Stats )
+{
+	*Stats = tasks[Slot].Stats;
+	if(tasks[Slot].State == TASK_RUNNING)
+	{
+		Stats->CpuTime += Now - tasks[Slot].SwitchedIn;
+	}
+}
@@ -0,0 +1,158 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Brian Amos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef DRIVERS_HANDSONRTOS_RUNTIMESTATS_H_
+#define DRIVERS_HANDSONRTOS_RUNTIMESTATS_H_
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include <stdint.h>
+#include <FreeRTOS.h>
+#include <task.h>
+
+/**
+ * Per task run time statistics, kept from the kernel's trace hooks
+ * (instead of configGENERATE_RUN_TIME_STATS, whose 32 bit counters
+ * wrap within seconds at full clock rate).  For every task:
+ *	- CPU time - the time spent running
+ *	- switches - the number of times it was switched in
+ *	- scheduling latency - the time from becoming ready (being
+ *	  unblocked, resumed or created, or preempted) to running,
+ *	  total and longest
+ *	- the longest time it was blocked (or suspended) for
+ *
+ * Times are in counts of a free running counter:
+ *	- Cortex-M: the DWT cycle counter (CYCCNT), at configCPU_CLOCK_HZ,
+ *	  extended to 64 bits by the hooks and the report timer
+ *	- Posix port: clock_gettime(CLOCK_MONOTONIC), in ns.  Only one task's
+ *	  thread runs at a time, so wall time while switched in is CPU time
+ * RunTimeStatsToUs converts them.
+ *
+ * Setting SYSVIEW_FREERTOS_RUN_TIME_STATS to 1 in FreeRTOSConfig.h
+ * points traceTASK_SWITCHED_OUT/IN, traceMOVED_TASK_TO_READY_STATE and
+ * traceTASK_DELETE at the hooks below (on the host, HOST_RUN_TIME_STATS
+ * does the same).  The results are available from:
+ *	- RunTimeStatsGetTasks/RunTimeStatsGetTask
+ *	- the "task-stats" FreeRTOS+CLI command (RUN_TIME_STATS_USE_CLI)
+ *	- a SystemView record per task, every report period
+ *
+ * A switch costs two counter reads, a hash of each task handle and a
+ * few 64 bit adds - tens of cycles, against the hundreds a switch takes
+ * already.  At a thousand switches a second that is well under 0.1% of a
+ * 216MHz M7 (benchContextSwitch_runTimeStats measures it on the host).
+ */
+
+//tasks tracked - must be a power of two, later tasks are counted, but not tracked
+#ifndef RUN_TIME_STATS_MAX_TASKS
+#define RUN_TIME_STATS_MAX_TASKS 16
+#endif
+
+//FreeRTOS+CLI isn't part of the chapter projects, so the command is optional
+#ifndef RUN_TIME_STATS_USE_CLI
+#define RUN_TIME_STATS_USE_CLI 0
+#endif
+
+typedef struct
+{
+	TaskHandle_t Task;
+	char Name[configMAX_TASK_NAME_LEN];
+	uint64_t CpuTime;			//counts spent running
+	uint32_t Switches;			//times switched in
+	uint64_t LatencyTotal;		//counts from ready to running, over all switches
+	uint64_t LatencyMax;
+	uint64_t BlockedMax;		//longest time from switched out to ready again
+}RunTimeStatsTask_t;
+
+typedef struct
+{
+	uint32_t Frequency;			//counts per second
+	uint64_t Elapsed;			//counts since RunTimeStatsInit/RunTimeStatsReset
+	UBaseType_t NumTasks;
+	uint32_t UntrackedTasks;	//tasks seen while the table was full
+}RunTimeStatsSummary_t;
+
+/**
+ * the kernel hooks - Task is the TCB
+ */
+void RunTimeStatsSwitchedOut( void* Task );
+void RunTimeStatsSwitchedIn( void* Task );
+void RunTimeStatsReady( void* Task );
+void RunTimeStatsTaskDeleted( void* Task );
+
+/**
+ * start the counter and, when ReportPeriod isn't 0, a timer that sends
+ * the SystemView records every ReportPeriod ticks.  On Cortex-M the
+ * timer also keeps the 64 bit counter extended - without it something
+ * has to be switched at least every 2^32 cycles (19.8s at 216MHz)
+ *
+ * Call before the scheduler is started, after SEGGER_SYSVIEW_Conf
+ */
+void RunTimeStatsInit( TickType_t ReportPeriod );
+
+/**
+ * zero the statistics of every task (the tasks stay tracked)
+ */
+void RunTimeStatsReset( void );
+
+/**
+ * @returns the counter, extended to 64 bits
+ */
+uint64_t RunTimeStatsNow( void );
+
+uint64_t RunTimeStatsToUs( uint64_t Counts );
+
+void RunTimeStatsGetSummary( RunTimeStatsSummary_t* Summary );
+
+/**
+ * copy out up to MaxTasks tasks, in no particular order.  The running
+ * task's CPU time is brought up to date first
+ * @returns the number of tasks copied
+ */
+UBaseType_t RunTimeStatsGetTasks( RunTimeStatsTask_t* Tasks, UBaseType_t MaxTasks );
+
+/**
+ * @returns pdFALSE if Task isn't tracked
+ */
+BaseType_t RunTimeStatsGetTask( TaskHandle_t Task, RunTimeStatsTask_t* Stats );
+
+/**
+ * send a SystemView record for every task (the report timer calls this):
+ *	TaskStats Task CpuPermille Switches MaxLatencyUs MaxBlockedUs
+ * with the CPU load and switches since the last record
+ */
+void RunTimeStatsSendSysView( void );
+
+#if RUN_TIME_STATS_USE_CLI == 1
+/**
+ * register the "task-stats" command with FreeRTOS+CLI
+ */
+void RunTimeStatsRegisterCommand( void );
+#endif
+
+#ifdef __cplusplus
+ }
+#endif
+#endif /* DRIVERS_HANDSONRTOS_RUNTIMESTATS_H_ */
@@ -0,0 +1,190 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Brian Amos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef DRIVERS_HANDSONRTOS_STATICARENA_H_
+#define DRIVERS_HANDSONRTOS_STATICARENA_H_
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#include <queue.h>
+#include <stream_buffer.h>
+#include <message_buffer.h>
+#include "BufferPool.h"
+
+#if configSUPPORT_STATIC_ALLOCATION != 1
+	#error StaticArena.h requires configSUPPORT_STATIC_ALLOCATION
+#endif
+
+/**
+ * A single statically allocated region holding the memory for a fixed
+ * set of tasks, queues, stream/message buffers and per-task buffer
+ * pools, so they can be created at startup without touching the
+ * FreeRTOS heap.
+ *
+ * The objects are listed once, in a macro taking one "kind" macro per
+ * type of object:
+ *
+ *		#define APP_ARENA(TASK, QUEUE, STREAM_BUFFER, POOL)		\
+ *			TASK(Green, STACK_SIZE)							\
+ *			TASK(Blue, STACK_SIZE)							\
+ *			QUEUE(LedCmds, 8, sizeof(LedStates_t))			\
+ *			STREAM_BUFFER(Log, 512)							\
+ *			POOL(BlueMsgs, Msg_t, 4)
+ *
+ *		ARENA_STATIC(appArena, APP_ARENA);
+ *		ARENA_ASSERT_FITS(appArena, 8 * 1024);
+ *		...
+ *		ARENA_TASK_CREATE(appArena, Green, GreenTask, "GreenTask", NULL, tskIDLE_PRIORITY + 2);
+ *		QueueHandle_t ledCmds = ARENA_QUEUE_CREATE(appArena, LedCmds);
+ *
+ * ARENA_STATIC expands the list into one struct with a member per
+ * object, so every offset into the arena is worked out by the
+ * compiler (ARENA_OFFSET) and the footprint is a compile time
+ * constant (ARENA_FOOTPRINT) that ARENA_ASSERT_FITS holds to a budget.
+ * Nothing is carved up at run time - the create macros only pass
+ * pointers into the arena to the xxxCreateStatic functions, which
+ * can't fail.
+ *
+ * Every arena is placed in the .bss.rtos_arena section.  The chapter
+ * linker scripts collect that section at the start of .bss, between
+ * _srtos_arena and _ertos_arena, so the arenas form one contiguous
+ * region (cleared by the startup code with the rest of .bss) whose
+ * exact size is in the map file and in _rtos_arena_size.  Linker
+ * scripts that don't name the section still pick it up with *(.bss*).
+ */
+
+#ifndef ARENA_ALIGNMENT
+	#define ARENA_ALIGNMENT 8
+#endif
+
+#if defined(__GNUC__)
+	#define ARENA_PLACEMENT __attribute__((section(".bss.rtos_arena"), aligned(ARENA_ALIGNMENT)))
+#else
+	#define ARENA_PLACEMENT
+#endif
+
+/**
+ * members for each kind of object.  Task stacks come before their TCB,
+ * so a stack that grows down overflows away from it (the same order
+ * xTaskCreate allocates them in)
+ */
+#define ARENA_TASK_MEMBER(Object, StackDepth)			\
+	struct												\
+	{													\
+		StackType_t Stack[StackDepth];					\
+		StaticTask_t Tcb;								\
+	}Object;
+
+#define ARENA_QUEUE_MEMBER(Object, Length, ItemSize)	\
+	struct												\
+	{													\
+		uint8_t Storage[Length][ItemSize];				\
+		StaticQueue_t Queue;							\
+	}Object;
+
+//stream and message buffers need one byte more than they can hold
+//(the static create functions are passed the full storage size,
+//they don't add the extra byte themselves)
+#define ARENA_STREAM_BUFFER_MEMBER(Object, Size)		\
+	struct												\
+	{													\
+		uint8_t Storage[(Size) + 1];					\
+		StaticStreamBuffer_t Buffer;					\
+	}Object;
+
+#define ARENA_POOL_MEMBER(Object, BlockType, Count)		\
+	struct												\
+	{													\
+		BlockType Blocks[Count];						\
+		uint16_t Links[Count];							\
+		BufPool_t Pool;									\
+	}Object;
+
+/**
+ * define the arena Name (of type Name##Arena_t) for the objects listed
+ * by the Objects macro
+ */
+#define ARENA_STATIC(Name, Objects)						\
+	typedef struct										\
+	{													\
+		Objects(ARENA_TASK_MEMBER, ARENA_QUEUE_MEMBER,	\
+				ARENA_STREAM_BUFFER_MEMBER, ARENA_POOL_MEMBER)	\
+	}Name##Arena_t;										\
+	static Name##Arena_t Name ARENA_PLACEMENT
+
+/**
+ * compile time layout of an arena
+ */
+#define ARENA_FOOTPRINT(Name)			sizeof(Name##Arena_t)
+#define ARENA_OFFSET(Name, Object)		offsetof(Name##Arena_t, Object)
+#define ARENA_OBJECT_SIZE(Name, Object)	sizeof(((Name##Arena_t*)0)->Object)
+
+/**
+ * fail the build if the arena needs more than MaxBytes
+ */
+#define ARENA_ASSERT_FITS(Name, MaxBytes)				\
+	typedef char Name##FitsBudget[(ARENA_FOOTPRINT(Name) <= (MaxBytes)) ? 1 : -1]
+
+/**
+ * create the objects - these evaluate to the same handles
+ * the xxxCreateStatic functions return
+ */
+#define ARENA_TASK_CREATE(Name, Object, Code, TaskName, Parameters, Priority)	\
+	xTaskCreateStatic(Code, TaskName,											\
+					(uint32_t)(sizeof(Name.Object.Stack) / sizeof(Name.Object.Stack[0])),	\
+					Parameters, Priority, Name.Object.Stack, &Name.Object.Tcb)
+
+#define ARENA_QUEUE_CREATE(Name, Object)										\
+	xQueueCreateStatic((UBaseType_t)(sizeof(Name.Object.Storage) / sizeof(Name.Object.Storage[0])),	\
+					(UBaseType_t)sizeof(Name.Object.Storage[0]),				\
+					&Name.Object.Storage[0][0], &Name.Object.Queue)
+
+#define ARENA_STREAM_BUFFER_CREATE(Name, Object, TriggerLevel)					\
+	xStreamBufferCreateStatic(sizeof(Name.Object.Storage), TriggerLevel,		\
+					Name.Object.Storage, &Name.Object.Buffer)
+
+#define ARENA_MESSAGE_BUFFER_CREATE(Name, Object)								\
+	xMessageBufferCreateStatic(sizeof(Name.Object.Storage),					\
+					Name.Object.Storage, &Name.Object.Buffer)
+
+/**
+ * initialize a pool of blocks for a task to pass by reference
+ * (see BufferPool.h), evaluates to the BufPool_t*
+ */
+#define ARENA_POOL_INIT(Name, Object)											\
+	(BufPoolInit(&Name.Object.Pool, Name.Object.Blocks, sizeof(Name.Object.Blocks[0]),	\
+				Name.Object.Links,												\
+				(uint16_t)(sizeof(Name.Object.Blocks) / sizeof(Name.Object.Blocks[0]))),	\
+	 &Name.Object.Pool)
+
+#ifdef __cplusplus
+ }
+#endif
+#endif /* DRIVERS_HANDSONRTOS_STATICARENA_H_ */
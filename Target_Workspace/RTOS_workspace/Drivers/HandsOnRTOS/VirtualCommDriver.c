@@ -26,6 +26,8 @@
 #include "VirtualCommDriver.h"
 #include <usb_device.h>
 #include "usbd_cdc.h"
+#include "usbd_cdc_if.h"
+#include "VirtualCommTx.h"
 #include <FreeRTOS.h>
 #include <stream_buffer.h>
 #include <task.h>
@@ -42,7 +44,7 @@
  */
 #define txBuffLen 2048
 #define rxBuffLen 2048
-static uint8_t usbTxBuff[txBuffLen];
+#define txMaxTransfer (txBuffLen / 4)
 static StreamBufferHandle_t txStream = NULL;
 static TaskHandle_t usbTaskHandle = NULL;
 
@@ -53,7 +55,6 @@ StreamBufferHandle_t vcom_rxStream = NULL;
 extern USBD_HandleTypeDef hUsbDeviceFS;
 
 void usbTask( void* NotUsed);
-void usbTxComplete( void );
 
 /********************************** PUBLIC *************************************/
 
@@ -65,7 +66,10 @@ void usbTxComplete( void );
 void VirtualCommInit( void )
 {
 	MX_USB_DEVICE_Init();
-	txStream = xStreamBufferCreate( txBuffLen, 1);
+	//a stream buffer's storage is one byte longer than its capacity -
+	//keeping the storage a whole number of USB packets long means data
+	//doesn't wrap part way through a packet (see VirtualCommTx.c)
+	txStream = xStreamBufferCreate( txBuffLen - 1, 1);
 	vcom_rxStream  = xStreamBufferCreate( rxBuffLen, 1);
 	assert_param( txStream != NULL);
 	assert_param( vcom_rxStream != NULL);
@@ -79,12 +83,30 @@ void VirtualCommInit( void )
  *
  * NOTE:	This return value will not be valid until VirtualCommInit has
  * 			been run
+ * NOTE:	With VCOM_RX_FLOW_CONTROL enabled (usbd_cdc_if.c), reception stops
+ * 			while the stream buffer is full - call CDC_RxResume_FS after
+ * 			reading from it directly (or use ReceiveUsbData, which does this),
+ * 			otherwise the host is NAK'd forever
  */
 StreamBufferHandle_t const* GetUsbRxStreamBuff( void )
 {
 	return &vcom_rxStream;
 }
 
+/**
+ * Receive up to Len bytes into Buff, waiting up to DelayMs for data to
+ * arrive.  Reception is resumed if it was paused because the receive
+ * stream buffer was full
+ * @returns number of bytes received
+ */
+int32_t ReceiveUsbData(uint8_t* Buff, uint16_t Len, int32_t DelayMs)
+{
+	int32_t numBytesReceived = xStreamBufferReceive(vcom_rxStream, Buff, Len, DelayMs / portTICK_PERIOD_MS);
+
+	CDC_RxResume_FS();
+	return numBytesReceived;
+}
+
 /**
  * Transmit data to to USB is space is available in the stream.  If no space is available
  * then the function will return immediately.
@@ -122,66 +144,26 @@ int32_t TransmitUsbData(uint8_t const* Buff, uint16_t Len)
 
 /********************************** PRIVATE *************************************/
 
+static uint32_t txPeek( StreamBufferSpans_t* TxSpans, TickType_t TicksToWait )
+{
+	return xStreamBufferPeek(txStream, TxSpans, txBuffLen, TicksToWait);
+}
+
+static void txConsume( uint32_t NumBytes )
+{
+	xStreamBufferConsume(txStream, NumBytes);
+}
+
 /**
  * FreeRTOS task that takes data out of the txStream and pushes
  * data to be transmitted into the USB HAL buffer.
  *
- * This function waits for a task notification, which is sent by a callback generated
- * from the USB stack upon completion of a transmission
- *
- * It then then copies up to 2KB of data from the stream buffer to a
- * local buffer, which is passed to the HAL USB stack.
- *
+ * The data waiting in the stream buffer is passed directly to the
+ * HAL USB stack, without copying it to an intermediate buffer.  The next
+ * chunk is staged while the current one is being sent and submitted from
+ * the USB ISR as soon as the current one completes (see VirtualCommTx.h)
  */
 void usbTask( void* NotUsed)
 {
-	USBD_CDC_HandleTypeDef *hcdc = NULL;
-
-	while(hcdc == NULL)
-	{
-		hcdc = (USBD_CDC_HandleTypeDef*)hUsbDeviceFS.pClassData;
-		vTaskDelay(10);
-	}
-	if (hcdc->TxState == 0)
-	{
-		//if there is no TX in progress, immediately send a task notification
-		//to kick things off
-		xTaskNotify( usbTaskHandle, 1, eSetValueWithOverwrite);
-	}
-	ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
-
-	//setup our own callback to be called when transmission is complete
-	hcdc->TxCallBack = usbTxComplete;
-
-	//ensure the USB interrupt priority is low enough to allow for
-	//FreeRTOS API calls within the ISR
-	NVIC_SetPriority(OTG_FS_IRQn, 6);
-
-	while(1)
-	{
-		SEGGER_SYSVIEW_PrintfHost("waiting for txStream");
-		//wait forever for data to become available in the stream buffer
-		//txStream.  up to txBuffLen bytes of data will be copied into
-		//usbTxBuff when at least 1 byte is available
-		uint8_t numBytes = xStreamBufferReceive(	txStream,
-													usbTxBuff,
-													txBuffLen,
-													portMAX_DELAY);
-		if(numBytes > 0)
-		{
-			SEGGER_SYSVIEW_PrintfHost("pulled %d bytes from txStream", numBytes);
-			USBD_CDC_SetTxBuffer(&hUsbDeviceFS, usbTxBuff, numBytes);
-			USBD_CDC_TransmitPacket(&hUsbDeviceFS);
-			//wait forever for a notification, clearing it to 0 when received
-			ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
-			SEGGER_SYSVIEW_PrintfHost("tx complete");
-		}
-	}
-}
-
-void usbTxComplete( void )
-{
-	portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
-	xTaskNotifyFromISR( usbTaskHandle, 1, eSetValueWithOverwrite, &xHigherPriorityTaskWoken);
-	portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+	VcomTxRun(&hUsbDeviceFS, txPeek, txConsume, txMaxTransfer);
 }
@@ -35,6 +35,7 @@
 void VirtualCommInit( void );
 
 StreamBufferHandle_t const* GetUsbRxStreamBuff( void );
+int32_t ReceiveUsbData(uint8_t* Buff, uint16_t Len, int32_t DelayMs);
 int32_t TransmitUsbData(uint8_t const* Buff, uint16_t Len);
 int32_t TransmitUsbDataLossy(uint8_t const* Buff, uint16_t Len);
 
@@ -24,8 +24,11 @@
  */
 
 #include "VirtualCommDriverMultiTask.h"
+#include "MultiProducerRing.h"
+#include "VirtualCommTx.h"
 #include <usb_device.h>
 #include "usbd_cdc.h"
+#include "usbd_cdc_if.h"
 #include <task.h>
 #include <semphr.h>
 #include <SEGGER_SYSVIEW.h>
@@ -36,24 +39,44 @@
  * if multiple transfers should be placed into vcom_rxStream before being read
  * by the application, the streamBuffers should be larger
  *
- * The way usbd_cdc_if.c is written, any newly received data not fitting into the stream
- * buffer is dropped
+ * With VCOM_RX_FLOW_CONTROL set to 1 in usbd_cdc_if.c, the host is held off (NAK'd) while
+ * vcom_rxStream is full, so received data is never dropped.  Otherwise any newly received
+ * data not fitting into the stream buffer is dropped
  **/
 #define txBuffLen 1024
 #define rxBuffLen 1024
 
-uint8_t vcom_usbTxBuff[txBuffLen];
+//largest transfer handed to the USB stack at once - two can be
+//outstanding, and their data isn't released until they've been sent
+#define txMaxTransfer (txBuffLen / 4)
+
+/**
+ * When VCOM_MULTI_PRODUCER_TX is 1, writers queue data in a lock free ring
+ * (see MultiProducerRing.h) - each call to TransmitUsbData claims its own
+ * region of the ring with a single compare-and-swap, so a low priority
+ * writer can't hold up a high priority one the way it can while holding a mutex.
+ * Set it to 0 to serialize writers through vcom_mutexPtr and a stream buffer
+ * instead (txBuffLen must be a power of two in multi-producer mode)
+ */
+#ifndef VCOM_MULTI_PRODUCER_TX
+#define VCOM_MULTI_PRODUCER_TX 1
+#endif
+
 StreamBufferHandle_t vcom_rxStream = NULL;
-StreamBufferHandle_t vcom_txStream = NULL;
 TaskHandle_t vcom_usbTaskHandle = NULL;
+#if VCOM_MULTI_PRODUCER_TX
+static uint8_t vcom_txStorage[txBuffLen];
+static MpRing_t vcom_txRing;
+#else
+StreamBufferHandle_t vcom_txStream = NULL;
 SemaphoreHandle_t vcom_mutexPtr = NULL;
+#endif
 
 
 //hUsbDeviceFS defined in usb_device.c
 extern USBD_HandleTypeDef hUsbDeviceFS;
 
 void usbTxTask( void* NotUsed);
-void usbTxComplete( void );
 
 /********************************** PUBLIC *************************************/
 
@@ -69,13 +92,21 @@ void VirtualCommInit(	const configSTACK_DEPTH_TYPE UsbStackSize,
 						UBaseType_t UsbTxPriority )
 {
 	MX_USB_DEVICE_Init();
-	vcom_txStream = xStreamBufferCreate( txBuffLen, 1);
 	vcom_rxStream  = xStreamBufferCreate( rxBuffLen, 1);
-	assert_param( vcom_txStream != NULL);
 	assert_param( vcom_rxStream != NULL);
 
+#if VCOM_MULTI_PRODUCER_TX
+	MpRingInit(&vcom_txRing, vcom_txStorage, txBuffLen);
+#else
+	//a stream buffer's storage is one byte longer than its capacity -
+	//keeping the storage a whole number of USB packets long means data
+	//doesn't wrap part way through a packet (see VirtualCommTx.c)
+	vcom_txStream = xStreamBufferCreate( txBuffLen - 1, 1);
+	assert_param( vcom_txStream != NULL);
+
 	vcom_mutexPtr = xSemaphoreCreateMutex();
 	assert_param(vcom_mutexPtr != NULL);
+#endif
 	assert_param(xTaskCreate(usbTxTask, "usbTx", UsbStackSize, NULL, UsbTxPriority, &vcom_usbTaskHandle) == pdPASS);
 }
 
@@ -86,12 +117,30 @@ void VirtualCommInit(	const configSTACK_DEPTH_TYPE UsbStackSize,
  *
  * NOTE:	This return value will not be valid until VirtualCommInit has
  * 			been run
+ * NOTE:	With VCOM_RX_FLOW_CONTROL enabled (usbd_cdc_if.c), reception stops
+ * 			while the stream buffer is full - call CDC_RxResume_FS after
+ * 			reading from it directly (or use ReceiveUsbData, which does this),
+ * 			otherwise the host is NAK'd forever
  */
 StreamBufferHandle_t const* GetUsbRxStreamBuff( void )
 {
 	return &vcom_rxStream;
 }
 
+/**
+ * Receive up to Len bytes into Buff, waiting up to DelayMs for data to
+ * arrive.  Reception is resumed if it was paused because the receive
+ * stream buffer was full
+ * @returns number of bytes received
+ */
+int32_t ReceiveUsbData(uint8_t* Buff, uint16_t Len, int32_t DelayMs)
+{
+	int32_t numBytesReceived = xStreamBufferReceive(vcom_rxStream, Buff, Len, DelayMs / portTICK_PERIOD_MS);
+
+	CDC_RxResume_FS();
+	return numBytesReceived;
+}
+
 /**
  * Attempt to transmit Len bytes of data pointed to by Buff.  Waiting no longer
  * than DelayMs returning the number of bytes queued for transmission
@@ -100,9 +149,15 @@ StreamBufferHandle_t const* GetUsbRxStreamBuff( void )
  * @param DelayMs number of milliseconds to wait for space in the stream buffer
  * 		  to become available
  * @returns number of bytes added to the stream buffer
+ *
+ * NOTE:	In multi-producer mode Buff is queued as a whole or not at
+ * 			all, so the return value is either Len or 0
  */
 int32_t TransmitUsbData(uint8_t const*  Buff, uint16_t Len, int32_t DelayMs)
 {
+#if VCOM_MULTI_PRODUCER_TX
+	return MpRingSend(&vcom_txRing, Buff, Len, DelayMs / portTICK_PERIOD_MS);
+#else
 	int32_t numBytesCopied = 0;
 
 	//convert mS into ticks to work in native units
@@ -125,70 +180,43 @@ int32_t TransmitUsbData(uint8_t const*  Buff, uint16_t Len, int32_t DelayMs)
 	}
 
 	return numBytesCopied;
+#endif
 }
 
 /********************************** PRIVATE *************************************/
 
 /**
- * FreeRTOS task that takes data out of the vcom_txStream and pushes
- * data to be transmitted into the USB HAL buffer.
- *
- * This function waits for a task notification, which is sent by a callback generated
- * from the USB stack upon completion of a transmission
- *
- * It then then copies up to 2KB of data from the stream buffer to a
- * local buffer, which is passed to the HAL USB stack.
- *
+ * peek at the data waiting to be transmitted - only committed data is
+ * returned, it stays queued (so writers can't overwrite it) until
+ * txConsume is called
  */
-void usbTxTask( void* NotUsed)
+static uint32_t txPeek( StreamBufferSpans_t* TxSpans, TickType_t TicksToWait )
 {
-	USBD_CDC_HandleTypeDef *hcdc = NULL;
-
-	while(hcdc == NULL)
-	{
-		hcdc = (USBD_CDC_HandleTypeDef*)hUsbDeviceFS.pClassData;
-		vTaskDelay(10);
-	}
-	if (hcdc->TxState == 0)
-	{
-		//if there is no TX in progress, immediately send a task notification
-		//to kick things off
-		xTaskNotify( vcom_usbTaskHandle, 1, eSetValueWithOverwrite);
-	}
-	ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
-
-	//setup our own callback to be called when transmission is complete
-	hcdc->TxCallBack = usbTxComplete;
-
-	//ensure the USB interrupt priority is low enough to allow for
-	//FreeRTOS API calls within the ISR
-	NVIC_SetPriority(OTG_FS_IRQn, 6);
+#if VCOM_MULTI_PRODUCER_TX
+	return MpRingPeek(&vcom_txRing, TxSpans, TicksToWait);
+#else
+	return xStreamBufferPeek(vcom_txStream, TxSpans, txBuffLen, TicksToWait);
+#endif
+}
 
-	while(1)
-	{
-		SEGGER_SYSVIEW_PrintfHost("waiting for vcom_txStream");
-		//wait forever for data to become available in the stream buffer
-		//vcom_txStream.  up to txBuffLen bytes of data will be copied into
-		//vcom_usbTxBuff when at least 1 byte is available
-		uint8_t numBytes = xStreamBufferReceive(	vcom_txStream,
-													vcom_usbTxBuff,
-													txBuffLen,
-													portMAX_DELAY);
-		if(numBytes > 0)
-		{
-			SEGGER_SYSVIEW_PrintfHost("pulled %d bytes from vcom_txStream", numBytes);
-			USBD_CDC_SetTxBuffer(&hUsbDeviceFS, vcom_usbTxBuff, numBytes);
-			USBD_CDC_TransmitPacket(&hUsbDeviceFS);
-			//wait forever for a notification, clearing it to 0 when received
-			ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
-			SEGGER_SYSVIEW_PrintfHost("tx complete");
-		}
-	}
+static void txConsume( uint32_t NumBytes )
+{
+#if VCOM_MULTI_PRODUCER_TX
+	MpRingConsume(&vcom_txRing, NumBytes);
+#else
+	xStreamBufferConsume(vcom_txStream, NumBytes);
+#endif
 }
 
-void usbTxComplete( void )
+/**
+ * FreeRTOS task that passes data waiting to be transmitted directly to
+ * the HAL USB stack, without copying it to an intermediate buffer.
+ *
+ * The next chunk is staged while the current one is being sent and
+ * submitted from the USB ISR as soon as the current one completes
+ * (see VirtualCommTx.h)
+ */
+void usbTxTask( void* NotUsed)
 {
-	portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
-	xTaskNotifyFromISR( vcom_usbTaskHandle, 1, eSetValueWithOverwrite, &xHigherPriorityTaskWoken);
-	portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+	VcomTxRun(&hUsbDeviceFS, txPeek, txConsume, txMaxTransfer);
 }
@@ -36,6 +36,7 @@ void VirtualCommInit(	const configSTACK_DEPTH_TYPE UsbStackSize,
  						UBaseType_t UsbTxPriority );
 
 StreamBufferHandle_t const* GetUsbRxStreamBuff( void );
+int32_t ReceiveUsbData(uint8_t* Buff, uint16_t Len, int32_t DelayMs);
 
 int32_t TransmitUsbData(uint8_t const*  Buff, uint16_t Len, int32_t DelayMs);
 
@@ -0,0 +1,240 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Brian Amos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "VirtualCommTx.h"
+#include "usbd_cdc.h"
+#include <task.h>
+
+typedef struct
+{
+	uint8_t* Buff;
+	uint32_t Len;
+}TxRegion_t;
+
+static USBD_HandleTypeDef* txDev = NULL;
+static TaskHandle_t txTaskHandle = NULL;
+
+//the region the USB peripheral is sending, and the next one to send
+//(Len == 0 when empty) - shared with the ISR, only accessed from
+//within critical sections by the task
+static TxRegion_t inFlight;
+static TxRegion_t staged;
+//bytes sent since the task last consumed them from the buffer
+static uint32_t completedBytes;
+static VcomTxStats_t stats;
+
+static void usbTxComplete( void );
+static void submit( TxRegion_t const* Region );
+static TxRegion_t nextRegion( StreamBufferSpans_t const* Spans, uint32_t NumBytes,
+								uint32_t Offset, uint32_t MaxTransfer );
+
+/**
+ * body of the driver's TX task - never returns
+ *
+ * @param Dev USB device to transmit on (with the CDC class started)
+ * @param Peek returns (without removing) all of the data waiting in the
+ * 		  driver's buffer, waiting up to TicksToWait for some to arrive
+ * @param Consume removes NumBytes of data from the front of the driver's buffer
+ * @param MaxTransfer largest number of bytes to pass to the USB stack at
+ * 		  once.  Data is only consumed once it has been sent, so this should be
+ * 		  well under half of the buffer to leave writers room while the two
+ * 		  regions are outstanding
+ */
+void VcomTxRun(	USBD_HandleTypeDef* Dev, VcomTxPeekFn Peek, VcomTxConsumeFn Consume,
+				uint32_t MaxTransfer )
+{
+	USBD_CDC_HandleTypeDef *hcdc = NULL;
+
+	configASSERT(MaxTransfer > 0 && MaxTransfer <= UINT16_MAX);
+
+	while(hcdc == NULL)
+	{
+		hcdc = (USBD_CDC_HandleTypeDef*)Dev->pClassData;
+		vTaskDelay(10);
+	}
+
+	txDev = Dev;
+	txTaskHandle = xTaskGetCurrentTaskHandle();
+	taskENTER_CRITICAL();
+	//setup our own callback to be called when transmission is complete
+	hcdc->TxCallBack = usbTxComplete;
+	taskEXIT_CRITICAL();
+
+	//ensure the USB interrupt priority is low enough to allow for
+	//FreeRTOS API calls within the ISR
+	NVIC_SetPriority(OTG_FS_IRQn, 6);
+
+	while(1)
+	{
+		StreamBufferSpans_t spans;
+		TxRegion_t next;
+		uint32_t done, numBytes, offset;
+		BaseType_t isStaged, isIdle;
+
+		taskENTER_CRITICAL();
+		done = completedBytes;
+		completedBytes = 0;
+		isStaged = (staged.Len != 0);
+		offset = inFlight.Len;
+		isIdle = (offset == 0);
+		taskEXIT_CRITICAL();
+
+		//the regions are sent in order, so whatever has completed is
+		//always at the front of the buffer
+		if(done > 0)
+		{
+			Consume(done);
+		}
+
+		if(isStaged)
+		{
+			//both regions are taken, wait for the first to complete
+			ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+			continue;
+		}
+
+		//the region in flight is still at the front of the buffer, the
+		//next region starts right after it
+		numBytes = Peek(&spans, isIdle ? portMAX_DELAY : 0);
+		next = nextRegion(&spans, numBytes, offset, MaxTransfer);
+		if(next.Len == 0)
+		{
+			if(!isIdle)
+			{
+				//nothing new to stage - wait for the transfer to complete
+				ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+			}
+			continue;
+		}
+
+		taskENTER_CRITICAL();
+		if(inFlight.Len == 0 && hcdc->TxState == 0)
+		{
+			inFlight = next;
+			submit(&inFlight);
+		}
+		else
+		{
+			//picked up by usbTxComplete as soon as the endpoint is free
+			staged = next;
+		}
+		taskEXIT_CRITICAL();
+	}
+}
+
+/**
+ * copies the current statistics into Stats
+ */
+void VcomTxGetStats( VcomTxStats_t* Stats )
+{
+	taskENTER_CRITICAL();
+	*Stats = stats;
+	taskEXIT_CRITICAL();
+}
+
+/********************************** PRIVATE *************************************/
+
+/**
+ * called from the USB ISR (by the CDC class) when the IN endpoint is free -
+ * either a transfer has completed, or the ZLP ending one has been sent
+ */
+static void usbTxComplete( void )
+{
+	portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+	USBD_CDC_HandleTypeDef *hcdc = (USBD_CDC_HandleTypeDef*)txDev->pClassData;
+
+	if(inFlight.Len > 0)
+	{
+		completedBytes += inFlight.Len;
+		inFlight.Len = 0;
+	}
+	else
+	{
+		stats.Zlps++;
+	}
+
+	if(staged.Len > 0 && hcdc->TxState == 0)
+	{
+		inFlight = staged;
+		staged.Len = 0;
+		submit(&inFlight);
+		stats.ChainedTransfers++;
+	}
+
+	vTaskNotifyGiveFromISR(txTaskHandle, &xHigherPriorityTaskWoken);
+	portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
+/**
+ * hand Region to the USB stack - called with interrupts masked
+ */
+static void submit( TxRegion_t const* Region )
+{
+	USBD_CDC_SetTxBuffer(txDev, Region->Buff, Region->Len);
+	USBD_CDC_TransmitPacket(txDev);
+	stats.Transfers++;
+	stats.TxBytes += Region->Len;
+}
+
+/**
+ * the first contiguous run of at most MaxTransfer bytes starting Offset
+ * bytes into the NumBytes described by Spans.
+ *
+ * Every packet but the last in a transfer is full, so runs are cut to
+ * a whole number of packets where possible - any remainder is sent
+ * in the next transfer instead of going out as a short packet in the
+ * middle of the stream
+ */
+static TxRegion_t nextRegion( StreamBufferSpans_t const* Spans, uint32_t NumBytes,
+								uint32_t Offset, uint32_t MaxTransfer )
+{
+	TxRegion_t region = { NULL, 0 };
+
+	if(NumBytes <= Offset)
+	{
+		return region;
+	}
+
+	if(Offset < Spans->xFirstLength)
+	{
+		region.Buff = Spans->pucFirst + Offset;
+		region.Len = Spans->xFirstLength - Offset;
+	}
+	else
+	{
+		region.Buff = Spans->pucSecond + (Offset - Spans->xFirstLength);
+		region.Len = NumBytes - Offset;
+	}
+
+	if(region.Len > MaxTransfer)
+	{
+		region.Len = MaxTransfer;
+	}
+	if(region.Len > CDC_DATA_FS_IN_PACKET_SIZE)
+	{
+		region.Len -= region.Len % CDC_DATA_FS_IN_PACKET_SIZE;
+	}
+	return region;
+}
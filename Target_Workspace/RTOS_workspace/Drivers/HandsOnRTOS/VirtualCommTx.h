@@ -0,0 +1,72 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Brian Amos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef DRIVERS_HANDSONRTOS_VIRTUALCOMMTX_H_
+#define DRIVERS_HANDSONRTOS_VIRTUALCOMMTX_H_
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include <stdint.h>
+#include <FreeRTOS.h>
+#include <stream_buffer.h>
+#include "usbd_def.h"
+
+/**
+ * Double buffered USB CDC transmit, shared by VirtualCommDriver
+ * and VirtualCommDriverMultiTask.
+ *
+ * Two regions of the driver's TX buffer are handed to the USB stack
+ * at a time: the one being transmitted and the next one, which is
+ * staged by the TX task while the first is still in flight.  As soon as
+ * a transfer completes, the staged region is submitted straight from
+ * the CDC class's TxCallBack (in the USB ISR), so the IN endpoint isn't
+ * left NAK'ing while the TX task wakes up.
+ *
+ * Data is transmitted in place - the driver supplies functions to peek
+ * at and consume its buffer (the same as xStreamBufferPeek/Consume).
+ */
+
+typedef uint32_t (*VcomTxPeekFn)( StreamBufferSpans_t* Spans, TickType_t TicksToWait );
+typedef void (*VcomTxConsumeFn)( uint32_t NumBytes );
+
+typedef struct
+{
+	uint32_t TxBytes;
+	uint32_t Transfers;
+	//transfers submitted from the ISR, back to back with the previous one
+	uint32_t ChainedTransfers;
+	//transfers ending on a packet boundary that were followed by a ZLP
+	uint32_t Zlps;
+}VcomTxStats_t;
+
+void VcomTxRun(	USBD_HandleTypeDef* Dev, VcomTxPeekFn Peek, VcomTxConsumeFn Consume,
+				uint32_t MaxTransfer );
+void VcomTxGetStats( VcomTxStats_t* Stats );
+
+#ifdef __cplusplus
+ }
+#endif
+#endif /* DRIVERS_HANDSONRTOS_VIRTUALCOMMTX_H_ */
@@ -22,6 +22,7 @@
 /* Includes ------------------------------------------------------------------*/
 #include "usbd_cdc_if.h"
 #include "VirtualCommDriverMultiTask.h"
+#include <task.h>
 
 /* USER CODE BEGIN INCLUDE */
 
@@ -74,6 +75,22 @@
 /* It's up to user to redefine and/or remove those define */
 #define APP_RX_DATA_SIZE  1024
 #define APP_TX_DATA_SIZE  1024
+
+/**
+ * When VCOM_RX_FLOW_CONTROL is 1, the OUT endpoint is only re-armed once
+ * the receive stream buffer has room for a full packet.  Until then the
+ * peripheral NAK's the host, which holds on to the data and retries, so
+ * nothing is lost no matter how slowly the application reads.  The
+ * endpoint is re-armed by CDC_RxResume_FS once data has been read, so only
+ * enable it when every reader goes through ReceiveUsbData (or calls
+ * CDC_RxResume_FS itself) - a reader draining the stream buffer directly
+ * would leave the host NAK'd forever.
+ * Left at 0 the endpoint is always re-armed immediately, dropping whatever
+ * doesn't fit
+ */
+#ifndef VCOM_RX_FLOW_CONTROL
+#define VCOM_RX_FLOW_CONTROL 0
+#endif
 /* USER CODE END PRIVATE_DEFINES */
 
 /**
@@ -106,7 +123,9 @@ uint8_t UserRxBufferFS[APP_RX_DATA_SIZE];
 uint8_t UserTxBufferFS[APP_TX_DATA_SIZE];
 
 /* USER CODE BEGIN PRIVATE_VARIABLES */
-
+//set while the OUT endpoint is left un-armed because the stream buffer is full
+static volatile uint8_t rxPaused = 0;
+static CDC_RxStats_t rxStats;
 /* USER CODE END PRIVATE_VARIABLES */
 
 /**
@@ -165,6 +184,8 @@ static int8_t CDC_Init_FS(void)
   /* Set Application Buffers */
   USBD_CDC_SetTxBuffer(&hUsbDeviceFS, UserTxBufferFS, 0);
   USBD_CDC_SetRxBuffer(&hUsbDeviceFS, UserRxBufferFS);
+  //the class arms the OUT endpoint as soon as this returns
+  rxPaused = 0;
   return (USBD_OK);
   /* USER CODE END 3 */
 }
@@ -272,14 +293,29 @@ static int8_t CDC_Receive_FS(uint8_t* Buf, uint32_t *Len)
 {
 	/* USER CODE BEGIN 6 */
 	portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+	StreamBufferHandle_t rxStream = *GetUsbRxStreamBuff();
+	size_t numBytesCopied;
 
 	USBD_CDC_SetRxBuffer(&hUsbDeviceFS, &Buf[0]);
-	xStreamBufferSendFromISR(	*GetUsbRxStreamBuff(),
-								Buf,
-								*Len,
-								&xHigherPriorityTaskWoken);
-
-	USBD_CDC_ReceivePacket(&hUsbDeviceFS);
+	numBytesCopied = xStreamBufferSendFromISR(	rxStream,
+												Buf,
+												*Len,
+												&xHigherPriorityTaskWoken);
+	rxStats.RxBytes += numBytesCopied;
+	rxStats.DroppedBytes += *Len - numBytesCopied;
+
+#if VCOM_RX_FLOW_CONTROL
+	if(xStreamBufferSpacesAvailable(rxStream) < CDC_DATA_FS_OUT_PACKET_SIZE)
+	{
+		//leave the endpoint NAK'ing until the application makes room
+		rxPaused = 1;
+		rxStats.Pauses++;
+	}
+	else
+#endif
+	{
+		USBD_CDC_ReceivePacket(&hUsbDeviceFS);
+	}
 	portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
 	return (USBD_OK);
 	/* USER CODE END 6 */
@@ -312,6 +348,37 @@ uint8_t CDC_Transmit_FS(uint8_t* Buf, uint16_t Len)
 
 /* USER CODE BEGIN PRIVATE_FUNCTIONS_IMPLEMENTATION */
 
+/**
+  * @brief  CDC_RxResume_FS
+  *         Re-arms the OUT endpoint if it was left NAK'ing because the
+  *         receive stream buffer was full and there is now room for a full
+  *         packet.  Call after reading from the receive stream buffer -
+  *         it's cheap when reception isn't paused.
+  *         NOT able to be called from within an ISR
+  */
+void CDC_RxResume_FS(void)
+{
+  taskENTER_CRITICAL();
+  if(rxPaused && xStreamBufferSpacesAvailable(*GetUsbRxStreamBuff()) >= CDC_DATA_FS_OUT_PACKET_SIZE)
+  {
+    rxPaused = 0;
+    rxStats.Resumes++;
+    USBD_CDC_ReceivePacket(&hUsbDeviceFS);
+  }
+  taskEXIT_CRITICAL();
+}
+
+/**
+  * @brief  CDC_GetRxStats_FS
+  *         Copies the current receive statistics into Stats
+  */
+void CDC_GetRxStats_FS(CDC_RxStats_t* Stats)
+{
+  taskENTER_CRITICAL();
+  *Stats = rxStats;
+  taskEXIT_CRITICAL();
+}
+
 /* USER CODE END PRIVATE_FUNCTIONS_IMPLEMENTATION */
 
 /**
@@ -62,6 +62,18 @@
   */
 
 /* USER CODE BEGIN EXPORTED_TYPES */
+typedef struct
+{
+  uint32_t RxBytes;
+  //bytes that didn't fit in the receive stream buffer (only possible
+  //with VCOM_RX_FLOW_CONTROL set to 0)
+  uint32_t DroppedBytes;
+  //times the OUT endpoint was left un-armed (NAK'ing the host) because
+  //the receive stream buffer couldn't hold another packet
+  uint32_t Pauses;
+  //times CDC_RxResume_FS re-armed the endpoint
+  uint32_t Resumes;
+}CDC_RxStats_t;
 
 /* USER CODE END EXPORTED_TYPES */
 
@@ -106,6 +118,8 @@ extern USBD_CDC_ItfTypeDef USBD_Interface_fops_FS;
 uint8_t CDC_Transmit_FS(uint8_t* Buf, uint16_t Len);
 
 /* USER CODE BEGIN EXPORTED_FUNCTIONS */
+void CDC_RxResume_FS(void);
+void CDC_GetRxStats_FS(CDC_RxStats_t* Stats);
 
 /* USER CODE END EXPORTED_FUNCTIONS */
 
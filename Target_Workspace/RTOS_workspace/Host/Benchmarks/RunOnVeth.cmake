@@ -0,0 +1,45 @@
+# cmake -DCOMMAND=<benchmark> -DNODE=<interface> -DPEER=<interface> [-DARGS=<args>] -P RunOnVeth.cmake
+#
+# Runs a network benchmark across a veth pair created for the run: the
+# benchmark's FreeRTOS+TCP node is attached to NODE, its peer to PEER, and the
+# pair is deleted again afterwards.  Creating the pair needs CAP_NET_ADMIN -
+# without it (or without the ip tool) the run is reported as skipped.
+
+find_program( IP_TOOL ip PATHS /sbin /usr/sbin )
+if( NOT IP_TOOL )
+    message( "SKIPPED: no ip tool to create the veth pair" )
+    return()
+endif()
+
+function( ip )
+    execute_process( COMMAND ${IP_TOOL} ${ARGN}
+                     OUTPUT_QUIET ERROR_VARIABLE error
+                     RESULT_VARIABLE result )
+    set( ip_result ${result} PARENT_SCOPE )
+    set( ip_error "${error}" PARENT_SCOPE )
+endfunction()
+
+# Left over from an interrupted run.
+ip( link delete ${NODE} )
+
+ip( link add ${NODE} type veth peer name ${PEER} )
+if( NOT ip_result EQUAL 0 )
+    message( "SKIPPED: can't create a veth pair: ${ip_error}" )
+    return()
+endif()
+foreach( interface ${NODE} ${PEER} )
+    # No IPv6 router solicitations or other stray traffic from the host stack.
+    ip( link set ${interface} mtu 1500 up )
+    execute_process( COMMAND sysctl -qw net.ipv6.conf.${interface}.disable_ipv6=1
+                     OUTPUT_QUIET ERROR_QUIET )
+endforeach()
+
+execute_process( COMMAND ${COMMAND} ${NODE} ${PEER} ${ARGS}
+                 OUTPUT_VARIABLE output
+                 RESULT_VARIABLE result )
+ip( link delete ${NODE} )
+
+message( "${output}" )
+if( NOT result EQUAL 0 )
+    message( FATAL_ERROR "${COMMAND} failed (${result})" )
+endif()
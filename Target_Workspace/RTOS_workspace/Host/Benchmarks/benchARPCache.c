@@ -0,0 +1,404 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Brian Amos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <FreeRTOS_IP.h>
+#include <FreeRTOS_Sockets.h>
+#include <FreeRTOS_IP_Private.h>
+#include <FreeRTOS_ARP.h>
+#include <NetworkBufferManagement.h>
+#include <linux_vswitch.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "HostIP.h"
+#include "HostSupport.h"
+
+/*********************************************
+ * Cost of the ARP cache against the number of peers
+ *
+ * A single node on a port of the virtual switch learns
+ * more and more peers 10.30.x.y, the way a reply from
+ * each would enter them.  At each step these are timed
+ * with the IP task held off:
+ * hit:     looking up a random peer, as every UDP
+ *          datagram and TCP connect sent to it does
+ * miss:    looking up an address that is not in the cache
+ * refresh: refreshing a random peer, as every packet
+ *          received from it does
+ * age:     the ARP timer ageing the cache
+ *
+ * Built with the table scan the stack does by default
+ * (benchARPCache) and with ipconfigUSE_ARP_HASH
+ * (benchARPCache_hash), both with room for 512 peers, the
+ * cache column tells the results apart.  With the index,
+ * the slots examined per search come from
+ * FreeRTOS_GetARPCacheStats.  Two checks follow: with
+ * the cache full, learning new peers must replace the
+ * least recently used ones, and a datagram to an unknown
+ * peer must be held and sent once the ARP request for it
+ * is answered, rather than dropped.
+ *
+ * usage: benchARPCache [max peers] [lookups]
+ *********************************************/
+
+#define STACK_SIZE 512
+#define PEER_PORT 5001
+#define DEFAULT_MAX_PEERS 512
+#define DEFAULT_LOOKUPS 100000
+#define AGE_CALLS 8
+
+#if ( ipconfigUSE_ARP_HASH == 1 )
+#define CACHE_NAME "hash"
+#else
+#define CACHE_NAME "list"
+#endif
+
+static uint32_t maxPeers = DEFAULT_MAX_PEERS;
+static uint32_t lookups = DEFAULT_LOOKUPS;
+static char switchName[64];
+static const uint8_t nodeMac[ipMAC_ADDRESS_LENGTH_BYTES] = { 0x02, 0x00, 0x00, 0x00, 0x04, 0x00 };
+
+static void benchTask( void* NotUsed );
+
+int main( int argc, char* argv[] )
+{
+	if(argc > 1) maxPeers = (uint32_t)strtoul(argv[1], NULL, 0);
+	if(argc > 2) lookups = (uint32_t)strtoul(argv[2], NULL, 0);
+	configASSERT(maxPeers <= ipconfigARP_CACHE_ENTRIES);
+
+	//a switch with only this node on it - the ARP requests go nowhere
+	snprintf(switchName, sizeof(switchName), "/benchARPCache.%d", (int)getpid());
+	configASSERT(xVSwitchCreate(switchName, 1, NULL) == pdPASS);
+	configASSERT(xVSwitchAttach(switchName, 0) == pdPASS);
+	configASSERT(HostIPStart(nodeMac, FreeRTOS_inet_addr("10.30.0.1"), FreeRTOS_inet_addr("255.255.0.0")) == pdPASS);
+
+	//below the IP task, so it is never caught in the middle of changing the cache
+	configASSERT(xTaskCreate(benchTask, "bench", STACK_SIZE, NULL, tskIDLE_PRIORITY + 1, NULL) == pdPASS);
+	vTaskStartScheduler();
+	return 1;
+}
+
+/**
+ * @returns the address of peer Index, in network byte order
+ */
+static uint32_t peerIP( uint32_t Index )
+{
+	return FreeRTOS_htonl(0x0a1e0100UL + Index);
+}
+
+static void peerMac( uint32_t Index, MACAddress_t* Mac )
+{
+	const MACAddress_t base = { { 0x02, 0x00, 0x00, 0x01, 0x00, 0x00 } };
+
+	*Mac = base;
+	Mac->ucBytes[4] = (uint8_t)(Index >> 8);
+	Mac->ucBytes[5] = (uint8_t)Index;
+}
+
+/**
+ * time Count look-ups of random peers among NumPeers, or of
+ * addresses that are not in the cache when NumPeers is 0,
+ * with the scheduler suspended
+ * @returns ns per look-up
+ */
+static double timeLookups( uint32_t NumPeers )
+{
+	uint32_t seed = 1;
+	uint64_t start, elapsed;
+	MACAddress_t mac;
+
+	vTaskSuspendAll();
+	start = HostTimeNs();
+	for(uint32_t i = 0; i < lookups; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		if(NumPeers != 0)
+		{
+			uint32_t ip = peerIP((seed >> 8) % NumPeers);
+			configASSERT(eARPGetCacheEntry(&ip, &mac) == eARPCacheHit);
+		}
+		else
+		{
+			//10.30.200.0 to 10.30.207.255, none of them learnt
+			uint32_t ip = FreeRTOS_htonl(0x0a1ec800UL | ((seed >> 16) & 0x07ff));
+			configASSERT(eARPGetCacheEntry(&ip, &mac) == eARPCacheMiss);
+		}
+	}
+	elapsed = HostTimeNs() - start;
+	xTaskResumeAll();
+
+	return (double)elapsed / lookups;
+}
+
+/**
+ * time Count refreshes of random peers among NumPeers with
+ * the scheduler suspended
+ * @returns ns per refresh
+ */
+static double timeRefreshes( uint32_t NumPeers )
+{
+	uint32_t seed = 1;
+	uint64_t start, elapsed;
+	MACAddress_t mac;
+
+	vTaskSuspendAll();
+	start = HostTimeNs();
+	for(uint32_t i = 0; i < lookups; i++)
+	{
+		uint32_t index;
+
+		seed = seed * 1103515245 + 12345;
+		index = (seed >> 8) % NumPeers;
+		peerMac(index, &mac);
+		vARPRefreshCacheEntry(&mac, peerIP(index));
+	}
+	elapsed = HostTimeNs() - start;
+	xTaskResumeAll();
+
+	return (double)elapsed / lookups;
+}
+
+/**
+ * time AGE_CALLS calls of vARPAgeCache, as made by the IP task
+ * when its ARP timer fires, with the scheduler suspended.
+ * Every call ages the whole cache by one, so keep the total
+ * well below ipconfigMAX_ARP_AGE
+ * @returns ns per call
+ */
+static double timeAgeing( void )
+{
+	uint64_t start, elapsed;
+
+	vTaskSuspendAll();
+	start = HostTimeNs();
+	for(uint32_t i = 0; i < AGE_CALLS; i++)
+	{
+		vARPAgeCache();
+	}
+	elapsed = HostTimeNs() - start;
+	xTaskResumeAll();
+
+	return (double)elapsed / AGE_CALLS;
+}
+
+#if ( ipconfigUSE_ARP_HASH == 1 )
+/**
+ * with the cache full of NumPeers peers, use every other one
+ * in a random order and learn as many new peers as there are
+ * unused ones: those must have made room for the new ones, and
+ * all the others must still be found
+ */
+static void checkEviction( uint32_t NumPeers )
+{
+	uint32_t seed = 7;
+	uint32_t first = NumPeers;
+	uint8_t* used;
+	MACAddress_t mac;
+	ARPCacheStats_t before, after;
+
+	configASSERT(NumPeers == ipconfigARP_CACHE_ENTRIES);
+	used = pvPortMalloc(NumPeers);
+	configASSERT(used != NULL);
+	memset(used, 0, NumPeers);
+
+	vTaskSuspendAll();
+	FreeRTOS_GetARPCacheStats(&before);
+	for(uint32_t i = 0; i < NumPeers; i++)
+	{
+		uint32_t index, ip;
+
+		seed = seed * 1103515245 + 12345;
+		index = (seed >> 8) % NumPeers;
+		if(index % 2 == 0)
+		{
+			ip = peerIP(index);
+			configASSERT(eARPGetCacheEntry(&ip, &mac) == eARPCacheHit);
+			used[index] = 1;
+		}
+	}
+
+	for(uint32_t i = 0; i < NumPeers; i++)
+	{
+		if(!used[i])
+		{
+			peerMac(first + i, &mac);
+			vARPRefreshCacheEntry(&mac, peerIP(first + i));
+		}
+	}
+
+	for(uint32_t i = 0; i < NumPeers; i++)
+	{
+		uint32_t ip = peerIP(i);
+
+		configASSERT(eARPGetCacheEntry(&ip, &mac) == (used[i] ? eARPCacheHit : eARPCacheMiss));
+		if(!used[i])
+		{
+			ip = peerIP(first + i);
+			configASSERT(eARPGetCacheEntry(&ip, &mac) == eARPCacheHit);
+			configASSERT(mac.ucBytes[5] == (uint8_t)(first + i));
+		}
+	}
+	FreeRTOS_GetARPCacheStats(&after);
+	xTaskResumeAll();
+
+	configASSERT(after.uxValid == NumPeers);
+	printf("%lu least recently used peers made room for new ones\n", (unsigned long)(after.ulEvictions - before.ulEvictions));
+	vPortFree(used);
+}
+
+/**
+ * send a datagram to a peer the node has not heard of, answer
+ * the ARP request for it the way the peer would, and check the
+ * datagram waited for the answer and went out
+ */
+static void checkParking( void )
+{
+	const uint32_t strangerIP = FreeRTOS_inet_addr("10.30.250.1");
+	const MACAddress_t strangerMac = { { 0x02, 0x00, 0x00, 0x02, 0x00, 0x01 } };
+	struct freertos_sockaddr to = { 0 };
+	NetworkBufferDescriptor_t* reply;
+	ARPPacket_t* arp;
+	IPStackEvent_t rxEvent;
+	ARPCacheStats_t before, after;
+	Socket_t socket;
+
+	socket = FreeRTOS_socket(FREERTOS_AF_INET, FREERTOS_SOCK_DGRAM, FREERTOS_IPPROTO_UDP);
+	configASSERT(socket != FREERTOS_INVALID_SOCKET);
+
+	FreeRTOS_GetARPCacheStats(&before);
+	to.sin_addr = strangerIP;
+	to.sin_port = FreeRTOS_htons(PEER_PORT);
+	configASSERT(FreeRTOS_sendto(socket, "parked", 6, 0, &to, sizeof(to)) == 6);
+	vTaskDelay(pdMS_TO_TICKS(50));
+
+	FreeRTOS_GetARPCacheStats(&after);
+	configASSERT(after.uxParked == before.uxParked + 1);
+	configASSERT(after.uxPending == before.uxPending + 1);
+
+	//the reply to the request, as it would arrive from the switch
+	reply = pxGetNetworkBufferWithDescriptor(sizeof(ARPPacket_t), 0);
+	configASSERT(reply != NULL);
+	arp = (ARPPacket_t*)reply->pucEthernetBuffer;
+	memcpy(arp->xEthernetHeader.xDestinationAddress.ucBytes, nodeMac, sizeof(nodeMac));
+	arp->xEthernetHeader.xSourceAddress = strangerMac;
+	arp->xEthernetHeader.usFrameType = ipARP_FRAME_TYPE;
+	arp->xARPHeader.usHardwareType = ipARP_HARDWARE_TYPE_ETHERNET;
+	arp->xARPHeader.usProtocolType = ipARP_PROTOCOL_TYPE;
+	arp->xARPHeader.ucHardwareAddressLength = ipMAC_ADDRESS_LENGTH_BYTES;
+	arp->xARPHeader.ucProtocolAddressLength = ipIP_ADDRESS_LENGTH_BYTES;
+	arp->xARPHeader.usOperation = ipARP_REPLY;
+	arp->xARPHeader.xSenderHardwareAddress = strangerMac;
+	memcpy(arp->xARPHeader.ucSenderProtocolAddress, &strangerIP, sizeof(strangerIP));
+	memcpy(arp->xARPHeader.xTargetHardwareAddress.ucBytes, nodeMac, sizeof(nodeMac));
+	arp->xARPHeader.ulTargetProtocolAddress = FreeRTOS_GetIPAddress();
+	reply->xDataLength = sizeof(ARPPacket_t);
+	rxEvent.eEventType = eNetworkRxEvent;
+	rxEvent.pvData = reply;
+	configASSERT(xSendEventStructToIPTask(&rxEvent, portMAX_DELAY) == pdPASS);
+	vTaskDelay(pdMS_TO_TICKS(50));
+
+	FreeRTOS_GetARPCacheStats(&after);
+	configASSERT(after.uxParked == before.uxParked);
+	configASSERT(after.ulParkedSent == before.ulParkedSent + 1);
+	configASSERT(after.ulParkedDropped == before.ulParkedDropped);
+	printf("parked datagram sent after the ARP reply\n");
+
+	FreeRTOS_closesocket(socket);
+}
+#endif /* ipconfigUSE_ARP_HASH */
+
+static void benchTask( void* NotUsed )
+{
+	uint32_t numPeers = 0;
+	uint32_t step = 16;
+	double hitNs, missNs, refreshNs, ageNs;
+
+	configASSERT(HostIPWaitUp(pdMS_TO_TICKS(10000)));
+
+	//have the IP task send a gratuitous ARP now, rather than the timed
+	//ageing queue one for it with the scheduler suspended - not at tick 0,
+	//which the stack takes for never having sent one
+	vTaskDelay(pdMS_TO_TICKS(50));
+	vARPSendGratuitous();
+	vTaskDelay(pdMS_TO_TICKS(50));
+
+	printf("cache,peers,hit_ns,miss_ns,refresh_ns,age_ns,probes_per_search\n");
+	while(numPeers < maxPeers)
+	{
+		//learn peers up to the next step
+		vTaskSuspendAll();
+		while((numPeers < step) && (numPeers < maxPeers))
+		{
+			MACAddress_t mac;
+
+			peerMac(numPeers, &mac);
+			vARPRefreshCacheEntry(&mac, peerIP(numPeers));
+			numPeers++;
+		}
+		xTaskResumeAll();
+
+#if ( ipconfigUSE_ARP_HASH == 1 )
+		{
+			ARPCacheStats_t before, after;
+
+			FreeRTOS_GetARPCacheStats(&before);
+			hitNs = timeLookups(numPeers);
+			FreeRTOS_GetARPCacheStats(&after);
+			configASSERT(after.uxValid >= numPeers);
+			missNs = timeLookups(0);
+			refreshNs = timeRefreshes(numPeers);
+			ageNs = timeAgeing();
+			printf("%s,%lu,%.1f,%.1f,%.1f,%.1f,%.2f\n", CACHE_NAME, (unsigned long)numPeers, hitNs, missNs, refreshNs, ageNs,
+					(double)(after.ulProbes - before.ulProbes) / (after.ulSearches - before.ulSearches));
+		}
+#else
+		hitNs = timeLookups(numPeers);
+		missNs = timeLookups(0);
+		refreshNs = timeRefreshes(numPeers);
+		ageNs = timeAgeing();
+		printf("%s,%lu,%.1f,%.1f,%.1f,%.1f,\n", CACHE_NAME, (unsigned long)numPeers, hitNs, missNs, refreshNs, ageNs);
+#endif
+		step *= 4;
+	}
+
+#if ( ipconfigUSE_ARP_HASH == 1 )
+	if(numPeers == ipconfigARP_CACHE_ENTRIES)
+	{
+		checkEviction(numPeers);
+	}
+	checkParking();
+#endif
+	fflush(stdout);
+
+	//the IP task keeps running, so leave from here rather than ending the
+	//scheduler - with the interrupts off, for the network interface's task
+	//not to run once the switch is unmapped
+	taskENTER_CRITICAL();
+	vVSwitchDestroy(switchName);
+	exit(0);
+}
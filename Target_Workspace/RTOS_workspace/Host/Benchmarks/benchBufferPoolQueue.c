@@ -0,0 +1,324 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2019 Brian Amos
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <queue.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "HostSupport.h"
+#include "BufferPool.h"
+
+/*********************************************
+ * Moving large messages between tasks: queue pass by
+ * value vs. BufferPool pass by reference
+ *
+ * value:     the message is built in a local buffer and
+ *            xQueueSend copies it into the queue, then
+ *            xQueueReceive copies it back out
+ *            (Chapter_9 mainQueueCompositePassByValue.c)
+ * reference: the message is built in a block from a pool and
+ *            only its pointer goes through the queue - the
+ *            receiver frees the block once it's done with it
+ *
+ * Each mode is run twice: "inline", where a single task sends
+ * a message then immediately receives it (isolating the cost of
+ * moving the message) and "tasks", where a sending task
+ * (tskIDLE_PRIORITY + 2) sends messages back to back to a
+ * receiving task (tskIDLE_PRIORITY + 1) through a queue of
+ * QUEUE_LEN messages, the same priorities as the Chapter_9
+ * examples (end to end, including the context switches, which
+ * dominate on the Posix port).  Every message is checked.
+ *
+ * Also reports the RAM each approach needs for the queue
+ * (and pool) storage.
+ *
+ * Passing by reference trades the two copies of the message for
+ * the pool's bookkeeping (a semaphore take/give and two short
+ * critical sections).  On the Posix port every critical section
+ * is a pair of signal mask system calls while copying a 1KB
+ * message takes tens of ns, so these numbers are the worst case
+ * for the pool - on a Cortex-M7 a critical section is a few
+ * instructions and the copies are what cost.
+ *
+ * usage: benchBufferPoolQueue [numMessages]
+ *********************************************/
+
+#define STACK_SIZE 256
+#define QUEUE_LEN 8
+//one block for the sender to fill and one for the receiver to
+//work on while the queue is full
+#define NUM_BLOCKS (QUEUE_LEN + 2)
+#define DEFAULT_NUM_MESSAGES 100000
+
+static const size_t payloadLens[] = { 16, 64, 256, 1024 };
+#define NUM_PAYLOAD_LENS (sizeof(payloadLens)/sizeof(payloadLens[0]))
+#define MAX_PAYLOAD_LEN 1024
+
+typedef enum
+{
+	MODE_VALUE = 0,
+	MODE_REFERENCE,
+	NUM_MODES
+}BenchMode_t;
+
+typedef enum
+{
+	TOPOLOGY_INLINE = 0,
+	TOPOLOGY_TASKS,
+	NUM_TOPOLOGIES
+}BenchTopology_t;
+
+static const char* topologyNames[NUM_TOPOLOGIES] = { "inline", "tasks" };
+
+typedef struct
+{
+	uint32_t Seq;
+	uint32_t Len;
+	uint8_t Payload[];
+}Msg_t;
+
+typedef struct
+{
+	Msg_t Header;
+	uint8_t Payload[MAX_PAYLOAD_LEN];
+}MaxMsg_t;
+
+static TaskHandle_t controlTaskHandle = NULL;
+static BenchMode_t currentMode;
+static size_t currentPayloadLen;
+static size_t msgLen;
+static uint32_t numMessages;
+static volatile bool dataCorrupt = false;
+static uint64_t results[NUM_TOPOLOGIES][NUM_PAYLOAD_LENS][NUM_MODES];
+static uint16_t highWater[NUM_PAYLOAD_LENS];
+
+static QueueHandle_t valueQueue = NULL;
+static MaxMsg_t blocks[NUM_BLOCKS];
+static uint16_t links[NUM_BLOCKS];
+static BufPool_t pool;
+BUF_QUEUE_STATIC(refQueue, QUEUE_LEN);
+
+static uint8_t pattern[256 + MAX_PAYLOAD_LEN];
+
+void sendingTask( void* NotUsed );
+void recvTask( void* NotUsed );
+void controlTask( void* NotUsed );
+
+int main( int argc, char* argv[] )
+{
+	numMessages = DEFAULT_NUM_MESSAGES;
+	if(argc > 1)
+	{
+		numMessages = (uint32_t)strtoul(argv[1], NULL, 0);
+	}
+
+	for(size_t i = 0; i < sizeof(pattern); i++)
+	{
+		pattern[i] = (uint8_t)i;
+	}
+
+	configASSERT(xTaskCreate(controlTask, "control", STACK_SIZE, NULL, tskIDLE_PRIORITY + 3, &controlTaskHandle) == pdPASS);
+
+	vTaskStartScheduler();
+
+	printf("topology,payload_len,messages,value_ns_per_msg,reference_ns_per_msg,speedup,value_queue_bytes,reference_pool_queue_bytes,pool_high_water\n");
+	for(int topology = 0; topology < NUM_TOPOLOGIES; topology++)
+	{
+		for(size_t i = 0; i < NUM_PAYLOAD_LENS; i++)
+		{
+			uint64_t const* elapsed = results[topology][i];
+			size_t len = sizeof(Msg_t) + payloadLens[i];
+
+			printf("%s,%zu,%lu,%.1f,%.1f,%.2f,%zu,%zu,%u\n", topologyNames[topology],
+					payloadLens[i], (unsigned long)numMessages,
+					(double)elapsed[MODE_VALUE] / numMessages,
+					(double)elapsed[MODE_REFERENCE] / numMessages,
+					(double)elapsed[MODE_VALUE] / (double)elapsed[MODE_REFERENCE],
+					QUEUE_LEN * len,
+					NUM_BLOCKS * (len + sizeof(uint16_t)) + QUEUE_LEN * sizeof(void*),
+					highWater[i]);
+		}
+	}
+
+	if(dataCorrupt)
+	{
+		fprintf(stderr, "data corrupted in transit\n");
+		return 1;
+	}
+	return 0;
+}
+
+static void sendMsg( uint32_t Seq );
+static void recvMsg( uint32_t Seq );
+
+/**
+ * runs each topology/payload length/mode combination in turn
+ */
+void controlTask( void* NotUsed )
+{
+	TaskHandle_t sender, receiver;
+
+	for(size_t i = 0; i < NUM_PAYLOAD_LENS; i++)
+	{
+		for(int mode = 0; mode < NUM_MODES; mode++)
+		{
+			uint64_t start;
+
+			currentMode = (BenchMode_t)mode;
+			currentPayloadLen = payloadLens[i];
+			msgLen = sizeof(Msg_t) + currentPayloadLen;
+
+			if(currentMode == MODE_VALUE)
+			{
+				valueQueue = xQueueCreate(QUEUE_LEN, msgLen);
+				configASSERT(valueQueue != NULL);
+			}
+			else
+			{
+				//blocks are sized for this run's messages, the same as a
+				//pool dedicated to one message type would be
+				BufPoolInit(&pool, blocks, msgLen, links, NUM_BLOCKS);
+				BUF_QUEUE_INIT(refQueue, pool);
+			}
+
+			//inline - this task is both the sender and the receiver
+			start = HostTimeNs();
+			for(uint32_t seq = 0; seq < numMessages; seq++)
+			{
+				sendMsg(seq);
+				recvMsg(seq);
+			}
+			results[TOPOLOGY_INLINE][i][mode] = HostTimeNs() - start;
+
+			//tasks - a fresh sender/receiver pair
+			start = HostTimeNs();
+			configASSERT(xTaskCreate(recvTask, "recvTask", STACK_SIZE, NULL, tskIDLE_PRIORITY + 1, &receiver) == pdPASS);
+			configASSERT(xTaskCreate(sendingTask, "sendingTask", STACK_SIZE, NULL, tskIDLE_PRIORITY + 2, &sender) == pdPASS);
+
+			//the receiver notifies once every message has been checked
+			ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+			results[TOPOLOGY_TASKS][i][mode] = HostTimeNs() - start;
+
+			vTaskDelete(sender);
+			vTaskDelete(receiver);
+			//give the idle task a chance to clean up the deleted tasks
+			vTaskDelay(2);
+
+			if(currentMode == MODE_VALUE)
+			{
+				vQueueDelete(valueQueue);
+			}
+			else
+			{
+				configASSERT(BufPoolNumFree(&pool) == NUM_BLOCKS);
+				highWater[i] = BufPoolGetHighWaterMark(&pool);
+				vQueueDelete(refQueue.Queue);
+				vSemaphoreDelete(pool.FreeCount);
+			}
+		}
+	}
+
+	vTaskEndScheduler();
+}
+
+/**
+ * stands in for whatever fills in a message (sampling, formatting...)
+ */
+static void buildMsg( Msg_t* Msg, uint32_t Seq )
+{
+	Msg->Seq = Seq;
+	Msg->Len = (uint32_t)currentPayloadLen;
+	memcpy(Msg->Payload, &pattern[Seq & 0xFF], currentPayloadLen);
+}
+
+static void checkMsg( Msg_t const* Msg, uint32_t Seq )
+{
+	if(Msg->Seq != Seq || Msg->Len != currentPayloadLen ||
+			memcmp(Msg->Payload, &pattern[Seq & 0xFF], currentPayloadLen) != 0)
+	{
+		dataCorrupt = true;
+	}
+}
+
+static void sendMsg( uint32_t Seq )
+{
+	if(currentMode == MODE_VALUE)
+	{
+		MaxMsg_t msg;
+
+		buildMsg(&msg.Header, Seq);
+		configASSERT(xQueueSend(valueQueue, &msg, portMAX_DELAY) == pdPASS);
+	}
+	else
+	{
+		Msg_t* msg = BufPoolAlloc(&pool, portMAX_DELAY);
+
+		buildMsg(msg, Seq);
+		configASSERT(BufQueueSend(&refQueue, msg, portMAX_DELAY) == pdPASS);
+	}
+}
+
+static void recvMsg( uint32_t Seq )
+{
+	if(currentMode == MODE_VALUE)
+	{
+		MaxMsg_t msg;
+
+		configASSERT(xQueueReceive(valueQueue, &msg, portMAX_DELAY) == pdPASS);
+		checkMsg(&msg.Header, Seq);
+	}
+	else
+	{
+		Msg_t* msg = BufQueueReceive(&refQueue, portMAX_DELAY);
+
+		checkMsg(msg, Seq);
+		BufPoolFree(&pool, msg);
+	}
+}
+
+void sendingTask( void* NotUsed )
+{
+	for(uint32_t seq = 0; seq < numMessages; seq++)
+	{
+		sendMsg(seq);
+	}
+
+	//wait to be deleted by the control task
+	vTaskSuspend(NULL);
+}
+
+void recvTask( void* NotUsed )
+{
+	for(uint32_t seq = 0; seq < numMessages; seq++)
+	{
+		recvMsg(seq);
+	}
+
+	xTaskNotifyGive(controlTaskHandle);
+	vTaskSuspend(NULL);
+}
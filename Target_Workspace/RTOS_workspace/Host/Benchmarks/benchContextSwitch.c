@@ -0,0 +1,157 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2019 Brian Amos
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "HostSupport.h"
+#include "wait_for_event.h"
+
+/*********************************************
+ * Context switches per second on the Posix port
+ *
+ * Every switch on the Posix port is a thread handoff: the
+ * outgoing thread signals the incoming thread's event and
+ * waits on its own (utils/wait_for_event.c).
+ * yield:   two tasks at the same priority taskYIELD() back
+ *          and forth, one switch per yield
+ * notify:  a high priority task waits on ulTaskNotifyTake,
+ *          a low priority one gives to it - two switches
+ *          per notification
+ *
+ * Built with the futex events (benchContextSwitch) and with
+ * the pthread mutex/condition variable events the port used
+ * before (benchContextSwitch_condvar), the event column
+ * tells the results apart.  benchContextSwitch_runTimeStats
+ * adds the RunTimeStats.c hooks to every switch ("+stats"),
+ * for their overhead.
+ *
+ * usage: benchContextSwitch [switches]
+ *********************************************/
+
+#define STACK_SIZE 256
+#define DEFAULT_SWITCHES 200000
+
+#if EVENT_USE_FUTEX == 1
+#define EVENT_NAME "futex"
+#else
+#define EVENT_NAME "condvar"
+#endif
+
+#if defined(HOST_RUN_TIME_STATS) && (HOST_RUN_TIME_STATS == 1)
+#include "RunTimeStats.h"
+#define STATS_NAME "+stats"
+#else
+#define STATS_NAME ""
+#endif
+
+static uint32_t switches;
+static TaskHandle_t controlTaskHandle = NULL;
+static TaskHandle_t peerTaskHandle = NULL;
+
+static void controlTask( void* NotUsed );
+
+int main( int argc, char* argv[] )
+{
+	switches = DEFAULT_SWITCHES;
+	if(argc > 1)
+	{
+		switches = (uint32_t)strtoul(argv[1], NULL, 0);
+	}
+
+	printf("event,test,switches,ns_per_switch,switches_per_sec\n");
+
+#if defined(HOST_RUN_TIME_STATS) && (HOST_RUN_TIME_STATS == 1)
+	RunTimeStatsInit(0);
+#endif
+	configASSERT(xTaskCreate(controlTask, "control", STACK_SIZE, NULL, tskIDLE_PRIORITY + 4, &controlTaskHandle) == pdPASS);
+
+	vTaskStartScheduler();
+	return 0;
+}
+
+static void printResult( const char* Test, uint64_t ElapsedNs )
+{
+	printf("%s%s,%s,%lu,%.1f,%.0f\n", EVENT_NAME, STATS_NAME, Test, (unsigned long)switches,
+			(double)ElapsedNs / switches, switches * 1e9 / ElapsedNs);
+}
+
+static void yieldTask( void* NotUsed )
+{
+	for(uint32_t i = 0; i < switches / 2; i++)
+	{
+		taskYIELD();
+	}
+	xTaskNotifyGive(controlTaskHandle);
+	vTaskSuspend(NULL);
+}
+
+static void notifyTakeTask( void* NotUsed )
+{
+	for(uint32_t i = 0; i < switches / 2; i++)
+	{
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+	}
+	xTaskNotifyGive(controlTaskHandle);
+	vTaskSuspend(NULL);
+}
+
+static void notifyGiveTask( void* NotUsed )
+{
+	for(uint32_t i = 0; i < switches / 2; i++)
+	{
+		xTaskNotifyGive(peerTaskHandle);
+	}
+	vTaskSuspend(NULL);
+}
+
+static void controlTask( void* NotUsed )
+{
+	TaskHandle_t yielders[2];
+	TaskHandle_t giver;
+	uint64_t start;
+
+	//yield - the two yielding tasks alternate until both are done
+	start = HostTimeNs();
+	configASSERT(xTaskCreate(yieldTask, "yield0", STACK_SIZE, NULL, tskIDLE_PRIORITY + 2, &yielders[0]) == pdPASS);
+	configASSERT(xTaskCreate(yieldTask, "yield1", STACK_SIZE, NULL, tskIDLE_PRIORITY + 2, &yielders[1]) == pdPASS);
+	ulTaskNotifyTake(pdFALSE, portMAX_DELAY);
+	ulTaskNotifyTake(pdFALSE, portMAX_DELAY);
+	printResult("yield", HostTimeNs() - start);
+	vTaskDelete(yielders[0]);
+	vTaskDelete(yielders[1]);
+
+	//notify
+	configASSERT(xTaskCreate(notifyTakeTask, "take", STACK_SIZE, NULL, tskIDLE_PRIORITY + 3, &peerTaskHandle) == pdPASS);
+	start = HostTimeNs();
+	configASSERT(xTaskCreate(notifyGiveTask, "give", STACK_SIZE, NULL, tskIDLE_PRIORITY + 1, &giver) == pdPASS);
+	ulTaskNotifyTake(pdFALSE, portMAX_DELAY);
+	printResult("notify", HostTimeNs() - start);
+	vTaskDelete(peerTaskHandle);
+	vTaskDelete(giver);
+
+	vTaskEndScheduler();
+}
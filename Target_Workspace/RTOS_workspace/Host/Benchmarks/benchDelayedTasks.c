@@ -0,0 +1,279 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2019 Brian Amos
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "HostSupport.h"
+
+/*********************************************
+ * Cost of blocking with a timeout, against the number of
+ * tasks blocked, for the sorted delayed task lists and the
+ * delayed task wheel (configUSE_DELAYED_TASK_WHEEL)
+ *
+ * For 10, 100 and 1000 sleeper tasks in turn, every sleeper
+ * loops on ulTaskNotifyTake() with a random timeout of 1 to
+ * MAX_PERIOD ticks and is never notified, so every wait
+ * times out.  ulTaskNotifyTake() adds the task to the
+ * delayed lists inside a critical section, so a sorted
+ * insertion that walks the other blocked tasks keeps
+ * interrupts masked for as long as the walk takes.
+ *
+ * insert_ns/insert_max_ns  adding the running task to the
+ *                          delayed lists or wheel, timed with
+ *                          the traceADD_TO_DELAYED_LIST hooks
+ * unblock_ns/unblock_max_ns  a tick's pass over the tasks
+ *                          due to unblock, timed with the
+ *                          traceUNBLOCK_DELAYED_TASKS hooks
+ * critical_max_ns          longest time the port kept signals
+ *                          masked (configUSE_CRITICAL_SECTION_TIMING)
+ * late_max_ticks           latest a sleeper ran after its
+ *                          timeout, which includes waiting its
+ *                          turn behind the other sleepers
+ *
+ * All the timings include a HostTimeNs() call, and the host
+ * can preempt the process inside any of them - compare the
+ * max columns over a few runs.  With the lists insert_ns
+ * should grow with the task count, with the wheel it should
+ * stay flat.
+ *
+ * usage: benchDelayedTasks_<backend> [ticks per task count]
+ *********************************************/
+
+#define STACK_SIZE configMINIMAL_STACK_SIZE
+#define CONTROL_STACK_SIZE 256
+#define SLEEPER_PRIORITY (tskIDLE_PRIORITY + 1)
+#define CONTROL_PRIORITY (configMAX_PRIORITIES - 1)
+#define MAX_SLEEPERS 1000
+#define MAX_PERIOD 200
+#define DEFAULT_TICKS 2000
+
+#if configUSE_DELAYED_TASK_WHEEL == 1
+#define BACKEND_NAME "wheel"
+#else
+#define BACKEND_NAME "list"
+#endif
+
+typedef struct
+{
+	uint64_t TotalNs;
+	uint64_t MaxNs;
+	uint32_t Count;
+}TimingStats_t;
+
+typedef struct
+{
+	uint32_t Sleepers;
+	TimingStats_t Insert;
+	TimingStats_t Unblock;
+	uint64_t CriticalMaxNs;
+	TickType_t LateMax;
+}Result_t;
+
+static const uint32_t sleeperCounts[] = { 10, 100, 1000 };
+#define NUM_RUNS (sizeof(sleeperCounts)/sizeof(sleeperCounts[0]))
+
+//the sleepers are static, 1000 of them don't fit the host heap
+static StaticTask_t sleeperTcbs[MAX_SLEEPERS];
+static StackType_t sleeperStacks[MAX_SLEEPERS][STACK_SIZE];
+static TaskHandle_t sleeperHandles[MAX_SLEEPERS];
+static TickType_t sleeperLateMax[MAX_SLEEPERS];
+static volatile uint32_t activeSleepers = 0;
+
+static TickType_t runTicks;
+static Result_t results[NUM_RUNS];
+
+//written with the scheduler suspended or from the tick, which
+//the port serializes
+static volatile int timingEnabled = 0;
+static uint64_t insertStartNs;
+static uint64_t unblockStartNs;
+static TimingStats_t insertStats;
+static TimingStats_t unblockStats;
+
+static void controlTask( void* NotUsed );
+static void sleeperTask( void* Arg );
+
+int main( int argc, char* argv[] )
+{
+	runTicks = DEFAULT_TICKS;
+	if(argc > 1)
+	{
+		runTicks = (TickType_t)strtoul(argv[1], NULL, 0);
+	}
+
+	for(uint32_t i = 0; i < MAX_SLEEPERS; i++)
+	{
+		sleeperHandles[i] = xTaskCreateStatic(sleeperTask, "sleeper", STACK_SIZE, (void*)(uintptr_t)i,
+											  SLEEPER_PRIORITY, sleeperStacks[i], &sleeperTcbs[i]);
+		configASSERT(sleeperHandles[i] != NULL);
+	}
+	configASSERT(xTaskCreate(controlTask, "control", CONTROL_STACK_SIZE, NULL, CONTROL_PRIORITY, NULL) == pdPASS);
+
+	vTaskStartScheduler();
+
+	printf("backend,tasks,ticks,inserts,insert_ns,insert_max_ns,unblock_ns,unblock_max_ns,critical_max_ns,late_max_ticks\n");
+	for(uint32_t i = 0; i < NUM_RUNS; i++)
+	{
+		Result_t* result = &results[i];
+
+		printf("%s,%lu,%lu,%lu,%.1f,%llu,%.1f,%llu,%llu,%lu\n",
+				BACKEND_NAME, (unsigned long)result->Sleepers, (unsigned long)runTicks,
+				(unsigned long)result->Insert.Count,
+				(double)result->Insert.TotalNs / result->Insert.Count, (unsigned long long)result->Insert.MaxNs,
+				(double)result->Unblock.TotalNs / result->Unblock.Count, (unsigned long long)result->Unblock.MaxNs,
+				(unsigned long long)result->CriticalMaxNs, (unsigned long)result->LateMax);
+	}
+	return 0;
+}
+
+static void addTiming( TimingStats_t* Stats, uint64_t StartNs )
+{
+	uint64_t elapsed = HostTimeNs() - StartNs;
+
+	Stats->TotalNs += elapsed;
+	Stats->Count++;
+	if(elapsed > Stats->MaxNs)
+	{
+		Stats->MaxNs = elapsed;
+	}
+}
+
+void HostDelayedTimingInsertStart( void )
+{
+	if(timingEnabled)
+	{
+		insertStartNs = HostTimeNs();
+	}
+}
+
+void HostDelayedTimingInsertStop( void )
+{
+	if(timingEnabled && insertStartNs != 0)
+	{
+		addTiming(&insertStats, insertStartNs);
+	}
+	insertStartNs = 0;
+}
+
+void HostDelayedTimingUnblockStart( void )
+{
+	if(timingEnabled)
+	{
+		unblockStartNs = HostTimeNs();
+	}
+}
+
+void HostDelayedTimingUnblockStop( void )
+{
+	if(timingEnabled && unblockStartNs != 0)
+	{
+		addTiming(&unblockStats, unblockStartNs);
+	}
+	unblockStartNs = 0;
+}
+
+static void sleeperTask( void* Arg )
+{
+	uint32_t index = (uint32_t)(uintptr_t)Arg;
+	uint32_t random = index * 2654435761u + 1;
+
+	while(1)
+	{
+		TickType_t period, start, waited;
+
+		//parked until the control task wants this many sleepers
+		if(index >= activeSleepers)
+		{
+			ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+			continue;
+		}
+
+		//xorshift32
+		random ^= random << 13;
+		random ^= random >> 17;
+		random ^= random << 5;
+		period = 1 + random % MAX_PERIOD;
+
+		start = xTaskGetTickCount();
+		if(ulTaskNotifyTake(pdTRUE, period) == 0)
+		{
+			waited = xTaskGetTickCount() - start;
+			//a timeout can never come early
+			configASSERT(waited >= period);
+			if(waited - period > sleeperLateMax[index])
+			{
+				sleeperLateMax[index] = waited - period;
+			}
+		}
+	}
+}
+
+static void controlTask( void* NotUsed )
+{
+	for(uint32_t run = 0; run < NUM_RUNS; run++)
+	{
+		Result_t* result = &results[run];
+
+		result->Sleepers = sleeperCounts[run];
+		activeSleepers = result->Sleepers;
+		for(uint32_t i = 0; i < result->Sleepers; i++)
+		{
+			sleeperLateMax[i] = 0;
+			xTaskNotifyGive(sleeperHandles[i]);
+		}
+		//let every sleeper block once before timing anything
+		vTaskDelay(MAX_PERIOD);
+
+		vTaskSuspendAll();
+		insertStats = (TimingStats_t){ 0 };
+		unblockStats = (TimingStats_t){ 0 };
+		vPortResetCriticalSectionTiming();
+		timingEnabled = 1;
+		( void ) xTaskResumeAll();
+
+		vTaskDelay(runTicks);
+
+		vTaskSuspendAll();
+		timingEnabled = 0;
+		result->Insert = insertStats;
+		result->Unblock = unblockStats;
+		result->CriticalMaxNs = ullPortGetLongestCriticalSectionNs();
+		( void ) xTaskResumeAll();
+		for(uint32_t i = 0; i < result->Sleepers; i++)
+		{
+			if(sleeperLateMax[i] > result->LateMax)
+			{
+				result->LateMax = sleeperLateMax[i];
+			}
+		}
+
+		//every sleeper parks once its current timeout is up
+		activeSleepers = 0;
+		vTaskDelay(2 * MAX_PERIOD);
+	}
+	vTaskEndScheduler();
+}
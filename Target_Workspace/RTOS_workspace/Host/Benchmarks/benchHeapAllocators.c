@@ -0,0 +1,547 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2019 Brian Amos
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "HostSupport.h"
+
+/*********************************************
+ * Allocation time and fragmentation of the MemMang heaps,
+ * replaying the same allocation traces against heap_2,
+ * heap_4, heap_5 and heap_6 (the size class allocator)
+ *
+ * The traces are replayed before the scheduler starts, so
+ * the heap - the chapters' 15KB - holds nothing but the
+ * trace, and no tick lands inside a timing.  They run one
+ * after another on the same heap, the way an application's
+ * phases would, so heap_2 starts each one on whatever the
+ * last left behind.
+ *
+ * Built in traces, generated from a fixed seed so every heap
+ * replays the same operations:
+ * network  Ethernet frame buffers, mostly full sized with
+ *          some small ones, freed oldest first with up to 6
+ *          in flight
+ * mqtt     32 to 512 byte packets freed in random order, and
+ *          session objects that stay allocated for a long time
+ * json     16 to 256 byte parser scratch freed in reverse
+ *          order, with each document's result kept until 8
+ *          documents later
+ * mixed    all three interleaved - more than the heap holds,
+ *          so how many allocations fail depends on how well
+ *          the heap has kept its free space together
+ * scatter  240 small blocks with every other one freed, then
+ *          allocations too large for any of the gaps - the
+ *          worst case for a first fit search of the free list
+ * A trace file can be replayed instead, one operation per
+ * line, ids below MAX_IDS:
+ *   a <id> <size>   allocate <size> bytes as allocation <id>
+ *   f <id>          free allocation <id>
+ *
+ * failed          allocations that returned NULL (the trace's
+ *                 free of that id is then skipped)
+ * malloc_ns/malloc_p99_ns/malloc_max_ns, and the same for
+ *                 free  mean, 99th percentile and longest time
+ *                 per call.  The host can preempt any call, so
+ *                 the max columns are noisy
+ * baseline_ns     the same timing around just
+ *                 vTaskSuspendAll()/xTaskResumeAll(), which
+ *                 every call makes - the Posix port masks
+ *                 signals with a system call in between, which
+ *                 the target doesn't pay for
+ * end_free        free bytes at the end of the trace, before
+ *                 its remaining allocations are freed
+ * end_largest     the largest allocation that then succeeds
+ * frag_pct        100 * (1 - end_largest / end_free)
+ *
+ * usage: benchHeapAllocators_<heap> [operations per trace] [trace file]
+ *********************************************/
+
+#define DEFAULT_OPS 20000
+#define MAX_OPS 200000
+#define MAX_IDS 4096
+#define MAX_TRACES 5
+#define BASELINE_SAMPLES 10000
+
+#ifndef HEAP_NAME
+#define HEAP_NAME "unknown"
+#endif
+
+typedef struct
+{
+	uint8_t Free;
+	uint16_t Id;
+	uint32_t Size;
+}Op_t;
+
+typedef struct
+{
+	const char* Name;
+	Op_t* Ops;
+	uint32_t NumOps;
+}Trace_t;
+
+typedef struct
+{
+	uint32_t Count;
+	uint64_t TotalNs;
+	uint32_t* Ns;
+}Timings_t;
+
+typedef struct
+{
+	uint32_t Failed;
+	Timings_t Malloc;
+	Timings_t Free;
+	size_t EndFree;
+	size_t EndLargest;
+}Result_t;
+
+#if defined(HEAP_USES_REGIONS) && (HEAP_USES_REGIONS == 1)
+static uint8_t heapRegion[configTOTAL_HEAP_SIZE];
+#endif
+
+static Trace_t traces[MAX_TRACES];
+static uint32_t numTraces = 0;
+static void* allocations[MAX_IDS];
+static uint32_t mallocNs[MAX_OPS];
+static uint32_t freeNs[MAX_OPS];
+static uint32_t baselineNs[BASELINE_SAMPLES];
+
+static uint32_t random32( uint32_t* State )
+{
+	//xorshift32
+	*State ^= *State << 13;
+	*State ^= *State >> 17;
+	*State ^= *State << 5;
+	return *State;
+}
+
+/**
+ * between Min and Max inclusive
+ */
+static uint32_t randomRange( uint32_t* State, uint32_t Min, uint32_t Max )
+{
+	return Min + random32(State) % (Max - Min + 1);
+}
+
+static void addOp( Trace_t* Trace, uint8_t Free, uint32_t Id, uint32_t Size )
+{
+	Op_t* op = &Trace->Ops[Trace->NumOps++];
+
+	op->Free = Free;
+	op->Id = (uint16_t)Id;
+	op->Size = Size;
+}
+
+/*
+ * The generators add one operation per call.  Each owns a
+ * range of ids, so mixed can interleave them.
+ */
+#define NETWORK_ID_BASE 0
+#define NETWORK_IN_FLIGHT 6
+#define MQTT_ID_BASE 64
+#define MQTT_PACKETS 16
+#define MQTT_SESSIONS 4
+#define JSON_ID_BASE 128
+#define JSON_DEPTH 8
+#define JSON_RESULTS 8
+#define SCATTER_ID_BASE 256
+#define SCATTER_BLOCKS 240
+
+typedef struct
+{
+	uint32_t Random;
+	//network - a FIFO of frame ids
+	uint32_t NetHead;
+	uint32_t NetCount;
+	//mqtt - live packets and sessions, with the op each session ends on
+	uint8_t PacketLive[MQTT_PACKETS];
+	uint32_t NumPackets;
+	uint32_t SessionEnd[MQTT_SESSIONS];
+	uint8_t SessionLive[MQTT_SESSIONS];
+	//json - the scratch stack and a ring of kept results
+	uint32_t Depth;
+	uint32_t ResultNext;
+	uint8_t ResultLive[JSON_RESULTS];
+	//scatter - how far through the setup it is
+	uint32_t ScatterNext;
+}Generator_t;
+
+static void networkStep( Generator_t* Gen, Trace_t* Trace )
+{
+	uint32_t slot;
+
+	if(Gen->NetCount == NETWORK_IN_FLIGHT || (Gen->NetCount > 0 && random32(&Gen->Random) % 2))
+	{
+		addOp(Trace, 1, NETWORK_ID_BASE + Gen->NetHead, 0);
+		Gen->NetHead = (Gen->NetHead + 1) % NETWORK_IN_FLIGHT;
+		Gen->NetCount--;
+	}
+	else
+	{
+		slot = (Gen->NetHead + Gen->NetCount) % NETWORK_IN_FLIGHT;
+		//mostly full frames, some ACK sized ones
+		addOp(Trace, 0, NETWORK_ID_BASE + slot,
+			  (random32(&Gen->Random) % 5) ? 1536 : randomRange(&Gen->Random, 64, 128));
+		Gen->NetCount++;
+	}
+}
+
+static void mqttStep( Generator_t* Gen, Trace_t* Trace )
+{
+	uint32_t i, slot;
+
+	//sessions come and go slowly
+	for(i = 0; i < MQTT_SESSIONS; i++)
+	{
+		if(Gen->SessionLive[i] && Trace->NumOps >= Gen->SessionEnd[i])
+		{
+			addOp(Trace, 1, MQTT_ID_BASE + MQTT_PACKETS + i, 0);
+			Gen->SessionLive[i] = 0;
+			return;
+		}
+	}
+	if(random32(&Gen->Random) % 100 == 0)
+	{
+		for(i = 0; i < MQTT_SESSIONS; i++)
+		{
+			if(!Gen->SessionLive[i])
+			{
+				addOp(Trace, 0, MQTT_ID_BASE + MQTT_PACKETS + i, randomRange(&Gen->Random, 96, 160));
+				Gen->SessionLive[i] = 1;
+				Gen->SessionEnd[i] = Trace->NumOps + randomRange(&Gen->Random, 1000, 4000);
+				return;
+			}
+		}
+	}
+
+	//packets are freed in any order
+	slot = random32(&Gen->Random) % MQTT_PACKETS;
+	if(Gen->PacketLive[slot] && (Gen->NumPackets == MQTT_PACKETS || random32(&Gen->Random) % 2))
+	{
+		addOp(Trace, 1, MQTT_ID_BASE + slot, 0);
+		Gen->PacketLive[slot] = 0;
+		Gen->NumPackets--;
+	}
+	else
+	{
+		for(i = 0; Gen->PacketLive[slot]; i++)
+		{
+			slot = (slot + 1) % MQTT_PACKETS;
+		}
+		//mostly small packets, a few large publishes
+		addOp(Trace, 0, MQTT_ID_BASE + slot,
+			  (random32(&Gen->Random) % 4) ? randomRange(&Gen->Random, 32, 128) : randomRange(&Gen->Random, 129, 512));
+		Gen->PacketLive[slot] = 1;
+		Gen->NumPackets++;
+	}
+}
+
+static void jsonStep( Generator_t* Gen, Trace_t* Trace )
+{
+	uint32_t result;
+
+	if(Gen->Depth < JSON_DEPTH && (Gen->Depth == 0 || random32(&Gen->Random) % 100 < 55))
+	{
+		addOp(Trace, 0, JSON_ID_BASE + Gen->Depth, randomRange(&Gen->Random, 16, 256));
+		Gen->Depth++;
+		return;
+	}
+
+	Gen->Depth--;
+	addOp(Trace, 1, JSON_ID_BASE + Gen->Depth, 0);
+	if(Gen->Depth == 0)
+	{
+		//the document is parsed, keep its result for a while
+		result = Gen->ResultNext;
+		Gen->ResultNext = (Gen->ResultNext + 1) % JSON_RESULTS;
+		if(Gen->ResultLive[result])
+		{
+			addOp(Trace, 1, JSON_ID_BASE + JSON_DEPTH + result, 0);
+		}
+		addOp(Trace, 0, JSON_ID_BASE + JSON_DEPTH + result, randomRange(&Gen->Random, 32, 128));
+		Gen->ResultLive[result] = 1;
+	}
+}
+
+static void scatterStep( Generator_t* Gen, Trace_t* Trace )
+{
+	if(Gen->ScatterNext < SCATTER_BLOCKS)
+	{
+		addOp(Trace, 0, SCATTER_ID_BASE + Gen->ScatterNext, randomRange(&Gen->Random, 16, 32));
+	}
+	else if(Gen->ScatterNext < SCATTER_BLOCKS * 3 / 2)
+	{
+		addOp(Trace, 1, SCATTER_ID_BASE + 2 * (Gen->ScatterNext - SCATTER_BLOCKS), 0);
+	}
+	else if(Gen->ScatterNext % 2)
+	{
+		addOp(Trace, 0, SCATTER_ID_BASE + SCATTER_BLOCKS, randomRange(&Gen->Random, 64, 256));
+	}
+	else
+	{
+		addOp(Trace, 1, SCATTER_ID_BASE + SCATTER_BLOCKS, 0);
+	}
+	Gen->ScatterNext++;
+}
+
+static void generateTrace( const char* Name, uint32_t NumOps, uint32_t Seed )
+{
+	Trace_t* trace = &traces[numTraces++];
+	Generator_t gen;
+
+	memset(&gen, 0, sizeof(gen));
+	gen.Random = Seed;
+	trace->Name = Name;
+	//a step adds at most 3 operations
+	trace->Ops = malloc((NumOps + 3) * sizeof(Op_t));
+	configASSERT(trace->Ops != NULL);
+
+	while(trace->NumOps < NumOps)
+	{
+		uint32_t which = strcmp(Name, "network") == 0 ? 0 :
+						 strcmp(Name, "mqtt") == 0 ? 1 :
+						 strcmp(Name, "json") == 0 ? 2 :
+						 strcmp(Name, "scatter") == 0 ? 3 : random32(&gen.Random) % 3;
+
+		switch(which)
+		{
+			case 0:
+				networkStep(&gen, trace);
+				break;
+			case 1:
+				mqttStep(&gen, trace);
+				break;
+			case 2:
+				jsonStep(&gen, trace);
+				break;
+			default:
+				scatterStep(&gen, trace);
+				break;
+		}
+	}
+}
+
+static void loadTrace( const char* Path )
+{
+	Trace_t* trace = &traces[numTraces++];
+	FILE* file = fopen(Path, "r");
+	char op;
+	unsigned long id, size;
+
+	configASSERT(file != NULL);
+	trace->Name = "file";
+	trace->Ops = malloc(MAX_OPS * sizeof(Op_t));
+	configASSERT(trace->Ops != NULL);
+
+	while(trace->NumOps < MAX_OPS && fscanf(file, " %c %lu", &op, &id) == 2)
+	{
+		configASSERT(id < MAX_IDS);
+		if(op == 'a')
+		{
+			configASSERT(fscanf(file, "%lu", &size) == 1);
+			addOp(trace, 0, id, (uint32_t)size);
+		}
+		else
+		{
+			addOp(trace, 1, id, 0);
+		}
+	}
+	fclose(file);
+}
+
+static void addTiming( Timings_t* Timings, uint64_t Ns )
+{
+	Timings->TotalNs += Ns;
+	Timings->Ns[Timings->Count++] = (uint32_t)Ns;
+}
+
+static int compareNs( const void* A, const void* B )
+{
+	uint32_t a = *(const uint32_t*)A, b = *(const uint32_t*)B;
+
+	return (a > b) - (a < b);
+}
+
+/**
+ * sorts the timings, Percent 100 is the longest
+ */
+static uint32_t percentile( Timings_t* Timings, uint32_t Percent )
+{
+	if(Timings->Count == 0)
+	{
+		return 0;
+	}
+	qsort(Timings->Ns, Timings->Count, sizeof(uint32_t), compareNs);
+	return Timings->Ns[((uint64_t)Timings->Count - 1) * Percent / 100];
+}
+
+/**
+ * median cost of what every pvPortMalloc()/vPortFree() call
+ * does besides allocating, timed the same way
+ */
+static uint32_t baseline( void )
+{
+	Timings_t timings = { 0, 0, baselineNs };
+
+	for(uint32_t i = 0; i < BASELINE_SAMPLES; i++)
+	{
+		uint64_t start = HostTimeNs();
+
+		vTaskSuspendAll();
+		( void ) xTaskResumeAll();
+		addTiming(&timings, HostTimeNs() - start);
+	}
+	return percentile(&timings, 50);
+}
+
+/**
+ * bisect for the largest allocation the heap can still make
+ */
+static size_t largestAllocation( size_t FreeBytes )
+{
+	size_t low = 0, high = FreeBytes;
+
+	while(low < high)
+	{
+		size_t mid = low + (high - low + 1) / 2;
+		void* probe = pvPortMalloc(mid);
+
+		if(probe != NULL)
+		{
+			vPortFree(probe);
+			low = mid;
+		}
+		else
+		{
+			high = mid - 1;
+		}
+	}
+	return low;
+}
+
+static void replay( const Trace_t* Trace, Result_t* Result )
+{
+	memset(Result, 0, sizeof(*Result));
+	Result->Malloc.Ns = mallocNs;
+	Result->Free.Ns = freeNs;
+
+	for(uint32_t i = 0; i < Trace->NumOps; i++)
+	{
+		const Op_t* op = &Trace->Ops[i];
+		uint64_t start, elapsed;
+
+		if(!op->Free)
+		{
+			configASSERT(allocations[op->Id] == NULL);
+			start = HostTimeNs();
+			allocations[op->Id] = pvPortMalloc(op->Size);
+			elapsed = HostTimeNs() - start;
+
+			addTiming(&Result->Malloc, elapsed);
+			if(allocations[op->Id] == NULL)
+			{
+				Result->Failed++;
+			}
+			else
+			{
+				//touch it, as the application would
+				memset(allocations[op->Id], 0xA5, op->Size);
+			}
+		}
+		else if(allocations[op->Id] != NULL)
+		{
+			start = HostTimeNs();
+			vPortFree(allocations[op->Id]);
+			elapsed = HostTimeNs() - start;
+			allocations[op->Id] = NULL;
+
+			addTiming(&Result->Free, elapsed);
+		}
+	}
+
+	Result->EndFree = xPortGetFreeHeapSize();
+	Result->EndLargest = largestAllocation(Result->EndFree);
+
+	for(uint32_t i = 0; i < MAX_IDS; i++)
+	{
+		vPortFree(allocations[i]);
+		allocations[i] = NULL;
+	}
+}
+
+int main( int argc, char* argv[] )
+{
+	uint32_t numOps = DEFAULT_OPS;
+	uint32_t baselineMedianNs;
+	Result_t result;
+
+	if(argc > 1)
+	{
+		numOps = (uint32_t)strtoul(argv[1], NULL, 0);
+		configASSERT(numOps <= MAX_OPS);
+	}
+	if(argc > 2)
+	{
+		loadTrace(argv[2]);
+	}
+	else
+	{
+		generateTrace("network", numOps, 1);
+		generateTrace("mqtt", numOps, 2);
+		generateTrace("json", numOps, 3);
+		generateTrace("mixed", numOps, 4);
+		generateTrace("scatter", numOps, 5);
+	}
+
+	#if defined(HEAP_USES_REGIONS) && (HEAP_USES_REGIONS == 1)
+	{
+		const HeapRegion_t regions[] = { { heapRegion, sizeof(heapRegion) }, { NULL, 0 } };
+
+		vPortDefineHeapRegions(regions);
+	}
+	#endif
+
+	baselineMedianNs = baseline();
+
+	printf("heap,trace,ops,failed,malloc_ns,malloc_p99_ns,malloc_max_ns,free_ns,free_p99_ns,free_max_ns,baseline_ns,end_free,end_largest,frag_pct\n");
+	for(uint32_t i = 0; i < numTraces; i++)
+	{
+		replay(&traces[i], &result);
+		printf("%s,%s,%lu,%lu,%.1f,%lu,%lu,%.1f,%lu,%lu,%lu,%lu,%lu,%.1f\n",
+				HEAP_NAME, traces[i].Name, (unsigned long)traces[i].NumOps, (unsigned long)result.Failed,
+				result.Malloc.Count ? (double)result.Malloc.TotalNs / result.Malloc.Count : 0.0,
+				(unsigned long)percentile(&result.Malloc, 99), (unsigned long)percentile(&result.Malloc, 100),
+				result.Free.Count ? (double)result.Free.TotalNs / result.Free.Count : 0.0,
+				(unsigned long)percentile(&result.Free, 99), (unsigned long)percentile(&result.Free, 100),
+				(unsigned long)baselineMedianNs, (unsigned long)result.EndFree, (unsigned long)result.EndLargest,
+				result.EndFree ? 100.0 * (1.0 - (double)result.EndLargest / result.EndFree) : 0.0);
+	}
+	return 0;
+}
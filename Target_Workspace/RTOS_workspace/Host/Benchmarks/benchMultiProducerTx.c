@@ -0,0 +1,409 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2019 Brian Amos
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <semphr.h>
+#include <stream_buffer.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "HostSupport.h"
+#include "MultiProducerRing.h"
+
+/*********************************************
+ * VirtualCommDriverMultiTask TX path under contention:
+ * mutex + stream buffer vs. lock free multi-producer ring
+ *
+ * mutex:     TransmitUsbData as it was - take vcom_mutexPtr,
+ *            xStreamBufferSend, give the mutex
+ * lock_free: MpRingSend (VCOM_MULTI_PRODUCER_TX)
+ *
+ * N "logger" tasks (tskIDLE_PRIORITY + 1) send fixed length
+ * messages back to back, while a "telemetry" task
+ * (tskIDLE_PRIORITY + 3) sends a 16 byte message every tick -
+ * the case the mutex hurts most, since telemetry has to wait
+ * for whichever logger holds the mutex.  A stand in for
+ * usbTxTask (tskIDLE_PRIORITY + 2) drains the buffer with
+ * the peek/consume API and checks that every message arrives
+ * whole, in order for its sender.
+ *
+ * Each message is [sender id][sequence][length (2 bytes)]
+ * followed by a payload derived from the first three.
+ *
+ * Reports throughput and the worst case time spent in a single
+ * send call, for the loggers and for the telemetry task.
+ *
+ * usage: benchMultiProducerTx [ticksPerRun]
+ *********************************************/
+
+#define STACK_SIZE 256
+#define TX_BUFF_LEN 1024
+#define HEADER_LEN 4
+#define TELEMETRY_LEN 16
+#define TELEMETRY_ID 0xFF
+#define MAX_LOGGERS 8
+#define DEFAULT_TICKS_PER_RUN 1000
+
+static const uint32_t numLoggersList[] = { 1, 2, 4, 8 };
+static const size_t msgLens[] = { 16, 64, 256 };
+#define NUM_LOGGER_COUNTS (sizeof(numLoggersList)/sizeof(numLoggersList[0]))
+#define NUM_MSG_LENS (sizeof(msgLens)/sizeof(msgLens[0]))
+
+typedef enum
+{
+	MODE_MUTEX = 0,
+	MODE_LOCK_FREE,
+	NUM_MODES
+}BenchMode_t;
+
+static const char* modeNames[NUM_MODES] = { "mutex", "lock_free" };
+
+typedef struct
+{
+	uint64_t Bytes;
+	uint64_t Messages;
+	uint64_t ElapsedNs;
+	uint64_t LoggerMaxNs;
+	uint64_t TelemetryMaxNs;
+}RunResult_t;
+
+static RunResult_t results[NUM_MODES][NUM_LOGGER_COUNTS][NUM_MSG_LENS];
+
+static StreamBufferHandle_t txStream = NULL;
+static SemaphoreHandle_t txMutex = NULL;
+static uint8_t txStorage[TX_BUFF_LEN];
+static MpRing_t txRing;
+
+static TaskHandle_t controlTaskHandle = NULL;
+static BenchMode_t currentMode;
+static size_t currentMsgLen;
+static volatile bool stopSending;
+static volatile uint64_t bytesSent;
+static volatile uint64_t bytesReceived;
+static volatile uint64_t messagesReceived;
+static volatile bool dataCorrupt = false;
+static uint64_t loggerMaxNs[MAX_LOGGERS];
+static uint64_t telemetryMaxNs;
+
+void loggerTask( void* Id );
+void telemetryTask( void* NotUsed );
+void usbTxTask( void* NotUsed );
+void controlTask( void* NotUsed );
+
+int main( int argc, char* argv[] )
+{
+	TickType_t ticksPerRun = DEFAULT_TICKS_PER_RUN;
+
+	if(argc > 1)
+	{
+		ticksPerRun = (TickType_t)strtoul(argv[1], NULL, 0);
+	}
+
+	txMutex = xSemaphoreCreateMutex();
+	configASSERT(txMutex != NULL);
+	configASSERT(xTaskCreate(controlTask, "control", STACK_SIZE, (void*)(uintptr_t)ticksPerRun,
+							tskIDLE_PRIORITY + 4, &controlTaskHandle) == pdPASS);
+
+	vTaskStartScheduler();
+
+	printf("mode,loggers,msg_len,bytes,messages,MBps,logger_max_send_us,telemetry_max_send_us\n");
+	for(size_t n = 0; n < NUM_LOGGER_COUNTS; n++)
+	{
+		for(size_t i = 0; i < NUM_MSG_LENS; i++)
+		{
+			for(int mode = 0; mode < NUM_MODES; mode++)
+			{
+				RunResult_t const* result = &results[mode][n][i];
+
+				printf("%s,%u,%zu,%llu,%llu,%.1f,%.1f,%.1f\n", modeNames[mode],
+						(unsigned)numLoggersList[n], msgLens[i],
+						(unsigned long long)result->Bytes,
+						(unsigned long long)result->Messages,
+						(double)result->Bytes / ((double)result->ElapsedNs / 1e9) / (1024.0 * 1024.0),
+						(double)result->LoggerMaxNs / 1e3,
+						(double)result->TelemetryMaxNs / 1e3);
+			}
+		}
+	}
+
+	if(dataCorrupt)
+	{
+		fprintf(stderr, "data corrupted in transit\n");
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * runs each logger count/message length/mode combination in turn
+ */
+void controlTask( void* TicksPerRun )
+{
+	TickType_t ticksPerRun = (TickType_t)(uintptr_t)TicksPerRun;
+	TaskHandle_t loggers[MAX_LOGGERS], telemetry, consumer;
+
+	for(size_t n = 0; n < NUM_LOGGER_COUNTS; n++)
+	{
+		for(size_t i = 0; i < NUM_MSG_LENS; i++)
+		{
+			for(int mode = 0; mode < NUM_MODES; mode++)
+			{
+				RunResult_t* result = &results[mode][n][i];
+				uint32_t numLoggers = numLoggersList[n];
+				uint64_t start;
+
+				currentMode = (BenchMode_t)mode;
+				currentMsgLen = msgLens[i];
+				stopSending = false;
+				bytesSent = bytesReceived = messagesReceived = 0;
+				memset(loggerMaxNs, 0, sizeof(loggerMaxNs));
+				telemetryMaxNs = 0;
+				//the consumer is deleted while it's blocked on the previous
+				//run's buffer, so both buffers are recreated rather than reset
+				if(txStream != NULL)
+				{
+					vStreamBufferDelete(txStream);
+					vEventGroupDelete(txRing.Events);
+				}
+				txStream = xStreamBufferCreate(TX_BUFF_LEN, 1);
+				configASSERT(txStream != NULL);
+				MpRingInit(&txRing, txStorage, TX_BUFF_LEN);
+
+				start = HostTimeNs();
+				configASSERT(xTaskCreate(usbTxTask, "usbTx", STACK_SIZE, NULL, tskIDLE_PRIORITY + 2, &consumer) == pdPASS);
+				configASSERT(xTaskCreate(telemetryTask, "telemetry", STACK_SIZE, NULL, tskIDLE_PRIORITY + 3, &telemetry) == pdPASS);
+				for(uint32_t id = 0; id < numLoggers; id++)
+				{
+					configASSERT(xTaskCreate(loggerTask, "logger", STACK_SIZE, (void*)(uintptr_t)id,
+											tskIDLE_PRIORITY + 1, &loggers[id]) == pdPASS);
+				}
+
+				vTaskDelay(ticksPerRun);
+
+				//every sender notifies once it has stopped, then wait
+				//for the consumer to drain what they sent
+				stopSending = true;
+				for(uint32_t j = 0; j < numLoggers + 1; j++)
+				{
+					ulTaskNotifyTake(pdFALSE, portMAX_DELAY);
+				}
+				while(bytesReceived != bytesSent)
+				{
+					vTaskDelay(1);
+				}
+
+				result->ElapsedNs = HostTimeNs() - start;
+				result->Bytes = bytesReceived;
+				result->Messages = messagesReceived;
+				result->TelemetryMaxNs = telemetryMaxNs;
+				result->LoggerMaxNs = 0;
+				for(uint32_t id = 0; id < numLoggers; id++)
+				{
+					if(loggerMaxNs[id] > result->LoggerMaxNs)
+					{
+						result->LoggerMaxNs = loggerMaxNs[id];
+					}
+					vTaskDelete(loggers[id]);
+				}
+				vTaskDelete(telemetry);
+				vTaskDelete(consumer);
+				//give the idle task a chance to clean up the deleted tasks
+				vTaskDelay(2);
+			}
+		}
+	}
+
+	vTaskEndScheduler();
+}
+
+/**
+ * TransmitUsbData, in whichever mode is being measured
+ * @returns time spent in the call, in nS
+ */
+static uint64_t send( uint8_t const* Msg, size_t Len )
+{
+	uint64_t start = HostTimeNs();
+	size_t sent = 0;
+
+	if(currentMode == MODE_MUTEX)
+	{
+		if(xSemaphoreTake(txMutex, portMAX_DELAY) == pdPASS)
+		{
+			sent = xStreamBufferSend(txStream, Msg, Len, portMAX_DELAY);
+			xSemaphoreGive(txMutex);
+		}
+	}
+	else
+	{
+		sent = MpRingSend(&txRing, Msg, Len, portMAX_DELAY);
+	}
+	configASSERT(sent == Len);
+
+	//updated by tasks with different priorities
+	__atomic_add_fetch(&bytesSent, Len, __ATOMIC_RELAXED);
+	return HostTimeNs() - start;
+}
+
+static uint8_t payloadByte( uint8_t Id, uint8_t Seq, size_t Index )
+{
+	return (uint8_t)(Id * 31 + Seq + Index);
+}
+
+static void buildMsg( uint8_t* Msg, uint8_t Id, uint8_t Seq, size_t Len )
+{
+	Msg[0] = Id;
+	Msg[1] = Seq;
+	Msg[2] = (uint8_t)Len;
+	Msg[3] = (uint8_t)(Len >> 8);
+	for(size_t i = HEADER_LEN; i < Len; i++)
+	{
+		Msg[i] = payloadByte(Id, Seq, i);
+	}
+}
+
+void loggerTask( void* Id )
+{
+	uint8_t id = (uint8_t)(uintptr_t)Id;
+	uint8_t msg[256];
+	uint8_t seq = 0;
+
+	while(!stopSending)
+	{
+		uint64_t elapsed;
+
+		buildMsg(msg, id, seq++, currentMsgLen);
+		elapsed = send(msg, currentMsgLen);
+		if(elapsed > loggerMaxNs[id])
+		{
+			loggerMaxNs[id] = elapsed;
+		}
+	}
+
+	xTaskNotifyGive(controlTaskHandle);
+	vTaskSuspend(NULL);
+}
+
+void telemetryTask( void* NotUsed )
+{
+	uint8_t msg[TELEMETRY_LEN];
+	uint8_t seq = 0;
+	TickType_t lastWake = xTaskGetTickCount();
+
+	while(!stopSending)
+	{
+		uint64_t elapsed;
+
+		buildMsg(msg, TELEMETRY_ID, seq++, TELEMETRY_LEN);
+		elapsed = send(msg, TELEMETRY_LEN);
+		if(elapsed > telemetryMaxNs)
+		{
+			telemetryMaxNs = elapsed;
+		}
+		vTaskDelayUntil(&lastWake, 1);
+	}
+
+	xTaskNotifyGive(controlTaskHandle);
+	vTaskSuspend(NULL);
+}
+
+static uint8_t header[HEADER_LEN];
+static size_t headerPos, msgLen;
+static uint8_t expectedSeq[256];
+
+/**
+ * checks the stream one byte at a time - every message must arrive
+ * whole, and each sender's messages in sequence
+ */
+static void checkBytes( uint8_t const* Data, size_t Len )
+{
+	size_t pos = headerPos;
+
+	for(size_t i = 0; i < Len; i++)
+	{
+		if(pos < HEADER_LEN)
+		{
+			header[pos] = Data[i];
+			if(pos == HEADER_LEN - 1)
+			{
+				msgLen = header[2] | ((size_t)header[3] << 8);
+				if(header[1] != expectedSeq[header[0]]++ || msgLen < HEADER_LEN ||
+					msgLen != (header[0] == TELEMETRY_ID ? TELEMETRY_LEN : currentMsgLen))
+				{
+					dataCorrupt = true;
+				}
+			}
+		}
+		else if(Data[i] != payloadByte(header[0], header[1], pos))
+		{
+			dataCorrupt = true;
+		}
+
+		if(++pos == msgLen && pos >= HEADER_LEN)
+		{
+			pos = 0;
+			messagesReceived++;
+		}
+	}
+	headerPos = pos;
+}
+
+/**
+ * stands in for usbTxTask - transmits straight out of the buffer
+ */
+void usbTxTask( void* NotUsed )
+{
+	headerPos = 0;
+	memset(expectedSeq, 0, sizeof(expectedSeq));
+
+	while(1)
+	{
+		StreamBufferSpans_t spans;
+		size_t numBytes;
+
+		if(currentMode == MODE_MUTEX)
+		{
+			numBytes = xStreamBufferPeek(txStream, &spans, TX_BUFF_LEN, portMAX_DELAY);
+		}
+		else
+		{
+			numBytes = MpRingPeek(&txRing, &spans, portMAX_DELAY);
+		}
+
+		checkBytes(spans.pucFirst, spans.xFirstLength);
+		checkBytes(spans.pucSecond, spans.xSecondLength);
+
+		if(currentMode == MODE_MUTEX)
+		{
+			xStreamBufferConsume(txStream, numBytes);
+		}
+		else
+		{
+			MpRingConsume(&txRing, numBytes);
+		}
+		bytesReceived += numBytes;
+	}
+}
@@ -0,0 +1,536 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2019 Brian Amos
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <queue.h>
+#include <semphr.h>
+#include <event_groups.h>
+#include <stream_buffer.h>
+#include <message_buffer.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "HostSupport.h"
+
+/*********************************************
+ * Cost of each of the kernel's signaling primitives
+ *
+ * For each primitive:
+ * op:    a give/take (send/receive...) pair by a single task
+ *        that never blocks - the cost of the calls themselves
+ * task:  round trip between two tasks.  The "responder"
+ *        (tskIDLE_PRIORITY + 3) waits on channel 0 and
+ *        signals channel 1, the "initiator"
+ *        (tskIDLE_PRIORITY + 1) signals channel 0 and waits on
+ *        channel 1 - two context switches per round trip.
+ *        switch_ns is what's left of half a round trip once
+ *        the op cost is taken out
+ * isr:   a simulated interrupt - a low priority task signals
+ *        with the FromISR API with interrupts disabled, then
+ *        portYIELD_FROM_ISR's to the "handler" task
+ *        (tskIDLE_PRIORITY + 3) waiting on channel 0.
+ *        latency is from the FromISR call to the handler
+ *        running, cycle is the whole signal/handle/block loop
+ *
+ * Task notifications are measured both as a lightweight
+ * binary semaphore (xTaskNotifyGive/ulTaskNotifyTake) and as
+ * lightweight event flags (xTaskNotify eSetBits/xTaskNotifyWait).
+ *
+ * Mutexes can't be given from an ISR and can only be given by
+ * their holder, so their task round trip is a contended
+ * handoff: the initiator holds the mutex and notifies the
+ * responder, which blocks on the mutex (raising the initiator's
+ * priority) until the initiator gives it - four context
+ * switches and a notification per round trip.
+ *
+ * Built against both kernel trees (benchPrimitives and
+ * benchPrimitives_v202012), the kernel column tells the
+ * results apart.
+ *
+ * usage: benchPrimitives [iterations] [--json]
+ *********************************************/
+
+#define STACK_SIZE 256
+#define DEFAULT_ITERATIONS 20000
+#define MSG_LEN sizeof(uint32_t)
+
+typedef enum
+{
+	PRIM_BINARY_SEMAPHORE = 0,
+	PRIM_MUTEX,
+	PRIM_QUEUE,
+	PRIM_STREAM_BUFFER,
+	PRIM_MESSAGE_BUFFER,
+	PRIM_EVENT_GROUP,
+	PRIM_NOTIFY_GIVE,
+	PRIM_NOTIFY_BITS,
+	NUM_PRIMITIVES
+}Primitive_t;
+
+static const char* primitiveNames[NUM_PRIMITIVES] =
+{
+	"binary_semaphore", "mutex", "queue", "stream_buffer",
+	"message_buffer", "event_group", "notify_give", "notify_bits"
+};
+
+typedef struct
+{
+	double OpNs;
+	double RoundTripNs;
+	double SwitchNs;
+	double IsrLatencyNs;
+	double IsrCycleNs;
+}Result_t;
+
+static Result_t results[NUM_PRIMITIVES];
+static uint32_t iterations;
+static Primitive_t currentPrim;
+
+static TaskHandle_t controlTaskHandle = NULL;
+//the task waiting on each channel (for the notification primitives)
+static TaskHandle_t channelTasks[2];
+
+static SemaphoreHandle_t semaphores[2];
+static QueueHandle_t queues[2];
+static StreamBufferHandle_t streams[2];
+static EventGroupHandle_t events;
+
+static uint64_t roundTripNs;
+static volatile uint64_t isrSignalNs;
+static uint64_t isrLatencyTotalNs;
+static uint64_t isrCycleNs;
+
+static void controlTask( void* NotUsed );
+static void printResults( int Json );
+
+int main( int argc, char* argv[] )
+{
+	int json = 0;
+
+	iterations = DEFAULT_ITERATIONS;
+	for(int i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "--json") == 0)
+		{
+			json = 1;
+		}
+		else
+		{
+			iterations = (uint32_t)strtoul(argv[i], NULL, 0);
+		}
+	}
+
+	configASSERT(xTaskCreate(controlTask, "control", STACK_SIZE, NULL, tskIDLE_PRIORITY + 4, &controlTaskHandle) == pdPASS);
+
+	vTaskStartScheduler();
+
+	printResults(json);
+	return 0;
+}
+
+static void createObjects( void )
+{
+	for(int i = 0; i < 2; i++)
+	{
+		switch(currentPrim)
+		{
+			case PRIM_BINARY_SEMAPHORE:
+				semaphores[i] = xSemaphoreCreateBinary();
+				configASSERT(semaphores[i] != NULL);
+			break;
+			case PRIM_MUTEX:
+				semaphores[i] = xSemaphoreCreateMutex();
+				configASSERT(semaphores[i] != NULL);
+			break;
+			case PRIM_QUEUE:
+				queues[i] = xQueueCreate(1, MSG_LEN);
+				configASSERT(queues[i] != NULL);
+			break;
+			case PRIM_STREAM_BUFFER:
+				streams[i] = xStreamBufferCreate(4 * MSG_LEN, MSG_LEN);
+				configASSERT(streams[i] != NULL);
+			break;
+			case PRIM_MESSAGE_BUFFER:
+				streams[i] = xMessageBufferCreate(4 * (MSG_LEN + sizeof(size_t)));
+				configASSERT(streams[i] != NULL);
+			break;
+			default:
+			break;
+		}
+	}
+	if(currentPrim == PRIM_EVENT_GROUP)
+	{
+		events = xEventGroupCreate();
+		configASSERT(events != NULL);
+	}
+}
+
+static void deleteObjects( void )
+{
+	for(int i = 0; i < 2; i++)
+	{
+		switch(currentPrim)
+		{
+			case PRIM_BINARY_SEMAPHORE:
+			case PRIM_MUTEX:
+				vSemaphoreDelete(semaphores[i]);
+			break;
+			case PRIM_QUEUE:
+				vQueueDelete(queues[i]);
+			break;
+			case PRIM_STREAM_BUFFER:
+			case PRIM_MESSAGE_BUFFER:
+				vStreamBufferDelete(streams[i]);
+			break;
+			default:
+			break;
+		}
+	}
+	if(currentPrim == PRIM_EVENT_GROUP)
+	{
+		vEventGroupDelete(events);
+	}
+}
+
+/**
+ * give/send/set/notify on Channel
+ */
+static void signalChannel( int Channel )
+{
+	uint32_t msg = 0;
+
+	switch(currentPrim)
+	{
+		case PRIM_BINARY_SEMAPHORE:
+		case PRIM_MUTEX:
+			xSemaphoreGive(semaphores[Channel]);
+		break;
+		case PRIM_QUEUE:
+			configASSERT(xQueueSend(queues[Channel], &msg, portMAX_DELAY) == pdPASS);
+		break;
+		case PRIM_STREAM_BUFFER:
+			configASSERT(xStreamBufferSend(streams[Channel], &msg, MSG_LEN, portMAX_DELAY) == MSG_LEN);
+		break;
+		case PRIM_MESSAGE_BUFFER:
+			configASSERT(xMessageBufferSend(streams[Channel], &msg, MSG_LEN, portMAX_DELAY) == MSG_LEN);
+		break;
+		case PRIM_EVENT_GROUP:
+			xEventGroupSetBits(events, 1 << Channel);
+		break;
+		case PRIM_NOTIFY_GIVE:
+			xTaskNotifyGive(channelTasks[Channel]);
+		break;
+		case PRIM_NOTIFY_BITS:
+			xTaskNotify(channelTasks[Channel], 1 << Channel, eSetBits);
+		break;
+		default:
+		break;
+	}
+}
+
+/**
+ * take/receive/wait on Channel
+ * @returns pdPASS if the channel was signaled
+ */
+static BaseType_t waitChannel( int Channel, TickType_t TicksToWait )
+{
+	uint32_t msg;
+	BaseType_t ret = pdFAIL;
+
+	switch(currentPrim)
+	{
+		case PRIM_BINARY_SEMAPHORE:
+		case PRIM_MUTEX:
+			ret = xSemaphoreTake(semaphores[Channel], TicksToWait);
+		break;
+		case PRIM_QUEUE:
+			ret = xQueueReceive(queues[Channel], &msg, TicksToWait);
+		break;
+		case PRIM_STREAM_BUFFER:
+			ret = xStreamBufferReceive(streams[Channel], &msg, MSG_LEN, TicksToWait) == MSG_LEN;
+		break;
+		case PRIM_MESSAGE_BUFFER:
+			ret = xMessageBufferReceive(streams[Channel], &msg, MSG_LEN, TicksToWait) == MSG_LEN;
+		break;
+		case PRIM_EVENT_GROUP:
+			ret = (xEventGroupWaitBits(events, 1 << Channel, pdTRUE, pdFALSE, TicksToWait) & (1 << Channel)) != 0;
+		break;
+		case PRIM_NOTIFY_GIVE:
+			ret = ulTaskNotifyTake(pdTRUE, TicksToWait) != 0;
+		break;
+		case PRIM_NOTIFY_BITS:
+			ret = xTaskNotifyWait(0, 1 << Channel, &msg, TicksToWait);
+		break;
+		default:
+		break;
+	}
+	return ret;
+}
+
+/**
+ * signal Channel the way an interrupt handler would
+ */
+static void signalFromISR( int Channel )
+{
+	BaseType_t woken = pdFALSE;
+	uint32_t msg = 0;
+
+	//portSET_INTERRUPT_MASK_FROM_ISR is a no-op on the Posix port
+	//(signal handlers already run masked), so mask the tick here
+	//or it can land in the middle of a ready list update
+	portDISABLE_INTERRUPTS();
+	switch(currentPrim)
+	{
+		case PRIM_BINARY_SEMAPHORE:
+			xSemaphoreGiveFromISR(semaphores[Channel], &woken);
+		break;
+		case PRIM_QUEUE:
+			configASSERT(xQueueSendFromISR(queues[Channel], &msg, &woken) == pdPASS);
+		break;
+		case PRIM_STREAM_BUFFER:
+			configASSERT(xStreamBufferSendFromISR(streams[Channel], &msg, MSG_LEN, &woken) == MSG_LEN);
+		break;
+		case PRIM_MESSAGE_BUFFER:
+			configASSERT(xMessageBufferSendFromISR(streams[Channel], &msg, MSG_LEN, &woken) == MSG_LEN);
+		break;
+		case PRIM_EVENT_GROUP:
+			//deferred to the timer service task
+			configASSERT(xEventGroupSetBitsFromISR(events, 1 << Channel, &woken) == pdPASS);
+		break;
+		case PRIM_NOTIFY_GIVE:
+			vTaskNotifyGiveFromISR(channelTasks[Channel], &woken);
+		break;
+		case PRIM_NOTIFY_BITS:
+			xTaskNotifyFromISR(channelTasks[Channel], 1 << Channel, eSetBits, &woken);
+		break;
+		default:
+		break;
+	}
+	portENABLE_INTERRUPTS();
+	portYIELD_FROM_ISR(woken);
+}
+
+static void finished( void )
+{
+	xTaskNotifyGive(controlTaskHandle);
+	//wait to be deleted by the control task
+	vTaskSuspend(NULL);
+}
+
+static void responderTask( void* NotUsed )
+{
+	for(uint32_t i = 0; i < iterations; i++)
+	{
+		if(currentPrim == PRIM_MUTEX)
+		{
+			//the initiator holds the mutex when it notifies
+			ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+			configASSERT(xSemaphoreTake(semaphores[0], portMAX_DELAY) == pdPASS);
+			xSemaphoreGive(semaphores[0]);
+		}
+		else
+		{
+			configASSERT(waitChannel(0, portMAX_DELAY) == pdPASS);
+			signalChannel(1);
+		}
+	}
+	finished();
+}
+
+static void initiatorTask( void* NotUsed )
+{
+	uint64_t start = HostTimeNs();
+
+	for(uint32_t i = 0; i < iterations; i++)
+	{
+		if(currentPrim == PRIM_MUTEX)
+		{
+			configASSERT(xSemaphoreTake(semaphores[0], portMAX_DELAY) == pdPASS);
+			xTaskNotifyGive(channelTasks[0]);
+			xSemaphoreGive(semaphores[0]);
+		}
+		else
+		{
+			signalChannel(0);
+			configASSERT(waitChannel(1, portMAX_DELAY) == pdPASS);
+		}
+	}
+	roundTripNs = HostTimeNs() - start;
+	finished();
+}
+
+static void handlerTask( void* NotUsed )
+{
+	for(uint32_t i = 0; i < iterations; i++)
+	{
+		configASSERT(waitChannel(0, portMAX_DELAY) == pdPASS);
+		isrLatencyTotalNs += HostTimeNs() - isrSignalNs;
+	}
+	finished();
+}
+
+static void isrSourceTask( void* NotUsed )
+{
+	uint64_t start = HostTimeNs();
+
+	for(uint32_t i = 0; i < iterations; i++)
+	{
+		isrSignalNs = HostTimeNs();
+		signalFromISR(0);
+	}
+	isrCycleNs = HostTimeNs() - start;
+	finished();
+}
+
+/**
+ * runs the two tasks, waiting for both to finish
+ */
+static void runPair( TaskFunction_t High, TaskFunction_t Low )
+{
+	TaskHandle_t high, low;
+
+	createObjects();
+	configASSERT(xTaskCreate(High, "high", STACK_SIZE, NULL, tskIDLE_PRIORITY + 3, &high) == pdPASS);
+	configASSERT(xTaskCreate(Low, "low", STACK_SIZE, NULL, tskIDLE_PRIORITY + 1, &low) == pdPASS);
+	channelTasks[0] = high;
+	channelTasks[1] = low;
+
+	ulTaskNotifyTake(pdFALSE, portMAX_DELAY);
+	ulTaskNotifyTake(pdFALSE, portMAX_DELAY);
+
+	vTaskDelete(high);
+	vTaskDelete(low);
+	//give the idle task a chance to clean up the deleted tasks
+	vTaskDelay(2);
+	deleteObjects();
+}
+
+/**
+ * runs each primitive/mode combination in turn
+ */
+static void controlTask( void* NotUsed )
+{
+	for(int prim = 0; prim < NUM_PRIMITIVES; prim++)
+	{
+		Result_t* result = &results[prim];
+		uint64_t start;
+
+		currentPrim = (Primitive_t)prim;
+
+		//op - this task signals itself, so nothing ever blocks
+		createObjects();
+		channelTasks[0] = controlTaskHandle;
+		start = HostTimeNs();
+		for(uint32_t i = 0; i < iterations; i++)
+		{
+			if(currentPrim == PRIM_MUTEX)
+			{
+				waitChannel(0, 0);
+				signalChannel(0);
+			}
+			else
+			{
+				signalChannel(0);
+				configASSERT(waitChannel(0, 0) == pdPASS);
+			}
+		}
+		result->OpNs = (double)(HostTimeNs() - start) / iterations;
+		deleteObjects();
+
+		//task
+		runPair(responderTask, initiatorTask);
+		result->RoundTripNs = (double)roundTripNs / iterations;
+		result->SwitchNs = (result->RoundTripNs - 2 * result->OpNs) / 2;
+
+		//isr
+		if(currentPrim != PRIM_MUTEX)
+		{
+			isrLatencyTotalNs = 0;
+			runPair(handlerTask, isrSourceTask);
+			result->IsrLatencyNs = (double)isrLatencyTotalNs / iterations;
+			result->IsrCycleNs = (double)isrCycleNs / iterations;
+		}
+	}
+
+	//the mutex round trip is a take + give on each side, a notification
+	//and four switches
+	results[PRIM_MUTEX].SwitchNs = (results[PRIM_MUTEX].RoundTripNs - 2 * results[PRIM_MUTEX].OpNs -
+									results[PRIM_NOTIFY_GIVE].OpNs) / 4;
+
+	vTaskEndScheduler();
+}
+
+static void printResults( int Json )
+{
+	if(Json)
+	{
+		printf("{\n  \"kernel\": \"%s\",\n  \"iterations\": %lu,\n  \"results\": [\n",
+				tskKERNEL_VERSION_NUMBER, (unsigned long)iterations);
+	}
+	else
+	{
+		printf("kernel,primitive,iterations,op_ns,task_roundtrip_ns,task_switch_ns,isr_latency_ns,isr_cycle_ns\n");
+	}
+
+	for(int prim = 0; prim < NUM_PRIMITIVES; prim++)
+	{
+		Result_t const* result = &results[prim];
+		int hasIsr = (prim != PRIM_MUTEX);
+
+		if(Json)
+		{
+			printf("    { \"primitive\": \"%s\", \"op_ns\": %.1f, \"task_roundtrip_ns\": %.1f, \"task_switch_ns\": %.1f, ",
+					primitiveNames[prim], result->OpNs, result->RoundTripNs, result->SwitchNs);
+			if(hasIsr)
+			{
+				printf("\"isr_latency_ns\": %.1f, \"isr_cycle_ns\": %.1f }", result->IsrLatencyNs, result->IsrCycleNs);
+			}
+			else
+			{
+				printf("\"isr_latency_ns\": null, \"isr_cycle_ns\": null }");
+			}
+			printf("%s\n", prim < NUM_PRIMITIVES - 1 ? "," : "");
+		}
+		else
+		{
+			printf("%s,%s,%lu,%.1f,%.1f,%.1f,", tskKERNEL_VERSION_NUMBER, primitiveNames[prim],
+					(unsigned long)iterations, result->OpNs, result->RoundTripNs, result->SwitchNs);
+			if(hasIsr)
+			{
+				printf("%.1f,%.1f\n", result->IsrLatencyNs, result->IsrCycleNs);
+			}
+			else
+			{
+				printf(",\n");
+			}
+		}
+	}
+
+	if(Json)
+	{
+		printf("  ]\n}\n");
+	}
+}
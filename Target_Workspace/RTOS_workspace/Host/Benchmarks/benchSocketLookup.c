@@ -0,0 +1,208 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Brian Amos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <FreeRTOS_IP.h>
+#include <FreeRTOS_Sockets.h>
+#include <FreeRTOS_IP_Private.h>
+#include <linux_vswitch.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "HostIP.h"
+#include "HostSupport.h"
+
+/*********************************************
+ * Cost of matching a received TCP segment to its socket
+ * (pxTCPSocketLookup) against the number of sockets
+ *
+ * A single node on a port of the virtual switch opens a
+ * listening socket and then more and more client sockets,
+ * each connecting to a different peer that never answers,
+ * so they stay bound with a remote address.  At each step
+ * the lookups are timed with the IP task held off:
+ * hit:     the 4-tuple of a random client socket
+ * listen:  a SYN from an unknown peer to the listening
+ *          port, which falls through to the listener
+ *
+ * Built with the lists of bound sockets the stack walks by
+ * default (benchSocketLookup) and with ipconfigUSE_SOCKET_HASH
+ * (benchSocketLookup_hash), the demux column tells the
+ * results apart.  With the hash tables, the longest chain
+ * in the connection table and the sockets compared per hit
+ * come from FreeRTOS_GetSocketHashStats.
+ *
+ * usage: benchSocketLookup [max sockets] [lookups]
+ *********************************************/
+
+#define STACK_SIZE 512
+#define LISTEN_PORT 80
+#define PEER_PORT 5001
+#define DEFAULT_MAX_SOCKETS 512
+#define DEFAULT_LOOKUPS 100000
+
+#if ( ipconfigUSE_SOCKET_HASH == 1 )
+#define DEMUX_NAME "hash"
+#else
+#define DEMUX_NAME "list"
+#endif
+
+typedef struct
+{
+	Socket_t Socket;
+	uint16_t LocalPort;		//all in host order, as pxTCPSocketLookup takes them
+	uint32_t RemoteIP;
+}Client_t;
+
+static uint32_t maxSockets = DEFAULT_MAX_SOCKETS;
+static uint32_t lookups = DEFAULT_LOOKUPS;
+static char switchName[64];
+
+static void benchTask( void* NotUsed );
+
+int main( int argc, char* argv[] )
+{
+	uint8_t mac[ipMAC_ADDRESS_LENGTH_BYTES] = { 0x02, 0x00, 0x00, 0x00, 0x02, 0x00 };
+
+	if(argc > 1) maxSockets = (uint32_t)strtoul(argv[1], NULL, 0);
+	if(argc > 2) lookups = (uint32_t)strtoul(argv[2], NULL, 0);
+
+	//a switch with only this node on it - the SYNs and ARP requests go nowhere
+	snprintf(switchName, sizeof(switchName), "/benchSocketLookup.%d", (int)getpid());
+	configASSERT(xVSwitchCreate(switchName, 1, NULL) == pdPASS);
+	configASSERT(xVSwitchAttach(switchName, 0) == pdPASS);
+	configASSERT(HostIPStart(mac, FreeRTOS_inet_addr("10.30.0.1"), FreeRTOS_inet_addr("255.255.0.0")) == pdPASS);
+
+	//below the IP task, so it is never caught in the middle of changing the lists
+	configASSERT(xTaskCreate(benchTask, "bench", STACK_SIZE, NULL, tskIDLE_PRIORITY + 1, NULL) == pdPASS);
+	vTaskStartScheduler();
+	return 1;
+}
+
+/**
+ * time Count lookups - of random clients, or of unknown peers
+ * when Clients is NULL - with the scheduler suspended
+ * @returns ns per lookup
+ */
+static double timeLookups( const Client_t* Clients, uint32_t NumClients, Socket_t Listener )
+{
+	uint32_t seed = 1;
+	uint64_t start, elapsed;
+
+	vTaskSuspendAll();
+	start = HostTimeNs();
+	for(uint32_t i = 0; i < lookups; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		if(Clients != NULL)
+		{
+			const Client_t* client = &Clients[(seed >> 8) % NumClients];
+			configASSERT(pxTCPSocketLookup(0, client->LocalPort, client->RemoteIP, PEER_PORT) == (FreeRTOS_Socket_t*)client->Socket);
+		}
+		else
+		{
+			configASSERT(pxTCPSocketLookup(0, LISTEN_PORT, 0x0a1f0000UL | (seed >> 16), seed & 0xffff) == (FreeRTOS_Socket_t*)Listener);
+		}
+	}
+	elapsed = HostTimeNs() - start;
+	xTaskResumeAll();
+
+	return (double)elapsed / lookups;
+}
+
+static void benchTask( void* NotUsed )
+{
+	struct freertos_sockaddr addr = { 0 };
+	TickType_t noWait = 0;
+	Client_t* clients;
+	Socket_t listener;
+	uint32_t numClients = 0;
+	uint32_t step = 4;
+	double hitNs, listenNs;
+
+	configASSERT(HostIPWaitUp(pdMS_TO_TICKS(10000)));
+	clients = pvPortMalloc(maxSockets * sizeof(Client_t));
+	configASSERT(clients != NULL);
+
+	listener = FreeRTOS_socket(FREERTOS_AF_INET, FREERTOS_SOCK_STREAM, FREERTOS_IPPROTO_TCP);
+	configASSERT(listener != FREERTOS_INVALID_SOCKET);
+	addr.sin_port = FreeRTOS_htons(LISTEN_PORT);
+	configASSERT(FreeRTOS_bind(listener, &addr, sizeof(addr)) == 0);
+	configASSERT(FreeRTOS_listen(listener, 4) == 0);
+
+	printf("demux,sockets,hit_ns,listen_ns,longest_chain,compares_per_lookup\n");
+	while(numClients < maxSockets)
+	{
+		//open clients up to the next step, each to its own peer 10.30.x.y
+		while((numClients < step) && (numClients < maxSockets))
+		{
+			Client_t* client = &clients[numClients];
+			struct freertos_sockaddr peer = { 0 };
+
+			client->Socket = FreeRTOS_socket(FREERTOS_AF_INET, FREERTOS_SOCK_STREAM, FREERTOS_IPPROTO_TCP);
+			configASSERT(client->Socket != FREERTOS_INVALID_SOCKET);
+			FreeRTOS_setsockopt(client->Socket, 0, FREERTOS_SO_RCVTIMEO, &noWait, sizeof(noWait));
+			client->RemoteIP = 0x0a1e0100UL + numClients;
+			peer.sin_addr = FreeRTOS_htonl(client->RemoteIP);
+			peer.sin_port = FreeRTOS_htons(PEER_PORT);
+			configASSERT(FreeRTOS_connect(client->Socket, &peer, sizeof(peer)) == -pdFREERTOS_ERRNO_EWOULDBLOCK);
+			FreeRTOS_GetLocalAddress(client->Socket, &addr);
+			client->LocalPort = FreeRTOS_ntohs(addr.sin_port);
+			numClients++;
+		}
+
+		//let the IP task start the connects
+		vTaskDelay(pdMS_TO_TICKS(50));
+
+#if ( ipconfigUSE_SOCKET_HASH == 1 )
+		{
+			SocketHashStats_t before, after;
+
+			FreeRTOS_GetSocketHashStats(&before);
+			hitNs = timeLookups(clients, numClients, listener);
+			FreeRTOS_GetSocketHashStats(&after);
+			listenNs = timeLookups(NULL, 0, listener);
+			printf("%s,%lu,%.1f,%.1f,%lu,%.2f\n", DEMUX_NAME, (unsigned long)numClients + 1, hitNs, listenNs,
+					(unsigned long)after.uxConnectionLongestChain,
+					(double)(after.ulCompares - before.ulCompares) / (after.ulLookups - before.ulLookups));
+		}
+#else
+		hitNs = timeLookups(clients, numClients, listener);
+		listenNs = timeLookups(NULL, 0, listener);
+		printf("%s,%lu,%.1f,%.1f,,\n", DEMUX_NAME, (unsigned long)numClients + 1, hitNs, listenNs);
+#endif
+		step *= 4;
+	}
+
+	fflush(stdout);
+
+	//the IP task keeps running, so leave from here rather than ending the
+	//scheduler - with the interrupts off, for the network interface's task
+	//not to run once the switch is unmapped
+	taskENTER_CRITICAL();
+	vVSwitchDestroy(switchName);
+	exit(0);
+}
@@ -0,0 +1,307 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Brian Amos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <stream_buffer.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "HostSupport.h"
+
+/*********************************************
+ * Stream buffer throughput: copy API vs. zero copy API
+ *
+ * Models the highest rate path in the firmware - a
+ * producer (DMA/USB OUT) that delivers packet sized chunks
+ * and a consumer (usbTask) that hands the bytes to
+ * the USB peripheral.
+ *
+ * copy:      the "DMA" lands each packet in a local buffer,
+ *            then xStreamBufferSend copies it into the ring.
+ *            consumer xStreamBufferReceive's into a local
+ *            tx buffer, then "transmits" it
+ * zero copy: the "DMA" lands each packet straight into
+ *            xStreamBufferReserve'd spans, consumer "transmits"
+ *            straight out of xStreamBufferPeek'd spans
+ *
+ * Each combination is run twice: "inline", where a single
+ * task produces a packet then immediately consumes it (this
+ * isolates the per-byte cost of the data path, as seen when an
+ * ISR producer is drained by a consumer that keeps up) and
+ * "tasks", with a separate producer and consumer task (end to
+ * end, including the context switches, which dominate on the
+ * Posix port for small packets).
+ *
+ * "DMA" is a memcpy out of a pattern table and "transmitting"
+ * is a memcpy into a FIFO (which is what the USB OTG FS core
+ * actually requires of the CPU).  Every byte is checked on the
+ * way out so the benchmark also verifies the data made it
+ * across intact.
+ *
+ * usage: benchStreamBufferZeroCopy [totalKB]
+ *********************************************/
+
+#define STACK_SIZE 256
+#define STREAM_LEN 8192
+#define DEFAULT_TOTAL_KB (64 * 1024)
+
+static const size_t packetLens[] = { 16, 64, 256, 1024, 4096 };
+#define NUM_PACKET_LENS (sizeof(packetLens)/sizeof(packetLens[0]))
+#define MAX_PACKET_LEN 4096
+
+typedef enum
+{
+	MODE_COPY = 0,
+	MODE_ZERO_COPY,
+	NUM_MODES
+}BenchMode_t;
+
+typedef enum
+{
+	TOPOLOGY_INLINE = 0,
+	TOPOLOGY_TASKS,
+	NUM_TOPOLOGIES
+}BenchTopology_t;
+
+static const char* topologyNames[NUM_TOPOLOGIES] = { "inline", "tasks" };
+
+static StreamBufferHandle_t stream = NULL;
+static TaskHandle_t controlTaskHandle = NULL;
+static BenchMode_t currentMode;
+static size_t currentPacketLen;
+static size_t totalBytes;
+static volatile bool dataCorrupt = false;
+static uint64_t results[NUM_TOPOLOGIES][NUM_PACKET_LENS][NUM_MODES];
+
+//byte n of the stream is always (uint8_t)n, so any window of the stream
+//can be found in this table starting at offset (n & 0xFF)
+static uint8_t pattern[256 + STREAM_LEN];
+static uint8_t usbFifo[STREAM_LEN];
+
+void producerTask( void* NotUsed );
+void consumerTask( void* NotUsed );
+void controlTask( void* NotUsed );
+
+int main( int argc, char* argv[] )
+{
+	totalBytes = (size_t)DEFAULT_TOTAL_KB * 1024;
+	if(argc > 1)
+	{
+		totalBytes = (size_t)strtoul(argv[1], NULL, 0) * 1024;
+	}
+
+	for(size_t i = 0; i < sizeof(pattern); i++)
+	{
+		pattern[i] = (uint8_t)i;
+	}
+
+	stream = xStreamBufferCreate(STREAM_LEN, 1);
+	configASSERT(stream != NULL);
+	configASSERT(xTaskCreate(controlTask, "control", STACK_SIZE, NULL, tskIDLE_PRIORITY + 3, &controlTaskHandle) == pdPASS);
+
+	vTaskStartScheduler();
+
+	printf("topology,packet_len,bytes,copy_ns,zero_copy_ns,copy_MBps,zero_copy_MBps,speedup\n");
+	for(int topology = 0; topology < NUM_TOPOLOGIES; topology++)
+	{
+		for(size_t i = 0; i < NUM_PACKET_LENS; i++)
+		{
+			uint64_t const* elapsed = results[topology][i];
+			double mbps[NUM_MODES];
+
+			for(int mode = 0; mode < NUM_MODES; mode++)
+			{
+				mbps[mode] = (double)totalBytes / ((double)elapsed[mode] / 1e9) / (1024.0 * 1024.0);
+			}
+			printf("%s,%zu,%zu,%llu,%llu,%.1f,%.1f,%.2f\n", topologyNames[topology],
+					packetLens[i], totalBytes,
+					(unsigned long long)elapsed[MODE_COPY],
+					(unsigned long long)elapsed[MODE_ZERO_COPY],
+					mbps[MODE_COPY], mbps[MODE_ZERO_COPY],
+					(double)elapsed[MODE_COPY] / (double)elapsed[MODE_ZERO_COPY]);
+		}
+	}
+
+	if(dataCorrupt)
+	{
+		fprintf(stderr, "data corrupted in transit\n");
+		return 1;
+	}
+	return 0;
+}
+
+static void producePacket( size_t* Seq );
+static void consumeAvailable( size_t* Received, TickType_t TicksToWait );
+
+/**
+ * runs each topology/packet length/mode combination in turn
+ */
+void controlTask( void* NotUsed )
+{
+	TaskHandle_t producer, consumer;
+
+	for(size_t i = 0; i < NUM_PACKET_LENS; i++)
+	{
+		for(int mode = 0; mode < NUM_MODES; mode++)
+		{
+			uint64_t start;
+			size_t seq = 0, received = 0;
+
+			currentMode = (BenchMode_t)mode;
+			currentPacketLen = packetLens[i];
+
+			//inline - this task is both the producer and the consumer
+			configASSERT(xStreamBufferReset(stream) == pdPASS);
+			start = HostTimeNs();
+			while(received < totalBytes)
+			{
+				producePacket(&seq);
+				consumeAvailable(&received, 0);
+			}
+			results[TOPOLOGY_INLINE][i][mode] = HostTimeNs() - start;
+
+			//tasks - a fresh producer/consumer pair
+			configASSERT(xStreamBufferReset(stream) == pdPASS);
+			start = HostTimeNs();
+			configASSERT(xTaskCreate(consumerTask, "consumer", STACK_SIZE, NULL, tskIDLE_PRIORITY + 1, &consumer) == pdPASS);
+			configASSERT(xTaskCreate(producerTask, "producer", STACK_SIZE, NULL, tskIDLE_PRIORITY + 2, &producer) == pdPASS);
+
+			//the consumer notifies once every byte has been accounted for
+			ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+			results[TOPOLOGY_TASKS][i][mode] = HostTimeNs() - start;
+
+			vTaskDelete(producer);
+			vTaskDelete(consumer);
+			//give the idle task a chance to clean up the deleted tasks
+			vTaskDelay(2);
+		}
+	}
+
+	vTaskEndScheduler();
+}
+
+/**
+ * stands in for a DMA transfer landing Len bytes of the stream at Dst
+ */
+static void dmaReceive( uint8_t* Dst, size_t Len, size_t* Seq )
+{
+	memcpy(Dst, &pattern[*Seq & 0xFF], Len);
+	*Seq += Len;
+}
+
+/**
+ * stands in for the USB core draining Len bytes of the stream from Src
+ */
+static void usbTransmit( uint8_t const* Src, size_t Len, size_t* Seq )
+{
+	if(memcmp(Src, &pattern[*Seq & 0xFF], Len) != 0)
+	{
+		dataCorrupt = true;
+	}
+	memcpy(usbFifo, Src, Len);
+	*Seq += Len;
+}
+
+/**
+ * moves the next packet of the stream into the stream buffer
+ */
+static void producePacket( size_t* Seq )
+{
+	static uint8_t packet[MAX_PACKET_LEN];
+	size_t len = totalBytes - *Seq;
+
+	if(len > currentPacketLen)
+	{
+		len = currentPacketLen;
+	}
+
+	if(currentMode == MODE_COPY)
+	{
+		dmaReceive(packet, len, Seq);
+		configASSERT(xStreamBufferSend(stream, packet, len, portMAX_DELAY) == len);
+	}
+	else
+	{
+		StreamBufferSpans_t spans;
+		size_t reserved = xStreamBufferReserve(stream, &spans, len, portMAX_DELAY);
+
+		configASSERT(reserved == len);
+		dmaReceive(spans.pucFirst, spans.xFirstLength, Seq);
+		dmaReceive(spans.pucSecond, spans.xSecondLength, Seq);
+		xStreamBufferCommit(stream, reserved);
+	}
+}
+
+/**
+ * drains everything currently in the stream buffer (waiting up
+ * to TicksToWait for something to arrive)
+ */
+static void consumeAvailable( size_t* Received, TickType_t TicksToWait )
+{
+	static uint8_t txBuff[STREAM_LEN];
+
+	if(currentMode == MODE_COPY)
+	{
+		size_t numBytes = xStreamBufferReceive(stream, txBuff, sizeof(txBuff), TicksToWait);
+		usbTransmit(txBuff, numBytes, Received);
+	}
+	else
+	{
+		StreamBufferSpans_t spans;
+		size_t numBytes = xStreamBufferPeek(stream, &spans, STREAM_LEN, TicksToWait);
+
+		usbTransmit(spans.pucFirst, spans.xFirstLength, Received);
+		usbTransmit(spans.pucSecond, spans.xSecondLength, Received);
+		xStreamBufferConsume(stream, numBytes);
+	}
+}
+
+void producerTask( void* NotUsed )
+{
+	size_t seq = 0;
+
+	while(seq < totalBytes)
+	{
+		producePacket(&seq);
+	}
+
+	//wait to be deleted by the control task
+	vTaskSuspend(NULL);
+}
+
+void consumerTask( void* NotUsed )
+{
+	size_t received = 0;
+
+	while(received < totalBytes)
+	{
+		consumeAvailable(&received, portMAX_DELAY);
+	}
+
+	xTaskNotifyGive(controlTaskHandle);
+	vTaskSuspend(NULL);
+}
@@ -0,0 +1,169 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Brian Amos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <FreeRTOS_IP.h>
+#include <FreeRTOS_Sockets.h>
+#include <FreeRTOS_IP_Private.h>
+#include <FreeRTOS_ARP.h>
+#include <linux_vswitch.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "HostIP.h"
+#include "HostSupport.h"
+
+/*********************************************
+ * Cost of the IP task attending to the TCP timers
+ * (xTCPTimerCheck) against the number of sockets
+ *
+ * A single node on a port of the virtual switch opens
+ * more and more client sockets, each connecting to a
+ * peer that is in the ARP cache but never answers, so
+ * every socket has its SYN retransmission timer running
+ * seconds ahead.  At each step the check the IP task
+ * makes when its TCP timer fires, or when it is done with
+ * a batch of TCP segments, is timed with the IP task held
+ * off.  Hardly any timer expires during the calls, so this
+ * is the cost the stack pays for sockets that need nothing.
+ *
+ * Built with the scan of all bound sockets the stack does
+ * by default (benchTCPTimers) and with
+ * ipconfigUSE_TCP_TIMER_HEAP (benchTCPTimers_heap), the
+ * timers column tells the results apart.  Every call of
+ * the scan ages the timers by at least a tick, so keep
+ * the number of checks well below the 3000 tick
+ * retransmission time.
+ *
+ * usage: benchTCPTimers [max sockets] [checks]
+ *********************************************/
+
+#define STACK_SIZE 512
+#define PEER_PORT 5001
+#define DEFAULT_MAX_SOCKETS 1024
+#define DEFAULT_CHECKS 200
+
+#if ( ipconfigUSE_TCP_TIMER_HEAP == 1 )
+#define TIMERS_NAME "heap"
+#else
+#define TIMERS_NAME "list"
+#endif
+
+static uint32_t maxSockets = DEFAULT_MAX_SOCKETS;
+static uint32_t checks = DEFAULT_CHECKS;
+static char switchName[64];
+
+static void benchTask( void* NotUsed );
+
+int main( int argc, char* argv[] )
+{
+	uint8_t mac[ipMAC_ADDRESS_LENGTH_BYTES] = { 0x02, 0x00, 0x00, 0x00, 0x03, 0x00 };
+
+	if(argc > 1) maxSockets = (uint32_t)strtoul(argv[1], NULL, 0);
+	if(argc > 2) checks = (uint32_t)strtoul(argv[2], NULL, 0);
+
+	//a switch with only this node on it - the SYNs go nowhere
+	snprintf(switchName, sizeof(switchName), "/benchTCPTimers.%d", (int)getpid());
+	configASSERT(xVSwitchCreate(switchName, 1, NULL) == pdPASS);
+	configASSERT(xVSwitchAttach(switchName, 0) == pdPASS);
+	configASSERT(HostIPStart(mac, FreeRTOS_inet_addr("10.30.0.1"), FreeRTOS_inet_addr("255.255.0.0")) == pdPASS);
+
+	//below the IP task, so it is never caught in the middle of a check
+	configASSERT(xTaskCreate(benchTask, "bench", STACK_SIZE, NULL, tskIDLE_PRIORITY + 1, NULL) == pdPASS);
+	vTaskStartScheduler();
+	return 1;
+}
+
+/**
+ * time Count calls of xTCPTimerCheck, as made by the IP task
+ * when it is about to sleep, with the scheduler suspended
+ * @returns ns per call
+ */
+static double timeChecks( void )
+{
+	uint64_t start, elapsed;
+
+	vTaskSuspendAll();
+	start = HostTimeNs();
+	for(uint32_t i = 0; i < checks; i++)
+	{
+		(void)xTCPTimerCheck(pdTRUE);
+	}
+	elapsed = HostTimeNs() - start;
+	xTaskResumeAll();
+
+	return (double)elapsed / checks;
+}
+
+static void benchTask( void* NotUsed )
+{
+	const MACAddress_t peerMac = { { 0x02, 0x00, 0x00, 0x00, 0x03, 0x01 } };
+	const uint32_t peerIP = FreeRTOS_inet_addr("10.30.1.1");
+	TickType_t noWait = 0;
+	uint32_t numSockets = 0;
+	uint32_t step = 4;
+
+	configASSERT(HostIPWaitUp(pdMS_TO_TICKS(10000)));
+
+	//with the peer's address known, the connects go straight to SYN_SENT
+	//and their next timeout is the 3 s retransmission
+	vTaskSuspendAll();
+	vARPRefreshCacheEntry(&peerMac, peerIP);
+	xTaskResumeAll();
+
+	printf("timers,sockets,check_ns\n");
+	while(numSockets < maxSockets)
+	{
+		while((numSockets < step) && (numSockets < maxSockets))
+		{
+			struct freertos_sockaddr peer = { 0 };
+			Socket_t client;
+
+			client = FreeRTOS_socket(FREERTOS_AF_INET, FREERTOS_SOCK_STREAM, FREERTOS_IPPROTO_TCP);
+			configASSERT(client != FREERTOS_INVALID_SOCKET);
+			FreeRTOS_setsockopt(client, 0, FREERTOS_SO_RCVTIMEO, &noWait, sizeof(noWait));
+			peer.sin_addr = peerIP;
+			peer.sin_port = FreeRTOS_htons(PEER_PORT);
+			configASSERT(FreeRTOS_connect(client, &peer, sizeof(peer)) == -pdFREERTOS_ERRNO_EWOULDBLOCK);
+			numSockets++;
+		}
+
+		//let the IP task send the SYNs
+		vTaskDelay(pdMS_TO_TICKS(50));
+
+		printf("%s,%lu,%.1f\n", TIMERS_NAME, (unsigned long)numSockets, timeChecks());
+		step *= 4;
+	}
+
+	fflush(stdout);
+
+	//the IP task keeps running, so leave from here rather than ending the
+	//scheduler - with the interrupts off, for the network interface's task
+	//not to run once the switch is unmapped
+	taskENTER_CRITICAL();
+	vVSwitchDestroy(switchName);
+	exit(0);
+}
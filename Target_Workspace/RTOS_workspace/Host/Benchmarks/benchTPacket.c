@@ -0,0 +1,370 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2019 Brian Amos
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <FreeRTOS_IP.h>
+#include <FreeRTOS_Sockets.h>
+#include <linux_tpacket.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include "HostIP.h"
+#include "HostSupport.h"
+
+/*********************************************
+ * UDP echo rate of a FreeRTOS+TCP node on the
+ * TPACKET_V3 network interface
+ * (portable/NetworkInterface/linux_tpacket)
+ *
+ * The node is attached to one end of a veth pair and
+ * echoes UDP datagrams from a task.  A plain pthread on
+ * the other end plays the peer with a raw packet socket:
+ * it keeps a window of datagrams in flight, sends a new
+ * one for every echo and answers the node's ARP requests.
+ * A window that goes quiet for 100ms is resent and
+ * counted as lost.
+ *
+ * Reports echoes (one datagram in, one out) per second
+ * and the driver's counters: frames per RX ring block
+ * handed over, and frames per TX kick.
+ *
+ * Opening packet sockets needs CAP_NET_RAW - without it
+ * the run is reported as skipped.  RunOnVeth.cmake
+ * creates the veth pair for CTest.
+ *
+ * usage: benchTPacket <node interface> <peer interface> [echoes] [window]
+ *********************************************/
+
+#define STACK_SIZE 512
+#define DEFAULT_ECHOES 100000
+#define DEFAULT_WINDOW 32
+#define ECHO_PORT 7
+#define PEER_PORT 40000
+#define PAYLOAD_LEN 64
+#define LOSS_TIMEOUT_MS 100
+#define FRAME_LEN (sizeof(struct ethhdr) + 20 + 8 + PAYLOAD_LEN)
+
+static const uint8_t nodeMac[ipMAC_ADDRESS_LENGTH_BYTES] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x02 };
+
+static char const* peerIf;
+static uint32_t echoes;
+static uint32_t window;
+static uint32_t nodeIp;
+static uint32_t peerIp;
+static uint8_t peerMac[ETH_ALEN];
+static int peerSocket = -1;
+static int peerIndex;
+
+//shared between the FreeRTOS tasks and the peer pthread
+static volatile int nodeReady = 0;
+static volatile int peerDone = 0;
+static uint64_t peerElapsedNs;
+static uint32_t peerLost;
+
+static void controlTask( void* NotUsed );
+static void echoTask( void* NotUsed );
+static void* peerThread( void* NotUsed );
+
+static int openPeer( void )
+{
+	struct sockaddr_ll addr;
+	struct ifreq ifr;
+
+	peerIndex = (int)if_nametoindex(peerIf);
+	if(peerIndex == 0)
+	{
+		return -1;
+	}
+	peerSocket = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+	if(peerSocket < 0)
+	{
+		return -1;
+	}
+
+	memset(&ifr, 0, sizeof(ifr));
+	strncpy(ifr.ifr_name, peerIf, IFNAMSIZ - 1);
+	if(ioctl(peerSocket, SIOCGIFHWADDR, &ifr) != 0)
+	{
+		return -1;
+	}
+	memcpy(peerMac, ifr.ifr_hwaddr.sa_data, ETH_ALEN);
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sll_family = AF_PACKET;
+	addr.sll_protocol = htons(ETH_P_ALL);
+	addr.sll_ifindex = peerIndex;
+	return bind(peerSocket, (struct sockaddr*)&addr, sizeof(addr));
+}
+
+int main( int argc, char* argv[] )
+{
+	pthread_t peer;
+	sigset_t all, previous;
+	int err;
+
+	if(argc < 3)
+	{
+		printf("usage: benchTPacket <node interface> <peer interface> [echoes] [window]\n");
+		return 1;
+	}
+	setenv("TPACKET_INTERFACE", argv[1], 1);
+	peerIf = argv[2];
+	echoes = (argc > 3) ? (uint32_t)strtoul(argv[3], NULL, 0) : DEFAULT_ECHOES;
+	window = (argc > 4) ? (uint32_t)strtoul(argv[4], NULL, 0) : DEFAULT_WINDOW;
+	nodeIp = FreeRTOS_inet_addr("10.10.0.2");
+	peerIp = FreeRTOS_inet_addr("10.10.0.1");
+
+	if(openPeer() != 0)
+	{
+		err = errno;
+		printf("SKIPPED: no packet socket on %s (%s)\n", peerIf, strerror(err));
+		return 0;
+	}
+
+	//the peer is a host thread, keep the port's signals away from it
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &previous);
+	configASSERT(pthread_create(&peer, NULL, peerThread, NULL) == 0);
+	pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+	configASSERT(HostIPStart(nodeMac, nodeIp, FreeRTOS_inet_addr("255.255.255.0")) == pdPASS);
+	configASSERT(xTaskCreate(controlTask, "control", STACK_SIZE, NULL, tskIDLE_PRIORITY + 1, NULL) == pdPASS);
+	vTaskStartScheduler();
+	return 0;
+}
+
+static void controlTask( void* NotUsed )
+{
+	TPacketStats_t stats;
+
+	configASSERT(HostIPWaitUp(pdMS_TO_TICKS(10000)));
+	configASSERT(xTaskCreate(echoTask, "echo", STACK_SIZE, NULL, tskIDLE_PRIORITY + 3, NULL) == pdPASS);
+
+	while(!peerDone)
+	{
+		vTaskDelay(pdMS_TO_TICKS(10));
+	}
+
+	vTPacketGetStats(&stats);
+	printf("driver,payload,window,echoes,lost,echoes_per_sec,frames_per_rx_block,frames_per_tx_kick,rx_no_buffer,tx_ring_full\n");
+	printf("tpacket_v3,%d,%lu,%lu,%lu,%.0f,%.1f,%.1f,%llu,%llu\n", PAYLOAD_LEN,
+			(unsigned long)window, (unsigned long)echoes, (unsigned long)peerLost,
+			echoes * 1e9 / peerElapsedNs,
+			(double)stats.ullRxFrames / (stats.ullRxBlocks ? stats.ullRxBlocks : 1),
+			(double)stats.ullTxFrames / (stats.ullTxKicks ? stats.ullTxKicks : 1),
+			(unsigned long long)stats.ullRxNoBuffer, (unsigned long long)stats.ullTxRingFull);
+	fflush(stdout);
+
+	vTaskEndScheduler();
+}
+
+static void echoTask( void* NotUsed )
+{
+	static uint8_t buffer[ipconfigNETWORK_MTU];
+	struct freertos_sockaddr bindAddr = { 0 };
+	struct freertos_sockaddr from;
+	uint32_t fromLen = sizeof(from);
+	Socket_t sock;
+	int32_t len;
+
+	sock = FreeRTOS_socket(FREERTOS_AF_INET, FREERTOS_SOCK_DGRAM, FREERTOS_IPPROTO_UDP);
+	configASSERT(sock != FREERTOS_INVALID_SOCKET);
+	bindAddr.sin_port = FreeRTOS_htons(ECHO_PORT);
+	configASSERT(FreeRTOS_bind(sock, &bindAddr, sizeof(bindAddr)) == 0);
+	nodeReady = 1;
+
+	while(1)
+	{
+		len = FreeRTOS_recvfrom(sock, buffer, sizeof(buffer), 0, &from, &fromLen);
+		if(len > 0)
+		{
+			FreeRTOS_sendto(sock, buffer, (size_t)len, 0, &from, fromLen);
+		}
+	}
+}
+
+/*********************************************
+ * the peer - a host thread, no FreeRTOS calls
+ *********************************************/
+
+static uint16_t checksum( uint8_t const* Data, size_t Len, uint32_t Sum )
+{
+	for(size_t i = 0; i + 1 < Len; i += 2)
+	{
+		Sum += (uint32_t)((Data[i] << 8) | Data[i + 1]);
+	}
+	if(Len & 1)
+	{
+		Sum += (uint32_t)(Data[Len - 1] << 8);
+	}
+	while(Sum >> 16)
+	{
+		Sum = (Sum & 0xFFFF) + (Sum >> 16);
+	}
+	return (uint16_t)~Sum;
+}
+
+static void sendDatagram( uint32_t Seq )
+{
+	uint8_t frame[FRAME_LEN];
+	uint8_t* ip = frame + sizeof(struct ethhdr);
+	uint8_t* udp = ip + 20;
+	uint16_t udpLen = 8 + PAYLOAD_LEN;
+	uint32_t pseudo;
+	uint16_t sum;
+
+	memcpy(frame, nodeMac, ETH_ALEN);
+	memcpy(frame + ETH_ALEN, peerMac, ETH_ALEN);
+	frame[12] = 0x08;
+	frame[13] = 0x00;
+
+	memset(ip, 0, 20);
+	ip[0] = 0x45;
+	ip[2] = (uint8_t)((20 + udpLen) >> 8);
+	ip[3] = (uint8_t)(20 + udpLen);
+	ip[8] = 64;
+	ip[9] = 17;
+	memcpy(ip + 12, &peerIp, 4);
+	memcpy(ip + 16, &nodeIp, 4);
+	sum = checksum(ip, 20, 0);
+	ip[10] = (uint8_t)(sum >> 8);
+	ip[11] = (uint8_t)sum;
+
+	udp[0] = PEER_PORT >> 8;
+	udp[1] = PEER_PORT & 0xFF;
+	udp[2] = 0;
+	udp[3] = ECHO_PORT;
+	udp[4] = (uint8_t)(udpLen >> 8);
+	udp[5] = (uint8_t)udpLen;
+	udp[6] = 0;
+	udp[7] = 0;
+	memset(udp + 8, 0, PAYLOAD_LEN);
+	memcpy(udp + 8, &Seq, sizeof(Seq));
+
+	//pseudo header: addresses, protocol and length
+	pseudo = 17 + udpLen;
+	for(int i = 12; i < 20; i += 2)
+	{
+		pseudo += (uint32_t)((ip[i] << 8) | ip[i + 1]);
+	}
+	sum = checksum(udp, udpLen, pseudo);
+	if(sum == 0)
+	{
+		sum = 0xFFFF;
+	}
+	udp[6] = (uint8_t)(sum >> 8);
+	udp[7] = (uint8_t)sum;
+
+	send(peerSocket, frame, sizeof(frame), 0);
+}
+
+/**
+ * answer an ARP request for the peer's address
+ */
+static void answerArp( uint8_t* Frame, ssize_t Len )
+{
+	uint8_t* arp = Frame + sizeof(struct ethhdr);
+
+	if((Len < (ssize_t)(sizeof(struct ethhdr) + 28)) || (arp[7] != 1) || (memcmp(arp + 24, &peerIp, 4) != 0))
+	{
+		return;
+	}
+	memcpy(Frame, Frame + ETH_ALEN, ETH_ALEN);
+	memcpy(Frame + ETH_ALEN, peerMac, ETH_ALEN);
+	arp[7] = 2;
+	memcpy(arp + 18, arp + 8, 10);		//target = the requester
+	memcpy(arp + 8, peerMac, ETH_ALEN);
+	memcpy(arp + 14, &peerIp, 4);
+	send(peerSocket, Frame, sizeof(struct ethhdr) + 28, 0);
+}
+
+static void* peerThread( void* NotUsed )
+{
+	uint8_t frame[2048];
+	struct sockaddr_ll from;
+	socklen_t fromLen;
+	struct timeval timeout = { 0, LOSS_TIMEOUT_MS * 1000 };
+	uint32_t received = 0;
+	uint32_t sent = 0;
+	uint64_t start;
+	ssize_t len;
+
+	setsockopt(peerSocket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	while(!nodeReady)
+	{
+		usleep(1000);
+	}
+
+	start = HostTimeNs();
+	for(; sent < window; sent++)
+	{
+		sendDatagram(sent);
+	}
+
+	while(received < echoes)
+	{
+		fromLen = sizeof(from);
+		len = recvfrom(peerSocket, frame, sizeof(frame), 0, (struct sockaddr*)&from, &fromLen);
+		if(len < 0)
+		{
+			//the whole window went missing
+			peerLost += window;
+			for(uint32_t i = 0; i < window; i++, sent++)
+			{
+				sendDatagram(sent);
+			}
+			continue;
+		}
+		if((from.sll_pkttype == PACKET_OUTGOING) || (len < (ssize_t)sizeof(struct ethhdr)))
+		{
+			continue;
+		}
+		if((frame[12] == 0x08) && (frame[13] == 0x06))
+		{
+			answerArp(frame, len);
+		}
+		else if((len >= (ssize_t)FRAME_LEN) && (frame[12] == 0x08) && (frame[13] == 0x00) &&
+				(frame[sizeof(struct ethhdr) + 9] == 17) &&
+				(frame[sizeof(struct ethhdr) + 20 + 1] == ECHO_PORT))
+		{
+			received++;
+			sendDatagram(sent++);
+		}
+	}
+	peerElapsedNs = HostTimeNs() - start;
+	peerDone = 1;
+	return NULL;
+}
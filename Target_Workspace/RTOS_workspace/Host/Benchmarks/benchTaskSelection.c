@@ -0,0 +1,191 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2019 Brian Amos
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "HostSupport.h"
+
+/*********************************************
+ * Cost of selecting the next task to run, against the
+ * number of priorities
+ *
+ * A "low" task (tskIDLE_PRIORITY + 1) and a "high" task
+ * (configMAX_PRIORITIES - 1) ping-pong with task
+ * notifications, so every priority in between is empty.
+ * Each round trip selects twice:
+ * up:    low wakes high - the top ready priority is
+ *        high's, so both methods find it straight away
+ * down:  high blocks - the generic method walks the empty
+ *        ready lists from high's priority down to low's,
+ *        the bitmap method takes one (<= 32 priorities) or
+ *        two count leading zeros
+ *
+ * The selection itself is timed from inside
+ * vTaskSwitchContext() with the traceTASK_SWITCHED_OUT/IN
+ * hooks (HOST_SELECT_TIMING), so the time includes one
+ * HostTimeNs() call.  round_trip_ns is the whole exchange,
+ * including the Posix port's thread switches.
+ *
+ * CMake builds one copy per method for 4, 32 and 256
+ * priorities (benchTaskSelection_<method><priorities>), the
+ * bitmap rows should be flat and the linear down column
+ * should grow with the priority count.
+ *
+ * usage: benchTaskSelection_<method><priorities> [iterations]
+ *********************************************/
+
+#define STACK_SIZE 256
+#define DEFAULT_ITERATIONS 20000
+
+#if configUSE_BITMAP_TASK_SELECTION == 1
+#define SELECTION_NAME "bitmap"
+#else
+#define SELECTION_NAME "linear"
+#endif
+
+typedef struct
+{
+	uint64_t TotalNs;
+	uint64_t MinNs;
+	uint32_t Count;
+}SelectStats_t;
+
+static uint32_t iterations;
+static TaskHandle_t lowTaskHandle = NULL;
+static TaskHandle_t highTaskHandle = NULL;
+
+//written from vTaskSwitchContext, which the port serializes
+static volatile int timingEnabled = 0;
+static uint64_t selectStartNs;
+static TaskHandle_t switchedOut;
+static SelectStats_t selectUp;
+static SelectStats_t selectDown;
+static uint64_t roundTripNs;
+
+static void lowTask( void* NotUsed );
+static void highTask( void* NotUsed );
+
+int main( int argc, char* argv[] )
+{
+	iterations = DEFAULT_ITERATIONS;
+	if(argc > 1)
+	{
+		iterations = (uint32_t)strtoul(argv[1], NULL, 0);
+	}
+
+	configASSERT(xTaskCreate(lowTask, "low", STACK_SIZE, NULL, tskIDLE_PRIORITY + 1, &lowTaskHandle) == pdPASS);
+	configASSERT(xTaskCreate(highTask, "high", STACK_SIZE, NULL, configMAX_PRIORITIES - 1, &highTaskHandle) == pdPASS);
+
+	vTaskStartScheduler();
+
+	printf("selection,priorities,round_trips,select_up_ns,select_up_min_ns,select_down_ns,select_down_min_ns,round_trip_ns\n");
+	printf("%s,%d,%lu,%.1f,%llu,%.1f,%llu,%.1f\n",
+			SELECTION_NAME, configMAX_PRIORITIES, (unsigned long)iterations,
+			(double)selectUp.TotalNs / selectUp.Count, (unsigned long long)selectUp.MinNs,
+			(double)selectDown.TotalNs / selectDown.Count, (unsigned long long)selectDown.MinNs,
+			(double)roundTripNs / iterations);
+	return 0;
+}
+
+void HostSelectTimingStart( void )
+{
+	if(timingEnabled)
+	{
+		switchedOut = xTaskGetCurrentTaskHandle();
+		selectStartNs = HostTimeNs();
+	}
+}
+
+void HostSelectTimingStop( void )
+{
+	SelectStats_t* stats;
+	TaskHandle_t switchedIn;
+	uint64_t elapsed;
+
+	//the scheduler start switches in without switching out first
+	if(!timingEnabled || selectStartNs == 0)
+	{
+		return;
+	}
+	elapsed = HostTimeNs() - selectStartNs;
+	selectStartNs = 0;
+
+	//only count the switches between the two benchmark tasks,
+	//not a tick re-selecting the running task
+	switchedIn = xTaskGetCurrentTaskHandle();
+	if(switchedIn == switchedOut)
+	{
+		return;
+	}
+	if(switchedIn == highTaskHandle)
+	{
+		stats = &selectUp;
+	}
+	else if(switchedIn == lowTaskHandle)
+	{
+		stats = &selectDown;
+	}
+	else
+	{
+		return;
+	}
+
+	stats->TotalNs += elapsed;
+	stats->Count++;
+	if(stats->MinNs == 0 || elapsed < stats->MinNs)
+	{
+		stats->MinNs = elapsed;
+	}
+}
+
+static void highTask( void* NotUsed )
+{
+	while(1)
+	{
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+	}
+}
+
+static void lowTask( void* NotUsed )
+{
+	uint64_t start;
+
+	//let the high task block before timing anything
+	vTaskDelay(1);
+
+	timingEnabled = 1;
+	start = HostTimeNs();
+	for(uint32_t i = 0; i < iterations; i++)
+	{
+		xTaskNotifyGive(highTaskHandle);
+	}
+	roundTripNs = HostTimeNs() - start;
+	timingEnabled = 0;
+
+	configASSERT(selectUp.Count > 0 && selectDown.Count > 0);
+	vTaskEndScheduler();
+}
@@ -0,0 +1,229 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2019 Brian Amos
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#include <FreeRTOS.h>
+#include <task.h>
+#include <timers.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "HostSupport.h"
+
+/*********************************************
+ * Timer service cost against the number of active timers
+ *
+ * For each count, that many auto reload timers are started
+ * with periods spread over [run/2, run] ticks, then:
+ * reset:   the control task (above the timer service task)
+ *          resets every timer in a shuffled order, timed
+ *          until a pended function queued behind the last
+ *          reset runs - so this is the whole round trip
+ *          through the command queue, including the
+ *          sorted insert with the active timer lists
+ * expire:  every timer expires once, the timer service
+ *          task's CPU time from the first expiry to the
+ *          last, per expiry - re-inserting an auto reload
+ *          timer is a sorted insert with the lists
+ *
+ * CMake builds one copy per timer backend:
+ * benchTimerService_list         sorted active timer lists
+ * benchTimerService_list_batch   the same, with the command
+ *                                queue drained in batches
+ *                                (configTIMER_COMMAND_BATCH_LENGTH)
+ * benchTimerService_wheel_batch  timing wheel
+ *                                (configUSE_TIMER_WHEEL) and
+ *                                batches
+ * The list rows grow with the timer count, the wheel rows
+ * should stay flat.
+ *
+ * usage: benchTimerService_<backend> [run ticks]
+ *********************************************/
+
+#define STACK_SIZE 512
+#define DEFAULT_RUN_TICKS 1000
+#define MAX_TIMERS 10000
+
+#define CONTROL_PRIORITY (configTIMER_TASK_PRIORITY + 1)
+
+#if configUSE_TIMER_WHEEL == 1
+#define BACKEND_NAME "wheel"
+#else
+#define BACKEND_NAME "list"
+#endif
+
+static const uint32_t timerCounts[] = { 10, 100, 1000, MAX_TIMERS };
+#define NUM_COUNTS (sizeof(timerCounts)/sizeof(timerCounts[0]))
+
+typedef struct
+{
+	double ResetNs;
+	double ExpireNs;
+}Result_t;
+
+static Result_t results[NUM_COUNTS];
+static StaticTimer_t timerBuffers[MAX_TIMERS];
+static TimerHandle_t timers[MAX_TIMERS];
+static uint32_t order[MAX_TIMERS];
+static TickType_t runTicks;
+static TaskHandle_t controlTaskHandle = NULL;
+
+//only touched by the timer service task while a count is running
+static uint32_t expiryTarget;
+static uint32_t expiries;
+static uint64_t firstExpiryCpuNs;
+static uint64_t lastExpiryCpuNs;
+
+static void controlTask( void* NotUsed );
+
+int main( int argc, char* argv[] )
+{
+	runTicks = DEFAULT_RUN_TICKS;
+	if(argc > 1)
+	{
+		runTicks = (TickType_t)strtoul(argv[1], NULL, 0);
+	}
+
+	configASSERT(xTaskCreate(controlTask, "control", STACK_SIZE, NULL, CONTROL_PRIORITY, &controlTaskHandle) == pdPASS);
+
+	vTaskStartScheduler();
+
+	printf("backend,command_batch,timers,reset_ns,expire_ns\n");
+	for(uint32_t i = 0; i < NUM_COUNTS; i++)
+	{
+		printf("%s,%d,%lu,%.1f,%.1f\n", BACKEND_NAME, configTIMER_COMMAND_BATCH_LENGTH,
+				(unsigned long)timerCounts[i], results[i].ResetNs, results[i].ExpireNs);
+	}
+	return 0;
+}
+
+/**
+ * a small LCG, so every backend gets the same periods and order
+ */
+static uint32_t nextRandom( void )
+{
+	static uint32_t state = 12345;
+
+	state = state * 1103515245u + 12345u;
+	return state >> 8;
+}
+
+static uint64_t threadCpuNs( void )
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+	return (uint64_t)t.tv_sec * 1000000000ull + (uint64_t)t.tv_nsec;
+}
+
+static void timerCallback( TimerHandle_t Timer )
+{
+	if(expiries >= expiryTarget)
+	{
+		return;
+	}
+
+	lastExpiryCpuNs = threadCpuNs();
+	if(expiries == 0)
+	{
+		firstExpiryCpuNs = lastExpiryCpuNs;
+	}
+	if(++expiries == expiryTarget)
+	{
+		xTaskNotifyGive(controlTaskHandle);
+	}
+}
+
+static void pendedNotify( void* NotUsed1, uint32_t NotUsed2 )
+{
+	xTaskNotifyGive(controlTaskHandle);
+}
+
+/**
+ * wait for the timer service task to work through every
+ * command queued so far
+ */
+static void waitForTimerService( void )
+{
+	configASSERT(xTimerPendFunctionCall(pendedNotify, NULL, 0, portMAX_DELAY) == pdPASS);
+	ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+}
+
+static void runCount( uint32_t NumTimers, Result_t* Result )
+{
+	uint64_t start;
+
+	//expiries are ignored until the target is set
+	expiryTarget = 0;
+	for(uint32_t i = 0; i < NumTimers; i++)
+	{
+		TickType_t period = runTicks / 2 + nextRandom() % (runTicks / 2 + 1);
+
+		configASSERT(xTimerChangePeriod(timers[i], period, portMAX_DELAY) == pdPASS);
+		order[i] = i;
+	}
+	for(uint32_t i = NumTimers - 1; i > 0; i--)
+	{
+		uint32_t j = nextRandom() % (i + 1);
+		uint32_t tmp = order[i];
+
+		order[i] = order[j];
+		order[j] = tmp;
+	}
+	waitForTimerService();
+
+	expiries = 0;
+	expiryTarget = NumTimers;
+	start = HostTimeNs();
+	for(uint32_t i = 0; i < NumTimers; i++)
+	{
+		configASSERT(xTimerReset(timers[order[i]], portMAX_DELAY) == pdPASS);
+	}
+	waitForTimerService();
+	Result->ResetNs = (double)(HostTimeNs() - start) / NumTimers;
+
+	ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+	Result->ExpireNs = (double)(lastExpiryCpuNs - firstExpiryCpuNs) / (NumTimers - 1);
+
+	for(uint32_t i = 0; i < NumTimers; i++)
+	{
+		configASSERT(xTimerStop(timers[i], portMAX_DELAY) == pdPASS);
+	}
+	waitForTimerService();
+}
+
+static void controlTask( void* NotUsed )
+{
+	for(uint32_t i = 0; i < MAX_TIMERS; i++)
+	{
+		timers[i] = xTimerCreateStatic("bench", 1, pdTRUE, NULL, timerCallback, &timerBuffers[i]);
+		configASSERT(timers[i] != NULL);
+	}
+
+	for(uint32_t i = 0; i < NUM_COUNTS; i++)
+	{
+		runCount(timerCounts[i], &results[i]);
+	}
+
+	vTaskEndScheduler();
+}
@@ -0,0 +1,347 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2019 Brian Amos
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <FreeRTOS_IP.h>
+#include <FreeRTOS_Sockets.h>
+#include <linux_vswitch.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "HostIP.h"
+#include "HostSupport.h"
+
+/*********************************************
+ * TCP throughput between simulated FreeRTOS+TCP
+ * nodes on the virtual switch network interface
+ * (portable/NetworkInterface/linux_vswitch)
+ *
+ * Each node is a forked process on its own port of the
+ * switch.  Node 0 is a server that sinks whatever it
+ * is sent; every other node connects to it, sends its
+ * share of data and shuts the connection down.  All the
+ * clients start at once, so the run opens with an ARP
+ * storm: every client floods a request for the server.
+ *
+ * The switch delays, drops and rate limits frames as
+ * given on the command line, and with flap_ms takes
+ * node 1's link down for that long once it has started
+ * sending, for the stack to recover from.
+ *
+ * Reports the data delivered per second - from the
+ * fork to the last connection closing - and the
+ * switch's counters summed over the ports.
+ *
+ * usage: benchVSwitch [nodes] [kbytes per client] [latency_us]
+ *                     [loss_permille] [kbps] [flap_ms]
+ *********************************************/
+
+#define STACK_SIZE 512
+#define SERVER_PORT 5001
+#define CHUNK 1460
+#define TIMEOUT_S 60
+
+static int nodes = 8;
+static uint32_t bytesPerClient = 256 * 1024;
+static VSwitchShaping_t shaping = { 0 };
+static uint32_t flapMs = 0;
+
+static char switchName[64];
+static int node;
+static volatile uint32_t connectionsDone = 0;
+static volatile uint64_t bytesReceived = 0;
+static TaskHandle_t serverTaskHandle = NULL;
+
+static int runNode( void );
+static void serverTask( void* NotUsed );
+static void sinkTask( void* Connection );
+static void clientTask( void* NotUsed );
+
+static uint32_t nodeAddress( int Node )
+{
+	return FreeRTOS_htonl(0x0A140001UL + (uint32_t)Node);		//10.20.0.1 on
+}
+
+/**
+ * take node 1's link down for flapMs, once its node has got going
+ */
+static void flapLink( void )
+{
+	VSwitchPortStats_t stats;
+
+	do
+	{
+		usleep(1000);
+		xVSwitchGetStats(1, &stats);
+	} while(stats.ullTxFrames < 50);
+
+	vVSwitchSetLink(1, pdFALSE);
+	usleep(flapMs * 1000);
+	vVSwitchSetLink(1, pdTRUE);
+}
+
+int main( int argc, char* argv[] )
+{
+	VSwitchPortStats_t stats, total = { 0 };
+	uint64_t start, elapsed;
+	pid_t pids[256];
+	int failed = 0;
+	int status;
+	int done = 0;
+
+	if(argc > 1) nodes = atoi(argv[1]);
+	if(argc > 2) bytesPerClient = (uint32_t)strtoul(argv[2], NULL, 0) * 1024;
+	if(argc > 3) shaping.ulLatencyUs = (uint32_t)strtoul(argv[3], NULL, 0);
+	if(argc > 4) shaping.ulLossPermille = (uint32_t)strtoul(argv[4], NULL, 0);
+	if(argc > 5) shaping.ulBandwidthKbps = (uint32_t)strtoul(argv[5], NULL, 0);
+	if(argc > 6) flapMs = (uint32_t)strtoul(argv[6], NULL, 0);
+	configASSERT((nodes >= 2) && (nodes <= 256));
+
+	snprintf(switchName, sizeof(switchName), "/benchVSwitch.%d", (int)getpid());
+	configASSERT(xVSwitchCreate(switchName, nodes, &shaping) == pdPASS);
+
+	start = HostTimeNs();
+	fflush(stdout);
+	for(node = 0; node < nodes; node++)
+	{
+		pids[node] = fork();
+		configASSERT(pids[node] >= 0);
+		if(pids[node] == 0)
+		{
+			return runNode();
+		}
+	}
+
+	if(flapMs != 0)
+	{
+		flapLink();
+	}
+
+	//every node exits 0 once its part is done
+	while(done < nodes)
+	{
+		pid_t pid = waitpid(-1, &status, WNOHANG);
+		if(pid > 0)
+		{
+			done++;
+			if(!WIFEXITED(status) || (WEXITSTATUS(status) != 0))
+			{
+				failed++;
+			}
+		}
+		else if(HostTimeNs() - start > TIMEOUT_S * 1000000000ULL)
+		{
+			printf("timed out with %d of %d nodes done\nport,tx,flooded,rx,drop_loss,drop_full,drop_link\n", done, nodes);
+			for(int i = 0; i < nodes; i++)
+			{
+				kill(pids[i], SIGKILL);
+				xVSwitchGetStats(i, &stats);
+				printf("%d,%llu,%llu,%llu,%llu,%llu,%llu\n", i,
+						(unsigned long long)stats.ullTxFrames, (unsigned long long)stats.ullFlooded,
+						(unsigned long long)stats.ullRxFrames, (unsigned long long)stats.ullDropLoss,
+						(unsigned long long)stats.ullDropFull, (unsigned long long)stats.ullDropLink);
+			}
+			vVSwitchDestroy(switchName);
+			return 1;
+		}
+		else
+		{
+			usleep(1000);
+		}
+	}
+	elapsed = HostTimeNs() - start;
+
+	for(int i = 0; i < nodes; i++)
+	{
+		xVSwitchGetStats(i, &stats);
+		total.ullTxFrames += stats.ullTxFrames;
+		total.ullFlooded += stats.ullFlooded;
+		total.ullDropLoss += stats.ullDropLoss;
+		total.ullDropFull += stats.ullDropFull;
+		total.ullDropLink += stats.ullDropLink;
+	}
+	vVSwitchDestroy(switchName);
+
+	printf("nodes,latency_us,loss_permille,kbps,flap_ms,kbytes,elapsed_ms,mbit_per_sec,frames,flooded,drop_loss,drop_full,drop_link\n");
+	printf("%d,%lu,%lu,%lu,%lu,%lu,%.1f,%.2f,%llu,%llu,%llu,%llu,%llu\n", nodes,
+			(unsigned long)shaping.ulLatencyUs, (unsigned long)shaping.ulLossPermille,
+			(unsigned long)shaping.ulBandwidthKbps, (unsigned long)flapMs,
+			(unsigned long)((uint64_t)bytesPerClient * (nodes - 1) / 1024),
+			elapsed / 1e6, (double)bytesPerClient * (nodes - 1) * 8e3 / elapsed,
+			(unsigned long long)total.ullTxFrames, (unsigned long long)total.ullFlooded,
+			(unsigned long long)total.ullDropLoss, (unsigned long long)total.ullDropFull,
+			(unsigned long long)total.ullDropLink);
+
+	if(failed != 0)
+	{
+		printf("%d nodes failed\n", failed);
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * a forked node - attaches to its port and runs FreeRTOS, the
+ * node's task exits the process once its part is done
+ */
+static int runNode( void )
+{
+	uint8_t mac[ipMAC_ADDRESS_LENGTH_BYTES] = { 0x02, 0x00, 0x00, 0x00, 0x01, (uint8_t)node };
+
+	configASSERT(xVSwitchAttach(switchName, node) == pdPASS);
+	configASSERT(HostIPStart(mac, nodeAddress(node), FreeRTOS_inet_addr("255.255.0.0")) == pdPASS);
+	if(node == 0)
+	{
+		configASSERT(xTaskCreate(serverTask, "server", STACK_SIZE, NULL, tskIDLE_PRIORITY + 2, &serverTaskHandle) == pdPASS);
+	}
+	else
+	{
+		configASSERT(xTaskCreate(clientTask, "client", STACK_SIZE, NULL, tskIDLE_PRIORITY + 2, NULL) == pdPASS);
+	}
+	vTaskStartScheduler();
+	return 1;
+}
+
+static void serverTask( void* NotUsed )
+{
+	struct freertos_sockaddr bindAddr = { 0 };
+	struct freertos_sockaddr from;
+	uint32_t fromLen = sizeof(from);
+	Socket_t listener, connection;
+	uint32_t accepted = 0;
+
+	configASSERT(HostIPWaitUp(pdMS_TO_TICKS(10000)));
+	listener = FreeRTOS_socket(FREERTOS_AF_INET, FREERTOS_SOCK_STREAM, FREERTOS_IPPROTO_TCP);
+	configASSERT(listener != FREERTOS_INVALID_SOCKET);
+	bindAddr.sin_port = FreeRTOS_htons(SERVER_PORT);
+	configASSERT(FreeRTOS_bind(listener, &bindAddr, sizeof(bindAddr)) == 0);
+	configASSERT(FreeRTOS_listen(listener, nodes - 1) == 0);
+
+	while(accepted < (uint32_t)(nodes - 1))
+	{
+		connection = FreeRTOS_accept(listener, &from, &fromLen);
+		if((connection != NULL) && (connection != FREERTOS_INVALID_SOCKET))
+		{
+			configASSERT(xTaskCreate(sinkTask, "sink", STACK_SIZE, connection, tskIDLE_PRIORITY + 2, NULL) == pdPASS);
+			accepted++;
+		}
+	}
+
+	while(connectionsDone < accepted)
+	{
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+	}
+
+	if(bytesReceived != (uint64_t)bytesPerClient * (nodes - 1))
+	{
+		printf("server received %llu bytes\n", (unsigned long long)bytesReceived);
+		exit(1);
+	}
+	exit(0);
+}
+
+static void sinkTask( void* Connection )
+{
+	static uint8_t buffer[CHUNK];		//the contents are thrown away
+	Socket_t sock = (Socket_t)Connection;
+	BaseType_t len;
+
+	while(1)
+	{
+		len = FreeRTOS_recv(sock, buffer, sizeof(buffer), 0);
+		if(len > 0)
+		{
+			taskENTER_CRITICAL();
+			bytesReceived += (uint64_t)len;
+			taskEXIT_CRITICAL();
+		}
+		else if(len < 0)
+		{
+			//the client has shut the connection down
+			break;
+		}
+	}
+	FreeRTOS_closesocket(sock);
+
+	taskENTER_CRITICAL();
+	connectionsDone++;
+	taskEXIT_CRITICAL();
+	xTaskNotifyGive(serverTaskHandle);
+	vTaskDelete(NULL);
+}
+
+static void clientTask( void* NotUsed )
+{
+	static uint8_t buffer[CHUNK];
+	struct freertos_sockaddr server = { 0 };
+	TickType_t timeout = pdMS_TO_TICKS(10000);
+	Socket_t sock;
+	uint32_t sent = 0;
+	BaseType_t len;
+
+	configASSERT(HostIPWaitUp(pdMS_TO_TICKS(10000)));
+	server.sin_port = FreeRTOS_htons(SERVER_PORT);
+	server.sin_addr = nodeAddress(0);
+	memset(buffer, node, sizeof(buffer));
+
+	//the server may not be listening yet
+	while(1)
+	{
+		sock = FreeRTOS_socket(FREERTOS_AF_INET, FREERTOS_SOCK_STREAM, FREERTOS_IPPROTO_TCP);
+		configASSERT(sock != FREERTOS_INVALID_SOCKET);
+		FreeRTOS_setsockopt(sock, 0, FREERTOS_SO_SNDTIMEO, &timeout, sizeof(timeout));
+		FreeRTOS_setsockopt(sock, 0, FREERTOS_SO_RCVTIMEO, &timeout, sizeof(timeout));
+		if(FreeRTOS_connect(sock, &server, sizeof(server)) == 0)
+		{
+			break;
+		}
+		FreeRTOS_closesocket(sock);
+		vTaskDelay(pdMS_TO_TICKS(10));
+	}
+
+	while(sent < bytesPerClient)
+	{
+		len = FreeRTOS_send(sock, buffer, ((bytesPerClient - sent) < CHUNK) ? (bytesPerClient - sent) : CHUNK, 0);
+		if(len < 0)
+		{
+			printf("node %d: send failed %ld after %lu bytes\n", node, (long)len, (unsigned long)sent);
+			break;
+		}
+		sent += (uint32_t)len;
+	}
+
+	//wait for the server to close its side, by then it has everything
+	FreeRTOS_shutdown(sock, FREERTOS_SHUT_RDWR);
+	while(FreeRTOS_recv(sock, buffer, sizeof(buffer), 0) >= 0)
+	{
+	}
+	FreeRTOS_closesocket(sock);
+
+	exit((sent == bytesPerClient) ? 0 : 1);
+}
@@ -0,0 +1,263 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2019 Brian Amos
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "HostSupport.h"
+#include "LatencyHistogram.h"
+
+/*********************************************
+ * Host model of the TIM9 latency harness
+ * (BSP/TIM9_UnderRTOS_Radar_ISR.c)
+ *
+ * A POSIX timer stands in for the TIM9 compare: it raises
+ * SIGRTMIN at an absolute CLOCK_MONOTONIC time, the way TIM9
+ * raises its interrupt when the counter reaches CCR1.  The
+ * handler is the ISR - it records how late it started
+ * (entry), re-arms the timer one period on, gives a task
+ * notification and yields with portYIELD_FROM_ISR, the same
+ * as the target ISR does at or below
+ * configMAX_SYSCALL_INTERRUPT_PRIORITY.  The woken task
+ * records the time from the compare to it running (wake).
+ *
+ * The Posix port masks every signal for critical sections and
+ * the tick handler, so a lower priority task spending half of
+ * its time in critical sections of each length in loadsUs
+ * delays the handler just as it delays the ISR on the target.
+ * Every signal is masked, so there is no host equivalent of
+ * an ISR above the syscall priority - only the target can
+ * measure that one.
+ *
+ * Built on a kernel without tickless idle, which would leave
+ * the signal pending while the idle thread sleeps.  All times
+ * are in ns, the run fails if the longest critical section
+ * doesn't show up in the entry latency.
+ *
+ * usage: simTim9Latency [eventsPerRun]
+ *********************************************/
+
+#define STACK_SIZE 256
+#define PERIOD_NS 500000ULL
+#define DEFAULT_EVENTS 2000
+#define SIM_TIM9_SIGNAL SIGRTMIN
+
+static const uint32_t loadsUs[] = { 0, 20, 100 };
+#define NUM_LOADS (sizeof(loadsUs)/sizeof(loadsUs[0]))
+
+typedef struct
+{
+	LatencyHist_t Entry;
+	LatencyHist_t Isr;
+	LatencyHist_t Wake;
+	uint32_t Missed;
+}SimResult_t;
+
+static SimResult_t results[NUM_LOADS];
+static uint32_t eventsPerRun;
+
+static timer_t tim9;
+static TaskHandle_t wakeTaskHandle = NULL;
+static SimResult_t* volatile running = NULL;
+static volatile uint64_t nextCompareNs;
+static volatile uint64_t lastEventNs;
+static volatile int eventPending;
+static volatile uint64_t loadNs;
+
+static void wakeTask( void* NotUsed );
+static void loadTask( void* NotUsed );
+
+static void armTim9( uint64_t AtNs )
+{
+	struct itimerspec when;
+
+	memset(&when, 0, sizeof(when));
+	when.it_value.tv_sec = (time_t)(AtNs / 1000000000ULL);
+	when.it_value.tv_nsec = (long)(AtNs % 1000000000ULL);
+	timer_settime(tim9, TIMER_ABSTIME, &when, NULL);
+}
+
+static void stopTim9( void )
+{
+	struct itimerspec when;
+
+	memset(&when, 0, sizeof(when));
+	timer_settime(tim9, 0, &when, NULL);
+}
+
+/**
+ * the simulated TIM1_BRK_TIM9_IRQHandler - every signal is masked
+ * while it runs, as for the tick
+ */
+static void tim9Handler( int sig )
+{
+	uint64_t entry = HostTimeNs();
+	SimResult_t* result = running;
+	BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+	uint64_t event = nextCompareNs;
+
+	(void)sig;
+	if(result == NULL)
+	{
+		return;
+	}
+
+	//next compare one period on, skipping any the handler was too late for
+	do
+	{
+		nextCompareNs += PERIOD_NS;
+	}while(nextCompareNs <= entry);
+	armTim9(nextCompareNs);
+
+	LatencyHistRecord(&result->Entry, (uint32_t)(entry - event));
+	if(eventPending)
+	{
+		result->Missed++;
+	}
+	else
+	{
+		lastEventNs = event;
+		eventPending = 1;
+		vTaskNotifyGiveFromISR(wakeTaskHandle, &xHigherPriorityTaskWoken);
+	}
+	LatencyHistRecord(&result->Isr, (uint32_t)(HostTimeNs() - entry));
+	portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
+int main( int argc, char* argv[] )
+{
+	struct sigaction action;
+	struct sigevent event;
+
+	eventsPerRun = DEFAULT_EVENTS;
+	if(argc > 1)
+	{
+		eventsPerRun = (uint32_t)strtoul(argv[1], NULL, 0);
+	}
+
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = tim9Handler;
+	sigfillset(&action.sa_mask);
+	configASSERT(sigaction(SIM_TIM9_SIGNAL, &action, NULL) == 0);
+
+	memset(&event, 0, sizeof(event));
+	event.sigev_notify = SIGEV_SIGNAL;
+	event.sigev_signo = SIM_TIM9_SIGNAL;
+	configASSERT(timer_create(CLOCK_MONOTONIC, &event, &tim9) == 0);
+
+	configASSERT(xTaskCreate(wakeTask, "wake", STACK_SIZE, NULL, tskIDLE_PRIORITY + 3, &wakeTaskHandle) == pdPASS);
+	configASSERT(xTaskCreate(loadTask, "load", STACK_SIZE, NULL, tskIDLE_PRIORITY + 1, NULL) == pdPASS);
+
+	vTaskStartScheduler();
+
+	printf("load_us,measure,count,min_ns,mean_ns,p50_ns,p99_ns,max_ns\n");
+	for(uint32_t i = 0; i < NUM_LOADS; i++)
+	{
+		LatencyHist_t const* hists[] = { &results[i].Entry, &results[i].Isr, &results[i].Wake };
+		char const* names[] = { "entry", "isr", "wake" };
+
+		for(uint32_t h = 0; h < 3; h++)
+		{
+			LatencyHistSummary_t sum;
+
+			LatencyHistSummarize(hists[h], &sum);
+			printf("%lu,%s,%lu,%lu,%lu,%lu,%lu,%lu\n", (unsigned long)loadsUs[i], names[h],
+					(unsigned long)sum.Count, (unsigned long)sum.Min, (unsigned long)sum.Mean,
+					(unsigned long)sum.P50, (unsigned long)sum.P99, (unsigned long)sum.Max);
+		}
+		printf("%lu,missed,%lu,,,,,\n", (unsigned long)loadsUs[i], (unsigned long)results[i].Missed);
+	}
+
+	//events landing in the first half of the longest critical sections
+	//must have waited at least half of it
+	if(results[NUM_LOADS - 1].Entry.Max < loadsUs[NUM_LOADS - 1] * 1000 / 2)
+	{
+		printf("FAIL: %luus critical sections didn't delay the handler\n", (unsigned long)loadsUs[NUM_LOADS - 1]);
+		return 1;
+	}
+	return 0;
+}
+
+static void spinNs( uint64_t Ns )
+{
+	uint64_t start = HostTimeNs();
+	while((HostTimeNs() - start) < Ns);
+}
+
+/**
+ * critical sections of loadNs, with as long again outside of them
+ */
+static void loadTask( void* NotUsed )
+{
+	while(1)
+	{
+		uint64_t ns = loadNs;
+
+		taskENTER_CRITICAL();
+		spinNs(ns);
+		taskEXIT_CRITICAL();
+		spinNs(ns);
+	}
+}
+
+static void wakeTask( void* NotUsed )
+{
+	for(uint32_t i = 0; i < NUM_LOADS; i++)
+	{
+		SimResult_t* result = &results[i];
+
+		LatencyHistReset(&result->Entry);
+		LatencyHistReset(&result->Isr);
+		LatencyHistReset(&result->Wake);
+		result->Missed = 0;
+		loadNs = loadsUs[i] * 1000ULL;
+		eventPending = 0;
+
+		taskENTER_CRITICAL();
+		running = result;
+		nextCompareNs = HostTimeNs() + PERIOD_NS;
+		armTim9(nextCompareNs);
+		taskEXIT_CRITICAL();
+
+		while(result->Wake.Count < eventsPerRun)
+		{
+			configASSERT(ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000)) != 0);
+			LatencyHistRecord(&result->Wake, (uint32_t)(HostTimeNs() - lastEventNs));
+			eventPending = 0;
+		}
+
+		taskENTER_CRITICAL();
+		running = NULL;
+		stopTim9();
+		taskEXIT_CRITICAL();
+		ulTaskNotifyTake(pdTRUE, 0);
+	}
+
+	vTaskEndScheduler();
+}
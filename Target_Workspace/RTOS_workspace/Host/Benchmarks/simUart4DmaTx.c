@@ -0,0 +1,315 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2019 Brian Amos
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <stm32f7xx_hal.h>
+#include <Uart4DmaTx.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "HostSupport.h"
+
+/*********************************************
+ * Simulation of BSP/Uart4DmaTx.c at line rate
+ *
+ * Several producer tasks queue framed messages of random
+ * length as fast as the engine will accept them, while a
+ * lower priority "line" task models DMA1_Stream4 feeding
+ * UART4 (the producers run at a higher priority so they
+ * refill the stream buffer as soon as the ISR frees room,
+ * the same as producers running alongside the DMA controller
+ * on the target would).  Every
+ * RTOS tick it moves one tick's worth of characters at the
+ * simulated baudrate onto the line (register level fake,
+ * see Tests/Fakes) and calls the engine's ISR each time a
+ * DMA transfer completes.
+ *
+ * For each baudrate the simulation reports how much of the
+ * available line time was used, how many bytes each DMA
+ * transfer (and therefore each interrupt) carried and the
+ * host CPU time spent in the ISR per byte.  Every frame is
+ * checked on the way out, so interleaved or corrupted
+ * messages fail the run.
+ *
+ * usage: simUart4DmaTx [ticksPerRun]
+ *********************************************/
+
+#define STACK_SIZE 256
+#define NUM_PRODUCERS 3
+#define MAX_PAYLOAD 60
+#define FRAME_SYNC 0xA5
+#define FRAME_HEADER_LEN 4
+#define DEFAULT_TICKS 1000
+
+static const uint32_t baudrates[] = { 115200, 460800, 921600, 2000000 };
+#define NUM_BAUDRATES (sizeof(baudrates)/sizeof(baudrates[0]))
+
+typedef struct
+{
+	uint64_t Bytes;
+	uint64_t LineSlots;
+	uint64_t Isrs;
+	uint64_t IsrNs;
+	Uart4DmaTxStats_t EngineStats;
+}SimResult_t;
+
+static SimResult_t results[NUM_BAUDRATES];
+static uint32_t currentBaudrate;
+static TickType_t ticksPerRun = DEFAULT_TICKS;
+static volatile bool producersRunning = false;
+static volatile bool lineRunning = false;
+static volatile bool dataCorrupt = false;
+static TaskHandle_t controlTaskHandle = NULL;
+
+void controlTask( void* NotUsed );
+void producerTask( void* Id );
+void lineTask( void* NotUsed );
+
+int main( int argc, char* argv[] )
+{
+	if(argc > 1)
+	{
+		ticksPerRun = (TickType_t)strtoul(argv[1], NULL, 0);
+	}
+
+	configASSERT(xTaskCreate(controlTask, "control", STACK_SIZE, NULL, tskIDLE_PRIORITY + 4, &controlTaskHandle) == pdPASS);
+	vTaskStartScheduler();
+
+	printf("baudrate,bytes_per_tick,bytes,line_utilisation,transfers,avg_transfer_len,isr_per_byte,isr_ns_per_byte\n");
+	for(size_t i = 0; i < NUM_BAUDRATES; i++)
+	{
+		SimResult_t const* result = &results[i];
+
+		printf("%lu,%.1f,%llu,%.3f,%lu,%.1f,%.4f,%.2f\n",
+				(unsigned long)baudrates[i],
+				(double)result->LineSlots / (double)ticksPerRun,
+				(unsigned long long)result->Bytes,
+				(double)result->Bytes / (double)result->LineSlots,
+				(unsigned long)result->EngineStats.Transfers,
+				(double)result->Bytes / (double)result->EngineStats.Transfers,
+				(double)result->Isrs / (double)result->Bytes,
+				(double)result->IsrNs / (double)result->Bytes);
+	}
+
+	if(dataCorrupt)
+	{
+		fprintf(stderr, "corrupted frame on the line\n");
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * runs the simulation once for each baudrate
+ */
+void controlTask( void* NotUsed )
+{
+	TaskHandle_t line, producers[NUM_PRODUCERS];
+
+	for(size_t i = 0; i < NUM_BAUDRATES; i++)
+	{
+		currentBaudrate = baudrates[i];
+		FakeStm32Reset();
+		Uart4DmaTxStart(currentBaudrate);
+
+		lineRunning = true;
+		producersRunning = true;
+		configASSERT(xTaskCreate(lineTask, "line", STACK_SIZE, &results[i], tskIDLE_PRIORITY + 2, &line) == pdPASS);
+		for(uintptr_t id = 0; id < NUM_PRODUCERS; id++)
+		{
+			configASSERT(xTaskCreate(producerTask, "producer", STACK_SIZE, (void*)id, tskIDLE_PRIORITY + 3, &producers[id]) == pdPASS);
+		}
+
+		//the line task signals once it has simulated ticksPerRun ticks
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		producersRunning = false;
+		Uart4DmaTxGetStats(&results[i].EngineStats);
+
+		//each task signals once it has parked - a producer deleted while
+		//it holds the engine's mutex or waits for room in the stream buffer
+		//would be woken by the ISR after its TCB was freed.  The line keeps
+		//draining until every producer has finished its last frame.
+		for(size_t id = 0; id < NUM_PRODUCERS; id++)
+		{
+			ulTaskNotifyTake(pdFALSE, portMAX_DELAY);
+		}
+		for(size_t id = 0; id < NUM_PRODUCERS; id++)
+		{
+			vTaskDelete(producers[id]);
+		}
+		lineRunning = false;
+		ulTaskNotifyTake(pdFALSE, portMAX_DELAY);
+		vTaskDelete(line);
+		Uart4DmaTxStop();
+		vTaskDelay(2);
+	}
+
+	vTaskEndScheduler();
+}
+
+/**
+ * queues frames of [sync][id][seq][len][payload] until told to stop
+ */
+void producerTask( void* Id )
+{
+	uint8_t id = (uint8_t)(uintptr_t)Id;
+	uint8_t seq = 0;
+	uint8_t frame[FRAME_HEADER_LEN + MAX_PAYLOAD];
+	uint32_t seed = 0x1234567 * (id + 1);
+
+	while(producersRunning)
+	{
+		uint8_t len = 1 + (uint8_t)(rand_r(&seed) % MAX_PAYLOAD);
+
+		frame[0] = FRAME_SYNC;
+		frame[1] = id;
+		frame[2] = seq;
+		frame[3] = len;
+		for(uint8_t i = 0; i < len; i++)
+		{
+			frame[FRAME_HEADER_LEN + i] = (uint8_t)(id * 31 + seq + i);
+		}
+		configASSERT(Uart4DmaTxSend(frame, FRAME_HEADER_LEN + len, portMAX_DELAY) == FRAME_HEADER_LEN + len);
+		seq++;
+	}
+
+	xTaskNotifyGive(controlTaskHandle);
+	vTaskSuspend(NULL);
+}
+
+static uint8_t expectedSeq[NUM_PRODUCERS];
+static uint8_t header[FRAME_HEADER_LEN];
+static size_t pos = 0;
+
+/**
+ * checks each byte coming off the line against the frame format
+ */
+static void checkLineByte( uint8_t Byte )
+{
+	if(pos < FRAME_HEADER_LEN)
+	{
+		header[pos++] = Byte;
+		if(pos == 1 && Byte != FRAME_SYNC)
+		{
+			dataCorrupt = true;
+		}
+		if(pos == FRAME_HEADER_LEN)
+		{
+			if(header[1] >= NUM_PRODUCERS || header[2] != expectedSeq[header[1]] ||
+				header[3] == 0 || header[3] > MAX_PAYLOAD)
+			{
+				dataCorrupt = true;
+				pos = 0;
+				return;
+			}
+			expectedSeq[header[1]]++;
+		}
+		return;
+	}
+
+	if(Byte != (uint8_t)(header[1] * 31 + header[2] + (pos - FRAME_HEADER_LEN)))
+	{
+		dataCorrupt = true;
+	}
+	if(++pos == FRAME_HEADER_LEN + header[3])
+	{
+		pos = 0;
+	}
+}
+
+/**
+ * models UART4 + DMA1_Stream4 - one RTOS tick of characters at a time
+ */
+void lineTask( void* Result )
+{
+	SimResult_t* result = (SimResult_t*)Result;
+	static uint8_t lineBuff[4096];
+	//characters per tick in 1/1000ths (8N1 = 10 bits per character)
+	uint64_t milliCharsPerTick = (uint64_t)currentBaudrate * 1000 / 10 / configTICK_RATE_HZ;
+	uint64_t milliChars = 0;
+	TickType_t lastWake = xTaskGetTickCount();
+
+	//fresh producers start their sequence numbers over
+	memset(expectedSeq, 0, sizeof(expectedSeq));
+	pos = 0;
+
+	for(TickType_t tick = 0; lineRunning; tick++)
+	{
+		size_t slots, moved = 0;
+
+		vTaskDelayUntil(&lastWake, 1);
+		milliChars += milliCharsPerTick;
+		slots = (size_t)(milliChars / 1000);
+		milliChars %= 1000;
+
+		while(moved < slots && (DMA1_Stream4->CR & DMA_SxCR_EN))
+		{
+			size_t n = FakeDmaTransmit(DMA1_Stream4, &lineBuff[moved], slots - moved);
+
+			moved += n;
+			if(DMA1->HISR & (DMA_HISR_TCIF4 | DMA_HISR_TEIF4))
+			{
+				BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+				uint64_t start, isrNs;
+
+				//portSET_INTERRUPT_MASK_FROM_ISR is a no-op on the Posix port
+				//(signal handlers already run masked), so mask the tick here
+				//or it can land in the middle of a ready list update
+				portDISABLE_INTERRUPTS();
+				start = HostTimeNs();
+				Uart4DmaTxDmaIsr(&xHigherPriorityTaskWoken);
+				FakeStm32ApplyClears();
+				isrNs = HostTimeNs() - start;
+				portENABLE_INTERRUPTS();
+				if(producersRunning)
+				{
+					result->IsrNs += isrNs;
+					result->Isrs++;
+				}
+				portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+			}
+		}
+
+		for(size_t i = 0; i < moved; i++)
+		{
+			checkLineByte(lineBuff[i]);
+		}
+
+		if(producersRunning)
+		{
+			result->LineSlots += slots;
+			result->Bytes += moved;
+			if(tick + 1 == ticksPerRun)
+			{
+				xTaskNotifyGive(controlTaskHandle);
+			}
+		}
+	}
+
+	xTaskNotifyGive(controlTaskHandle);
+	vTaskSuspend(NULL);
+}
@@ -0,0 +1,107 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Brian Amos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libgen.h>
+#include "HostTrace.h"
+#include "SEGGER_SYSVIEW.h"
+#include "StubBsp.h"
+
+/*********************************************
+ * Runs one of the chapter mains on the Posix port for
+ * a fixed time, then reports what the kernel did.
+ *
+ * Each chapter main is built with main renamed to
+ * ChapterMain.  Before calling it, a "hostRun" task is
+ * created at the highest priority - once the run time
+ * is up it freezes the scheduler, prints the report
+ * and exits (the chapter mains never return from
+ * vTaskStartScheduler).
+ *
+ * The report is a set of CSV tables separated by blank
+ * lines: a summary, context switches/CPU time/IPC
+ * latency per task (see HostTrace.h), the IPC latency
+ * histogram and the LED activity.
+ *
+ * usage: <chapter main> [runMs] [-v]
+ * 		-v also dumps the last SEGGER_SYSVIEW_PrintfHost messages
+ *********************************************/
+
+#define DEFAULT_RUN_MS 2000
+
+int ChapterMain( void );
+
+static uint32_t runMs = DEFAULT_RUN_MS;
+static int verbose = 0;
+static char const* chapterName = "";
+
+static void hostRunTask( void* NotUsed );
+
+int main( int argc, char* argv[] )
+{
+	chapterName = basename(argv[0]);
+	for(int i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "-v") == 0)
+		{
+			verbose = 1;
+		}
+		else
+		{
+			runMs = (uint32_t)strtoul(argv[i], NULL, 0);
+		}
+	}
+
+	configASSERT(xTaskCreate(hostRunTask, "hostRun", configMINIMAL_STACK_SIZE, NULL, configMAX_PRIORITIES - 1, NULL) == pdPASS);
+
+	return ChapterMain();
+}
+
+static void hostRunTask( void* NotUsed )
+{
+	vTaskDelay(pdMS_TO_TICKS(runMs));
+
+	//nothing else runs (or is traced) while the report is written
+	vTaskSuspendAll();
+
+	printf("chapter,run_ms,sysview_messages\n");
+	printf("%s,%lu,%lu\n\n", chapterName, (unsigned long)runMs, (unsigned long)SysViewHostNumMessages());
+	HostTraceReport(stdout);
+	printf("\n");
+	StubBspReport(stdout);
+
+	if(verbose)
+	{
+		printf("\n");
+		SysViewHostDumpMessages(stdout);
+	}
+
+	fflush(stdout);
+	exit(0);
+}
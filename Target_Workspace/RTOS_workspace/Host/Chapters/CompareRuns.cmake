@@ -0,0 +1,52 @@
+# cmake -DCOMMAND=<chapter main> -DARGS=<args> -P CompareRuns.cmake
+#
+# Runs a virtual time chapter main twice and fails unless both runs report the
+# same events.  CPU time, traced time and IPC latency are host time, so only
+# the event columns are compared: the summary, context switch and wakeup
+# counts, the LEDs and the SysView messages.
+
+function( run_chapter out_var )
+    execute_process( COMMAND ${COMMAND} ${ARGS}
+                     OUTPUT_VARIABLE output
+                     RESULT_VARIABLE result )
+    if( NOT result EQUAL 0 )
+        message( FATAL_ERROR "${COMMAND} failed (${result}):\n${output}" )
+    endif()
+
+    string( REPLACE ";" "," output "${output}" )
+    string( REPLACE "\n" ";" lines "${output}" )
+    set( events "" )
+    set( table "" )
+    foreach( line IN LISTS lines )
+        if( line STREQUAL "" )
+            set( table "" )
+            continue()
+        elseif( table STREQUAL "" )
+            # Each table starts with its header line.
+            string( REGEX REPLACE ",.*" "" table "${line}" )
+        endif()
+
+        string( REPLACE "," ";" fields "${line}" )
+        if( table STREQUAL "context_switches" )
+            # context_switches,traced_ms
+            list( GET fields 0 line )
+        elseif( table STREQUAL "task" )
+            # task,priority,switch_ins,cpu_ms,cpu_pct,ipc_wakeups,...
+            list( GET fields 0 1 2 5 fields )
+            string( REPLACE ";" "," line "${fields}" )
+        elseif( table STREQUAL "ipc_latency_ns_from" )
+            continue()
+        endif()
+        string( APPEND events "${line}\n" )
+    endforeach()
+
+    set( ${out_var} "${events}" PARENT_SCOPE )
+endfunction()
+
+run_chapter( first )
+run_chapter( second )
+
+if( NOT first STREQUAL second )
+    message( FATAL_ERROR "runs differ:\n--- first\n${first}\n--- second\n${second}" )
+endif()
+message( "${first}" )
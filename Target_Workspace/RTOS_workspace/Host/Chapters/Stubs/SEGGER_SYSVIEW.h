@@ -0,0 +1,101 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Brian Amos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef HOST_CHAPTERS_STUBS_SEGGER_SYSVIEW_H_
+#define HOST_CHAPTERS_STUBS_SEGGER_SYSVIEW_H_
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * Host stand in for the SEGGER SystemView API used by the chapter mains.
+ *
+ * Instead of going out over RTT, messages are formatted into a ring of
+ * the most recent SYSVIEW_HOST_NUM_MESSAGES messages in memory (so a run
+ * pays for the formatting, as on the target, without flooding stdout).
+ * Kernel events are recorded by the HostTrace hooks.
+ */
+
+#define SYSVIEW_HOST_NUM_MESSAGES 32
+#define SYSVIEW_HOST_MESSAGE_LEN 80
+
+void SEGGER_SYSVIEW_Conf( void );
+void SEGGER_SYSVIEW_PrintfHost( const char* s, ... );
+void SEGGER_SYSVIEW_Print( const char* s );
+
+/**
+ * heap events (sent by Drivers/HandsOnRTOS/HeapProfiler.c) are only counted
+ */
+void SEGGER_SYSVIEW_HeapDefine( void* pHeap, void* pBase, unsigned int HeapSize, unsigned int MetadataSize );
+void SEGGER_SYSVIEW_HeapAllocEx( void* pHeap, void* pUserData, unsigned int UserDataLen, unsigned int Tag );
+void SEGGER_SYSVIEW_HeapFree( void* pHeap, void* pUserData );
+
+/**
+ * module events (the RunTimeStats.c task records) are only counted
+ */
+typedef uint32_t U32;
+typedef struct SEGGER_SYSVIEW_MODULE_STRUCT SEGGER_SYSVIEW_MODULE;
+struct SEGGER_SYSVIEW_MODULE_STRUCT
+{
+	const char* sModule;
+	U32 NumEvents;
+	U32 EventOffset;
+	void (*pfSendModuleDesc)( void );
+	SEGGER_SYSVIEW_MODULE* pNext;
+};
+void SEGGER_SYSVIEW_RegisterModule( SEGGER_SYSVIEW_MODULE* pModule );
+void SEGGER_SYSVIEW_RecordU32x5( unsigned int EventId, U32 Para0, U32 Para1, U32 Para2, U32 Para3, U32 Para4 );
+U32 SEGGER_SYSVIEW_ShrinkId( U32 Id );
+
+/**
+ * @returns the total number of messages recorded
+ */
+uint32_t SysViewHostNumMessages( void );
+
+/**
+ * prints the messages still held in memory, oldest first
+ */
+void SysViewHostDumpMessages( FILE* Out );
+
+/**
+ * @returns the number of HeapAllocEx/HeapFree events recorded
+ */
+uint32_t SysViewHostNumHeapAllocs( void );
+uint32_t SysViewHostNumHeapFrees( void );
+
+/**
+ * @returns the number of module events recorded, and the last one
+ * 			(Para[0..4])
+ */
+uint32_t SysViewHostNumModuleEvents( void );
+void SysViewHostLastModuleEvent( unsigned int* EventId, U32 Para[5] );
+
+#ifdef __cplusplus
+ }
+#endif
+#endif /* HOST_CHAPTERS_STUBS_SEGGER_SYSVIEW_H_ */
@@ -0,0 +1,99 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Brian Amos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <Nucleo_F767ZI_GPIO.h>
+#include <Nucleo_F767ZI_Init.h>
+#include <FreeRTOS.h>
+#include <timers.h>
+#include <stdlib.h>
+#include "StubBsp.h"
+
+/*********************************************
+ * Stub BSP for the host chapter builds (see StubBsp.h)
+ *********************************************/
+
+typedef struct
+{
+	uint32_t Ons;
+	uint32_t Offs;
+}LedCounts_t;
+
+static LedCounts_t blue, green, red;
+static volatile uint_fast8_t buttonPressed = 0;
+
+static void blueOn( void ){ blue.Ons++; }
+static void blueOff( void ){ blue.Offs++; }
+static void greenOn( void ){ green.Ons++; }
+static void greenOff( void ){ green.Offs++; }
+static void redOn( void ){ red.Ons++; }
+static void redOff( void ){ red.Offs++; }
+
+LED BlueLed = { blueOn, blueOff };
+LED GreenLed = { greenOn, greenOff };
+LED RedLed = { redOn, redOff };
+
+static void buttonPressCallback( TimerHandle_t NotUsed )
+{
+	buttonPressed = 1;
+}
+
+void HWInit( void )
+{
+	TimerHandle_t buttonTimer;
+
+	srand(1);
+
+	//the press is a timer rather than a check of the host clock, so it's
+	//an event virtual time (configUSE_VIRTUAL_TIME) can jump to
+	buttonTimer = xTimerCreate("button", pdMS_TO_TICKS(STUB_BSP_BUTTON_PRESS_MS), pdFALSE, NULL, buttonPressCallback);
+	configASSERT(buttonTimer != NULL);
+	configASSERT(xTimerStart(buttonTimer, 0) == pdPASS);
+}
+
+void PWMInit( void )
+{
+}
+
+/**
+ * same (Min, Max) argument order and distribution as the
+ * RNG based version in Nucleo_F767ZI_Init.c
+ */
+uint32_t StmRand( uint32_t Min, uint32_t Max )
+{
+	return (uint32_t)rand() % Max + Min;
+}
+
+uint_fast8_t ReadPushButton( void )
+{
+	return buttonPressed;
+}
+
+void StubBspReport( FILE* Out )
+{
+	fprintf(Out, "led,ons,offs\n");
+	fprintf(Out, "blue,%lu,%lu\n", (unsigned long)blue.Ons, (unsigned long)blue.Offs);
+	fprintf(Out, "green,%lu,%lu\n", (unsigned long)green.Ons, (unsigned long)green.Offs);
+	fprintf(Out, "red,%lu,%lu\n", (unsigned long)red.Ons, (unsigned long)red.Offs);
+}
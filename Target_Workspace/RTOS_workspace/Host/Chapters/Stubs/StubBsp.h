@@ -0,0 +1,54 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Brian Amos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef HOST_CHAPTERS_STUBS_STUBBSP_H_
+#define HOST_CHAPTERS_STUBS_STUBBSP_H_
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include <stdio.h>
+
+/**
+ * Host versions of BSP/Nucleo_F767ZI_Init.c and BSP/Nucleo_F767ZI_GPIO.c.
+ *
+ * LEDs only count how often they are turned on and off, StmRand is a
+ * seeded (so repeatable) pseudo random sequence and the push button
+ * reads as pressed from STUB_BSP_BUTTON_PRESS_MS after the scheduler
+ * starts onwards - the user pressing the button shortly after reset.
+ * The press comes from a one-shot software timer HWInit creates.
+ */
+
+#define STUB_BSP_BUTTON_PRESS_MS 100
+
+/**
+ * prints how many times each LED was switched on and off
+ */
+void StubBspReport( FILE* Out );
+
+#ifdef __cplusplus
+ }
+#endif
+#endif /* HOST_CHAPTERS_STUBS_STUBBSP_H_ */
@@ -0,0 +1,179 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Brian Amos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <string.h>
+#include "SEGGER_SYSVIEW.h"
+
+/*********************************************
+ * In memory SEGGER_SYSVIEW_PrintfHost for the host
+ * chapter builds (see SEGGER_SYSVIEW.h)
+ *********************************************/
+
+static char messages[SYSVIEW_HOST_NUM_MESSAGES][SYSVIEW_HOST_MESSAGE_LEN];
+static uint32_t numMessages = 0;
+static bool configured = false;
+static uint32_t numHeapAllocs = 0;
+static uint32_t numHeapFrees = 0;
+static uint32_t numModuleEvents = 0;
+static unsigned int lastModuleEventId;
+static U32 lastModuleEventParams[5];
+//SystemView's own module events start after its predefined ones
+static U32 nextModuleEventId = 512;
+
+void SEGGER_SYSVIEW_Conf( void )
+{
+	configured = true;
+}
+
+void SEGGER_SYSVIEW_PrintfHost( const char* s, ... )
+{
+	va_list args;
+	char* dst;
+
+	//messages are only recorded once SystemView is running, as on the target
+	if(!configured)
+	{
+		return;
+	}
+
+	vTaskSuspendAll();
+	dst = messages[numMessages++ % SYSVIEW_HOST_NUM_MESSAGES];
+	va_start(args, s);
+	vsnprintf(dst, SYSVIEW_HOST_MESSAGE_LEN, s, args);
+	va_end(args);
+	xTaskResumeAll();
+}
+
+void SEGGER_SYSVIEW_Print( const char* s )
+{
+	SEGGER_SYSVIEW_PrintfHost("%s", s);
+}
+
+void SEGGER_SYSVIEW_HeapDefine( void* pHeap, void* pBase, unsigned int HeapSize, unsigned int MetadataSize )
+{
+	(void)pHeap;
+	(void)pBase;
+	(void)HeapSize;
+	(void)MetadataSize;
+}
+
+//the heap hooks run with the scheduler suspended already
+void SEGGER_SYSVIEW_HeapAllocEx( void* pHeap, void* pUserData, unsigned int UserDataLen, unsigned int Tag )
+{
+	(void)pHeap;
+	(void)pUserData;
+	(void)UserDataLen;
+	(void)Tag;
+	if(configured)
+	{
+		numHeapAllocs++;
+	}
+}
+
+void SEGGER_SYSVIEW_HeapFree( void* pHeap, void* pUserData )
+{
+	(void)pHeap;
+	(void)pUserData;
+	if(configured)
+	{
+		numHeapFrees++;
+	}
+}
+
+void SEGGER_SYSVIEW_RegisterModule( SEGGER_SYSVIEW_MODULE* pModule )
+{
+	pModule->EventOffset = nextModuleEventId;
+	nextModuleEventId += pModule->NumEvents;
+}
+
+void SEGGER_SYSVIEW_RecordU32x5( unsigned int EventId, U32 Para0, U32 Para1, U32 Para2, U32 Para3, U32 Para4 )
+{
+	if(!configured)
+	{
+		return;
+	}
+	vTaskSuspendAll();
+	numModuleEvents++;
+	lastModuleEventId = EventId;
+	lastModuleEventParams[0] = Para0;
+	lastModuleEventParams[1] = Para1;
+	lastModuleEventParams[2] = Para2;
+	lastModuleEventParams[3] = Para3;
+	lastModuleEventParams[4] = Para4;
+	xTaskResumeAll();
+}
+
+U32 SEGGER_SYSVIEW_ShrinkId( U32 Id )
+{
+	return Id;
+}
+
+uint32_t SysViewHostNumModuleEvents( void )
+{
+	return numModuleEvents;
+}
+
+void SysViewHostLastModuleEvent( unsigned int* EventId, U32 Para[5] )
+{
+	*EventId = lastModuleEventId;
+	memcpy(Para, lastModuleEventParams, sizeof(lastModuleEventParams));
+}
+
+uint32_t SysViewHostNumHeapAllocs( void )
+{
+	return numHeapAllocs;
+}
+
+uint32_t SysViewHostNumHeapFrees( void )
+{
+	return numHeapFrees;
+}
+
+uint32_t SysViewHostNumMessages( void )
+{
+	return numMessages;
+}
+
+void SysViewHostDumpMessages( FILE* Out )
+{
+	uint32_t first = 0;
+
+	if(numMessages > SYSVIEW_HOST_NUM_MESSAGES)
+	{
+		first = numMessages - SYSVIEW_HOST_NUM_MESSAGES;
+	}
+	for(uint32_t i = first; i < numMessages; i++)
+	{
+		char const* msg = messages[i % SYSVIEW_HOST_NUM_MESSAGES];
+		size_t len = strlen(msg);
+
+		//most of the chapter messages already end in a newline
+		fprintf(Out, "%lu: %s%s", (unsigned long)i, msg, (len > 0 && msg[len - 1] == '\n') ? "" : "\n");
+	}
+}
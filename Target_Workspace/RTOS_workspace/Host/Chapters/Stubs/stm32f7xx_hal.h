@@ -0,0 +1,49 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Brian Amos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef HOST_CHAPTERS_STUBS_STM32F7XX_HAL_H_
+#define HOST_CHAPTERS_STUBS_STM32F7XX_HAL_H_
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include <FreeRTOS.h>
+#include <stdint.h>
+
+/**
+ * The parts of the STM32F7 HAL the chapter mains use directly.  There is no
+ * NVIC on the host, so setting the priority grouping does nothing.
+ */
+
+#define NVIC_PRIORITYGROUP_4	0x00000003U
+
+#define HAL_NVIC_SetPriorityGrouping(PriorityGroup)	((void)(PriorityGroup))
+
+#define assert_param(expr) configASSERT(expr)
+
+#ifdef __cplusplus
+ }
+#endif
+#endif /* HOST_CHAPTERS_STUBS_STM32F7XX_HAL_H_ */
@@ -0,0 +1,183 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Brian Amos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+/*-----------------------------------------------------------
+ * Host (Posix port) definitions.
+ *
+ * These mirror the chapter FreeRTOSConfig.h files as closely as possible so
+ * code built on the host behaves the same as it does on the Nucleo board.
+ * Cortex-M specific settings (interrupt priorities, handler names) have no
+ * meaning on the Posix port and are left out.
+ *----------------------------------------------------------*/
+
+#include <stdint.h>
+
+#define configUSE_PREEMPTION                     1
+#define configSUPPORT_STATIC_ALLOCATION          1
+//0 for the static only kernel, which is built without a heap
+#ifndef configSUPPORT_DYNAMIC_ALLOCATION
+#define configSUPPORT_DYNAMIC_ALLOCATION         1
+#endif
+//virtual time (see the Posix port's portmacro.h) is moved on from the idle hook
+#ifndef configUSE_VIRTUAL_TIME
+#define configUSE_VIRTUAL_TIME                   0
+#endif
+#define configUSE_IDLE_HOOK                      configUSE_VIRTUAL_TIME
+//tickless idle sleeps the host thread instead of spinning in the idle task,
+//virtual time skips idle time altogether so doesn't need it
+#ifndef configUSE_TICKLESS_IDLE
+#if configUSE_VIRTUAL_TIME == 1
+#define configUSE_TICKLESS_IDLE                  0
+#else
+#define configUSE_TICKLESS_IDLE                  1
+#endif
+#endif
+#define configUSE_TICK_HOOK                      0
+#define configTICK_RATE_HZ                       ((TickType_t)1000)
+//benchTaskSelection rebuilds the kernel with other priority counts and
+//selection methods, so these two can be set on the compiler command line
+#ifndef configMAX_PRIORITIES
+#define configMAX_PRIORITIES                     ( 7 )
+#endif
+//the Posix port runs each task in its own pthread with its own host stack,
+//the FreeRTOS stack only needs to hold the port's thread bookkeeping
+#define configMINIMAL_STACK_SIZE                 ((uint16_t)128)
+//benchHeapAllocators and testHeap6 rebuild the kernel with smaller heaps
+#ifndef configTOTAL_HEAP_SIZE
+#define configTOTAL_HEAP_SIZE                    ((size_t)(256 * 1024))
+#endif
+#define configMAX_TASK_NAME_LEN                  ( 16 )
+#define configUSE_TRACE_FACILITY                 1
+#define configUSE_16_BIT_TICKS                   0
+#define configUSE_MUTEXES                        1
+#define configQUEUE_REGISTRY_SIZE                8
+#define configUSE_RECURSIVE_MUTEXES              1
+#define configUSE_COUNTING_SEMAPHORES            1
+#define configUSE_PORT_OPTIMISED_TASK_SELECTION  0
+#ifndef configUSE_BITMAP_TASK_SELECTION
+#define configUSE_BITMAP_TASK_SELECTION          1
+#endif
+#define configSTACK_DEPTH_TYPE                   uint32_t
+
+/* Co-routine definitions. */
+#define configUSE_CO_ROUTINES                    0
+#define configMAX_CO_ROUTINE_PRIORITIES          ( 2 )
+
+/* Software timer definitions. */
+#define configUSE_TIMERS                         1
+#define configTIMER_TASK_PRIORITY                ( 2 )
+#define configTIMER_QUEUE_LENGTH                 10
+#define configTIMER_TASK_STACK_DEPTH             256
+
+/* Set the following definitions to 1 to include the API function, or zero
+to exclude the API function. */
+#define INCLUDE_vTaskPrioritySet                1
+#define INCLUDE_uxTaskPriorityGet               1
+#define INCLUDE_vTaskDelete                     1
+#define INCLUDE_vTaskCleanUpResources           0
+#define INCLUDE_vTaskSuspend                    1
+#define INCLUDE_vTaskDelayUntil                 1
+#define INCLUDE_vTaskDelay                      1
+#define INCLUDE_xTaskGetSchedulerState          1
+#define INCLUDE_xTimerPendFunctionCall          1
+#define INCLUDE_xQueueGetMutexHolder            1
+#define INCLUDE_uxTaskGetStackHighWaterMark     1
+#define INCLUDE_eTaskGetState                   1
+#define INCLUDE_xTaskGetIdleTaskHandle          1
+#define INCLUDE_xTimerGetTimerDaemonTaskHandle  1
+#define INCLUDE_xTaskGetCurrentTaskHandle       1
+
+#define configUSE_TASK_NOTIFICATIONS            1
+
+/* Run time and task stats gathering related definitions. */
+#define configGENERATE_RUN_TIME_STATS           0
+#define configUSE_STATS_FORMATTING_FUNCTIONS    1
+
+/* Normal assert() semantics, reported through the host's stderr rather than
+spinning forever so a failing benchmark or test ends the run. */
+void vAssertCalled( const char * const pcFileName, unsigned long ulLine );
+#define configASSERT( x ) if ((x) == 0) { vAssertCalled( __FILE__, __LINE__ ); }
+
+/* The chapter builds record kernel activity in memory, the host equivalent of
+including SEGGER_SYSVIEW_FreeRTOS.h on the target. */
+#if defined(HOST_TRACE) && (HOST_TRACE == 1)
+#include "HostTrace.h"
+#endif
+
+/* benchTaskSelection times taskSELECT_HIGHEST_PRIORITY_TASK(), which is the
+only thing vTaskSwitchContext() does between these two hooks on the host. */
+#if defined(HOST_SELECT_TIMING) && (HOST_SELECT_TIMING == 1)
+void HostSelectTimingStart( void );
+void HostSelectTimingStop( void );
+#define traceTASK_SWITCHED_OUT()  HostSelectTimingStart()
+#define traceTASK_SWITCHED_IN()   HostSelectTimingStop()
+#endif
+
+/* benchDelayedTasks times adding the running task to the delayed task
+lists (or wheel) and the tick's pass over the tasks due to unblock. */
+#if defined(HOST_DELAYED_TIMING) && (HOST_DELAYED_TIMING == 1)
+void HostDelayedTimingInsertStart( void );
+void HostDelayedTimingInsertStop( void );
+void HostDelayedTimingUnblockStart( void );
+void HostDelayedTimingUnblockStop( void );
+#define traceADD_TO_DELAYED_LIST_BEGIN()    HostDelayedTimingInsertStart()
+#define traceADD_TO_DELAYED_LIST_END()      HostDelayedTimingInsertStop()
+#define traceUNBLOCK_DELAYED_TASKS_BEGIN()  HostDelayedTimingUnblockStart()
+#define traceUNBLOCK_DELAYED_TASKS_END()    HostDelayedTimingUnblockStop()
+#endif
+
+/* The allocator hooks go to the heap profiler (Drivers/HandsOnRTOS/
+HeapProfiler.c), as SYSVIEW_FREERTOS_HEAP_PROFILER does on the target. */
+#if defined(HOST_HEAP_PROFILER) && (HOST_HEAP_PROFILER == 1)
+#include <stddef.h>
+void HeapProfilerHeapInit( void* Start, size_t HeapSize, size_t BlockOverhead );
+void HeapProfilerMalloc( void* Address, size_t WantedSize, size_t BlockSize, void const* Caller );
+void HeapProfilerFree( void* Address, size_t BlockSize );
+#define traceHEAP_INIT( pvStart, xHeapSize, xBlockOverhead )              HeapProfilerHeapInit( pvStart, xHeapSize, xBlockOverhead )
+#define traceMALLOC_FROM( pvAddress, xWantedSize, xBlockSize, pvCaller )   HeapProfilerMalloc( pvAddress, xWantedSize, xBlockSize, pvCaller )
+#define traceFREE( pvAddress, uiSize )                                    HeapProfilerFree( pvAddress, uiSize )
+#endif
+
+/* Task switches, readying and deletion go to the run time statistics
+(Drivers/HandsOnRTOS/RunTimeStats.c), as SYSVIEW_FREERTOS_RUN_TIME_STATS
+does on the target.  Ready tasks moved between priorities aren't readied. */
+#if defined(HOST_RUN_TIME_STATS) && (HOST_RUN_TIME_STATS == 1)
+void RunTimeStatsSwitchedOut( void* Task );
+void RunTimeStatsSwitchedIn( void* Task );
+void RunTimeStatsReady( void* Task );
+void RunTimeStatsTaskDeleted( void* Task );
+#define traceTASK_SWITCHED_OUT()                  RunTimeStatsSwitchedOut( pxCurrentTCB )
+#define traceTASK_SWITCHED_IN()                   RunTimeStatsSwitchedIn( pxCurrentTCB )
+#define traceMOVED_TASK_TO_READY_STATE( pxTCB )   RunTimeStatsReady( pxTCB )
+#define traceREADDED_TASK_TO_READY_STATE( pxTCB )
+#define traceTASK_DELETE( pxTCB )                 RunTimeStatsTaskDeleted( pxTCB )
+/* FreeRTOS+CLI, for the task-stats command */
+#define configCOMMAND_INT_MAX_OUTPUT_SIZE         128
+#endif
+
+#endif /* FREERTOS_CONFIG_H */
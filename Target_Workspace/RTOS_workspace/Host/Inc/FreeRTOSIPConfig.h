@@ -0,0 +1,120 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Brian Amos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef FREERTOS_IP_CONFIG_H
+#define FREERTOS_IP_CONFIG_H
+
+/*-----------------------------------------------------------
+ * FreeRTOS+TCP definitions for the host builds of the stack (the
+ * freertos_plus_tcp_* libraries in CMakeLists.txt).
+ *
+ * Anything a benchmark rebuilds the stack with is wrapped in #ifndef,
+ * so it can be set on the compiler command line.  Logging is off - the
+ * stack's printf calls would otherwise come from several tasks at once.
+ *----------------------------------------------------------*/
+
+#define ipconfigHAS_DEBUG_PRINTF                 0
+#define ipconfigHAS_PRINTF                       0
+
+#define ipconfigBYTE_ORDER                       pdFREERTOS_LITTLE_ENDIAN
+
+/* The host drivers hand the stack frames as they came off the wire, so the
+stack checks the IP and protocol checksums itself. */
+#define ipconfigDRIVER_INCLUDED_RX_IP_CHECKSUM   0
+#define ipconfigDRIVER_INCLUDED_TX_IP_CHECKSUM   0
+#define ipconfigETHERNET_DRIVER_FILTERS_FRAME_TYPES 1
+
+#define ipconfigUSE_DHCP                         0
+#define ipconfigUSE_DNS                          0
+#define ipconfigUSE_LLMNR                        0
+#define ipconfigUSE_NBNS                         0
+#define ipconfigUSE_NETWORK_EVENT_HOOK           1
+#define ipconfigINCLUDE_FULL_INET_ADDR           1
+#define ipconfigSUPPORT_OUTGOING_PINGS           0
+#define ipconfigREPLY_TO_INCOMING_PINGS          1
+
+/* The IP task runs below the driver's receive task (the host's stand-in
+for the MAC interrupt), as it would below the EMAC ISR on a target. */
+#define ipconfigIP_TASK_PRIORITY                 ( configMAX_PRIORITIES - 2 )
+#define ipconfigIP_TASK_STACK_SIZE_WORDS         ( configMINIMAL_STACK_SIZE * 5 )
+#ifndef configMAC_ISR_SIMULATOR_PRIORITY
+#define configMAC_ISR_SIMULATOR_PRIORITY         ( configMAX_PRIORITIES - 1 )
+#endif
+#ifndef configWINDOWS_MAC_INTERRUPT_SIMULATOR_DELAY
+#define configWINDOWS_MAC_INTERRUPT_SIMULATOR_DELAY ( 1 )
+#endif
+
+extern UBaseType_t uxHostIPRand( void );
+#define ipconfigRAND32()                         uxHostIPRand()
+
+#ifndef ipconfigNUM_NETWORK_BUFFER_DESCRIPTORS
+#define ipconfigNUM_NETWORK_BUFFER_DESCRIPTORS   128
+#endif
+#define ipconfigEVENT_QUEUE_LENGTH               ( ipconfigNUM_NETWORK_BUFFER_DESCRIPTORS + 5 )
+#define ipconfigNETWORK_MTU                      1500
+#define ipconfigTCP_MSS                          1460
+
+/* A driver that takes a burst of frames at once passes them to the IP task
+as one chain, see prvHandleEthernetPacket() in FreeRTOS_IP.c. */
+#ifndef ipconfigUSE_LINKED_RX_MESSAGES
+#define ipconfigUSE_LINKED_RX_MESSAGES           1
+#endif
+
+#define ipconfigUSE_TCP                          1
+#define ipconfigUSE_TCP_WIN                      1
+#define ipconfigTCP_TIME_TO_LIVE                 128
+#define ipconfigUDP_TIME_TO_LIVE                 128
+#define ipconfigTCP_RX_BUFFER_LENGTH             ( 4 * ipconfigTCP_MSS )
+#define ipconfigTCP_TX_BUFFER_LENGTH             ( 4 * ipconfigTCP_MSS )
+#define ipconfigTCP_KEEP_ALIVE                   1
+/* seconds.  FreeRTOS+TCP has no persist timer: a sender that misses the
+ * window update after a zero window waits for its next keep-alive, looked
+ * for every tcpMAXIMUM_TCP_WAKEUP_TIME_MS (20s unless defined) */
+#ifndef ipconfigTCP_KEEP_ALIVE_INTERVAL
+#define ipconfigTCP_KEEP_ALIVE_INTERVAL          20
+#endif
+#define ipconfigTCP_HANG_PROTECTION              1
+#define ipconfigTCP_HANG_PROTECTION_TIME         30
+#define ipconfigALLOW_SOCKET_SEND_WITHOUT_BIND   1
+#define ipconfigSOCK_DEFAULT_RECEIVE_BLOCK_TIME  ( pdMS_TO_TICKS( 5000 ) )
+#define ipconfigSOCK_DEFAULT_SEND_BLOCK_TIME     ( pdMS_TO_TICKS( 5000 ) )
+#define ipconfigUDP_MAX_SEND_BLOCK_TIME_TICKS    ( pdMS_TO_TICKS( 5000 ) )
+#define ipconfigUDP_MAX_RX_PACKETS               64
+
+#ifndef ipconfigARP_CACHE_ENTRIES
+#define ipconfigARP_CACHE_ENTRIES                16
+#endif
+#define ipconfigMAX_ARP_RETRANSMISSIONS          5
+#define ipconfigMAX_ARP_AGE                      150
+
+/* on a 64-bit host the padding in front of each frame must hold the
+ * descriptor pointer (FreeRTOS_IPInit asserts it) */
+#define ipconfigPACKET_FILLER_SIZE               2
+#define ipconfigBUFFER_PADDING                   14
+#define ipconfigCHECK_IP_QUEUE_SPACE             1
+#define ipconfigZERO_COPY_RX_DRIVER              0
+#define ipconfigZERO_COPY_TX_DRIVER              0
+
+#endif /* FREERTOS_IP_CONFIG_H */
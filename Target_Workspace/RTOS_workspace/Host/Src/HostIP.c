@@ -0,0 +1,117 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Brian Amos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <FreeRTOS.h>
+#include <event_groups.h>
+#include <FreeRTOS_IP.h>
+#include <string.h>
+#include "HostIP.h"
+#include "HostSupport.h"
+
+/*********************************************
+ * FreeRTOS+TCP callbacks required by the host
+ * FreeRTOSIPConfig.h
+ *********************************************/
+
+#define NETWORK_UP_BIT ( 1 << 0 )
+
+static EventGroupHandle_t networkEvents = NULL;
+static uint64_t randState = 0;
+
+BaseType_t HostIPStart( uint8_t const Mac[ipMAC_ADDRESS_LENGTH_BYTES], uint32_t Address, uint32_t NetMask )
+{
+	uint8_t ip[ipIP_ADDRESS_LENGTH_BYTES];
+	uint8_t mask[ipIP_ADDRESS_LENGTH_BYTES];
+	static const uint8_t none[ipIP_ADDRESS_LENGTH_BYTES] = { 0 };
+
+	//the addresses are in network order, so the first octet is in the lowest byte
+	memcpy(ip, &Address, sizeof(ip));
+	memcpy(mask, &NetMask, sizeof(mask));
+
+	if(networkEvents == NULL)
+	{
+		networkEvents = xEventGroupCreate();
+		configASSERT(networkEvents != NULL);
+	}
+	return FreeRTOS_IPInit(ip, mask, none, none, Mac);
+}
+
+BaseType_t HostIPWaitUp( TickType_t Timeout )
+{
+	return (xEventGroupWaitBits(networkEvents, NETWORK_UP_BIT, pdFALSE, pdTRUE, Timeout) & NETWORK_UP_BIT) != 0;
+}
+
+void vApplicationIPNetworkEventHook( eIPCallbackEvent_t eNetworkEvent )
+{
+	if(eNetworkEvent == eNetworkUp)
+	{
+		xEventGroupSetBits(networkEvents, NETWORK_UP_BIT);
+	}
+	else
+	{
+		xEventGroupClearBits(networkEvents, NETWORK_UP_BIT);
+	}
+}
+
+/**
+ * xorshift64*, good enough for sequence numbers and port choices
+ */
+UBaseType_t uxHostIPRand( void )
+{
+	uint64_t x;
+
+	taskENTER_CRITICAL();
+	if(randState == 0)
+	{
+		randState = HostTimeNs() | 1;
+	}
+	x = randState;
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	randState = x;
+	taskEXIT_CRITICAL();
+
+	return (UBaseType_t)((x * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+BaseType_t xApplicationGetRandomNumber( uint32_t* pulNumber )
+{
+	*pulNumber = (uint32_t)uxHostIPRand();
+	return pdTRUE;
+}
+
+uint32_t ulApplicationGetNextSequenceNumber( uint32_t ulSourceAddress,
+											 uint16_t usSourcePort,
+											 uint32_t ulDestinationAddress,
+											 uint16_t usDestinationPort )
+{
+	(void)ulSourceAddress;
+	(void)usSourcePort;
+	(void)ulDestinationAddress;
+	(void)usDestinationPort;
+
+	return (uint32_t)uxHostIPRand();
+}
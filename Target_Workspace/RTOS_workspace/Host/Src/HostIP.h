@@ -0,0 +1,64 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Brian Amos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef HOST_SRC_HOSTIP_H_
+#define HOST_SRC_HOSTIP_H_
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include <FreeRTOS.h>
+#include <FreeRTOS_IP.h>
+
+/**
+ * Application side of FreeRTOS+TCP for the host builds of the stack:
+ * the hooks FreeRTOSIPConfig.h asks for and a way for a test or
+ * benchmark to start the stack and wait for it to come up.
+ */
+
+/**
+ * start FreeRTOS+TCP with a static address (dotted quads in network
+ * order, as FreeRTOS_inet_addr returns them) and no gateway
+ * @param Mac the node's MAC address
+ * @returns pdPASS if the IP task was created
+ */
+BaseType_t HostIPStart( uint8_t const Mac[ipMAC_ADDRESS_LENGTH_BYTES], uint32_t Address, uint32_t NetMask );
+
+/**
+ * block until the driver has come up and the stack has sent
+ * eNetworkUp to vApplicationIPNetworkEventHook
+ * @returns pdFALSE on a timeout
+ */
+BaseType_t HostIPWaitUp( TickType_t Timeout );
+
+/**
+ * ipconfigRAND32 - seeded from the host clock, not for security
+ */
+UBaseType_t uxHostIPRand( void );
+
+#ifdef __cplusplus
+ }
+#endif
+#endif /* HOST_SRC_HOSTIP_H_ */
@@ -0,0 +1,96 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Brian Amos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "HostSupport.h"
+
+/*********************************************
+ * Kernel callbacks required by the host FreeRTOSConfig.h
+ * along with a few helpers shared by the host benchmarks
+ *********************************************/
+
+void vAssertCalled( const char * const pcFileName, unsigned long ulLine )
+{
+	fprintf(stderr, "ASSERT: %s:%lu\n", pcFileName, ulLine);
+	abort();
+}
+
+void vApplicationMallocFailedHook( void )
+{
+	vAssertCalled(__FILE__, __LINE__);
+}
+
+/**
+ * configSUPPORT_STATIC_ALLOCATION is set (the same as on the target), so the
+ * kernel asks the application for the idle task's memory
+ */
+void vApplicationGetIdleTaskMemory(	StaticTask_t** ppxIdleTaskTCBBuffer,
+									StackType_t** ppxIdleTaskStackBuffer,
+									uint32_t* pulIdleTaskStackSize )
+{
+	static StaticTask_t idleTaskTCB;
+	static StackType_t idleTaskStack[configMINIMAL_STACK_SIZE];
+
+	*ppxIdleTaskTCBBuffer = &idleTaskTCB;
+	*ppxIdleTaskStackBuffer = idleTaskStack;
+	*pulIdleTaskStackSize = configMINIMAL_STACK_SIZE;
+}
+
+/**
+ * same as above, for the timer service task
+ */
+void vApplicationGetTimerTaskMemory(	StaticTask_t** ppxTimerTaskTCBBuffer,
+										StackType_t** ppxTimerTaskStackBuffer,
+										uint32_t* pulTimerTaskStackSize )
+{
+	static StaticTask_t timerTaskTCB;
+	static StackType_t timerTaskStack[configTIMER_TASK_STACK_DEPTH];
+
+	*ppxTimerTaskTCBBuffer = &timerTaskTCB;
+	*ppxTimerTaskStackBuffer = timerTaskStack;
+	*pulTimerTaskStackSize = configTIMER_TASK_STACK_DEPTH;
+}
+
+#if configUSE_VIRTUAL_TIME == 1
+/**
+ * every task is blocked - move virtual time on to the next one to wake
+ */
+void vApplicationIdleHook( void )
+{
+	vPortVirtualTimeIdle();
+}
+#endif
+
+uint64_t HostTimeNs( void )
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
@@ -0,0 +1,256 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Brian Amos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <string.h>
+#include <stdbool.h>
+#include "HostSupport.h"
+#include "HostTrace.h"
+
+/*********************************************
+ * In memory recorder behind the kernel trace hooks
+ * in HostTrace.h.
+ *
+ * The hooks are called from inside the kernel - with
+ * the scheduler suspended or from a critical section -
+ * so only one of them runs at a time and they don't
+ * need any locking of their own.
+ *********************************************/
+
+typedef struct
+{
+	void const* Task;
+	char Name[configMAX_TASK_NAME_LEN];
+	unsigned Priority;
+	uint32_t SwitchIns;
+	uint64_t RunNs;
+	//object the task last blocked on and when it was signaled (0 until it is)
+	void const* WaitObject;
+	uint64_t SignalNs;
+	uint32_t IpcWakeups;
+	uint64_t IpcTotalNs;
+	uint64_t IpcMaxNs;
+}TaskTrace_t;
+
+//the last entry collects any tasks past HOST_TRACE_MAX_TASKS
+static TaskTrace_t tasks[HOST_TRACE_MAX_TASKS + 1];
+static uint32_t numTasks = 0;
+static bool untrackedTasks = false;
+
+static TaskTrace_t* running = NULL;
+static uint64_t switchedInNs = 0;
+static uint64_t firstSwitchNs = 0;
+static uint32_t contextSwitches = 0;
+
+//the most recent send/give/notify/set - the kernel readies any task it
+//unblocks before returning from the call
+static void const* signaledObject = NULL;
+static uint64_t signaledNs = 0;
+
+static uint32_t ipcBuckets[HOST_TRACE_NUM_BUCKETS];
+
+static TaskTrace_t* findTask( void const* Task );
+static unsigned bucketOf( uint64_t Ns );
+
+void HostTraceTaskCreate( void const* Task, char const* Name, unsigned Priority )
+{
+	TaskTrace_t* trace;
+
+	if(numTasks < HOST_TRACE_MAX_TASKS)
+	{
+		trace = &tasks[numTasks++];
+		strncpy(trace->Name, Name, sizeof(trace->Name) - 1);
+	}
+	else
+	{
+		untrackedTasks = true;
+		return;
+	}
+	trace->Task = Task;
+	trace->Priority = Priority;
+}
+
+/**
+ * the task's statistics are kept - but its TCB may be reused
+ * by a task created later
+ */
+void HostTraceTaskDelete( void const* Task )
+{
+	TaskTrace_t* trace = findTask(Task);
+
+	if(trace != &tasks[HOST_TRACE_MAX_TASKS])
+	{
+		trace->Task = NULL;
+	}
+}
+
+void HostTraceSwitchedIn( void const* Task )
+{
+	uint64_t now = HostTimeNs();
+	TaskTrace_t* trace = findTask(Task);
+
+	if(trace == running)
+	{
+		return;
+	}
+
+	if(running != NULL)
+	{
+		running->RunNs += now - switchedInNs;
+		contextSwitches++;
+	}
+	else
+	{
+		firstSwitchNs = now;
+	}
+	running = trace;
+	switchedInNs = now;
+	trace->SwitchIns++;
+}
+
+/**
+ * any task readied by the tick was unblocked by a timeout, not
+ * by the last signal
+ */
+void HostTraceTick( void )
+{
+	signaledObject = NULL;
+}
+
+void HostTraceBlock( void const* Object )
+{
+	TaskTrace_t* trace = findTask(xTaskGetCurrentTaskHandle());
+
+	trace->WaitObject = Object;
+	trace->SignalNs = 0;
+}
+
+void HostTraceSignal( void const* Object )
+{
+	signaledObject = Object;
+	signaledNs = HostTimeNs();
+}
+
+void HostTraceReady( void const* Task )
+{
+	TaskTrace_t* trace = findTask(Task);
+
+	if(signaledObject != NULL && trace->WaitObject == signaledObject && trace->SignalNs == 0)
+	{
+		trace->SignalNs = signaledNs;
+	}
+}
+
+void HostTraceWoken( void const* Object )
+{
+	TaskTrace_t* trace = findTask(xTaskGetCurrentTaskHandle());
+
+	if(trace->WaitObject == Object && trace->SignalNs != 0)
+	{
+		uint64_t latency = HostTimeNs() - trace->SignalNs;
+
+		trace->IpcWakeups++;
+		trace->IpcTotalNs += latency;
+		if(latency > trace->IpcMaxNs)
+		{
+			trace->IpcMaxNs = latency;
+		}
+		ipcBuckets[bucketOf(latency)]++;
+	}
+	trace->WaitObject = NULL;
+	trace->SignalNs = 0;
+}
+
+void HostTraceReport( FILE* Out )
+{
+	uint64_t now = HostTimeNs();
+	uint64_t tracedNs = now - firstSwitchNs;
+	uint32_t numRows = numTasks;
+
+	//charge the task that is running now for its current slice
+	if(running != NULL)
+	{
+		running->RunNs += now - switchedInNs;
+		switchedInNs = now;
+	}
+	if(untrackedTasks)
+	{
+		strcpy(tasks[HOST_TRACE_MAX_TASKS].Name, "(other)");
+		numRows = HOST_TRACE_MAX_TASKS + 1;
+	}
+
+	fprintf(Out, "context_switches,traced_ms\n");
+	fprintf(Out, "%lu,%.1f\n\n", (unsigned long)contextSwitches, (double)tracedNs / 1e6);
+
+	fprintf(Out, "task,priority,switch_ins,cpu_ms,cpu_pct,ipc_wakeups,ipc_mean_us,ipc_max_us\n");
+	for(uint32_t i = 0; i < numRows; i++)
+	{
+		TaskTrace_t const* trace = &tasks[i];
+
+		fprintf(Out, "%s,%u,%lu,%.2f,%.1f,%lu,%.1f,%.1f\n", trace->Name, trace->Priority,
+				(unsigned long)trace->SwitchIns, (double)trace->RunNs / 1e6,
+				tracedNs ? 100.0 * (double)trace->RunNs / (double)tracedNs : 0.0,
+				(unsigned long)trace->IpcWakeups,
+				trace->IpcWakeups ? (double)trace->IpcTotalNs / trace->IpcWakeups / 1e3 : 0.0,
+				(double)trace->IpcMaxNs / 1e3);
+	}
+
+	fprintf(Out, "\nipc_latency_ns_from,ipc_latency_ns_to,count\n");
+	for(unsigned i = 0; i < HOST_TRACE_NUM_BUCKETS; i++)
+	{
+		if(ipcBuckets[i] != 0)
+		{
+			fprintf(Out, "%llu,%llu,%lu\n", i ? 1ull << i : 0ull, (1ull << (i + 1)) - 1,
+					(unsigned long)ipcBuckets[i]);
+		}
+	}
+}
+
+/**
+ * tasks past HOST_TRACE_MAX_TASKS end up in the last entry
+ */
+static TaskTrace_t* findTask( void const* Task )
+{
+	for(uint32_t i = 0; i < numTasks; i++)
+	{
+		if(tasks[i].Task == Task)
+		{
+			return &tasks[i];
+		}
+	}
+	return &tasks[HOST_TRACE_MAX_TASKS];
+}
+
+static unsigned bucketOf( uint64_t Ns )
+{
+	unsigned bucket = 0;
+
+	if(Ns != 0)
+	{
+		bucket = 63 - (unsigned)__builtin_clzll(Ns);
+	}
+	return bucket < HOST_TRACE_NUM_BUCKETS ? bucket : HOST_TRACE_NUM_BUCKETS - 1;
+}
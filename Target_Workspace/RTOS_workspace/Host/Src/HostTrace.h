@@ -0,0 +1,97 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2019 Brian Amos
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef HOST_SRC_HOSTTRACE_H_
+#define HOST_SRC_HOSTTRACE_H_
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include <stdio.h>
+
+/**
+ * Kernel trace hooks for the host build, the same idea as
+ * SEGGER_SYSVIEW_FreeRTOS.h on the target: FreeRTOSConfig.h
+ * includes this header (when HOST_TRACE is 1) and the kernel
+ * calls into HostTrace.c, which keeps everything in memory
+ * until HostTraceReport is called.
+ *
+ * Recorded:
+ * 	- context switches, and per task: times switched in and
+ * 	  time spent running (host wall clock - only one task's
+ * 	  thread runs at a time on the Posix port)
+ * 	- IPC latency: the time from a queue send/semaphore give,
+ * 	  task notification or event group set that readies a
+ * 	  blocked task to that task returning from the call it
+ * 	  blocked in.  Stream buffers notify their reader, so they
+ * 	  are covered by the notification hooks
+ */
+
+//most tasks that are tracked individually - later tasks are lumped together
+#define HOST_TRACE_MAX_TASKS 16
+//IPC latencies are counted in power of two ns buckets
+#define HOST_TRACE_NUM_BUCKETS 32
+
+void HostTraceTaskCreate( void const* Task, char const* Name, unsigned Priority );
+void HostTraceTaskDelete( void const* Task );
+void HostTraceSwitchedIn( void const* Task );
+void HostTraceTick( void );
+void HostTraceBlock( void const* Object );
+void HostTraceSignal( void const* Object );
+void HostTraceReady( void const* Task );
+void HostTraceWoken( void const* Object );
+
+/**
+ * prints the statistics gathered so far as CSV tables
+ */
+void HostTraceReport( FILE* Out );
+
+#define traceTASK_CREATE( pxNewTCB )				HostTraceTaskCreate( pxNewTCB, pxNewTCB->pcTaskName, pxNewTCB->uxPriority )
+#define traceTASK_DELETE( pxTCB )					HostTraceTaskDelete( pxTCB )
+#define traceTASK_SWITCHED_IN()						HostTraceSwitchedIn( pxCurrentTCB )
+#define traceTASK_INCREMENT_TICK( xTickCount )		HostTraceTick()
+#define traceMOVED_TASK_TO_READY_STATE( pxTCB )		HostTraceReady( pxTCB )
+
+#define traceBLOCKING_ON_QUEUE_RECEIVE( pxQueue )	HostTraceBlock( pxQueue )
+#define traceQUEUE_SEND( pxQueue )					HostTraceSignal( pxQueue )
+#define traceQUEUE_SEND_FROM_ISR( pxQueue )			HostTraceSignal( pxQueue )
+#define traceQUEUE_RECEIVE( pxQueue )				HostTraceWoken( pxQueue )
+
+#define traceTASK_NOTIFY_TAKE_BLOCK()				HostTraceBlock( pxCurrentTCB )
+#define traceTASK_NOTIFY_WAIT_BLOCK()				HostTraceBlock( pxCurrentTCB )
+#define traceTASK_NOTIFY()							HostTraceSignal( pxTCB )
+#define traceTASK_NOTIFY_FROM_ISR()					HostTraceSignal( pxTCB )
+#define traceTASK_NOTIFY_GIVE_FROM_ISR()			HostTraceSignal( pxTCB )
+#define traceTASK_NOTIFY_TAKE()						HostTraceWoken( pxCurrentTCB )
+#define traceTASK_NOTIFY_WAIT()						HostTraceWoken( pxCurrentTCB )
+
+#define traceEVENT_GROUP_WAIT_BITS_BLOCK( xEventGroup, uxBitsToWaitFor )				HostTraceBlock( xEventGroup )
+#define traceEVENT_GROUP_SET_BITS( xEventGroup, uxBitsToSet )							HostTraceSignal( xEventGroup )
+#define traceEVENT_GROUP_WAIT_BITS_END( xEventGroup, uxBitsToWaitFor, xTimeoutOccurred )	HostTraceWoken( xEventGroup )
+
+#ifdef __cplusplus
+ }
+#endif
+#endif /* HOST_SRC_HOSTTRACE_H_ */
@@ -0,0 +1,140 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2019 Brian Amos
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "stm32f7xx_hal.h"
+#include <UartQuickDirtyInit.h>
+#include <string.h>
+
+USART_TypeDef FakeUsart2;
+USART_TypeDef FakeUart4;
+DMA_TypeDef FakeDma1;
+DMA_Stream_TypeDef FakeDma1Streams[8];
+
+uint32_t FakeNvicPriority[NUM_FAKE_IRQS];
+bool FakeNvicEnabled[NUM_FAKE_IRQS];
+
+FakeUartInitCall_t FakeUsart2Init;
+FakeUartInitCall_t FakeUart4Init;
+
+HAL_StatusTypeDef HAL_DMA_Init( DMA_HandleTypeDef* hdma )
+{
+	DMA_InitTypeDef const* init = &hdma->Init;
+
+	hdma->Instance->CR = init->Channel | init->Direction | init->PeriphInc |
+						 init->MemInc | init->PeriphDataAlignment |
+						 init->MemDataAlignment | init->Mode | init->Priority;
+	hdma->Instance->FCR = init->FIFOMode | init->FIFOThreshold;
+	return HAL_OK;
+}
+
+void NVIC_SetPriority( IRQn_Type IRQn, uint32_t priority )
+{
+	FakeNvicPriority[IRQn] = priority;
+}
+
+void NVIC_EnableIRQ( IRQn_Type IRQn )
+{
+	FakeNvicEnabled[IRQn] = true;
+}
+
+void NVIC_DisableIRQ( IRQn_Type IRQn )
+{
+	FakeNvicEnabled[IRQn] = false;
+}
+
+void STM_UartInit( USART_TypeDef* STM_UART_PERIPH, uint32_t Baudrate, DMA_HandleTypeDef* DmaTx, DMA_HandleTypeDef* DmaRx )
+{
+	FakeUartInitCall_t* call;
+
+	configASSERT(	STM_UART_PERIPH == USART2 ||
+					STM_UART_PERIPH == UART4 );
+	call = (STM_UART_PERIPH == USART2) ? &FakeUsart2Init : &FakeUart4Init;
+	call->NumCalls++;
+	call->Baudrate = Baudrate;
+	call->DmaTx = DmaTx;
+	call->DmaRx = DmaRx;
+	STM_UART_PERIPH->CR1 |= USART_CR1_UE | USART_CR1_RE | USART_CR1_TE;
+}
+
+void FakeStm32Reset( void )
+{
+	memset(&FakeUsart2, 0, sizeof(FakeUsart2));
+	memset(&FakeUart4, 0, sizeof(FakeUart4));
+	memset(&FakeDma1, 0, sizeof(FakeDma1));
+	memset(FakeDma1Streams, 0, sizeof(FakeDma1Streams));
+	memset(FakeNvicPriority, 0, sizeof(FakeNvicPriority));
+	memset(FakeNvicEnabled, 0, sizeof(FakeNvicEnabled));
+	memset(&FakeUsart2Init, 0, sizeof(FakeUsart2Init));
+	memset(&FakeUart4Init, 0, sizeof(FakeUart4Init));
+}
+
+void FakeStm32ApplyClears( void )
+{
+	FakeUsart2.ISR &= ~FakeUsart2.ICR;
+	FakeUsart2.ICR = 0;
+	FakeUart4.ISR &= ~FakeUart4.ICR;
+	FakeUart4.ICR = 0;
+	FakeDma1.LISR &= ~FakeDma1.LIFCR;
+	FakeDma1.LIFCR = 0;
+	FakeDma1.HISR &= ~FakeDma1.HIFCR;
+	FakeDma1.HIFCR = 0;
+}
+
+size_t FakeDmaTransmit( DMA_Stream_TypeDef* Stream, uint8_t* Dst, size_t MaxBytes )
+{
+	//flag positions for streams 0-3 within LISR (and 4-7 within HISR)
+	static const uint32_t flagOffsets[] = { 0, 6, 16, 22 };
+	uint32_t streamNum = (uint32_t)(Stream - FakeDma1Streams);
+	size_t numMoved = 0;
+
+	while(numMoved < MaxBytes && (Stream->CR & DMA_SxCR_EN) && Stream->NDTR > 0)
+	{
+		uint8_t byte = *(uint8_t const*)Stream->M0AR;
+
+		if(Dst != NULL)
+		{
+			Dst[numMoved] = byte;
+		}
+		Stream->M0AR++;
+		Stream->NDTR--;
+		numMoved++;
+	}
+
+	if((Stream->CR & DMA_SxCR_EN) && Stream->NDTR == 0)
+	{
+		uint32_t tcFlag = DMA_HISR_TCIF4 << flagOffsets[streamNum % 4];
+
+		Stream->CR &= ~DMA_SxCR_EN;
+		if(streamNum < 4)
+		{
+			FakeDma1.LISR |= tcFlag;
+		}
+		else
+		{
+			FakeDma1.HISR |= tcFlag;
+		}
+	}
+	return numMoved;
+}
@@ -0,0 +1,228 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2019 Brian Amos
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "FakeUsbdConf.h"
+#include "usbd_core.h"
+#include <task.h>
+#include <string.h>
+
+PCD_HandleTypeDef FakeHpcd;
+FakeUsbInStats_t FakeUsbIn;
+FakeUsbOutStats_t FakeUsbOut;
+
+//transfer armed on each IN endpoint by USBD_LL_Transmit
+typedef struct
+{
+	bool Armed;
+	uint8_t* Buff;
+	uint16_t Len;
+	uint16_t Sent;
+}FakeInTransfer_t;
+
+static FakeInTransfer_t inTransfers[16];
+
+//buffer armed on each OUT endpoint by USBD_LL_PrepareReceive
+typedef struct
+{
+	bool Armed;
+	uint8_t* Buff;
+	uint16_t Size;
+	uint16_t Received;
+}FakeOutTransfer_t;
+
+static FakeOutTransfer_t outTransfers[16];
+
+void FakeUsbReset( USBD_HandleTypeDef* Dev )
+{
+	memset(&FakeHpcd, 0, sizeof(FakeHpcd));
+	memset(&FakeUsbIn, 0, sizeof(FakeUsbIn));
+	memset(&FakeUsbOut, 0, sizeof(FakeUsbOut));
+	memset(inTransfers, 0, sizeof(inTransfers));
+	memset(outTransfers, 0, sizeof(outTransfers));
+	for(int i = 0; i < 16; i++)
+	{
+		FakeHpcd.IN_ep[i].maxpacket = USB_FS_MAX_PACKET_SIZE;
+		FakeHpcd.OUT_ep[i].maxpacket = USB_FS_MAX_PACKET_SIZE;
+	}
+	Dev->pData = &FakeHpcd;
+	Dev->dev_speed = USBD_SPEED_FULL;
+}
+
+size_t FakeUsbInFrame( USBD_HandleTypeDef* Dev, uint8_t EpAddr, uint8_t* Dst, uint32_t MaxPackets )
+{
+	uint8_t epnum = EpAddr & 0x0FU;
+	FakeInTransfer_t* xfer = &inTransfers[epnum];
+	uint32_t maxPacket = FakeHpcd.IN_ep[epnum].maxpacket;
+	size_t total = 0;
+
+	for(uint32_t i = 0; i < MaxPackets; i++)
+	{
+		uint32_t len;
+		bool nak;
+
+		//the completion interrupt runs (and the host's next IN token
+		//arrives) before any task the interrupt wakes can run
+		vTaskSuspendAll();
+		nak = !xfer->Armed;
+		if(!nak)
+		{
+			len = xfer->Len - xfer->Sent;
+			if(len > maxPacket)
+			{
+				len = maxPacket;
+			}
+			if(Dst != NULL)
+			{
+				memcpy(&Dst[total], &xfer->Buff[xfer->Sent], len);
+			}
+			xfer->Sent += len;
+			total += len;
+			FakeUsbIn.Packets++;
+			FakeUsbIn.Bytes += len;
+			if(len == 0)
+			{
+				FakeUsbIn.Zlps++;
+			}
+
+			//like the OTG core, a transfer completes when all of its bytes
+			//are sent - it doesn't add a ZLP of its own
+			if(xfer->Sent == xfer->Len)
+			{
+				xfer->Armed = false;
+				Dev->pClass->DataIn(Dev, epnum);
+				nak = !xfer->Armed;
+			}
+		}
+		xTaskResumeAll();
+
+		if(nak)
+		{
+			FakeUsbIn.Naks++;
+			break;
+		}
+		//tasks at the caller's priority get to run while the next packet
+		//is on the wire
+		taskYIELD();
+	}
+	return total;
+}
+
+bool FakeUsbOutPacket( USBD_HandleTypeDef* Dev, uint8_t EpAddr, uint8_t const* Data, uint16_t Len )
+{
+	uint8_t epnum = EpAddr & 0x0FU;
+	FakeOutTransfer_t* xfer = &outTransfers[epnum];
+
+	configASSERT(Len <= FakeHpcd.OUT_ep[epnum].maxpacket);
+	if(!xfer->Armed)
+	{
+		FakeUsbOut.Naks++;
+		return false;
+	}
+
+	configASSERT(Len <= xfer->Size);
+	memcpy(xfer->Buff, Data, Len);
+	xfer->Received = Len;
+	xfer->Armed = false;
+	FakeUsbOut.Packets++;
+	FakeUsbOut.Bytes += Len;
+	//the receive interrupt runs before any task it wakes can run
+	vTaskSuspendAll();
+	Dev->pClass->DataOut(Dev, epnum);
+	xTaskResumeAll();
+	return true;
+}
+
+bool FakeUsbOutIsArmed( uint8_t EpAddr )
+{
+	return outTransfers[EpAddr & 0x0FU].Armed;
+}
+
+/**
+ * arms EpAddr with a transfer of Size bytes - a transfer must not
+ * already be in progress on the endpoint
+ */
+USBD_StatusTypeDef USBD_LL_Transmit( USBD_HandleTypeDef *pdev, uint8_t ep_addr, uint8_t *pbuf, uint16_t size )
+{
+	FakeInTransfer_t* xfer = &inTransfers[ep_addr & 0x0FU];
+
+	configASSERT(!xfer->Armed);
+	xfer->Armed = true;
+	xfer->Buff = pbuf;
+	xfer->Len = size;
+	xfer->Sent = 0;
+
+	if(FakeUsbIn.Transfers < FAKE_USB_MAX_TRANSFER_LOG)
+	{
+		FakeUsbIn.TransferLens[FakeUsbIn.Transfers] = size;
+	}
+	FakeUsbIn.Transfers++;
+	return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_OpenEP( USBD_HandleTypeDef *pdev, uint8_t ep_addr, uint8_t ep_type, uint16_t ep_mps )
+{
+	return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_CloseEP( USBD_HandleTypeDef *pdev, uint8_t ep_addr )
+{
+	return USBD_OK;
+}
+
+/**
+ * arms EpAddr to receive a packet into pbuf - the endpoint must not
+ * already be armed
+ */
+USBD_StatusTypeDef USBD_LL_PrepareReceive( USBD_HandleTypeDef *pdev, uint8_t ep_addr, uint8_t *pbuf, uint16_t size )
+{
+	FakeOutTransfer_t* xfer = &outTransfers[ep_addr & 0x0FU];
+
+	configASSERT(!xfer->Armed);
+	xfer->Armed = true;
+	xfer->Buff = pbuf;
+	xfer->Size = size;
+	FakeUsbOut.Arms++;
+	return USBD_OK;
+}
+
+uint32_t USBD_LL_GetRxDataSize( USBD_HandleTypeDef *pdev, uint8_t ep_addr )
+{
+	return outTransfers[ep_addr & 0x0FU].Received;
+}
+
+//control transfers (usbd_ioreq.c/usbd_ctlreq.c) aren't modelled
+USBD_StatusTypeDef USBD_CtlSendData( USBD_HandleTypeDef *pdev, uint8_t *pbuf, uint16_t len )
+{
+	return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_CtlPrepareRx( USBD_HandleTypeDef *pdev, uint8_t *pbuf, uint16_t len )
+{
+	return USBD_OK;
+}
+
+void USBD_CtlError( USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req )
+{
+}
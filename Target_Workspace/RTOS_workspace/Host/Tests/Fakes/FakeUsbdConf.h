@@ -0,0 +1,110 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2019 Brian Amos
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef HOST_TESTS_FAKES_FAKEUSBDCONF_H_
+#define HOST_TESTS_FAKES_FAKEUSBDCONF_H_
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/*********************************************
+ * Fake of BSP/usbd_conf.c - the low level glue between the
+ * ST USB device library and the OTG FS peripheral.
+ *
+ * Instead of a peripheral, the IN endpoint is drained by a
+ * model of a full speed host: FakeUsbInFrame plays out one
+ * 1 mS frame, sending a packet per IN token and calling the
+ * class's DataIn (from the caller's context, standing in for
+ * the OTG ISR) each time a transfer completes.  A token that
+ * finds nothing armed is NAK'd, and the host comes back to
+ * the endpoint in the next frame.
+ *
+ * The host's next token follows a completed transfer before
+ * any task woken by the completion can run, so the endpoint
+ * is only ever re-armed in time by the completion interrupt
+ * itself.  Other tasks get to run between packets.
+ *
+ * OUT packets are delivered one at a time by FakeUsbOutPacket,
+ * which NAK's the packet (leaving the host to retry it) if
+ * the endpoint hasn't been armed with USBD_LL_PrepareReceive.
+ *********************************************/
+
+#include "usbd_def.h"
+
+//bulk IN packets a full speed host fits in one frame (19 * 64 bytes
+//is the usual practical limit for a single bulk endpoint)
+#define FAKE_USB_PACKETS_PER_FRAME	19
+#define FAKE_USB_MAX_TRANSFER_LOG	1024
+
+typedef struct
+{
+	uint32_t Packets;
+	uint32_t Bytes;
+	uint32_t Zlps;
+	uint32_t Naks;
+	uint32_t Transfers;
+	//length of each transfer passed to USBD_LL_Transmit on the IN endpoint
+	uint16_t TransferLens[FAKE_USB_MAX_TRANSFER_LOG];
+}FakeUsbInStats_t;
+
+typedef struct
+{
+	uint32_t Packets;
+	uint32_t Bytes;
+	uint32_t Naks;
+	//number of times an OUT endpoint was armed
+	uint32_t Arms;
+}FakeUsbOutStats_t;
+
+extern PCD_HandleTypeDef FakeHpcd;
+extern FakeUsbInStats_t FakeUsbIn;
+extern FakeUsbOutStats_t FakeUsbOut;
+
+/**
+ * clears the fake's state and points Dev->pData at FakeHpcd, with
+ * full speed packet sizes on every endpoint
+ */
+void FakeUsbReset( USBD_HandleTypeDef* Dev );
+
+/**
+ * plays out one frame on endpoint EpAddr, with the host accepting up
+ * to MaxPackets packets.  Data sent is copied to Dst (if not NULL)
+ * @returns number of bytes sent
+ */
+size_t FakeUsbInFrame( USBD_HandleTypeDef* Dev, uint8_t EpAddr, uint8_t* Dst, uint32_t MaxPackets );
+
+/**
+ * the host sends Len bytes to endpoint EpAddr.  If the endpoint is armed
+ * the data lands in its buffer and the class's DataOut is called
+ * @returns true if the packet was accepted, false if it was NAK'd
+ */
+bool FakeUsbOutPacket( USBD_HandleTypeDef* Dev, uint8_t EpAddr, uint8_t const* Data, uint16_t Len );
+
+bool FakeUsbOutIsArmed( uint8_t EpAddr );
+
+#ifdef __cplusplus
+ }
+#endif
+#endif /* HOST_TESTS_FAKES_FAKEUSBDCONF_H_ */
@@ -0,0 +1,294 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2019 Brian Amos
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef HOST_TESTS_FAKES_STM32F7XX_HAL_H_
+#define HOST_TESTS_FAKES_STM32F7XX_HAL_H_
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/*********************************************
+ * Register level fake of the parts of the STM32F7 HAL/CMSIS
+ * headers used by the BSP drivers, so they can be built and
+ * unit tested on the host.
+ *
+ * Peripherals are plain structs in RAM - tests play the part
+ * of the hardware by setting status registers and calling
+ * the driver's ISR's.  Address registers are widened to
+ * uintptr_t so they can hold host pointers.
+ * Bit definitions match stm32f767xx.h.
+ *********************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <FreeRTOS.h>
+
+#define __IO volatile
+
+typedef struct
+{
+	__IO uint32_t CR1;
+	__IO uint32_t CR2;
+	__IO uint32_t CR3;
+	__IO uint32_t BRR;
+	__IO uint32_t GTPR;
+	__IO uint32_t RTOR;
+	__IO uint32_t RQR;
+	__IO uint32_t ISR;
+	__IO uint32_t ICR;
+	__IO uint32_t RDR;
+	__IO uint32_t TDR;
+}USART_TypeDef;
+
+typedef struct
+{
+	__IO uint32_t CR;
+	__IO uint32_t NDTR;
+	__IO uintptr_t PAR;
+	__IO uintptr_t M0AR;
+	__IO uintptr_t M1AR;
+	__IO uint32_t FCR;
+}DMA_Stream_TypeDef;
+
+typedef struct
+{
+	__IO uint32_t LISR;
+	__IO uint32_t HISR;
+	__IO uint32_t LIFCR;
+	__IO uint32_t HIFCR;
+}DMA_TypeDef;
+
+extern USART_TypeDef FakeUsart2;
+extern USART_TypeDef FakeUart4;
+extern DMA_TypeDef FakeDma1;
+extern DMA_Stream_TypeDef FakeDma1Streams[8];
+
+#define USART2			(&FakeUsart2)
+#define UART4			(&FakeUart4)
+#define DMA1			(&FakeDma1)
+#define DMA1_Stream0	(&FakeDma1Streams[0])
+#define DMA1_Stream1	(&FakeDma1Streams[1])
+#define DMA1_Stream2	(&FakeDma1Streams[2])
+#define DMA1_Stream3	(&FakeDma1Streams[3])
+#define DMA1_Stream4	(&FakeDma1Streams[4])
+#define DMA1_Stream5	(&FakeDma1Streams[5])
+#define DMA1_Stream6	(&FakeDma1Streams[6])
+#define DMA1_Stream7	(&FakeDma1Streams[7])
+
+typedef enum
+{
+	DMA1_Stream0_IRQn = 11,
+	DMA1_Stream1_IRQn = 12,
+	DMA1_Stream2_IRQn = 13,
+	DMA1_Stream3_IRQn = 14,
+	DMA1_Stream4_IRQn = 15,
+	DMA1_Stream5_IRQn = 16,
+	DMA1_Stream6_IRQn = 17,
+	USART2_IRQn = 38,
+	DMA1_Stream7_IRQn = 47,
+	UART4_IRQn = 52,
+	OTG_FS_IRQn = 67,
+	NUM_FAKE_IRQS = 128
+}IRQn_Type;
+
+/* USART */
+#define USART_CR1_UE			(0x1UL << 0U)
+#define USART_CR1_RE			(0x1UL << 2U)
+#define USART_CR1_TE			(0x1UL << 3U)
+#define USART_CR1_IDLEIE		(0x1UL << 4U)
+#define USART_CR1_RXNEIE		(0x1UL << 5U)
+#define USART_CR1_TCIE			(0x1UL << 6U)
+#define USART_CR1_TXEIE			(0x1UL << 7U)
+#define USART_CR3_EIE			(0x1UL << 0U)
+#define USART_CR3_DMAR			(0x1UL << 6U)
+#define USART_CR3_DMAT			(0x1UL << 7U)
+#define USART_ISR_PE			(0x1UL << 0U)
+#define USART_ISR_FE			(0x1UL << 1U)
+#define USART_ISR_NE			(0x1UL << 2U)
+#define USART_ISR_ORE			(0x1UL << 3U)
+#define USART_ISR_IDLE			(0x1UL << 4U)
+#define USART_ISR_RXNE			(0x1UL << 5U)
+#define USART_ISR_TC			(0x1UL << 6U)
+#define USART_ISR_TXE			(0x1UL << 7U)
+#define USART_ISR_PE_Msk		USART_ISR_PE
+#define USART_ISR_FE_Msk		USART_ISR_FE
+#define USART_ISR_NE_Msk		USART_ISR_NE
+#define USART_ISR_ORE_Msk		USART_ISR_ORE
+#define USART_ICR_PECF			(0x1UL << 0U)
+#define USART_ICR_FECF			(0x1UL << 1U)
+#define USART_ICR_NCF			(0x1UL << 2U)
+#define USART_ICR_ORECF			(0x1UL << 3U)
+#define USART_ICR_IDLECF		(0x1UL << 4U)
+#define USART_ICR_TCCF			(0x1UL << 6U)
+
+/* DMA */
+#define DMA_SxCR_EN				(0x1UL << 0U)
+#define DMA_SxCR_DMEIE			(0x1UL << 1U)
+#define DMA_SxCR_TEIE			(0x1UL << 2U)
+#define DMA_SxCR_HTIE			(0x1UL << 3U)
+#define DMA_SxCR_TCIE			(0x1UL << 4U)
+#define DMA_SxCR_DIR_0			(0x1UL << 6U)
+#define DMA_SxCR_CIRC			(0x1UL << 8U)
+#define DMA_SxCR_MINC			(0x1UL << 10U)
+#define DMA_SxCR_DBM			(0x1UL << 18U)
+#define DMA_SxCR_CT				(0x1UL << 19U)
+#define DMA_HISR_FEIF4			(0x1UL << 0U)
+#define DMA_HISR_DMEIF4			(0x1UL << 2U)
+#define DMA_HISR_TEIF4			(0x1UL << 3U)
+#define DMA_HISR_HTIF4			(0x1UL << 4U)
+#define DMA_HISR_TCIF4			(0x1UL << 5U)
+#define DMA_HISR_FEIF5			(0x1UL << 6U)
+#define DMA_HISR_DMEIF5			(0x1UL << 8U)
+#define DMA_HISR_TEIF5			(0x1UL << 9U)
+#define DMA_HISR_HTIF5			(0x1UL << 10U)
+#define DMA_HISR_TCIF5			(0x1UL << 11U)
+#define DMA_HIFCR_CFEIF4		DMA_HISR_FEIF4
+#define DMA_HIFCR_CDMEIF4		DMA_HISR_DMEIF4
+#define DMA_HIFCR_CTEIF4		DMA_HISR_TEIF4
+#define DMA_HIFCR_CHTIF4		DMA_HISR_HTIF4
+#define DMA_HIFCR_CTCIF4		DMA_HISR_TCIF4
+#define DMA_HIFCR_CFEIF5		DMA_HISR_FEIF5
+#define DMA_HIFCR_CDMEIF5		DMA_HISR_DMEIF5
+#define DMA_HIFCR_CTEIF5		DMA_HISR_TEIF5
+#define DMA_HIFCR_CHTIF5		DMA_HISR_HTIF5
+#define DMA_HIFCR_CTCIF5		DMA_HISR_TCIF5
+
+/* HAL DMA */
+typedef enum
+{
+	HAL_OK = 0x00U,
+	HAL_ERROR = 0x01U,
+	HAL_BUSY = 0x02U,
+	HAL_TIMEOUT = 0x03U
+}HAL_StatusTypeDef;
+
+typedef struct
+{
+	uint32_t Channel;
+	uint32_t Direction;
+	uint32_t PeriphInc;
+	uint32_t MemInc;
+	uint32_t PeriphDataAlignment;
+	uint32_t MemDataAlignment;
+	uint32_t Mode;
+	uint32_t Priority;
+	uint32_t FIFOMode;
+	uint32_t FIFOThreshold;
+	uint32_t MemBurst;
+	uint32_t PeriphBurst;
+}DMA_InitTypeDef;
+
+typedef struct
+{
+	DMA_Stream_TypeDef* Instance;
+	DMA_InitTypeDef Init;
+}DMA_HandleTypeDef;
+
+#define DMA_CHANNEL_4			0x08000000U
+#define DMA_PERIPH_TO_MEMORY	0x00000000U
+#define DMA_MEMORY_TO_PERIPH	DMA_SxCR_DIR_0
+#define DMA_PINC_DISABLE		0x00000000U
+#define DMA_MINC_ENABLE			DMA_SxCR_MINC
+#define DMA_PDATAALIGN_BYTE		0x00000000U
+#define DMA_MDATAALIGN_BYTE		0x00000000U
+#define DMA_NORMAL				0x00000000U
+#define DMA_CIRCULAR			DMA_SxCR_CIRC
+#define DMA_PRIORITY_HIGH		0x00020000U
+#define DMA_FIFOMODE_DISABLE	0x00000000U
+#define DMA_MBURST_SINGLE		0x00000000U
+#define DMA_PBURST_SINGLE		0x00000000U
+
+#define __HAL_RCC_DMA1_CLK_ENABLE()	do{}while(0)
+
+/* HAL PCD - only the parts the USB device library's classes look at */
+typedef struct
+{
+	uint32_t maxpacket;
+}PCD_EPTypeDef;
+
+typedef struct
+{
+	PCD_EPTypeDef IN_ep[16];
+	PCD_EPTypeDef OUT_ep[16];
+}PCD_HandleTypeDef;
+
+/**
+ * writes the Init settings into Instance->CR (leaving the stream disabled)
+ */
+HAL_StatusTypeDef HAL_DMA_Init( DMA_HandleTypeDef* hdma );
+
+/* NVIC - the fake records what the driver asked for */
+extern uint32_t FakeNvicPriority[NUM_FAKE_IRQS];
+extern bool FakeNvicEnabled[NUM_FAKE_IRQS];
+
+void NVIC_SetPriority( IRQn_Type IRQn, uint32_t priority );
+void NVIC_EnableIRQ( IRQn_Type IRQn );
+void NVIC_DisableIRQ( IRQn_Type IRQn );
+
+#define assert_param(expr) configASSERT(expr)
+
+/**
+ * returns every fake peripheral to its reset state
+ */
+void FakeStm32Reset( void );
+
+/**
+ * models the write-1-to-clear flag registers: bits written to
+ * USARTx->ICR and DMAx->xIFCR are cleared from the matching status
+ * register (and the clear registers read back as 0)
+ */
+void FakeStm32ApplyClears( void );
+
+/**
+ * BSP/UartQuickDirtyInit.c's STM_UartInit is faked as well - it records
+ * its arguments and leaves the UART enabled, as HAL_UART_Init would
+ */
+typedef struct
+{
+	uint32_t NumCalls;
+	uint32_t Baudrate;
+	DMA_HandleTypeDef* DmaTx;
+	DMA_HandleTypeDef* DmaRx;
+}FakeUartInitCall_t;
+
+extern FakeUartInitCall_t FakeUsart2Init;
+extern FakeUartInitCall_t FakeUart4Init;
+
+/**
+ * models a memory to peripheral DMA1 stream moving up to MaxBytes bytes
+ * (one per UART character time) into the peripheral, copying them to Dst
+ * (if not NULL).  When NDTR reaches 0 the stream disables itself and its
+ * transfer complete flag is raised, the same as the real controller in
+ * normal mode.  Unlike the real controller, M0AR is advanced as bytes are
+ * moved instead of an internal pointer.
+ * @returns number of bytes moved
+ */
+size_t FakeDmaTransmit( DMA_Stream_TypeDef* Stream, uint8_t* Dst, size_t MaxBytes );
+
+#ifdef __cplusplus
+ }
+#endif
+#endif /* HOST_TESTS_FAKES_STM32F7XX_HAL_H_ */
@@ -0,0 +1,175 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2019 Brian Amos
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <FreeRTOS.h>
+#include <BufferPool.h>
+#include <unity.h>
+#include <string.h>
+
+/*********************************************
+ * Unit tests for Drivers/HandsOnRTOS/BufferPool.c
+ *
+ * Blocking between tasks is covered by benchBufferPoolQueue.
+ *********************************************/
+
+#define NUM_BLOCKS 4
+#define QUEUE_LEN 4
+
+typedef struct
+{
+	uint32_t Seq;
+	char Message[60];
+}Msg_t;
+
+BUF_POOL_STATIC(pool, Msg_t, NUM_BLOCKS);
+BUF_QUEUE_STATIC(queue, QUEUE_LEN);
+
+void setUp( void )
+{
+	BUF_POOL_INIT(pool);
+	BUF_QUEUE_INIT(queue, pool);
+}
+
+void tearDown( void )
+{
+	vQueueDelete(queue.Queue);
+	vSemaphoreDelete(pool.FreeCount);
+}
+
+void test_Alloc_DistinctBlocksUntilEmpty( void )
+{
+	Msg_t* blocks[NUM_BLOCKS];
+
+	for(int i = 0; i < NUM_BLOCKS; i++)
+	{
+		blocks[i] = BufPoolAlloc(&pool, 0);
+		TEST_ASSERT_NOT_NULL(blocks[i]);
+		TEST_ASSERT_TRUE(blocks[i] >= poolBlocks && blocks[i] < &poolBlocks[NUM_BLOCKS]);
+		for(int j = 0; j < i; j++)
+		{
+			TEST_ASSERT_NOT_EQUAL(blocks[j], blocks[i]);
+		}
+	}
+	TEST_ASSERT_NULL(BufPoolAlloc(&pool, 0));
+	TEST_ASSERT_NULL(BufPoolAllocFromISR(&pool));
+	TEST_ASSERT_EQUAL(0, BufPoolNumFree(&pool));
+}
+
+void test_Free_BlockReusedFirst( void )
+{
+	Msg_t* first = BufPoolAlloc(&pool, 0);
+	Msg_t* second = BufPoolAlloc(&pool, 0);
+
+	BufPoolFree(&pool, second);
+	TEST_ASSERT_EQUAL_PTR(second, BufPoolAlloc(&pool, 0));
+	BufPoolFree(&pool, first);
+	TEST_ASSERT_EQUAL_PTR(first, BufPoolAllocFromISR(&pool));
+	TEST_ASSERT_EQUAL(NUM_BLOCKS - 2, BufPoolNumFree(&pool));
+}
+
+void test_EmptyPool_FreeFromISRMakesBlockAvailable( void )
+{
+	Msg_t* blocks[NUM_BLOCKS];
+	BaseType_t woken = pdFALSE;
+
+	for(int i = 0; i < NUM_BLOCKS; i++)
+	{
+		blocks[i] = BufPoolAllocFromISR(&pool);
+	}
+	BufPoolFreeFromISR(&pool, blocks[2], &woken);
+	TEST_ASSERT_EQUAL_PTR(blocks[2], BufPoolAlloc(&pool, 0));
+	TEST_ASSERT_EQUAL(pdFALSE, woken);
+}
+
+void test_HighWaterMark_TracksMostBlocksInUse( void )
+{
+	Msg_t* blocks[NUM_BLOCKS];
+
+	TEST_ASSERT_EQUAL(0, BufPoolGetHighWaterMark(&pool));
+	for(int i = 0; i < 3; i++)
+	{
+		blocks[i] = BufPoolAlloc(&pool, 0);
+	}
+	for(int i = 0; i < 3; i++)
+	{
+		BufPoolFree(&pool, blocks[i]);
+	}
+	blocks[0] = BufPoolAlloc(&pool, 0);
+	TEST_ASSERT_EQUAL(3, BufPoolGetHighWaterMark(&pool));
+	TEST_ASSERT_EQUAL(NUM_BLOCKS - 1, BufPoolNumFree(&pool));
+}
+
+void test_SendReceive_BlockPassedByReference( void )
+{
+	Msg_t* sent = BufPoolAlloc(&pool, 0);
+	Msg_t* received;
+
+	sent->Seq = 42;
+	strcpy(sent->Message, "passed by reference");
+	TEST_ASSERT_EQUAL(pdPASS, BufQueueSend(&queue, sent, 0));
+
+	received = BufQueueReceive(&queue, 0);
+	TEST_ASSERT_EQUAL_PTR(sent, received);
+	TEST_ASSERT_EQUAL(42, received->Seq);
+	TEST_ASSERT_EQUAL_STRING("passed by reference", received->Message);
+
+	//the receiver owns the block now
+	BufPoolFree(&pool, received);
+	TEST_ASSERT_EQUAL(NUM_BLOCKS, BufPoolNumFree(&pool));
+	TEST_ASSERT_NULL(BufQueueReceive(&queue, 0));
+}
+
+void test_SendReceiveFromISR_OrderPreserved( void )
+{
+	Msg_t* blocks[NUM_BLOCKS];
+
+	for(int i = 0; i < NUM_BLOCKS; i++)
+	{
+		blocks[i] = BufPoolAllocFromISR(&pool);
+		blocks[i]->Seq = (uint32_t)i;
+		TEST_ASSERT_EQUAL(pdPASS, BufQueueSendFromISR(&queue, blocks[i], NULL));
+	}
+	for(int i = 0; i < NUM_BLOCKS; i++)
+	{
+		Msg_t* received = BufQueueReceiveFromISR(&queue, NULL);
+
+		TEST_ASSERT_EQUAL_PTR(blocks[i], received);
+		TEST_ASSERT_EQUAL(i, received->Seq);
+		BufPoolFree(&pool, received);
+	}
+	TEST_ASSERT_NULL(BufQueueReceiveFromISR(&queue, NULL));
+}
+
+int main( void )
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_Alloc_DistinctBlocksUntilEmpty);
+	RUN_TEST(test_Free_BlockReusedFirst);
+	RUN_TEST(test_EmptyPool_FreeFromISRMakesBlockAvailable);
+	RUN_TEST(test_HighWaterMark_TracksMostBlocksInUse);
+	RUN_TEST(test_SendReceive_BlockPassedByReference);
+	RUN_TEST(test_SendReceiveFromISR_OrderPreserved);
+	return UNITY_END();
+}
@@ -0,0 +1,230 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2019 Brian Amos
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <queue.h>
+#include <unity.h>
+
+/*********************************************
+ * Wake up ticks of blocked tasks, for both delayed task
+ * backends (the sorted delayed task lists and
+ * configUSE_DELAYED_TASK_WHEEL).
+ *
+ * The kernels run on virtual time (configUSE_VIRTUAL_TIME),
+ * so every task wakes on exactly the tick it is due.  They
+ * start 3000 ticks short of the tick count overflowing,
+ * so most of the delays below cross it.
+ *********************************************/
+
+#define STACK_SIZE 512
+#define TEST_PRIORITY (tskIDLE_PRIORITY + 3)
+#define SLEEPER_PRIORITY (tskIDLE_PRIORITY + 2)
+#define MAX_SLEEPERS 16
+
+typedef struct
+{
+	StaticTask_t Buffer;
+	StackType_t Stack[STACK_SIZE];
+	TaskHandle_t Handle;
+	TickType_t Delay;
+	TickType_t Start;
+	TickType_t Woken;
+}Sleeper_t;
+
+static Sleeper_t sleepers[MAX_SLEEPERS];
+static int testResult;
+
+/**
+ * blocks once for its delay (or until it is notified),
+ * then parks until it is deleted
+ */
+static void sleeperTask( void* Arg )
+{
+	Sleeper_t* sleeper = (Sleeper_t*)Arg;
+
+	sleeper->Start = xTaskGetTickCount();
+	ulTaskNotifyTake(pdTRUE, sleeper->Delay);
+	sleeper->Woken = xTaskGetTickCount();
+	vTaskSuspend(NULL);
+}
+
+static void startSleeper( uint32_t Index, TickType_t Delay )
+{
+	Sleeper_t* sleeper = &sleepers[Index];
+
+	sleeper->Delay = Delay;
+	sleeper->Woken = 0;
+	sleeper->Handle = xTaskCreateStatic(sleeperTask, "sleeper", STACK_SIZE, sleeper,
+										SLEEPER_PRIORITY, sleeper->Stack, &sleeper->Buffer);
+	TEST_ASSERT_NOT_NULL(sleeper->Handle);
+}
+
+void setUp( void )
+{
+}
+
+void tearDown( void )
+{
+	for(uint32_t i = 0; i < MAX_SLEEPERS; i++)
+	{
+		if(sleepers[i].Handle != NULL)
+		{
+			vTaskDelete(sleepers[i].Handle);
+			sleepers[i].Handle = NULL;
+		}
+	}
+	//let the idle task clean up the deleted sleepers
+	vTaskDelay(2);
+}
+
+void test_Delay_WakesOnTheDueTick( void )
+{
+	//either side of the wheel's level boundaries, and past its reach
+	static const TickType_t delays[] = { 1, 2, 31, 32, 33, 1023, 1024, 1025, 40000,
+										 (1 << 20) + 7, (1 << 25) - 1, (1 << 25) + 5, (1ull << 31) + 3 };
+	const uint32_t numSleepers = sizeof(delays)/sizeof(delays[0]);
+
+	for(uint32_t i = 0; i < numSleepers; i++)
+	{
+		startSleeper(i, delays[i]);
+	}
+	//the sleepers start (and block) as soon as this task does
+	vTaskDelay(delays[numSleepers - 1] + 10);
+	for(uint32_t i = 0; i < numSleepers; i++)
+	{
+		TEST_ASSERT_EQUAL(eSuspended, eTaskGetState(sleepers[i].Handle));
+		TEST_ASSERT_EQUAL_UINT64(sleepers[i].Start + delays[i], sleepers[i].Woken);
+	}
+}
+
+void test_DelayUntil_KeepsItsPeriod( void )
+{
+	static const TickType_t periods[] = { 1, 32, 33, 1000 };
+	TickType_t lastWake;
+
+	for(uint32_t i = 0; i < sizeof(periods)/sizeof(periods[0]); i++)
+	{
+		lastWake = xTaskGetTickCount();
+		for(uint32_t j = 0; j < 5; j++)
+		{
+			TickType_t due = lastWake + periods[i];
+
+			vTaskDelayUntil(&lastWake, periods[i]);
+			TEST_ASSERT_EQUAL_UINT64(due, lastWake);
+			TEST_ASSERT_EQUAL_UINT64(due, xTaskGetTickCount());
+		}
+	}
+}
+
+void test_BlockedTimeout_RemovedEarlyLeavesOthersOnTime( void )
+{
+	static StaticQueue_t queueBuffer;
+	static uint8_t queueStorage[sizeof(uint32_t)];
+	QueueHandle_t queue = xQueueCreateStatic(1, sizeof(uint32_t), queueStorage, &queueBuffer);
+	uint32_t value = 7;
+	TickType_t start;
+
+	vTaskDelay(1);
+	start = xTaskGetTickCount();
+	startSleeper(0, 30);
+	startSleeper(1, 2000);
+	vTaskDelay(1);
+	TEST_ASSERT_EQUAL(eBlocked, eTaskGetState(sleepers[0].Handle));
+	TEST_ASSERT_EQUAL(eBlocked, eTaskGetState(sleepers[1].Handle));
+
+	//the sleeper due at 30 ticks is woken early, which leaves its
+	//slot empty - the one due at 2000 must still wake on time
+	xTaskNotifyGive(sleepers[0].Handle);
+	vTaskDelay(1);
+	TEST_ASSERT_EQUAL_UINT64(start + 1, sleepers[0].Woken);
+
+	//a receive timing out across the two sleepers
+	TEST_ASSERT_EQUAL(pdFALSE, xQueueReceive(queue, &value, 500));
+	TEST_ASSERT_EQUAL_UINT64(start + 502, xTaskGetTickCount());
+	TEST_ASSERT_EQUAL(eBlocked, eTaskGetState(sleepers[1].Handle));
+
+	vTaskDelay(2000);
+	TEST_ASSERT_EQUAL_UINT64(start + 2000, sleepers[1].Woken);
+	vQueueDelete(queue);
+}
+
+void test_ManySleepers_EachWakesOnItsTick( void )
+{
+	//spread over the first two levels, several per slot
+	for(uint32_t i = 0; i < MAX_SLEEPERS; i++)
+	{
+		startSleeper(i, 3 + i * 97);
+	}
+	vTaskDelay(3 + MAX_SLEEPERS * 97);
+	for(uint32_t i = 0; i < MAX_SLEEPERS; i++)
+	{
+		TEST_ASSERT_EQUAL_UINT64(sleepers[i].Start + 3 + i * 97, sleepers[i].Woken);
+	}
+}
+
+void test_Delay_AfterIdleGapWakesOnTime( void )
+{
+	//either side of the wheel's level boundaries
+	static const TickType_t delays[] = { 1, 5, 31, 33, 1000, 1025 };
+	TickType_t start;
+
+	for(uint32_t i = 0; i < sizeof(delays)/sizeof(delays[0]); i++)
+	{
+		//nothing is due while this task spins, so the ticks go by
+		//without the wheel moving on with them
+		vTaskDelay(1);
+		start = xTaskGetTickCount();
+		while(xTaskGetTickCount() - start < 40)
+		{
+		}
+
+		start = xTaskGetTickCount();
+		vTaskDelay(delays[i]);
+		TEST_ASSERT_EQUAL_UINT64(start + delays[i], xTaskGetTickCount());
+	}
+}
+
+static void testTask( void* NotUsed )
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_Delay_WakesOnTheDueTick);
+	RUN_TEST(test_DelayUntil_KeepsItsPeriod);
+	RUN_TEST(test_BlockedTimeout_RemovedEarlyLeavesOthersOnTime);
+	RUN_TEST(test_ManySleepers_EachWakesOnItsTick);
+	RUN_TEST(test_Delay_AfterIdleGapWakesOnTime);
+	//the tick count has to have overflowed part way through
+	TEST_ASSERT_LESS_THAN_UINT64(( TickType_t ) configINITIAL_TICK_COUNT, xTaskGetTickCount());
+	testResult = UNITY_END();
+	vTaskEndScheduler();
+}
+
+int main( void )
+{
+	configASSERT(xTaskCreate(testTask, "test", STACK_SIZE, NULL, TEST_PRIORITY, NULL) == pdPASS);
+
+	vTaskStartScheduler();
+	return testResult;
+}
@@ -0,0 +1,306 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2019 Brian Amos
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <FreeRTOS.h>
+#include <unity.h>
+#include <string.h>
+
+/*********************************************
+ * Unit tests for portable/MemMang/heap_6.c, the size class
+ * (TLSF) allocator.
+ *
+ * The heap is the chapters' 15KB, and the scheduler is never
+ * started, so nothing but the tests uses it and every test
+ * can check it ends up as one free block again.  Allocation traces against the other
+ * heaps are replayed by benchHeapAllocators.
+ *********************************************/
+
+#define MAX_BLOCKS 64
+#define MAX_CLASSES 32
+
+static void* blocks[MAX_BLOCKS];
+static size_t blockSizes[MAX_BLOCKS];
+static size_t initialFree;
+
+static void fillBlock( uint32_t Index, size_t Size )
+{
+	blockSizes[Index] = Size;
+	memset(blocks[Index], (int)(Index + 1), Size);
+}
+
+static void checkBlock( uint32_t Index )
+{
+	const uint8_t* bytes = (const uint8_t*)blocks[Index];
+
+	for(size_t i = 0; i < blockSizes[Index]; i++)
+	{
+		TEST_ASSERT_EQUAL_HEX8(Index + 1, bytes[i]);
+	}
+}
+
+static void freeAll( void )
+{
+	for(uint32_t i = 0; i < MAX_BLOCKS; i++)
+	{
+		vPortFree(blocks[i]);
+		blocks[i] = NULL;
+	}
+}
+
+/**
+ * the class whose range of block sizes holds Size
+ */
+static UBaseType_t classOf( const HeapClassStats_t* Classes, UBaseType_t NumClasses, size_t Size )
+{
+	UBaseType_t class = 0;
+
+	for(UBaseType_t i = 0; i < NumClasses; i++)
+	{
+		if(Classes[i].xMinimumBlockSizeInBytes <= Size)
+		{
+			class = i;
+		}
+	}
+	return class;
+}
+
+static void assertSingleFreeBlock( void )
+{
+	HeapStats_t stats;
+
+	vPortGetHeapStats(&stats);
+	TEST_ASSERT_EQUAL(initialFree, stats.xAvailableHeapSpaceInBytes);
+	TEST_ASSERT_EQUAL(1, stats.xNumberOfFreeBlocks);
+	TEST_ASSERT_EQUAL(initialFree, stats.xSizeOfLargestFreeBlockInBytes);
+}
+
+void setUp( void )
+{
+	//the first allocation sets the heap up
+	if(initialFree == 0)
+	{
+		vPortFree(pvPortMalloc(1));
+		initialFree = xPortGetFreeHeapSize();
+	}
+}
+
+void tearDown( void )
+{
+	freeAll();
+}
+
+void test_Malloc_AlignedDistinctAndWritable( void )
+{
+	for(uint32_t i = 0; i < MAX_BLOCKS; i++)
+	{
+		size_t size = 1 + i * 5;
+
+		blocks[i] = pvPortMalloc(size);
+		TEST_ASSERT_NOT_NULL(blocks[i]);
+		TEST_ASSERT_EQUAL(0, (size_t)blocks[i] & portBYTE_ALIGNMENT_MASK);
+		fillBlock(i, size);
+	}
+	for(uint32_t i = 0; i < MAX_BLOCKS; i++)
+	{
+		checkBlock(i);
+	}
+	TEST_ASSERT_NULL(pvPortMalloc(0));
+
+	freeAll();
+	assertSingleFreeBlock();
+}
+
+void test_RandomAllocFree_NothingOverwrittenAndFullyCoalesced( void )
+{
+	uint32_t random = 12345;
+	HeapStats_t stats;
+	size_t allocations;
+
+	vPortGetHeapStats(&stats);
+	allocations = stats.xNumberOfSuccessfulAllocations;
+
+	for(uint32_t op = 0; op < 20000; op++)
+	{
+		uint32_t index;
+
+		random = random * 1103515245u + 12345u;
+		index = (random >> 16) % MAX_BLOCKS;
+		if(blocks[index] == NULL)
+		{
+			size_t size = 1 + (random >> 4) % 160;
+
+			blocks[index] = pvPortMalloc(size);
+			TEST_ASSERT_NOT_NULL(blocks[index]);
+			fillBlock(index, size);
+			allocations++;
+		}
+		else
+		{
+			checkBlock(index);
+			vPortFree(blocks[index]);
+			blocks[index] = NULL;
+		}
+	}
+
+	freeAll();
+	assertSingleFreeBlock();
+	vPortGetHeapStats(&stats);
+	TEST_ASSERT_EQUAL(allocations, stats.xNumberOfSuccessfulAllocations);
+	TEST_ASSERT_EQUAL(stats.xNumberOfSuccessfulAllocations, stats.xNumberOfSuccessfulFrees);
+}
+
+void test_Fragmented_LargeBlockOnlyAfterNeighboursFreed( void )
+{
+	void* big;
+	uint32_t count = 0;
+	void* filler[512];
+	uint32_t numFillers = 0;
+
+	//fill the heap with 4KB blocks, then whatever space is left
+	while(count < MAX_BLOCKS && (blocks[count] = pvPortMalloc(4096)) != NULL)
+	{
+		count++;
+	}
+	TEST_ASSERT_LESS_THAN(MAX_BLOCKS, count);
+	while(numFillers < 512 && (filler[numFillers] = pvPortMalloc(16)) != NULL)
+	{
+		numFillers++;
+	}
+	TEST_ASSERT_NULL(pvPortMalloc(16));
+
+	//every other block free - plenty of space, none of it contiguous
+	for(uint32_t i = 0; i < count; i += 2)
+	{
+		vPortFree(blocks[i]);
+		blocks[i] = NULL;
+	}
+	TEST_ASSERT_NULL(pvPortMalloc(3 * 4096));
+
+	//freeing the blocks in between joins them back up
+	vPortFree(blocks[1]);
+	blocks[1] = NULL;
+	big = pvPortMalloc(3 * 4096);
+	TEST_ASSERT_NOT_NULL(big);
+	vPortFree(big);
+
+	for(uint32_t i = 0; i < numFillers; i++)
+	{
+		vPortFree(filler[i]);
+	}
+	freeAll();
+	assertSingleFreeBlock();
+	TEST_ASSERT_NULL(pvPortMalloc(initialFree + 1));
+}
+
+void test_OnlyFreeBlockInOwnClass_StillAllocated( void )
+{
+	void* filler[512];
+	uint32_t numFillers = 0;
+	uint32_t count = 0;
+
+	while(count < MAX_BLOCKS && (blocks[count] = pvPortMalloc(1000)) != NULL)
+	{
+		count++;
+	}
+	while(numFillers < 512 && (filler[numFillers] = pvPortMalloc(16)) != NULL)
+	{
+		numFillers++;
+	}
+
+	//the one free block is in the class of a 1000 byte request, but
+	//not every block of that class would fit, so it is only found by
+	//checking the head of the class's own list
+	vPortFree(blocks[count / 2]);
+	blocks[count / 2] = pvPortMalloc(1000);
+	TEST_ASSERT_NOT_NULL(blocks[count / 2]);
+
+	vPortFree(blocks[count / 2]);
+	blocks[count / 2] = NULL;
+	TEST_ASSERT_NULL(pvPortMalloc(1000 + portBYTE_ALIGNMENT));
+
+	for(uint32_t i = 0; i < numFillers; i++)
+	{
+		vPortFree(filler[i]);
+	}
+	freeAll();
+	assertSingleFreeBlock();
+}
+
+void test_ClassStats_MatchHeapStats( void )
+{
+	HeapClassStats_t before[MAX_CLASSES], after[MAX_CLASSES];
+	HeapStats_t stats;
+	UBaseType_t numClasses, smallClass = 0, largeClass, hugeClass;
+	size_t freeBlocks = 0, freeBytes = 0;
+
+	numClasses = uxPortGetHeapClassStats(before, MAX_CLASSES);
+	TEST_ASSERT_LESS_OR_EQUAL(MAX_CLASSES, numClasses);
+
+	for(uint32_t i = 0; i < 8; i++)
+	{
+		blocks[i] = pvPortMalloc(24);
+		blocks[i + 8] = pvPortMalloc(1000);
+	}
+	vPortFree(blocks[0]);
+	blocks[0] = NULL;
+	//class sizes include the block header, so keep clear of a boundary
+	TEST_ASSERT_NULL(pvPortMalloc(initialFree * 3 / 2));
+	uxPortGetHeapClassStats(after, MAX_CLASSES);
+
+	//classes cover increasing, contiguous ranges of block size
+	for(UBaseType_t i = 1; i < numClasses; i++)
+	{
+		TEST_ASSERT_GREATER_THAN(after[i - 1].xMinimumBlockSizeInBytes, after[i].xMinimumBlockSizeInBytes);
+	}
+	largeClass = classOf(after, numClasses, 1000);
+	hugeClass = classOf(after, numClasses, initialFree * 3 / 2);
+	TEST_ASSERT_NOT_EQUAL(smallClass, largeClass);
+	TEST_ASSERT_EQUAL(8, after[smallClass].xNumberOfSuccessfulAllocations - before[smallClass].xNumberOfSuccessfulAllocations);
+	TEST_ASSERT_EQUAL(1, after[smallClass].xNumberOfSuccessfulFrees - before[smallClass].xNumberOfSuccessfulFrees);
+	TEST_ASSERT_EQUAL(8, after[largeClass].xNumberOfSuccessfulAllocations - before[largeClass].xNumberOfSuccessfulAllocations);
+	TEST_ASSERT_EQUAL(1, after[hugeClass].xNumberOfFailedAllocations - before[hugeClass].xNumberOfFailedAllocations);
+
+	//the freed small block is the only free block below the large class
+	vPortGetHeapStats(&stats);
+	for(UBaseType_t i = 0; i < numClasses; i++)
+	{
+		freeBlocks += after[i].xNumberOfFreeBlocks;
+		freeBytes += after[i].xFreeBytes;
+	}
+	TEST_ASSERT_EQUAL(1, after[smallClass].xNumberOfFreeBlocks);
+	TEST_ASSERT_EQUAL(stats.xNumberOfFreeBlocks, freeBlocks);
+	TEST_ASSERT_EQUAL(stats.xAvailableHeapSpaceInBytes, freeBytes);
+}
+
+int main( void )
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_Malloc_AlignedDistinctAndWritable);
+	RUN_TEST(test_RandomAllocFree_NothingOverwrittenAndFullyCoalesced);
+	RUN_TEST(test_Fragmented_LargeBlockOnlyAfterNeighboursFreed);
+	RUN_TEST(test_OnlyFreeBlockInOwnClass_StillAllocated);
+	RUN_TEST(test_ClassStats_MatchHeapStats);
+	return UNITY_END();
+}
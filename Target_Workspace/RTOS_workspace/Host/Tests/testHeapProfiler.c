@@ -0,0 +1,365 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2019 Brian Amos
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <HeapProfiler.h>
+#include <SEGGER_SYSVIEW.h>
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+
+/*********************************************
+ * Unit tests for Drivers/HandsOnRTOS/HeapProfiler.c,
+ * on a heap_4 kernel with the allocator hooks pointed
+ * at it (HOST_HEAP_PROFILER).  The kernel runs on virtual
+ * time (configUSE_VIRTUAL_TIME), so the lifetimes are
+ * exactly the ticks delayed.
+ *
+ * usage: testHeapProfiler [dump file]
+ * 		the last test writes HeapProfilerDump's lines to the
+ * 		dump file, for the heapReport test to decode
+ *********************************************/
+
+#define STACK_SIZE 512
+#define TEST_PRIORITY (tskIDLE_PRIORITY + 3)
+#define FIXED_SIZE 40
+#define MAX_SITES 8
+
+static int testResult;
+static char const* dumpFileName = NULL;
+static FILE* dumpFile;
+
+/**
+ * two call sites - kept out of line so each has its own return address,
+ * and not ending in a tail call (which would leave pvPortMalloc the
+ * return address of whoever called these)
+ */
+void* __attribute__((noinline)) allocFixed( void )
+{
+	void* block = pvPortMalloc(FIXED_SIZE);
+
+	__asm__ volatile("" ::: "memory");
+	return block;
+}
+
+void* __attribute__((noinline)) allocVaried( size_t Size )
+{
+	void* block = pvPortMalloc(Size);
+
+	__asm__ volatile("" ::: "memory");
+	return block;
+}
+
+//return addresses of the pvPortMalloc calls in allocFixed and
+//allocVaried, as the profiler records them
+static void const* fixedCaller;
+static void const* variedCaller;
+
+/**
+ * learns the exact return address of each call site from the
+ * profiler itself - the helpers can sit closer together than
+ * any guess at their size
+ */
+static void findCallers( void )
+{
+	HeapProfilerSite_t site;
+	void* block;
+
+	HeapProfilerReset();
+	block = allocFixed();
+	configASSERT(HeapProfilerGetSites(&site, 1) == 1);
+	fixedCaller = site.Caller;
+	vPortFree(block);
+
+	HeapProfilerReset();
+	block = allocVaried(FIXED_SIZE);
+	configASSERT(HeapProfilerGetSites(&site, 1) == 1);
+	variedCaller = site.Caller;
+	vPortFree(block);
+
+	configASSERT(fixedCaller != variedCaller);
+}
+
+/**
+ * @returns the site Caller (fixedCaller or variedCaller) was
+ * 			recorded for by Task, or NULL if there isn't one
+ */
+static HeapProfilerSite_t* findSite( HeapProfilerSite_t* Sites, UBaseType_t NumSites,
+									void const* Caller, TaskHandle_t Task )
+{
+	for(UBaseType_t i = 0; i < NumSites; i++)
+	{
+		if(Sites[i].Caller == Caller && Sites[i].Task == Task)
+		{
+			return &Sites[i];
+		}
+	}
+	return NULL;
+}
+
+void setUp( void )
+{
+	HeapProfilerReset();
+}
+
+void tearDown( void )
+{
+}
+
+void test_Malloc_StatisticsPerCallSite( void )
+{
+	HeapProfilerSite_t sites[MAX_SITES];
+	HeapProfilerSite_t* fixed;
+	HeapProfilerSite_t* varied;
+	void* blocks[6];
+	UBaseType_t numSites;
+
+	for(int i = 0; i < 3; i++)
+	{
+		blocks[i] = allocFixed();
+		blocks[3 + i] = allocVaried(10 + 100 * i);
+	}
+	numSites = HeapProfilerGetSites(sites, MAX_SITES);
+	TEST_ASSERT_EQUAL(2, numSites);
+
+	fixed = findSite(sites, numSites, fixedCaller, xTaskGetCurrentTaskHandle());
+	TEST_ASSERT_NOT_NULL(fixed);
+	TEST_ASSERT_EQUAL_STRING("test", fixed->TaskName);
+	TEST_ASSERT_EQUAL(3, fixed->Allocs);
+	TEST_ASSERT_EQUAL(3, fixed->Live);
+	TEST_ASSERT_EQUAL(3 * FIXED_SIZE, fixed->LiveBytes);
+	TEST_ASSERT_EQUAL(FIXED_SIZE, fixed->MinSize);
+	TEST_ASSERT_EQUAL(FIXED_SIZE, fixed->MaxSize);
+
+	varied = findSite(sites, numSites, variedCaller, xTaskGetCurrentTaskHandle());
+	TEST_ASSERT_NOT_NULL(varied);
+	TEST_ASSERT_EQUAL(3, varied->Allocs);
+	TEST_ASSERT_EQUAL(10 + 110 + 210, varied->TotalBytes);
+	TEST_ASSERT_EQUAL(10, varied->MinSize);
+	TEST_ASSERT_EQUAL(210, varied->MaxSize);
+
+	for(int i = 0; i < 6; i++)
+	{
+		vPortFree(blocks[i]);
+	}
+}
+
+void test_Free_TracksLiveBlocksAndLifetimes( void )
+{
+	HeapProfilerSite_t site;
+	HeapProfilerSummary_t summary;
+	void* first = allocFixed();
+	void* second = allocFixed();
+
+	vTaskDelay(5);
+	vPortFree(first);
+	vTaskDelay(20);
+	vPortFree(second);
+
+	TEST_ASSERT_EQUAL(1, HeapProfilerGetSites(&site, 1));
+	TEST_ASSERT_EQUAL(2, site.Frees);
+	TEST_ASSERT_EQUAL(0, site.Live);
+	TEST_ASSERT_EQUAL(0, site.LiveBytes);
+	TEST_ASSERT_EQUAL(2, site.PeakLive);
+	TEST_ASSERT_EQUAL(2 * FIXED_SIZE, site.PeakBytes);
+	TEST_ASSERT_EQUAL(5 + 25, site.LifetimeTotal);
+	TEST_ASSERT_EQUAL(25, site.LifetimeMax);
+
+	//40 bytes has 6 bits, 5 ticks 3 bits and 25 ticks 5 bits
+	HeapProfilerGetSummary(&summary);
+	TEST_ASSERT_EQUAL(2, summary.Sizes[6]);
+	TEST_ASSERT_EQUAL(1, summary.Lifetimes[3]);
+	TEST_ASSERT_EQUAL(1, summary.Lifetimes[5]);
+	TEST_ASSERT_EQUAL(0, summary.UntrackedFrees);
+}
+
+void test_Malloc_FailureCountedAgainstItsSite( void )
+{
+	HeapProfilerSite_t site;
+
+	TEST_ASSERT_NULL(allocVaried(configTOTAL_HEAP_SIZE * 2));
+	TEST_ASSERT_EQUAL(1, HeapProfilerGetSites(&site, 1));
+	TEST_ASSERT_EQUAL(1, site.Failed);
+	TEST_ASSERT_EQUAL(0, site.Allocs);
+}
+
+static void otherTask( void* Block )
+{
+	*(void**)Block = allocFixed();
+	vTaskDelete(NULL);
+}
+
+void test_Malloc_EachTaskHasItsOwnSite( void )
+{
+	HeapProfilerSite_t sites[MAX_SITES];
+	HeapProfilerSite_t* other;
+	TaskHandle_t otherHandle;
+	void* mine = allocFixed();
+	void* volatile theirs = NULL;
+	UBaseType_t numSites;
+
+	xTaskCreate(otherTask, "other task", STACK_SIZE, (void*)&theirs, TEST_PRIORITY + 1, &otherHandle);
+	TEST_ASSERT_NOT_NULL(theirs);
+
+	numSites = HeapProfilerGetSites(sites, MAX_SITES);
+	TEST_ASSERT_NOT_NULL(findSite(sites, numSites, fixedCaller, xTaskGetCurrentTaskHandle()));
+	other = findSite(sites, numSites, fixedCaller, otherHandle);
+	TEST_ASSERT_NOT_NULL(other);
+	TEST_ASSERT_EQUAL_STRING("other task", other->TaskName);
+	TEST_ASSERT_EQUAL(1, other->Live);
+
+	vPortFree(mine);
+	vPortFree(theirs);
+}
+
+void test_SysView_EventForEveryAllocAndFree( void )
+{
+	uint32_t allocs = SysViewHostNumHeapAllocs();
+	uint32_t frees = SysViewHostNumHeapFrees();
+	void* block = allocFixed();
+
+	vPortFree(block);
+	TEST_ASSERT_NULL(allocVaried(configTOTAL_HEAP_SIZE * 2));
+	TEST_ASSERT_EQUAL(allocs + 1, SysViewHostNumHeapAllocs());
+	TEST_ASSERT_EQUAL(frees + 1, SysViewHostNumHeapFrees());
+}
+
+void test_Reset_EarlierBlocksFreedUntracked( void )
+{
+	HeapProfilerSummary_t summary;
+	void* block = allocFixed();
+
+	HeapProfilerReset();
+	vPortFree(block);
+	HeapProfilerGetSummary(&summary);
+	TEST_ASSERT_EQUAL(0, summary.NumSites);
+	TEST_ASSERT_EQUAL(1, summary.UntrackedFrees);
+}
+
+void test_Malloc_LiveTableFullStillCountsAllocs( void )
+{
+	HeapProfilerSite_t site;
+	HeapProfilerSummary_t summary;
+	void* blocks[HEAP_PROFILER_MAX_LIVE + 2];
+
+	for(int i = 0; i < HEAP_PROFILER_MAX_LIVE + 2; i++)
+	{
+		blocks[i] = allocVaried(8);
+		TEST_ASSERT_NOT_NULL(blocks[i]);
+	}
+	HeapProfilerGetSummary(&summary);
+	TEST_ASSERT_EQUAL(2, summary.UntrackedAllocs);
+	HeapProfilerGetSites(&site, 1);
+	TEST_ASSERT_EQUAL(HEAP_PROFILER_MAX_LIVE + 2, site.Allocs);
+	TEST_ASSERT_EQUAL(HEAP_PROFILER_MAX_LIVE, site.Live);
+
+	//every tracked block is found again, whatever order they go in
+	for(int i = HEAP_PROFILER_MAX_LIVE + 1; i >= 0; i -= 2)
+	{
+		vPortFree(blocks[i]);
+	}
+	for(int i = HEAP_PROFILER_MAX_LIVE; i >= 0; i -= 2)
+	{
+		vPortFree(blocks[i]);
+	}
+	HeapProfilerGetSummary(&summary);
+	HeapProfilerGetSites(&site, 1);
+	TEST_ASSERT_EQUAL(0, site.Live);
+	TEST_ASSERT_EQUAL(2, summary.UntrackedFrees);
+}
+
+static void printLine( char const* Line )
+{
+	if(dumpFile != NULL)
+	{
+		fprintf(dumpFile, "%s\n", Line);
+	}
+}
+
+void test_Dump_WritesEverySite( void )
+{
+	void* blocks[4];
+	char line[256];
+	int siteLines = 0;
+
+	//the blocks heapReport finds: a fixed size site still holding two
+	//blocks and a varied size one that has freed everything
+	blocks[0] = allocFixed();
+	blocks[1] = allocFixed();
+	blocks[2] = allocVaried(24);
+	blocks[3] = allocVaried(300);
+	vTaskDelay(3);
+	vPortFree(blocks[2]);
+	vPortFree(blocks[3]);
+
+	dumpFile = (dumpFileName != NULL) ? fopen(dumpFileName, "w+") : tmpfile();
+	TEST_ASSERT_NOT_NULL(dumpFile);
+	HeapProfilerDump(printLine);
+
+	rewind(dumpFile);
+	TEST_ASSERT_NOT_NULL(fgets(line, sizeof(line), dumpFile));
+	TEST_ASSERT_EQUAL(0, strncmp(line, "heapprof heap ", 14));
+	while(fgets(line, sizeof(line), dumpFile) != NULL)
+	{
+		if(strncmp(line, "heapprof site ", 14) == 0)
+		{
+			siteLines++;
+		}
+	}
+	TEST_ASSERT_EQUAL_STRING("heapprof end\n", line);
+	TEST_ASSERT_EQUAL(2, siteLines);
+	fclose(dumpFile);
+	dumpFile = NULL;
+}
+
+static void testTask( void* NotUsed )
+{
+	findCallers();
+	UNITY_BEGIN();
+	RUN_TEST(test_Malloc_StatisticsPerCallSite);
+	RUN_TEST(test_Free_TracksLiveBlocksAndLifetimes);
+	RUN_TEST(test_Malloc_FailureCountedAgainstItsSite);
+	RUN_TEST(test_Malloc_EachTaskHasItsOwnSite);
+	RUN_TEST(test_SysView_EventForEveryAllocAndFree);
+	RUN_TEST(test_Reset_EarlierBlocksFreedUntracked);
+	RUN_TEST(test_Malloc_LiveTableFullStillCountsAllocs);
+	RUN_TEST(test_Dump_WritesEverySite);
+	testResult = UNITY_END();
+	vTaskEndScheduler();
+}
+
+int main( int argc, char* argv[] )
+{
+	if(argc > 1)
+	{
+		dumpFileName = argv[1];
+	}
+	SEGGER_SYSVIEW_Conf();
+	configASSERT(xTaskCreate(testTask, "test", STACK_SIZE, NULL, TEST_PRIORITY, NULL) == pdPASS);
+
+	vTaskStartScheduler();
+	return testResult;
+}
@@ -0,0 +1,203 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2019 Brian Amos
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <LatencyHistogram.h>
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+
+/*********************************************
+ * Unit tests for Drivers/HandsOnRTOS/LatencyHistogram.c
+ *
+ * The histograms filled from an interrupt are checked end to
+ * end by simTim9Latency, these cover the bucket layout and
+ * the statistics worked out from it.
+ *********************************************/
+
+static LatencyHist_t hist;
+
+void setUp( void )
+{
+	LatencyHistReset(&hist);
+}
+
+void tearDown( void )
+{
+}
+
+void test_Empty_AllStatisticsZero( void )
+{
+	LatencyHistSummary_t sum;
+
+	LatencyHistSummarize(&hist, &sum);
+	TEST_ASSERT_EQUAL(0, sum.Count);
+	TEST_ASSERT_EQUAL(0, sum.Min);
+	TEST_ASSERT_EQUAL(0, sum.Mean);
+	TEST_ASSERT_EQUAL(0, sum.P99);
+	TEST_ASSERT_EQUAL(0, sum.Max);
+}
+
+void test_Buckets_CoverEveryValueOnce( void )
+{
+	TEST_ASSERT_EQUAL(0, LatencyHistBucketLow(0));
+	for(uint32_t i = 1; i < LATENCY_HIST_BUCKETS; i++)
+	{
+		TEST_ASSERT_EQUAL(LatencyHistBucketHigh(i - 1) + 1, LatencyHistBucketLow(i));
+		TEST_ASSERT_TRUE(LatencyHistBucketHigh(i) >= LatencyHistBucketLow(i));
+	}
+	TEST_ASSERT_EQUAL(UINT32_MAX, LatencyHistBucketHigh(LATENCY_HIST_BUCKETS - 1));
+}
+
+void test_Buckets_NoWiderThanAnEighth( void )
+{
+	for(uint32_t i = 16; i < LATENCY_HIST_BUCKETS; i++)
+	{
+		uint32_t width = LatencyHistBucketHigh(i) - LatencyHistBucketLow(i) + 1;
+		TEST_ASSERT_TRUE(width <= LatencyHistBucketLow(i) / 8);
+	}
+}
+
+void test_Record_ValueLandsInItsBucket( void )
+{
+	uint32_t const values[] = { 0, 7, 15, 16, 17, 1000, 65535, 123456789, UINT32_MAX };
+
+	for(uint32_t v = 0; v < sizeof(values) / sizeof(values[0]); v++)
+	{
+		uint32_t found = LATENCY_HIST_BUCKETS;
+
+		LatencyHistReset(&hist);
+		LatencyHistRecord(&hist, values[v]);
+		for(uint32_t i = 0; i < LATENCY_HIST_BUCKETS; i++)
+		{
+			if(hist.Buckets[i] != 0)
+			{
+				found = i;
+			}
+		}
+		TEST_ASSERT_TRUE(found < LATENCY_HIST_BUCKETS);
+		TEST_ASSERT_TRUE(values[v] >= LatencyHistBucketLow(found));
+		TEST_ASSERT_TRUE(values[v] <= LatencyHistBucketHigh(found));
+	}
+}
+
+void test_SmallValues_StatisticsExact( void )
+{
+	LatencyHistSummary_t sum;
+
+	//1 - 10, each recorded ten times
+	for(uint32_t v = 1; v <= 10; v++)
+	{
+		for(uint32_t n = 0; n < 10; n++)
+		{
+			LatencyHistRecord(&hist, v);
+		}
+	}
+	LatencyHistSummarize(&hist, &sum);
+	TEST_ASSERT_EQUAL(100, sum.Count);
+	TEST_ASSERT_EQUAL(1, sum.Min);
+	TEST_ASSERT_EQUAL(5, sum.Mean);
+	TEST_ASSERT_EQUAL(5, sum.P50);
+	TEST_ASSERT_EQUAL(10, sum.P99);
+	TEST_ASSERT_EQUAL(10, sum.Max);
+	TEST_ASSERT_EQUAL(1, LatencyHistPercentile(&hist, 0));
+	TEST_ASSERT_EQUAL(9, LatencyHistPercentile(&hist, 900));
+	TEST_ASSERT_EQUAL(10, LatencyHistPercentile(&hist, 901));
+}
+
+void test_Percentile_WithinBucketOfTheTrueValue( void )
+{
+	uint32_t p99;
+
+	//99 fast events and one slow one - the p99 is the fast ones' bucket
+	for(uint32_t i = 0; i < 99; i++)
+	{
+		LatencyHistRecord(&hist, 1000 + i);
+	}
+	LatencyHistRecord(&hist, 50000);
+
+	p99 = LatencyHistPercentile(&hist, 990);
+	TEST_ASSERT_TRUE(p99 >= 1098);
+	TEST_ASSERT_TRUE(p99 <= 1098 + 1098 / 8);
+	TEST_ASSERT_EQUAL(50000, LatencyHistPercentile(&hist, 1000));
+	TEST_ASSERT_EQUAL(50000, hist.Max);
+	TEST_ASSERT_EQUAL(1000, hist.Min);
+}
+
+void test_Percentile_NeverAboveMax( void )
+{
+	LatencyHistRecord(&hist, 1000);
+	LatencyHistRecord(&hist, 1001);
+	TEST_ASSERT_EQUAL(1001, LatencyHistPercentile(&hist, 990));
+}
+
+void test_Mean_NoOverflowForLargeValues( void )
+{
+	for(uint32_t i = 0; i < 16; i++)
+	{
+		LatencyHistRecord(&hist, UINT32_MAX - 1);
+	}
+	TEST_ASSERT_EQUAL(UINT32_MAX - 1, LatencyHistMean(&hist));
+}
+
+static char dumped[8][96];
+static uint32_t numDumped;
+
+static void collect( char const* Line )
+{
+	if(numDumped < 8)
+	{
+		strncpy(dumped[numDumped], Line, sizeof(dumped[0]) - 1);
+	}
+	numDumped++;
+}
+
+void test_Dump_SummaryThenNonEmptyBuckets( void )
+{
+	numDumped = 0;
+	LatencyHistRecord(&hist, 3);
+	LatencyHistRecord(&hist, 3);
+	LatencyHistRecord(&hist, 100);
+	LatencyHistDump(&hist, "entry", collect);
+
+	TEST_ASSERT_EQUAL(3, numDumped);
+	TEST_ASSERT_EQUAL_STRING("lathist entry 3 3 35 3 100 100", dumped[0]);
+	TEST_ASSERT_EQUAL_STRING("lathist entry bucket 3 3 2", dumped[1]);
+	TEST_ASSERT_EQUAL_STRING("lathist entry bucket 96 103 1", dumped[2]);
+}
+
+int main( void )
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_Empty_AllStatisticsZero);
+	RUN_TEST(test_Buckets_CoverEveryValueOnce);
+	RUN_TEST(test_Buckets_NoWiderThanAnEighth);
+	RUN_TEST(test_Record_ValueLandsInItsBucket);
+	RUN_TEST(test_SmallValues_StatisticsExact);
+	RUN_TEST(test_Percentile_WithinBucketOfTheTrueValue);
+	RUN_TEST(test_Percentile_NeverAboveMax);
+	RUN_TEST(test_Mean_NoOverflowForLargeValues);
+	RUN_TEST(test_Dump_SummaryThenNonEmptyBuckets);
+	return UNITY_END();
+}
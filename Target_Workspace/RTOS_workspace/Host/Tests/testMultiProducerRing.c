@@ -0,0 +1,187 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2019 Brian Amos
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <FreeRTOS.h>
+#include <MultiProducerRing.h>
+#include <unity.h>
+#include <string.h>
+
+/*********************************************
+ * Unit tests for Drivers/HandsOnRTOS/MultiProducerRing.c
+ *
+ * These exercise the single threaded behavior (ordering of
+ * out of order commits, wrapping, full rings) - contention
+ * between writers is covered by benchMultiProducerTx.
+ *********************************************/
+
+#define RING_LEN 64
+
+static uint8_t storage[RING_LEN];
+static MpRing_t ring;
+
+void setUp( void )
+{
+	memset(storage, 0, sizeof(storage));
+	MpRingInit(&ring, storage, RING_LEN);
+}
+
+void tearDown( void )
+{
+	vEventGroupDelete(ring.Events);
+}
+
+static void fill( MpRingReservation_t const* Reservation, uint8_t Value )
+{
+	memset(Reservation->Spans.pucFirst, Value, Reservation->Spans.xFirstLength);
+	if(Reservation->Spans.xSecondLength > 0)
+	{
+		memset(Reservation->Spans.pucSecond, Value, Reservation->Spans.xSecondLength);
+	}
+}
+
+void test_Send_DataVisibleToReader( void )
+{
+	StreamBufferSpans_t spans;
+
+	TEST_ASSERT_EQUAL(5, MpRingSend(&ring, "hello", 5, 0));
+	TEST_ASSERT_EQUAL(5, MpRingPeek(&ring, &spans, 0));
+	TEST_ASSERT_EQUAL(5, spans.xFirstLength);
+	TEST_ASSERT_EQUAL(0, spans.xSecondLength);
+	TEST_ASSERT_EQUAL_MEMORY("hello", spans.pucFirst, 5);
+
+	//peeking doesn't remove anything
+	TEST_ASSERT_EQUAL(5, MpRingPeek(&ring, &spans, 0));
+	MpRingConsume(&ring, 5);
+	TEST_ASSERT_EQUAL(0, MpRingPeek(&ring, &spans, 0));
+}
+
+void test_OutOfOrderCommit_ReaderWaitsForEarlierRegion( void )
+{
+	MpRingReservation_t first, second;
+	StreamBufferSpans_t spans;
+
+	TEST_ASSERT_EQUAL(pdPASS, MpRingReserve(&ring, 4, &first));
+	TEST_ASSERT_EQUAL(pdPASS, MpRingReserve(&ring, 6, &second));
+	TEST_ASSERT_EQUAL_PTR(first.Spans.pucFirst + 4, second.Spans.pucFirst);
+
+	//the second writer finishes first - nothing can be read yet
+	fill(&second, 'b');
+	MpRingCommit(&ring, &second);
+	TEST_ASSERT_EQUAL(0, MpRingPeek(&ring, &spans, 0));
+
+	fill(&first, 'a');
+	MpRingCommit(&ring, &first);
+	TEST_ASSERT_EQUAL(10, MpRingPeek(&ring, &spans, 0));
+	TEST_ASSERT_EQUAL_MEMORY("aaaabbbbbb", spans.pucFirst, 10);
+}
+
+void test_PartialConsume_RecordKeptUntilFullyRead( void )
+{
+	StreamBufferSpans_t spans;
+
+	MpRingSend(&ring, "0123456789", 10, 0);
+	MpRingConsume(&ring, 4);
+	TEST_ASSERT_EQUAL(6, MpRingPeek(&ring, &spans, 0));
+	TEST_ASSERT_EQUAL_MEMORY("456789", spans.pucFirst, 6);
+
+	MpRingSend(&ring, "ab", 2, 0);
+	MpRingConsume(&ring, 7);
+	TEST_ASSERT_EQUAL(1, MpRingPeek(&ring, &spans, 0));
+	TEST_ASSERT_EQUAL('b', spans.pucFirst[0]);
+}
+
+void test_RegionWrappingStorage_ReturnedAsTwoSpans( void )
+{
+	StreamBufferSpans_t spans;
+	uint8_t msg[20];
+
+	for(size_t i = 0; i < sizeof(msg); i++)
+	{
+		msg[i] = (uint8_t)i;
+	}
+
+	//move the tail to 56 bytes from the start
+	for(int i = 0; i < 7; i++)
+	{
+		MpRingSend(&ring, msg, 8, 0);
+		MpRingConsume(&ring, 8);
+	}
+
+	TEST_ASSERT_EQUAL(sizeof(msg), MpRingSend(&ring, msg, sizeof(msg), 0));
+	TEST_ASSERT_EQUAL(sizeof(msg), MpRingPeek(&ring, &spans, 0));
+	TEST_ASSERT_EQUAL_PTR(&storage[RING_LEN - 8], spans.pucFirst);
+	TEST_ASSERT_EQUAL(8, spans.xFirstLength);
+	TEST_ASSERT_EQUAL_PTR(storage, spans.pucSecond);
+	TEST_ASSERT_EQUAL(12, spans.xSecondLength);
+	TEST_ASSERT_EQUAL_MEMORY(msg, spans.pucFirst, 8);
+	TEST_ASSERT_EQUAL_MEMORY(&msg[8], spans.pucSecond, 12);
+}
+
+void test_Full_SendIsAllOrNothing( void )
+{
+	static uint8_t msg[RING_LEN];
+	StreamBufferSpans_t spans;
+
+	TEST_ASSERT_EQUAL(40, MpRingSend(&ring, msg, 40, 0));
+	TEST_ASSERT_EQUAL(0, MpRingSend(&ring, msg, 25, 0));
+	TEST_ASSERT_EQUAL(24, MpRingSend(&ring, msg, 24, 0));
+	TEST_ASSERT_EQUAL(0, MpRingSend(&ring, msg, 1, 0));
+	TEST_ASSERT_EQUAL(0, MpRingSend(&ring, msg, RING_LEN + 1, 0));
+	TEST_ASSERT_EQUAL(RING_LEN, MpRingPeek(&ring, &spans, 0));
+
+	MpRingConsume(&ring, 40);
+	TEST_ASSERT_EQUAL(40, MpRingSend(&ring, msg, 40, 0));
+}
+
+void test_RecordsExhausted_SendFailsUntilConsumed( void )
+{
+	StreamBufferSpans_t spans;
+	MpRing_t bigRing;
+	static uint8_t bigStorage[1024];
+
+	MpRingInit(&bigRing, bigStorage, sizeof(bigStorage));
+	for(int i = 0; i < MP_RING_MAX_RECORDS; i++)
+	{
+		TEST_ASSERT_EQUAL(1, MpRingSend(&bigRing, "x", 1, 0));
+	}
+	TEST_ASSERT_EQUAL(0, MpRingSend(&bigRing, "x", 1, 0));
+
+	TEST_ASSERT_EQUAL(MP_RING_MAX_RECORDS, MpRingPeek(&bigRing, &spans, 0));
+	MpRingConsume(&bigRing, 1);
+	TEST_ASSERT_EQUAL(1, MpRingSend(&bigRing, "y", 1, 0));
+	vEventGroupDelete(bigRing.Events);
+}
+
+int main( void )
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_Send_DataVisibleToReader);
+	RUN_TEST(test_OutOfOrderCommit_ReaderWaitsForEarlierRegion);
+	RUN_TEST(test_PartialConsume_RecordKeptUntilFullyRead);
+	RUN_TEST(test_RegionWrappingStorage_ReturnedAsTwoSpans);
+	RUN_TEST(test_Full_SendIsAllOrNothing);
+	RUN_TEST(test_RecordsExhausted_SendFailsUntilConsumed);
+	return UNITY_END();
+}
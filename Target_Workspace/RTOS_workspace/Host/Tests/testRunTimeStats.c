@@ -0,0 +1,252 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2019 Brian Amos
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <RunTimeStats.h>
+#include <FreeRTOS_CLI.h>
+#include <SEGGER_SYSVIEW.h>
+#include <unity.h>
+#include <stdbool.h>
+#include <string.h>
+#include "HostSupport.h"
+
+/*********************************************
+ * Unit tests for Drivers/HandsOnRTOS/RunTimeStats.c,
+ * on a kernel with the task switch hooks pointed at it
+ * (HOST_RUN_TIME_STATS).  Counts are ns on the host.
+ *********************************************/
+
+#define STACK_SIZE 512
+#define TEST_PRIORITY (tskIDLE_PRIORITY + 3)
+#define MS (1000000u)
+
+static int testResult;
+static TaskHandle_t helper = NULL;
+
+static void spin( uint32_t Ms )
+{
+	uint64_t until = HostTimeNs() + (uint64_t)Ms * MS;
+
+	while(HostTimeNs() < until)
+	{
+	}
+}
+
+static void spinTask( void* NotUsed )
+{
+	spin(20);
+	vTaskSuspend(NULL);
+}
+
+static void waitTask( void* NotUsed )
+{
+	ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+	vTaskSuspend(NULL);
+}
+
+static void delayTask( void* NotUsed )
+{
+	vTaskDelay(5);
+	vTaskDelay(30);
+	vTaskSuspend(NULL);
+}
+
+void setUp( void )
+{
+	RunTimeStatsReset();
+}
+
+void tearDown( void )
+{
+	if(helper != NULL)
+	{
+		vTaskDelete(helper);
+		helper = NULL;
+	}
+}
+
+void test_CpuTime_CountsTimeSpentRunning( void )
+{
+	RunTimeStatsTask_t stats;
+
+	//higher priority, so it runs straight away
+	xTaskCreate(spinTask, "spin", STACK_SIZE, NULL, TEST_PRIORITY + 1, &helper);
+
+	TEST_ASSERT_EQUAL(pdTRUE, RunTimeStatsGetTask(helper, &stats));
+	TEST_ASSERT_EQUAL_STRING("spin", stats.Name);
+	TEST_ASSERT_EQUAL(1, stats.Switches);
+	TEST_ASSERT_TRUE(stats.CpuTime >= 20 * MS);
+	TEST_ASSERT_TRUE(stats.CpuTime < 1000 * MS);
+}
+
+void test_Latency_ReadyUntilRunning( void )
+{
+	RunTimeStatsTask_t stats;
+
+	xTaskCreate(waitTask, "wait", STACK_SIZE, NULL, TEST_PRIORITY - 1, &helper);
+	vTaskDelay(2);
+	RunTimeStatsReset();
+
+	//readied here, but it can't run until this task blocks
+	xTaskNotifyGive(helper);
+	spin(10);
+	vTaskDelay(2);
+
+	TEST_ASSERT_EQUAL(pdTRUE, RunTimeStatsGetTask(helper, &stats));
+	TEST_ASSERT_EQUAL(1, stats.Switches);
+	TEST_ASSERT_TRUE(stats.LatencyMax >= 10 * MS);
+	TEST_ASSERT_EQUAL(stats.LatencyMax, stats.LatencyTotal);
+}
+
+void test_BlockedMax_LongestBlock( void )
+{
+	RunTimeStatsTask_t stats;
+
+	xTaskCreate(delayTask, "delay", STACK_SIZE, NULL, TEST_PRIORITY + 1, &helper);
+	vTaskDelay(50);
+
+	TEST_ASSERT_EQUAL(pdTRUE, RunTimeStatsGetTask(helper, &stats));
+	TEST_ASSERT_EQUAL(3, stats.Switches);
+	TEST_ASSERT_TRUE(stats.BlockedMax >= 29 * MS);
+	TEST_ASSERT_TRUE(stats.BlockedMax < 1000 * MS);
+}
+
+void test_Yield_NoSwitchWhenReselected( void )
+{
+	RunTimeStatsTask_t before;
+	RunTimeStatsTask_t after;
+
+	RunTimeStatsGetTask(xTaskGetCurrentTaskHandle(), &before);
+	for(int i = 0; i < 10; i++)
+	{
+		taskYIELD();
+	}
+	RunTimeStatsGetTask(xTaskGetCurrentTaskHandle(), &after);
+	TEST_ASSERT_EQUAL(before.Switches, after.Switches);
+	TEST_ASSERT_TRUE(after.CpuTime >= before.CpuTime);
+}
+
+void test_Delete_TaskNoLongerTracked( void )
+{
+	RunTimeStatsSummary_t summary;
+	RunTimeStatsTask_t stats;
+	UBaseType_t numTasks;
+
+	xTaskCreate(waitTask, "wait", STACK_SIZE, NULL, TEST_PRIORITY - 1, &helper);
+	RunTimeStatsGetSummary(&summary);
+	numTasks = summary.NumTasks;
+	TEST_ASSERT_EQUAL(pdTRUE, RunTimeStatsGetTask(helper, &stats));
+
+	vTaskDelete(helper);
+	TEST_ASSERT_EQUAL(pdFALSE, RunTimeStatsGetTask(helper, &stats));
+	helper = NULL;
+	RunTimeStatsGetSummary(&summary);
+	TEST_ASSERT_EQUAL(numTasks - 1, summary.NumTasks);
+	TEST_ASSERT_EQUAL(0, summary.UntrackedTasks);
+}
+
+void test_Reset_StatsZeroed( void )
+{
+	RunTimeStatsSummary_t summary;
+	RunTimeStatsTask_t stats;
+
+	vTaskDelay(2);
+	RunTimeStatsReset();
+	RunTimeStatsGetTask(xTaskGetCurrentTaskHandle(), &stats);
+	TEST_ASSERT_EQUAL(0, stats.Switches);
+	TEST_ASSERT_EQUAL(0, stats.BlockedMax);
+	TEST_ASSERT_TRUE(stats.CpuTime < 10 * MS);
+	RunTimeStatsGetSummary(&summary);
+	TEST_ASSERT_EQUAL(1000000000u, summary.Frequency);
+	TEST_ASSERT_TRUE(summary.Elapsed < 10 * MS);
+}
+
+void test_SendSysView_RecordPerTask( void )
+{
+	RunTimeStatsSummary_t summary;
+	uint32_t numEvents = SysViewHostNumModuleEvents();
+	unsigned int eventId;
+	U32 params[5];
+
+	spin(5);
+	RunTimeStatsGetSummary(&summary);
+	RunTimeStatsSendSysView();
+	TEST_ASSERT_EQUAL(numEvents + summary.NumTasks, SysViewHostNumModuleEvents());
+
+	SysViewHostLastModuleEvent(&eventId, params);
+	TEST_ASSERT_EQUAL(512, eventId);
+	TEST_ASSERT_TRUE(params[1] <= 1000);
+}
+
+void test_Cli_LinePerTask( void )
+{
+	RunTimeStatsSummary_t summary;
+	char output[configCOMMAND_INT_MAX_OUTPUT_SIZE];
+	BaseType_t more;
+	UBaseType_t lines = 0;
+	bool foundTest = false;
+
+	RunTimeStatsGetSummary(&summary);
+	do
+	{
+		more = FreeRTOS_CLIProcessCommand("task-stats", output, sizeof(output));
+		TEST_ASSERT_NOT_EQUAL(0, strlen(output));
+		if(lines > 0 && strncmp(output, "test ", 5) == 0)
+		{
+			foundTest = true;
+		}
+		lines++;
+	}while(more != pdFALSE);
+
+	TEST_ASSERT_EQUAL(summary.NumTasks + 1, lines);
+	TEST_ASSERT_TRUE(foundTest);
+}
+
+static void testTask( void* NotUsed )
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_CpuTime_CountsTimeSpentRunning);
+	RUN_TEST(test_Latency_ReadyUntilRunning);
+	RUN_TEST(test_BlockedMax_LongestBlock);
+	RUN_TEST(test_Yield_NoSwitchWhenReselected);
+	RUN_TEST(test_Delete_TaskNoLongerTracked);
+	RUN_TEST(test_Reset_StatsZeroed);
+	RUN_TEST(test_SendSysView_RecordPerTask);
+	RUN_TEST(test_Cli_LinePerTask);
+	testResult = UNITY_END();
+	vTaskEndScheduler();
+}
+
+int main( void )
+{
+	SEGGER_SYSVIEW_Conf();
+	RunTimeStatsInit(0);
+	RunTimeStatsRegisterCommand();
+	configASSERT(xTaskCreate(testTask, "test", STACK_SIZE, NULL, TEST_PRIORITY, NULL) == pdPASS);
+
+	vTaskStartScheduler();
+	return testResult;
+}
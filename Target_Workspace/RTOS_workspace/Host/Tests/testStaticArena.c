@@ -0,0 +1,210 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2019 Brian Amos
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <queue.h>
+#include <stream_buffer.h>
+#include <message_buffer.h>
+#include <StaticArena.h>
+#include <unity.h>
+#include <string.h>
+
+/*********************************************
+ * Unit tests for Drivers/HandsOnRTOS/StaticArena.h
+ *
+ * Built against a kernel without a heap
+ * (configSUPPORT_DYNAMIC_ALLOCATION 0), so everything
+ * below - the test task included - is created without
+ * any heap work.
+ *********************************************/
+
+#define STACK_SIZE 512
+#define TEST_PRIORITY (tskIDLE_PRIORITY + 3)
+#define QUEUE_LEN 5
+#define STREAM_SIZE 64
+#define MESSAGE_SIZE 48
+#define POOL_BLOCKS 3
+
+typedef struct
+{
+	uint32_t Seq;
+	char Message[20];
+}Msg_t;
+
+#define TEST_ARENA(TASK, QUEUE, STREAM_BUFFER, POOL)	\
+	TASK(Test, STACK_SIZE)							\
+	TASK(Worker, configMINIMAL_STACK_SIZE)			\
+	QUEUE(Seqs, QUEUE_LEN, sizeof(uint32_t))		\
+	STREAM_BUFFER(Bytes, STREAM_SIZE)				\
+	STREAM_BUFFER(Messages, MESSAGE_SIZE)			\
+	POOL(WorkerMsgs, Msg_t, POOL_BLOCKS)
+
+ARENA_STATIC(arena, TEST_ARENA);
+ARENA_ASSERT_FITS(arena, 16 * 1024);
+
+static int testResult;
+static QueueHandle_t seqs;
+
+void setUp( void )
+{
+}
+
+void tearDown( void )
+{
+}
+
+static int inArena( void const* Start, size_t Size )
+{
+	uint8_t const* start = (uint8_t const*)Start;
+	uint8_t const* arenaStart = (uint8_t const*)&arena;
+
+	return start >= arenaStart && start + Size <= arenaStart + sizeof(arena);
+}
+
+void test_Layout_ObjectsPackedInOrderWithinFootprint( void )
+{
+	size_t objects =	ARENA_OBJECT_SIZE(arena, Test) + ARENA_OBJECT_SIZE(arena, Worker) +
+						ARENA_OBJECT_SIZE(arena, Seqs) + ARENA_OBJECT_SIZE(arena, Bytes) +
+						ARENA_OBJECT_SIZE(arena, Messages) + ARENA_OBJECT_SIZE(arena, WorkerMsgs);
+
+	TEST_ASSERT_EQUAL(0, ARENA_OFFSET(arena, Test));
+	TEST_ASSERT_EQUAL(ARENA_OBJECT_SIZE(arena, Test), ARENA_OFFSET(arena, Worker));
+	TEST_ASSERT_TRUE(ARENA_OFFSET(arena, Seqs) > ARENA_OFFSET(arena, Worker));
+	TEST_ASSERT_TRUE(ARENA_OFFSET(arena, Bytes) > ARENA_OFFSET(arena, Seqs));
+	TEST_ASSERT_TRUE(ARENA_OFFSET(arena, Messages) > ARENA_OFFSET(arena, Bytes));
+	TEST_ASSERT_TRUE(ARENA_OFFSET(arena, WorkerMsgs) > ARENA_OFFSET(arena, Messages));
+
+	//the only slack is alignment padding between the objects
+	TEST_ASSERT_TRUE(ARENA_FOOTPRINT(arena) >= objects);
+	TEST_ASSERT_TRUE(ARENA_FOOTPRINT(arena) - objects < 6 * sizeof(void*));
+	TEST_ASSERT_EQUAL(0, (uintptr_t)&arena % ARENA_ALIGNMENT);
+}
+
+void test_TaskCreate_HandleIsArenaTcb( void )
+{
+	//(the Posix port runs tasks on their own thread's stack, so the
+	//arena stack itself isn't checked here)
+	TEST_ASSERT_EQUAL_PTR(&arena.Test.Tcb, xTaskGetCurrentTaskHandle());
+	TEST_ASSERT_EQUAL_STRING("test", pcTaskGetName(NULL));
+}
+
+static void workerTask( void* Pool )
+{
+	uint32_t seq = 0;
+
+	while(1)
+	{
+		Msg_t* msg = BufPoolAlloc((BufPool_t*)Pool, portMAX_DELAY);
+
+		msg->Seq = seq++;
+		xQueueSend(seqs, &msg->Seq, portMAX_DELAY);
+		BufPoolFree((BufPool_t*)Pool, msg);
+	}
+}
+
+void test_QueueAndPool_PassDataBetweenArenaTasks( void )
+{
+	BufPool_t* pool = ARENA_POOL_INIT(arena, WorkerMsgs);
+	Msg_t* blocks[POOL_BLOCKS];
+	uint32_t seq;
+
+	seqs = ARENA_QUEUE_CREATE(arena, Seqs);
+	TEST_ASSERT_EQUAL_PTR(&arena.Seqs.Queue, seqs);
+	TEST_ASSERT_EQUAL(QUEUE_LEN, uxQueueSpacesAvailable(seqs));
+
+	TEST_ASSERT_EQUAL(POOL_BLOCKS, BufPoolNumFree(pool));
+	for(int i = 0; i < POOL_BLOCKS; i++)
+	{
+		blocks[i] = BufPoolAlloc(pool, 0);
+		TEST_ASSERT_TRUE(inArena(blocks[i], sizeof(Msg_t)));
+	}
+	for(int i = 0; i < POOL_BLOCKS; i++)
+	{
+		BufPoolFree(pool, blocks[i]);
+	}
+
+	TEST_ASSERT_EQUAL_PTR(&arena.Worker.Tcb,
+			ARENA_TASK_CREATE(arena, Worker, workerTask, "worker", pool, TEST_PRIORITY - 1));
+
+	//the worker runs while this task blocks - and fills the queue
+	for(uint32_t i = 0; i < 3 * QUEUE_LEN; i++)
+	{
+		TEST_ASSERT_EQUAL(pdPASS, xQueueReceive(seqs, &seq, 10));
+		TEST_ASSERT_EQUAL(i, seq);
+	}
+	TEST_ASSERT_EQUAL(POOL_BLOCKS, BufPoolGetHighWaterMark(pool));
+}
+
+void test_StreamBuffer_HoldsItsFullSize( void )
+{
+	StreamBufferHandle_t bytes = ARENA_STREAM_BUFFER_CREATE(arena, Bytes, 1);
+	uint8_t data[STREAM_SIZE + 1];
+	uint8_t received[STREAM_SIZE + 1];
+
+	for(size_t i = 0; i < sizeof(data); i++)
+	{
+		data[i] = (uint8_t)i;
+	}
+	TEST_ASSERT_EQUAL_PTR(&arena.Bytes.Buffer, bytes);
+	TEST_ASSERT_EQUAL(STREAM_SIZE, xStreamBufferSpacesAvailable(bytes));
+	TEST_ASSERT_EQUAL(STREAM_SIZE, xStreamBufferSend(bytes, data, sizeof(data), 0));
+	TEST_ASSERT_EQUAL(STREAM_SIZE, xStreamBufferReceive(bytes, received, sizeof(received), 0));
+	TEST_ASSERT_EQUAL_UINT8_ARRAY(data, received, STREAM_SIZE);
+}
+
+void test_MessageBuffer_KeepsMessageBoundaries( void )
+{
+	MessageBufferHandle_t messages = ARENA_MESSAGE_BUFFER_CREATE(arena, Messages);
+	char received[MESSAGE_SIZE];
+
+	TEST_ASSERT_EQUAL_PTR(&arena.Messages.Buffer, messages);
+	TEST_ASSERT_EQUAL(6, xMessageBufferSend(messages, "first", 6, 0));
+	TEST_ASSERT_EQUAL(7, xMessageBufferSend(messages, "second", 7, 0));
+	TEST_ASSERT_EQUAL(6, xMessageBufferReceive(messages, received, sizeof(received), 0));
+	TEST_ASSERT_EQUAL_STRING("first", received);
+	TEST_ASSERT_EQUAL(7, xMessageBufferReceive(messages, received, sizeof(received), 0));
+	TEST_ASSERT_EQUAL_STRING("second", received);
+}
+
+static void testTask( void* NotUsed )
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_Layout_ObjectsPackedInOrderWithinFootprint);
+	RUN_TEST(test_TaskCreate_HandleIsArenaTcb);
+	RUN_TEST(test_QueueAndPool_PassDataBetweenArenaTasks);
+	RUN_TEST(test_StreamBuffer_HoldsItsFullSize);
+	RUN_TEST(test_MessageBuffer_KeepsMessageBoundaries);
+	testResult = UNITY_END();
+	vTaskEndScheduler();
+}
+
+int main( void )
+{
+	ARENA_TASK_CREATE(arena, Test, testTask, "test", NULL, TEST_PRIORITY);
+
+	vTaskStartScheduler();
+	return testResult;
+}
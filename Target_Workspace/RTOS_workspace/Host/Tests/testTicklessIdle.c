@@ -0,0 +1,176 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2019 Brian Amos
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#include <FreeRTOS.h>
+#include <task.h>
+#include <unity.h>
+#include <time.h>
+#include "HostSupport.h"
+
+/*********************************************
+ * Tests for tickless idle on the Posix port
+ * (vPortSuppressTicksAndSleep in port.c).
+ *
+ * The test task is the only one due to run, so every
+ * delay below is spent with the idle task asleep.  The
+ * tick count has to come out of each sleep matching the
+ * host clock - with no drift building up over long runs -
+ * and sleeping has to leave the host CPU alone.
+ *********************************************/
+
+#define STACK_SIZE 512
+#define TEST_PRIORITY (tskIDLE_PRIORITY + 3)
+
+#define NS_PER_TICK (1000000000ull / configTICK_RATE_HZ)
+
+//how late the host may run the test task after its wake up tick -
+//by then the tick count may have moved on past the due tick
+#define MAX_LATE_TICKS 5
+#define MAX_LATE_NS (MAX_LATE_TICKS * NS_PER_TICK)
+
+static int testResult;
+
+static uint64_t processCpuNs( void )
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t);
+	return (uint64_t)t.tv_sec * 1000000000ull + (uint64_t)t.tv_nsec;
+}
+
+/**
+ * start timing right after a tick, so the host time of the
+ * next one is known to within the host's wake up latency
+ */
+static void alignToTick( TickType_t* Ticks, uint64_t* HostNs )
+{
+	vTaskDelay(1);
+	*Ticks = xTaskGetTickCount();
+	*HostNs = HostTimeNs();
+}
+
+void setUp( void )
+{
+}
+
+void tearDown( void )
+{
+}
+
+void test_Delay_WakesOnTheDueTick( void )
+{
+	static const TickType_t delays[] = { 2, 3, 10, 100, 1000 };
+	TickType_t startTicks;
+	uint64_t startNs;
+
+	for(size_t i = 0; i < sizeof(delays)/sizeof(delays[0]); i++)
+	{
+		alignToTick(&startTicks, &startNs);
+		vTaskDelay(delays[i]);
+		uint64_t elapsedNs = HostTimeNs() - startNs;
+
+		TEST_ASSERT_GREATER_OR_EQUAL(delays[i], xTaskGetTickCount() - startTicks);
+		TEST_ASSERT_LESS_OR_EQUAL(delays[i] + MAX_LATE_TICKS, xTaskGetTickCount() - startTicks);
+		TEST_ASSERT_GREATER_OR_EQUAL((delays[i] - 1) * NS_PER_TICK, elapsedNs);
+		TEST_ASSERT_LESS_OR_EQUAL(delays[i] * NS_PER_TICK + MAX_LATE_NS, elapsedNs);
+	}
+}
+
+void test_LongSleeps_TickStaysInPhaseWithHostClock( void )
+{
+	const TickType_t period = 250;
+	const int periods = 20;
+	TickType_t startTicks;
+	TickType_t lastWake;
+	uint64_t startNs;
+
+	alignToTick(&startTicks, &startNs);
+	lastWake = startTicks;
+	for(int i = 0; i < periods; i++)
+	{
+		vTaskDelayUntil(&lastWake, period);
+	}
+	uint64_t elapsedNs = HostTimeNs() - startNs;
+
+	//any time lost or gained across a sleep would add up over the
+	//periods, the last wake up is as close to its tick as the first
+	TEST_ASSERT_GREATER_OR_EQUAL(period * periods, xTaskGetTickCount() - startTicks);
+	TEST_ASSERT_LESS_OR_EQUAL(period * periods + MAX_LATE_TICKS, xTaskGetTickCount() - startTicks);
+	TEST_ASSERT_GREATER_OR_EQUAL((period * periods - 1) * NS_PER_TICK, elapsedNs);
+	TEST_ASSERT_LESS_OR_EQUAL(period * periods * NS_PER_TICK + MAX_LATE_NS, elapsedNs);
+}
+
+void test_TickRestartsAfterSleep( void )
+{
+	const uint64_t busyNs = 50 * NS_PER_TICK;
+	TickType_t startTicks;
+	uint64_t startNs;
+
+	vTaskDelay(100);
+
+	//no kernel calls, only the periodic tick moves the count on
+	startTicks = xTaskGetTickCount();
+	startNs = HostTimeNs();
+	while(HostTimeNs() - startNs < busyNs)
+	{
+	}
+	TickType_t ticks = xTaskGetTickCount() - startTicks;
+
+	//a tick left stopped counts none; ticks the host misses while it
+	//doesn't run the process are merged into one SIGALRM, so only most
+	//of them are certain to be counted
+	TEST_ASSERT_GREATER_OR_EQUAL(25, ticks);
+	TEST_ASSERT_LESS_OR_EQUAL(51, ticks);
+}
+
+void test_IdleSleep_UsesAlmostNoHostCpu( void )
+{
+	const TickType_t sleepTicks = 2000;
+	uint64_t startCpuNs = processCpuNs();
+
+	vTaskDelay(sleepTicks);
+	uint64_t cpuNs = processCpuNs() - startCpuNs;
+
+	//the idle task spins without tickless idle - 100% of a core
+	TEST_ASSERT_LESS_THAN(sleepTicks * NS_PER_TICK / 100, cpuNs);
+}
+
+static void testTask( void* NotUsed )
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_Delay_WakesOnTheDueTick);
+	RUN_TEST(test_LongSleeps_TickStaysInPhaseWithHostClock);
+	RUN_TEST(test_TickRestartsAfterSleep);
+	RUN_TEST(test_IdleSleep_UsesAlmostNoHostCpu);
+	testResult = UNITY_END();
+	vTaskEndScheduler();
+}
+
+int main( void )
+{
+	configASSERT(xTaskCreate(testTask, "test", STACK_SIZE, NULL, TEST_PRIORITY, NULL) == pdPASS);
+
+	vTaskStartScheduler();
+	return testResult;
+}
@@ -0,0 +1,214 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2019 Brian Amos
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#include <FreeRTOS.h>
+#include <task.h>
+#include <timers.h>
+#include <unity.h>
+
+/*********************************************
+ * Software timer expiry times, for both timer backends
+ * (the sorted active timer lists and configUSE_TIMER_WHEEL).
+ *
+ * The kernels run on virtual time (configUSE_VIRTUAL_TIME),
+ * so periods of millions of ticks take no time and every
+ * timer expires on exactly the tick it is due.  They start
+ * 3000 ticks short of the tick count
+ * overflowing, so most of the periods below cross it.
+ *********************************************/
+
+#define STACK_SIZE 512
+#define TEST_PRIORITY (configTIMER_TASK_PRIORITY + 1)
+#define MAX_TIMERS 16
+#define MAX_EXPIRIES 8
+
+typedef struct
+{
+	StaticTimer_t Buffer;
+	TimerHandle_t Handle;
+	TickType_t Expiries[MAX_EXPIRIES];
+	uint32_t NumExpiries;
+}TestTimer_t;
+
+static TestTimer_t testTimers[MAX_TIMERS];
+static int testResult;
+
+static void timerCallback( TimerHandle_t Timer )
+{
+	TestTimer_t* timer = (TestTimer_t*)pvTimerGetTimerID(Timer);
+
+	if(timer->NumExpiries < MAX_EXPIRIES)
+	{
+		timer->Expiries[timer->NumExpiries] = xTaskGetTickCount();
+	}
+	timer->NumExpiries++;
+}
+
+static TimerHandle_t createTimer( uint32_t Index, TickType_t Period, UBaseType_t AutoReload )
+{
+	TestTimer_t* timer = &testTimers[Index];
+
+	timer->NumExpiries = 0;
+	timer->Handle = xTimerCreateStatic("test", Period, AutoReload, timer, timerCallback, &timer->Buffer);
+	TEST_ASSERT_NOT_NULL(timer->Handle);
+	return timer->Handle;
+}
+
+void setUp( void )
+{
+}
+
+void tearDown( void )
+{
+	for(uint32_t i = 0; i < MAX_TIMERS; i++)
+	{
+		if(testTimers[i].Handle != NULL)
+		{
+			xTimerDelete(testTimers[i].Handle, portMAX_DELAY);
+			testTimers[i].Handle = NULL;
+		}
+	}
+	//let the timer service task act on the deletes
+	vTaskDelay(1);
+}
+
+void test_OneShot_ExpiresOnceAfterItsPeriod( void )
+{
+	//either side of the wheel's level boundaries, and past its reach
+	static const TickType_t periods[] = { 1, 2, 31, 32, 33, 1023, 1024, 1025,
+										  40000, (1 << 20) + 7, (1 << 25) - 1, (1 << 25) + 5 };
+	const uint32_t numTimers = sizeof(periods)/sizeof(periods[0]);
+	TickType_t start;
+
+	vTaskDelay(1);
+	start = xTaskGetTickCount();
+	for(uint32_t i = 0; i < numTimers; i++)
+	{
+		xTimerStart(createTimer(i, periods[i], pdFALSE), portMAX_DELAY);
+	}
+	//virtual time doesn't move on until this task blocks
+	TEST_ASSERT_EQUAL(start, xTaskGetTickCount());
+
+	vTaskDelay(periods[numTimers - 1] + 10);
+	for(uint32_t i = 0; i < numTimers; i++)
+	{
+		TEST_ASSERT_EQUAL_UINT32(1, testTimers[i].NumExpiries);
+		TEST_ASSERT_EQUAL_UINT64(start + periods[i], testTimers[i].Expiries[0]);
+	}
+}
+
+void test_AutoReload_ExpiresEveryPeriod( void )
+{
+	//32 reloads a timer into the level 0 slot it was just taken from
+	static const TickType_t periods[] = { 1, 32, 100, 5000 };
+	const uint32_t numTimers = sizeof(periods)/sizeof(periods[0]);
+	TickType_t start;
+
+	vTaskDelay(1);
+	start = xTaskGetTickCount();
+	for(uint32_t i = 0; i < numTimers; i++)
+	{
+		xTimerStart(createTimer(i, periods[i], pdTRUE), portMAX_DELAY);
+	}
+
+	vTaskDelay(periods[numTimers - 1] * MAX_EXPIRIES + 1);
+	for(uint32_t i = 0; i < numTimers; i++)
+	{
+		TEST_ASSERT_GREATER_OR_EQUAL_UINT32(MAX_EXPIRIES, testTimers[i].NumExpiries);
+		for(uint32_t j = 0; j < MAX_EXPIRIES; j++)
+		{
+			TEST_ASSERT_EQUAL_UINT64(start + periods[i] * (j + 1), testTimers[i].Expiries[j]);
+		}
+	}
+}
+
+void test_ResetAndStop_BeforeExpiry( void )
+{
+	TimerHandle_t reset = createTimer(0, 2000, pdFALSE);
+	TimerHandle_t stopped = createTimer(1, 2000, pdFALSE);
+	TimerHandle_t changed = createTimer(2, 2000, pdFALSE);
+	TickType_t start, resetAt;
+
+	vTaskDelay(1);
+	start = xTaskGetTickCount();
+	xTimerStart(reset, portMAX_DELAY);
+	xTimerStart(stopped, portMAX_DELAY);
+	xTimerStart(changed, portMAX_DELAY);
+
+	vTaskDelay(1500);
+	resetAt = xTaskGetTickCount();
+	xTimerReset(reset, portMAX_DELAY);
+	xTimerStop(stopped, portMAX_DELAY);
+	xTimerChangePeriod(changed, 10, portMAX_DELAY);
+
+	vTaskDelay(5000);
+	TEST_ASSERT_EQUAL_UINT32(1, testTimers[0].NumExpiries);
+	TEST_ASSERT_EQUAL_UINT64(resetAt + 2000, testTimers[0].Expiries[0]);
+	TEST_ASSERT_EQUAL_UINT32(0, testTimers[1].NumExpiries);
+	TEST_ASSERT_FALSE(xTimerIsTimerActive(stopped));
+	TEST_ASSERT_EQUAL_UINT32(1, testTimers[2].NumExpiries);
+	TEST_ASSERT_EQUAL_UINT64(resetAt + 10, testTimers[2].Expiries[0]);
+	TEST_ASSERT_EQUAL_UINT64(start + 1500, resetAt);
+}
+
+void test_ManyTimers_EachExpiresOnItsTick( void )
+{
+	TickType_t start;
+
+	vTaskDelay(1);
+	start = xTaskGetTickCount();
+	//spread over the first two levels, several per slot
+	for(uint32_t i = 0; i < MAX_TIMERS; i++)
+	{
+		xTimerStart(createTimer(i, 3 + i * 97, pdFALSE), portMAX_DELAY);
+	}
+
+	vTaskDelay(3 + MAX_TIMERS * 97);
+	for(uint32_t i = 0; i < MAX_TIMERS; i++)
+	{
+		TEST_ASSERT_EQUAL_UINT32(1, testTimers[i].NumExpiries);
+		TEST_ASSERT_EQUAL_UINT64(start + 3 + i * 97, testTimers[i].Expiries[0]);
+	}
+}
+
+static void testTask( void* NotUsed )
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_OneShot_ExpiresOnceAfterItsPeriod);
+	RUN_TEST(test_AutoReload_ExpiresEveryPeriod);
+	RUN_TEST(test_ResetAndStop_BeforeExpiry);
+	RUN_TEST(test_ManyTimers_EachExpiresOnItsTick);
+	//the tick count has to have overflowed part way through
+	TEST_ASSERT_LESS_THAN_UINT64(( TickType_t ) configINITIAL_TICK_COUNT, xTaskGetTickCount());
+	testResult = UNITY_END();
+	vTaskEndScheduler();
+}
+
+int main( void )
+{
+	configASSERT(xTaskCreate(testTask, "test", STACK_SIZE, NULL, TEST_PRIORITY, NULL) == pdPASS);
+
+	vTaskStartScheduler();
+	return testResult;
+}
@@ -0,0 +1,295 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2019 Brian Amos
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <FreeRTOS.h>
+#include <stm32f7xx_hal.h>
+#include <Uart4DmaTx.h>
+#include <unity.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*********************************************
+ * Unit tests for BSP/Uart4DmaTx.c, run against the register
+ * level fake of UART4 and DMA1_Stream4.
+ *
+ * lineTransmit() plays the part of the hardware: the DMA
+ * stream moves one byte per character time onto the "line"
+ * and the engine's ISR is called as soon as a transfer
+ * completes.
+ *********************************************/
+
+#define STREAM_LEN UART4_DMA_TX_STREAM_LEN
+#define BAUDRATE 460800
+
+static uint8_t msg[4 * STREAM_LEN];
+static uint8_t lineOut[64 * STREAM_LEN];
+static size_t lineLen = 0;
+static uint32_t numIsrs = 0;
+
+static void serviceDmaIrq( void )
+{
+	BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+	if(FakeNvicEnabled[DMA1_Stream4_IRQn] && (DMA1->HISR & (DMA_HISR_TCIF4 | DMA_HISR_TEIF4)))
+	{
+		numIsrs++;
+		//portSET_INTERRUPT_MASK_FROM_ISR is a no-op on the Posix port
+		//(signal handlers already run masked), so mask the tick here
+		//or it can land in the middle of a ready list update
+		portDISABLE_INTERRUPTS();
+		Uart4DmaTxDmaIsr(&xHigherPriorityTaskWoken);
+		FakeStm32ApplyClears();
+		portENABLE_INTERRUPTS();
+	}
+}
+
+/**
+ * the line is given MaxBytes character times to transmit
+ * @returns number of bytes that went out
+ */
+static size_t lineTransmit( size_t MaxBytes )
+{
+	size_t total = 0;
+
+	while(total < MaxBytes && (DMA1_Stream4->CR & DMA_SxCR_EN))
+	{
+		total += FakeDmaTransmit(DMA1_Stream4, &lineOut[lineLen + total], MaxBytes - total);
+		serviceDmaIrq();
+	}
+	lineLen += total;
+	return total;
+}
+
+void setUp( void )
+{
+	for(size_t i = 0; i < sizeof(msg); i++)
+	{
+		msg[i] = (uint8_t)(i * 13 + 5);
+	}
+	lineLen = 0;
+	numIsrs = 0;
+
+	FakeStm32Reset();
+	Uart4DmaTxStart(BAUDRATE);
+}
+
+void tearDown( void )
+{
+	Uart4DmaTxStop();
+}
+
+void test_Start_ConfiguresDmaForUart4Transmit( void )
+{
+	uint32_t cr = DMA1_Stream4->CR;
+
+	TEST_ASSERT_EQUAL_PTR(&UART4->TDR, (void*)DMA1_Stream4->PAR);
+	TEST_ASSERT_TRUE(cr & DMA_SxCR_DIR_0);
+	TEST_ASSERT_TRUE(cr & DMA_SxCR_TCIE);
+	TEST_ASSERT_TRUE(cr & DMA_SxCR_TEIE);
+	TEST_ASSERT_FALSE(cr & DMA_SxCR_CIRC);
+	//nothing to send yet
+	TEST_ASSERT_FALSE(cr & DMA_SxCR_EN);
+
+	TEST_ASSERT_EQUAL(BAUDRATE, FakeUart4Init.Baudrate);
+	TEST_ASSERT_NOT_NULL(FakeUart4Init.DmaTx);
+	TEST_ASSERT_TRUE(UART4->CR3 & USART_CR3_DMAT);
+	TEST_ASSERT_TRUE(FakeNvicEnabled[DMA1_Stream4_IRQn]);
+	//must be at or below configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY (5) on the target
+	TEST_ASSERT_GREATER_OR_EQUAL(5, FakeNvicPriority[DMA1_Stream4_IRQn]);
+}
+
+void test_Send_StartsTransferWhenIdle( void )
+{
+	TEST_ASSERT_EQUAL(5, Uart4DmaTxSend(msg, 5, 0));
+
+	TEST_ASSERT_TRUE(DMA1_Stream4->CR & DMA_SxCR_EN);
+	TEST_ASSERT_EQUAL(5, DMA1_Stream4->NDTR);
+
+	TEST_ASSERT_EQUAL(5, lineTransmit(100));
+	TEST_ASSERT_EQUAL_UINT8_ARRAY(msg, lineOut, 5);
+	TEST_ASSERT_FALSE(DMA1_Stream4->CR & DMA_SxCR_EN);
+}
+
+void test_WritesWhileBusy_BatchedIntoOneTransfer( void )
+{
+	Uart4DmaTxStats_t stats;
+
+	TEST_ASSERT_EQUAL(10, Uart4DmaTxSend(msg, 10, 0));
+	lineTransmit(4);
+
+	//these all arrive while the first transfer is still running
+	TEST_ASSERT_EQUAL(7, Uart4DmaTxSend(&msg[10], 7, 0));
+	TEST_ASSERT_EQUAL(1, Uart4DmaTxSend(&msg[17], 1, 0));
+	TEST_ASSERT_EQUAL(12, Uart4DmaTxSend(&msg[18], 12, 0));
+	TEST_ASSERT_EQUAL(6, DMA1_Stream4->NDTR);
+
+	//the transfer complete ISR starts a single transfer for all of them
+	lineTransmit(6);
+	TEST_ASSERT_TRUE(DMA1_Stream4->CR & DMA_SxCR_EN);
+	TEST_ASSERT_EQUAL(20, DMA1_Stream4->NDTR);
+
+	lineTransmit(100);
+	TEST_ASSERT_EQUAL(30, lineLen);
+	TEST_ASSERT_EQUAL_UINT8_ARRAY(msg, lineOut, 30);
+
+	Uart4DmaTxGetStats(&stats);
+	TEST_ASSERT_EQUAL(2, stats.Transfers);
+	TEST_ASSERT_EQUAL(30, stats.TxBytes);
+	TEST_ASSERT_EQUAL(20, stats.MaxTransferLen);
+	TEST_ASSERT_EQUAL(2, numIsrs);
+}
+
+void test_LargeBacklog_TransfersCappedSoProducersCanRefill( void )
+{
+	TEST_ASSERT_EQUAL(STREAM_LEN, Uart4DmaTxSend(msg, STREAM_LEN, 0));
+	TEST_ASSERT_EQUAL(UART4_DMA_TX_MAX_TRANSFER, DMA1_Stream4->NDTR);
+
+	//once the first batch is out, there's room for more
+	lineTransmit(UART4_DMA_TX_MAX_TRANSFER);
+	TEST_ASSERT_EQUAL(UART4_DMA_TX_MAX_TRANSFER, Uart4DmaTxSend(&msg[STREAM_LEN], UART4_DMA_TX_MAX_TRANSFER, 0));
+
+	lineTransmit(sizeof(lineOut));
+	TEST_ASSERT_EQUAL(STREAM_LEN + UART4_DMA_TX_MAX_TRANSFER, lineLen);
+	TEST_ASSERT_EQUAL_UINT8_ARRAY(msg, lineOut, lineLen);
+}
+
+void test_DataWrappingStreamBuffer_SentInOrder( void )
+{
+	//leave the stream buffer's read/write position 10 bytes from the end
+	TEST_ASSERT_EQUAL(STREAM_LEN - 10, Uart4DmaTxSend(msg, STREAM_LEN - 10, 0));
+	lineTransmit(STREAM_LEN);
+	TEST_ASSERT_EQUAL(STREAM_LEN - 10, lineLen);
+
+	TEST_ASSERT_EQUAL(30, Uart4DmaTxSend(&msg[STREAM_LEN - 10], 30, 0));
+	//only the bytes up to the end of the storage area go in the first transfer
+	TEST_ASSERT_LESS_OR_EQUAL(30, DMA1_Stream4->NDTR);
+	lineTransmit(100);
+
+	TEST_ASSERT_EQUAL(STREAM_LEN + 20, lineLen);
+	TEST_ASSERT_EQUAL_UINT8_ARRAY(msg, lineOut, lineLen);
+}
+
+void test_Send_StreamBufferFull_ReturnsBytesQueued( void )
+{
+	Uart4DmaTxStats_t stats;
+
+	TEST_ASSERT_EQUAL(STREAM_LEN, Uart4DmaTxSend(msg, STREAM_LEN + 50, 0));
+	TEST_ASSERT_EQUAL(0, Uart4DmaTxSend(msg, 1, 0));
+
+	lineTransmit(sizeof(lineOut));
+	TEST_ASSERT_EQUAL(STREAM_LEN, lineLen);
+	TEST_ASSERT_EQUAL_UINT8_ARRAY(msg, lineOut, lineLen);
+
+	Uart4DmaTxGetStats(&stats);
+	TEST_ASSERT_EQUAL(STREAM_LEN, stats.TxBytes);
+}
+
+void test_TransferError_CountedAndTransmissionContinues( void )
+{
+	Uart4DmaTxStats_t stats;
+	BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+	TEST_ASSERT_EQUAL(8, Uart4DmaTxSend(msg, 8, 0));
+	TEST_ASSERT_EQUAL(4, Uart4DmaTxSend(&msg[8], 4, 0));
+
+	//a bus error stops the stream part way through the first transfer
+	lineTransmit(3);
+	DMA1_Stream4->CR &= ~DMA_SxCR_EN;
+	DMA1->HISR |= DMA_HISR_TEIF4;
+	portDISABLE_INTERRUPTS();
+	Uart4DmaTxDmaIsr(&xHigherPriorityTaskWoken);
+	FakeStm32ApplyClears();
+	portENABLE_INTERRUPTS();
+
+	//the failed transfer is abandoned, the next write still goes out
+	lineLen = 0;
+	lineTransmit(100);
+	TEST_ASSERT_EQUAL(4, lineLen);
+	TEST_ASSERT_EQUAL_UINT8_ARRAY(&msg[8], lineOut, 4);
+
+	Uart4DmaTxGetStats(&stats);
+	TEST_ASSERT_EQUAL(1, stats.DmaErrors);
+}
+
+void test_DirectModeError_CountedAndTransferCompletes( void )
+{
+	Uart4DmaTxStats_t stats;
+
+	TEST_ASSERT_EQUAL(8, Uart4DmaTxSend(msg, 8, 0));
+
+	//an underrun flags the stream without stopping it
+	DMA1->HISR |= DMA_HISR_DMEIF4 | DMA_HISR_FEIF4;
+	lineTransmit(100);
+	TEST_ASSERT_EQUAL(8, lineLen);
+	TEST_ASSERT_EQUAL_UINT8_ARRAY(msg, lineOut, 8);
+
+	Uart4DmaTxGetStats(&stats);
+	TEST_ASSERT_EQUAL(8, stats.TxBytes);
+	TEST_ASSERT_EQUAL(1, stats.DmaErrors);
+}
+
+void test_RandomWritesAndLineProgress_OutputMatchesInput( void )
+{
+	static uint8_t expected[sizeof(lineOut)];
+	size_t expectedLen = 0;
+	Uart4DmaTxStats_t stats;
+
+	srand(1234);
+	while(expectedLen < sizeof(expected) - sizeof(msg))
+	{
+		size_t len = 1 + (size_t)rand() % 100;
+		size_t offset = (size_t)rand() % (sizeof(msg) - len);
+		size_t queued = Uart4DmaTxSend(&msg[offset], len, 0);
+
+		memcpy(&expected[expectedLen], &msg[offset], queued);
+		expectedLen += queued;
+
+		lineTransmit((size_t)rand() % 80);
+	}
+	lineTransmit(sizeof(lineOut));
+
+	TEST_ASSERT_EQUAL(expectedLen, lineLen);
+	TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, lineOut, lineLen);
+
+	//batching means far fewer interrupts than bytes
+	Uart4DmaTxGetStats(&stats);
+	TEST_ASSERT_EQUAL(stats.Transfers, numIsrs);
+	TEST_ASSERT_LESS_THAN(lineLen / 10, numIsrs);
+}
+
+int main( void )
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_Start_ConfiguresDmaForUart4Transmit);
+	RUN_TEST(test_Send_StartsTransferWhenIdle);
+	RUN_TEST(test_WritesWhileBusy_BatchedIntoOneTransfer);
+	RUN_TEST(test_LargeBacklog_TransfersCappedSoProducersCanRefill);
+	RUN_TEST(test_DataWrappingStreamBuffer_SentInOrder);
+	RUN_TEST(test_Send_StreamBufferFull_ReturnsBytesQueued);
+	RUN_TEST(test_TransferError_CountedAndTransmissionContinues);
+	RUN_TEST(test_DirectModeError_CountedAndTransferCompletes);
+	RUN_TEST(test_RandomWritesAndLineProgress_OutputMatchesInput);
+	return UNITY_END();
+}
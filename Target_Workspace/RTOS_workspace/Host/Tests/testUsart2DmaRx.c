@@ -0,0 +1,301 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2019 Brian Amos
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <FreeRTOS.h>
+#include <stream_buffer.h>
+#include <stm32f7xx_hal.h>
+#include <Usart2DmaRx.h>
+#include <unity.h>
+#include <string.h>
+
+/*********************************************
+ * Unit tests for BSP/Usart2DmaRx.c, run against the register
+ * level fake of USART2 and DMA1_Stream5.
+ *
+ * The helpers below play the part of the hardware: bytes
+ * "arriving" on the line are written wherever the DMA stream
+ * is pointing, NDTR counts down (and reloads, since the stream
+ * is circular) and the HT/TC/IDLE flags are raised with the
+ * driver's ISR's called immediately, unless the test has
+ * masked the IRQ in the fake NVIC to model ISR latency.
+ *********************************************/
+
+#define RING_LEN USART2_DMA_RX_RING_LEN
+#define STREAM_LEN 256
+#define BAUDRATE 115200
+
+static StreamBufferHandle_t rxStream = NULL;
+static uint8_t line[4 * RING_LEN];
+
+static void serviceDmaIrq( void )
+{
+	BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+	if(FakeNvicEnabled[DMA1_Stream5_IRQn] && (DMA1->HISR & (DMA_HISR_HTIF5 | DMA_HISR_TCIF5)))
+	{
+		//portSET_INTERRUPT_MASK_FROM_ISR is a no-op on the Posix port
+		//(signal handlers already run masked), so mask the tick here
+		//or it can land in the middle of a ready list update
+		portDISABLE_INTERRUPTS();
+		Usart2DmaRxDmaIsr(&xHigherPriorityTaskWoken);
+		FakeStm32ApplyClears();
+		portENABLE_INTERRUPTS();
+	}
+}
+
+static void serviceUsartIrq( void )
+{
+	BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+	if(FakeNvicEnabled[USART2_IRQn] && USART2->ISR)
+	{
+		portDISABLE_INTERRUPTS();
+		Usart2DmaRxUsartIsr(&xHigherPriorityTaskWoken);
+		FakeStm32ApplyClears();
+		portENABLE_INTERRUPTS();
+	}
+}
+
+/**
+ * Len bytes arrive on USART2_RX and are moved by DMA1_Stream5
+ */
+static void lineReceive( uint8_t const* Data, size_t Len )
+{
+	DMA_Stream_TypeDef* stream = DMA1_Stream5;
+
+	for(size_t i = 0; i < Len; i++)
+	{
+		TEST_ASSERT_TRUE(stream->CR & DMA_SxCR_EN);
+		((uint8_t*)stream->M0AR)[RING_LEN - stream->NDTR] = Data[i];
+		stream->NDTR--;
+
+		if(stream->NDTR == RING_LEN/2 && (stream->CR & DMA_SxCR_HTIE))
+		{
+			DMA1->HISR |= DMA_HISR_HTIF5;
+		}
+		if(stream->NDTR == 0)
+		{
+			stream->NDTR = RING_LEN;
+			if(stream->CR & DMA_SxCR_TCIE)
+			{
+				DMA1->HISR |= DMA_HISR_TCIF5;
+			}
+		}
+		serviceDmaIrq();
+	}
+}
+
+/**
+ * the line has been quiet for a frame
+ */
+static void lineIdle( void )
+{
+	if(USART2->CR1 & USART_CR1_IDLEIE)
+	{
+		USART2->ISR |= USART_ISR_IDLE;
+	}
+	serviceUsartIrq();
+}
+
+static void assertStreamHolds( uint8_t const* Expected, size_t Len )
+{
+	static uint8_t rxData[STREAM_LEN];
+
+	TEST_ASSERT_EQUAL(Len, xStreamBufferBytesAvailable(rxStream));
+	TEST_ASSERT_EQUAL(Len, xStreamBufferReceive(rxStream, rxData, sizeof(rxData), 0));
+	TEST_ASSERT_EQUAL_UINT8_ARRAY(Expected, rxData, Len);
+}
+
+void setUp( void )
+{
+	for(size_t i = 0; i < sizeof(line); i++)
+	{
+		line[i] = (uint8_t)(i * 7 + 1);
+	}
+
+	FakeStm32Reset();
+	rxStream = xStreamBufferCreate(STREAM_LEN, 1);
+	TEST_ASSERT_NOT_NULL(rxStream);
+	Usart2DmaRxStart(rxStream, BAUDRATE);
+}
+
+void tearDown( void )
+{
+	Usart2DmaRxStop();
+	vStreamBufferDelete(rxStream);
+}
+
+void test_Start_ConfiguresCircularDmaAndIdleDetection( void )
+{
+	uint32_t cr = DMA1_Stream5->CR;
+
+	TEST_ASSERT_TRUE(cr & DMA_SxCR_EN);
+	TEST_ASSERT_TRUE(cr & DMA_SxCR_CIRC);
+	TEST_ASSERT_TRUE(cr & DMA_SxCR_HTIE);
+	TEST_ASSERT_TRUE(cr & DMA_SxCR_TCIE);
+	TEST_ASSERT_FALSE(cr & DMA_SxCR_DBM);
+	TEST_ASSERT_EQUAL(RING_LEN, DMA1_Stream5->NDTR);
+	TEST_ASSERT_EQUAL_PTR(&USART2->RDR, (void*)DMA1_Stream5->PAR);
+	TEST_ASSERT_NOT_EQUAL(0, DMA1_Stream5->M0AR);
+
+	TEST_ASSERT_EQUAL(1, FakeUsart2Init.NumCalls);
+	TEST_ASSERT_EQUAL(BAUDRATE, FakeUsart2Init.Baudrate);
+	TEST_ASSERT_NULL(FakeUsart2Init.DmaTx);
+	TEST_ASSERT_NOT_NULL(FakeUsart2Init.DmaRx);
+	TEST_ASSERT_TRUE(USART2->CR1 & USART_CR1_UE);
+	TEST_ASSERT_TRUE(USART2->CR1 & USART_CR1_IDLEIE);
+	TEST_ASSERT_TRUE(USART2->CR3 & USART_CR3_DMAR);
+	TEST_ASSERT_TRUE(USART2->CR3 & USART_CR3_EIE);
+
+	//both ISR's touch the ring's tail, so they can't be allowed to preempt one another
+	TEST_ASSERT_TRUE(FakeNvicEnabled[DMA1_Stream5_IRQn]);
+	TEST_ASSERT_TRUE(FakeNvicEnabled[USART2_IRQn]);
+	TEST_ASSERT_EQUAL(FakeNvicPriority[DMA1_Stream5_IRQn], FakeNvicPriority[USART2_IRQn]);
+	//and must be at or below configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY (5) on the target
+	TEST_ASSERT_GREATER_OR_EQUAL(5, FakeNvicPriority[USART2_IRQn]);
+}
+
+void test_ShortMessage_DeliveredAsSoonAsLineGoesIdle( void )
+{
+	lineReceive(line, 5);
+	TEST_ASSERT_EQUAL(0, xStreamBufferBytesAvailable(rxStream));
+
+	lineIdle();
+	assertStreamHolds(line, 5);
+	TEST_ASSERT_EQUAL(0, USART2->ISR);
+}
+
+void test_ContinuousTraffic_DeliveredEveryHalfRing( void )
+{
+	Usart2DmaRxStats_t stats;
+
+	lineReceive(line, RING_LEN/2);
+	assertStreamHolds(line, RING_LEN/2);
+
+	lineReceive(&line[RING_LEN/2], RING_LEN/2);
+	assertStreamHolds(&line[RING_LEN/2], RING_LEN/2);
+
+	Usart2DmaRxGetStats(&stats);
+	TEST_ASSERT_EQUAL(1, stats.HalfTransferEvents);
+	TEST_ASSERT_EQUAL(1, stats.TransferCompleteEvents);
+	TEST_ASSERT_EQUAL(RING_LEN, stats.RxBytes);
+	TEST_ASSERT_EQUAL(0, DMA1->HISR);
+}
+
+void test_OddSizedMessages_DeliveredInOrderAcrossRingWrap( void )
+{
+	static const size_t lens[] = { 1, 3, 17, RING_LEN/2 + 1, 5, RING_LEN - 1, 2 };
+	size_t offset = 0;
+
+	for(size_t i = 0; i < sizeof(lens)/sizeof(lens[0]); i++)
+	{
+		lineReceive(&line[offset], lens[i]);
+		lineIdle();
+		offset += lens[i];
+	}
+	assertStreamHolds(line, offset);
+}
+
+void test_DelayedIsr_WrappedDataDeliveredInOrder( void )
+{
+	//move the DMA write position close to the end of the ring
+	lineReceive(line, RING_LEN - 4);
+	lineIdle();
+	assertStreamHolds(line, RING_LEN - 4);
+
+	//the DMA ISR is held off while the DMA controller wraps
+	FakeNvicEnabled[DMA1_Stream5_IRQn] = false;
+	lineReceive(&line[RING_LEN - 4], 10);
+	FakeNvicEnabled[DMA1_Stream5_IRQn] = true;
+	serviceDmaIrq();
+
+	assertStreamHolds(&line[RING_LEN - 4], 10);
+}
+
+void test_StreamBufferFull_BytesDroppedAndCountedWithoutBlocking( void )
+{
+	static uint8_t filler[STREAM_LEN - 10];
+	Usart2DmaRxStats_t stats;
+
+	TEST_ASSERT_EQUAL(sizeof(filler), xStreamBufferSend(rxStream, filler, sizeof(filler), 0));
+
+	lineReceive(line, 25);
+	lineIdle();
+
+	Usart2DmaRxGetStats(&stats);
+	TEST_ASSERT_EQUAL(10, stats.RxBytes);
+	TEST_ASSERT_EQUAL(15, stats.DroppedBytes);
+	TEST_ASSERT_EQUAL(0, xStreamBufferSpacesAvailable(rxStream));
+
+	//once the consumer catches up, reception carries on normally
+	TEST_ASSERT_TRUE(xStreamBufferReset(rxStream));
+	lineReceive(&line[25], 4);
+	lineIdle();
+	assertStreamHolds(&line[25], 4);
+}
+
+void test_UsartErrors_CountedAndCleared( void )
+{
+	Usart2DmaRxStats_t stats;
+
+	USART2->ISR = USART_ISR_ORE | USART_ISR_NE | USART_ISR_FE | USART_ISR_PE;
+	serviceUsartIrq();
+	USART2->ISR = USART_ISR_ORE;
+	serviceUsartIrq();
+
+	Usart2DmaRxGetStats(&stats);
+	TEST_ASSERT_EQUAL(2, stats.OverrunErrors);
+	TEST_ASSERT_EQUAL(1, stats.NoiseErrors);
+	TEST_ASSERT_EQUAL(1, stats.FramingErrors);
+	TEST_ASSERT_EQUAL(1, stats.ParityErrors);
+	TEST_ASSERT_EQUAL(0, stats.IdleEvents);
+	TEST_ASSERT_EQUAL(0, USART2->ISR);
+	TEST_ASSERT_EQUAL(0, xStreamBufferBytesAvailable(rxStream));
+}
+
+void test_Stop_DisablesDmaAndInterrupts( void )
+{
+	Usart2DmaRxStop();
+
+	TEST_ASSERT_FALSE(DMA1_Stream5->CR & DMA_SxCR_EN);
+	TEST_ASSERT_FALSE(USART2->CR1 & USART_CR1_IDLEIE);
+	TEST_ASSERT_FALSE(USART2->CR3 & USART_CR3_DMAR);
+	TEST_ASSERT_FALSE(FakeNvicEnabled[DMA1_Stream5_IRQn]);
+	TEST_ASSERT_FALSE(FakeNvicEnabled[USART2_IRQn]);
+}
+
+int main( void )
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_Start_ConfiguresCircularDmaAndIdleDetection);
+	RUN_TEST(test_ShortMessage_DeliveredAsSoonAsLineGoesIdle);
+	RUN_TEST(test_ContinuousTraffic_DeliveredEveryHalfRing);
+	RUN_TEST(test_OddSizedMessages_DeliveredInOrderAcrossRingWrap);
+	RUN_TEST(test_DelayedIsr_WrappedDataDeliveredInOrder);
+	RUN_TEST(test_StreamBufferFull_BytesDroppedAndCountedWithoutBlocking);
+	RUN_TEST(test_UsartErrors_CountedAndCleared);
+	RUN_TEST(test_Stop_DisablesDmaAndInterrupts);
+	return UNITY_END();
+}
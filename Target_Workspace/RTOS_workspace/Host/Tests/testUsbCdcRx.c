@@ -0,0 +1,235 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2019 Brian Amos
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <FreeRTOS.h>
+#include <stream_buffer.h>
+#include <FakeUsbdConf.h>
+#include "usbd_cdc_if.h"
+#include <unity.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*********************************************
+ * Unit tests for the flow controlled receive path in
+ * Drivers/HandsOnRTOS/usbd_cdc_if.c (VCOM_RX_FLOW_CONTROL),
+ * run through the CDC class against a fake of BSP/usbd_conf.c.
+ *
+ * The tests play the part of both the host (sending OUT
+ * packets, retrying NAK'd ones) and the application reading
+ * the receive stream buffer.
+ *********************************************/
+
+#define RX_LEN 256
+#define PACKET_LEN CDC_DATA_FS_OUT_PACKET_SIZE
+
+//normally provided by usb_device.c and VirtualCommDriver(MultiTask).c
+USBD_HandleTypeDef hUsbDeviceFS;
+static StreamBufferHandle_t rxStream = NULL;
+
+StreamBufferHandle_t const* GetUsbRxStreamBuff( void )
+{
+	return &rxStream;
+}
+
+static uint8_t pattern[256 + PACKET_LEN];
+static CDC_RxStats_t statsBefore;
+
+static void getStatsDelta( CDC_RxStats_t* Delta )
+{
+	CDC_RxStats_t now;
+
+	CDC_GetRxStats_FS(&now);
+	Delta->RxBytes = now.RxBytes - statsBefore.RxBytes;
+	Delta->DroppedBytes = now.DroppedBytes - statsBefore.DroppedBytes;
+	Delta->Pauses = now.Pauses - statsBefore.Pauses;
+	Delta->Resumes = now.Resumes - statsBefore.Resumes;
+}
+
+static size_t readBytes( uint8_t* Dst, size_t Len )
+{
+	size_t numBytes = xStreamBufferReceive(rxStream, Dst, Len, 0);
+
+	CDC_RxResume_FS();
+	return numBytes;
+}
+
+void setUp( void )
+{
+	if(rxStream != NULL)
+	{
+		vStreamBufferDelete(rxStream);
+	}
+	rxStream = xStreamBufferCreate(RX_LEN, 1);
+	configASSERT(rxStream != NULL);
+
+	//(re)enumerate - the class arms the OUT endpoint
+	FakeUsbReset(&hUsbDeviceFS);
+	hUsbDeviceFS.pClass = &USBD_CDC;
+	hUsbDeviceFS.pUserData = &USBD_Interface_fops_FS;
+	USBD_CDC.Init(&hUsbDeviceFS, 0);
+	CDC_GetRxStats_FS(&statsBefore);
+}
+
+void tearDown( void )
+{
+}
+
+void test_Packet_ReachesStreamBufferAndEndpointRearmed( void )
+{
+	uint8_t received[PACKET_LEN];
+	CDC_RxStats_t stats;
+
+	TEST_ASSERT_TRUE(FakeUsbOutPacket(&hUsbDeviceFS, CDC_OUT_EP, pattern, 40));
+	TEST_ASSERT_TRUE(FakeUsbOutIsArmed(CDC_OUT_EP));
+
+	TEST_ASSERT_EQUAL(40, readBytes(received, sizeof(received)));
+	TEST_ASSERT_EQUAL_UINT8_ARRAY(pattern, received, 40);
+
+	getStatsDelta(&stats);
+	TEST_ASSERT_EQUAL(40, stats.RxBytes);
+	TEST_ASSERT_EQUAL(0, stats.Pauses);
+}
+
+void test_StreamBufferCantHoldAnotherPacket_HostNakdInsteadOfDropping( void )
+{
+	CDC_RxStats_t stats;
+
+	for(int i = 0; i < RX_LEN / PACKET_LEN - 1; i++)
+	{
+		TEST_ASSERT_TRUE(FakeUsbOutPacket(&hUsbDeviceFS, CDC_OUT_EP, pattern, PACKET_LEN));
+		TEST_ASSERT_TRUE(FakeUsbOutIsArmed(CDC_OUT_EP));
+	}
+	//this one leaves the stream buffer full
+	TEST_ASSERT_TRUE(FakeUsbOutPacket(&hUsbDeviceFS, CDC_OUT_EP, pattern, PACKET_LEN));
+	TEST_ASSERT_FALSE(FakeUsbOutIsArmed(CDC_OUT_EP));
+
+	TEST_ASSERT_FALSE(FakeUsbOutPacket(&hUsbDeviceFS, CDC_OUT_EP, pattern, PACKET_LEN));
+	TEST_ASSERT_FALSE(FakeUsbOutPacket(&hUsbDeviceFS, CDC_OUT_EP, pattern, PACKET_LEN));
+	TEST_ASSERT_EQUAL(2, FakeUsbOut.Naks);
+
+	getStatsDelta(&stats);
+	TEST_ASSERT_EQUAL(RX_LEN, stats.RxBytes);
+	TEST_ASSERT_EQUAL(0, stats.DroppedBytes);
+	TEST_ASSERT_EQUAL(1, stats.Pauses);
+}
+
+void test_Read_RearmsOnlyOnceRoomForFullPacket( void )
+{
+	uint8_t received[RX_LEN];
+	CDC_RxStats_t stats;
+
+	while(FakeUsbOutIsArmed(CDC_OUT_EP))
+	{
+		FakeUsbOutPacket(&hUsbDeviceFS, CDC_OUT_EP, pattern, PACKET_LEN);
+	}
+
+	readBytes(received, PACKET_LEN - 1);
+	TEST_ASSERT_FALSE(FakeUsbOutIsArmed(CDC_OUT_EP));
+
+	readBytes(received, 1);
+	TEST_ASSERT_TRUE(FakeUsbOutIsArmed(CDC_OUT_EP));
+	TEST_ASSERT_TRUE(FakeUsbOutPacket(&hUsbDeviceFS, CDC_OUT_EP, pattern, PACKET_LEN));
+
+	getStatsDelta(&stats);
+	TEST_ASSERT_EQUAL(2, stats.Pauses);
+	TEST_ASSERT_EQUAL(1, stats.Resumes);
+}
+
+void test_ReadWhileNotPaused_EndpointLeftAlone( void )
+{
+	uint8_t received[PACKET_LEN];
+	uint32_t arms;
+	CDC_RxStats_t stats;
+
+	FakeUsbOutPacket(&hUsbDeviceFS, CDC_OUT_EP, pattern, PACKET_LEN);
+	arms = FakeUsbOut.Arms;
+	readBytes(received, sizeof(received));
+
+	//re-arming an armed endpoint would trip the fake's assert
+	TEST_ASSERT_EQUAL(arms, FakeUsbOut.Arms);
+	getStatsDelta(&stats);
+	TEST_ASSERT_EQUAL(0, stats.Resumes);
+}
+
+void test_BulkUploadWithSlowReader_Lossless( void )
+{
+	static uint8_t received[64 * 1024];
+	const size_t total = sizeof(received);
+	size_t sent = 0, numReceived = 0;
+	CDC_RxStats_t stats;
+
+	srand(7);
+	while(numReceived < total)
+	{
+		//the host keeps offering the next packet until it's accepted
+		if(sent < total)
+		{
+			size_t len = total - sent;
+
+			if(len > PACKET_LEN)
+			{
+				len = PACKET_LEN;
+			}
+			if(FakeUsbOutPacket(&hUsbDeviceFS, CDC_OUT_EP, &pattern[sent & 0xFF], (uint16_t)len))
+			{
+				sent += len;
+			}
+		}
+
+		//the application reads less often, and less, than the host sends
+		if(rand() % 3 == 0 || sent == total)
+		{
+			numReceived += readBytes(&received[numReceived], 1 + (size_t)rand() % 48);
+		}
+	}
+
+	for(size_t i = 0; i < total; i++)
+	{
+		TEST_ASSERT_EQUAL_UINT8_MESSAGE((uint8_t)i, received[i], "data lost or corrupted");
+	}
+
+	getStatsDelta(&stats);
+	TEST_ASSERT_EQUAL(total, stats.RxBytes);
+	TEST_ASSERT_EQUAL(0, stats.DroppedBytes);
+	TEST_ASSERT_GREATER_THAN(0, stats.Pauses);
+	TEST_ASSERT_EQUAL(stats.Pauses, stats.Resumes);
+	TEST_ASSERT_GREATER_THAN(0, FakeUsbOut.Naks);
+}
+
+int main( void )
+{
+	for(size_t i = 0; i < sizeof(pattern); i++)
+	{
+		pattern[i] = (uint8_t)i;
+	}
+
+	UNITY_BEGIN();
+	RUN_TEST(test_Packet_ReachesStreamBufferAndEndpointRearmed);
+	RUN_TEST(test_StreamBufferCantHoldAnotherPacket_HostNakdInsteadOfDropping);
+	RUN_TEST(test_Read_RearmsOnlyOnceRoomForFullPacket);
+	RUN_TEST(test_ReadWhileNotPaused_EndpointLeftAlone);
+	RUN_TEST(test_BulkUploadWithSlowReader_Lossless);
+	return UNITY_END();
+}
@@ -0,0 +1,329 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2019 Brian Amos
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <stream_buffer.h>
+#include <VirtualCommTx.h>
+#include <FakeUsbdConf.h>
+#include "usbd_cdc.h"
+#include <unity.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*********************************************
+ * Unit tests for Drivers/HandsOnRTOS/VirtualCommTx.c and the
+ * ZLP handling in the CDC class's DataIn, run against a fake
+ * of BSP/usbd_conf.c that replays a full speed host draining
+ * the IN endpoint one frame at a time.
+ *
+ * The tests run inside a task (the "bus", which plays out the
+ * frames) so the TX task can block and be woken the same as
+ * it is on the target.
+ *********************************************/
+
+#define STACK_SIZE 512
+#define TX_BUFF_LEN 1024
+#define MAX_TRANSFER (TX_BUFF_LEN / 4)
+#define FRAME_BYTES (FAKE_USB_PACKETS_PER_FRAME * USB_FS_MAX_PACKET_SIZE)
+
+#define BUS_PRIORITY (tskIDLE_PRIORITY + 1)
+#define PRODUCER_PRIORITY (tskIDLE_PRIORITY + 1)
+#define TX_PRIORITY (tskIDLE_PRIORITY + 2)
+
+static USBD_HandleTypeDef usbDev;
+static StreamBufferHandle_t txStream;
+static uint8_t pattern[256 + TX_BUFF_LEN];
+static uint8_t lineOut[512 * 1024];
+static size_t lineLen;
+static VcomTxStats_t statsBefore;
+static int testResult;
+
+static int8_t fakeItfInit( void ) { return 0; }
+static USBD_CDC_ItfTypeDef fakeItf = { fakeItfInit, NULL, NULL, NULL };
+
+static uint32_t txPeek( StreamBufferSpans_t* Spans, TickType_t TicksToWait )
+{
+	return xStreamBufferPeek(txStream, Spans, TX_BUFF_LEN, TicksToWait);
+}
+
+static void txConsume( uint32_t NumBytes )
+{
+	xStreamBufferConsume(txStream, NumBytes);
+}
+
+static void txTask( void* NotUsed )
+{
+	VcomTxRun(&usbDev, txPeek, txConsume, MAX_TRANSFER);
+}
+
+/**
+ * plays out frames until the endpoint goes quiet (or MaxFrames have
+ * passed), giving the TX task a tick between frames
+ * @returns number of frames that moved data
+ */
+static uint32_t runFrames( uint32_t MaxFrames )
+{
+	uint32_t frames = 0;
+
+	for(; frames < MaxFrames; frames++)
+	{
+		size_t len = FakeUsbInFrame(&usbDev, CDC_IN_EP, &lineOut[lineLen], FAKE_USB_PACKETS_PER_FRAME);
+
+		lineLen += len;
+		if(len == 0 && FakeUsbIn.Packets == 0)
+		{
+			break;
+		}
+		vTaskDelay(1);
+	}
+	return frames;
+}
+
+static void writeAndWait( uint8_t const* Data, size_t Len )
+{
+	TEST_ASSERT_EQUAL(Len, xStreamBufferSend(txStream, Data, Len, 0));
+	//let the TX task stage the data
+	vTaskDelay(1);
+}
+
+static void getStatsDelta( VcomTxStats_t* Delta )
+{
+	VcomTxStats_t now;
+
+	VcomTxGetStats(&now);
+	Delta->TxBytes = now.TxBytes - statsBefore.TxBytes;
+	Delta->Transfers = now.Transfers - statsBefore.Transfers;
+	Delta->ChainedTransfers = now.ChainedTransfers - statsBefore.ChainedTransfers;
+	Delta->Zlps = now.Zlps - statsBefore.Zlps;
+}
+
+void setUp( void )
+{
+	//every test leaves the endpoint idle, so the fake can start over
+	FakeUsbReset(&usbDev);
+	VcomTxGetStats(&statsBefore);
+	lineLen = 0;
+}
+
+void tearDown( void )
+{
+	//drain anything left behind so the next test starts idle
+	while(FakeUsbInFrame(&usbDev, CDC_IN_EP, NULL, FAKE_USB_PACKETS_PER_FRAME) > 0 ||
+			!xStreamBufferIsEmpty(txStream))
+	{
+		vTaskDelay(1);
+	}
+}
+
+void test_ShortWrite_SentAsOneTransfer( void )
+{
+	writeAndWait(pattern, 50);
+	FakeUsbInFrame(&usbDev, CDC_IN_EP, lineOut, FAKE_USB_PACKETS_PER_FRAME);
+
+	TEST_ASSERT_EQUAL(1, FakeUsbIn.Transfers);
+	TEST_ASSERT_EQUAL(50, FakeUsbIn.TransferLens[0]);
+	TEST_ASSERT_EQUAL(1, FakeUsbIn.Packets);
+	TEST_ASSERT_EQUAL(0, FakeUsbIn.Zlps);
+	TEST_ASSERT_EQUAL_UINT8_ARRAY(pattern, lineOut, 50);
+
+	//the data is released once it has been sent
+	vTaskDelay(1);
+	TEST_ASSERT_TRUE(xStreamBufferIsEmpty(txStream));
+}
+
+void test_PartialPacketAtEnd_SplitIntoFollowOnTransfer( void )
+{
+	writeAndWait(pattern, 100);
+	FakeUsbInFrame(&usbDev, CDC_IN_EP, lineOut, FAKE_USB_PACKETS_PER_FRAME);
+
+	//the full packet goes first, the remainder is chained after it (so
+	//no short packet or ZLP ends up in the middle of the data)
+	TEST_ASSERT_EQUAL(2, FakeUsbIn.Transfers);
+	TEST_ASSERT_EQUAL(64, FakeUsbIn.TransferLens[0]);
+	TEST_ASSERT_EQUAL(36, FakeUsbIn.TransferLens[1]);
+	TEST_ASSERT_EQUAL(2, FakeUsbIn.Packets);
+	TEST_ASSERT_EQUAL(0, FakeUsbIn.Zlps);
+	TEST_ASSERT_EQUAL_UINT8_ARRAY(pattern, lineOut, 100);
+}
+
+void test_WriteOfExactMultipleOfPacketSize_EndedWithZlp( void )
+{
+	VcomTxStats_t stats;
+
+	writeAndWait(pattern, 128);
+	FakeUsbInFrame(&usbDev, CDC_IN_EP, lineOut, FAKE_USB_PACKETS_PER_FRAME);
+
+	TEST_ASSERT_EQUAL(2, FakeUsbIn.Transfers);
+	TEST_ASSERT_EQUAL(128, FakeUsbIn.TransferLens[0]);
+	TEST_ASSERT_EQUAL(0, FakeUsbIn.TransferLens[1]);
+	TEST_ASSERT_EQUAL(1, FakeUsbIn.Zlps);
+	TEST_ASSERT_EQUAL_UINT8_ARRAY(pattern, lineOut, 128);
+
+	getStatsDelta(&stats);
+	TEST_ASSERT_EQUAL(1, stats.Zlps);
+}
+
+void test_BackToBackTransfers_ChainedWithoutZlpBetween( void )
+{
+	VcomTxStats_t stats;
+
+	//two full transfers are outstanding at once (in flight + staged)
+	writeAndWait(pattern, 2 * MAX_TRANSFER);
+	FakeUsbInFrame(&usbDev, CDC_IN_EP, lineOut, FAKE_USB_PACKETS_PER_FRAME);
+
+	//both went out in the same frame, with a ZLP only after the last one
+	TEST_ASSERT_EQUAL(3, FakeUsbIn.Transfers);
+	TEST_ASSERT_EQUAL(MAX_TRANSFER, FakeUsbIn.TransferLens[0]);
+	TEST_ASSERT_EQUAL(MAX_TRANSFER, FakeUsbIn.TransferLens[1]);
+	TEST_ASSERT_EQUAL(0, FakeUsbIn.TransferLens[2]);
+	TEST_ASSERT_EQUAL(1, FakeUsbIn.Zlps);
+	TEST_ASSERT_EQUAL_UINT8_ARRAY(pattern, lineOut, 2 * MAX_TRANSFER);
+
+	getStatsDelta(&stats);
+	TEST_ASSERT_EQUAL(2, stats.Transfers);
+	TEST_ASSERT_EQUAL(1, stats.ChainedTransfers);
+}
+
+void test_WriteWhileZlpPending_SentAfterZlp( void )
+{
+	writeAndWait(pattern, 64);
+	//the data packet goes out, the ZLP is armed but not yet sent
+	FakeUsbInFrame(&usbDev, CDC_IN_EP, lineOut, 1);
+	writeAndWait(&pattern[64], 10);
+	lineLen = 64;
+	runFrames(4);
+
+	TEST_ASSERT_EQUAL(3, FakeUsbIn.Transfers);
+	TEST_ASSERT_EQUAL(64, FakeUsbIn.TransferLens[0]);
+	TEST_ASSERT_EQUAL(0, FakeUsbIn.TransferLens[1]);
+	TEST_ASSERT_EQUAL(10, FakeUsbIn.TransferLens[2]);
+	TEST_ASSERT_EQUAL(74, lineLen);
+	TEST_ASSERT_EQUAL_UINT8_ARRAY(pattern, lineOut, 74);
+}
+
+static volatile size_t producerTotal;
+static volatile BaseType_t producerDone;
+
+/**
+ * writes producerTotal bytes of the pattern in random sized chunks
+ */
+static void producerTask( void* NotUsed )
+{
+	size_t sent = 0;
+
+	while(sent < producerTotal)
+	{
+		size_t len = 1 + (size_t)rand() % 200;
+
+		if(len > producerTotal - sent)
+		{
+			len = producerTotal - sent;
+		}
+		configASSERT(xStreamBufferSend(txStream, &pattern[sent & 0xFF], len, portMAX_DELAY) == len);
+		sent += len;
+	}
+	producerDone = pdTRUE;
+	vTaskSuspend(NULL);
+}
+
+void test_SustainedWrites_NearFullSpeedLimit( void )
+{
+	TaskHandle_t producer;
+	uint32_t frames = 0;
+	size_t bytesInFirstFrames = 0;
+	const uint32_t measuredFrames = 200;
+	VcomTxStats_t stats;
+
+	srand(42);
+	producerTotal = (measuredFrames + 20) * FRAME_BYTES;
+	producerDone = pdFALSE;
+	TEST_ASSERT_EQUAL(pdPASS, xTaskCreate(producerTask, "producer", STACK_SIZE, NULL, PRODUCER_PRIORITY, &producer));
+	vTaskDelay(1);
+
+	while(lineLen < producerTotal && frames < 10 * measuredFrames)
+	{
+		lineLen += FakeUsbInFrame(&usbDev, CDC_IN_EP, &lineOut[lineLen], FAKE_USB_PACKETS_PER_FRAME);
+		if(++frames == measuredFrames)
+		{
+			bytesInFirstFrames = lineLen;
+		}
+		vTaskDelay(1);
+	}
+	TEST_ASSERT_TRUE(producerDone);
+	vTaskDelete(producer);
+
+	TEST_ASSERT_EQUAL(producerTotal, lineLen);
+	for(size_t i = 0; i < lineLen; i++)
+	{
+		TEST_ASSERT_EQUAL_UINT8_MESSAGE((uint8_t)i, lineOut[i], "data corrupted");
+	}
+
+	//the endpoint is kept busy for (nearly) the whole frame
+	TEST_ASSERT_GREATER_OR_EQUAL(measuredFrames * FRAME_BYTES * 97 / 100, bytesInFirstFrames);
+
+	getStatsDelta(&stats);
+	TEST_ASSERT_EQUAL(producerTotal, stats.TxBytes);
+	TEST_ASSERT_GREATER_THAN(stats.Transfers / 2, stats.ChainedTransfers);
+}
+
+static void testTask( void* NotUsed )
+{
+	//the TX task polls for the CDC class to start, the same as it
+	//waits for enumeration on the target
+	vTaskDelay(20);
+
+	UNITY_BEGIN();
+	RUN_TEST(test_ShortWrite_SentAsOneTransfer);
+	RUN_TEST(test_PartialPacketAtEnd_SplitIntoFollowOnTransfer);
+	RUN_TEST(test_WriteOfExactMultipleOfPacketSize_EndedWithZlp);
+	RUN_TEST(test_BackToBackTransfers_ChainedWithoutZlpBetween);
+	RUN_TEST(test_WriteWhileZlpPending_SentAfterZlp);
+	RUN_TEST(test_SustainedWrites_NearFullSpeedLimit);
+	testResult = UNITY_END();
+	vTaskEndScheduler();
+}
+
+int main( void )
+{
+	for(size_t i = 0; i < sizeof(pattern); i++)
+	{
+		pattern[i] = (uint8_t)i;
+	}
+
+	FakeUsbReset(&usbDev);
+	usbDev.pClass = &USBD_CDC;
+	usbDev.pUserData = &fakeItf;
+	USBD_CDC.Init(&usbDev, 0);
+
+	//sized the same as the drivers' - storage a whole number of packets long
+	txStream = xStreamBufferCreate(TX_BUFF_LEN - 1, 1);
+	configASSERT(txStream != NULL);
+	configASSERT(xTaskCreate(txTask, "usbTx", STACK_SIZE, NULL, TX_PRIORITY, NULL) == pdPASS);
+	configASSERT(xTaskCreate(testTask, "test", STACK_SIZE, NULL, BUS_PRIORITY, NULL) == pdPASS);
+
+	vTaskStartScheduler();
+	return testResult;
+}
@@ -0,0 +1,305 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2019 Brian Amos
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+/*********************************************
+ * heapReport - turns the "heapprof" lines written by
+ * HeapProfilerDump (Drivers/HandsOnRTOS/HeapProfiler.c) into
+ * a per call site report, in CSV.
+ *
+ * usage: heapReport [-e <elf file>] [dump file]
+ *
+ * The dump is read from the file (or stdin) - the lines can be
+ * anywhere in a capture of the target's output (a serial log, an RTT
+ * terminal, a SystemView terminal window export), any text in front
+ * of "heapprof" is skipped.  With -e, each call site is looked up in
+ * the ELF file with addr2line (which has to be on the path - the
+ * cross toolchain's arm-none-eabi-addr2line is picked with ADDR2LINE).
+ *
+ * Sites are merged across tasks and sorted by the number of
+ * allocations.  The "pool" column suggests a BufferPool.h pool
+ * (blocks x size) for sites that always allocate the same size and
+ * free their blocks again.  The size and lifetime histograms follow
+ * the sites.
+ *********************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_SITES 256
+#define MAX_TASKS_LEN 96
+#define NUM_BUCKETS 16
+
+typedef struct
+{
+	unsigned long Caller;
+	char Tasks[MAX_TASKS_LEN];
+	unsigned long Allocs, Frees, Failed, Live, PeakLive;
+	unsigned long PeakBytes, TotalBytes, MinSize, MaxSize;
+	unsigned long LifetimeTotal, LifetimeMax;
+}Site_t;
+
+static Site_t sites[MAX_SITES];
+static int numSites;
+static unsigned long sizes[NUM_BUCKETS];
+static unsigned long lifetimes[NUM_BUCKETS];
+
+static Site_t* findSite( unsigned long Caller )
+{
+	for(int i = 0; i < numSites; i++)
+	{
+		if(sites[i].Caller == Caller)
+		{
+			return &sites[i];
+		}
+	}
+	if(numSites == MAX_SITES)
+	{
+		return NULL;
+	}
+	memset(&sites[numSites], 0, sizeof(Site_t));
+	sites[numSites].Caller = Caller;
+	sites[numSites].MinSize = (unsigned long)-1;
+	return &sites[numSites++];
+}
+
+static void addTask( Site_t* Site, char const* Task )
+{
+	size_t len = strlen(Site->Tasks);
+
+	if(len + strlen(Task) + 2 > sizeof(Site->Tasks))
+	{
+		return;
+	}
+	if(len > 0)
+	{
+		Site->Tasks[len++] = ' ';
+	}
+	strcpy(Site->Tasks + len, Task);
+}
+
+static void parseSite( char const* Fields )
+{
+	char task[64];
+	unsigned long caller;
+	unsigned long v[12];
+	Site_t* site;
+
+	if(sscanf(Fields, "%lx %63s %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu",
+			&caller, task, &v[0], &v[1], &v[2], &v[3], &v[4], &v[5],
+			&v[6], &v[7], &v[8], &v[9], &v[10], &v[11]) != 14)
+	{
+		return;
+	}
+	if((site = findSite(caller)) == NULL)
+	{
+		fprintf(stderr, "heapReport: more than %d call sites\n", MAX_SITES);
+		return;
+	}
+	addTask(site, task);
+	site->Allocs += v[0];
+	site->Frees += v[1];
+	site->Failed += v[2];
+	site->Live += v[3];
+	//peaks of different tasks don't necessarily line up, their sum is the worst case
+	site->PeakLive += v[4];
+	site->PeakBytes += v[6];
+	site->TotalBytes += v[7];
+	if(v[0] > 0 && v[8] < site->MinSize)
+	{
+		site->MinSize = v[8];
+	}
+	if(v[9] > site->MaxSize)
+	{
+		site->MaxSize = v[9];
+	}
+	site->LifetimeTotal += v[10];
+	if(v[11] > site->LifetimeMax)
+	{
+		site->LifetimeMax = v[11];
+	}
+}
+
+static void parseBuckets( char const* Fields, unsigned long* Buckets )
+{
+	for(int i = 0; i < NUM_BUCKETS; i++)
+	{
+		char* end;
+		unsigned long count = strtoul(Fields, &end, 10);
+
+		if(end == Fields)
+		{
+			break;
+		}
+		Buckets[i] += count;
+		Fields = end;
+	}
+}
+
+static void parseLine( char const* Line )
+{
+	char const* fields = strstr(Line, "heapprof ");
+
+	if(fields == NULL)
+	{
+		return;
+	}
+	fields += strlen("heapprof ");
+	if(strncmp(fields, "site ", 5) == 0)
+	{
+		parseSite(fields + 5);
+	}
+	else if(strncmp(fields, "sizes ", 6) == 0)
+	{
+		parseBuckets(fields + 6, sizes);
+	}
+	else if(strncmp(fields, "lifetimes ", 10) == 0)
+	{
+		parseBuckets(fields + 10, lifetimes);
+	}
+}
+
+/**
+ * look Caller up with addr2line.  Caller is a return address, so the
+ * call itself is the instruction before it (on Cortex-M it also has
+ * the Thumb bit set) - subtracting one lands inside the call either way
+ */
+static void lookUp( char const* Elf, unsigned long Caller, char* Function, size_t FunctionLen,
+					char* Location, size_t LocationLen )
+{
+	char const* addr2line = getenv("ADDR2LINE");
+	char command[512];
+	FILE* output;
+
+	snprintf(Function, FunctionLen, "?");
+	snprintf(Location, LocationLen, "?");
+	if(Elf == NULL || Caller == 0)
+	{
+		return;
+	}
+	snprintf(command, sizeof(command), "%s -f -C -e '%s' %lx",
+			(addr2line != NULL) ? addr2line : "addr2line", Elf, Caller - 1);
+	if((output = popen(command, "r")) == NULL)
+	{
+		return;
+	}
+	if(fgets(Function, (int)FunctionLen, output) != NULL)
+	{
+		Function[strcspn(Function, "\r\n")] = '\0';
+		if(fgets(Location, (int)LocationLen, output) != NULL)
+		{
+			Location[strcspn(Location, "\r\n")] = '\0';
+		}
+	}
+	pclose(output);
+}
+
+static int byAllocs( void const* A, void const* B )
+{
+	Site_t const* a = A;
+	Site_t const* b = B;
+
+	if(a->Allocs + a->Failed != b->Allocs + b->Failed)
+	{
+		return (a->Allocs + a->Failed < b->Allocs + b->Failed) ? 1 : -1;
+	}
+	return (a->Caller > b->Caller) - (a->Caller < b->Caller);
+}
+
+static void printBuckets( char const* Name, unsigned long const* Buckets )
+{
+	printf("%s", Name);
+	for(int i = 0; i < NUM_BUCKETS; i++)
+	{
+		printf(",%lu", Buckets[i]);
+	}
+	printf("\n");
+}
+
+int main( int argc, char* argv[] )
+{
+	char const* elf = NULL;
+	FILE* input = stdin;
+	char line[512];
+	int arg = 1;
+
+	if(arg + 1 < argc && strcmp(argv[arg], "-e") == 0)
+	{
+		elf = argv[arg + 1];
+		arg += 2;
+	}
+	if(arg < argc && (input = fopen(argv[arg], "r")) == NULL)
+	{
+		fprintf(stderr, "usage: heapReport [-e <elf file>] [dump file]\n");
+		return 1;
+	}
+	while(fgets(line, sizeof(line), input) != NULL)
+	{
+		parseLine(line);
+	}
+	if(input != stdin)
+	{
+		fclose(input);
+	}
+	if(numSites == 0)
+	{
+		fprintf(stderr, "heapReport: no heapprof site lines found\n");
+		return 1;
+	}
+
+	qsort(sites, (size_t)numSites, sizeof(Site_t), byAllocs);
+	printf("site,function,location,tasks,allocs,frees,failed,live,peak_live,peak_bytes,"
+			"min_size,max_size,mean_lifetime_ticks,max_lifetime_ticks,pool\n");
+	for(int i = 0; i < numSites; i++)
+	{
+		Site_t const* site = &sites[i];
+		char function[256];
+		char location[256];
+		char pool[32] = "";
+
+		lookUp(elf, site->Caller, function, sizeof(function), location, sizeof(location));
+		if(site->Allocs > 0 && site->Frees > 0 && site->MinSize == site->MaxSize)
+		{
+			snprintf(pool, sizeof(pool), "%lux%lu", site->PeakLive, site->MaxSize);
+		}
+		printf("0x%lx,%s,%s,%s,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%s\n",
+				site->Caller, function, location, site->Tasks,
+				site->Allocs, site->Frees, site->Failed, site->Live, site->PeakLive,
+				site->PeakBytes, (site->Allocs > 0) ? site->MinSize : 0, site->MaxSize,
+				(site->Frees > 0) ? site->LifetimeTotal / site->Frees : 0,
+				site->LifetimeMax, pool);
+	}
+
+	//bucket n holds the values n bits long: 0, 1, 2-3, 4-7 ...
+	printf("\nbucket");
+	for(int i = 0; i < NUM_BUCKETS; i++)
+	{
+		printf(",%lu", (i == 0) ? 0UL : 1UL << (i - 1));
+	}
+	printf("\n");
+	printBuckets("sizes", sizes);
+	printBuckets("lifetimes", lifetimes);
+	return 0;
+}
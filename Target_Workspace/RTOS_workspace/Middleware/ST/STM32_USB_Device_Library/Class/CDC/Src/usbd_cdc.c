@@ -680,8 +680,24 @@ static uint8_t  USBD_CDC_DataIn (USBD_HandleTypeDef *pdev, uint8_t epnum)
       /* Update the packet total length */
       pdev->ep_in[epnum].total_length = 0U;
 
-      /* Send ZLP */
-      USBD_LL_Transmit (pdev, epnum, NULL, 0U);
+      /* The data has all been sent, so the callback is given the chance to
+         queue the next transfer straight away.  A ZLP is only needed to end
+         the transfer if nothing follows it - otherwise the next transfer's
+         short packet ends it.  The callback is called again once the ZLP
+         has been sent */
+      hcdc->TxState = 0U;
+      if(hcdc->TxCallBack != NULL)
+      {
+        hcdc->TxCallBack();
+      }
+
+      if(hcdc->TxState == 0U)
+      {
+        hcdc->TxState = 1U;
+
+        /* Send ZLP */
+        USBD_LL_Transmit (pdev, epnum, NULL, 0U);
+      }
     }
     else
     {
@@ -274,6 +274,12 @@ extern "C" {
 	#define portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSavedStatusValue ) ( void ) uxSavedStatusValue
 #endif
 
+#ifndef portGET_CALLER_ADDRESS
+	/* The return address of the function it is used in, for traceMALLOC_FROM.
+	Ports built with GCC define it as __builtin_return_address( 0 ). */
+	#define portGET_CALLER_ADDRESS() NULL
+#endif
+
 #ifndef portCLEAN_UP_TCB
 	#define portCLEAN_UP_TCB( pxTCB ) ( void ) pxTCB
 #endif
@@ -553,6 +559,27 @@ extern "C" {
 	#define traceTASK_INCREMENT_TICK( xTickCount )
 #endif
 
+#ifndef traceADD_TO_DELAYED_LIST_BEGIN
+	/* Called on entering and leaving the code that moves the running task to
+	the delayed task lists, which runs with the scheduler suspended or, when
+	waiting for a notification, inside a critical section. */
+	#define traceADD_TO_DELAYED_LIST_BEGIN()
+#endif
+
+#ifndef traceADD_TO_DELAYED_LIST_END
+	#define traceADD_TO_DELAYED_LIST_END()
+#endif
+
+#ifndef traceUNBLOCK_DELAYED_TASKS_BEGIN
+	/* Called around the tick interrupt's search of the delayed task lists for
+	tasks to unblock, on the ticks where there may be any. */
+	#define traceUNBLOCK_DELAYED_TASKS_BEGIN()
+#endif
+
+#ifndef traceUNBLOCK_DELAYED_TASKS_END
+	#define traceUNBLOCK_DELAYED_TASKS_END()
+#endif
+
 #ifndef traceTIMER_CREATE
 	#define traceTIMER_CREATE( pxNewTimer )
 #endif
@@ -581,6 +608,24 @@ extern "C" {
     #define traceFREE( pvAddress, uiSize )
 #endif
 
+#ifndef traceMALLOC_FROM
+	/* Called alongside traceMALLOC, with the size that was asked for, the size
+	of the block handed out (header included, 0 if the allocation failed) and
+	the address pvPortMalloc() was called from - see portGET_CALLER_ADDRESS(). */
+	#define traceMALLOC_FROM( pvAddress, xWantedSize, xBlockSize, pvCaller )
+	#define traceMALLOC_FROM_DEFINED 0
+#else
+	/* The allocators only keep the sizes traceMALLOC_FROM reports when it is
+	defined. */
+	#define traceMALLOC_FROM_DEFINED 1
+#endif
+
+#ifndef traceHEAP_INIT
+	/* Called once the heap has been set up, with the start and size of the
+	memory it manages and the size of the header in front of each block. */
+	#define traceHEAP_INIT( pvStart, xHeapSize, xBlockOverhead )
+#endif
+
 #ifndef traceEVENT_GROUP_CREATE
 	#define traceEVENT_GROUP_CREATE( xEventGroup )
 #endif
@@ -843,6 +888,82 @@ extern "C" {
 	#define configUSE_PORT_OPTIMISED_TASK_SELECTION 0
 #endif
 
+/* configUSE_BITMAP_TASK_SELECTION selects the highest priority ready task from
+a bitmap of the non-empty ready lists using the compiler's count leading zeros
+builtin, rather than by walking down the ready lists.  Unlike the port optimised
+method it is not tied to a port, and supports up to 1024 priorities by adding a
+second bitmap level when configMAX_PRIORITIES is greater than 32. */
+#ifndef configUSE_BITMAP_TASK_SELECTION
+	#define configUSE_BITMAP_TASK_SELECTION 0
+#endif
+
+#if( ( configUSE_BITMAP_TASK_SELECTION == 1 ) && ( configUSE_PORT_OPTIMISED_TASK_SELECTION == 1 ) )
+	#error configUSE_BITMAP_TASK_SELECTION and configUSE_PORT_OPTIMISED_TASK_SELECTION cannot both be set to 1.  Set configUSE_PORT_OPTIMISED_TASK_SELECTION to 0 in FreeRTOSConfig.h.
+#endif
+
+#if( ( configUSE_BITMAP_TASK_SELECTION == 1 ) && ( configMAX_PRIORITIES > 1024 ) )
+	#error configUSE_BITMAP_TASK_SELECTION can only be set to 1 when configMAX_PRIORITIES is less than or equal to 1024.
+#endif
+
+/* The count leading zeros of a non-zero 32-bit value, used by
+configUSE_BITMAP_TASK_SELECTION.  Compilers without __builtin_clz() can provide
+their own intrinsic by defining portCOUNT_LEADING_ZEROS() in portmacro.h. */
+#ifndef portCOUNT_LEADING_ZEROS
+	#define portCOUNT_LEADING_ZEROS( ulBitmap ) ( ( UBaseType_t ) __builtin_clz( ( unsigned int ) ( ulBitmap ) ) )
+#endif
+
+/* configUSE_TIMER_WHEEL keeps active software timers in a hierarchical timing
+wheel instead of the two sorted active timer lists, so starting, stopping and
+resetting a timer takes the same time however many timers are active.  Each of
+the configTIMER_WHEEL_LEVELS levels has 32 slots, so the wheel reaches 2^25
+ticks ahead with the default 5 levels.  Timers due further ahead than that are
+parked in the top level and re-filed as the wheel turns. */
+#ifndef configUSE_TIMER_WHEEL
+	#define configUSE_TIMER_WHEEL 0
+#endif
+
+#ifndef configTIMER_WHEEL_LEVELS
+	#define configTIMER_WHEEL_LEVELS 5
+#endif
+
+#if( ( configUSE_TIMER_WHEEL == 1 ) && ( ( configTIMER_WHEEL_LEVELS < 2 ) || ( configTIMER_WHEEL_LEVELS > 6 ) ) )
+	#error configTIMER_WHEEL_LEVELS must be between 2 and 6.
+#endif
+
+#if( ( configUSE_TIMER_WHEEL == 1 ) && ( configUSE_16_BIT_TICKS == 1 ) )
+	#error configUSE_TIMER_WHEEL cannot be used with 16-bit ticks.
+#endif
+
+/* The timer service task takes up to configTIMER_COMMAND_BATCH_LENGTH commands
+off the timer command queue at a time, with the scheduler suspended, before
+acting on them.  Tasks blocked on a full command queue are then readied once
+per batch rather than once per command.  1 receives one command at a time. */
+#ifndef configTIMER_COMMAND_BATCH_LENGTH
+	#define configTIMER_COMMAND_BATCH_LENGTH 1
+#endif
+
+/* configUSE_DELAYED_TASK_WHEEL keeps the tasks that are Blocked with a timeout
+in a timing wheel, the same as configUSE_TIMER_WHEEL does for timers, instead
+of the two sorted delayed task lists.  A task then enters the Blocked state in
+the same time however many tasks are blocked already, and the tick interrupt
+only handles the tasks it unblocks, plus those it moves down a level of the
+wheel now and again. */
+#ifndef configUSE_DELAYED_TASK_WHEEL
+	#define configUSE_DELAYED_TASK_WHEEL 0
+#endif
+
+#ifndef configDELAYED_TASK_WHEEL_LEVELS
+	#define configDELAYED_TASK_WHEEL_LEVELS 5
+#endif
+
+#if( ( configUSE_DELAYED_TASK_WHEEL == 1 ) && ( ( configDELAYED_TASK_WHEEL_LEVELS < 2 ) || ( configDELAYED_TASK_WHEEL_LEVELS > 6 ) ) )
+	#error configDELAYED_TASK_WHEEL_LEVELS must be between 2 and 6.
+#endif
+
+#if( ( configUSE_DELAYED_TASK_WHEEL == 1 ) && ( configUSE_16_BIT_TICKS == 1 ) )
+	#error configUSE_DELAYED_TASK_WHEEL cannot be used with 16-bit ticks.
+#endif
+
 #ifndef configAPPLICATION_ALLOCATED_HEAP
 	#define configAPPLICATION_ALLOCATED_HEAP 0
 #endif
@@ -125,6 +125,30 @@ typedef struct HeapRegion
 	size_t xSizeInBytes;
 } HeapRegion_t;
 
+/* Used to pass information about the heap out of vPortGetHeapStats(). */
+typedef struct xHeapStats
+{
+	size_t xAvailableHeapSpaceInBytes;		/* The total heap size currently available - this is the sum of all the free blocks, not the largest block that can be allocated. */
+	size_t xSizeOfLargestFreeBlockInBytes;	/* The maximum size, in bytes, of all the free blocks within the heap at the time vPortGetHeapStats() is called. */
+	size_t xSizeOfSmallestFreeBlockInBytes;	/* The minimum size, in bytes, of all the free blocks within the heap at the time vPortGetHeapStats() is called. */
+	size_t xNumberOfFreeBlocks;				/* The number of free memory blocks within the heap at the time vPortGetHeapStats() is called. */
+	size_t xMinimumEverFreeBytesRemaining;	/* The minimum amount of total free memory (sum of all free blocks) there has been in the heap since the system booted. */
+	size_t xNumberOfSuccessfulAllocations;	/* The number of calls to pvPortMalloc() that have returned a valid memory block. */
+	size_t xNumberOfSuccessfulFrees;		/* The number of calls to vPortFree() that has successfully freed a block of memory. */
+} HeapStats_t;
+
+/* Used by heap_6.c to pass information about each of its size classes out of
+uxPortGetHeapClassStats().  Block sizes include the allocator's header. */
+typedef struct xHeapClassStats
+{
+	size_t xMinimumBlockSizeInBytes;		/* The smallest block size in the class - the class holds blocks up to the next class's minimum. */
+	size_t xNumberOfFreeBlocks;				/* The number of free blocks in the class at the time uxPortGetHeapClassStats() is called. */
+	size_t xFreeBytes;						/* The sum of the sizes of those free blocks. */
+	size_t xNumberOfSuccessfulAllocations;	/* The number of calls to pvPortMalloc() for a block in this class that returned a valid memory block. */
+	size_t xNumberOfFailedAllocations;		/* The number of calls to pvPortMalloc() for a block in this class that returned NULL. */
+	size_t xNumberOfSuccessfulFrees;		/* The number of blocks in this class returned by vPortFree(). */
+} HeapClassStats_t;
+
 /*
  * Used to define multiple heap regions for use by heap_5.c.  This function
  * must be called before any calls to pvPortMalloc() - not creating a task,
@@ -138,6 +162,18 @@ typedef struct HeapRegion
  */
 void vPortDefineHeapRegions( const HeapRegion_t * const pxHeapRegions ) PRIVILEGED_FUNCTION;
 
+/*
+ * Returns a HeapStats_t structure filled with information about the current
+ * heap state.
+ */
+void vPortGetHeapStats( HeapStats_t *pxHeapStats ) PRIVILEGED_FUNCTION;
+
+/*
+ * Used by heap_6.c.  Fills in up to uxMaxClasses HeapClassStats_t structures,
+ * one per size class from the smallest up, and returns the number of classes
+ * the heap has.
+ */
+UBaseType_t uxPortGetHeapClassStats( HeapClassStats_t *pxClassStats, UBaseType_t uxMaxClasses ) PRIVILEGED_FUNCTION;
 
 /*
  * Map to the memory management routines required for the port.
@@ -64,6 +64,22 @@ extern "C" {
 struct StreamBufferDef_t;
 typedef struct StreamBufferDef_t * StreamBufferHandle_t;
 
+/**
+ * Describes a region of a stream buffer's storage area that can be accessed
+ * directly by the application, as returned by xStreamBufferReserve() and
+ * xStreamBufferPeek().  The region is split into two contiguous spans when it
+ * wraps past the end of the storage area, in which case pucSecond always
+ * points to the start of the storage area.  xSecondLength is 0 (and pucSecond
+ * is NULL) when the region does not wrap.
+ */
+typedef struct xSTREAM_BUFFER_SPANS
+{
+	uint8_t *pucFirst;
+	size_t xFirstLength;
+	uint8_t *pucSecond;
+	size_t xSecondLength;
+} StreamBufferSpans_t;
+
 
 /**
  * message_buffer.h
@@ -829,6 +845,243 @@ BaseType_t xStreamBufferReceiveCompletedFromISR( StreamBufferHandle_t xStreamBuf
  */
 BaseType_t xStreamBufferReceiveCompletedFromISR( StreamBufferHandle_t xStreamBuffer, BaseType_t *pxHigherPriorityTaskWoken ) PRIVILEGED_FUNCTION;
 
+/**
+ * stream_buffer.h
+ *
+<pre>
+size_t xStreamBufferReserve( StreamBufferHandle_t xStreamBuffer,
+                             StreamBufferSpans_t *pxSpans,
+                             size_t xMaxLengthBytes,
+                             TickType_t xTicksToWait );
+</pre>
+ *
+ * Obtains direct access to the free space of a stream buffer so the writer
+ * can place data straight into the stream buffer's storage area (for example
+ * by pointing a DMA transfer at it) instead of building the data in a separate
+ * buffer and copying it in with xStreamBufferSend().  Nothing is made visible
+ * to the reader until xStreamBufferCommit() or xStreamBufferCommitFromISR()
+ * is called.
+ *
+ * The free space is returned as one contiguous span, or two spans if it wraps
+ * past the end of the storage area.  A writer that needs a single contiguous
+ * region (such as a DMA transfer) can simply use the first span and reserve
+ * again after committing it.
+ *
+ * xStreamBufferReserve() does not modify the stream buffer.  The usual single
+ * writer rule applies - only the writer may reserve and commit.  Cannot be
+ * used with message buffers.  Use xStreamBufferReserveFromISR() to reserve
+ * space from an interrupt.
+ *
+ * @param xStreamBuffer The handle of the stream buffer being written to.
+ *
+ * @param pxSpans Filled with the location and length of the free space.
+ *
+ * @param xMaxLengthBytes The maximum number of bytes the caller wants to
+ * write.  The total length of the returned spans will not exceed this value.
+ *
+ * @param xTicksToWait The maximum amount of time the calling task should
+ * remain in the Blocked state to wait for xMaxLengthBytes of space to become
+ * free (capped to the capacity of the stream buffer).  If the block time
+ * expires first, however much space is free is returned.
+ *
+ * @return The total number of bytes described by pxSpans, which may be less
+ * than xMaxLengthBytes if the stream buffer does not have enough free space.
+ *
+ * \defgroup xStreamBufferReserve xStreamBufferReserve
+ * \ingroup StreamBufferManagement
+ */
+size_t xStreamBufferReserve( StreamBufferHandle_t xStreamBuffer,
+							 StreamBufferSpans_t *pxSpans,
+							 size_t xMaxLengthBytes,
+							 TickType_t xTicksToWait ) PRIVILEGED_FUNCTION;
+
+/**
+ * stream_buffer.h
+ *
+<pre>
+size_t xStreamBufferReserveFromISR( StreamBufferHandle_t xStreamBuffer,
+                                    StreamBufferSpans_t *pxSpans,
+                                    size_t xMaxLengthBytes );
+</pre>
+ *
+ * An interrupt safe version of xStreamBufferReserve(), which never blocks.
+ *
+ * \defgroup xStreamBufferReserveFromISR xStreamBufferReserveFromISR
+ * \ingroup StreamBufferManagement
+ */
+size_t xStreamBufferReserveFromISR( StreamBufferHandle_t xStreamBuffer,
+									StreamBufferSpans_t *pxSpans,
+									size_t xMaxLengthBytes ) PRIVILEGED_FUNCTION;
+
+/**
+ * stream_buffer.h
+ *
+<pre>
+size_t xStreamBufferCommit( StreamBufferHandle_t xStreamBuffer, size_t xLengthBytes );
+</pre>
+ *
+ * Makes the first xLengthBytes of the space previously obtained with
+ * xStreamBufferReserve() available to the reader, in the same way as if they
+ * had been sent with xStreamBufferSend().  A task that is blocked waiting for
+ * data is unblocked if the trigger level has been reached.
+ *
+ * Use xStreamBufferCommitFromISR() to commit from an interrupt.
+ *
+ * @param xStreamBuffer The handle of the stream buffer being written to.
+ *
+ * @param xLengthBytes The number of bytes that were written into the reserved
+ * spans, starting at the first span.  Must not exceed the value returned by
+ * the preceding call to xStreamBufferReserve().
+ *
+ * @return The number of bytes committed.
+ *
+ * \defgroup xStreamBufferCommit xStreamBufferCommit
+ * \ingroup StreamBufferManagement
+ */
+size_t xStreamBufferCommit( StreamBufferHandle_t xStreamBuffer, size_t xLengthBytes ) PRIVILEGED_FUNCTION;
+
+/**
+ * stream_buffer.h
+ *
+<pre>
+size_t xStreamBufferCommitFromISR( StreamBufferHandle_t xStreamBuffer,
+                                   size_t xLengthBytes,
+                                   BaseType_t *pxHigherPriorityTaskWoken );
+</pre>
+ *
+ * An interrupt safe version of xStreamBufferCommit().
+ *
+ * @param xStreamBuffer The handle of the stream buffer being written to.
+ *
+ * @param xLengthBytes The number of bytes that were written into the reserved
+ * spans.
+ *
+ * @param pxHigherPriorityTaskWoken Set to pdTRUE if committing the data
+ * unblocked a task with a priority above the currently running task, in which
+ * case a context switch should be requested before the interrupt is exited.
+ *
+ * @return The number of bytes committed.
+ *
+ * \defgroup xStreamBufferCommitFromISR xStreamBufferCommitFromISR
+ * \ingroup StreamBufferManagement
+ */
+size_t xStreamBufferCommitFromISR( StreamBufferHandle_t xStreamBuffer,
+								   size_t xLengthBytes,
+								   BaseType_t * const pxHigherPriorityTaskWoken ) PRIVILEGED_FUNCTION;
+
+/**
+ * stream_buffer.h
+ *
+<pre>
+size_t xStreamBufferPeek( StreamBufferHandle_t xStreamBuffer,
+                          StreamBufferSpans_t *pxSpans,
+                          size_t xMaxLengthBytes,
+                          TickType_t xTicksToWait );
+</pre>
+ *
+ * Obtains direct access to the data held in a stream buffer so the reader can
+ * use the data in place (for example by handing it to a USB or DMA transfer)
+ * instead of copying it out with xStreamBufferReceive().  The data remains in
+ * the stream buffer, and the space it occupies is not made available to the
+ * writer, until xStreamBufferConsume() or xStreamBufferConsumeFromISR() is
+ * called.
+ *
+ * The data is returned as one contiguous span, or two spans if it wraps past
+ * the end of the storage area.
+ *
+ * Like xStreamBufferReceive(), if the stream buffer is empty the calling task
+ * can optionally block until data arrives.  The usual single reader rule
+ * applies - only the reader may peek and consume.  Cannot be used with message
+ * buffers.  Use xStreamBufferPeekFromISR() to peek from an interrupt.
+ *
+ * @param xStreamBuffer The handle of the stream buffer being read from.
+ *
+ * @param pxSpans Filled with the location and length of the available data.
+ *
+ * @param xMaxLengthBytes The maximum number of bytes the caller wants to read.
+ * The total length of the returned spans will not exceed this value.
+ *
+ * @param xTicksToWait The maximum amount of time the task should remain in the
+ * Blocked state to wait for data to become available if the stream buffer is
+ * empty.
+ *
+ * @return The total number of bytes described by pxSpans.
+ *
+ * \defgroup xStreamBufferPeek xStreamBufferPeek
+ * \ingroup StreamBufferManagement
+ */
+size_t xStreamBufferPeek( StreamBufferHandle_t xStreamBuffer,
+						  StreamBufferSpans_t *pxSpans,
+						  size_t xMaxLengthBytes,
+						  TickType_t xTicksToWait ) PRIVILEGED_FUNCTION;
+
+/**
+ * stream_buffer.h
+ *
+<pre>
+size_t xStreamBufferPeekFromISR( StreamBufferHandle_t xStreamBuffer,
+                                 StreamBufferSpans_t *pxSpans,
+                                 size_t xMaxLengthBytes );
+</pre>
+ *
+ * An interrupt safe version of xStreamBufferPeek(), which never blocks.
+ *
+ * \defgroup xStreamBufferPeekFromISR xStreamBufferPeekFromISR
+ * \ingroup StreamBufferManagement
+ */
+size_t xStreamBufferPeekFromISR( StreamBufferHandle_t xStreamBuffer,
+								 StreamBufferSpans_t *pxSpans,
+								 size_t xMaxLengthBytes ) PRIVILEGED_FUNCTION;
+
+/**
+ * stream_buffer.h
+ *
+<pre>
+size_t xStreamBufferConsume( StreamBufferHandle_t xStreamBuffer, size_t xLengthBytes );
+</pre>
+ *
+ * Removes the first xLengthBytes of the data previously obtained with
+ * xStreamBufferPeek() from the stream buffer, in the same way as if they had
+ * been read with xStreamBufferReceive().  A task that is blocked waiting for
+ * space is unblocked.
+ *
+ * Use xStreamBufferConsumeFromISR() to consume from an interrupt.
+ *
+ * @param xStreamBuffer The handle of the stream buffer being read from.
+ *
+ * @param xLengthBytes The number of bytes that have been used, starting at the
+ * first span.  Must not exceed the value returned by the preceding call to
+ * xStreamBufferPeek().
+ *
+ * @return The number of bytes removed from the stream buffer.
+ *
+ * \defgroup xStreamBufferConsume xStreamBufferConsume
+ * \ingroup StreamBufferManagement
+ */
+size_t xStreamBufferConsume( StreamBufferHandle_t xStreamBuffer, size_t xLengthBytes ) PRIVILEGED_FUNCTION;
+
+/**
+ * stream_buffer.h
+ *
+<pre>
+size_t xStreamBufferConsumeFromISR( StreamBufferHandle_t xStreamBuffer,
+                                    size_t xLengthBytes,
+                                    BaseType_t *pxHigherPriorityTaskWoken );
+</pre>
+ *
+ * An interrupt safe version of xStreamBufferConsume().
+ *
+ * @param pxHigherPriorityTaskWoken Set to pdTRUE if freeing the space
+ * unblocked a task with a priority above the currently running task, in which
+ * case a context switch should be requested before the interrupt is exited.
+ *
+ * \defgroup xStreamBufferConsumeFromISR xStreamBufferConsumeFromISR
+ * \ingroup StreamBufferManagement
+ */
+size_t xStreamBufferConsumeFromISR( StreamBufferHandle_t xStreamBuffer,
+									size_t xLengthBytes,
+									BaseType_t * const pxHigherPriorityTaskWoken ) PRIVILEGED_FUNCTION;
+
 /* Functions below here are not part of the public API. */
 StreamBufferHandle_t xStreamBufferGenericCreate( size_t xBufferSizeBytes,
 												 size_t xTriggerLevelBytes,
@@ -160,6 +160,10 @@ not necessary for to use this port.  They are defined so the common demo files
 /* portNOP() is not required by this port. */
 #define portNOP()
 
+/* For traceMALLOC_FROM.  This is the address after the call, with the Thumb
+bit set - look up the address minus one to find the calling line. */
+#define portGET_CALLER_ADDRESS() __builtin_return_address( 0 )
+
 #define portINLINE	__inline
 
 #ifndef portFORCE_INLINE
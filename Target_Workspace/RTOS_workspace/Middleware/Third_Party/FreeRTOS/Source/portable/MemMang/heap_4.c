@@ -114,6 +114,9 @@ void *pvPortMalloc( size_t xWantedSize )
 {
 BlockLink_t *pxBlock, *pxPreviousBlock, *pxNewBlockLink;
 void *pvReturn = NULL;
+#if( traceMALLOC_FROM_DEFINED == 1 )
+	size_t xRequestedSize = xWantedSize, xAllocatedBlockSize = 0;
+#endif
 
 	vTaskSuspendAll();
 	{
@@ -219,6 +222,11 @@ void *pvReturn = NULL;
 
 					/* The block is being returned - it is allocated and owned
 					by the application and has no "next" block. */
+					#if( traceMALLOC_FROM_DEFINED == 1 )
+					{
+						xAllocatedBlockSize = pxBlock->xBlockSize;
+					}
+					#endif
 					pxBlock->xBlockSize |= xBlockAllocatedBit;
 					pxBlock->pxNextFreeBlock = NULL;
 				}
@@ -238,6 +246,11 @@ void *pvReturn = NULL;
 		}
 
 		traceMALLOC( pvReturn, xWantedSize );
+		#if( traceMALLOC_FROM_DEFINED == 1 )
+		{
+			traceMALLOC_FROM( pvReturn, xRequestedSize, xAllocatedBlockSize, portGET_CALLER_ADDRESS() );
+		}
+		#endif
 	}
 	( void ) xTaskResumeAll();
 
@@ -369,6 +382,8 @@ size_t xTotalHeapSize = configTOTAL_HEAP_SIZE;
 	xMinimumEverFreeBytesRemaining = pxFirstFreeBlock->xBlockSize;
 	xFreeBytesRemaining = pxFirstFreeBlock->xBlockSize;
 
+	traceHEAP_INIT( pucAlignedHeap, xTotalHeapSize, xHeapStructSize );
+
 	/* Work out the position of the top bit in a size_t variable. */
 	xBlockAllocatedBit = ( ( size_t ) 1 ) << ( ( sizeof( size_t ) * heapBITS_PER_BYTE ) - 1 );
 }
@@ -0,0 +1,844 @@
+/*
+ * FreeRTOS Kernel V10.2.1
+ * Copyright (C) 2019 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/*
+ * A sample implementation of pvPortMalloc() and vPortFree() that keeps the
+ * free blocks in segregated size class lists (a two level segregated fit, or
+ * TLSF, allocator), so that both take the same bounded time however many
+ * blocks the heap has been split into.  heap_4.c searches its address ordered
+ * free list, first fit, when allocating and when freeing.
+ *
+ * The first level of classes are powers of two, each split into
+ * heapSL_INDEX_COUNT equal second level classes, with a bitmap of the non
+ * empty lists at each level.  An allocation takes the first block from the
+ * smallest non empty class whose blocks are all large enough, found with two
+ * bit scans.  Every block records the block below it in memory, so a freed
+ * block is combined (coalesced) with free neighbours on either side without a
+ * search, limiting fragmentation as heap_4.c does.
+ *
+ * The class lists take heapFL_INDEX_COUNT * heapSL_INDEX_COUNT pointers of RAM
+ * outside of the heap - 8 * 16 = 128 pointers for a 15KB heap with 8 byte
+ * alignment.
+ *
+ * Per class allocation counts and free space are available from
+ * uxPortGetHeapClassStats(), alongside vPortGetHeapStats().
+ *
+ * See heap_1.c, heap_2.c, heap_3.c, heap_4.c and heap_5.c for alternative
+ * implementations, and the memory management pages of http://www.FreeRTOS.org
+ * for more information.
+ */
+#include <stdlib.h>
+#include <stddef.h>
+
+/* Defining MPU_WRAPPERS_INCLUDED_FROM_API_FILE prevents task.h from redefining
+all the API functions to use the MPU wrappers.  That should only be done when
+task.h is included from an application file. */
+#define MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#undef MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#if( configSUPPORT_DYNAMIC_ALLOCATION == 0 )
+	#error This file must not be used if configSUPPORT_DYNAMIC_ALLOCATION is 0
+#endif
+
+/* Assumes 8bit bytes! */
+#define heapBITS_PER_BYTE		( ( size_t ) 8 )
+
+/* Block sizes are multiples of portBYTE_ALIGNMENT. */
+#if portBYTE_ALIGNMENT == 32
+	#define heapALIGNMENT_BITS	( 5U )
+#elif portBYTE_ALIGNMENT == 16
+	#define heapALIGNMENT_BITS	( 4U )
+#elif portBYTE_ALIGNMENT == 8
+	#define heapALIGNMENT_BITS	( 3U )
+#elif portBYTE_ALIGNMENT == 4
+	#define heapALIGNMENT_BITS	( 2U )
+#elif portBYTE_ALIGNMENT == 2
+	#define heapALIGNMENT_BITS	( 1U )
+#else
+	#define heapALIGNMENT_BITS	( 0U )
+#endif
+
+/* Each first level class is split into this many second level classes. */
+#define heapSL_INDEX_BITS		( 4U )
+#define heapSL_INDEX_COUNT		( 1U << heapSL_INDEX_BITS )
+
+/* Blocks smaller than heapSMALL_BLOCK_SIZE all go in first level class 0,
+whose second level classes are one alignment unit apart.  Above it first level
+class n holds the blocks from 2^(heapFL_INDEX_SHIFT + n - 1) bytes up. */
+#define heapFL_INDEX_SHIFT		( heapSL_INDEX_BITS + heapALIGNMENT_BITS )
+#define heapSMALL_BLOCK_SIZE	( ( size_t ) 1 << heapFL_INDEX_SHIFT )
+
+/* Enough first level classes for one block the size of the whole heap.  This
+is a ternary chain rather than #if as configTOTAL_HEAP_SIZE usually contains a
+cast. */
+#define heapMAX_SIZE_BITS		( ( configTOTAL_HEAP_SIZE ) < ( ( size_t ) 1 << 12 ) ? 12U :	\
+								  ( configTOTAL_HEAP_SIZE ) < ( ( size_t ) 1 << 14 ) ? 14U :	\
+								  ( configTOTAL_HEAP_SIZE ) < ( ( size_t ) 1 << 16 ) ? 16U :	\
+								  ( configTOTAL_HEAP_SIZE ) < ( ( size_t ) 1 << 18 ) ? 18U :	\
+								  ( configTOTAL_HEAP_SIZE ) < ( ( size_t ) 1 << 20 ) ? 20U :	\
+								  ( configTOTAL_HEAP_SIZE ) < ( ( size_t ) 1 << 24 ) ? 24U : 31U )
+#define heapFL_INDEX_COUNT		( heapMAX_SIZE_BITS - heapFL_INDEX_SHIFT + 1U )
+
+/* Allocate the memory for the heap. */
+#if( configAPPLICATION_ALLOCATED_HEAP == 1 )
+	/* The application writer has already defined the array used for the RTOS
+	heap - probably so it can be placed in a special segment or address. */
+	extern uint8_t ucHeap[ configTOTAL_HEAP_SIZE ];
+#else
+	static uint8_t ucHeap[ configTOTAL_HEAP_SIZE ];
+#endif /* configAPPLICATION_ALLOCATED_HEAP */
+
+/* The header at the start of every block.  Only the first two members are
+kept while the block is allocated - the allocation starts where the free list
+links would be. */
+typedef struct A_BLOCK_HEADER
+{
+	struct A_BLOCK_HEADER *pxPrevPhysicalBlock;	/*<< The block immediately below this one in memory, NULL for the lowest block. */
+	size_t xBlockSize;							/*<< The size of the block including its header. */
+	struct A_BLOCK_HEADER *pxNextFreeBlock;		/*<< The next free block in the same class. */
+	struct A_BLOCK_HEADER *pxPrevFreeBlock;		/*<< The previous free block in the same class. */
+} BlockHeader_t;
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Called automatically to setup the required heap structures the first time
+ * pvPortMalloc() is called.
+ */
+static void prvHeapInit( void );
+
+/*
+ * The first and second level class of a free block of xBlockSize bytes.
+ */
+static void prvMapping( size_t xBlockSize, UBaseType_t *puxFL, UBaseType_t *puxSL );
+
+/*
+ * The first level class only, used to index the class statistics.
+ */
+static UBaseType_t prvFirstLevelIndex( size_t xBlockSize );
+
+/*
+ * Find (but don't remove) a free block of at least xWantedSize bytes, and the
+ * class it is in.  Returns NULL if there is none.
+ */
+static BlockHeader_t *prvFindFreeBlock( size_t xWantedSize, UBaseType_t *puxFL, UBaseType_t *puxSL );
+
+/*
+ * Add a free block to the head of its class list, or take it out again.
+ */
+static void prvInsertFreeBlock( BlockHeader_t *pxBlock );
+static void prvRemoveFreeBlock( BlockHeader_t *pxBlock, UBaseType_t uxFL, UBaseType_t uxSL );
+
+/*
+ * Bit scans - the index of the most and least significant set bit.  The value
+ * must not be 0.
+ */
+static UBaseType_t prvFindLastSet( size_t xValue );
+static UBaseType_t prvFindFirstSet( uint32_t ulValue );
+
+/*-----------------------------------------------------------*/
+
+/* The size of the header kept at the start of an allocated block must be
+correctly byte aligned. */
+static const size_t xHeapStructSize	= ( offsetof( BlockHeader_t, pxNextFreeBlock ) + ( ( size_t ) ( portBYTE_ALIGNMENT - 1 ) ) ) & ~( ( size_t ) portBYTE_ALIGNMENT_MASK );
+
+/* Free blocks must be large enough to hold the whole header. */
+static const size_t xMinimumBlockSize = ( sizeof( BlockHeader_t ) + ( ( size_t ) ( portBYTE_ALIGNMENT - 1 ) ) ) & ~( ( size_t ) portBYTE_ALIGNMENT_MASK );
+
+/* The free block lists, with one bit per list in the second level bitmaps set
+while it is not empty, and one bit per first level class set while any of its
+lists are not empty. */
+static BlockHeader_t *pxFreeLists[ heapFL_INDEX_COUNT ][ heapSL_INDEX_COUNT ];
+static uint32_t ulSecondLevelBitmaps[ heapFL_INDEX_COUNT ];
+static uint32_t ulFirstLevelBitmap = 0U;
+
+/* A zero sized, permanently allocated block at the top of the heap, so the
+block above any other block can be looked at without a bounds check. */
+static BlockHeader_t *pxEnd = NULL;
+
+/* Keeps track of the number of free bytes remaining, but says nothing about
+fragmentation. */
+static size_t xFreeBytesRemaining = 0U;
+static size_t xMinimumEverFreeBytesRemaining = 0U;
+static size_t xNumberOfSuccessfulAllocations = 0U;
+static size_t xNumberOfSuccessfulFrees = 0U;
+
+/* Per first level class counts for uxPortGetHeapClassStats(). */
+static size_t xClassAllocations[ heapFL_INDEX_COUNT ];
+static size_t xClassFailedAllocations[ heapFL_INDEX_COUNT ];
+static size_t xClassFrees[ heapFL_INDEX_COUNT ];
+
+/* Gets set to the top bit of an size_t type.  When this bit in the xBlockSize
+member of an BlockHeader_t structure is set then the block belongs to the
+application.  When the bit is free the block is still part of the free heap
+space. */
+static size_t xBlockAllocatedBit = 0;
+
+/*-----------------------------------------------------------*/
+
+void *pvPortMalloc( size_t xWantedSize )
+{
+BlockHeader_t *pxBlock, *pxNewBlock;
+UBaseType_t uxFL, uxSL, uxClass;
+void *pvReturn = NULL;
+#if( traceMALLOC_FROM_DEFINED == 1 )
+	size_t xRequestedSize = xWantedSize, xAllocatedBlockSize = 0;
+#endif
+
+	vTaskSuspendAll();
+	{
+		/* If this is the first call to malloc then the heap will require
+		initialisation to setup the list of free blocks. */
+		if( pxEnd == NULL )
+		{
+			prvHeapInit();
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+
+		/* Check the requested block size is not so large that the top bit is
+		set.  The top bit of the block size member of the BlockHeader_t
+		structure is used to determine who owns the block - the application or
+		the kernel, so it must be free. */
+		if( ( xWantedSize > 0 ) && ( ( xWantedSize & xBlockAllocatedBit ) == 0 ) )
+		{
+			/* The wanted size is increased so it can contain the header in
+			addition to the requested amount of bytes, and so that blocks are
+			always aligned to the required number of bytes. */
+			xWantedSize += xHeapStructSize;
+			if( ( xWantedSize & portBYTE_ALIGNMENT_MASK ) != 0x00 )
+			{
+				xWantedSize += ( portBYTE_ALIGNMENT - ( xWantedSize & portBYTE_ALIGNMENT_MASK ) );
+				configASSERT( ( xWantedSize & portBYTE_ALIGNMENT_MASK ) == 0 );
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+
+			/* The block has to be able to hold the free list links once it
+			is freed again. */
+			if( xWantedSize < xMinimumBlockSize )
+			{
+				xWantedSize = xMinimumBlockSize;
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+
+			uxClass = prvFirstLevelIndex( xWantedSize );
+
+			if( xWantedSize <= xFreeBytesRemaining )
+			{
+				pxBlock = prvFindFreeBlock( xWantedSize, &uxFL, &uxSL );
+
+				if( pxBlock != NULL )
+				{
+					prvRemoveFreeBlock( pxBlock, uxFL, uxSL );
+
+					/* If the block is larger than required it can be split
+					into two.  The block above a free block is never free, so
+					the remainder doesn't need combining with anything. */
+					if( ( pxBlock->xBlockSize - xWantedSize ) >= xMinimumBlockSize )
+					{
+						/* The void cast is used to prevent byte alignment
+						warnings from the compiler. */
+						pxNewBlock = ( void * ) ( ( ( uint8_t * ) pxBlock ) + xWantedSize );
+						configASSERT( ( ( ( size_t ) pxNewBlock ) & portBYTE_ALIGNMENT_MASK ) == 0 );
+
+						pxNewBlock->xBlockSize = pxBlock->xBlockSize - xWantedSize;
+						pxNewBlock->pxPrevPhysicalBlock = pxBlock;
+						( ( BlockHeader_t * ) ( ( ( uint8_t * ) pxNewBlock ) + pxNewBlock->xBlockSize ) )->pxPrevPhysicalBlock = pxNewBlock;
+						pxBlock->xBlockSize = xWantedSize;
+
+						prvInsertFreeBlock( pxNewBlock );
+					}
+					else
+					{
+						mtCOVERAGE_TEST_MARKER();
+					}
+
+					xFreeBytesRemaining -= pxBlock->xBlockSize;
+
+					if( xFreeBytesRemaining < xMinimumEverFreeBytesRemaining )
+					{
+						xMinimumEverFreeBytesRemaining = xFreeBytesRemaining;
+					}
+					else
+					{
+						mtCOVERAGE_TEST_MARKER();
+					}
+
+					/* The block is being returned - it is allocated and owned
+					by the application. */
+					#if( traceMALLOC_FROM_DEFINED == 1 )
+					{
+						xAllocatedBlockSize = pxBlock->xBlockSize;
+					}
+					#endif
+					pxBlock->xBlockSize |= xBlockAllocatedBit;
+					pvReturn = ( void * ) ( ( ( uint8_t * ) pxBlock ) + xHeapStructSize );
+					xNumberOfSuccessfulAllocations++;
+					xClassAllocations[ uxClass ]++;
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+
+			if( pvReturn == NULL )
+			{
+				xClassFailedAllocations[ uxClass ]++;
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+
+		traceMALLOC( pvReturn, xWantedSize );
+		#if( traceMALLOC_FROM_DEFINED == 1 )
+		{
+			traceMALLOC_FROM( pvReturn, xRequestedSize, xAllocatedBlockSize, portGET_CALLER_ADDRESS() );
+		}
+		#endif
+	}
+	( void ) xTaskResumeAll();
+
+	#if( configUSE_MALLOC_FAILED_HOOK == 1 )
+	{
+		if( pvReturn == NULL )
+		{
+			extern void vApplicationMallocFailedHook( void );
+			vApplicationMallocFailedHook();
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+	#endif
+
+	configASSERT( ( ( ( size_t ) pvReturn ) & ( size_t ) portBYTE_ALIGNMENT_MASK ) == 0 );
+	return pvReturn;
+}
+/*-----------------------------------------------------------*/
+
+void vPortFree( void *pv )
+{
+uint8_t *puc = ( uint8_t * ) pv;
+BlockHeader_t *pxBlock, *pxNeighbour;
+UBaseType_t uxFL, uxSL;
+
+	if( pv != NULL )
+	{
+		/* The memory being freed will have a header immediately before it. */
+		puc -= xHeapStructSize;
+
+		/* This casting is to keep the compiler from issuing warnings. */
+		pxBlock = ( void * ) puc;
+
+		/* Check the block is actually allocated. */
+		configASSERT( ( pxBlock->xBlockSize & xBlockAllocatedBit ) != 0 );
+
+		if( ( pxBlock->xBlockSize & xBlockAllocatedBit ) != 0 )
+		{
+			vTaskSuspendAll();
+			{
+				/* The block is being returned to the heap - it is no longer
+				allocated. */
+				pxBlock->xBlockSize &= ~xBlockAllocatedBit;
+				xFreeBytesRemaining += pxBlock->xBlockSize;
+				xNumberOfSuccessfulFrees++;
+				xClassFrees[ prvFirstLevelIndex( pxBlock->xBlockSize ) ]++;
+				traceFREE( pv, pxBlock->xBlockSize );
+
+				/* Combine the block with the block below it if that is
+				free... */
+				pxNeighbour = pxBlock->pxPrevPhysicalBlock;
+				if( ( pxNeighbour != NULL ) && ( ( pxNeighbour->xBlockSize & xBlockAllocatedBit ) == 0 ) )
+				{
+					prvMapping( pxNeighbour->xBlockSize, &uxFL, &uxSL );
+					prvRemoveFreeBlock( pxNeighbour, uxFL, uxSL );
+					pxNeighbour->xBlockSize += pxBlock->xBlockSize;
+					pxBlock = pxNeighbour;
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+
+				/* ...and with the block above it.  pxEnd is always allocated,
+				so this never runs off the end of the heap. */
+				pxNeighbour = ( BlockHeader_t * ) ( ( ( uint8_t * ) pxBlock ) + pxBlock->xBlockSize );
+				if( ( pxNeighbour->xBlockSize & xBlockAllocatedBit ) == 0 )
+				{
+					prvMapping( pxNeighbour->xBlockSize, &uxFL, &uxSL );
+					prvRemoveFreeBlock( pxNeighbour, uxFL, uxSL );
+					pxBlock->xBlockSize += pxNeighbour->xBlockSize;
+					pxNeighbour = ( BlockHeader_t * ) ( ( ( uint8_t * ) pxBlock ) + pxBlock->xBlockSize );
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+				pxNeighbour->pxPrevPhysicalBlock = pxBlock;
+
+				prvInsertFreeBlock( pxBlock );
+			}
+			( void ) xTaskResumeAll();
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetFreeHeapSize( void )
+{
+	return xFreeBytesRemaining;
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetMinimumEverFreeHeapSize( void )
+{
+	return xMinimumEverFreeBytesRemaining;
+}
+/*-----------------------------------------------------------*/
+
+void vPortInitialiseBlocks( void )
+{
+	/* This just exists to keep the linker quiet. */
+}
+/*-----------------------------------------------------------*/
+
+void vPortGetHeapStats( HeapStats_t *pxHeapStats )
+{
+BlockHeader_t *pxBlock;
+size_t xBlocks = 0, xMaxSize = 0, xMinSize = portMAX_DELAY; /* portMAX_DELAY used as a portable way of getting the maximum value. */
+UBaseType_t uxFL, uxSL;
+
+	vTaskSuspendAll();
+	{
+		if( pxEnd == NULL )
+		{
+			prvHeapInit();
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+
+		/* Unlike allocating and freeing, this walks every free block. */
+		for( uxFL = 0; uxFL < heapFL_INDEX_COUNT; uxFL++ )
+		{
+			for( uxSL = 0; uxSL < heapSL_INDEX_COUNT; uxSL++ )
+			{
+				for( pxBlock = pxFreeLists[ uxFL ][ uxSL ]; pxBlock != NULL; pxBlock = pxBlock->pxNextFreeBlock )
+				{
+					xBlocks++;
+
+					if( pxBlock->xBlockSize > xMaxSize )
+					{
+						xMaxSize = pxBlock->xBlockSize;
+					}
+
+					if( pxBlock->xBlockSize < xMinSize )
+					{
+						xMinSize = pxBlock->xBlockSize;
+					}
+				}
+			}
+		}
+
+		pxHeapStats->xSizeOfLargestFreeBlockInBytes = xMaxSize;
+		pxHeapStats->xSizeOfSmallestFreeBlockInBytes = xMinSize;
+		pxHeapStats->xNumberOfFreeBlocks = xBlocks;
+		pxHeapStats->xAvailableHeapSpaceInBytes = xFreeBytesRemaining;
+		pxHeapStats->xNumberOfSuccessfulAllocations = xNumberOfSuccessfulAllocations;
+		pxHeapStats->xNumberOfSuccessfulFrees = xNumberOfSuccessfulFrees;
+		pxHeapStats->xMinimumEverFreeBytesRemaining = xMinimumEverFreeBytesRemaining;
+	}
+	( void ) xTaskResumeAll();
+}
+/*-----------------------------------------------------------*/
+
+UBaseType_t uxPortGetHeapClassStats( HeapClassStats_t *pxClassStats, UBaseType_t uxMaxClasses )
+{
+BlockHeader_t *pxBlock;
+HeapClassStats_t *pxStats;
+UBaseType_t uxFL, uxSL;
+
+	vTaskSuspendAll();
+	{
+		if( pxEnd == NULL )
+		{
+			prvHeapInit();
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+
+		for( uxFL = 0; ( uxFL < heapFL_INDEX_COUNT ) && ( uxFL < uxMaxClasses ); uxFL++ )
+		{
+			pxStats = &( pxClassStats[ uxFL ] );
+
+			if( uxFL == 0 )
+			{
+				pxStats->xMinimumBlockSizeInBytes = xMinimumBlockSize;
+			}
+			else
+			{
+				pxStats->xMinimumBlockSizeInBytes = ( size_t ) 1 << ( heapFL_INDEX_SHIFT + uxFL - 1U );
+			}
+
+			pxStats->xNumberOfFreeBlocks = 0;
+			pxStats->xFreeBytes = 0;
+			for( uxSL = 0; uxSL < heapSL_INDEX_COUNT; uxSL++ )
+			{
+				for( pxBlock = pxFreeLists[ uxFL ][ uxSL ]; pxBlock != NULL; pxBlock = pxBlock->pxNextFreeBlock )
+				{
+					pxStats->xNumberOfFreeBlocks++;
+					pxStats->xFreeBytes += pxBlock->xBlockSize;
+				}
+			}
+
+			pxStats->xNumberOfSuccessfulAllocations = xClassAllocations[ uxFL ];
+			pxStats->xNumberOfFailedAllocations = xClassFailedAllocations[ uxFL ];
+			pxStats->xNumberOfSuccessfulFrees = xClassFrees[ uxFL ];
+		}
+	}
+	( void ) xTaskResumeAll();
+
+	return ( UBaseType_t ) heapFL_INDEX_COUNT;
+}
+/*-----------------------------------------------------------*/
+
+static void prvHeapInit( void )
+{
+BlockHeader_t *pxFirstFreeBlock;
+uint8_t *pucAlignedHeap;
+size_t uxAddress;
+size_t xTotalHeapSize = configTOTAL_HEAP_SIZE;
+
+	/* Work out the position of the top bit in a size_t variable. */
+	xBlockAllocatedBit = ( ( size_t ) 1 ) << ( ( sizeof( size_t ) * heapBITS_PER_BYTE ) - 1 );
+
+	/* Ensure the heap starts on a correctly aligned boundary. */
+	uxAddress = ( size_t ) ucHeap;
+
+	if( ( uxAddress & portBYTE_ALIGNMENT_MASK ) != 0 )
+	{
+		uxAddress += ( portBYTE_ALIGNMENT - 1 );
+		uxAddress &= ~( ( size_t ) portBYTE_ALIGNMENT_MASK );
+		xTotalHeapSize -= uxAddress - ( size_t ) ucHeap;
+	}
+
+	pucAlignedHeap = ( uint8_t * ) uxAddress;
+
+	/* pxEnd is used to mark the end of the heap, and is inserted at the end
+	of the heap space. */
+	uxAddress = ( ( size_t ) pucAlignedHeap ) + xTotalHeapSize;
+	uxAddress -= xHeapStructSize;
+	uxAddress &= ~( ( size_t ) portBYTE_ALIGNMENT_MASK );
+	pxEnd = ( void * ) uxAddress;
+	pxEnd->xBlockSize = xBlockAllocatedBit;
+
+	/* To start with there is a single free block that is sized to take up the
+	entire heap space, minus the space taken by pxEnd. */
+	pxFirstFreeBlock = ( void * ) pucAlignedHeap;
+	pxFirstFreeBlock->pxPrevPhysicalBlock = NULL;
+	pxFirstFreeBlock->xBlockSize = uxAddress - ( size_t ) pxFirstFreeBlock;
+	pxEnd->pxPrevPhysicalBlock = pxFirstFreeBlock;
+	prvInsertFreeBlock( pxFirstFreeBlock );
+
+	/* Only one block exists - and it covers the entire usable heap space. */
+	xMinimumEverFreeBytesRemaining = pxFirstFreeBlock->xBlockSize;
+	xFreeBytesRemaining = pxFirstFreeBlock->xBlockSize;
+
+	traceHEAP_INIT( pucAlignedHeap, xTotalHeapSize, xHeapStructSize );
+}
+/*-----------------------------------------------------------*/
+
+static void prvMapping( size_t xBlockSize, UBaseType_t *puxFL, UBaseType_t *puxSL )
+{
+UBaseType_t uxBit;
+
+	if( xBlockSize < heapSMALL_BLOCK_SIZE )
+	{
+		*puxFL = 0;
+		*puxSL = ( UBaseType_t ) ( xBlockSize >> heapALIGNMENT_BITS );
+	}
+	else
+	{
+		/* The second level is the heapSL_INDEX_BITS bits below the top set
+		bit. */
+		uxBit = prvFindLastSet( xBlockSize );
+		*puxFL = uxBit - heapFL_INDEX_SHIFT + 1U;
+		*puxSL = ( UBaseType_t ) ( xBlockSize >> ( uxBit - heapSL_INDEX_BITS ) ) ^ heapSL_INDEX_COUNT;
+	}
+}
+/*-----------------------------------------------------------*/
+
+static UBaseType_t prvFirstLevelIndex( size_t xBlockSize )
+{
+UBaseType_t uxFL, uxSL;
+
+	prvMapping( xBlockSize, &uxFL, &uxSL );
+
+	/* Requests bigger than the heap are counted against the largest class. */
+	if( uxFL >= heapFL_INDEX_COUNT )
+	{
+		uxFL = heapFL_INDEX_COUNT - 1U;
+	}
+
+	return uxFL;
+}
+/*-----------------------------------------------------------*/
+
+static BlockHeader_t *prvFindFreeBlock( size_t xWantedSize, UBaseType_t *puxFL, UBaseType_t *puxSL )
+{
+BlockHeader_t *pxBlock = NULL;
+size_t xSearchSize = xWantedSize;
+uint32_t ulBitmap = 0U;
+UBaseType_t uxFL, uxSL;
+
+	/* Round the size up to the next class boundary, so that every block in
+	the class found is large enough and the first one can be taken. */
+	if( xSearchSize >= heapSMALL_BLOCK_SIZE )
+	{
+		xSearchSize += ( ( size_t ) 1 << ( prvFindLastSet( xSearchSize ) - heapSL_INDEX_BITS ) ) - 1U;
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	prvMapping( xSearchSize, &uxFL, &uxSL );
+
+	if( uxFL < heapFL_INDEX_COUNT )
+	{
+		/* A non empty list at or above the second level class... */
+		ulBitmap = ulSecondLevelBitmaps[ uxFL ] & ( ~( uint32_t ) 0U << uxSL );
+
+		if( ulBitmap == 0U )
+		{
+			/* ...or failing that, the smallest list of a larger first level
+			class. */
+			ulBitmap = ulFirstLevelBitmap & ( ~( uint32_t ) 0U << ( uxFL + 1U ) );
+
+			if( ulBitmap != 0U )
+			{
+				uxFL = prvFindFirstSet( ulBitmap );
+				ulBitmap = ulSecondLevelBitmaps[ uxFL ];
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+
+		if( ulBitmap != 0U )
+		{
+			uxSL = prvFindFirstSet( ulBitmap );
+			pxBlock = pxFreeLists[ uxFL ][ uxSL ];
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	if( pxBlock == NULL )
+	{
+		/* No class above the wanted size's own has a free block, but the
+		block at the head of its own class list might still be large enough.
+		Checking just that one keeps the search bounded. */
+		prvMapping( xWantedSize, &uxFL, &uxSL );
+
+		if( uxFL < heapFL_INDEX_COUNT )
+		{
+			pxBlock = pxFreeLists[ uxFL ][ uxSL ];
+
+			if( ( pxBlock != NULL ) && ( pxBlock->xBlockSize < xWantedSize ) )
+			{
+				pxBlock = NULL;
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	*puxFL = uxFL;
+	*puxSL = uxSL;
+	return pxBlock;
+}
+/*-----------------------------------------------------------*/
+
+static void prvInsertFreeBlock( BlockHeader_t *pxBlock )
+{
+UBaseType_t uxFL, uxSL;
+
+	prvMapping( pxBlock->xBlockSize, &uxFL, &uxSL );
+	configASSERT( uxFL < heapFL_INDEX_COUNT );
+
+	pxBlock->pxPrevFreeBlock = NULL;
+	pxBlock->pxNextFreeBlock = pxFreeLists[ uxFL ][ uxSL ];
+
+	if( pxBlock->pxNextFreeBlock != NULL )
+	{
+		pxBlock->pxNextFreeBlock->pxPrevFreeBlock = pxBlock;
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	pxFreeLists[ uxFL ][ uxSL ] = pxBlock;
+	ulFirstLevelBitmap |= ( uint32_t ) 1U << uxFL;
+	ulSecondLevelBitmaps[ uxFL ] |= ( uint32_t ) 1U << uxSL;
+}
+/*-----------------------------------------------------------*/
+
+static void prvRemoveFreeBlock( BlockHeader_t *pxBlock, UBaseType_t uxFL, UBaseType_t uxSL )
+{
+	if( pxBlock->pxNextFreeBlock != NULL )
+	{
+		pxBlock->pxNextFreeBlock->pxPrevFreeBlock = pxBlock->pxPrevFreeBlock;
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	if( pxBlock->pxPrevFreeBlock != NULL )
+	{
+		pxBlock->pxPrevFreeBlock->pxNextFreeBlock = pxBlock->pxNextFreeBlock;
+	}
+	else
+	{
+		/* The block was at the head of its list, which may now be empty. */
+		pxFreeLists[ uxFL ][ uxSL ] = pxBlock->pxNextFreeBlock;
+
+		if( pxBlock->pxNextFreeBlock == NULL )
+		{
+			ulSecondLevelBitmaps[ uxFL ] &= ~( ( uint32_t ) 1U << uxSL );
+
+			if( ulSecondLevelBitmaps[ uxFL ] == 0U )
+			{
+				ulFirstLevelBitmap &= ~( ( uint32_t ) 1U << uxFL );
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+static UBaseType_t prvFindLastSet( size_t xValue )
+{
+	#if defined( __GNUC__ )
+	{
+		return ( UBaseType_t ) ( ( sizeof( unsigned long ) * heapBITS_PER_BYTE ) - 1U - ( size_t ) __builtin_clzl( ( unsigned long ) xValue ) );
+	}
+	#else
+	{
+	UBaseType_t uxBit = 0;
+	size_t xShift;
+
+		/* A fixed number of halving steps, so still constant time. */
+		for( xShift = ( sizeof( size_t ) * heapBITS_PER_BYTE ) / 2U; xShift > 0U; xShift /= 2U )
+		{
+			if( ( xValue >> xShift ) != 0U )
+			{
+				xValue >>= xShift;
+				uxBit += ( UBaseType_t ) xShift;
+			}
+		}
+
+		return uxBit;
+	}
+	#endif
+}
+/*-----------------------------------------------------------*/
+
+static UBaseType_t prvFindFirstSet( uint32_t ulValue )
+{
+	#if defined( __GNUC__ )
+	{
+		return ( UBaseType_t ) __builtin_ctz( ulValue );
+	}
+	#else
+	{
+		/* Isolate the lowest set bit. */
+		return prvFindLastSet( ( size_t ) ( ulValue & ( ~ulValue + 1U ) ) );
+	}
+	#endif
+}
@@ -202,6 +202,24 @@ static size_t prvReadBytesFromBuffer( StreamBuffer_t *pxStreamBuffer,
 									  size_t xMaxCount,
 									  size_t xBytesAvailable ) PRIVILEGED_FUNCTION;
 
+/*
+ * Describe the xCount bytes of the storage area that start at index xIndex as
+ * one or two contiguous spans (two if the region wraps past the end of the
+ * storage area).  Used by the zero copy reserve and peek functions.
+ */
+static void prvGetSpans( const StreamBuffer_t * const pxStreamBuffer,
+						 size_t xIndex,
+						 size_t xCount,
+						 StreamBufferSpans_t * const pxSpans ) PRIVILEGED_FUNCTION;
+
+/*
+ * Returns xIndex moved forward by xCount bytes, wrapping back to the start of
+ * the storage area if necessary.  Used to move both the head and the tail.
+ */
+static size_t prvAdvanceIndex( const StreamBuffer_t * const pxStreamBuffer,
+							   size_t xIndex,
+							   size_t xCount ) PRIVILEGED_FUNCTION;
+
 /*
  * Called by both pxStreamBufferCreate() and pxStreamBufferCreateStatic() to
  * initialise the members of the newly created stream buffer structure.
@@ -1085,6 +1103,297 @@ UBaseType_t uxSavedInterruptStatus;
 }
 /*-----------------------------------------------------------*/
 
+size_t xStreamBufferReserve( StreamBufferHandle_t xStreamBuffer,
+							 StreamBufferSpans_t *pxSpans,
+							 size_t xMaxLengthBytes,
+							 TickType_t xTicksToWait )
+{
+StreamBuffer_t * const pxStreamBuffer = xStreamBuffer;
+size_t xSpace = 0, xRequiredSpace, xCount;
+TimeOut_t xTimeOut;
+
+	configASSERT( pxStreamBuffer );
+	configASSERT( pxSpans );
+
+	/* Direct access would bypass the length bytes that prefix each message
+	held in a message buffer. */
+	configASSERT( ( pxStreamBuffer->ucFlags & sbFLAGS_IS_MESSAGE_BUFFER ) == ( uint8_t ) 0 );
+
+	/* Never wait for more space than the stream buffer can ever provide. */
+	xRequiredSpace = configMIN( xMaxLengthBytes, pxStreamBuffer->xLength - ( size_t ) 1 );
+
+	/* Only enter the critical section needed to block if there isn't already
+	enough space.  The reader can only ever increase the space, so a stale
+	value here errs on the side of blocking, which is then re-checked. */
+	if( ( xTicksToWait != ( TickType_t ) 0 ) && ( xStreamBufferSpacesAvailable( pxStreamBuffer ) < xRequiredSpace ) )
+	{
+		vTaskSetTimeOutState( &xTimeOut );
+
+		do
+		{
+			/* Wait until the required number of bytes are free in the stream
+			buffer. */
+			taskENTER_CRITICAL();
+			{
+				xSpace = xStreamBufferSpacesAvailable( pxStreamBuffer );
+
+				if( xSpace < xRequiredSpace )
+				{
+					/* Clear notification state as going to wait for space. */
+					( void ) xTaskNotifyStateClear( NULL );
+
+					/* Should only be one writer. */
+					configASSERT( pxStreamBuffer->xTaskWaitingToSend == NULL );
+					pxStreamBuffer->xTaskWaitingToSend = xTaskGetCurrentTaskHandle();
+				}
+				else
+				{
+					taskEXIT_CRITICAL();
+					break;
+				}
+			}
+			taskEXIT_CRITICAL();
+
+			traceBLOCKING_ON_STREAM_BUFFER_SEND( xStreamBuffer );
+			( void ) xTaskNotifyWait( ( uint32_t ) 0, ( uint32_t ) 0, NULL, xTicksToWait );
+			pxStreamBuffer->xTaskWaitingToSend = NULL;
+
+		} while( xTaskCheckForTimeOut( &xTimeOut, &xTicksToWait ) == pdFALSE );
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	/* Only the writer moves the head, so the space found here can only grow
+	(as the reader frees space) until it is committed. */
+	xSpace = xStreamBufferSpacesAvailable( pxStreamBuffer );
+	xCount = configMIN( xSpace, xMaxLengthBytes );
+	prvGetSpans( pxStreamBuffer, pxStreamBuffer->xHead, xCount, pxSpans );
+
+	return xCount;
+}
+/*-----------------------------------------------------------*/
+
+size_t xStreamBufferReserveFromISR( StreamBufferHandle_t xStreamBuffer,
+									StreamBufferSpans_t *pxSpans,
+									size_t xMaxLengthBytes )
+{
+StreamBuffer_t * const pxStreamBuffer = xStreamBuffer;
+size_t xCount;
+
+	configASSERT( pxStreamBuffer );
+	configASSERT( pxSpans );
+	configASSERT( ( pxStreamBuffer->ucFlags & sbFLAGS_IS_MESSAGE_BUFFER ) == ( uint8_t ) 0 );
+
+	xCount = configMIN( xStreamBufferSpacesAvailable( pxStreamBuffer ), xMaxLengthBytes );
+	prvGetSpans( pxStreamBuffer, pxStreamBuffer->xHead, xCount, pxSpans );
+
+	return xCount;
+}
+/*-----------------------------------------------------------*/
+
+size_t xStreamBufferCommit( StreamBufferHandle_t xStreamBuffer, size_t xLengthBytes )
+{
+StreamBuffer_t * const pxStreamBuffer = xStreamBuffer;
+
+	configASSERT( pxStreamBuffer );
+	configASSERT( xLengthBytes <= xStreamBufferSpacesAvailable( pxStreamBuffer ) );
+
+	if( xLengthBytes > ( size_t ) 0 )
+	{
+		pxStreamBuffer->xHead = prvAdvanceIndex( pxStreamBuffer, pxStreamBuffer->xHead, xLengthBytes );
+		traceSTREAM_BUFFER_SEND( xStreamBuffer, xLengthBytes );
+
+		/* Was a task waiting for the data? */
+		if( prvBytesInBuffer( pxStreamBuffer ) >= pxStreamBuffer->xTriggerLevelBytes )
+		{
+			sbSEND_COMPLETED( pxStreamBuffer );
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	return xLengthBytes;
+}
+/*-----------------------------------------------------------*/
+
+size_t xStreamBufferCommitFromISR( StreamBufferHandle_t xStreamBuffer,
+								   size_t xLengthBytes,
+								   BaseType_t * const pxHigherPriorityTaskWoken )
+{
+StreamBuffer_t * const pxStreamBuffer = xStreamBuffer;
+
+	configASSERT( pxStreamBuffer );
+	configASSERT( xLengthBytes <= xStreamBufferSpacesAvailable( pxStreamBuffer ) );
+
+	if( xLengthBytes > ( size_t ) 0 )
+	{
+		pxStreamBuffer->xHead = prvAdvanceIndex( pxStreamBuffer, pxStreamBuffer->xHead, xLengthBytes );
+
+		/* Was a task waiting for the data? */
+		if( prvBytesInBuffer( pxStreamBuffer ) >= pxStreamBuffer->xTriggerLevelBytes )
+		{
+			sbSEND_COMPLETE_FROM_ISR( pxStreamBuffer, pxHigherPriorityTaskWoken );
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	traceSTREAM_BUFFER_SEND_FROM_ISR( xStreamBuffer, xLengthBytes );
+
+	return xLengthBytes;
+}
+/*-----------------------------------------------------------*/
+
+size_t xStreamBufferPeek( StreamBufferHandle_t xStreamBuffer,
+						  StreamBufferSpans_t *pxSpans,
+						  size_t xMaxLengthBytes,
+						  TickType_t xTicksToWait )
+{
+StreamBuffer_t * const pxStreamBuffer = xStreamBuffer;
+size_t xBytesAvailable, xCount;
+
+	configASSERT( pxStreamBuffer );
+	configASSERT( pxSpans );
+	configASSERT( ( pxStreamBuffer->ucFlags & sbFLAGS_IS_MESSAGE_BUFFER ) == ( uint8_t ) 0 );
+
+	/* As in xStreamBufferReserve(), the critical section is only needed if
+	the calling task may have to block. */
+	xBytesAvailable = prvBytesInBuffer( pxStreamBuffer );
+
+	if( ( xTicksToWait != ( TickType_t ) 0 ) && ( xBytesAvailable == ( size_t ) 0 ) )
+	{
+		/* Checking if there is data and clearing the notification state must be
+		performed atomically. */
+		taskENTER_CRITICAL();
+		{
+			xBytesAvailable = prvBytesInBuffer( pxStreamBuffer );
+
+			if( xBytesAvailable == ( size_t ) 0 )
+			{
+				/* Clear notification state as going to wait for data. */
+				( void ) xTaskNotifyStateClear( NULL );
+
+				/* Should only be one reader. */
+				configASSERT( pxStreamBuffer->xTaskWaitingToReceive == NULL );
+				pxStreamBuffer->xTaskWaitingToReceive = xTaskGetCurrentTaskHandle();
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+		taskEXIT_CRITICAL();
+
+		if( xBytesAvailable == ( size_t ) 0 )
+		{
+			/* Wait for data to be available. */
+			traceBLOCKING_ON_STREAM_BUFFER_RECEIVE( xStreamBuffer );
+			( void ) xTaskNotifyWait( ( uint32_t ) 0, ( uint32_t ) 0, NULL, xTicksToWait );
+			pxStreamBuffer->xTaskWaitingToReceive = NULL;
+
+			/* Recheck the data available after blocking. */
+			xBytesAvailable = prvBytesInBuffer( pxStreamBuffer );
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	xCount = configMIN( xBytesAvailable, xMaxLengthBytes );
+	prvGetSpans( pxStreamBuffer, pxStreamBuffer->xTail, xCount, pxSpans );
+
+	return xCount;
+}
+/*-----------------------------------------------------------*/
+
+size_t xStreamBufferPeekFromISR( StreamBufferHandle_t xStreamBuffer,
+								 StreamBufferSpans_t *pxSpans,
+								 size_t xMaxLengthBytes )
+{
+StreamBuffer_t * const pxStreamBuffer = xStreamBuffer;
+size_t xCount;
+
+	configASSERT( pxStreamBuffer );
+	configASSERT( pxSpans );
+	configASSERT( ( pxStreamBuffer->ucFlags & sbFLAGS_IS_MESSAGE_BUFFER ) == ( uint8_t ) 0 );
+
+	xCount = configMIN( prvBytesInBuffer( pxStreamBuffer ), xMaxLengthBytes );
+	prvGetSpans( pxStreamBuffer, pxStreamBuffer->xTail, xCount, pxSpans );
+
+	return xCount;
+}
+/*-----------------------------------------------------------*/
+
+size_t xStreamBufferConsume( StreamBufferHandle_t xStreamBuffer, size_t xLengthBytes )
+{
+StreamBuffer_t * const pxStreamBuffer = xStreamBuffer;
+
+	configASSERT( pxStreamBuffer );
+	configASSERT( xLengthBytes <= prvBytesInBuffer( pxStreamBuffer ) );
+
+	if( xLengthBytes > ( size_t ) 0 )
+	{
+		pxStreamBuffer->xTail = prvAdvanceIndex( pxStreamBuffer, pxStreamBuffer->xTail, xLengthBytes );
+		traceSTREAM_BUFFER_RECEIVE( xStreamBuffer, xLengthBytes );
+
+		/* Was a task waiting for space in the buffer? */
+		sbRECEIVE_COMPLETED( pxStreamBuffer );
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	return xLengthBytes;
+}
+/*-----------------------------------------------------------*/
+
+size_t xStreamBufferConsumeFromISR( StreamBufferHandle_t xStreamBuffer,
+									size_t xLengthBytes,
+									BaseType_t * const pxHigherPriorityTaskWoken )
+{
+StreamBuffer_t * const pxStreamBuffer = xStreamBuffer;
+
+	configASSERT( pxStreamBuffer );
+	configASSERT( xLengthBytes <= prvBytesInBuffer( pxStreamBuffer ) );
+
+	if( xLengthBytes > ( size_t ) 0 )
+	{
+		pxStreamBuffer->xTail = prvAdvanceIndex( pxStreamBuffer, pxStreamBuffer->xTail, xLengthBytes );
+
+		/* Was a task waiting for space in the buffer? */
+		sbRECEIVE_COMPLETED_FROM_ISR( pxStreamBuffer, pxHigherPriorityTaskWoken );
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	traceSTREAM_BUFFER_RECEIVE_FROM_ISR( xStreamBuffer, xLengthBytes );
+
+	return xLengthBytes;
+}
+/*-----------------------------------------------------------*/
+
 static size_t prvWriteBytesToBuffer( StreamBuffer_t * const pxStreamBuffer, const uint8_t *pucData, size_t xCount )
 {
 size_t xNextHead, xFirstLength;
@@ -1115,17 +1424,7 @@ size_t xNextHead, xFirstLength;
 		mtCOVERAGE_TEST_MARKER();
 	}
 
-	xNextHead += xCount;
-	if( xNextHead >= pxStreamBuffer->xLength )
-	{
-		xNextHead -= pxStreamBuffer->xLength;
-	}
-	else
-	{
-		mtCOVERAGE_TEST_MARKER();
-	}
-
-	pxStreamBuffer->xHead = xNextHead;
+	pxStreamBuffer->xHead = prvAdvanceIndex( pxStreamBuffer, xNextHead, xCount );
 
 	return xCount;
 }
@@ -1168,21 +1467,60 @@ size_t xCount, xFirstLength, xNextTail;
 
 		/* Move the tail pointer to effectively remove the data read from
 		the buffer. */
-		xNextTail += xCount;
+		pxStreamBuffer->xTail = prvAdvanceIndex( pxStreamBuffer, xNextTail, xCount );
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
 
-		if( xNextTail >= pxStreamBuffer->xLength )
-		{
-			xNextTail -= pxStreamBuffer->xLength;
-		}
+	return xCount;
+}
+/*-----------------------------------------------------------*/
+
+static size_t prvAdvanceIndex( const StreamBuffer_t * const pxStreamBuffer,
+							   size_t xIndex,
+							   size_t xCount )
+{
+	xIndex += xCount;
 
-		pxStreamBuffer->xTail = xNextTail;
+	if( xIndex >= pxStreamBuffer->xLength )
+	{
+		xIndex -= pxStreamBuffer->xLength;
 	}
 	else
 	{
 		mtCOVERAGE_TEST_MARKER();
 	}
 
-	return xCount;
+	return xIndex;
+}
+/*-----------------------------------------------------------*/
+
+static void prvGetSpans( const StreamBuffer_t * const pxStreamBuffer,
+						 size_t xIndex,
+						 size_t xCount,
+						 StreamBufferSpans_t * const pxSpans )
+{
+size_t xFirstLength;
+
+	/* The first span runs from xIndex up to, at most, the end of the storage
+	area.  Anything left over wraps back to the start. */
+	xFirstLength = configMIN( pxStreamBuffer->xLength - xIndex, xCount );
+
+	pxSpans->pucFirst = &( pxStreamBuffer->pucBuffer[ xIndex ] );
+	pxSpans->xFirstLength = xFirstLength;
+
+	if( xCount > xFirstLength )
+	{
+		pxSpans->pucSecond = pxStreamBuffer->pucBuffer;
+		pxSpans->xSecondLength = xCount - xFirstLength;
+	}
+	else
+	{
+		pxSpans->pucSecond = NULL;
+		pxSpans->xSecondLength = 0;
+	}
 }
 /*-----------------------------------------------------------*/
 
@@ -112,7 +112,60 @@ configIDLE_TASK_NAME in FreeRTOSConfig.h. */
 	#define configIDLE_TASK_NAME "IDLE"
 #endif
 
-#if ( configUSE_PORT_OPTIMISED_TASK_SELECTION == 0 )
+#if ( configUSE_BITMAP_TASK_SELECTION == 1 )
+
+	/* If configUSE_BITMAP_TASK_SELECTION is 1 then the port optimised selection
+	macros are provided here in portable C, using the compiler's count leading
+	zeros builtin.  Bit n is set while pxReadyTasksLists[ n ] is not empty.  Up
+	to 32 priorities uxTopReadyPriority holds the bitmap directly, as it does for
+	a port optimised port.  Above that each 32 priorities get a word of
+	ulReadyPriorityGroups[], and bit g of uxTopReadyPriority is set while group
+	g has any bit set, so finding the highest priority takes two lookups however
+	many priorities there are. */
+	#undef portRECORD_READY_PRIORITY
+	#undef portRESET_READY_PRIORITY
+	#undef portGET_HIGHEST_PRIORITY
+
+	#if ( configMAX_PRIORITIES <= 32 )
+
+		#define portRECORD_READY_PRIORITY( uxPriority, uxReadyPriorities ) ( uxReadyPriorities ) |= ( 1UL << ( uxPriority ) )
+		#define portRESET_READY_PRIORITY( uxPriority, uxReadyPriorities ) ( uxReadyPriorities ) &= ~( 1UL << ( uxPriority ) )
+		#define portGET_HIGHEST_PRIORITY( uxTopPriority, uxReadyPriorities ) uxTopPriority = ( 31UL - portCOUNT_LEADING_ZEROS( ( uxReadyPriorities ) ) )
+
+	#else
+
+		#define taskPRIORITY_GROUP( uxPriority )	( ( uxPriority ) >> 5UL )
+		#define taskPRIORITY_BIT( uxPriority )		( 1UL << ( ( uxPriority ) & 31UL ) )
+
+		#define portRECORD_READY_PRIORITY( uxPriority, uxReadyGroups )							\
+		{																						\
+			ulReadyPriorityGroups[ taskPRIORITY_GROUP( uxPriority ) ] |= taskPRIORITY_BIT( uxPriority );	\
+			( uxReadyGroups ) |= ( 1UL << taskPRIORITY_GROUP( uxPriority ) );					\
+		}
+
+		#define portRESET_READY_PRIORITY( uxPriority, uxReadyGroups )							\
+		{																						\
+			ulReadyPriorityGroups[ taskPRIORITY_GROUP( uxPriority ) ] &= ~taskPRIORITY_BIT( uxPriority );	\
+			if( ulReadyPriorityGroups[ taskPRIORITY_GROUP( uxPriority ) ] == 0UL )				\
+			{																					\
+				( uxReadyGroups ) &= ~( 1UL << taskPRIORITY_GROUP( uxPriority ) );				\
+			}																					\
+		}
+
+		#define portGET_HIGHEST_PRIORITY( uxTopPriority, uxReadyGroups )						\
+		{																						\
+		UBaseType_t uxGroup = 31UL - portCOUNT_LEADING_ZEROS( ( uxReadyGroups ) );				\
+																								\
+			uxTopPriority = ( uxGroup << 5UL ) + ( 31UL - portCOUNT_LEADING_ZEROS( ulReadyPriorityGroups[ uxGroup ] ) );	\
+		}
+
+	#endif /* configMAX_PRIORITIES */
+
+#endif /* configUSE_BITMAP_TASK_SELECTION */
+
+/*-----------------------------------------------------------*/
+
+#if ( ( configUSE_PORT_OPTIMISED_TASK_SELECTION == 0 ) && ( configUSE_BITMAP_TASK_SELECTION == 0 ) )
 
 	/* If configUSE_PORT_OPTIMISED_TASK_SELECTION is 0 then task selection is
 	performed in a generic way that is not optimised to any particular
@@ -159,7 +212,8 @@ configIDLE_TASK_NAME in FreeRTOSConfig.h. */
 
 	/* If configUSE_PORT_OPTIMISED_TASK_SELECTION is 1 then task selection is
 	performed in a way that is tailored to the particular microcontroller
-	architecture being used. */
+	architecture being used.  configUSE_BITMAP_TASK_SELECTION uses the same
+	path with the generic bitmap macros defined above. */
 
 	/* A port optimised version is provided.  Call the port defined macros. */
 	#define taskRECORD_READY_PRIORITY( uxPriority )	portRECORD_READY_PRIORITY( uxPriority, uxTopReadyPriority )
@@ -193,21 +247,43 @@ configIDLE_TASK_NAME in FreeRTOSConfig.h. */
 
 /*-----------------------------------------------------------*/
 
-/* pxDelayedTaskList and pxOverflowDelayedTaskList are switched when the tick
-count overflows. */
-#define taskSWITCH_DELAYED_LISTS()																	\
-{																									\
-	List_t *pxTemp;																					\
-																									\
-	/* The delayed tasks list should be empty when the lists are switched. */						\
-	configASSERT( ( listLIST_IS_EMPTY( pxDelayedTaskList ) ) );										\
-																									\
-	pxTemp = pxDelayedTaskList;																		\
-	pxDelayedTaskList = pxOverflowDelayedTaskList;													\
-	pxOverflowDelayedTaskList = pxTemp;																\
-	xNumOfOverflows++;																				\
-	prvResetNextTaskUnblockTime();																	\
-}
+#if ( configUSE_DELAYED_TASK_WHEEL == 0 )
+
+	/* pxDelayedTaskList and pxOverflowDelayedTaskList are switched when the tick
+	count overflows. */
+	#define taskSWITCH_DELAYED_LISTS()																	\
+	{																									\
+		List_t *pxTemp;																					\
+																										\
+		/* The delayed tasks list should be empty when the lists are switched. */						\
+		configASSERT( ( listLIST_IS_EMPTY( pxDelayedTaskList ) ) );										\
+																										\
+		pxTemp = pxDelayedTaskList;																		\
+		pxDelayedTaskList = pxOverflowDelayedTaskList;													\
+		pxOverflowDelayedTaskList = pxTemp;																\
+		xNumOfOverflows++;																				\
+		prvResetNextTaskUnblockTime();																	\
+	}
+
+#else /* configUSE_DELAYED_TASK_WHEEL */
+
+	/* The delayed task wheel is laid out the same as the timer wheel in
+	timers.c, 32 slots per level, one bit each in the level's occupancy
+	bitmap. */
+	#define taskWHEEL_SLOT_BITS			( 5U )
+	#define taskWHEEL_SLOTS				( 1U << taskWHEEL_SLOT_BITS )
+	#define taskWHEEL_SLOT_MASK			( ( TickType_t ) taskWHEEL_SLOTS - 1U )
+	#define taskWHEEL_SHIFT( uxLevel )	( ( uxLevel ) * taskWHEEL_SLOT_BITS )
+	#define taskWHEEL_MAX_DELTA			( ( TickType_t ) ( ( 1UL << taskWHEEL_SHIFT( configDELAYED_TASK_WHEEL_LEVELS ) ) - 1UL ) )
+
+	/* Ticks are compared by how far they are past xDelayedTaskWheelTime, so
+	the tick count overflowing needs no special handling. */
+	#define taskWHEEL_TICKS_AHEAD( xTime )	( ( TickType_t ) ( ( xTime ) - xDelayedTaskWheelTime ) )
+
+	/* Whether pxList is one of the delayed task wheel's slots. */
+	#define taskIS_DELAYED_TASK_LIST( pxList ) ( ( ( pxList ) >= &( xDelayedTaskWheel[ 0 ][ 0 ] ) ) && ( ( pxList ) <= &( xDelayedTaskWheel[ configDELAYED_TASK_WHEEL_LEVELS - 1 ][ taskWHEEL_SLOTS - 1U ] ) ) )
+
+#endif /* configUSE_DELAYED_TASK_WHEEL */
 
 /*-----------------------------------------------------------*/
 
@@ -349,10 +425,23 @@ xDelayedTaskList1 and xDelayedTaskList2 could be move to function scople but
 doing so breaks some kernel aware debuggers and debuggers that rely on removing
 the static qualifier. */
 PRIVILEGED_DATA static List_t pxReadyTasksLists[ configMAX_PRIORITIES ];/*< Prioritised ready tasks. */
+#if( configUSE_DELAYED_TASK_WHEEL == 0 )
 PRIVILEGED_DATA static List_t xDelayedTaskList1;						/*< Delayed tasks. */
 PRIVILEGED_DATA static List_t xDelayedTaskList2;						/*< Delayed tasks (two lists are used - one for delays that have overflowed the current tick count. */
 PRIVILEGED_DATA static List_t * volatile pxDelayedTaskList;				/*< Points to the delayed task list currently being used. */
 PRIVILEGED_DATA static List_t * volatile pxOverflowDelayedTaskList;		/*< Points to the delayed task list currently being used to hold tasks that have overflowed the current tick count. */
+#else
+/* Delayed tasks, by wake time.  Slot n of level 0 holds the tasks due in the
+next 32 ticks on a tick that is n modulo 32, slot n of level k the tasks due in
+a span of 32^k ticks, which are moved to the levels below (cascaded) when the
+tick reaches the start of the span.  Every task due on or before
+xDelayedTaskWheelTime has been unblocked.  A slot's occupancy bit is set while
+it may hold tasks - a task removed from the Blocked state early can leave it
+set, it is cleared when the slot is next looked at. */
+PRIVILEGED_DATA static List_t xDelayedTaskWheel[ configDELAYED_TASK_WHEEL_LEVELS ][ taskWHEEL_SLOTS ];
+PRIVILEGED_DATA static uint32_t ulDelayedTaskWheelOccupied[ configDELAYED_TASK_WHEEL_LEVELS ];
+PRIVILEGED_DATA static TickType_t xDelayedTaskWheelTime = ( TickType_t ) configINITIAL_TICK_COUNT;
+#endif
 PRIVILEGED_DATA static List_t xPendingReadyList;						/*< Tasks that have been readied while the scheduler was suspended.  They will be moved to the ready list when the scheduler is resumed. */
 
 #if( INCLUDE_vTaskDelete == 1 )
@@ -378,6 +467,11 @@ the errno of the currently running task. */
 PRIVILEGED_DATA static volatile UBaseType_t uxCurrentNumberOfTasks 	= ( UBaseType_t ) 0U;
 PRIVILEGED_DATA static volatile TickType_t xTickCount 				= ( TickType_t ) configINITIAL_TICK_COUNT;
 PRIVILEGED_DATA static volatile UBaseType_t uxTopReadyPriority 		= tskIDLE_PRIORITY;
+
+#if( ( configUSE_BITMAP_TASK_SELECTION == 1 ) && ( configMAX_PRIORITIES > 32 ) )
+	/* The second level of the ready bitmap, one bit per priority. */
+	PRIVILEGED_DATA static volatile uint32_t ulReadyPriorityGroups[ ( configMAX_PRIORITIES + 31 ) / 32 ];
+#endif
 PRIVILEGED_DATA static volatile BaseType_t xSchedulerRunning 		= pdFALSE;
 PRIVILEGED_DATA static volatile UBaseType_t uxPendedTicks 			= ( UBaseType_t ) 0U;
 PRIVILEGED_DATA static volatile BaseType_t xYieldPending 			= pdFALSE;
@@ -538,10 +632,48 @@ static void prvAddCurrentTaskToDelayedList( TickType_t xTicksToWait, const BaseT
 
 /*
  * Set xNextTaskUnblockTime to the time at which the next Blocked state task
- * will exit the Blocked state.
+ * will exit the Blocked state.  With configUSE_DELAYED_TASK_WHEEL this can
+ * also be when a slot of the wheel has to be cascaded.
  */
 static void prvResetNextTaskUnblockTime( void );
 
+#if( configUSE_DELAYED_TASK_WHEEL == 1 )
+
+	/*
+	 * The delayed task wheel equivalent of inserting the running task into
+	 * pxDelayedTaskList, called by prvAddCurrentTaskToDelayedList().
+	 */
+	static void prvAddCurrentTaskToDelayedWheel( const TickType_t xConstTickCount, const TickType_t xTicksToWait ) PRIVILEGED_FUNCTION;
+
+	/*
+	 * File a Blocked task's state list item in the wheel by its wake time.
+	 * Returns the tick on which the wheel next looks at the task - its wake
+	 * time, or the start of the span of the higher level slot it went into.
+	 */
+	static TickType_t prvDelayedWheelInsert( ListItem_t * const pxStateListItem ) PRIVILEGED_FUNCTION;
+
+	/*
+	 * Move the wheel on to xTime, cascading the slots whose span starts on
+	 * that tick.  Returns the level 0 slot holding the tasks due on it.
+	 */
+	static List_t *prvDelayedWheelAdvance( const TickType_t xTime ) PRIVILEGED_FUNCTION;
+
+	/*
+	 * The first tick after xDelayedTaskWheelTime on which a task is due or a
+	 * slot cascades.  The furthest tick the wheel reaches if it is empty, so
+	 * xDelayedTaskWheelTime never falls too far behind the tick count.
+	 */
+	static TickType_t prvDelayedWheelNextEvent( void ) PRIVILEGED_FUNCTION;
+
+	/*
+	 * The number of slots from uxFrom (cyclically) to the first slot of the
+	 * level that holds any tasks, or taskWHEEL_SLOTS if none do.  Clears the
+	 * occupancy bits of slots found to be empty on the way.
+	 */
+	static UBaseType_t prvDelayedWheelFirstSlot( const UBaseType_t uxLevel, const UBaseType_t uxFrom ) PRIVILEGED_FUNCTION;
+
+#endif /* configUSE_DELAYED_TASK_WHEEL */
+
 #if ( ( configUSE_TRACE_FACILITY == 1 ) && ( configUSE_STATS_FORMATTING_FUNCTIONS > 0 ) )
 
 	/*
@@ -1389,7 +1521,10 @@ static void prvAddNewTaskToReadyList( TCB_t *pxNewTCB )
 	eTaskState eTaskGetState( TaskHandle_t xTask )
 	{
 	eTaskState eReturn;
-	List_t const * pxStateList, *pxDelayedList, *pxOverflowedDelayedList;
+	List_t const * pxStateList;
+	#if( configUSE_DELAYED_TASK_WHEEL == 0 )
+		List_t const * pxDelayedList, *pxOverflowedDelayedList;
+	#endif
 	const TCB_t * const pxTCB = xTask;
 
 		configASSERT( pxTCB );
@@ -1404,12 +1539,20 @@ static void prvAddNewTaskToReadyList( TCB_t *pxNewTCB )
 			taskENTER_CRITICAL();
 			{
 				pxStateList = listLIST_ITEM_CONTAINER( &( pxTCB->xStateListItem ) );
-				pxDelayedList = pxDelayedTaskList;
-				pxOverflowedDelayedList = pxOverflowDelayedTaskList;
+				#if( configUSE_DELAYED_TASK_WHEEL == 0 )
+				{
+					pxDelayedList = pxDelayedTaskList;
+					pxOverflowedDelayedList = pxOverflowDelayedTaskList;
+				}
+				#endif
 			}
 			taskEXIT_CRITICAL();
 
+			#if( configUSE_DELAYED_TASK_WHEEL == 0 )
 			if( ( pxStateList == pxDelayedList ) || ( pxStateList == pxOverflowedDelayedList ) )
+			#else
+			if( taskIS_DELAYED_TASK_LIST( pxStateList ) )
+			#endif
 			{
 				/* The task being queried is referenced from one of the Blocked
 				lists. */
@@ -2057,9 +2200,18 @@ BaseType_t xReturn;
 		}
 		#endif /* configUSE_NEWLIB_REENTRANT */
 
-		xNextTaskUnblockTime = portMAX_DELAY;
 		xSchedulerRunning = pdTRUE;
 		xTickCount = ( TickType_t ) configINITIAL_TICK_COUNT;
+		#if( configUSE_DELAYED_TASK_WHEEL == 0 )
+		{
+			xNextTaskUnblockTime = portMAX_DELAY;
+		}
+		#else
+		{
+			xDelayedTaskWheelTime = xTickCount;
+			xNextTaskUnblockTime = prvDelayedWheelNextEvent();
+		}
+		#endif
 
 		/* If configGENERATE_RUN_TIME_STATS is defined then the following
 		macro must be defined to configure the timer/counter used to generate
@@ -2130,13 +2282,23 @@ void vTaskSuspendAll( void )
 		configUSE_PREEMPTION is 0, so there may be tasks above the idle priority
 		task that are in the Ready state, even though the idle task is
 		running. */
-		#if( configUSE_PORT_OPTIMISED_TASK_SELECTION == 0 )
+		#if( ( configUSE_PORT_OPTIMISED_TASK_SELECTION == 0 ) && ( configUSE_BITMAP_TASK_SELECTION == 0 ) )
 		{
 			if( uxTopReadyPriority > tskIDLE_PRIORITY )
 			{
 				uxHigherPriorityReadyTasks = pdTRUE;
 			}
 		}
+		#elif( ( configUSE_BITMAP_TASK_SELECTION == 1 ) && ( configMAX_PRIORITIES > 32 ) )
+		{
+			/* The idle priority is the least significant bit of the first
+			group, any other bit in it or any other group being set means a
+			task above the idle priority is in the Ready state. */
+			if( ( uxTopReadyPriority > ( UBaseType_t ) 0x01 ) || ( ulReadyPriorityGroups[ 0 ] > 0x01UL ) )
+			{
+				uxHigherPriorityReadyTasks = pdTRUE;
+			}
+		}
 		#else
 		{
 			const UBaseType_t uxLeastSignificantBit = ( UBaseType_t ) 0x01;
@@ -2453,15 +2615,31 @@ TCB_t *pxTCB;
 			} while( uxQueue > ( UBaseType_t ) tskIDLE_PRIORITY ); /*lint !e961 MISRA exception as the casts are only redundant for some ports. */
 
 			/* Search the delayed lists. */
-			if( pxTCB == NULL )
+			#if( configUSE_DELAYED_TASK_WHEEL == 0 )
 			{
-				pxTCB = prvSearchForNameWithinSingleList( ( List_t * ) pxDelayedTaskList, pcNameToQuery );
-			}
+				if( pxTCB == NULL )
+				{
+					pxTCB = prvSearchForNameWithinSingleList( ( List_t * ) pxDelayedTaskList, pcNameToQuery );
+				}
 
-			if( pxTCB == NULL )
+				if( pxTCB == NULL )
+				{
+					pxTCB = prvSearchForNameWithinSingleList( ( List_t * ) pxOverflowDelayedTaskList, pcNameToQuery );
+				}
+			}
+			#else
 			{
-				pxTCB = prvSearchForNameWithinSingleList( ( List_t * ) pxOverflowDelayedTaskList, pcNameToQuery );
+			UBaseType_t uxLevel, uxSlot;
+
+				for( uxLevel = 0U; ( pxTCB == NULL ) && ( uxLevel < ( UBaseType_t ) configDELAYED_TASK_WHEEL_LEVELS ); uxLevel++ )
+				{
+					for( uxSlot = 0U; ( pxTCB == NULL ) && ( uxSlot < taskWHEEL_SLOTS ); uxSlot++ )
+					{
+						pxTCB = prvSearchForNameWithinSingleList( &( xDelayedTaskWheel[ uxLevel ][ uxSlot ] ), pcNameToQuery );
+					}
+				}
 			}
+			#endif /* configUSE_DELAYED_TASK_WHEEL */
 
 			#if ( INCLUDE_vTaskSuspend == 1 )
 			{
@@ -2513,8 +2691,24 @@ TCB_t *pxTCB;
 
 				/* Fill in an TaskStatus_t structure with information on each
 				task in the Blocked state. */
-				uxTask += prvListTasksWithinSingleList( &( pxTaskStatusArray[ uxTask ] ), ( List_t * ) pxDelayedTaskList, eBlocked );
-				uxTask += prvListTasksWithinSingleList( &( pxTaskStatusArray[ uxTask ] ), ( List_t * ) pxOverflowDelayedTaskList, eBlocked );
+				#if( configUSE_DELAYED_TASK_WHEEL == 0 )
+				{
+					uxTask += prvListTasksWithinSingleList( &( pxTaskStatusArray[ uxTask ] ), ( List_t * ) pxDelayedTaskList, eBlocked );
+					uxTask += prvListTasksWithinSingleList( &( pxTaskStatusArray[ uxTask ] ), ( List_t * ) pxOverflowDelayedTaskList, eBlocked );
+				}
+				#else
+				{
+				UBaseType_t uxLevel, uxSlot;
+
+					for( uxLevel = 0U; uxLevel < ( UBaseType_t ) configDELAYED_TASK_WHEEL_LEVELS; uxLevel++ )
+					{
+						for( uxSlot = 0U; uxSlot < taskWHEEL_SLOTS; uxSlot++ )
+						{
+							uxTask += prvListTasksWithinSingleList( &( pxTaskStatusArray[ uxTask ] ), &( xDelayedTaskWheel[ uxLevel ][ uxSlot ] ), eBlocked );
+						}
+					}
+				}
+				#endif /* configUSE_DELAYED_TASK_WHEEL */
 
 				#if( INCLUDE_vTaskDelete == 1 )
 				{
@@ -2589,7 +2783,15 @@ implementations require configUSE_TICKLESS_IDLE to be set to a value other than
 		/* Correct the tick count value after a period during which the tick
 		was suppressed.  Note this does *not* call the tick hook function for
 		each stepped tick. */
-		configASSERT( ( xTickCount + xTicksToJump ) <= xNextTaskUnblockTime );
+		#if( configUSE_DELAYED_TASK_WHEEL == 0 )
+		{
+			configASSERT( ( xTickCount + xTicksToJump ) <= xNextTaskUnblockTime );
+		}
+		#else
+		{
+			configASSERT( taskWHEEL_TICKS_AHEAD( xTickCount + xTicksToJump ) <= taskWHEEL_TICKS_AHEAD( xNextTaskUnblockTime ) );
+		}
+		#endif
 		xTickCount += xTicksToJump;
 		traceINCREASE_TICK_COUNT( xTicksToJump );
 	}
@@ -2676,7 +2878,11 @@ implementations require configUSE_TICKLESS_IDLE to be set to a value other than
 BaseType_t xTaskIncrementTick( void )
 {
 TCB_t * pxTCB;
-TickType_t xItemValue;
+#if( configUSE_DELAYED_TASK_WHEEL == 0 )
+	TickType_t xItemValue;
+#else
+	List_t *pxDueTasks;
+#endif
 BaseType_t xSwitchRequired = pdFALSE;
 
 	/* Called by the portable layer each time a tick interrupt occurs.
@@ -2695,7 +2901,17 @@ BaseType_t xSwitchRequired = pdFALSE;
 
 		if( xConstTickCount == ( TickType_t ) 0U ) /*lint !e774 'if' does not always evaluate to false as it is looking for an overflow. */
 		{
-			taskSWITCH_DELAYED_LISTS();
+			#if( configUSE_DELAYED_TASK_WHEEL == 0 )
+			{
+				taskSWITCH_DELAYED_LISTS();
+			}
+			#else
+			{
+				/* The wheel is unaffected, but xTaskCheckForTimeOut() counts
+				overflows. */
+				xNumOfOverflows++;
+			}
+			#endif
 		}
 		else
 		{
@@ -2706,8 +2922,10 @@ BaseType_t xSwitchRequired = pdFALSE;
 		the	queue in the order of their wake time - meaning once one task
 		has been found whose block time has not expired there is no need to
 		look any further down the list. */
+		#if( configUSE_DELAYED_TASK_WHEEL == 0 )
 		if( xConstTickCount >= xNextTaskUnblockTime )
 		{
+			traceUNBLOCK_DELAYED_TASKS_BEGIN();
 			for( ;; )
 			{
 				if( listLIST_IS_EMPTY( pxDelayedTaskList ) != pdFALSE )
@@ -2782,7 +3000,51 @@ BaseType_t xSwitchRequired = pdFALSE;
 					#endif /* configUSE_PREEMPTION */
 				}
 			}
+			traceUNBLOCK_DELAYED_TASKS_END();
+		}
+		#else /* configUSE_DELAYED_TASK_WHEEL */
+		/* With the delayed task wheel every task in the level 0 slot for this
+		tick is due, and no other task is. */
+		if( taskWHEEL_TICKS_AHEAD( xNextTaskUnblockTime ) <= taskWHEEL_TICKS_AHEAD( xConstTickCount ) )
+		{
+			traceUNBLOCK_DELAYED_TASKS_BEGIN();
+			pxDueTasks = prvDelayedWheelAdvance( xConstTickCount );
+			while( listLIST_IS_EMPTY( pxDueTasks ) == pdFALSE )
+			{
+				pxTCB = listGET_OWNER_OF_HEAD_ENTRY( pxDueTasks ); /*lint !e9079 void * is used as this macro is used with timers and co-routines too.  Alignment is known to be fine as the type of the pointer stored and retrieved is the same. */
+				( void ) uxListRemove( &( pxTCB->xStateListItem ) );
+
+				/* The rest is the same as for the delayed task lists. */
+				if( listLIST_ITEM_CONTAINER( &( pxTCB->xEventListItem ) ) != NULL )
+				{
+					( void ) uxListRemove( &( pxTCB->xEventListItem ) );
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+
+				prvAddTaskToReadyList( pxTCB );
+
+				#if (  configUSE_PREEMPTION == 1 )
+				{
+					if( pxTCB->uxPriority >= pxCurrentTCB->uxPriority )
+					{
+						xSwitchRequired = pdTRUE;
+					}
+					else
+					{
+						mtCOVERAGE_TEST_MARKER();
+					}
+				}
+				#endif /* configUSE_PREEMPTION */
+			}
+			ulDelayedTaskWheelOccupied[ 0 ] &= ~( ( uint32_t ) 1U << ( xConstTickCount & taskWHEEL_SLOT_MASK ) );
+
+			xNextTaskUnblockTime = prvDelayedWheelNextEvent();
+			traceUNBLOCK_DELAYED_TASKS_END();
 		}
+		#endif /* configUSE_DELAYED_TASK_WHEEL */
 
 		/* Tasks of equal priority to the currently running task will share
 		processing time (time slice) if preemption is on, and the application
@@ -3428,7 +3690,15 @@ static portTASK_FUNCTION( prvIdleTask, pvParameters )
 					/* Now the scheduler is suspended, the expected idle
 					time can be sampled again, and this time its value can
 					be used. */
-					configASSERT( xNextTaskUnblockTime >= xTickCount );
+					#if( configUSE_DELAYED_TASK_WHEEL == 0 )
+					{
+						configASSERT( xNextTaskUnblockTime >= xTickCount );
+					}
+					#else
+					{
+						configASSERT( taskWHEEL_TICKS_AHEAD( xNextTaskUnblockTime ) >= taskWHEEL_TICKS_AHEAD( xTickCount ) );
+					}
+					#endif
 					xExpectedIdleTime = prvGetExpectedIdleTime();
 
 					/* Define the following macro to set xExpectedIdleTime to 0
@@ -3563,8 +3833,24 @@ UBaseType_t uxPriority;
 		vListInitialise( &( pxReadyTasksLists[ uxPriority ] ) );
 	}
 
-	vListInitialise( &xDelayedTaskList1 );
-	vListInitialise( &xDelayedTaskList2 );
+	#if( configUSE_DELAYED_TASK_WHEEL == 0 )
+	{
+		vListInitialise( &xDelayedTaskList1 );
+		vListInitialise( &xDelayedTaskList2 );
+	}
+	#else
+	{
+	UBaseType_t uxLevel, uxSlot;
+
+		for( uxLevel = 0U; uxLevel < ( UBaseType_t ) configDELAYED_TASK_WHEEL_LEVELS; uxLevel++ )
+		{
+			for( uxSlot = 0U; uxSlot < taskWHEEL_SLOTS; uxSlot++ )
+			{
+				vListInitialise( &( xDelayedTaskWheel[ uxLevel ][ uxSlot ] ) );
+			}
+		}
+	}
+	#endif /* configUSE_DELAYED_TASK_WHEEL */
 	vListInitialise( &xPendingReadyList );
 
 	#if ( INCLUDE_vTaskDelete == 1 )
@@ -3579,10 +3865,14 @@ UBaseType_t uxPriority;
 	}
 	#endif /* INCLUDE_vTaskSuspend */
 
-	/* Start with pxDelayedTaskList using list1 and the pxOverflowDelayedTaskList
-	using list2. */
-	pxDelayedTaskList = &xDelayedTaskList1;
-	pxOverflowDelayedTaskList = &xDelayedTaskList2;
+	#if( configUSE_DELAYED_TASK_WHEEL == 0 )
+	{
+		/* Start with pxDelayedTaskList using list1 and the pxOverflowDelayedTaskList
+		using list2. */
+		pxDelayedTaskList = &xDelayedTaskList1;
+		pxOverflowDelayedTaskList = &xDelayedTaskList2;
+	}
+	#endif
 }
 /*-----------------------------------------------------------*/
 
@@ -3902,6 +4192,8 @@ static void prvCheckTasksWaitingTermination( void )
 #endif /* INCLUDE_vTaskDelete */
 /*-----------------------------------------------------------*/
 
+#if( configUSE_DELAYED_TASK_WHEEL == 0 )
+
 static void prvResetNextTaskUnblockTime( void )
 {
 TCB_t *pxTCB;
@@ -3924,6 +4216,212 @@ TCB_t *pxTCB;
 		xNextTaskUnblockTime = listGET_LIST_ITEM_VALUE( &( ( pxTCB )->xStateListItem ) );
 	}
 }
+
+#else /* configUSE_DELAYED_TASK_WHEEL */
+
+static void prvResetNextTaskUnblockTime( void )
+{
+	xNextTaskUnblockTime = prvDelayedWheelNextEvent();
+}
+/*-----------------------------------------------------------*/
+
+static void prvAddCurrentTaskToDelayedWheel( const TickType_t xConstTickCount, const TickType_t xTicksToWait )
+{
+TickType_t xTimeToWake, xFirstEvent;
+
+	/* The wheel only moves on when a task is due or a slot cascades, so after
+	ticks on which neither happened it is behind the tick count.  Nothing can
+	be due or cascade before xNextTaskUnblockTime, so the wheel is moved on to
+	the tick count (or as close to it as that allows) before the task is
+	filed - filed from a wheel time further back, a short wait could go into
+	a higher level slot whose span has already started, and so would not be
+	looked at again until the wheel came round to it. */
+	if( taskWHEEL_TICKS_AHEAD( xNextTaskUnblockTime ) > taskWHEEL_TICKS_AHEAD( xConstTickCount ) )
+	{
+		xDelayedTaskWheelTime = xConstTickCount;
+	}
+	else
+	{
+		xDelayedTaskWheelTime = xNextTaskUnblockTime - ( TickType_t ) 1U;
+	}
+
+	/* The wheel counts ticks from xDelayedTaskWheelTime, which can still be
+	behind the tick count.  A wait so long that its wake time would look to the
+	wheel like a tick it has already passed is cut short to the longest one
+	that doesn't.  A wait of 0 ends on the next tick, as it does with the
+	delayed task lists. */
+	if( xTicksToWait > ( portMAX_DELAY - taskWHEEL_TICKS_AHEAD( xConstTickCount ) ) )
+	{
+		xTimeToWake = xDelayedTaskWheelTime + portMAX_DELAY;
+	}
+	else if( xTicksToWait == ( TickType_t ) 0U )
+	{
+		xTimeToWake = xConstTickCount + ( TickType_t ) 1U;
+	}
+	else
+	{
+		xTimeToWake = xConstTickCount + xTicksToWait;
+	}
+
+	listSET_LIST_ITEM_VALUE( &( pxCurrentTCB->xStateListItem ), xTimeToWake );
+	traceMOVED_TASK_TO_DELAYED_LIST();
+	xFirstEvent = prvDelayedWheelInsert( &( pxCurrentTCB->xStateListItem ) );
+
+	/* The tick has to stop at the task's slot even when that is a higher
+	level slot to be cascaded, not only when the task is due. */
+	if( taskWHEEL_TICKS_AHEAD( xFirstEvent ) < taskWHEEL_TICKS_AHEAD( xNextTaskUnblockTime ) )
+	{
+		xNextTaskUnblockTime = xFirstEvent;
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+}
+/*-----------------------------------------------------------*/
+
+static TickType_t prvDelayedWheelInsert( ListItem_t * const pxStateListItem )
+{
+TickType_t xSlotTime = listGET_LIST_ITEM_VALUE( pxStateListItem );
+TickType_t xDelta = taskWHEEL_TICKS_AHEAD( xSlotTime ) - ( TickType_t ) 1U;
+UBaseType_t uxLevel, uxSlot;
+
+	/* Park a task due beyond the wheel's reach as far ahead as the top level
+	goes, it is filed again (by its real wake time) when its slot
+	cascades. */
+	if( xDelta > taskWHEEL_MAX_DELTA )
+	{
+		xDelta = taskWHEEL_MAX_DELTA;
+		xSlotTime = xDelayedTaskWheelTime + ( TickType_t ) 1U + taskWHEEL_MAX_DELTA;
+	}
+
+	/* The lowest level that reaches far enough ahead. */
+	for( uxLevel = 0U; uxLevel < ( ( UBaseType_t ) configDELAYED_TASK_WHEEL_LEVELS - 1U ); uxLevel++ )
+	{
+		if( ( xDelta >> taskWHEEL_SHIFT( uxLevel + 1U ) ) == 0U )
+		{
+			break;
+		}
+	}
+
+	uxSlot = ( UBaseType_t ) ( ( xSlotTime >> taskWHEEL_SHIFT( uxLevel ) ) & taskWHEEL_SLOT_MASK );
+	vListInsertEnd( &( xDelayedTaskWheel[ uxLevel ][ uxSlot ] ), pxStateListItem );
+	ulDelayedTaskWheelOccupied[ uxLevel ] |= ( uint32_t ) 1U << uxSlot;
+
+	return xSlotTime & ~( ( ( TickType_t ) 1U << taskWHEEL_SHIFT( uxLevel ) ) - ( TickType_t ) 1U );
+}
+/*-----------------------------------------------------------*/
+
+static List_t *prvDelayedWheelAdvance( const TickType_t xTime )
+{
+List_t *pxSlot;
+ListItem_t *pxItem;
+UBaseType_t uxLevel, uxSlot;
+
+	/* Nothing is due before xTime, move straight on to it. */
+	xDelayedTaskWheelTime = xTime - ( TickType_t ) 1U;
+
+	/* Cascade the slots of the levels whose span starts on this tick.  A
+	level's span can only start where the span of the level below starts
+	too.  Every task in a cascaded slot is due within its span, so goes to
+	a lower level rather than back into the same slot. */
+	for( uxLevel = 1U; uxLevel < ( UBaseType_t ) configDELAYED_TASK_WHEEL_LEVELS; uxLevel++ )
+	{
+		if( ( xTime & ( ( ( TickType_t ) 1U << taskWHEEL_SHIFT( uxLevel ) ) - 1U ) ) != 0U )
+		{
+			break;
+		}
+
+		uxSlot = ( UBaseType_t ) ( ( xTime >> taskWHEEL_SHIFT( uxLevel ) ) & taskWHEEL_SLOT_MASK );
+		pxSlot = &( xDelayedTaskWheel[ uxLevel ][ uxSlot ] );
+		while( listLIST_IS_EMPTY( pxSlot ) == pdFALSE )
+		{
+			pxItem = listGET_HEAD_ENTRY( pxSlot );
+			( void ) uxListRemove( pxItem );
+			( void ) prvDelayedWheelInsert( pxItem );
+		}
+		ulDelayedTaskWheelOccupied[ uxLevel ] &= ~( ( uint32_t ) 1U << uxSlot );
+	}
+
+	xDelayedTaskWheelTime = xTime;
+
+	return &( xDelayedTaskWheel[ 0 ][ xTime & taskWHEEL_SLOT_MASK ] );
+}
+/*-----------------------------------------------------------*/
+
+static UBaseType_t prvDelayedWheelFirstSlot( const UBaseType_t uxLevel, const UBaseType_t uxFrom )
+{
+uint32_t ulOccupied, ulRotated;
+UBaseType_t uxOffset = taskWHEEL_SLOTS, uxSlot;
+
+	while( ulDelayedTaskWheelOccupied[ uxLevel ] != 0U )
+	{
+		ulOccupied = ulDelayedTaskWheelOccupied[ uxLevel ];
+		ulRotated = ulOccupied >> uxFrom;
+		if( uxFrom != 0U )
+		{
+			ulRotated |= ulOccupied << ( taskWHEEL_SLOTS - uxFrom );
+		}
+
+		/* Count the zeros below the lowest set bit. */
+		ulRotated &= ~ulRotated + 1U;
+		uxOffset = ( UBaseType_t ) 31U - portCOUNT_LEADING_ZEROS( ulRotated );
+		uxSlot = ( uxFrom + uxOffset ) & ( taskWHEEL_SLOTS - 1U );
+
+		if( listLIST_IS_EMPTY( &( xDelayedTaskWheel[ uxLevel ][ uxSlot ] ) ) == pdFALSE )
+		{
+			break;
+		}
+
+		/* Every task in the slot left the Blocked state early. */
+		ulDelayedTaskWheelOccupied[ uxLevel ] &= ~( ( uint32_t ) 1U << uxSlot );
+		uxOffset = taskWHEEL_SLOTS;
+	}
+
+	return uxOffset;
+}
+/*-----------------------------------------------------------*/
+
+static TickType_t prvDelayedWheelNextEvent( void )
+{
+const TickType_t xFirst = xDelayedTaskWheelTime + ( TickType_t ) 1U;
+TickType_t xBest = taskWHEEL_MAX_DELTA, xSpan, xToSpanStart, xTicks;
+UBaseType_t uxLevel, uxOffset;
+
+	/* Level 0 slots each hold a single tick. */
+	uxOffset = prvDelayedWheelFirstSlot( 0U, ( UBaseType_t ) ( xFirst & taskWHEEL_SLOT_MASK ) );
+	if( uxOffset < taskWHEEL_SLOTS )
+	{
+		xBest = ( TickType_t ) uxOffset;
+	}
+
+	/* A higher level slot cascades when the wheel reaches the start of its
+	span.  Each level's spans start less often than those of the level below,
+	so the search can stop once a level's next span start is too late. */
+	for( uxLevel = 1U; uxLevel < ( UBaseType_t ) configDELAYED_TASK_WHEEL_LEVELS; uxLevel++ )
+	{
+		xSpan = ( TickType_t ) 1U << taskWHEEL_SHIFT( uxLevel );
+		xToSpanStart = ( TickType_t ) ( ( TickType_t ) 0U - xFirst ) & ( xSpan - ( TickType_t ) 1U );
+		if( xToSpanStart >= xBest )
+		{
+			break;
+		}
+
+		uxOffset = prvDelayedWheelFirstSlot( uxLevel, ( UBaseType_t ) ( ( ( xFirst + xToSpanStart ) >> taskWHEEL_SHIFT( uxLevel ) ) & taskWHEEL_SLOT_MASK ) );
+		if( uxOffset < taskWHEEL_SLOTS )
+		{
+			xTicks = xToSpanStart + ( ( TickType_t ) uxOffset * xSpan );
+			if( xTicks < xBest )
+			{
+				xBest = xTicks;
+			}
+		}
+	}
+
+	return xFirst + xBest;
+}
+
+#endif /* configUSE_DELAYED_TASK_WHEEL */
 /*-----------------------------------------------------------*/
 
 #if ( ( INCLUDE_xTaskGetCurrentTaskHandle == 1 ) || ( configUSE_MUTEXES == 1 ) )
@@ -5105,9 +5603,13 @@ TickType_t uxReturn;
 
 static void prvAddCurrentTaskToDelayedList( TickType_t xTicksToWait, const BaseType_t xCanBlockIndefinitely )
 {
-TickType_t xTimeToWake;
+#if( configUSE_DELAYED_TASK_WHEEL == 0 )
+	TickType_t xTimeToWake;
+#endif
 const TickType_t xConstTickCount = xTickCount;
 
+	traceADD_TO_DELAYED_LIST_BEGIN();
+
 	#if( INCLUDE_xTaskAbortDelay == 1 )
 	{
 		/* About to enter a delayed list, so ensure the ucDelayAborted flag is
@@ -5141,6 +5643,11 @@ const TickType_t xConstTickCount = xTickCount;
 			vListInsertEnd( &xSuspendedTaskList, &( pxCurrentTCB->xStateListItem ) );
 		}
 		else
+		#if( configUSE_DELAYED_TASK_WHEEL == 1 )
+		{
+			prvAddCurrentTaskToDelayedWheel( xConstTickCount, xTicksToWait );
+		}
+		#else
 		{
 			/* Calculate the time at which the task should be woken if the event
 			does not occur.  This may overflow but this doesn't matter, the
@@ -5177,6 +5684,14 @@ const TickType_t xConstTickCount = xTickCount;
 				}
 			}
 		}
+		#endif /* configUSE_DELAYED_TASK_WHEEL */
+	}
+	#elif( configUSE_DELAYED_TASK_WHEEL == 1 )
+	{
+		prvAddCurrentTaskToDelayedWheel( xConstTickCount, xTicksToWait );
+
+		/* Avoid compiler warning when INCLUDE_vTaskSuspend is not 1. */
+		( void ) xCanBlockIndefinitely;
 	}
 	#else /* INCLUDE_vTaskSuspend */
 	{
@@ -5217,6 +5732,8 @@ const TickType_t xConstTickCount = xTickCount;
 		( void ) xCanBlockIndefinitely;
 	}
 	#endif /* INCLUDE_vTaskSuspend */
+
+	traceADD_TO_DELAYED_LIST_END();
 }
 
 /* Code below here allows additional code to be inserted into this source file,
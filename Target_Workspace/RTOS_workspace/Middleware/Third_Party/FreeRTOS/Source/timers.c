@@ -69,6 +69,26 @@ defining trmTIMER_SERVICE_TASK_NAME in FreeRTOSConfig.h. */
 #define tmrSTATUS_IS_STATICALLY_ALLOCATED	( ( uint8_t ) 0x02 )
 #define tmrSTATUS_IS_AUTORELOAD				( ( uint8_t ) 0x04 )
 
+#if( configUSE_TIMER_WHEEL == 1 )
+	/* Each level of the timer wheel has 32 slots, one bit each in the level's
+	occupancy bitmap. */
+	#define tmrWHEEL_SLOT_BITS			( 5U )
+	#define tmrWHEEL_SLOTS				( 1U << tmrWHEEL_SLOT_BITS )
+	#define tmrWHEEL_SLOT_MASK			( ( TickType_t ) tmrWHEEL_SLOTS - 1U )
+
+	/* The number of tick bits below a level's slot number. */
+	#define tmrWHEEL_SHIFT( uxLevel )	( ( uxLevel ) * tmrWHEEL_SLOT_BITS )
+
+	/* The furthest past the first unprocessed tick a timer can be filed. */
+	#define tmrWHEEL_MAX_DELTA			( ( TickType_t ) ( ( 1UL << tmrWHEEL_SHIFT( configTIMER_WHEEL_LEVELS ) ) - 1UL ) )
+
+	/* The wheel counts ticks from xTimerWheelTime, so is unaffected by the
+	tick count overflowing. */
+	#define tmrIS_DUE( xExpireTime, xTimeNow ) ( ( TickType_t ) ( ( xExpireTime ) - xTimerWheelTime ) <= ( TickType_t ) ( ( xTimeNow ) - xTimerWheelTime ) )
+#else
+	#define tmrIS_DUE( xExpireTime, xTimeNow ) ( ( xExpireTime ) <= ( xTimeNow ) )
+#endif
+
 /* The definition of the timers themselves. */
 typedef struct tmrTimerControl /* The old naming convention is used to prevent breaking kernel aware debuggers. */
 {
@@ -126,21 +146,40 @@ typedef struct tmrTimerQueueMessage
 /*lint -save -e956 A manual analysis and inspection has been used to determine
 which static variables must be declared volatile. */
 
-/* The list in which active timers are stored.  Timers are referenced in expire
-time order, with the nearest expiry time at the front of the list.  Only the
-timer service task is allowed to access these lists.
-xActiveTimerList1 and xActiveTimerList2 could be at function scope but that
-breaks some kernel aware debuggers, and debuggers that reply on removing the
-static qualifier. */
-PRIVILEGED_DATA static List_t xActiveTimerList1;
-PRIVILEGED_DATA static List_t xActiveTimerList2;
-PRIVILEGED_DATA static List_t *pxCurrentTimerList;
-PRIVILEGED_DATA static List_t *pxOverflowTimerList;
+#if( configUSE_TIMER_WHEEL == 0 )
+	/* The list in which active timers are stored.  Timers are referenced in expire
+	time order, with the nearest expiry time at the front of the list.  Only the
+	timer service task is allowed to access these lists.
+	xActiveTimerList1 and xActiveTimerList2 could be at function scope but that
+	breaks some kernel aware debuggers, and debuggers that reply on removing the
+	static qualifier. */
+	PRIVILEGED_DATA static List_t xActiveTimerList1;
+	PRIVILEGED_DATA static List_t xActiveTimerList2;
+	PRIVILEGED_DATA static List_t *pxCurrentTimerList;
+	PRIVILEGED_DATA static List_t *pxOverflowTimerList;
+#else
+	/* The timing wheel in which active timers are stored.  Slot n of level 0
+	holds the timers due in the next 32 ticks on a tick that is n modulo 32.
+	Slot n of level k holds the timers due in a span of 32^k ticks, and is
+	emptied into the levels below (cascaded) when the wheel reaches the start
+	of its span.  Every timer due on or before xTimerWheelTime has been
+	processed.  Only the timer service task is allowed to access the wheel. */
+	PRIVILEGED_DATA static List_t xTimerWheel[ configTIMER_WHEEL_LEVELS ][ tmrWHEEL_SLOTS ];
+	PRIVILEGED_DATA static uint32_t ulTimerWheelOccupied[ configTIMER_WHEEL_LEVELS ];
+	PRIVILEGED_DATA static TickType_t xTimerWheelTime = ( TickType_t ) 0U;
+#endif
 
 /* A queue that is used to send commands to the timer service task. */
 PRIVILEGED_DATA static QueueHandle_t xTimerQueue = NULL;
 PRIVILEGED_DATA static TaskHandle_t xTimerTaskHandle = NULL;
 
+#if( configTIMER_COMMAND_BATCH_LENGTH > 1 )
+	/* Commands taken off xTimerQueue but not processed yet. */
+	PRIVILEGED_DATA static DaemonTaskMessage_t xCommandBatch[ configTIMER_COMMAND_BATCH_LENGTH ];
+	PRIVILEGED_DATA static UBaseType_t uxCommandBatchNext = 0U;
+	PRIVILEGED_DATA static UBaseType_t uxCommandBatchLength = 0U;
+#endif
+
 /*lint -restore */
 
 /*-----------------------------------------------------------*/
@@ -174,23 +213,70 @@ static portTASK_FUNCTION_PROTO( prvTimerTask, pvParameters ) PRIVILEGED_FUNCTION
  */
 static void prvProcessReceivedCommands( void ) PRIVILEGED_FUNCTION;
 
+/*
+ * Take the next command off the timer queue, a batch at a time if
+ * configTIMER_COMMAND_BATCH_LENGTH is greater than 1.
+ */
+#if( configTIMER_COMMAND_BATCH_LENGTH > 1 )
+	static BaseType_t prvReceiveCommand( DaemonTaskMessage_t * const pxMessage ) PRIVILEGED_FUNCTION;
+#else
+	#define prvReceiveCommand( pxMessage ) xQueueReceive( xTimerQueue, ( pxMessage ), tmrNO_DELAY )
+#endif
+
 /*
  * Insert the timer into either xActiveTimerList1, or xActiveTimerList2,
- * depending on if the expire time causes a timer counter overflow.
+ * depending on if the expire time causes a timer counter overflow.  With
+ * configUSE_TIMER_WHEEL the timer is filed in the timing wheel instead.
  */
 static BaseType_t prvInsertTimerInActiveList( Timer_t * const pxTimer, const TickType_t xNextExpiryTime, const TickType_t xTimeNow, const TickType_t xCommandTime ) PRIVILEGED_FUNCTION;
 
 /*
  * An active timer has reached its expire time.  Reload the timer if it is an
- * auto reload timer, then call its callback.
+ * auto reload timer, then call its callback.  With configUSE_TIMER_WHEEL the
+ * wheel is moved on to xNextExpireTime and every timer due then is processed.
  */
 static void prvProcessExpiredTimer( const TickType_t xNextExpireTime, const TickType_t xTimeNow ) PRIVILEGED_FUNCTION;
 
-/*
- * The tick count has overflowed.  Switch the timer lists after ensuring the
- * current timer list does not still reference some timers.
- */
-static void prvSwitchTimerLists( void ) PRIVILEGED_FUNCTION;
+#if( configUSE_TIMER_WHEEL == 0 )
+
+	/*
+	 * The tick count has overflowed.  Switch the timer lists after ensuring the
+	 * current timer list does not still reference some timers.
+	 */
+	static void prvSwitchTimerLists( void ) PRIVILEGED_FUNCTION;
+
+#else
+
+	/*
+	 * File a timer in the wheel by its list item value (expiry time), or
+	 * remove it again.
+	 */
+	static void prvWheelInsert( Timer_t * const pxTimer ) PRIVILEGED_FUNCTION;
+	static void prvWheelRemove( Timer_t * const pxTimer ) PRIVILEGED_FUNCTION;
+
+	/*
+	 * Re-file the timers in a level 1 or higher slot into the levels below.
+	 */
+	static void prvWheelCascade( const UBaseType_t uxLevel, const UBaseType_t uxSlot ) PRIVILEGED_FUNCTION;
+
+	/*
+	 * The first tick after xTimerWheelTime on which a timer is due or a slot
+	 * has to be cascaded.  The wheel must not be empty.
+	 */
+	static TickType_t prvWheelNextEvent( void ) PRIVILEGED_FUNCTION;
+
+	/*
+	 * pdTRUE if no timers are active.
+	 */
+	static BaseType_t prvWheelIsEmpty( void ) PRIVILEGED_FUNCTION;
+
+	/*
+	 * The number of slots from uxFrom, going round the level, to the first
+	 * occupied slot in ulOccupied, which must not be 0.
+	 */
+	static UBaseType_t prvWheelFirstSlot( const uint32_t ulOccupied, const UBaseType_t uxFrom ) PRIVILEGED_FUNCTION;
+
+#endif /* configUSE_TIMER_WHEEL */
 
 /*
  * Obtain the current tick count, setting *pxTimerListsWereSwitched to pdTRUE
@@ -202,7 +288,8 @@ static TickType_t prvSampleTimeNow( BaseType_t * const pxTimerListsWereSwitched
  * If the timer list contains any active timers then return the expire time of
  * the timer that will expire first and set *pxListWasEmpty to false.  If the
  * timer list does not contain any timers then return 0 and set *pxListWasEmpty
- * to pdTRUE.
+ * to pdTRUE.  With configUSE_TIMER_WHEEL the time returned can also be when the
+ * wheel next has to cascade a slot.
  */
 static TickType_t prvGetNextExpireTime( BaseType_t * const pxListWasEmpty ) PRIVILEGED_FUNCTION;
 
@@ -479,6 +566,8 @@ Timer_t *pxTimer = xTimer;
 }
 /*-----------------------------------------------------------*/
 
+#if( configUSE_TIMER_WHEEL == 0 )
+
 static void prvProcessExpiredTimer( const TickType_t xNextExpireTime, const TickType_t xTimeNow )
 {
 BaseType_t xResult;
@@ -518,6 +607,62 @@ Timer_t * const pxTimer = ( Timer_t * ) listGET_OWNER_OF_HEAD_ENTRY( pxCurrentTi
 	/* Call the timer callback. */
 	pxTimer->pxCallbackFunction( ( TimerHandle_t ) pxTimer );
 }
+
+#else /* configUSE_TIMER_WHEEL */
+
+static void prvProcessExpiredTimer( const TickType_t xNextExpireTime, const TickType_t xTimeNow )
+{
+List_t * const pxSlot = &( xTimerWheel[ 0 ][ xNextExpireTime & tmrWHEEL_SLOT_MASK ] );
+Timer_t *pxTimer;
+UBaseType_t uxLevel, uxDue;
+
+	( void ) xTimeNow;
+
+	/* Nothing is due before xNextExpireTime, move straight on to it. */
+	xTimerWheelTime = xNextExpireTime - ( TickType_t ) 1U;
+
+	/* Cascade the slots of the levels whose span starts on this tick.  A
+	level's span can only start where the span of the level below starts
+	too. */
+	for( uxLevel = 1U; uxLevel < ( UBaseType_t ) configTIMER_WHEEL_LEVELS; uxLevel++ )
+	{
+		if( ( xNextExpireTime & ( ( ( TickType_t ) 1U << tmrWHEEL_SHIFT( uxLevel ) ) - 1U ) ) != 0U )
+		{
+			break;
+		}
+
+		prvWheelCascade( uxLevel, ( UBaseType_t ) ( ( xNextExpireTime >> tmrWHEEL_SHIFT( uxLevel ) ) & tmrWHEEL_SLOT_MASK ) );
+	}
+
+	xTimerWheelTime = xNextExpireTime;
+
+	/* Every timer in the level 0 slot for this tick is due now.  An auto
+	reload timer with a period that is a multiple of 32 goes back into the
+	same slot, so only the timers there to start with are processed. */
+	for( uxDue = listCURRENT_LIST_LENGTH( pxSlot ); uxDue > 0U; uxDue-- )
+	{
+		pxTimer = ( Timer_t * ) listGET_OWNER_OF_HEAD_ENTRY( pxSlot ); /*lint !e9087 !e9079 void * is used as this macro is used with tasks and co-routines too.  Alignment is known to be fine as the type of the pointer stored and retrieved is the same. */
+		prvWheelRemove( pxTimer );
+		traceTIMER_EXPIRED( pxTimer );
+
+		/* Auto reload timers are reloaded relative to when they were
+		due, the same as they are with the active timer lists. */
+		if( ( pxTimer->ucStatus & tmrSTATUS_IS_AUTORELOAD ) != 0 )
+		{
+			listSET_LIST_ITEM_VALUE( &( pxTimer->xTimerListItem ), ( xNextExpireTime + pxTimer->xTimerPeriodInTicks ) );
+			prvWheelInsert( pxTimer );
+		}
+		else
+		{
+			pxTimer->ucStatus &= ~tmrSTATUS_IS_ACTIVE;
+		}
+
+		/* Call the timer callback. */
+		pxTimer->pxCallbackFunction( ( TimerHandle_t ) pxTimer );
+	}
+}
+
+#endif /* configUSE_TIMER_WHEEL */
 /*-----------------------------------------------------------*/
 
 static portTASK_FUNCTION( prvTimerTask, pvParameters )
@@ -572,7 +717,7 @@ BaseType_t xTimerListsWereSwitched;
 		if( xTimerListsWereSwitched == pdFALSE )
 		{
 			/* The tick count has not overflowed, has the timer expired? */
-			if( ( xListWasEmpty == pdFALSE ) && ( xNextExpireTime <= xTimeNow ) )
+			if( ( xListWasEmpty == pdFALSE ) && tmrIS_DUE( xNextExpireTime, xTimeNow ) )
 			{
 				( void ) xTaskResumeAll();
 				prvProcessExpiredTimer( xNextExpireTime, xTimeNow );
@@ -585,12 +730,16 @@ BaseType_t xTimerListsWereSwitched;
 				received - whichever comes first.  The following line cannot
 				be reached unless xNextExpireTime > xTimeNow, except in the
 				case when the current timer list is empty. */
-				if( xListWasEmpty != pdFALSE )
+				#if( configUSE_TIMER_WHEEL == 0 )
 				{
-					/* The current timer list is empty - is the overflow list
-					also empty? */
-					xListWasEmpty = listLIST_IS_EMPTY( pxOverflowTimerList );
+					if( xListWasEmpty != pdFALSE )
+					{
+						/* The current timer list is empty - is the overflow list
+						also empty? */
+						xListWasEmpty = listLIST_IS_EMPTY( pxOverflowTimerList );
+					}
 				}
+				#endif /* configUSE_TIMER_WHEEL */
 
 				vQueueWaitForMessageRestricted( xTimerQueue, ( xNextExpireTime - xTimeNow ), xListWasEmpty );
 
@@ -616,6 +765,8 @@ BaseType_t xTimerListsWereSwitched;
 }
 /*-----------------------------------------------------------*/
 
+#if( configUSE_TIMER_WHEEL == 0 )
+
 static TickType_t prvGetNextExpireTime( BaseType_t * const pxListWasEmpty )
 {
 TickType_t xNextExpireTime;
@@ -640,8 +791,33 @@ TickType_t xNextExpireTime;
 
 	return xNextExpireTime;
 }
+
+#else /* configUSE_TIMER_WHEEL */
+
+static TickType_t prvGetNextExpireTime( BaseType_t * const pxListWasEmpty )
+{
+TickType_t xNextExpireTime;
+
+	/* With no active timers the timer service task waits for a command
+	indefinitely, tick count overflows don't matter to the wheel. */
+	*pxListWasEmpty = prvWheelIsEmpty();
+	if( *pxListWasEmpty == pdFALSE )
+	{
+		xNextExpireTime = prvWheelNextEvent();
+	}
+	else
+	{
+		xNextExpireTime = ( TickType_t ) 0U;
+	}
+
+	return xNextExpireTime;
+}
+
+#endif /* configUSE_TIMER_WHEEL */
 /*-----------------------------------------------------------*/
 
+#if( configUSE_TIMER_WHEEL == 0 )
+
 static TickType_t prvSampleTimeNow( BaseType_t * const pxTimerListsWereSwitched )
 {
 TickType_t xTimeNow;
@@ -663,8 +839,22 @@ PRIVILEGED_DATA static TickType_t xLastTime = ( TickType_t ) 0U; /*lint !e956 Va
 
 	return xTimeNow;
 }
+
+#else /* configUSE_TIMER_WHEEL */
+
+static TickType_t prvSampleTimeNow( BaseType_t * const pxTimerListsWereSwitched )
+{
+	/* There are no lists to switch. */
+	*pxTimerListsWereSwitched = pdFALSE;
+
+	return xTaskGetTickCount();
+}
+
+#endif /* configUSE_TIMER_WHEEL */
 /*-----------------------------------------------------------*/
 
+#if( configUSE_TIMER_WHEEL == 0 )
+
 static BaseType_t prvInsertTimerInActiveList( Timer_t * const pxTimer, const TickType_t xNextExpiryTime, const TickType_t xTimeNow, const TickType_t xCommandTime )
 {
 BaseType_t xProcessTimerNow = pdFALSE;
@@ -704,16 +894,94 @@ BaseType_t xProcessTimerNow = pdFALSE;
 
 	return xProcessTimerNow;
 }
+
+#else /* configUSE_TIMER_WHEEL */
+
+static BaseType_t prvInsertTimerInActiveList( Timer_t * const pxTimer, const TickType_t xNextExpiryTime, const TickType_t xTimeNow, const TickType_t xCommandTime )
+{
+BaseType_t xProcessTimerNow = pdFALSE;
+TickType_t xCommandAge, xWheelAge;
+
+	listSET_LIST_ITEM_VALUE( &( pxTimer->xTimerListItem ), xNextExpiryTime );
+	listSET_LIST_ITEM_OWNER( &( pxTimer->xTimerListItem ), pxTimer );
+
+	/* With no other timers active the wheel has nothing to catch up on, so
+	can be moved on to the current time. */
+	if( prvWheelIsEmpty() != pdFALSE )
+	{
+		xTimerWheelTime = xTimeNow;
+	}
+
+	/* Has the wheel already gone past the expiry time - did more than the
+	timer's period pass between the command being issued and the wheel's time?
+	Both ages are counted back from xTimeNow, so the tick count overflowing in
+	between doesn't matter. */
+	xCommandAge = ( TickType_t ) ( xTimeNow - xCommandTime );
+	xWheelAge = ( TickType_t ) ( xTimeNow - xTimerWheelTime );
+	if( ( xCommandAge >= xWheelAge ) && ( ( TickType_t ) ( xCommandAge - xWheelAge ) >= pxTimer->xTimerPeriodInTicks ) )
+	{
+		xProcessTimerNow = pdTRUE;
+	}
+	else
+	{
+		prvWheelInsert( pxTimer );
+	}
+
+	return xProcessTimerNow;
+}
+
+#endif /* configUSE_TIMER_WHEEL */
+/*-----------------------------------------------------------*/
+
+#if( configTIMER_COMMAND_BATCH_LENGTH > 1 )
+
+static BaseType_t prvReceiveCommand( DaemonTaskMessage_t * const pxMessage )
+{
+BaseType_t xReturn = pdPASS;
+
+	if( uxCommandBatchNext == uxCommandBatchLength )
+	{
+		/* Take what is queued, up to a batch, with the scheduler suspended.
+		Tasks blocked on a full queue are then readied together when the
+		scheduler is resumed, rather than each preempting this task as soon as
+		a space frees. */
+		uxCommandBatchNext = 0U;
+		uxCommandBatchLength = 0U;
+		vTaskSuspendAll();
+		{
+			while( ( uxCommandBatchLength < ( UBaseType_t ) configTIMER_COMMAND_BATCH_LENGTH ) &&
+				   ( xQueueReceive( xTimerQueue, &( xCommandBatch[ uxCommandBatchLength ] ), tmrNO_DELAY ) != pdFAIL ) )
+			{
+				uxCommandBatchLength++;
+			}
+		}
+		( void ) xTaskResumeAll();
+	}
+
+	if( uxCommandBatchNext < uxCommandBatchLength )
+	{
+		*pxMessage = xCommandBatch[ uxCommandBatchNext ];
+		uxCommandBatchNext++;
+	}
+	else
+	{
+		xReturn = pdFAIL;
+	}
+
+	return xReturn;
+}
+
+#endif /* configTIMER_COMMAND_BATCH_LENGTH */
 /*-----------------------------------------------------------*/
 
 static void	prvProcessReceivedCommands( void )
 {
 DaemonTaskMessage_t xMessage;
 Timer_t *pxTimer;
-BaseType_t xTimerListsWereSwitched, xResult;
-TickType_t xTimeNow;
+BaseType_t xTimerListsWereSwitched;
+TickType_t xTimeNow, xExpiredTime;
 
-	while( xQueueReceive( xTimerQueue, &xMessage, tmrNO_DELAY ) != pdFAIL ) /*lint !e603 xMessage does not have to be initialised as it is passed out, not in, and it is not used unless xQueueReceive() returns pdTRUE. */
+	while( prvReceiveCommand( &xMessage ) != pdFAIL ) /*lint !e603 xMessage does not have to be initialised as it is passed out, not in, and it is not used unless xQueueReceive() returns pdTRUE. */
 	{
 		#if ( INCLUDE_xTimerPendFunctionCall == 1 )
 		{
@@ -748,7 +1016,15 @@ TickType_t xTimeNow;
 			if( listIS_CONTAINED_WITHIN( NULL, &( pxTimer->xTimerListItem ) ) == pdFALSE ) /*lint !e961. The cast is only redundant when NULL is passed into the macro. */
 			{
 				/* The timer is in a list, remove it. */
-				( void ) uxListRemove( &( pxTimer->xTimerListItem ) );
+				#if( configUSE_TIMER_WHEEL == 0 )
+				{
+					( void ) uxListRemove( &( pxTimer->xTimerListItem ) );
+				}
+				#else
+				{
+					prvWheelRemove( pxTimer );
+				}
+				#endif /* configUSE_TIMER_WHEEL */
 			}
 			else
 			{
@@ -783,9 +1059,18 @@ TickType_t xTimeNow;
 
 						if( ( pxTimer->ucStatus & tmrSTATUS_IS_AUTORELOAD ) != 0 )
 						{
-							xResult = xTimerGenericCommand( pxTimer, tmrCOMMAND_START_DONT_TRACE, xMessage.u.xTimerParameters.xMessageValue + pxTimer->xTimerPeriodInTicks, NULL, tmrNO_DELAY );
-							configASSERT( xResult );
-							( void ) xResult;
+							/* Reload the timer here rather than posting a
+							command back to the timer queue, which fails if
+							the queue has been filled in the meantime.  Any
+							further periods that have also passed expire
+							now too. */
+							xExpiredTime = xMessage.u.xTimerParameters.xMessageValue + pxTimer->xTimerPeriodInTicks;
+							while( prvInsertTimerInActiveList( pxTimer, xExpiredTime + pxTimer->xTimerPeriodInTicks, xTimeNow, xExpiredTime ) != pdFALSE )
+							{
+								xExpiredTime += pxTimer->xTimerPeriodInTicks;
+								pxTimer->pxCallbackFunction( ( TimerHandle_t ) pxTimer );
+								traceTIMER_EXPIRED( pxTimer );
+							}
 						}
 						else
 						{
@@ -854,6 +1139,8 @@ TickType_t xTimeNow;
 }
 /*-----------------------------------------------------------*/
 
+#if( configUSE_TIMER_WHEEL == 0 )
+
 static void prvSwitchTimerLists( void )
 {
 TickType_t xNextExpireTime, xReloadTime;
@@ -911,6 +1198,145 @@ BaseType_t xResult;
 	pxCurrentTimerList = pxOverflowTimerList;
 	pxOverflowTimerList = pxTemp;
 }
+
+#else /* configUSE_TIMER_WHEEL */
+
+static void prvWheelInsert( Timer_t * const pxTimer )
+{
+TickType_t xSlotTime = listGET_LIST_ITEM_VALUE( &( pxTimer->xTimerListItem ) );
+TickType_t xDelta = ( TickType_t ) ( xSlotTime - xTimerWheelTime - ( TickType_t ) 1U );
+UBaseType_t uxLevel, uxSlot;
+
+	/* Park a timer due beyond the wheel's reach as far ahead as the top level
+	goes, it is filed again (by its real expiry time) when its slot
+	cascades. */
+	if( xDelta > tmrWHEEL_MAX_DELTA )
+	{
+		xDelta = tmrWHEEL_MAX_DELTA;
+		xSlotTime = xTimerWheelTime + ( TickType_t ) 1U + tmrWHEEL_MAX_DELTA;
+	}
+
+	/* The lowest level that reaches far enough ahead. */
+	for( uxLevel = 0U; uxLevel < ( ( UBaseType_t ) configTIMER_WHEEL_LEVELS - 1U ); uxLevel++ )
+	{
+		if( ( xDelta >> tmrWHEEL_SHIFT( uxLevel + 1U ) ) == 0U )
+		{
+			break;
+		}
+	}
+
+	uxSlot = ( UBaseType_t ) ( ( xSlotTime >> tmrWHEEL_SHIFT( uxLevel ) ) & tmrWHEEL_SLOT_MASK );
+	vListInsertEnd( &( xTimerWheel[ uxLevel ][ uxSlot ] ), &( pxTimer->xTimerListItem ) );
+	ulTimerWheelOccupied[ uxLevel ] |= ( uint32_t ) 1U << uxSlot;
+}
+/*-----------------------------------------------------------*/
+
+static void prvWheelRemove( Timer_t * const pxTimer )
+{
+List_t * const pxSlot = listLIST_ITEM_CONTAINER( &( pxTimer->xTimerListItem ) );
+UBaseType_t uxIndex;
+
+	if( uxListRemove( &( pxTimer->xTimerListItem ) ) == ( UBaseType_t ) 0U )
+	{
+		uxIndex = ( UBaseType_t ) ( pxSlot - &( xTimerWheel[ 0 ][ 0 ] ) );
+		ulTimerWheelOccupied[ uxIndex / tmrWHEEL_SLOTS ] &= ~( ( uint32_t ) 1U << ( uxIndex % tmrWHEEL_SLOTS ) );
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvWheelCascade( const UBaseType_t uxLevel, const UBaseType_t uxSlot )
+{
+List_t * const pxSlot = &( xTimerWheel[ uxLevel ][ uxSlot ] );
+Timer_t *pxTimer;
+UBaseType_t uxTimers;
+
+	/* Every timer here is due in the span that starts now, so they all go
+	to lower levels rather than back into this slot. */
+	for( uxTimers = listCURRENT_LIST_LENGTH( pxSlot ); uxTimers > 0U; uxTimers-- )
+	{
+		pxTimer = ( Timer_t * ) listGET_OWNER_OF_HEAD_ENTRY( pxSlot ); /*lint !e9087 !e9079 void * is used as this macro is used with tasks and co-routines too.  Alignment is known to be fine as the type of the pointer stored and retrieved is the same. */
+		prvWheelRemove( pxTimer );
+		prvWheelInsert( pxTimer );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvWheelIsEmpty( void )
+{
+BaseType_t xReturn = pdTRUE;
+UBaseType_t uxLevel;
+
+	for( uxLevel = 0U; uxLevel < ( UBaseType_t ) configTIMER_WHEEL_LEVELS; uxLevel++ )
+	{
+		if( ulTimerWheelOccupied[ uxLevel ] != 0U )
+		{
+			xReturn = pdFALSE;
+			break;
+		}
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static UBaseType_t prvWheelFirstSlot( const uint32_t ulOccupied, const UBaseType_t uxFrom )
+{
+uint32_t ulRotated = ulOccupied >> uxFrom;
+
+	if( uxFrom != 0U )
+	{
+		ulRotated |= ulOccupied << ( tmrWHEEL_SLOTS - uxFrom );
+	}
+
+	/* Count the zeros below the lowest set bit. */
+	ulRotated &= ~ulRotated + 1U;
+	return ( UBaseType_t ) 31U - portCOUNT_LEADING_ZEROS( ulRotated );
+}
+/*-----------------------------------------------------------*/
+
+static TickType_t prvWheelNextEvent( void )
+{
+const TickType_t xFirst = xTimerWheelTime + ( TickType_t ) 1U;
+TickType_t xBest = portMAX_DELAY, xSpan, xToSpanStart, xTicks;
+UBaseType_t uxLevel, uxFirstSlot;
+
+	/* Level 0 slots each hold a single tick. */
+	if( ulTimerWheelOccupied[ 0 ] != 0U )
+	{
+		xBest = ( TickType_t ) prvWheelFirstSlot( ulTimerWheelOccupied[ 0 ], ( UBaseType_t ) ( xFirst & tmrWHEEL_SLOT_MASK ) );
+	}
+
+	/* A higher level slot cascades when the wheel reaches the start of its
+	span.  Each level's spans start less often than those of the level below,
+	so the search can stop once a level's next span start is too late. */
+	for( uxLevel = 1U; uxLevel < ( UBaseType_t ) configTIMER_WHEEL_LEVELS; uxLevel++ )
+	{
+		xSpan = ( TickType_t ) 1U << tmrWHEEL_SHIFT( uxLevel );
+		xToSpanStart = ( TickType_t ) ( ( TickType_t ) 0U - xFirst ) & ( xSpan - ( TickType_t ) 1U );
+		if( xToSpanStart >= xBest )
+		{
+			break;
+		}
+
+		if( ulTimerWheelOccupied[ uxLevel ] != 0U )
+		{
+			uxFirstSlot = ( UBaseType_t ) ( ( ( xFirst + xToSpanStart ) >> tmrWHEEL_SHIFT( uxLevel ) ) & tmrWHEEL_SLOT_MASK );
+			xTicks = xToSpanStart + ( ( TickType_t ) prvWheelFirstSlot( ulTimerWheelOccupied[ uxLevel ], uxFirstSlot ) * xSpan );
+			if( xTicks < xBest )
+			{
+				xBest = xTicks;
+			}
+		}
+	}
+
+	return xFirst + xBest;
+}
+
+#endif /* configUSE_TIMER_WHEEL */
 /*-----------------------------------------------------------*/
 
 static void prvCheckForValidListAndQueue( void )
@@ -922,10 +1348,26 @@ static void prvCheckForValidListAndQueue( void )
 	{
 		if( xTimerQueue == NULL )
 		{
-			vListInitialise( &xActiveTimerList1 );
-			vListInitialise( &xActiveTimerList2 );
-			pxCurrentTimerList = &xActiveTimerList1;
-			pxOverflowTimerList = &xActiveTimerList2;
+			#if( configUSE_TIMER_WHEEL == 0 )
+			{
+				vListInitialise( &xActiveTimerList1 );
+				vListInitialise( &xActiveTimerList2 );
+				pxCurrentTimerList = &xActiveTimerList1;
+				pxOverflowTimerList = &xActiveTimerList2;
+			}
+			#else
+			{
+				UBaseType_t uxLevel, uxSlot;
+
+				for( uxLevel = 0U; uxLevel < ( UBaseType_t ) configTIMER_WHEEL_LEVELS; uxLevel++ )
+				{
+					for( uxSlot = 0U; uxSlot < tmrWHEEL_SLOTS; uxSlot++ )
+					{
+						vListInitialise( &( xTimerWheel[ uxLevel ][ uxSlot ] ) );
+					}
+				}
+			}
+			#endif /* configUSE_TIMER_WHEEL */
 
 			#if( configSUPPORT_STATIC_ALLOCATION == 1 )
 			{
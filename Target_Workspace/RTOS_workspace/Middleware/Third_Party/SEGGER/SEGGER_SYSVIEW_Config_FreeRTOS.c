@@ -87,6 +87,13 @@ extern const SEGGER_SYSVIEW_OS_API SYSVIEW_X_OS_TraceAPI;
 static void _cbSendSystemDesc(void) {
   SEGGER_SYSVIEW_SendSysDesc("N="SYSVIEW_APP_NAME",D="SYSVIEW_DEVICE_NAME",O=FreeRTOS V10");
   SEGGER_SYSVIEW_SendSysDesc("I#15=SysTick");
+#ifdef SYSVIEW_FREERTOS_MARKER_DELAYED_INSERT
+  SEGGER_SYSVIEW_NameMarker(SYSVIEW_FREERTOS_MARKER_DELAYED_INSERT, "Delayed insert");
+  SEGGER_SYSVIEW_NameMarker(SYSVIEW_FREERTOS_MARKER_DELAYED_UNBLOCK, "Delayed unblock");
+#endif
+#if SYSVIEW_FREERTOS_HEAP_PROFILER
+  HeapProfilerSendHeapDefine();   // the heap was set up before the recording started
+#endif
 }
 
 /*********************************************************************
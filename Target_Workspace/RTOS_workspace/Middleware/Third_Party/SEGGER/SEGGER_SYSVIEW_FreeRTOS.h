@@ -73,6 +73,29 @@ Notes:
 
 #define SYSVIEW_FREERTOS_MAX_NOF_TASKS  8
 
+// Marker IDs bracketing the delayed task list (or wheel) insertion and the
+// tick's unblocking of due tasks, so SystemView shows how long each takes
+#ifndef SYSVIEW_FREERTOS_MARKER_DELAYED_INSERT
+  #define SYSVIEW_FREERTOS_MARKER_DELAYED_INSERT   0x100u
+#endif
+#ifndef SYSVIEW_FREERTOS_MARKER_DELAYED_UNBLOCK
+  #define SYSVIEW_FREERTOS_MARKER_DELAYED_UNBLOCK  0x101u
+#endif
+
+// 1 to send the MemMang allocators' heap events through HeapProfiler.c
+// (Drivers/HandsOnRTOS), which tags each allocation with its call site and
+// keeps per call site statistics on the target
+#ifndef SYSVIEW_FREERTOS_HEAP_PROFILER
+  #define SYSVIEW_FREERTOS_HEAP_PROFILER           0
+#endif
+
+// 1 to also pass task switches, readying and deletion to RunTimeStats.c
+// (Drivers/HandsOnRTOS), which keeps per task CPU time, switch counts,
+// scheduling latency and longest block, timed with the DWT cycle counter
+#ifndef SYSVIEW_FREERTOS_RUN_TIME_STATS
+  #define SYSVIEW_FREERTOS_RUN_TIME_STATS          0
+#endif
+
 /*********************************************************************
 *
 *       Defines, fixed
@@ -238,9 +261,26 @@ Notes:
 #define traceSTREAM_BUFFER_RECEIVE_FROM_ISR( xStreamBuffer, xReceivedLength )   SEGGER_SYSVIEW_RecordU32x2(apiID_OFFSET + apiID_XSTREAMBUFFERRECEIVEFROMISR, (U32)xStreamBuffer, (U32)xReceivedLength)
 
 
+#if SYSVIEW_FREERTOS_RUN_TIME_STATS
+void RunTimeStatsSwitchedOut(void* Task);
+void RunTimeStatsSwitchedIn (void* Task);
+void RunTimeStatsReady      (void* Task);
+void RunTimeStatsTaskDeleted(void* Task);
+
+  #define SYSVIEW_RUN_TIME_STATS_SWITCHED_IN()      RunTimeStatsSwitchedIn(pxCurrentTCB)
+  #define SYSVIEW_RUN_TIME_STATS_READY(pxTCB)       RunTimeStatsReady(pxTCB)
+  #define SYSVIEW_RUN_TIME_STATS_DELETE(pxTCB)      RunTimeStatsTaskDeleted(pxTCB)
+  #define traceTASK_SWITCHED_OUT()                  RunTimeStatsSwitchedOut(pxCurrentTCB)
+#else
+  #define SYSVIEW_RUN_TIME_STATS_SWITCHED_IN()
+  #define SYSVIEW_RUN_TIME_STATS_READY(pxTCB)
+  #define SYSVIEW_RUN_TIME_STATS_DELETE(pxTCB)
+#endif
+
 #define traceTASK_DELETE( pxTCB )                   {                                                                                                   \
                                                       SEGGER_SYSVIEW_RecordU32(apiID_OFFSET + apiID_VTASKDELETE, SEGGER_SYSVIEW_ShrinkId((U32)pxTCB));  \
                                                       SYSVIEW_DeleteTask((U32)pxTCB);                                                                   \
+                                                      SYSVIEW_RUN_TIME_STATS_DELETE(pxTCB);                                                             \
                                                     }
 
 
@@ -281,13 +321,17 @@ Notes:
 // Define INCLUDE_xTaskGetIdleTaskHandle as 1 in FreeRTOSConfig.h to allow identification of Idle state.
 //
 #if ( INCLUDE_xTaskGetIdleTaskHandle == 1 )
-  #define traceTASK_SWITCHED_IN()                   if(prvGetTCBFromHandle(NULL) == xIdleTaskHandle) {                  \
-                                                      SEGGER_SYSVIEW_OnIdle();                                          \
-                                                    } else {                                                            \
-                                                      SEGGER_SYSVIEW_OnTaskStartExec((U32)pxCurrentTCB);                \
+  #define traceTASK_SWITCHED_IN()                   {                                                                   \
+                                                      SYSVIEW_RUN_TIME_STATS_SWITCHED_IN();                             \
+                                                      if(prvGetTCBFromHandle(NULL) == xIdleTaskHandle) {                \
+                                                        SEGGER_SYSVIEW_OnIdle();                                        \
+                                                      } else {                                                          \
+                                                        SEGGER_SYSVIEW_OnTaskStartExec((U32)pxCurrentTCB);              \
+                                                      }                                                                 \
                                                     }
 #else
   #define traceTASK_SWITCHED_IN()                   {                                                                   \
+                                                      SYSVIEW_RUN_TIME_STATS_SWITCHED_IN();                             \
                                                       if (memcmp(pxCurrentTCB->pcTaskName, "IDLE", 5) != 0) {           \
                                                         SEGGER_SYSVIEW_OnTaskStartExec((U32)pxCurrentTCB);              \
                                                       } else {                                                          \
@@ -296,13 +340,32 @@ Notes:
                                                     }
 #endif
 
-#define traceMOVED_TASK_TO_READY_STATE(pxTCB)       SEGGER_SYSVIEW_OnTaskStartReady((U32)pxTCB)
+#define traceMOVED_TASK_TO_READY_STATE(pxTCB)       {                                                                   \
+                                                      SYSVIEW_RUN_TIME_STATS_READY(pxTCB);                              \
+                                                      SEGGER_SYSVIEW_OnTaskStartReady((U32)pxTCB);                      \
+                                                    }
 #define traceREADDED_TASK_TO_READY_STATE(pxTCB)     
 
 #define traceMOVED_TASK_TO_DELAYED_LIST()           SEGGER_SYSVIEW_OnTaskStopReady((U32)pxCurrentTCB,  (1u << 2))
 #define traceMOVED_TASK_TO_OVERFLOW_DELAYED_LIST()  SEGGER_SYSVIEW_OnTaskStopReady((U32)pxCurrentTCB,  (1u << 2))
 #define traceMOVED_TASK_TO_SUSPENDED_LIST(pxTCB)    SEGGER_SYSVIEW_OnTaskStopReady((U32)pxTCB,         ((3u << 3) | 3))
 
+#define traceADD_TO_DELAYED_LIST_BEGIN()            SEGGER_SYSVIEW_MarkStart(SYSVIEW_FREERTOS_MARKER_DELAYED_INSERT)
+#define traceADD_TO_DELAYED_LIST_END()              SEGGER_SYSVIEW_MarkStop(SYSVIEW_FREERTOS_MARKER_DELAYED_INSERT)
+#define traceUNBLOCK_DELAYED_TASKS_BEGIN()          SEGGER_SYSVIEW_MarkStart(SYSVIEW_FREERTOS_MARKER_DELAYED_UNBLOCK)
+#define traceUNBLOCK_DELAYED_TASKS_END()            SEGGER_SYSVIEW_MarkStop(SYSVIEW_FREERTOS_MARKER_DELAYED_UNBLOCK)
+
+#if SYSVIEW_FREERTOS_HEAP_PROFILER
+void HeapProfilerHeapInit(void* Start, size_t HeapSize, size_t BlockOverhead);
+void HeapProfilerMalloc  (void* Address, size_t WantedSize, size_t BlockSize, void const* Caller);
+void HeapProfilerFree    (void* Address, size_t BlockSize);
+void HeapProfilerSendHeapDefine(void);
+
+#define traceHEAP_INIT(pvStart, xHeapSize, xBlockOverhead)                HeapProfilerHeapInit(pvStart, xHeapSize, xBlockOverhead)
+#define traceMALLOC_FROM(pvAddress, xWantedSize, xBlockSize, pvCaller)     HeapProfilerMalloc(pvAddress, xWantedSize, xBlockSize, pvCaller)
+#define traceFREE(pvAddress, uiSize)                                      HeapProfilerFree(pvAddress, uiSize)
+#endif
+
 
 #define traceISR_EXIT_TO_SCHEDULER()                SEGGER_SYSVIEW_RecordExitISRToScheduler()
 #define traceISR_EXIT()                             SEGGER_SYSVIEW_RecordExitISR()
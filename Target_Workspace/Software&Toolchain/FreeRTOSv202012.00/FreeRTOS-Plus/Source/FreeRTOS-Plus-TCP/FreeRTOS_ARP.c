@@ -61,6 +61,47 @@
     #define arpGRATUITOUS_ARP_PERIOD    ( pdMS_TO_TICKS( 20000U ) )
 #endif
 
+#if ( ipconfigUSE_ARP_HASH == 1 )
+
+    #if ( configUSE_16_BIT_TICKS == 1 ) && ( ipconfigARP_MAX_PARKED_PACKETS > 0 )
+        #error ipconfigARP_MAX_PARKED_PACKETS keeps an IP address in a list item value, and needs 32-bit ticks
+    #endif
+
+/** @brief The first slot to try for an IP address, the halves are folded
+ * together first so that neighbours on the LAN, which differ in the upper bytes
+ * of the address in network byte order, spread over the index. */
+    #define arpHASH_SLOT( ulIPAddress ) \
+    ( ( ( ( ( ulIPAddress ) ^ ( ( ulIPAddress ) >> 16 ) ) * 0x9E3779B1UL ) >> 16 ) & ( ( uint32_t ) ipconfigARP_HASH_SLOTS - 1UL ) )
+
+/** @brief Row number of a non-zero link or slot. */
+    #define arpROW( usLink )    ( ( BaseType_t ) ( usLink ) - 1 )
+
+/** @brief Link or slot value of a row number. */
+    #define arpLINK( x )        ( ( uint16_t ) ( ( x ) + 1 ) )
+
+/** @brief The links of a row in the list of use, or in the age or pending
+ * list. */
+    #define arpROW_LINK( x, xUseLink ) \
+    ( ( ( xUseLink ) != pdFALSE ) ? &( xARPCache[ ( x ) ].xUseLink ) : &( xARPCache[ ( x ) ].xAgeLink ) )
+
+/**
+ * @brief Utility function to cast pointer of a type to pointer of type NetworkBufferDescriptor_t.
+ *
+ * @return The casted pointer.
+ */
+    static portINLINE ipDECL_CAST_PTR_FUNC_FOR_TYPE( NetworkBufferDescriptor_t )
+    {
+        return ( NetworkBufferDescriptor_t * ) pvArgument;
+    }
+
+/** @brief A list of ARP cache rows, as row numbers plus one. */
+    typedef struct xARP_ROW_LIST
+    {
+        uint16_t usHead; /**< The first row, or zero. */
+        uint16_t usTail; /**< The last row, or zero. */
+    } ARPRowList_t;
+#endif /* ipconfigUSE_ARP_HASH */
+
 /*-----------------------------------------------------------*/
 
 /*
@@ -69,11 +110,95 @@
 static eARPLookupResult_t prvCacheLookup( uint32_t ulAddressToLookup,
                                           MACAddress_t * const pxMACAddress );
 
+#if ( ipconfigUSE_ARP_HASH == 1 )
+
+/*
+ * Find the row holding an IP address through the index, or -1.
+ */
+    static BaseType_t prvARPHashFind( uint32_t ulIPAddress );
+
+/*
+ * Add or refresh an entry through the index, for vARPRefreshCacheEntry().
+ */
+    static void prvARPHashRefresh( const MACAddress_t * pxMACAddress,
+                                   const uint32_t ulIPAddress );
+
+/*
+ * Take a row for a new IP address, replacing the least recently used entry when
+ * the table is full, and enter it in the index and the list of use.
+ */
+    static BaseType_t prvARPNewRow( uint32_t ulIPAddress );
+
+/*
+ * Take a row out of the index and the lists, and free it.
+ */
+    static void prvARPRemoveRow( BaseType_t x );
+
+/*
+ * Append a row to a list, or unlink it.  xUseLink chooses between the links
+ * of the list of use and those of the age and pending lists.
+ */
+    static void prvARPListAppend( ARPRowList_t * pxList,
+                                  BaseType_t x,
+                                  BaseType_t xUseLink );
+    static void prvARPListRemove( ARPRowList_t * pxList,
+                                  BaseType_t x,
+                                  BaseType_t xUseLink );
+
+/*
+ * The age of a valid entry, from the times the cache aged since its refresh.
+ */
+    static uint8_t prvARPValidAge( BaseType_t x );
+
+/*
+ * Send, or drop, the packets held for an IP address.
+ */
+    static void prvARPReleaseParked( uint32_t ulIPAddress,
+                                     BaseType_t xSend );
+#endif /* ipconfigUSE_ARP_HASH */
+
 /*-----------------------------------------------------------*/
 
 /** @brief The ARP cache. */
 _static ARPCacheRow_t xARPCache[ ipconfigARP_CACHE_ENTRIES ];
 
+#if ( ipconfigUSE_ARP_HASH == 1 )
+
+/** @brief The index of the ARP cache: each slot holds a row number plus one, or
+ * zero when empty.  A row sits in the first free slot from the one its IP
+ * address hashes to. */
+    static uint16_t usARPHashSlots[ ipconfigARP_HASH_SLOTS ];
+
+/** @brief Rows from least to most recently used, looked up or refreshed. */
+    static ARPRowList_t xARPUseList;
+
+/** @brief Valid rows from least to most recently refreshed. */
+    static ARPRowList_t xARPAgeList;
+
+/** @brief Rows waiting for an ARP reply. */
+    static ARPRowList_t xARPPendingList;
+
+/** @brief Freed rows, linked through their xUseLink.usNext. */
+    static uint16_t usARPFreeRows;
+
+/** @brief Rows from this one on have never been used since the cache was
+ * cleared. */
+    static UBaseType_t uxARPUnusedRow;
+
+/** @brief Counts the calls to vARPAgeCache(), the age of a valid entry is
+ * ipconfigMAX_ARP_AGE minus the calls since its usRefreshTime. */
+    static uint16_t usARPAgeCount;
+
+/** @brief Outgoing packets waiting for an ARP reply, the item value is the IP
+ * address that was looked up for them. */
+    static List_t xARPParkedPackets;
+
+/** @brief Counters for FreeRTOS_GetARPCacheStats(). */
+    static uint32_t ulARPLookups, ulARPHits, ulARPMisses, ulARPPendingHits;
+    static uint32_t ulARPSearches, ulARPProbes, ulARPEvictions;
+    static uint32_t ulARPParkedSent, ulARPParkedDropped;
+#endif /* ipconfigUSE_ARP_HASH */
+
 /** @brief  The time at which the last gratuitous ARP was sent.  Gratuitous ARPs are used
  * to ensure ARP tables are up to date and to detect IP address conflicts. */
 static TickType_t xLastGratuitousARPTime = ( TickType_t ) 0;
@@ -242,7 +367,19 @@ eFrameProcessingResult_t eARPProcessPacket( ARPPacket_t * const pxARPFrame )
             if( ( memcmp( xARPCache[ x ].xMACAddress.ucBytes, pxMACAddress->ucBytes, sizeof( pxMACAddress->ucBytes ) ) == 0 ) )
             {
                 lResult = xARPCache[ x ].ulIPAddress;
-                ( void ) memset( &xARPCache[ x ], 0, sizeof( xARPCache[ x ] ) );
+
+                #if ( ipconfigUSE_ARP_HASH == 1 )
+                    {
+                        if( lResult != 0UL )
+                        {
+                            prvARPRemoveRow( x );
+                        }
+                    }
+                #else
+                    {
+                        ( void ) memset( &xARPCache[ x ], 0, sizeof( xARPCache[ x ] ) );
+                    }
+                #endif /* ipconfigUSE_ARP_HASH */
                 break;
             }
         }
@@ -264,11 +401,13 @@ eFrameProcessingResult_t eARPProcessPacket( ARPPacket_t * const pxARPFrame )
 void vARPRefreshCacheEntry( const MACAddress_t * pxMACAddress,
                             const uint32_t ulIPAddress )
 {
-    BaseType_t x = 0;
-    BaseType_t xIpEntry = -1;
-    BaseType_t xMacEntry = -1;
-    BaseType_t xUseEntry = 0;
-    uint8_t ucMinAgeFound = 0U;
+    #if ( ipconfigUSE_ARP_HASH == 0 )
+        BaseType_t x = 0;
+        BaseType_t xIpEntry = -1;
+        BaseType_t xMacEntry = -1;
+        BaseType_t xUseEntry = 0;
+        uint8_t ucMinAgeFound = 0U;
+    #endif
 
     #if ( ipconfigARP_STORES_REMOTE_ADDRESSES == 0 )
 
@@ -288,6 +427,11 @@ void vARPRefreshCacheEntry( const MACAddress_t * pxMACAddress,
 
         if( pdTRUE )
     #endif
+    #if ( ipconfigUSE_ARP_HASH == 1 )
+        {
+            prvARPHashRefresh( pxMACAddress, ulIPAddress );
+        }
+    #else
     {
         /* Start with the maximum possible number. */
         ucMinAgeFound--;
@@ -429,6 +573,7 @@ void vARPRefreshCacheEntry( const MACAddress_t * pxMACAddress,
             /* Nothing will be stored. */
         }
     }
+    #endif /* ipconfigUSE_ARP_HASH */
 }
 /*-----------------------------------------------------------*/
 
@@ -581,6 +726,19 @@ eARPLookupResult_t eARPGetCacheEntry( uint32_t * pulIPAddress,
                     /* It might be that the ARP has to go to the gateway. */
                     *pulIPAddress = ulAddressToLookup;
                 }
+
+                #if ( ipconfigUSE_ARP_HASH == 1 )
+                    else if( eReturn == eCantSendPacket )
+                    {
+                        /* Waiting for a reply: the caller may park the packet
+                         * with the entry of the address that was asked for. */
+                        *pulIPAddress = ulAddressToLookup;
+                    }
+                    else
+                    {
+                        /* A hit. */
+                    }
+                #endif /* ipconfigUSE_ARP_HASH */
             }
         }
     }
@@ -608,6 +766,33 @@ static eARPLookupResult_t prvCacheLookup( uint32_t ulAddressToLookup,
     BaseType_t x;
     eARPLookupResult_t eReturn = eARPCacheMiss;
 
+    #if ( ipconfigUSE_ARP_HASH == 1 )
+        {
+            ulARPLookups++;
+            x = prvARPHashFind( ulAddressToLookup );
+
+            if( x < 0 )
+            {
+                ulARPMisses++;
+            }
+            else if( xARPCache[ x ].ucValid == ( uint8_t ) pdFALSE )
+            {
+                /* This entry is waiting an ARP reply, so is not valid. */
+                ulARPPendingHits++;
+                eReturn = eCantSendPacket;
+            }
+            else
+            {
+                ulARPHits++;
+                ( void ) memcpy( pxMACAddress->ucBytes, xARPCache[ x ].xMACAddress.ucBytes, sizeof( MACAddress_t ) );
+                eReturn = eARPCacheHit;
+
+                /* Keep the entry from being replaced, it is in use. */
+                prvARPListRemove( &xARPUseList, x, pdTRUE );
+                prvARPListAppend( &xARPUseList, x, pdTRUE );
+            }
+        }
+    #else /* if ( ipconfigUSE_ARP_HASH == 1 ) */
     /* Loop through each entry in the ARP cache. */
     for( x = 0; x < ipconfigARP_CACHE_ENTRIES; x++ )
     {
@@ -631,11 +816,459 @@ static eARPLookupResult_t prvCacheLookup( uint32_t ulAddressToLookup,
             break;
         }
     }
+    #endif /* if ( ipconfigUSE_ARP_HASH == 1 ) */
 
     return eReturn;
 }
 /*-----------------------------------------------------------*/
 
+#if ( ipconfigUSE_ARP_HASH == 1 )
+
+/**
+ * @brief Find the row that holds an IP address, by probing the index from the
+ *        slot the address hashes to until an empty slot.
+ *
+ * @param[in] ulIPAddress: The IP address to look for.
+ *
+ * @return The row number, or -1 when the address is not in the cache.
+ */
+    static BaseType_t prvARPHashFind( uint32_t ulIPAddress )
+    {
+        uint32_t ulSlot = arpHASH_SLOT( ulIPAddress );
+        BaseType_t xReturn = -1;
+
+        ulARPSearches++;
+
+        while( usARPHashSlots[ ulSlot ] != 0U )
+        {
+            ulARPProbes++;
+
+            if( xARPCache[ arpROW( usARPHashSlots[ ulSlot ] ) ].ulIPAddress == ulIPAddress )
+            {
+                xReturn = arpROW( usARPHashSlots[ ulSlot ] );
+                break;
+            }
+
+            ulSlot = ( ulSlot + 1UL ) & ( ( uint32_t ) ipconfigARP_HASH_SLOTS - 1UL );
+        }
+
+        return xReturn;
+    }
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Add an entry for an IP address, or refresh the one there is.
+ *
+ * @param[in] pxMACAddress: The MAC address that was seen for the IP address,
+ *                          or NULL to reserve an entry that waits for an ARP
+ *                          reply.
+ * @param[in] ulIPAddress: The IP address.
+ */
+    static void prvARPHashRefresh( const MACAddress_t * pxMACAddress,
+                                   const uint32_t ulIPAddress )
+    {
+        BaseType_t x;
+        BaseType_t xWasWaiting;
+
+        if( ulIPAddress != 0UL )
+        {
+            x = prvARPHashFind( ulIPAddress );
+
+            if( x < 0 )
+            {
+                x = prvARPNewRow( ulIPAddress );
+
+                if( pxMACAddress == NULL )
+                {
+                    /* The ARP timer will retransmit the request for this
+                     * entry. */
+                    xARPCache[ x ].ucAge = ( uint8_t ) ipconfigMAX_ARP_RETRANSMISSIONS;
+                    xARPCache[ x ].ucValid = ( uint8_t ) pdFALSE;
+                    prvARPListAppend( &xARPPendingList, x, pdFALSE );
+                }
+                else
+                {
+                    ( void ) memcpy( xARPCache[ x ].xMACAddress.ucBytes, pxMACAddress->ucBytes, sizeof( pxMACAddress->ucBytes ) );
+                    iptraceARP_TABLE_ENTRY_CREATED( ulIPAddress, ( *pxMACAddress ) );
+                    xARPCache[ x ].ucAge = ( uint8_t ) ipconfigMAX_ARP_AGE;
+                    xARPCache[ x ].ucValid = ( uint8_t ) pdTRUE;
+                    xARPCache[ x ].usRefreshTime = usARPAgeCount;
+                    prvARPListAppend( &xARPAgeList, x, pdFALSE );
+                }
+            }
+            else if( pxMACAddress != NULL )
+            {
+                xWasWaiting = ( xARPCache[ x ].ucValid == ( uint8_t ) pdFALSE ) ? pdTRUE : pdFALSE;
+
+                if( ( xWasWaiting != pdFALSE ) ||
+                    ( memcmp( xARPCache[ x ].xMACAddress.ucBytes, pxMACAddress->ucBytes, sizeof( pxMACAddress->ucBytes ) ) != 0 ) )
+                {
+                    ( void ) memcpy( xARPCache[ x ].xMACAddress.ucBytes, pxMACAddress->ucBytes, sizeof( pxMACAddress->ucBytes ) );
+                    iptraceARP_TABLE_ENTRY_CREATED( ulIPAddress, ( *pxMACAddress ) );
+                }
+
+                prvARPListRemove( ( xWasWaiting != pdFALSE ) ? &xARPPendingList : &xARPAgeList, x, pdFALSE );
+                xARPCache[ x ].ucAge = ( uint8_t ) ipconfigMAX_ARP_AGE;
+                xARPCache[ x ].ucValid = ( uint8_t ) pdTRUE;
+                xARPCache[ x ].usRefreshTime = usARPAgeCount;
+                prvARPListAppend( &xARPAgeList, x, pdFALSE );
+
+                prvARPListRemove( &xARPUseList, x, pdTRUE );
+                prvARPListAppend( &xARPUseList, x, pdTRUE );
+
+                if( xWasWaiting != pdFALSE )
+                {
+                    prvARPReleaseParked( ulIPAddress, pdTRUE );
+                }
+            }
+            else
+            {
+                /* The address is known or asked for already. */
+            }
+        }
+    }
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Take a row for an IP address that is not in the cache: a free one,
+ *        or else the one of the least recently used entry.
+ *
+ * @param[in] ulIPAddress: The IP address.
+ *
+ * @return The row number, entered in the index and at the end of the list of
+ *         use.  The caller fills it in and enters it in the age or pending
+ *         list.
+ */
+    static BaseType_t prvARPNewRow( uint32_t ulIPAddress )
+    {
+        BaseType_t x;
+        uint32_t ulSlot;
+
+        if( ( usARPFreeRows == 0U ) && ( uxARPUnusedRow >= ( UBaseType_t ) ipconfigARP_CACHE_ENTRIES ) )
+        {
+            ulARPEvictions++;
+            prvARPRemoveRow( arpROW( xARPUseList.usHead ) );
+        }
+
+        if( usARPFreeRows != 0U )
+        {
+            x = arpROW( usARPFreeRows );
+            usARPFreeRows = xARPCache[ x ].xUseLink.usNext;
+        }
+        else
+        {
+            x = ( BaseType_t ) uxARPUnusedRow;
+            uxARPUnusedRow++;
+        }
+
+        ( void ) memset( &( xARPCache[ x ] ), 0, sizeof( ARPCacheRow_t ) );
+        xARPCache[ x ].ulIPAddress = ulIPAddress;
+
+        /* The index has at least twice as many slots as there are rows, so
+         * there is always an empty one. */
+        ulSlot = arpHASH_SLOT( ulIPAddress );
+
+        while( usARPHashSlots[ ulSlot ] != 0U )
+        {
+            ulSlot = ( ulSlot + 1UL ) & ( ( uint32_t ) ipconfigARP_HASH_SLOTS - 1UL );
+        }
+
+        usARPHashSlots[ ulSlot ] = arpLINK( x );
+        prvARPListAppend( &xARPUseList, x, pdTRUE );
+
+        return x;
+    }
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Remove an entry from the cache.  The entries that were placed after
+ *        it in the index, in the same run of occupied slots, are moved back
+ *        into the gap when it lies between their hash slot and their current
+ *        slot, so that searches keep finding them.  Packets that were held for
+ *        the entry are dropped.
+ *
+ * @param[in] x: The row number of the entry.
+ */
+    static void prvARPRemoveRow( BaseType_t x )
+    {
+        const uint32_t ulMask = ( uint32_t ) ipconfigARP_HASH_SLOTS - 1UL;
+        uint32_t ulIPAddress = xARPCache[ x ].ulIPAddress;
+        uint32_t ulHole = arpHASH_SLOT( ulIPAddress );
+        uint32_t ulSlot;
+        uint32_t ulHome;
+
+        while( usARPHashSlots[ ulHole ] != arpLINK( x ) )
+        {
+            ulHole = ( ulHole + 1UL ) & ulMask;
+        }
+
+        ulSlot = ( ulHole + 1UL ) & ulMask;
+
+        while( usARPHashSlots[ ulSlot ] != 0U )
+        {
+            ulHome = arpHASH_SLOT( xARPCache[ arpROW( usARPHashSlots[ ulSlot ] ) ].ulIPAddress );
+
+            if( ( ( ulSlot - ulHome ) & ulMask ) >= ( ( ulSlot - ulHole ) & ulMask ) )
+            {
+                usARPHashSlots[ ulHole ] = usARPHashSlots[ ulSlot ];
+                ulHole = ulSlot;
+            }
+
+            ulSlot = ( ulSlot + 1UL ) & ulMask;
+        }
+
+        usARPHashSlots[ ulHole ] = 0U;
+
+        prvARPListRemove( &xARPUseList, x, pdTRUE );
+
+        if( xARPCache[ x ].ucValid != ( uint8_t ) pdFALSE )
+        {
+            prvARPListRemove( &xARPAgeList, x, pdFALSE );
+        }
+        else
+        {
+            prvARPListRemove( &xARPPendingList, x, pdFALSE );
+            prvARPReleaseParked( ulIPAddress, pdFALSE );
+        }
+
+        ( void ) memset( &( xARPCache[ x ] ), 0, sizeof( ARPCacheRow_t ) );
+        xARPCache[ x ].xUseLink.usNext = usARPFreeRows;
+        usARPFreeRows = arpLINK( x );
+    }
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Append a row at the end of a list of rows.
+ *
+ * @param[in] pxList: The list.
+ * @param[in] x: The row number.
+ * @param[in] xUseLink: pdTRUE for the list of use, pdFALSE for the age and
+ *                      pending lists.
+ */
+    static void prvARPListAppend( ARPRowList_t * pxList,
+                                  BaseType_t x,
+                                  BaseType_t xUseLink )
+    {
+        ARPCacheRowLink_t * pxLink = arpROW_LINK( x, xUseLink );
+
+        pxLink->usPrevious = pxList->usTail;
+        pxLink->usNext = 0U;
+
+        if( pxList->usTail != 0U )
+        {
+            arpROW_LINK( arpROW( pxList->usTail ), xUseLink )->usNext = arpLINK( x );
+        }
+        else
+        {
+            pxList->usHead = arpLINK( x );
+        }
+
+        pxList->usTail = arpLINK( x );
+    }
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Unlink a row from a list of rows.
+ *
+ * @param[in] pxList: The list, which must hold the row.
+ * @param[in] x: The row number.
+ * @param[in] xUseLink: pdTRUE for the list of use, pdFALSE for the age and
+ *                      pending lists.
+ */
+    static void prvARPListRemove( ARPRowList_t * pxList,
+                                  BaseType_t x,
+                                  BaseType_t xUseLink )
+    {
+        ARPCacheRowLink_t * pxLink = arpROW_LINK( x, xUseLink );
+
+        if( pxLink->usPrevious != 0U )
+        {
+            arpROW_LINK( arpROW( pxLink->usPrevious ), xUseLink )->usNext = pxLink->usNext;
+        }
+        else
+        {
+            pxList->usHead = pxLink->usNext;
+        }
+
+        if( pxLink->usNext != 0U )
+        {
+            arpROW_LINK( arpROW( pxLink->usNext ), xUseLink )->usPrevious = pxLink->usPrevious;
+        }
+        else
+        {
+            pxList->usTail = pxLink->usPrevious;
+        }
+
+        pxLink->usPrevious = 0U;
+        pxLink->usNext = 0U;
+    }
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Compute the age of a valid entry.
+ *
+ * @param[in] x: The row number.
+ *
+ * @return ipconfigMAX_ARP_AGE minus the times the cache aged since the entry
+ *         was refreshed, or zero.
+ */
+    static uint8_t prvARPValidAge( BaseType_t x )
+    {
+        uint16_t usAged = ( uint16_t ) ( usARPAgeCount - xARPCache[ x ].usRefreshTime );
+        uint8_t ucReturn = 0U;
+
+        if( usAged < ( uint16_t ) ipconfigMAX_ARP_AGE )
+        {
+            ucReturn = ( uint8_t ) ( ( uint16_t ) ipconfigMAX_ARP_AGE - usAged );
+        }
+
+        return ucReturn;
+    }
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Hold an outgoing packet until the ARP reply it needs comes in.
+ *
+ * @param[in] pxNetworkBuffer: The UDP or ICMP packet, as passed to
+ *                             vProcessGeneratedUDPPacket().
+ * @param[in] ulIPAddress: The address that was looked up for it, which is the
+ *                         gateway for a destination off the network.
+ *
+ * @return pdTRUE when the cache took the packet, pdFALSE when there is no
+ *         entry waiting for ulIPAddress or no room.
+ */
+    BaseType_t xARPParkPacket( NetworkBufferDescriptor_t * const pxNetworkBuffer,
+                               uint32_t ulIPAddress )
+    {
+        BaseType_t xReturn = pdFALSE;
+        BaseType_t x;
+
+        if( !listLIST_IS_INITIALISED( &xARPParkedPackets ) )
+        {
+            vListInitialise( &xARPParkedPackets );
+        }
+
+        if( listCURRENT_LIST_LENGTH( &xARPParkedPackets ) < ( UBaseType_t ) ipconfigARP_MAX_PARKED_PACKETS )
+        {
+            x = prvARPHashFind( ulIPAddress );
+
+            if( ( x >= 0 ) && ( xARPCache[ x ].ucValid == ( uint8_t ) pdFALSE ) )
+            {
+                listSET_LIST_ITEM_VALUE( &( pxNetworkBuffer->xBufferListItem ), ( TickType_t ) ulIPAddress );
+                vListInsertEnd( &xARPParkedPackets, &( pxNetworkBuffer->xBufferListItem ) );
+                xReturn = pdTRUE;
+            }
+        }
+
+        return xReturn;
+    }
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Take the packets that were held for an IP address out of the list,
+ *        in the order they came in, and send or drop them.
+ *
+ * @param[in] ulIPAddress: The address that was looked up for the packets.
+ * @param[in] xSend: pdTRUE when its ARP reply came in, pdFALSE when the entry
+ *                   is gone.
+ */
+    static void prvARPReleaseParked( uint32_t ulIPAddress,
+                                     BaseType_t xSend )
+    {
+        const ListItem_t * pxEnd;
+        ListItem_t * pxIterator;
+        ListItem_t * pxNext;
+        NetworkBufferDescriptor_t * pxNetworkBuffer;
+        IPStackEvent_t xSendEvent;
+
+        if( listLIST_IS_INITIALISED( &xARPParkedPackets ) )
+        {
+            pxEnd = listGET_END_MARKER( &xARPParkedPackets );
+
+            for( pxIterator = listGET_HEAD_ENTRY( &xARPParkedPackets ); pxIterator != pxEnd; pxIterator = pxNext )
+            {
+                pxNext = listGET_NEXT( pxIterator );
+
+                if( listGET_LIST_ITEM_VALUE( pxIterator ) == ( TickType_t ) ulIPAddress )
+                {
+                    pxNetworkBuffer = ipCAST_PTR_TO_TYPE_PTR( NetworkBufferDescriptor_t, listGET_LIST_ITEM_OWNER( pxIterator ) );
+                    ( void ) uxListRemove( pxIterator );
+
+                    if( xSend == pdFALSE )
+                    {
+                        ulARPParkedDropped++;
+                        vReleaseNetworkBufferAndDescriptor( pxNetworkBuffer );
+                    }
+                    else if( xIsCallingFromIPTask() != 0 )
+                    {
+                        ulARPParkedSent++;
+                        vProcessGeneratedUDPPacket( pxNetworkBuffer );
+                    }
+                    else
+                    {
+                        /* Only the IP-task sends, hand it the packet the way
+                         * FreeRTOS_sendto() does. */
+                        xSendEvent.eEventType = eStackTxEvent;
+                        xSendEvent.pvData = pxNetworkBuffer;
+
+                        if( xSendEventStructToIPTask( &xSendEvent, ( TickType_t ) 0U ) == pdPASS )
+                        {
+                            ulARPParkedSent++;
+                        }
+                        else
+                        {
+                            ulARPParkedDropped++;
+                            vReleaseNetworkBufferAndDescriptor( pxNetworkBuffer );
+                        }
+                    }
+                }
+            }
+        }
+    }
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Report how full the ARP cache is and what the lookups cost.
+ *
+ * @param[out] pxStats: Where to write the figures.
+ */
+    void FreeRTOS_GetARPCacheStats( ARPCacheStats_t * pxStats )
+    {
+        uint16_t usNext;
+
+        ( void ) memset( pxStats, 0, sizeof( *pxStats ) );
+        pxStats->uxEntries = ( UBaseType_t ) ipconfigARP_CACHE_ENTRIES;
+        pxStats->uxSlots = ( UBaseType_t ) ipconfigARP_HASH_SLOTS;
+
+        for( usNext = xARPAgeList.usHead; usNext != 0U; usNext = xARPCache[ arpROW( usNext ) ].xAgeLink.usNext )
+        {
+            pxStats->uxValid++;
+        }
+
+        for( usNext = xARPPendingList.usHead; usNext != 0U; usNext = xARPCache[ arpROW( usNext ) ].xAgeLink.usNext )
+        {
+            pxStats->uxPending++;
+        }
+
+        if( listLIST_IS_INITIALISED( &xARPParkedPackets ) )
+        {
+            pxStats->uxParked = listCURRENT_LIST_LENGTH( &xARPParkedPackets );
+        }
+
+        pxStats->ulLookups = ulARPLookups;
+        pxStats->ulHits = ulARPHits;
+        pxStats->ulMisses = ulARPMisses;
+        pxStats->ulPendingHits = ulARPPendingHits;
+        pxStats->ulSearches = ulARPSearches;
+        pxStats->ulProbes = ulARPProbes;
+        pxStats->ulEvictions = ulARPEvictions;
+        pxStats->ulParkedSent = ulARPParkedSent;
+        pxStats->ulParkedDropped = ulARPParkedDropped;
+    }
+/*-----------------------------------------------------------*/
+
+#endif /* ipconfigUSE_ARP_HASH */
+
 /**
  * @brief A call to this function will update (or 'Age') the ARP cache entries.
  *        The function will also try to prevent a removal of entry by sending
@@ -649,6 +1282,55 @@ void vARPAgeCache( void )
     BaseType_t x;
     TickType_t xTimeNow;
 
+    #if ( ipconfigUSE_ARP_HASH == 1 )
+        uint16_t usNext;
+
+        /* Ageing the valid entries is counting, their ages follow from the
+         * count at their last refresh. */
+        usARPAgeCount++;
+
+        /* Entries waiting for a reply: retransmit the ARP request, and give
+         * up on the address after ipconfigMAX_ARP_RETRANSMISSIONS times. */
+        for( usNext = xARPPendingList.usHead; usNext != 0U; )
+        {
+            x = arpROW( usNext );
+            usNext = xARPCache[ x ].xAgeLink.usNext;
+
+            ( xARPCache[ x ].ucAge )--;
+            FreeRTOS_OutputARPRequest( xARPCache[ x ].ulIPAddress );
+
+            if( xARPCache[ x ].ucAge == 0U )
+            {
+                iptraceARP_TABLE_ENTRY_EXPIRED( xARPCache[ x ].ulIPAddress );
+                prvARPRemoveRow( x );
+            }
+        }
+
+        /* Valid entries, from the least recently refreshed, until one that
+         * is not about to expire. */
+        for( usNext = xARPAgeList.usHead; usNext != 0U; )
+        {
+            x = arpROW( usNext );
+            usNext = xARPCache[ x ].xAgeLink.usNext;
+            xARPCache[ x ].ucAge = prvARPValidAge( x );
+
+            if( xARPCache[ x ].ucAge > ( uint8_t ) arpMAX_ARP_AGE_BEFORE_NEW_ARP_REQUEST )
+            {
+                break;
+            }
+
+            /* This entry will get removed soon.  See if the MAC address is
+             * still valid to prevent this happening. */
+            iptraceARP_TABLE_ENTRY_WILL_EXPIRE( xARPCache[ x ].ulIPAddress );
+            FreeRTOS_OutputARPRequest( xARPCache[ x ].ulIPAddress );
+
+            if( xARPCache[ x ].ucAge == 0U )
+            {
+                iptraceARP_TABLE_ENTRY_EXPIRED( xARPCache[ x ].ulIPAddress );
+                prvARPRemoveRow( x );
+            }
+        }
+    #else /* if ( ipconfigUSE_ARP_HASH == 1 ) */
     /* Loop through each entry in the ARP cache. */
     for( x = 0; x < ipconfigARP_CACHE_ENTRIES; x++ )
     {
@@ -685,6 +1367,7 @@ void vARPAgeCache( void )
             }
         }
     }
+    #endif /* if ( ipconfigUSE_ARP_HASH == 1 ) */
 
     xTimeNow = xTaskGetTickCount();
 
@@ -857,6 +1540,29 @@ void vARPGenerateRequestPacket( NetworkBufferDescriptor_t * const pxNetworkBuffe
  */
 void FreeRTOS_ClearARP( void )
 {
+    #if ( ipconfigUSE_ARP_HASH == 1 )
+        {
+            if( listLIST_IS_INITIALISED( &xARPParkedPackets ) )
+            {
+                while( listLIST_IS_EMPTY( &xARPParkedPackets ) == pdFALSE )
+                {
+                    prvARPReleaseParked( ( uint32_t ) listGET_ITEM_VALUE_OF_HEAD_ENTRY( &xARPParkedPackets ), pdFALSE );
+                }
+            }
+            else
+            {
+                vListInitialise( &xARPParkedPackets );
+            }
+
+            ( void ) memset( usARPHashSlots, 0, sizeof( usARPHashSlots ) );
+            ( void ) memset( &xARPUseList, 0, sizeof( xARPUseList ) );
+            ( void ) memset( &xARPAgeList, 0, sizeof( xARPAgeList ) );
+            ( void ) memset( &xARPPendingList, 0, sizeof( xARPPendingList ) );
+            usARPFreeRows = 0U;
+            uxARPUnusedRow = 0U;
+        }
+    #endif /* ipconfigUSE_ARP_HASH */
+
     ( void ) memset( xARPCache, 0, sizeof( xARPCache ) );
 }
 /*-----------------------------------------------------------*/
@@ -928,6 +1634,14 @@ void FreeRTOS_ClearARP( void )
         /* Loop through each entry in the ARP cache. */
         for( x = 0; x < ipconfigARP_CACHE_ENTRIES; x++ )
         {
+            #if ( ipconfigUSE_ARP_HASH == 1 )
+                if( ( xARPCache[ x ].ulIPAddress != 0UL ) && ( xARPCache[ x ].ucValid != ( uint8_t ) pdFALSE ) )
+                {
+                    /* Valid entries are only aged when about to expire. */
+                    xARPCache[ x ].ucAge = prvARPValidAge( x );
+                }
+            #endif
+
             if( ( xARPCache[ x ].ulIPAddress != 0UL ) && ( xARPCache[ x ].ucAge > ( uint8_t ) 0U ) )
             {
                 /* See if the MAC-address also matches, and we're all happy */
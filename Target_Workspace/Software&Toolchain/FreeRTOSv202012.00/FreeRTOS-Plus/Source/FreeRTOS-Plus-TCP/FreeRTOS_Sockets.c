@@ -45,6 +45,7 @@
 #include "FreeRTOS_IP.h"
 #include "FreeRTOS_Sockets.h"
 #include "FreeRTOS_IP_Private.h"
+#include "FreeRTOS_ARP.h"
 #include "FreeRTOS_DNS.h"
 #include "NetworkBufferManagement.h"
 
@@ -142,6 +143,60 @@ static uint16_t prvGetPrivatePortNumber( BaseType_t xProtocol );
 static const ListItem_t * pxListFindListItemWithValue( const List_t * pxList,
                                                        TickType_t xWantedItemValue );
 
+#if ( ipconfigUSE_SOCKET_HASH == 1 )
+
+/*
+ * Find the socket that owns a port in the port table, or NULL.
+ */
+    static FreeRTOS_Socket_t * prvPortHashLookup( BaseType_t xProtocol,
+                                                  TickType_t xPort );
+
+/*
+ * Enter a newly bound socket in the port table, if no other socket of its
+ * protocol owns the port yet.
+ */
+    static void prvPortHashInsert( FreeRTOS_Socket_t * pxSocket );
+
+/*
+ * Take a socket that is being unbound out of the port table, and out of the
+ * connection table.
+ */
+    static void prvSocketHashRemove( FreeRTOS_Socket_t * pxSocket );
+
+    #if ( ipconfigUSE_TCP == 1 )
+
+/*
+ * Unlink a TCP socket from its connection table bucket, if it is in one.
+ */
+        static void prvConnectionHashRemove( FreeRTOS_Socket_t * pxSocket );
+    #endif /* ipconfigUSE_TCP == 1 */
+#endif /* ipconfigUSE_SOCKET_HASH */
+
+#if ( ipconfigUSE_TCP_TIMER_HEAP == 1 )
+
+/*
+ * Make sure the TCP timer heap has room for one more TCP socket.
+ */
+    static BaseType_t prvTCPTimerHeapReserve( void );
+
+/*
+ * Take a TCP socket that is being closed out of the timer heap and out of the
+ * list of sockets to wake up, and give back its room in the heap.
+ */
+    static void prvTCPTimerHeapRelease( FreeRTOS_Socket_t * pxSocket );
+
+/*
+ * Move the socket at position 'uxIndex' of the heap up or down until the heap
+ * is ordered again.
+ */
+    static void prvTCPTimerHeapSift( UBaseType_t uxIndex );
+
+/*
+ * Take the socket at position 'uxIndex' out of the heap.
+ */
+    static void prvTCPTimerHeapRemove( UBaseType_t uxIndex );
+#endif /* ipconfigUSE_TCP_TIMER_HEAP */
+
 /*
  * Return pdTRUE only if pxSocket is valid and bound, as far as can be
  * determined.
@@ -240,6 +295,64 @@ List_t xBoundUDPSocketsList;
 
 #endif /* ipconfigUSE_TCP == 1 */
 
+#if ( ipconfigUSE_SOCKET_HASH == 1 )
+
+/** @brief Bound sockets by protocol and local port.  Only one socket per port
+ *         is entered: the one bound first.  TCP child sockets share the port
+ *         of their listening socket and are only found through
+ *         xConnectionHashTable. */
+    static FreeRTOS_Socket_t * xPortHashTable[ ipconfigSOCKET_HASH_BUCKETS ];
+
+    #if ( ipconfigUSE_TCP == 1 )
+
+/** @brief Bound TCP sockets that are not listening, by local port, remote IP
+ *         and remote port.  Only changed by the IP-task. */
+        static FreeRTOS_Socket_t * xConnectionHashTable[ ipconfigSOCKET_HASH_BUCKETS ];
+    #endif /* ipconfigUSE_TCP == 1 */
+
+/** @brief Lookups made through the tables, and the sockets they compared. */
+    static uint32_t ulSocketHashLookups, ulSocketHashCompares;
+
+/** @brief Mix the key bits, so that neighbouring ports and addresses spread
+ *         over the buckets. */
+    #define socketHASH_MIX( ulKey )    ( ( ( ( ulKey ) * 0x9E3779B1UL ) >> 16 ) & ( ( uint32_t ) ipconfigSOCKET_HASH_BUCKETS - 1UL ) )
+
+/** @brief Port table bucket for a protocol and port number in network byte
+ *         order. */
+    #define socketPORT_HASH( xProtocol, xPort )    socketHASH_MIX( ( ( uint32_t ) ( xPort ) & 0xffffUL ) | ( ( uint32_t ) ( xProtocol ) << 16 ) )
+
+/** @brief Connection table bucket for a local port, remote IP and remote port,
+ *         all in host byte order. */
+    #define socketCONNECTION_HASH( uxLocalPort, ulRemoteIP, uxRemotePort ) \
+    socketHASH_MIX( ( ulRemoteIP ) ^ ( ( ( uint32_t ) ( uxLocalPort ) << 16 ) | ( ( uint32_t ) ( uxRemotePort ) & 0xffffUL ) ) )
+#endif /* ipconfigUSE_SOCKET_HASH */
+
+#if ( ipconfigUSE_TCP_TIMER_HEAP == 1 )
+
+    #if ( configUSE_16_BIT_TICKS == 1 )
+
+/* The expiry times are compared as a signed distance, which must be able to
+ * hold any 'usTimeout'. */
+        #error ipconfigUSE_TCP_TIMER_HEAP needs 32-bit ticks
+    #endif
+
+/** @brief TCP sockets with a running timer, as a binary min-heap on
+ *         'xTimerExpiry' that counts from 1: the parent of position N is at
+ *         N / 2.  Position 0 is not used.  Only accessed with the scheduler
+ *         suspended, as user tasks start timers too. */
+    static FreeRTOS_Socket_t ** pxTCPTimerHeap;
+
+/** @brief Sockets in the heap, the positions allocated for it and the TCP
+ *         sockets that it must be able to hold. */
+    static UBaseType_t uxTCPTimerHeapLength, uxTCPTimerHeapSize, uxTCPTimerHeapSockets;
+
+/** @brief TCP sockets that have events in 'xEventBits' for their owner. */
+    static List_t xTCPWakeUpList;
+
+/** @brief True when expiry time xA comes before xB. */
+    #define socketTIMER_BEFORE( xA, xB )    ( ( ( TickType_t ) ( ( xA ) - ( xB ) ) ) > ( portMAX_DELAY >> 1 ) )
+#endif /* ipconfigUSE_TCP_TIMER_HEAP */
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -291,6 +404,12 @@ void vNetworkSocketsInit( void )
     #if ( ipconfigUSE_TCP == 1 )
         {
             vListInitialise( &xBoundTCPSocketsList );
+
+            #if ( ipconfigUSE_TCP_TIMER_HEAP == 1 )
+                {
+                    vListInitialise( &xTCPWakeUpList );
+                }
+            #endif /* ipconfigUSE_TCP_TIMER_HEAP */
         }
     #endif /* ipconfigUSE_TCP == 1 */
 }
@@ -422,6 +541,16 @@ Socket_t FreeRTOS_socket( BaseType_t xDomain,
                 xReturn = FREERTOS_INVALID_SOCKET;
                 iptraceFAILED_TO_CREATE_EVENT_GROUP();
             }
+
+            #if ( ipconfigUSE_TCP_TIMER_HEAP == 1 )
+                else if( ( xProtocol == FREERTOS_IPPROTO_TCP ) && ( prvTCPTimerHeapReserve() == pdFAIL ) )
+                {
+                    vEventGroupDelete( xEventGroup );
+                    vPortFreeSocket( pxSocket );
+                    xReturn = FREERTOS_INVALID_SOCKET;
+                    iptraceFAILED_TO_CREATE_SOCKET();
+                }
+            #endif /* ipconfigUSE_TCP_TIMER_HEAP */
             else
             {
                 if( xProtocol == FREERTOS_IPPROTO_UDP )
@@ -456,6 +585,12 @@ Socket_t FreeRTOS_socket( BaseType_t xDomain,
                 vListInitialiseItem( &( pxSocket->xBoundSocketListItem ) );
                 listSET_LIST_ITEM_OWNER( &( pxSocket->xBoundSocketListItem ), ipPOINTER_CAST( void *, pxSocket ) );
 
+                #if ( ipconfigUSE_SOCKET_HASH == 1 )
+                    {
+                        pxSocket->xConnectionHashBucket = -1;
+                    }
+                #endif /* ipconfigUSE_SOCKET_HASH */
+
                 pxSocket->xReceiveBlockTime = ipconfigSOCK_DEFAULT_RECEIVE_BLOCK_TIME;
                 pxSocket->xSendBlockTime = ipconfigSOCK_DEFAULT_SEND_BLOCK_TIME;
                 pxSocket->ucSocketOptions = ( uint8_t ) FREERTOS_SO_UDPCKSUM_OUT;
@@ -484,6 +619,13 @@ Socket_t FreeRTOS_socket( BaseType_t xDomain,
                                 }
                             #endif
 
+                            #if ( ipconfigUSE_TCP_TIMER_HEAP == 1 )
+                                {
+                                    vListInitialiseItem( &( pxSocket->u.xTCP.xWakeListItem ) );
+                                    listSET_LIST_ITEM_OWNER( &( pxSocket->u.xTCP.xWakeListItem ), ipPOINTER_CAST( void *, pxSocket ) );
+                                }
+                            #endif /* ipconfigUSE_TCP_TIMER_HEAP */
+
                             /* The above values are just defaults, and can be overridden by
                              * calling FreeRTOS_setsockopt().  No buffers will be allocated until a
                              * socket is connected and data is exchanged. */
@@ -1374,6 +1516,19 @@ BaseType_t vSocketBind( FreeRTOS_Socket_t * pxSocket,
                     /* Add the socket to 'xBoundUDPSocketsList' or 'xBoundTCPSocketsList' */
                     vListInsertEnd( pxSocketList, &( pxSocket->xBoundSocketListItem ) );
 
+                    #if ( ipconfigUSE_SOCKET_HASH == 1 )
+                        {
+                            prvPortHashInsert( pxSocket );
+
+                            #if ( ipconfigUSE_TCP == 1 )
+                                if( pxSocket->ucProtocol == ( uint8_t ) FREERTOS_IPPROTO_TCP )
+                                {
+                                    vSocketHashUpdate( pxSocket );
+                                }
+                            #endif /* ipconfigUSE_TCP == 1 */
+                        }
+                    #endif /* ipconfigUSE_SOCKET_HASH */
+
                     #if ( ipconfigETHERNET_DRIVER_FILTERS_PACKETS == 1 )
                         {
                             ( void ) xTaskResumeAll();
@@ -1510,6 +1665,12 @@ void * vSocketClose( FreeRTOS_Socket_t * pxSocket )
                 /* In case this is a child socket, make sure the child-count of the
                  * parent socket is decreased. */
                 prvTCPSetSocketCount( pxSocket );
+
+                #if ( ipconfigUSE_TCP_TIMER_HEAP == 1 )
+                    {
+                        prvTCPTimerHeapRelease( pxSocket );
+                    }
+                #endif /* ipconfigUSE_TCP_TIMER_HEAP */
             }
         }
     #endif /* ipconfigUSE_TCP == 1 */
@@ -1529,6 +1690,12 @@ void * vSocketClose( FreeRTOS_Socket_t * pxSocket )
 
         ( void ) uxListRemove( &( pxSocket->xBoundSocketListItem ) );
 
+        #if ( ipconfigUSE_SOCKET_HASH == 1 )
+            {
+                prvSocketHashRemove( pxSocket );
+            }
+        #endif /* ipconfigUSE_SOCKET_HASH */
+
         #if ( ipconfigETHERNET_DRIVER_FILTERS_PACKETS == 1 )
             {
                 ( void ) xTaskResumeAll();
@@ -2015,7 +2182,7 @@ BaseType_t FreeRTOS_setsockopt( Socket_t xSocket,
                            ( pxSocket->u.xTCP.ucTCPState >= ( uint8_t ) eESTABLISHED ) &&
                            ( FreeRTOS_outstanding( pxSocket ) != 0 ) )
                        {
-                           pxSocket->u.xTCP.usTimeout = 1U; /* to set/clear bSendFullSize */
+                           vSocketTimerSet( pxSocket, 1U ); /* to set/clear bSendFullSize */
                            ( void ) xSendEventToIPTask( eTCPTimerEvent );
                        }
                    }
@@ -2039,7 +2206,7 @@ BaseType_t FreeRTOS_setsockopt( Socket_t xSocket,
                        }
 
                        pxSocket->u.xTCP.bits.bWinChange = pdTRUE;
-                       pxSocket->u.xTCP.usTimeout = 1U; /* to set/clear bRxStopped */
+                       vSocketTimerSet( pxSocket, 1U ); /* to set/clear bRxStopped */
                        ( void ) xSendEventToIPTask( eTCPTimerEvent );
                    }
                     xReturn = 0;
@@ -2139,6 +2306,29 @@ static const ListItem_t * pxListFindListItemWithValue( const List_t * pxList,
 {
     const ListItem_t * pxResult = NULL;
 
+    #if ( ipconfigUSE_SOCKET_HASH == 1 )
+        if( ( xIPIsNetworkTaskReady() != pdFALSE ) && ( pxList != NULL ) )
+        {
+            /* Only the bound socket lists are searched, the port table holds
+             * a socket for every port that is in either of them. */
+            BaseType_t xProtocol = ( BaseType_t ) FREERTOS_IPPROTO_UDP;
+            const FreeRTOS_Socket_t * pxSocket;
+
+            #if ( ipconfigUSE_TCP == 1 )
+                if( pxList == &xBoundTCPSocketsList )
+                {
+                    xProtocol = ( BaseType_t ) FREERTOS_IPPROTO_TCP;
+                }
+            #endif /* ipconfigUSE_TCP == 1 */
+
+            pxSocket = prvPortHashLookup( xProtocol, xWantedItemValue );
+
+            if( pxSocket != NULL )
+            {
+                pxResult = &( pxSocket->xBoundSocketListItem );
+            }
+        }
+    #else /* if ( ipconfigUSE_SOCKET_HASH == 1 ) */
     if( ( xIPIsNetworkTaskReady() != pdFALSE ) && ( pxList != NULL ) )
     {
         const ListItem_t * pxIterator;
@@ -2155,12 +2345,232 @@ static const ListItem_t * pxListFindListItemWithValue( const List_t * pxList,
             }
         }
     }
+    #endif /* if ( ipconfigUSE_SOCKET_HASH == 1 ) */
 
     return pxResult;
 } /* Tested */
 
 /*-----------------------------------------------------------*/
 
+#if ( ipconfigUSE_SOCKET_HASH == 1 )
+
+/**
+ * @brief Find the socket owning a port in the port table.
+ *
+ * @param[in] xProtocol: FREERTOS_IPPROTO_TCP/FREERTOS_IPPROTO_UDP.
+ * @param[in] xPort: The port number in network byte order.
+ *
+ * @return The socket that was bound to the port first, or NULL when no socket
+ *         of the protocol is bound to it.
+ */
+    static FreeRTOS_Socket_t * prvPortHashLookup( BaseType_t xProtocol,
+                                                  TickType_t xPort )
+    {
+        FreeRTOS_Socket_t * pxSocket;
+
+        ulSocketHashLookups++;
+
+        for( pxSocket = xPortHashTable[ socketPORT_HASH( xProtocol, xPort ) ];
+             pxSocket != NULL;
+             pxSocket = pxSocket->pxPortHashNext )
+        {
+            ulSocketHashCompares++;
+
+            if( ( socketGET_SOCKET_PORT( pxSocket ) == xPort ) &&
+                ( pxSocket->ucProtocol == ( uint8_t ) xProtocol ) )
+            {
+                break;
+            }
+        }
+
+        return pxSocket;
+    }
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Enter a newly bound socket in the port table, unless another socket
+ *        of the same protocol owns the port already (a TCP child socket).
+ *
+ * @param[in] pxSocket: The socket that was just bound.
+ */
+    static void prvPortHashInsert( FreeRTOS_Socket_t * pxSocket )
+    {
+        TickType_t xPort = socketGET_SOCKET_PORT( pxSocket );
+        uint32_t ulBucket = socketPORT_HASH( pxSocket->ucProtocol, xPort );
+
+        if( prvPortHashLookup( ( BaseType_t ) pxSocket->ucProtocol, xPort ) == NULL )
+        {
+            pxSocket->pxPortHashNext = xPortHashTable[ ulBucket ];
+            xPortHashTable[ ulBucket ] = pxSocket;
+        }
+    }
+/*-----------------------------------------------------------*/
+
+    #if ( ipconfigUSE_TCP == 1 )
+
+/**
+ * @brief Unlink a TCP socket from its connection table bucket, if it is in one.
+ *
+ * @param[in] pxSocket: The TCP socket.
+ */
+        static void prvConnectionHashRemove( FreeRTOS_Socket_t * pxSocket )
+        {
+            if( pxSocket->xConnectionHashBucket >= 0 )
+            {
+                FreeRTOS_Socket_t ** ppxLink = &( xConnectionHashTable[ pxSocket->xConnectionHashBucket ] );
+
+                while( *ppxLink != pxSocket )
+                {
+                    ppxLink = &( ( *ppxLink )->pxConnectionHashNext );
+                }
+
+                *ppxLink = pxSocket->pxConnectionHashNext;
+                pxSocket->xConnectionHashBucket = -1;
+            }
+        }
+    #endif /* ipconfigUSE_TCP == 1 */
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Take a socket that is being unbound out of the hash tables.  When
+ *        it owned a TCP port that child sockets still use, one of them takes
+ *        over the port, so the port stays in use until the last one is closed.
+ *
+ * @param[in] pxSocket: The socket, already removed from its bound socket list.
+ */
+    static void prvSocketHashRemove( FreeRTOS_Socket_t * pxSocket )
+    {
+        TickType_t xPort = socketGET_SOCKET_PORT( pxSocket );
+        FreeRTOS_Socket_t ** ppxLink = &( xPortHashTable[ socketPORT_HASH( pxSocket->ucProtocol, xPort ) ] );
+
+        while( ( *ppxLink != NULL ) && ( *ppxLink != pxSocket ) )
+        {
+            ppxLink = &( ( *ppxLink )->pxPortHashNext );
+        }
+
+        if( *ppxLink != NULL )
+        {
+            *ppxLink = pxSocket->pxPortHashNext;
+
+            #if ( ipconfigUSE_TCP == 1 )
+                if( pxSocket->ucProtocol == ( uint8_t ) FREERTOS_IPPROTO_TCP )
+                {
+                    const ListItem_t * pxEnd = listGET_END_MARKER( &xBoundTCPSocketsList );
+                    const ListItem_t * pxIterator;
+
+                    for( pxIterator = listGET_NEXT( pxEnd );
+                         pxIterator != pxEnd;
+                         pxIterator = listGET_NEXT( pxIterator ) )
+                    {
+                        if( listGET_LIST_ITEM_VALUE( pxIterator ) == xPort )
+                        {
+                            prvPortHashInsert( ipCAST_PTR_TO_TYPE_PTR( FreeRTOS_Socket_t, listGET_LIST_ITEM_OWNER( pxIterator ) ) );
+                            break;
+                        }
+                    }
+                }
+            #endif /* ipconfigUSE_TCP == 1 */
+        }
+
+        #if ( ipconfigUSE_TCP == 1 )
+            {
+                prvConnectionHashRemove( pxSocket );
+            }
+        #endif /* ipconfigUSE_TCP == 1 */
+    }
+/*-----------------------------------------------------------*/
+
+    #if ( ipconfigUSE_TCP == 1 )
+
+/**
+ * @brief Move a bound TCP socket to the connection table bucket of its current
+ *        local port, remote IP and remote port.  A listening socket is left out,
+ *        pxTCPSocketLookup() finds it through the port table.  Called by the
+ *        IP-task after binding, when it sets the remote address of a socket and
+ *        on every state change it makes.  The remote address that
+ *        FreeRTOS_connect() sets from the user's task is picked up by
+ *        prvTCPPrepareConnect(), before the SYN is sent.
+ *
+ * @param[in] pxSocket: The TCP socket.
+ */
+        void vSocketHashUpdate( FreeRTOS_Socket_t * pxSocket )
+        {
+            prvConnectionHashRemove( pxSocket );
+
+            if( socketSOCKET_IS_BOUND( pxSocket ) &&
+                ( pxSocket->u.xTCP.ucTCPState != ( uint8_t ) eTCP_LISTEN ) )
+            {
+                uint32_t ulBucket = socketCONNECTION_HASH( pxSocket->usLocalPort,
+                                                           pxSocket->u.xTCP.ulRemoteIP,
+                                                           pxSocket->u.xTCP.usRemotePort );
+
+                pxSocket->pxConnectionHashNext = xConnectionHashTable[ ulBucket ];
+                xConnectionHashTable[ ulBucket ] = pxSocket;
+                pxSocket->xConnectionHashBucket = ( BaseType_t ) ulBucket;
+            }
+        }
+    #endif /* ipconfigUSE_TCP == 1 */
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Report how full the socket hash tables are and how many sockets the
+ *        lookups compared.
+ *
+ * @param[out] pxStats: Where to write the figures.
+ */
+    void FreeRTOS_GetSocketHashStats( SocketHashStats_t * pxStats )
+    {
+        UBaseType_t uxBucket;
+        UBaseType_t uxChain;
+        const FreeRTOS_Socket_t * pxSocket;
+
+        ( void ) memset( pxStats, 0, sizeof( *pxStats ) );
+        pxStats->uxBuckets = ( UBaseType_t ) ipconfigSOCKET_HASH_BUCKETS;
+
+        for( uxBucket = 0U; uxBucket < ( UBaseType_t ) ipconfigSOCKET_HASH_BUCKETS; uxBucket++ )
+        {
+            uxChain = 0U;
+
+            for( pxSocket = xPortHashTable[ uxBucket ]; pxSocket != NULL; pxSocket = pxSocket->pxPortHashNext )
+            {
+                uxChain++;
+            }
+
+            pxStats->uxPortSockets += uxChain;
+            pxStats->uxPortBucketsUsed += ( uxChain != 0U ) ? 1U : 0U;
+
+            if( uxChain > pxStats->uxPortLongestChain )
+            {
+                pxStats->uxPortLongestChain = uxChain;
+            }
+
+            #if ( ipconfigUSE_TCP == 1 )
+                {
+                    uxChain = 0U;
+
+                    for( pxSocket = xConnectionHashTable[ uxBucket ]; pxSocket != NULL; pxSocket = pxSocket->pxConnectionHashNext )
+                    {
+                        uxChain++;
+                    }
+
+                    pxStats->uxConnectionSockets += uxChain;
+                    pxStats->uxConnectionBucketsUsed += ( uxChain != 0U ) ? 1U : 0U;
+
+                    if( uxChain > pxStats->uxConnectionLongestChain )
+                    {
+                        pxStats->uxConnectionLongestChain = uxChain;
+                    }
+                }
+            #endif /* ipconfigUSE_TCP == 1 */
+        }
+
+        pxStats->ulLookups = ulSocketHashLookups;
+        pxStats->ulCompares = ulSocketHashCompares;
+    }
+
+#endif /* ipconfigUSE_SOCKET_HASH */
+/*-----------------------------------------------------------*/
+
 /**
  * @brief Find the UDP socket corresponding to the port number.
  *
@@ -2744,7 +3154,7 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t * pxSocket )
                 vTCPStateChange( pxSocket, eCONNECT_SYN );
 
                 /* To start an active connect. */
-                pxSocket->u.xTCP.usTimeout = 1U;
+                vSocketTimerSet( pxSocket, 1U );
 
                 if( xSendEventToIPTask( eTCPTimerEvent ) != pdPASS )
                 {
@@ -3178,7 +3588,7 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t * pxSocket )
                         {
                             pxSocket->u.xTCP.bits.bLowWater = pdFALSE;
                             pxSocket->u.xTCP.bits.bWinChange = pdTRUE;
-                            pxSocket->u.xTCP.usTimeout = 1U; /* because bLowWater is cleared. */
+                            vSocketTimerSet( pxSocket, 1U ); /* because bLowWater is cleared. */
                             ( void ) xSendEventToIPTask( eTCPTimerEvent );
                         }
                     }
@@ -3405,7 +3815,7 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t * pxSocket )
 
                     /* Send a message to the IP-task so it can work on this
                     * socket.  Data is sent, let the IP-task work on it. */
-                    pxSocket->u.xTCP.usTimeout = 1U;
+                    vSocketTimerSet( pxSocket, 1U );
 
                     if( xIsCallingFromIPTask() == pdFALSE )
                     {
@@ -3614,7 +4024,7 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t * pxSocket )
             pxSocket->u.xTCP.bits.bUserShutdown = pdTRUE_UNSIGNED;
 
             /* Let the IP-task perform the shutdown of the connection. */
-            pxSocket->u.xTCP.usTimeout = 1U;
+            vSocketTimerSet( pxSocket, 1U );
             ( void ) xSendEventToIPTask( eTCPTimerEvent );
             xResult = 0;
         }
@@ -3638,10 +4048,15 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t * pxSocket )
  *        - Send a keep-alive packet
  *        - Check for timeout (in non-connected states only)
  *
+ *        With ipconfigUSE_TCP_TIMER_HEAP, only the sockets whose timer has
+ *        expired are checked, and only the sockets in xTCPWakeUpList are
+ *        woken up.
+ *
  * @param[in] xWillSleep: Whether the calling task is going to sleep.
  *
  * @return Minimum amount of time before the timer shall expire.
  */
+    #if ( ipconfigUSE_TCP_TIMER_HEAP == 0 )
     TickType_t xTCPTimerCheck( BaseType_t xWillSleep )
     {
         FreeRTOS_Socket_t * pxSocket;
@@ -3717,11 +4132,308 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t * pxSocket )
 
         return xShortest;
     }
+    #else /* if ( ipconfigUSE_TCP_TIMER_HEAP == 0 ) */
+    TickType_t xTCPTimerCheck( BaseType_t xWillSleep )
+    {
+        FreeRTOS_Socket_t * pxSocket;
+        TickType_t xShortest = pdMS_TO_TICKS( ( TickType_t ) ipTCP_TIMER_PERIOD_MS );
+        TickType_t xNow = xTaskGetTickCount();
+        TickType_t xExpiry;
+
+        /* The expired sockets are at the top of the heap.  A socket that gets
+         * a new time-out from xTCPSocketCheck() will expire after 'xNow', so it
+         * is not checked twice. */
+        vTaskSuspendAll();
+
+        while( uxTCPTimerHeapLength > 0U )
+        {
+            pxSocket = pxTCPTimerHeap[ 1 ];
+            xExpiry = pxSocket->u.xTCP.xTimerExpiry;
+
+            if( socketTIMER_BEFORE( xNow, xExpiry ) != pdFALSE )
+            {
+                if( xShortest > ( xExpiry - xNow ) )
+                {
+                    xShortest = xExpiry - xNow;
+                }
+
+                break;
+            }
+
+            pxSocket->u.xTCP.usTimeout = 0U;
+            prvTCPTimerHeapRemove( 1U );
+            ( void ) xTaskResumeAll();
+
+            /* Within this function, the socket might want to send a delayed
+             * ack or send out data or whatever it needs to do.  When it gets
+             * deleted, it is also taken out of xTCPWakeUpList. */
+            ( void ) xTCPSocketCheck( pxSocket );
+
+            vTaskSuspendAll();
+        }
+
+        ( void ) xTaskResumeAll();
+
+        /* In xEventBits the driver may indicate that the socket has
+         * important events for the user.  These are only done just before the
+         * IP-task goes to sleep. */
+        if( listLIST_IS_EMPTY( &xTCPWakeUpList ) == pdFALSE )
+        {
+            if( xWillSleep != pdFALSE )
+            {
+                /* The IP-task is about to go to sleep, so messages can be
+                 * sent to the socket owners. */
+                do
+                {
+                    vTaskSuspendAll();
+                    {
+                        pxSocket = ipCAST_PTR_TO_TYPE_PTR( FreeRTOS_Socket_t, listGET_OWNER_OF_HEAD_ENTRY( &xTCPWakeUpList ) );
+                        ( void ) uxListRemove( &( pxSocket->u.xTCP.xWakeListItem ) );
+                    }
+                    ( void ) xTaskResumeAll();
+
+                    if( pxSocket->xEventBits != 0U )
+                    {
+                        vSocketWakeUpUser( pxSocket );
+                    }
+                } while( listLIST_IS_EMPTY( &xTCPWakeUpList ) == pdFALSE );
+            }
+            else
+            {
+                /* Or else make sure this will be called again to wake-up
+                 * the sockets' owner. */
+                xShortest = ( TickType_t ) 0;
+            }
+        }
+
+        return xShortest;
+    }
+    #endif /* if ( ipconfigUSE_TCP_TIMER_HEAP == 0 ) */
 
 
 #endif /* ipconfigUSE_TCP */
 /*-----------------------------------------------------------*/
 
+#if ( ipconfigUSE_TCP_TIMER_HEAP == 1 )
+
+/**
+ * @brief Start, restart or stop the timer of a TCP socket, and move the
+ *        socket in the TCP timer heap accordingly.  May be called from any
+ *        task.
+ *
+ * @param[in] pxSocket: The TCP socket.
+ * @param[in] usTimeout: Ticks before the socket needs attention, or zero to
+ *                       stop its timer.
+ */
+    void vSocketTimerSet( FreeRTOS_Socket_t * pxSocket,
+                          uint16_t usTimeout )
+    {
+        vTaskSuspendAll();
+        {
+            pxSocket->u.xTCP.usTimeout = usTimeout;
+
+            if( usTimeout == 0U )
+            {
+                if( pxSocket->u.xTCP.uxTimerHeapIndex != 0U )
+                {
+                    prvTCPTimerHeapRemove( pxSocket->u.xTCP.uxTimerHeapIndex );
+                }
+            }
+            else
+            {
+                pxSocket->u.xTCP.xTimerExpiry = xTaskGetTickCount() + ( TickType_t ) usTimeout;
+
+                if( xIsCallingFromIPTask() == pdFALSE )
+                {
+                    /* A user task follows this with an eTCPTimerEvent, to have
+                     * the socket checked straight away.  The scan of all sockets
+                     * counts every check as at least one tick. */
+                    pxSocket->u.xTCP.xTimerExpiry--;
+                }
+
+                if( pxSocket->u.xTCP.uxTimerHeapIndex == 0U )
+                {
+                    /* prvTCPTimerHeapReserve() made room for the socket when
+                     * it was created. */
+                    configASSERT( uxTCPTimerHeapLength < uxTCPTimerHeapSockets );
+                    uxTCPTimerHeapLength++;
+                    pxTCPTimerHeap[ uxTCPTimerHeapLength ] = pxSocket;
+                    pxSocket->u.xTCP.uxTimerHeapIndex = uxTCPTimerHeapLength;
+                }
+
+                prvTCPTimerHeapSift( pxSocket->u.xTCP.uxTimerHeapIndex );
+            }
+        }
+        ( void ) xTaskResumeAll();
+    }
+    /*-----------------------------------------------------------*/
+
+/**
+ * @brief Have the owner of a TCP socket woken up by xTCPTimerCheck(), for the
+ *        events that were just set in its 'xEventBits'.
+ *
+ * @param[in] pxSocket: The TCP socket.
+ */
+    void vSocketWakeUpLater( FreeRTOS_Socket_t * pxSocket )
+    {
+        vTaskSuspendAll();
+        {
+            if( listIS_CONTAINED_WITHIN( &xTCPWakeUpList, &( pxSocket->u.xTCP.xWakeListItem ) ) == pdFALSE )
+            {
+                vListInsertEnd( &xTCPWakeUpList, &( pxSocket->u.xTCP.xWakeListItem ) );
+            }
+        }
+        ( void ) xTaskResumeAll();
+    }
+    /*-----------------------------------------------------------*/
+
+/**
+ * @brief Make room in the TCP timer heap for a TCP socket that is being
+ *        created.  The heap doubles when it is full, so it is only ever
+ *        grown here and never while a timer is started.
+ *
+ * @return pdPASS, or pdFAIL when a larger heap could not be allocated.
+ */
+    static BaseType_t prvTCPTimerHeapReserve( void )
+    {
+        BaseType_t xReturn = pdPASS;
+        FreeRTOS_Socket_t ** pxNewHeap;
+        UBaseType_t uxNewSize;
+
+        vTaskSuspendAll();
+        {
+            /* Position 0 is not used. */
+            if( ( uxTCPTimerHeapSockets + 2U ) > uxTCPTimerHeapSize )
+            {
+                uxNewSize = ( uxTCPTimerHeapSize == 0U ) ? 8U : ( uxTCPTimerHeapSize * 2U );
+                pxNewHeap = ( FreeRTOS_Socket_t ** ) pvPortMalloc( uxNewSize * sizeof( *pxNewHeap ) );
+
+                if( pxNewHeap == NULL )
+                {
+                    xReturn = pdFAIL;
+                }
+                else
+                {
+                    if( pxTCPTimerHeap != NULL )
+                    {
+                        ( void ) memcpy( pxNewHeap, pxTCPTimerHeap, ( uxTCPTimerHeapLength + 1U ) * sizeof( *pxNewHeap ) );
+                        vPortFree( pxTCPTimerHeap );
+                    }
+
+                    pxTCPTimerHeap = pxNewHeap;
+                    uxTCPTimerHeapSize = uxNewSize;
+                }
+            }
+
+            if( xReturn == pdPASS )
+            {
+                uxTCPTimerHeapSockets++;
+            }
+        }
+        ( void ) xTaskResumeAll();
+
+        return xReturn;
+    }
+    /*-----------------------------------------------------------*/
+
+/**
+ * @brief Forget about a TCP socket that is being closed.
+ *
+ * @param[in] pxSocket: The TCP socket.
+ */
+    static void prvTCPTimerHeapRelease( FreeRTOS_Socket_t * pxSocket )
+    {
+        vTaskSuspendAll();
+        {
+            if( pxSocket->u.xTCP.uxTimerHeapIndex != 0U )
+            {
+                prvTCPTimerHeapRemove( pxSocket->u.xTCP.uxTimerHeapIndex );
+            }
+
+            if( listIS_CONTAINED_WITHIN( &xTCPWakeUpList, &( pxSocket->u.xTCP.xWakeListItem ) ) != pdFALSE )
+            {
+                ( void ) uxListRemove( &( pxSocket->u.xTCP.xWakeListItem ) );
+            }
+
+            uxTCPTimerHeapSockets--;
+        }
+        ( void ) xTaskResumeAll();
+    }
+    /*-----------------------------------------------------------*/
+
+/**
+ * @brief Restore the heap order for the socket at a position: move it up
+ *        while it expires before its parent, then down while a child expires
+ *        before it.
+ *
+ * @param[in] uxIndex: The position of the socket.
+ */
+    static void prvTCPTimerHeapSift( UBaseType_t uxIndex )
+    {
+        FreeRTOS_Socket_t * pxSocket = pxTCPTimerHeap[ uxIndex ];
+        TickType_t xExpiry = pxSocket->u.xTCP.xTimerExpiry;
+        UBaseType_t uxPosition = uxIndex;
+        UBaseType_t uxChild;
+
+        while( ( uxPosition > 1U ) &&
+               ( socketTIMER_BEFORE( xExpiry, pxTCPTimerHeap[ uxPosition / 2U ]->u.xTCP.xTimerExpiry ) != pdFALSE ) )
+        {
+            pxTCPTimerHeap[ uxPosition ] = pxTCPTimerHeap[ uxPosition / 2U ];
+            pxTCPTimerHeap[ uxPosition ]->u.xTCP.uxTimerHeapIndex = uxPosition;
+            uxPosition /= 2U;
+        }
+
+        for( ; ; )
+        {
+            uxChild = uxPosition * 2U;
+
+            if( uxChild > uxTCPTimerHeapLength )
+            {
+                break;
+            }
+
+            if( ( uxChild < uxTCPTimerHeapLength ) &&
+                ( socketTIMER_BEFORE( pxTCPTimerHeap[ uxChild + 1U ]->u.xTCP.xTimerExpiry, pxTCPTimerHeap[ uxChild ]->u.xTCP.xTimerExpiry ) != pdFALSE ) )
+            {
+                uxChild++;
+            }
+
+            if( socketTIMER_BEFORE( pxTCPTimerHeap[ uxChild ]->u.xTCP.xTimerExpiry, xExpiry ) == pdFALSE )
+            {
+                break;
+            }
+
+            pxTCPTimerHeap[ uxPosition ] = pxTCPTimerHeap[ uxChild ];
+            pxTCPTimerHeap[ uxPosition ]->u.xTCP.uxTimerHeapIndex = uxPosition;
+            uxPosition = uxChild;
+        }
+
+        pxTCPTimerHeap[ uxPosition ] = pxSocket;
+        pxSocket->u.xTCP.uxTimerHeapIndex = uxPosition;
+    }
+    /*-----------------------------------------------------------*/
+
+/**
+ * @brief Take a socket out of the heap, filling its position with the last
+ *        socket of the heap.
+ *
+ * @param[in] uxIndex: The position of the socket.
+ */
+    static void prvTCPTimerHeapRemove( UBaseType_t uxIndex )
+    {
+        pxTCPTimerHeap[ uxIndex ]->u.xTCP.uxTimerHeapIndex = 0U;
+        uxTCPTimerHeapLength--;
+
+        if( uxIndex <= uxTCPTimerHeapLength )
+        {
+            pxTCPTimerHeap[ uxIndex ] = pxTCPTimerHeap[ uxTCPTimerHeapLength + 1U ];
+            prvTCPTimerHeapSift( uxIndex );
+        }
+    }
+
+#endif /* ipconfigUSE_TCP_TIMER_HEAP */
+/*-----------------------------------------------------------*/
+
 #if ( ipconfigUSE_TCP == 1 )
 
 /**
@@ -3743,40 +4455,76 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t * pxSocket )
                                            uint32_t ulRemoteIP,
                                            UBaseType_t uxRemotePort )
     {
-        const ListItem_t * pxIterator;
         FreeRTOS_Socket_t * pxResult = NULL, * pxListenSocket = NULL;
-        const ListItem_t * pxEnd = listGET_END_MARKER( &xBoundTCPSocketsList );
+
+        #if ( ipconfigUSE_SOCKET_HASH == 0 )
+            const ListItem_t * pxIterator;
+            const ListItem_t * pxEnd = listGET_END_MARKER( &xBoundTCPSocketsList );
+        #endif /* ipconfigUSE_SOCKET_HASH == 0 */
 
         /* Parameter not yet supported. */
         ( void ) ulLocalIP;
 
-        for( pxIterator = listGET_NEXT( pxEnd );
-             pxIterator != pxEnd;
-             pxIterator = listGET_NEXT( pxIterator ) )
-        {
-            FreeRTOS_Socket_t * pxSocket = ipCAST_PTR_TO_TYPE_PTR( FreeRTOS_Socket_t, listGET_LIST_ITEM_OWNER( pxIterator ) );
-
-            if( pxSocket->usLocalPort == ( uint16_t ) uxLocalPort )
+        #if ( ipconfigUSE_SOCKET_HASH == 1 )
             {
-                if( pxSocket->u.xTCP.ucTCPState == ( uint8_t ) eTCP_LISTEN )
+                /* A connected socket is found in the bucket of its 4-tuple, a
+                 * listening socket owns the port in the port table. */
+                ulSocketHashLookups++;
+
+                for( pxResult = xConnectionHashTable[ socketCONNECTION_HASH( uxLocalPort, ulRemoteIP, uxRemotePort ) ];
+                     pxResult != NULL;
+                     pxResult = pxResult->pxConnectionHashNext )
                 {
-                    /* If this is a socket listening to uxLocalPort, remember it
-                     * in case there is no perfect match. */
-                    pxListenSocket = pxSocket;
+                    ulSocketHashCompares++;
+
+                    if( ( pxResult->usLocalPort == ( uint16_t ) uxLocalPort ) &&
+                        ( pxResult->u.xTCP.usRemotePort == ( uint16_t ) uxRemotePort ) &&
+                        ( pxResult->u.xTCP.ulRemoteIP == ulRemoteIP ) &&
+                        ( pxResult->u.xTCP.ucTCPState != ( uint8_t ) eTCP_LISTEN ) )
+                    {
+                        break;
+                    }
                 }
-                else if( ( pxSocket->u.xTCP.usRemotePort == ( uint16_t ) uxRemotePort ) && ( pxSocket->u.xTCP.ulRemoteIP == ulRemoteIP ) )
+
+                if( pxResult == NULL )
                 {
-                    /* For sockets not in listening mode, find a match with
-                     * xLocalPort, ulRemoteIP AND xRemotePort. */
-                    pxResult = pxSocket;
-                    break;
+                    pxListenSocket = prvPortHashLookup( ( BaseType_t ) FREERTOS_IPPROTO_TCP, ( TickType_t ) FreeRTOS_htons( ( uint16_t ) uxLocalPort ) );
+
+                    if( ( pxListenSocket != NULL ) && ( pxListenSocket->u.xTCP.ucTCPState != ( uint8_t ) eTCP_LISTEN ) )
+                    {
+                        pxListenSocket = NULL;
+                    }
                 }
-                else
+            }
+        #else /* if ( ipconfigUSE_SOCKET_HASH == 1 ) */
+            for( pxIterator = listGET_NEXT( pxEnd );
+                 pxIterator != pxEnd;
+                 pxIterator = listGET_NEXT( pxIterator ) )
+            {
+                FreeRTOS_Socket_t * pxSocket = ipCAST_PTR_TO_TYPE_PTR( FreeRTOS_Socket_t, listGET_LIST_ITEM_OWNER( pxIterator ) );
+
+                if( pxSocket->usLocalPort == ( uint16_t ) uxLocalPort )
                 {
-                    /* This 'pxSocket' doesn't match. */
+                    if( pxSocket->u.xTCP.ucTCPState == ( uint8_t ) eTCP_LISTEN )
+                    {
+                        /* If this is a socket listening to uxLocalPort, remember it
+                         * in case there is no perfect match. */
+                        pxListenSocket = pxSocket;
+                    }
+                    else if( ( pxSocket->u.xTCP.usRemotePort == ( uint16_t ) uxRemotePort ) && ( pxSocket->u.xTCP.ulRemoteIP == ulRemoteIP ) )
+                    {
+                        /* For sockets not in listening mode, find a match with
+                         * xLocalPort, ulRemoteIP AND xRemotePort. */
+                        pxResult = pxSocket;
+                        break;
+                    }
+                    else
+                    {
+                        /* This 'pxSocket' doesn't match. */
+                    }
                 }
             }
-        }
+        #endif /* if ( ipconfigUSE_SOCKET_HASH == 1 ) */
 
         if( pxResult == NULL )
         {
@@ -4025,7 +4773,7 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t * pxSocket )
                             pxSocket->u.xTCP.bits.bWinChange = pdTRUE;
 
                             /* bLowWater was reached, send the changed window size. */
-                            pxSocket->u.xTCP.usTimeout = 1U;
+                            vSocketTimerSet( pxSocket, 1U );
                             ( void ) xSendEventToIPTask( eTCPTimerEvent );
                         }
                     }
@@ -4033,6 +4781,7 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t * pxSocket )
                     /* New incoming data is available, wake up the user.   User's
                      * semaphores will be set just before the IP-task goes asleep. */
                     pxSocket->xEventBits |= ( EventBits_t ) eSOCKET_RECEIVE;
+                    vSocketWakeUpLater( pxSocket );
 
                     #if ipconfigSUPPORT_SELECT_FUNCTION == 1
                         {
@@ -4481,6 +5230,58 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t * pxSocket )
                                ( UBaseType_t ) uxMinimum,
                                ( UBaseType_t ) uxCurrent,
                                ( BaseType_t ) ipconfigNUM_NETWORK_BUFFER_DESCRIPTORS ) );
+
+            #if ( ipconfigUSE_SOCKET_HASH == 1 )
+                {
+                    SocketHashStats_t xStats;
+
+                    FreeRTOS_GetSocketHashStats( &xStats );
+                    FreeRTOS_printf( ( "Socket hash: %lu buckets, port %lu in %lu (longest %lu), connection %lu in %lu (longest %lu), %lu compares in %lu lookups\n",
+                                       ( UBaseType_t ) xStats.uxBuckets,
+                                       ( UBaseType_t ) xStats.uxPortSockets,
+                                       ( UBaseType_t ) xStats.uxPortBucketsUsed,
+                                       ( UBaseType_t ) xStats.uxPortLongestChain,
+                                       ( UBaseType_t ) xStats.uxConnectionSockets,
+                                       ( UBaseType_t ) xStats.uxConnectionBucketsUsed,
+                                       ( UBaseType_t ) xStats.uxConnectionLongestChain,
+                                       ( UBaseType_t ) xStats.ulCompares,
+                                       ( UBaseType_t ) xStats.ulLookups ) );
+                }
+            #endif /* ipconfigUSE_SOCKET_HASH */
+
+            #if ( ipconfigUSE_TCP_TIMER_HEAP == 1 )
+                {
+                    /* With the heap, 'tmout' above is the time-out the timer was
+                     * started with, not the time left. */
+                    FreeRTOS_printf( ( "TCP timer heap: %lu running, %lu sockets, room for %lu\n",
+                                       ( UBaseType_t ) uxTCPTimerHeapLength,
+                                       ( UBaseType_t ) uxTCPTimerHeapSockets,
+                                       ( UBaseType_t ) ( ( uxTCPTimerHeapSize > 0U ) ? ( uxTCPTimerHeapSize - 1U ) : 0U ) ) );
+                }
+            #endif /* ipconfigUSE_TCP_TIMER_HEAP */
+
+            #if ( ipconfigUSE_ARP_HASH == 1 )
+                {
+                    ARPCacheStats_t xARPStats;
+
+                    FreeRTOS_GetARPCacheStats( &xARPStats );
+                    FreeRTOS_printf( ( "ARP cache: %lu valid, %lu pending of %lu, %lu slots, %lu evicted\n",
+                                       ( UBaseType_t ) xARPStats.uxValid,
+                                       ( UBaseType_t ) xARPStats.uxPending,
+                                       ( UBaseType_t ) xARPStats.uxEntries,
+                                       ( UBaseType_t ) xARPStats.uxSlots,
+                                       ( UBaseType_t ) xARPStats.ulEvictions ) );
+                    FreeRTOS_printf( ( "ARP lookups: %lu hit, %lu miss, %lu pending, %lu probes in %lu searches; parked %lu, %lu sent, %lu dropped\n",
+                                       ( UBaseType_t ) xARPStats.ulHits,
+                                       ( UBaseType_t ) xARPStats.ulMisses,
+                                       ( UBaseType_t ) xARPStats.ulPendingHits,
+                                       ( UBaseType_t ) xARPStats.ulProbes,
+                                       ( UBaseType_t ) xARPStats.ulSearches,
+                                       ( UBaseType_t ) xARPStats.uxParked,
+                                       ( UBaseType_t ) xARPStats.ulParkedSent,
+                                       ( UBaseType_t ) xARPStats.ulParkedDropped ) );
+                }
+            #endif /* ipconfigUSE_ARP_HASH */
         }
     }
 
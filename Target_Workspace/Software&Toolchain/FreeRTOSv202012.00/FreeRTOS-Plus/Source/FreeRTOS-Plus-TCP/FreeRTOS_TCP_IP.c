@@ -1106,6 +1106,14 @@
             }
         #endif /* ipconfigHAS_PRINTF != 0 */
 
+        #if ( ipconfigUSE_SOCKET_HASH == 1 )
+            {
+                /* FreeRTOS_connect() has set the remote address from the user's
+                 * task, file the socket under it before the SYN goes out. */
+                vSocketHashUpdate( pxSocket );
+            }
+        #endif /* ipconfigUSE_SOCKET_HASH */
+
         ulRemoteIP = FreeRTOS_htonl( pxSocket->u.xTCP.ulRemoteIP );
 
         /* Determine the ARP cache status for the requested IP address. */
@@ -1528,6 +1536,7 @@
                 /* Just advancing the tail index, 'ulCount' bytes have been confirmed. */
                 ( void ) uxStreamBufferGet( pxSocket->u.xTCP.txStream, 0, NULL, ( size_t ) ulCount, pdFALSE );
                 pxSocket->xEventBits |= ( EventBits_t ) eSOCKET_SEND;
+                vSocketWakeUpLater( pxSocket );
 
                 #if ipconfigSUPPORT_SELECT_FUNCTION == 1
                     {
@@ -1732,6 +1741,7 @@
                         }
 
                         xParent->xEventBits |= ( EventBits_t ) eSOCKET_ACCEPT;
+                        vSocketWakeUpLater( xParent );
 
                         #if ( ipconfigSUPPORT_SELECT_FUNCTION == 1 )
                             {
@@ -1769,6 +1779,7 @@
                 else
                 {
                     pxSocket->xEventBits |= ( EventBits_t ) eSOCKET_CONNECT;
+                    vSocketWakeUpLater( pxSocket );
 
                     #if ( ipconfigSUPPORT_SELECT_FUNCTION == 1 )
                         {
@@ -1784,6 +1795,7 @@
             {
                 /* Notify/wake-up the socket-owner by setting a semaphore. */
                 pxSocket->xEventBits |= ( EventBits_t ) eSOCKET_CLOSED;
+                vSocketWakeUpLater( pxSocket );
 
                 #if ( ipconfigSUPPORT_SELECT_FUNCTION == 1 )
                     {
@@ -1811,7 +1823,7 @@
                  * won't need further attention of the IP-task.
                  * Setting time-out to zero means that the socket won't get checked during
                  * timer events. */
-                pxSocket->u.xTCP.usTimeout = 0U;
+                vSocketTimerSet( pxSocket, 0U );
             }
         }
         else
@@ -1837,6 +1849,18 @@
         /* Fill in the new state. */
         pxSocket->u.xTCP.ucTCPState = ( uint8_t ) eTCPState;
 
+        #if ( ipconfigUSE_SOCKET_HASH == 1 )
+            {
+                /* FreeRTOS_connect(), FreeRTOS_listen() and FreeRTOS_shutdown()
+                 * change the state from the user's task, the connection table
+                 * is only changed by the IP-task. */
+                if( xIsCallingFromIPTask() == pdTRUE )
+                {
+                    vSocketHashUpdate( pxSocket );
+                }
+            }
+        #endif /* ipconfigUSE_SOCKET_HASH */
+
         /* Touch the alive timers because moving to another state. */
         prvTCPTouchSocket( pxSocket );
 
@@ -2154,7 +2178,7 @@
                             }
 
                             pxSocket->u.xTCP.bits.bSendKeepAlive = pdTRUE_UNSIGNED;
-                            pxSocket->u.xTCP.usTimeout = ( ( uint16_t ) pdMS_TO_TICKS( 2500U ) );
+                            vSocketTimerSet( pxSocket, ( uint16_t ) pdMS_TO_TICKS( 2500U ) );
                             pxSocket->u.xTCP.ucKeepRepCount++;
                         }
                     }
@@ -2222,7 +2246,7 @@
             FreeRTOS_debug_printf( ( "Connect[%lxip:%u]: next timeout %u: %lu ms\n",
                                      pxSocket->u.xTCP.ulRemoteIP, pxSocket->u.xTCP.usRemotePort,
                                      pxSocket->u.xTCP.ucRepCount, ulDelayMs ) );
-            pxSocket->u.xTCP.usTimeout = ( uint16_t ) ipMS_TO_MIN_TICKS( ulDelayMs );
+            vSocketTimerSet( pxSocket, ( uint16_t ) ipMS_TO_MIN_TICKS( ulDelayMs ) );
         }
         else if( pxSocket->u.xTCP.usTimeout == 0U )
         {
@@ -2245,7 +2269,7 @@
                 /* ulDelayMs contains the time to wait before a re-transmission. */
             }
 
-            pxSocket->u.xTCP.usTimeout = ( uint16_t ) ipMS_TO_MIN_TICKS( ulDelayMs );
+            vSocketTimerSet( pxSocket, ( uint16_t ) ipMS_TO_MIN_TICKS( ulDelayMs ) );
         }
         else
         {
@@ -2852,6 +2876,7 @@
                 if( uxStreamBufferGet( pxSocket->u.xTCP.txStream, 0U, NULL, ( size_t ) ulCount, pdFALSE ) != 0U )
                 {
                     pxSocket->xEventBits |= ( EventBits_t ) eSOCKET_SEND;
+                    vSocketWakeUpLater( pxSocket );
 
                     #if ipconfigSUPPORT_SELECT_FUNCTION == 1
                         {
@@ -3048,14 +3073,14 @@
                     if( ( ulReceiveLength < ( uint32_t ) pxSocket->u.xTCP.usCurMSS ) ||            /* Received a small message. */
                         ( lRxSpace < ipNUMERIC_CAST( int32_t, 2U * pxSocket->u.xTCP.usCurMSS ) ) ) /* There are less than 2 x MSS space in the Rx buffer. */
                     {
-                        pxSocket->u.xTCP.usTimeout = ( uint16_t ) tcpDELAYED_ACK_SHORT_DELAY_MS;
+                        vSocketTimerSet( pxSocket, ( uint16_t ) tcpDELAYED_ACK_SHORT_DELAY_MS );
                     }
                     else
                     {
                         /* Normally a delayed ACK should wait 200 ms for a next incoming
                          * packet.  Only wait 20 ms here to gain performance.  A slow ACK
                          * for full-size message. */
-                        pxSocket->u.xTCP.usTimeout = ( uint16_t ) ipMS_TO_MIN_TICKS( tcpDELAYED_ACK_LONGER_DELAY_MS );
+                        vSocketTimerSet( pxSocket, ( uint16_t ) ipMS_TO_MIN_TICKS( tcpDELAYED_ACK_LONGER_DELAY_MS ) );
                     }
 
                     if( ( xTCPWindowLoggingLevel > 1 ) && ( ipconfigTCP_MAY_LOG_PORT( pxSocket->usLocalPort ) ) )
@@ -92,6 +92,7 @@ void vProcessGeneratedUDPPacket( NetworkBufferDescriptor_t * const pxNetworkBuff
     eARPLookupResult_t eReturned;
     uint32_t ulIPAddress = pxNetworkBuffer->ulIPAddress;
     size_t uxPayloadSize;
+    BaseType_t xParked = pdFALSE;
     /* memcpy() helper variables for MISRA Rule 21.15 compliance*/
     const void * pvCopySource;
     void * pvCopyDest;
@@ -230,20 +231,43 @@ void vProcessGeneratedUDPPacket( NetworkBufferDescriptor_t * const pxNetworkBuff
              * outstanding, and perform retransmissions if necessary. */
             vARPRefreshCacheEntry( NULL, ulIPAddress );
 
-            /* Generate an ARP for the required IP address. */
-            iptracePACKET_DROPPED_TO_GENERATE_ARP( pxNetworkBuffer->ulIPAddress );
-            pxNetworkBuffer->ulIPAddress = ulIPAddress;
-            vARPGenerateRequestPacket( pxNetworkBuffer );
+            #if ( ipconfigUSE_ARP_HASH == 1 )
+                if( xARPParkPacket( pxNetworkBuffer, ulIPAddress ) != pdFALSE )
+                {
+                    /* The packet waits with the new entry and goes out when
+                     * the reply comes in, ask in a buffer of its own. */
+                    FreeRTOS_OutputARPRequest( ulIPAddress );
+                    xParked = pdTRUE;
+                }
+                else
+            #endif /* ipconfigUSE_ARP_HASH */
+            {
+                /* Generate an ARP for the required IP address. */
+                iptracePACKET_DROPPED_TO_GENERATE_ARP( pxNetworkBuffer->ulIPAddress );
+                pxNetworkBuffer->ulIPAddress = ulIPAddress;
+                vARPGenerateRequestPacket( pxNetworkBuffer );
+            }
         }
         else
         {
             /* The lookup indicated that an ARP request has already been
              * sent out for the queried IP address. */
             eReturned = eCantSendPacket;
+
+            #if ( ipconfigUSE_ARP_HASH == 1 )
+                {
+                    /* Wait for the reply with the entry. */
+                    xParked = xARPParkPacket( pxNetworkBuffer, ulIPAddress );
+                }
+            #endif /* ipconfigUSE_ARP_HASH */
         }
     }
 
-    if( eReturned != eCantSendPacket )
+    if( xParked != pdFALSE )
+    {
+        /* The ARP cache holds the packet now. */
+    }
+    else if( eReturned != eCantSendPacket )
     {
         /* The network driver is responsible for freeing the network buffer
          * after the packet has been sent. */
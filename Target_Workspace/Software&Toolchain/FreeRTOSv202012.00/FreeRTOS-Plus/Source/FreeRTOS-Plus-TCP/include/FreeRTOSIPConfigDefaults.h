@@ -500,6 +500,66 @@
     #define ipconfigETHERNET_DRIVER_FILTERS_PACKETS    ( 0 )
 #endif
 
+/* When set to 1, received packets are matched to their socket through hash
+ * tables instead of by walking the lists of bound sockets: one keyed on the
+ * protocol and local port, for UDP sockets, listening TCP sockets and port
+ * allocation, and one keyed on local port, remote IP and remote port for the
+ * other TCP sockets.  Each table has ipconfigSOCKET_HASH_BUCKETS buckets, a
+ * power of 2, and costs two pointers and a BaseType_t per socket. */
+#ifndef ipconfigUSE_SOCKET_HASH
+    #define ipconfigUSE_SOCKET_HASH    ( 0 )
+#endif
+
+#ifndef ipconfigSOCKET_HASH_BUCKETS
+    #define ipconfigSOCKET_HASH_BUCKETS    ( 64U )
+#endif
+
+#if ( ( ipconfigSOCKET_HASH_BUCKETS & ( ipconfigSOCKET_HASH_BUCKETS - 1U ) ) != 0U )
+    #error ipconfigSOCKET_HASH_BUCKETS must be a power of 2
+#endif
+
+/* When set to 1, TCP sockets with a running timer (retransmission, delayed
+ * ACK, keep-alive, connect) are kept in a binary min-heap ordered on their
+ * expiry time, and sockets with events for their owner in a list.  When the
+ * TCP timer fires, the IP-task only visits the sockets that expired instead of
+ * ageing every bound socket, and the time until the next expiry is read from
+ * the top of the heap.  The heap holds one pointer per TCP socket and grows,
+ * doubling, when a socket is created. */
+#ifndef ipconfigUSE_TCP_TIMER_HEAP
+    #define ipconfigUSE_TCP_TIMER_HEAP    ( 0 )
+#endif
+
+/* When set to 1, the rows of the ARP cache are found through an open-addressed
+ * index of ipconfigARP_HASH_SLOTS slots, a power of 2 of at least twice
+ * ipconfigARP_CACHE_ENTRIES, instead of by scanning the table.  The rows are
+ * also kept in order of use, so that the least recently used one is replaced
+ * when the table is full, and in order of refresh, so that the ARP timer only
+ * visits the entries that wait for a reply or are about to expire.  Up to
+ * ipconfigARP_MAX_PARKED_PACKETS outgoing UDP and ICMP packets that wait for an
+ * ARP reply are held and sent when it arrives, instead of being dropped.  Each
+ * row grows from 12 to 24 bytes, each slot costs 2 bytes. */
+#ifndef ipconfigUSE_ARP_HASH
+    #define ipconfigUSE_ARP_HASH    ( 0 )
+#endif
+
+#ifndef ipconfigARP_HASH_SLOTS
+    #define ipconfigARP_HASH_SLOTS    ( 64U )
+#endif
+
+#ifndef ipconfigARP_MAX_PARKED_PACKETS
+    #define ipconfigARP_MAX_PARKED_PACKETS    ( 4U )
+#endif
+
+#if ( ipconfigUSE_ARP_HASH == 1 )
+    #if ( ( ipconfigARP_HASH_SLOTS & ( ipconfigARP_HASH_SLOTS - 1U ) ) != 0U )
+        #error ipconfigARP_HASH_SLOTS must be a power of 2
+    #endif
+
+    #if ( ipconfigARP_HASH_SLOTS < ( 2U * ipconfigARP_CACHE_ENTRIES ) ) || ( ipconfigARP_HASH_SLOTS > 65536U )
+        #error ipconfigARP_HASH_SLOTS must be at least twice ipconfigARP_CACHE_ENTRIES, and at most 65536
+    #endif
+#endif /* ipconfigUSE_ARP_HASH */
+
 #ifndef ipconfigWATCHDOG_TIMER
 
 /* This macro will be called in every loop the IP-task makes.  It may be
@@ -39,6 +39,19 @@
 /* Miscellaneous structure and definitions. */
 /*-----------------------------------------------------------*/
 
+    #if ( ipconfigUSE_ARP_HASH == 1 )
+
+/**
+ * The neighbours of an ARP cache row in one of the lists of rows, as row
+ * numbers plus one so that zero means none.
+ */
+        typedef struct xARP_CACHE_ROW_LINK
+        {
+            uint16_t usPrevious; /**< The row before this one, or zero for the head. */
+            uint16_t usNext;     /**< The row after this one, or zero for the tail. */
+        } ARPCacheRowLink_t;
+    #endif /* ipconfigUSE_ARP_HASH */
+
 /**
  * Structure for one row in the ARP cache table.
  */
@@ -48,6 +61,11 @@
         MACAddress_t xMACAddress; /**< The MAC address of an ARP cache entry. */
         uint8_t ucAge;            /**< A value that is periodically decremented but can also be refreshed by active communication.  The ARP cache entry is removed if the value reaches zero. */
         uint8_t ucValid;          /**< pdTRUE: xMACAddress is valid, pdFALSE: waiting for ARP reply */
+        #if ( ipconfigUSE_ARP_HASH == 1 )
+            uint16_t usRefreshTime;     /**< The number of times the cache had aged when a valid entry was last refreshed, its ucAge is only brought up to date when it is about to expire. */
+            ARPCacheRowLink_t xUseLink; /**< Position in the list of rows from least to most recently used. */
+            ARPCacheRowLink_t xAgeLink; /**< Position in the list of valid rows from least to most recently refreshed, or in the list of rows waiting for a reply. */
+        #endif
     } ARPCacheRow_t;
 
     typedef enum
@@ -108,6 +126,41 @@
  */
     void vARPAgeCache( void );
 
+    #if ( ipconfigUSE_ARP_HASH == 1 )
+
+/*
+ * Hold an outgoing UDP or ICMP packet until the ARP reply for ulIPAddress, the
+ * address that was looked up for it, comes in.  Returns pdFALSE, and leaves
+ * the packet to the caller, when there is no entry waiting for that reply or
+ * ipconfigARP_MAX_PARKED_PACKETS packets are held already.
+ */
+        BaseType_t xARPParkPacket( NetworkBufferDescriptor_t * const pxNetworkBuffer,
+                                   uint32_t ulIPAddress );
+
+/* How full the ARP cache is and what the lookups cost since boot. */
+        typedef struct xARP_CACHE_STATS
+        {
+            UBaseType_t uxEntries;    /**< Rows in the cache, ipconfigARP_CACHE_ENTRIES. */
+            UBaseType_t uxSlots;      /**< Slots in the index, ipconfigARP_HASH_SLOTS. */
+            UBaseType_t uxValid;      /**< Rows holding a MAC address. */
+            UBaseType_t uxPending;    /**< Rows waiting for an ARP reply. */
+            UBaseType_t uxParked;     /**< Packets held for an ARP reply. */
+            uint32_t ulLookups;       /**< Look-ups of an address to send to. */
+            uint32_t ulHits;          /**< Look-ups that found a MAC address. */
+            uint32_t ulMisses;        /**< Look-ups that found no entry. */
+            uint32_t ulPendingHits;   /**< Look-ups that found an entry waiting for a reply. */
+            uint32_t ulSearches;      /**< Searches of the index, by look-ups and refreshes. */
+            uint32_t ulProbes;        /**< Index slots those searches examined. */
+            uint32_t ulEvictions;     /**< Rows taken from the least recently used entry. */
+            uint32_t ulParkedSent;    /**< Held packets sent when the reply came in. */
+            uint32_t ulParkedDropped; /**< Held packets dropped because their entry expired or was replaced. */
+        } ARPCacheStats_t;
+
+/* Walks the lists of rows without locking them, so the counts are only exact
+ * when called from the IP-task or while it is blocked. */
+        void FreeRTOS_GetARPCacheStats( ARPCacheStats_t * pxStats );
+    #endif /* ipconfigUSE_ARP_HASH */
+
 /*
  * Send out an ARP request for the IP address contained in pxNetworkBuffer, and
  * add an entry into the ARP table that indicates that an ARP reply is
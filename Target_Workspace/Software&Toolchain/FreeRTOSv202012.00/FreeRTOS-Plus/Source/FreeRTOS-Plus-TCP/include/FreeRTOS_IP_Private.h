@@ -697,6 +697,11 @@
             #if ( ipconfigUSE_TCP_WIN == 1 )
                 NetworkBufferDescriptor_t * pxAckMessage; /**< The pointer to the ACK message */
             #endif /* ipconfigUSE_TCP_WIN */
+            #if ( ipconfigUSE_TCP_TIMER_HEAP == 1 )
+                TickType_t xTimerExpiry;                  /**< Tick count at which the timer of 'usTimeout' expires. */
+                UBaseType_t uxTimerHeapIndex;             /**< Position in the TCP timer heap, counting from 1, or 0 when not in it. */
+                ListItem_t xWakeListItem;                 /**< Used to reference the socket from the list of sockets with events for their owner. */
+            #endif /* ipconfigUSE_TCP_TIMER_HEAP */
             LastTCPPacket_t xPacket;                      /**< Buffer space to store the last TCP header received. */
             uint8_t tcpflags;                             /**< TCP flags */
             #if ( ipconfigUSE_TCP_WIN != 0 )
@@ -761,6 +766,11 @@
         EventGroupHandle_t xEventGroup;        /**< The event group for this socket. */
 
         ListItem_t xBoundSocketListItem;       /**< Used to reference the socket from a bound sockets list. */
+        #if ( ipconfigUSE_SOCKET_HASH == 1 )
+            struct xSOCKET * pxPortHashNext;       /**< Next socket in the same bucket of the bound port table. */
+            struct xSOCKET * pxConnectionHashNext; /**< Next socket in the same bucket of the TCP connection table. */
+            BaseType_t xConnectionHashBucket;      /**< The connection table bucket holding the socket, or -1. */
+        #endif /* ipconfigUSE_SOCKET_HASH */
         TickType_t xReceiveBlockTime;          /**< if recv[to] is called while no data is available, wait this amount of time. Unit in clock-ticks */
         TickType_t xSendBlockTime;             /**< if send[to] is called while there is not enough space to send, wait this amount of time. Unit in clock-ticks */
 
@@ -817,6 +827,40 @@
                                                uint32_t ulRemoteIP,
                                                UBaseType_t uxRemotePort );
 
+        #if ( ipconfigUSE_SOCKET_HASH == 1 )
+
+/*
+ * Move a bound TCP socket to the connection table bucket of its current
+ * local port, remote IP and remote port, or take it out of the table while it
+ * is listening.  Only to be called from the IP-task.
+ */
+            void vSocketHashUpdate( FreeRTOS_Socket_t * pxSocket );
+        #endif /* ipconfigUSE_SOCKET_HASH */
+
+        #if ( ipconfigUSE_TCP_TIMER_HEAP == 1 )
+
+/*
+ * Set the timer of a TCP socket to expire after 'usTimeout' ticks, or stop it
+ * when 'usTimeout' is zero, and move the socket in the TCP timer heap.
+ */
+            void vSocketTimerSet( FreeRTOS_Socket_t * pxSocket,
+                                  uint16_t usTimeout );
+
+/*
+ * Remember that a TCP socket has events in 'xEventBits', they will be passed
+ * to its owner when the IP-task is about to sleep.
+ */
+            void vSocketWakeUpLater( FreeRTOS_Socket_t * pxSocket );
+        #else
+
+/*
+ * Without the heap, xTCPTimerCheck() ages the timers of all bound sockets and
+ * finds the ones with events by itself.
+ */
+            #define vSocketTimerSet( pxSocket, usNewTimeout )    ( ( pxSocket )->u.xTCP.usTimeout = ( uint16_t ) ( usNewTimeout ) )
+            #define vSocketWakeUpLater( pxSocket )
+        #endif /* ipconfigUSE_TCP_TIMER_HEAP */
+
     #endif /* ipconfigUSE_TCP */
 
 
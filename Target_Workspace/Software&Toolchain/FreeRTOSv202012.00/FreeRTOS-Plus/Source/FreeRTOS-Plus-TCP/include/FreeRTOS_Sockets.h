@@ -482,6 +482,28 @@
 
     void FreeRTOS_netstat( void );
 
+    #if ( ipconfigUSE_SOCKET_HASH == 1 )
+
+/* The occupancy of the socket hash tables, and the number of sockets that
+ * lookups had to compare since boot. */
+        typedef struct xSOCKET_HASH_STATS
+        {
+            UBaseType_t uxBuckets;                /**< Buckets in each table, ipconfigSOCKET_HASH_BUCKETS. */
+            UBaseType_t uxPortSockets;            /**< Sockets in the port table. */
+            UBaseType_t uxPortBucketsUsed;        /**< Port table buckets holding at least one socket. */
+            UBaseType_t uxPortLongestChain;       /**< Sockets in the fullest port table bucket. */
+            UBaseType_t uxConnectionSockets;      /**< Sockets in the TCP connection table. */
+            UBaseType_t uxConnectionBucketsUsed;  /**< Connection table buckets holding at least one socket. */
+            UBaseType_t uxConnectionLongestChain; /**< Sockets in the fullest connection table bucket. */
+            uint32_t ulLookups;                   /**< Socket lookups made. */
+            uint32_t ulCompares;                  /**< Sockets compared by those lookups. */
+        } SocketHashStats_t;
+
+/* Walks the tables without locking them, so the counts are only exact when
+ * called from the IP-task or while it is blocked. */
+        void FreeRTOS_GetSocketHashStats( SocketHashStats_t * pxStats );
+    #endif /* ipconfigUSE_SOCKET_HASH */
+
     #if ipconfigSUPPORT_SELECT_FUNCTION == 1
 
 /* For FD_SET and FD_CLR, a combination of the following bits can be used: */
@@ -499,7 +499,9 @@ static int prvCreateWorkerThreads( void )
         FreeRTOS_debug_printf( ( "Creating Threads ..\n" ) );
         ret = pdFAIL;
         /* Create event used to signal the  pcap Tx thread. */
-        pvSendEvent = event_create();
+        pvSendEvent = malloc( sizeof( *pvSendEvent ) );
+        configASSERT( pvSendEvent != NULL );
+        event_init( pvSendEvent );
 
         do
         {
@@ -0,0 +1,556 @@
+/*
+ * FreeRTOS+TCP V2.3.2
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/*
+ * Linux network interface over AF_PACKET TPACKET_V3 memory mapped rings.
+ *
+ * An alternative to linux/NetworkInterface.c for simulated nodes attached to
+ * a TAP or veth device, which needs no libpcap.  The socket's RX and TX rings
+ * are mapped into the process:
+ *
+ * - RX: the kernel fills fixed size blocks with frames and hands a block over
+ *   once it is full or niTPACKET_RX_RETIRE_MS has passed.  A FreeRTOS task
+ *   (standing in for the MAC interrupt) copies each frame of a block straight
+ *   from the ring into a network buffer - the only copy on the way in - and,
+ *   with ipconfigUSE_LINKED_RX_MESSAGES, passes the whole block to the IP task
+ *   as one chain.  Polling the ring is a memory read, so the task only calls
+ *   into the host kernel to sleep when the ring is empty.
+ *
+ * - TX: xNetworkInterfaceOutput() copies the frame into the next free TX ring
+ *   slot and marks it for sending.  A pthread kicks the kernel with send(),
+ *   which transmits every marked slot, so frames queued while a kick is in
+ *   progress all go out with the next one.
+ *
+ * The interface is niTPACKET_INTERFACE, or the TPACKET_INTERFACE environment
+ * variable when it is set.  It is put into promiscuous mode, as the node's MAC
+ * address is not the device's own.  Opening an AF_PACKET socket needs
+ * CAP_NET_RAW.
+ */
+
+/* ========================= FreeRTOS includes ============================== */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* ========================= FreeRTOS+TCP includes ========================== */
+#include "FreeRTOS_IP.h"
+#include "FreeRTOS_IP_Private.h"
+#include "NetworkBufferManagement.h"
+#include "linux_tpacket.h"
+
+/* ======================== Standard Library includes ======================== */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <signal.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+
+/* ========================== Local includes =================================*/
+#include <utils/wait_for_event.h>
+
+/* ======================== Macro Definitions =============================== */
+#if ( ipconfigETHERNET_DRIVER_FILTERS_FRAME_TYPES == 0 )
+    #define ipCONSIDER_FRAME_FOR_PROCESSING( pucEthernetBuffer )    eProcessBuffer
+#else
+    #define ipCONSIDER_FRAME_FOR_PROCESSING( pucEthernetBuffer ) \
+    eConsiderFrameForProcessing( ( pucEthernetBuffer ) )
+#endif
+
+/* ============================== Definitions =============================== */
+#ifndef niTPACKET_INTERFACE
+    #define niTPACKET_INTERFACE    "tap0"
+#endif
+#define niTPACKET_INTERFACE_ENV    "TPACKET_INTERFACE"
+
+/* RX ring: niTPACKET_RX_BLOCK_COUNT blocks of niTPACKET_RX_BLOCK_SIZE bytes.
+ * A block holds as many frames as fit, so small frames are handed over many
+ * at a time.  A block that isn't full is handed over after
+ * niTPACKET_RX_RETIRE_MS, which bounds the latency of a lone frame. */
+#ifndef niTPACKET_RX_BLOCK_SIZE
+    #define niTPACKET_RX_BLOCK_SIZE    ( 1U << 16 )
+#endif
+#ifndef niTPACKET_RX_BLOCK_COUNT
+    #define niTPACKET_RX_BLOCK_COUNT    16U
+#endif
+#ifndef niTPACKET_RX_RETIRE_MS
+    #define niTPACKET_RX_RETIRE_MS    1U
+#endif
+
+/* TX ring: niTPACKET_TX_FRAME_COUNT slots of niTPACKET_FRAME_SIZE bytes. */
+#ifndef niTPACKET_TX_FRAME_COUNT
+    #define niTPACKET_TX_FRAME_COUNT    256U
+#endif
+#define niTPACKET_TX_BLOCK_SIZE         ( 1U << 16 )
+
+/* Room for the ring's frame header, the link layer address and a full
+ * Ethernet frame. */
+#define niTPACKET_FRAME_SIZE            2048U
+#define niTPACKET_HEADER_SIZE           ( TPACKET_ALIGN( sizeof( struct tpacket3_hdr ) ) )
+#define niTPACKET_TX_DATA_OFFSET        ( niTPACKET_HEADER_SIZE )
+
+#define niTPACKET_RX_RING_SIZE          ( niTPACKET_RX_BLOCK_SIZE * niTPACKET_RX_BLOCK_COUNT )
+#define niTPACKET_TX_FRAMES_PER_BLOCK   ( niTPACKET_TX_BLOCK_SIZE / niTPACKET_FRAME_SIZE )
+#define niTPACKET_TX_RING_SIZE          ( niTPACKET_TX_FRAME_COUNT * niTPACKET_FRAME_SIZE )
+
+#if ( ( niTPACKET_TX_FRAME_COUNT % niTPACKET_TX_FRAMES_PER_BLOCK ) != 0 )
+    #error niTPACKET_TX_FRAME_COUNT must fill whole blocks of 32 frames
+#endif
+
+/* How long the TX thread waits to be kicked before checking the ring anyway. */
+#define niTPACKET_TX_IDLE_MS            1000
+
+/* ================== Static Function Prototypes ============================ */
+static BaseType_t prvOpenSocket( const char * pcName );
+static BaseType_t prvCreateWorkers( void );
+static void prvRxTask( void * pvParameters );
+static void prvProcessBlock( struct tpacket_block_desc * pxBlock );
+static void prvPassToIPTask( NetworkBufferDescriptor_t * pxBuffer );
+static void * prvTxThread( void * pvParam );
+
+/* ======================== Static Global Variables ========================= */
+static int iSocket = -1;
+static uint8_t * pucRing = NULL;
+static uint8_t * pucTxRing = NULL;
+static UBaseType_t uxRxBlock = 0;
+static UBaseType_t uxTxFrame = 0;
+static struct event xTxEvent;
+static BaseType_t xWorkersCreated = pdFALSE;
+static TPacketStats_t xStats;
+
+/* ======================= API Function definitions ========================= */
+
+/*!
+ * @brief API call, called from FreeRTOS_IP.c to open the interface and map
+ *        its rings
+ * @return pdPASS if successful else pdFAIL
+ */
+BaseType_t xNetworkInterfaceInitialise( void )
+{
+    BaseType_t xReturn = pdPASS;
+    const char * pcName = getenv( niTPACKET_INTERFACE_ENV );
+
+    if( pcName == NULL )
+    {
+        pcName = niTPACKET_INTERFACE;
+    }
+
+    if( iSocket < 0 )
+    {
+        xReturn = prvOpenSocket( pcName );
+    }
+
+    if( ( xReturn == pdPASS ) && ( xWorkersCreated == pdFALSE ) )
+    {
+        xReturn = prvCreateWorkers();
+    }
+
+    return xReturn;
+}
+
+/*!
+ * @brief API call, called from FreeRTOS_IP.c to send a network packet over the
+ *        selected interface
+ * @return pdTRUE if successful else pdFALSE
+ */
+BaseType_t xNetworkInterfaceOutput( NetworkBufferDescriptor_t * const pxNetworkBuffer,
+                                    BaseType_t bReleaseAfterSend )
+{
+    struct tpacket3_hdr * pxFrame;
+    BaseType_t xReturn = pdFALSE;
+
+    iptraceNETWORK_INTERFACE_TRANSMIT();
+    configASSERT( xIsCallingFromIPTask() == pdTRUE );
+
+    pxFrame = ( struct tpacket3_hdr * ) ( pucTxRing + ( uxTxFrame * niTPACKET_FRAME_SIZE ) );
+
+    if( pxNetworkBuffer->xDataLength > ( ipconfigNETWORK_MTU + ipSIZE_OF_ETH_HEADER ) )
+    {
+        FreeRTOS_printf( ( "xNetworkInterfaceOutput: %lu bytes is too long\n",
+                           pxNetworkBuffer->xDataLength ) );
+    }
+    else if( __atomic_load_n( &( pxFrame->tp_status ), __ATOMIC_ACQUIRE ) != TP_STATUS_AVAILABLE )
+    {
+        /* The kernel hasn't sent the frame in this slot yet, so every slot is
+         * in use. */
+        xStats.ullTxRingFull++;
+    }
+    else
+    {
+        memcpy( ( ( uint8_t * ) pxFrame ) + niTPACKET_TX_DATA_OFFSET,
+                pxNetworkBuffer->pucEthernetBuffer,
+                pxNetworkBuffer->xDataLength );
+        pxFrame->tp_len = ( uint32_t ) pxNetworkBuffer->xDataLength;
+        pxFrame->tp_snaplen = ( uint32_t ) pxNetworkBuffer->xDataLength;
+        pxFrame->tp_next_offset = 0;
+        __atomic_store_n( &( pxFrame->tp_status ), TP_STATUS_SEND_REQUEST, __ATOMIC_RELEASE );
+
+        uxTxFrame = ( uxTxFrame + 1U ) % niTPACKET_TX_FRAME_COUNT;
+        xStats.ullTxFrames++;
+        xReturn = pdTRUE;
+    }
+
+    /* Kick the TX thread in either case - a full ring needs sending too. */
+    event_signal( &xTxEvent );
+
+    if( bReleaseAfterSend != pdFALSE )
+    {
+        vReleaseNetworkBufferAndDescriptor( pxNetworkBuffer );
+    }
+
+    return xReturn;
+}
+
+void vTPacketGetStats( TPacketStats_t * pxStats )
+{
+    *pxStats = xStats;
+}
+
+/* ====================== Static Function definitions ======================= */
+
+/*!
+ * @brief open the packet socket on pcName, set up and map its rings
+ * @returns pdPASS on success pdFAIL on failure
+ */
+static BaseType_t prvOpenSocket( const char * pcName )
+{
+    struct tpacket_req3 xRxRequest;
+    struct tpacket_req3 xTxRequest;
+    struct packet_mreq xMembership;
+    struct sockaddr_ll xAddress;
+    int iVersion = TPACKET_V3;
+    int iOne = 1;
+    unsigned int uxIndex;
+    int iFd;
+
+    uxIndex = if_nametoindex( pcName );
+
+    if( uxIndex == 0U )
+    {
+        FreeRTOS_printf( ( "TPACKET: no interface %s\n", pcName ) );
+        return pdFAIL;
+    }
+
+    /* Protocol 0 receives nothing until the socket is bound, after the rings
+     * are in place. */
+    iFd = socket( AF_PACKET, SOCK_RAW, 0 );
+
+    if( iFd < 0 )
+    {
+        FreeRTOS_printf( ( "TPACKET: socket failed %d\n", errno ) );
+        return pdFAIL;
+    }
+
+    memset( &xRxRequest, 0, sizeof( xRxRequest ) );
+    xRxRequest.tp_block_size = niTPACKET_RX_BLOCK_SIZE;
+    xRxRequest.tp_block_nr = niTPACKET_RX_BLOCK_COUNT;
+    xRxRequest.tp_frame_size = niTPACKET_FRAME_SIZE;
+    xRxRequest.tp_frame_nr = ( niTPACKET_RX_BLOCK_SIZE / niTPACKET_FRAME_SIZE ) * niTPACKET_RX_BLOCK_COUNT;
+    xRxRequest.tp_retire_blk_tov = niTPACKET_RX_RETIRE_MS;
+
+    /* The kernel sends from V3 TX rings frame by frame, the block timeout and
+     * private area have to be left at 0. */
+    memset( &xTxRequest, 0, sizeof( xTxRequest ) );
+    xTxRequest.tp_block_size = niTPACKET_TX_BLOCK_SIZE;
+    xTxRequest.tp_block_nr = niTPACKET_TX_FRAME_COUNT / niTPACKET_TX_FRAMES_PER_BLOCK;
+    xTxRequest.tp_frame_size = niTPACKET_FRAME_SIZE;
+    xTxRequest.tp_frame_nr = niTPACKET_TX_FRAME_COUNT;
+
+    if( ( setsockopt( iFd, SOL_PACKET, PACKET_VERSION, &iVersion, sizeof( iVersion ) ) != 0 ) ||
+        ( setsockopt( iFd, SOL_PACKET, PACKET_RX_RING, &xRxRequest, sizeof( xRxRequest ) ) != 0 ) ||
+        ( setsockopt( iFd, SOL_PACKET, PACKET_TX_RING, &xTxRequest, sizeof( xTxRequest ) ) != 0 ) )
+    {
+        FreeRTOS_printf( ( "TPACKET: ring setup failed %d\n", errno ) );
+        close( iFd );
+        return pdFAIL;
+    }
+
+    /* Frames skip the device's queueing discipline - not needed for a TAP or
+     * veth device, and not available on older kernels. */
+    ( void ) setsockopt( iFd, SOL_PACKET, PACKET_QDISC_BYPASS, &iOne, sizeof( iOne ) );
+
+    /* Both rings are in one mapping, RX first. */
+    pucRing = mmap( NULL, niTPACKET_RX_RING_SIZE + niTPACKET_TX_RING_SIZE,
+                    PROT_READ | PROT_WRITE, MAP_SHARED, iFd, 0 );
+
+    if( pucRing == MAP_FAILED )
+    {
+        FreeRTOS_printf( ( "TPACKET: mmap failed %d\n", errno ) );
+        pucRing = NULL;
+        close( iFd );
+        return pdFAIL;
+    }
+
+    pucTxRing = pucRing + niTPACKET_RX_RING_SIZE;
+
+    memset( &xMembership, 0, sizeof( xMembership ) );
+    xMembership.mr_ifindex = ( int ) uxIndex;
+    xMembership.mr_type = PACKET_MR_PROMISC;
+
+    memset( &xAddress, 0, sizeof( xAddress ) );
+    xAddress.sll_family = AF_PACKET;
+    xAddress.sll_protocol = htons( ETH_P_ALL );
+    xAddress.sll_ifindex = ( int ) uxIndex;
+
+    if( ( setsockopt( iFd, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &xMembership, sizeof( xMembership ) ) != 0 ) ||
+        ( bind( iFd, ( struct sockaddr * ) &xAddress, sizeof( xAddress ) ) != 0 ) )
+    {
+        FreeRTOS_printf( ( "TPACKET: could not attach to %s %d\n", pcName, errno ) );
+        munmap( pucRing, niTPACKET_RX_RING_SIZE + niTPACKET_TX_RING_SIZE );
+        pucRing = NULL;
+        close( iFd );
+        return pdFAIL;
+    }
+
+    FreeRTOS_debug_printf( ( "TPACKET: attached to %s\n", pcName ) );
+    iSocket = iFd;
+
+    return pdPASS;
+}
+
+/*!
+ * @brief start the TX pthread and the FreeRTOS task that empties the RX ring
+ * @return pdPASS on success otherwise pdFAIL
+ */
+static BaseType_t prvCreateWorkers( void )
+{
+    pthread_t xTxThread;
+
+    event_init( &xTxEvent );
+
+    if( pthread_create( &xTxThread, NULL, prvTxThread, NULL ) != 0 )
+    {
+        FreeRTOS_printf( ( "TPACKET: pthread_create failed\n" ) );
+        return pdFAIL;
+    }
+
+    if( xTaskCreate( prvRxTask,
+                     "MAC_ISR",
+                     configMINIMAL_STACK_SIZE,
+                     NULL,
+                     configMAC_ISR_SIMULATOR_PRIORITY,
+                     NULL ) != pdPASS )
+    {
+        FreeRTOS_printf( ( "xTaskCreate could not create a new task\n" ) );
+        return pdFAIL;
+    }
+
+    xWorkersCreated = pdTRUE;
+
+    return pdPASS;
+}
+
+/*!
+ * @brief FreeRTOS task that stands in for the MAC interrupt - passes every
+ *        block the kernel hands over to the IP task and returns it to the
+ *        kernel, sleeping a tick whenever the ring is empty
+ * @param [in] pvParameters not used
+ */
+static void prvRxTask( void * pvParameters )
+{
+    struct tpacket_block_desc * pxBlock;
+
+    ( void ) pvParameters;
+
+    for( ; ; )
+    {
+        pxBlock = ( struct tpacket_block_desc * ) ( pucRing + ( uxRxBlock * niTPACKET_RX_BLOCK_SIZE ) );
+
+        if( ( __atomic_load_n( &( pxBlock->hdr.bh1.block_status ), __ATOMIC_ACQUIRE ) & TP_STATUS_USER ) == 0U )
+        {
+            vTaskDelay( configWINDOWS_MAC_INTERRUPT_SIMULATOR_DELAY );
+        }
+        else
+        {
+            prvProcessBlock( pxBlock );
+
+            __atomic_store_n( &( pxBlock->hdr.bh1.block_status ), TP_STATUS_KERNEL, __ATOMIC_RELEASE );
+            uxRxBlock = ( uxRxBlock + 1U ) % niTPACKET_RX_BLOCK_COUNT;
+            xStats.ullRxBlocks++;
+        }
+    }
+}
+
+/*!
+ * @brief copy the frames of one RX block into network buffers, skipping the
+ *        ones the stack doesn't want
+ * @param [in] pxBlock block owned by user space
+ */
+static void prvProcessBlock( struct tpacket_block_desc * pxBlock )
+{
+    struct tpacket3_hdr * pxFrame;
+    const struct sockaddr_ll * pxLink;
+    const uint8_t * pucData;
+    NetworkBufferDescriptor_t * pxBuffer;
+    uint32_t ulFrame;
+    uint32_t ulFrames = pxBlock->hdr.bh1.num_pkts;
+
+    #if ( ipconfigUSE_LINKED_RX_MESSAGES != 0 )
+        NetworkBufferDescriptor_t * pxFirst = NULL;
+        NetworkBufferDescriptor_t * pxLast = NULL;
+    #endif
+
+    pxFrame = ( struct tpacket3_hdr * ) ( ( ( uint8_t * ) pxBlock ) + pxBlock->hdr.bh1.offset_to_first_pkt );
+
+    for( ulFrame = 0; ulFrame < ulFrames; ulFrame++ )
+    {
+        pucData = ( ( const uint8_t * ) pxFrame ) + pxFrame->tp_mac;
+        pxLink = ( const struct sockaddr_ll * ) ( ( ( const uint8_t * ) pxFrame ) + niTPACKET_HEADER_SIZE );
+
+        iptraceNETWORK_INTERFACE_RECEIVE();
+
+        /* The socket sees the node's own transmissions as well. */
+        if( ( pxLink->sll_pkttype == PACKET_OUTGOING ) ||
+            ( pxFrame->tp_snaplen < sizeof( EthernetHeader_t ) ) ||
+            ( pxFrame->tp_snaplen > ipTOTAL_ETHERNET_FRAME_SIZE ) ||
+            ( ipCONSIDER_FRAME_FOR_PROCESSING( pucData ) != eProcessBuffer ) )
+        {
+            xStats.ullRxFiltered++;
+        }
+        else
+        {
+            pxBuffer = pxGetNetworkBufferWithDescriptor( pxFrame->tp_snaplen, 0 );
+
+            if( pxBuffer == NULL )
+            {
+                xStats.ullRxNoBuffer++;
+                iptraceETHERNET_RX_EVENT_LOST();
+            }
+            else
+            {
+                memcpy( pxBuffer->pucEthernetBuffer, pucData, pxFrame->tp_snaplen );
+                pxBuffer->xDataLength = ( size_t ) pxFrame->tp_snaplen;
+                xStats.ullRxFrames++;
+
+                #if ( ipconfigUSE_LINKED_RX_MESSAGES != 0 )
+                    {
+                        pxBuffer->pxNextBuffer = NULL;
+
+                        if( pxLast == NULL )
+                        {
+                            pxFirst = pxBuffer;
+                        }
+                        else
+                        {
+                            pxLast->pxNextBuffer = pxBuffer;
+                        }
+
+                        pxLast = pxBuffer;
+                    }
+                #else
+                    {
+                        prvPassToIPTask( pxBuffer );
+                    }
+                #endif
+            }
+        }
+
+        pxFrame = ( struct tpacket3_hdr * ) ( ( ( uint8_t * ) pxFrame ) + pxFrame->tp_next_offset );
+    }
+
+    #if ( ipconfigUSE_LINKED_RX_MESSAGES != 0 )
+        {
+            if( pxFirst != NULL )
+            {
+                prvPassToIPTask( pxFirst );
+            }
+        }
+    #endif
+}
+
+/*!
+ * @brief send a received buffer (or chain of them) to the IP task, releasing
+ *        it if the IP task's queue is full
+ * @param [in] pxBuffer the first buffer
+ */
+static void prvPassToIPTask( NetworkBufferDescriptor_t * pxBuffer )
+{
+    IPStackEvent_t xRxEvent = { eNetworkRxEvent, NULL };
+
+    xRxEvent.pvData = ( void * ) pxBuffer;
+
+    if( xSendEventStructToIPTask( &xRxEvent, ( TickType_t ) 0 ) == pdFAIL )
+    {
+        #if ( ipconfigUSE_LINKED_RX_MESSAGES != 0 )
+            {
+                NetworkBufferDescriptor_t * pxNext;
+
+                while( pxBuffer != NULL )
+                {
+                    pxNext = pxBuffer->pxNextBuffer;
+                    vReleaseNetworkBufferAndDescriptor( pxBuffer );
+                    pxBuffer = pxNext;
+                }
+            }
+        #else
+            {
+                vReleaseNetworkBufferAndDescriptor( pxBuffer );
+            }
+        #endif
+
+        iptraceETHERNET_RX_EVENT_LOST();
+    }
+}
+
+/*!
+ * @brief Infinite loop thread that waits to be kicked, then has the kernel
+ *        send every frame marked in the TX ring
+ * @param [in] pvParam not used
+ * @returns NULL
+ * @warning this is called from a Linux thread, do not attempt any FreeRTOS calls
+ */
+static void * prvTxThread( void * pvParam )
+{
+    sigset_t set;
+
+    ( void ) pvParam;
+
+    /* disable signals to avoid treating this thread as a FreeRTOS task and putting
+     * it to sleep by the scheduler */
+    sigfillset( &set );
+    pthread_sigmask( SIG_SETMASK, &set, NULL );
+
+    for( ; ; )
+    {
+        event_wait_timed( &xTxEvent, niTPACKET_TX_IDLE_MS );
+
+        /* Sends every slot marked TP_STATUS_SEND_REQUEST, including the ones
+         * marked while this call is under way. */
+        if( send( iSocket, NULL, 0, 0 ) < 0 )
+        {
+            FreeRTOS_printf( ( "TPACKET: send failed %d\n", errno ) );
+        }
+
+        xStats.ullTxKicks++;
+    }
+
+    return NULL;
+}
@@ -0,0 +1,50 @@
+/*
+ * FreeRTOS+TCP V2.3.2
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+#ifndef LINUX_TPACKET_H
+#define LINUX_TPACKET_H
+
+/* Counters kept by the TPACKET_V3 network interface (linux_tpacket/
+ * NetworkInterface.c), for benchmarks and for checking a simulated node is
+ * keeping up with its traffic. */
+
+#include <stdint.h>
+
+typedef struct xTPACKET_STATS
+{
+    uint64_t ullRxFrames;      /* Frames passed to the IP task. */
+    uint64_t ullRxBlocks;      /* RX ring blocks handed back to the kernel. */
+    uint64_t ullRxNoBuffer;    /* Frames dropped for want of a network buffer. */
+    uint64_t ullRxFiltered;    /* Our own transmissions and frames for other MACs. */
+    uint64_t ullTxFrames;      /* Frames placed in the TX ring. */
+    uint64_t ullTxKicks;       /* send() calls made to transmit them. */
+    uint64_t ullTxRingFull;    /* Frames dropped because the TX ring was full. */
+} TPacketStats_t;
+
+/* Copy out the counters.  They are updated without locking, so a copy taken
+ * while traffic flows can be a few frames out. */
+void vTPacketGetStats( TPacketStats_t * pxStats );
+
+#endif /* LINUX_TPACKET_H */
@@ -0,0 +1,895 @@
+/*
+ * FreeRTOS+TCP V2.3.2
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+/*
+ * Linux network interface to a virtual Ethernet switch in shared memory.
+ *
+ * Connects any number of simulated nodes without a host network device,
+ * libpcap or root.  FreeRTOS+TCP and the Posix port keep their state in
+ * globals, so each node is a process of its own; the switch is a POSIX
+ * shared memory object that every node maps (linux_vswitch.h).  There is no
+ * switch process - the sending node does the switching:
+ *
+ * - xNetworkInterfaceOutput() learns the frame's source MAC for the sending
+ *   port, looks up the destination MAC and queues a copy of the frame on the
+ *   port it was learnt on, or on every other port for broadcasts, multicasts
+ *   and MACs not seen yet.  Each port has a ring of niVSWITCH_RING_FRAMES
+ *   frames; a frame for a full ring is dropped, as a switch would.
+ *
+ * - Shaping is applied as the frame is queued: it may be dropped at random,
+ *   and is stamped with the time it is due - after the port's link has sent
+ *   the frames ahead of it at ulBandwidthKbps, plus ulLatencyUs.
+ *
+ * - A FreeRTOS task (standing in for the MAC interrupt) takes the frames that
+ *   are due off its port's ring and passes them to the IP task, chained with
+ *   ipconfigUSE_LINKED_RX_MESSAGES.  With frames queued but not yet due it
+ *   sleeps until the first one is, to the tick.  With none queued it waits to
+ *   be notified: a sender that queues a frame for a port whose task is
+ *   waiting sends niVSWITCH_RX_SIGNAL to the node's process, and the handler
+ *   notifies the task as a MAC interrupt would.  An idle node therefore costs
+ *   no host CPU - with tickless idle its idle task sleeps until the signal
+ *   (see vPortAddInterruptSignal()) - which matters once a test runs more
+ *   nodes than the host has cores.
+ *
+ * The rings and the MAC table are guarded by process shared, robust mutexes:
+ * a node killed while holding one (a reconnect test, say) doesn't hang the
+ * others.  A task only holds one inside a critical section, so the Posix
+ * port can't switch it out while another task waits for the same mutex.
+ */
+
+/* ========================= FreeRTOS includes ============================== */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* ========================= FreeRTOS+TCP includes ========================== */
+#include "FreeRTOS_IP.h"
+#include "FreeRTOS_IP_Private.h"
+#include "NetworkBufferManagement.h"
+#include "linux_vswitch.h"
+
+/* ======================== Standard Library includes ======================== */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* ======================== Macro Definitions =============================== */
+#if ( ipconfigETHERNET_DRIVER_FILTERS_FRAME_TYPES == 0 )
+    #define ipCONSIDER_FRAME_FOR_PROCESSING( pucEthernetBuffer )    eProcessBuffer
+#else
+    #define ipCONSIDER_FRAME_FOR_PROCESSING( pucEthernetBuffer ) \
+    eConsiderFrameForProcessing( ( pucEthernetBuffer ) )
+#endif
+
+/* ============================== Definitions =============================== */
+
+/* Frames each port can have queued. */
+#ifndef niVSWITCH_RING_FRAMES
+    #define niVSWITCH_RING_FRAMES    256U
+#endif
+
+/* MACs the switch can learn, a power of 2.  Frames to MACs that don't fit
+ * are flooded. */
+#ifndef niVSWITCH_MAC_TABLE_SIZE
+    #define niVSWITCH_MAC_TABLE_SIZE    1024U
+#endif
+
+#if ( ( niVSWITCH_MAC_TABLE_SIZE & ( niVSWITCH_MAC_TABLE_SIZE - 1U ) ) != 0 )
+    #error niVSWITCH_MAC_TABLE_SIZE must be a power of 2
+#endif
+
+/* Signal a node is sent when a frame is queued for it while it waits. */
+#ifndef niVSWITCH_RX_SIGNAL
+    #define niVSWITCH_RX_SIGNAL    ( SIGRTMIN + 1 )
+#endif
+
+/* How long a waiting node sleeps without a signal before looking anyway. */
+#define niVSWITCH_RX_IDLE_MS         1000U
+
+/* Frames passed to the IP task in one chain, at most. */
+#define niVSWITCH_RX_BATCH           32U
+
+#define niVSWITCH_FRAME_SIZE         1536U
+#define niVSWITCH_MAGIC              0x76537731UL
+#define niVSWITCH_NO_PORT            ( -1 )
+
+typedef struct xVSWITCH_SLOT
+{
+    uint64_t ullDueNs; /* CLOCK_MONOTONIC time the frame is delivered at. */
+    uint32_t ulLength;
+    uint8_t ucData[ niVSWITCH_FRAME_SIZE ];
+} VSwitchSlot_t;
+
+typedef struct xVSWITCH_PORT
+{
+    pthread_mutex_t xLock; /* Guards the ring and ullLinkFreeNs. */
+    uint32_t ulHead;       /* Oldest queued frame. */
+    uint32_t ulCount;
+    uint64_t ullLinkFreeNs; /* When the link has sent every queued frame. */
+    uint32_t ulLinkUp;
+    int32_t lPid;           /* The node's process. */
+    uint32_t ulRxWaiting;   /* Set while the node waits for the signal. */
+    VSwitchPortStats_t xStats;
+    VSwitchSlot_t xSlots[ niVSWITCH_RING_FRAMES ];
+} VSwitchPort_t;
+
+typedef struct xVSWITCH_MAC_ENTRY
+{
+    uint8_t ucMAC[ ipMAC_ADDRESS_LENGTH_BYTES ];
+    int16_t sPort; /* niVSWITCH_NO_PORT for a free entry. */
+} VSwitchMacEntry_t;
+
+typedef struct xVSWITCH
+{
+    uint32_t ulMagic;
+    uint32_t ulPorts;
+    size_t uxSize;
+    VSwitchShaping_t xShaping;
+    pthread_mutex_t xTableLock;
+    VSwitchMacEntry_t xTable[ niVSWITCH_MAC_TABLE_SIZE ];
+    VSwitchPort_t xPorts[];
+} VSwitch_t;
+
+#define niVSWITCH_SIZE( xPorts )    ( sizeof( VSwitch_t ) + ( ( size_t ) ( xPorts ) * sizeof( VSwitchPort_t ) ) )
+
+/* ================== Static Function Prototypes ============================ */
+static BaseType_t prvMap( const char * pcName );
+static void prvInitMutex( pthread_mutex_t * pxMutex );
+static void prvLock( pthread_mutex_t * pxMutex );
+static uint64_t prvNowNs( void );
+static UBaseType_t prvMACHash( const uint8_t * pucMAC );
+static void prvLearn( const uint8_t * pucMAC, BaseType_t xPort );
+static BaseType_t prvLookup( const uint8_t * pucMAC );
+static void prvQueue( BaseType_t xPort, const uint8_t * pucData, uint32_t ulLength, uint64_t ullNowNs );
+static void prvRxSignalHandler( int iSignal );
+static TickType_t prvTakeFrame( VSwitchPort_t * pxPort, NetworkBufferDescriptor_t * pxBuffer );
+static void prvWaitForFrames( VSwitchPort_t * pxPort, TickType_t xDue );
+static void prvRxTask( void * pvParameters );
+static void prvPassToIPTask( NetworkBufferDescriptor_t * pxBuffer );
+
+/* ======================== Static Global Variables ========================= */
+static VSwitch_t * pxSwitch = NULL;
+static BaseType_t xOurPort = niVSWITCH_NO_PORT;
+static TaskHandle_t xRxTask = NULL;
+
+/* ======================= API Function definitions ========================= */
+
+BaseType_t xVSwitchCreate( const char * pcName,
+                           BaseType_t xPorts,
+                           const VSwitchShaping_t * pxShaping )
+{
+    size_t uxSize = niVSWITCH_SIZE( xPorts );
+    VSwitch_t * pxNew;
+    UBaseType_t ux;
+    int iFd;
+
+    configASSERT( pxSwitch == NULL );
+    configASSERT( ( xPorts > 0 ) && ( xPorts <= INT16_MAX ) );
+
+    iFd = shm_open( pcName, O_RDWR | O_CREAT | O_EXCL, 0600 );
+
+    if( iFd < 0 )
+    {
+        FreeRTOS_printf( ( "VSWITCH: can't create %s %d\n", pcName, errno ) );
+        return pdFAIL;
+    }
+
+    /* The object reads as zeros until it is written, so the rings only take
+     * memory once they have been used. */
+    if( ftruncate( iFd, ( off_t ) uxSize ) != 0 )
+    {
+        FreeRTOS_printf( ( "VSWITCH: can't size %s %d\n", pcName, errno ) );
+        close( iFd );
+        shm_unlink( pcName );
+        return pdFAIL;
+    }
+
+    pxNew = mmap( NULL, uxSize, PROT_READ | PROT_WRITE, MAP_SHARED, iFd, 0 );
+    close( iFd );
+
+    if( pxNew == MAP_FAILED )
+    {
+        FreeRTOS_printf( ( "VSWITCH: mmap failed %d\n", errno ) );
+        shm_unlink( pcName );
+        return pdFAIL;
+    }
+
+    pxNew->ulPorts = ( uint32_t ) xPorts;
+    pxNew->uxSize = uxSize;
+
+    if( pxShaping != NULL )
+    {
+        pxNew->xShaping = *pxShaping;
+    }
+
+    prvInitMutex( &( pxNew->xTableLock ) );
+
+    for( ux = 0; ux < niVSWITCH_MAC_TABLE_SIZE; ux++ )
+    {
+        pxNew->xTable[ ux ].sPort = niVSWITCH_NO_PORT;
+    }
+
+    for( ux = 0; ux < ( UBaseType_t ) xPorts; ux++ )
+    {
+        prvInitMutex( &( pxNew->xPorts[ ux ].xLock ) );
+        pxNew->xPorts[ ux ].ulLinkUp = 1U;
+    }
+
+    /* Attaching checks for the magic number, set it once the rest is in
+     * place. */
+    __atomic_store_n( &( pxNew->ulMagic ), niVSWITCH_MAGIC, __ATOMIC_RELEASE );
+    pxSwitch = pxNew;
+
+    return pdPASS;
+}
+
+BaseType_t xVSwitchAttach( const char * pcName,
+                           BaseType_t xPort )
+{
+    VSwitchPort_t * pxPort;
+
+    if( ( pxSwitch == NULL ) && ( prvMap( pcName ) != pdPASS ) )
+    {
+        return pdFAIL;
+    }
+
+    if( ( xPort < 0 ) || ( xPort >= ( BaseType_t ) pxSwitch->ulPorts ) )
+    {
+        FreeRTOS_printf( ( "VSWITCH: %s has no port %ld\n", pcName, ( long ) xPort ) );
+        return pdFAIL;
+    }
+
+    /* Frames queued for an earlier node on the port are stale. */
+    pxPort = &( pxSwitch->xPorts[ xPort ] );
+    prvLock( &( pxPort->xLock ) );
+    pxPort->ulHead = 0U;
+    pxPort->ulCount = 0U;
+    pxPort->lPid = ( int32_t ) getpid();
+    __atomic_store_n( &( pxPort->ulRxWaiting ), 0U, __ATOMIC_SEQ_CST );
+    pthread_mutex_unlock( &( pxPort->xLock ) );
+
+    xOurPort = xPort;
+
+    return pdPASS;
+}
+
+void vVSwitchDestroy( const char * pcName )
+{
+    if( pxSwitch != NULL )
+    {
+        munmap( pxSwitch, pxSwitch->uxSize );
+        pxSwitch = NULL;
+        xOurPort = niVSWITCH_NO_PORT;
+    }
+
+    shm_unlink( pcName );
+}
+
+void vVSwitchSetShaping( const VSwitchShaping_t * pxShaping )
+{
+    configASSERT( pxSwitch != NULL );
+
+    __atomic_store_n( &( pxSwitch->xShaping.ulLatencyUs ), pxShaping->ulLatencyUs, __ATOMIC_RELAXED );
+    __atomic_store_n( &( pxSwitch->xShaping.ulLossPermille ), pxShaping->ulLossPermille, __ATOMIC_RELAXED );
+    __atomic_store_n( &( pxSwitch->xShaping.ulBandwidthKbps ), pxShaping->ulBandwidthKbps, __ATOMIC_RELAXED );
+}
+
+void vVSwitchSetLink( BaseType_t xPort,
+                      BaseType_t xUp )
+{
+    configASSERT( ( pxSwitch != NULL ) && ( xPort >= 0 ) && ( xPort < ( BaseType_t ) pxSwitch->ulPorts ) );
+
+    __atomic_store_n( &( pxSwitch->xPorts[ xPort ].ulLinkUp ), ( xUp != pdFALSE ) ? 1U : 0U, __ATOMIC_RELAXED );
+}
+
+BaseType_t xVSwitchGetStats( BaseType_t xPort,
+                             VSwitchPortStats_t * pxStats )
+{
+    const VSwitchPortStats_t * pxFrom;
+
+    if( ( pxSwitch == NULL ) || ( xPort < 0 ) || ( xPort >= ( BaseType_t ) pxSwitch->ulPorts ) )
+    {
+        return pdFAIL;
+    }
+
+    pxFrom = &( pxSwitch->xPorts[ xPort ].xStats );
+    pxStats->ullTxFrames = __atomic_load_n( &( pxFrom->ullTxFrames ), __ATOMIC_RELAXED );
+    pxStats->ullFlooded = __atomic_load_n( &( pxFrom->ullFlooded ), __ATOMIC_RELAXED );
+    pxStats->ullRxFrames = __atomic_load_n( &( pxFrom->ullRxFrames ), __ATOMIC_RELAXED );
+    pxStats->ullDropLoss = __atomic_load_n( &( pxFrom->ullDropLoss ), __ATOMIC_RELAXED );
+    pxStats->ullDropFull = __atomic_load_n( &( pxFrom->ullDropFull ), __ATOMIC_RELAXED );
+    pxStats->ullDropLink = __atomic_load_n( &( pxFrom->ullDropLink ), __ATOMIC_RELAXED );
+
+    return pdPASS;
+}
+
+/*!
+ * @brief API call, called from FreeRTOS_IP.c to start the interface.  Fails
+ *        until xVSwitchAttach() has given the node a port.
+ * @return pdPASS if successful else pdFAIL
+ */
+BaseType_t xNetworkInterfaceInitialise( void )
+{
+    struct sigaction xAction;
+
+    if( xOurPort == niVSWITCH_NO_PORT )
+    {
+        FreeRTOS_printf( ( "VSWITCH: not attached to a port\n" ) );
+        return pdFAIL;
+    }
+
+    if( xRxTask == NULL )
+    {
+        /* Handled like the tick, with every other signal masked.  Nothing
+         * sends the signal before the task first waits for it, by which time
+         * xRxTask is set. */
+        memset( &xAction, 0, sizeof( xAction ) );
+        xAction.sa_handler = prvRxSignalHandler;
+        sigfillset( &xAction.sa_mask );
+        configASSERT( sigaction( niVSWITCH_RX_SIGNAL, &xAction, NULL ) == 0 );
+        vPortAddInterruptSignal( niVSWITCH_RX_SIGNAL );
+
+        if( xTaskCreate( prvRxTask,
+                         "MAC_ISR",
+                         configMINIMAL_STACK_SIZE,
+                         NULL,
+                         configMAC_ISR_SIMULATOR_PRIORITY,
+                         &xRxTask ) != pdPASS )
+        {
+            FreeRTOS_printf( ( "xTaskCreate could not create a new task\n" ) );
+            return pdFAIL;
+        }
+    }
+
+    return pdPASS;
+}
+
+/*!
+ * @brief API call, called from FreeRTOS_IP.c to send a network packet - the
+ *        frame is switched to the port(s) it is for
+ * @return pdTRUE if successful else pdFALSE
+ */
+BaseType_t xNetworkInterfaceOutput( NetworkBufferDescriptor_t * const pxNetworkBuffer,
+                                    BaseType_t bReleaseAfterSend )
+{
+    const EthernetHeader_t * pxHeader = ( const EthernetHeader_t * ) pxNetworkBuffer->pucEthernetBuffer;
+    VSwitchPortStats_t * pxStats = &( pxSwitch->xPorts[ xOurPort ].xStats );
+    uint32_t ulLength = ( uint32_t ) pxNetworkBuffer->xDataLength;
+    uint64_t ullNowNs = prvNowNs();
+    BaseType_t xReturn = pdFALSE;
+    BaseType_t xTo;
+
+    iptraceNETWORK_INTERFACE_TRANSMIT();
+
+    if( ( ulLength < sizeof( EthernetHeader_t ) ) || ( ulLength > niVSWITCH_FRAME_SIZE ) )
+    {
+        FreeRTOS_printf( ( "xNetworkInterfaceOutput: %lu bytes is a bad length\n", ( unsigned long ) ulLength ) );
+    }
+    else if( __atomic_load_n( &( pxSwitch->xPorts[ xOurPort ].ulLinkUp ), __ATOMIC_RELAXED ) == 0U )
+    {
+        __atomic_add_fetch( &( pxStats->ullDropLink ), 1U, __ATOMIC_RELAXED );
+    }
+    else
+    {
+        __atomic_add_fetch( &( pxStats->ullTxFrames ), 1U, __ATOMIC_RELAXED );
+        prvLearn( pxHeader->xSourceAddress.ucBytes, xOurPort );
+
+        /* The group bit is set for broadcasts and multicasts. */
+        xTo = niVSWITCH_NO_PORT;
+
+        if( ( pxHeader->xDestinationAddress.ucBytes[ 0 ] & 0x01U ) == 0U )
+        {
+            xTo = prvLookup( pxHeader->xDestinationAddress.ucBytes );
+        }
+
+        if( xTo != niVSWITCH_NO_PORT )
+        {
+            /* A frame for a MAC on its own port goes nowhere. */
+            if( xTo != xOurPort )
+            {
+                prvQueue( xTo, pxNetworkBuffer->pucEthernetBuffer, ulLength, ullNowNs );
+            }
+        }
+        else
+        {
+            __atomic_add_fetch( &( pxStats->ullFlooded ), 1U, __ATOMIC_RELAXED );
+
+            for( xTo = 0; xTo < ( BaseType_t ) pxSwitch->ulPorts; xTo++ )
+            {
+                if( xTo != xOurPort )
+                {
+                    prvQueue( xTo, pxNetworkBuffer->pucEthernetBuffer, ulLength, ullNowNs );
+                }
+            }
+        }
+
+        xReturn = pdTRUE;
+    }
+
+    if( bReleaseAfterSend != pdFALSE )
+    {
+        vReleaseNetworkBufferAndDescriptor( pxNetworkBuffer );
+    }
+
+    return xReturn;
+}
+
+/* ====================== Static Function definitions ======================= */
+
+/*!
+ * @brief map the existing switch pcName into this process
+ * @returns pdPASS on success pdFAIL on failure
+ */
+static BaseType_t prvMap( const char * pcName )
+{
+    VSwitch_t * pxMapped;
+    struct stat xStat;
+    int iFd;
+
+    iFd = shm_open( pcName, O_RDWR, 0 );
+
+    if( ( iFd < 0 ) || ( fstat( iFd, &xStat ) != 0 ) || ( ( size_t ) xStat.st_size < sizeof( VSwitch_t ) ) )
+    {
+        FreeRTOS_printf( ( "VSWITCH: can't open %s %d\n", pcName, errno ) );
+
+        if( iFd >= 0 )
+        {
+            close( iFd );
+        }
+
+        return pdFAIL;
+    }
+
+    pxMapped = mmap( NULL, ( size_t ) xStat.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, iFd, 0 );
+    close( iFd );
+
+    if( pxMapped == MAP_FAILED )
+    {
+        FreeRTOS_printf( ( "VSWITCH: mmap failed %d\n", errno ) );
+        return pdFAIL;
+    }
+
+    if( ( __atomic_load_n( &( pxMapped->ulMagic ), __ATOMIC_ACQUIRE ) != niVSWITCH_MAGIC ) ||
+        ( pxMapped->uxSize != ( size_t ) xStat.st_size ) ||
+        ( pxMapped->uxSize != niVSWITCH_SIZE( pxMapped->ulPorts ) ) )
+    {
+        FreeRTOS_printf( ( "VSWITCH: %s is not a switch built with these settings\n", pcName ) );
+        munmap( pxMapped, ( size_t ) xStat.st_size );
+        return pdFAIL;
+    }
+
+    pxSwitch = pxMapped;
+
+    return pdPASS;
+}
+
+static void prvInitMutex( pthread_mutex_t * pxMutex )
+{
+    pthread_mutexattr_t xAttributes;
+
+    pthread_mutexattr_init( &xAttributes );
+    pthread_mutexattr_setpshared( &xAttributes, PTHREAD_PROCESS_SHARED );
+    pthread_mutexattr_setrobust( &xAttributes, PTHREAD_MUTEX_ROBUST );
+    pthread_mutex_init( pxMutex, &xAttributes );
+    pthread_mutexattr_destroy( &xAttributes );
+}
+
+/*!
+ * @brief lock a switch mutex, taking it over if its owner died holding it.
+ *        What it guards is at worst a frame short, which the protocols above
+ *        put right.
+ */
+static void prvLock( pthread_mutex_t * pxMutex )
+{
+    if( pthread_mutex_lock( pxMutex ) == EOWNERDEAD )
+    {
+        pthread_mutex_consistent( pxMutex );
+    }
+}
+
+static uint64_t prvNowNs( void )
+{
+    struct timespec xNow;
+
+    clock_gettime( CLOCK_MONOTONIC, &xNow );
+
+    return ( ( uint64_t ) xNow.tv_sec * 1000000000ULL ) + ( uint64_t ) xNow.tv_nsec;
+}
+
+/* FNV-1a of the address. */
+static UBaseType_t prvMACHash( const uint8_t * pucMAC )
+{
+    uint32_t ulHash = 2166136261UL;
+    UBaseType_t ux;
+
+    for( ux = 0; ux < ipMAC_ADDRESS_LENGTH_BYTES; ux++ )
+    {
+        ulHash = ( ulHash ^ pucMAC[ ux ] ) * 16777619UL;
+    }
+
+    return ( UBaseType_t ) ulHash & ( niVSWITCH_MAC_TABLE_SIZE - 1U );
+}
+
+/*!
+ * @brief record that pucMAC is reached through xPort.  Entries are never
+ *        removed, a MAC that moves is simply relearnt.
+ */
+static void prvLearn( const uint8_t * pucMAC,
+                      BaseType_t xPort )
+{
+    UBaseType_t uxSlot = prvMACHash( pucMAC );
+    UBaseType_t uxProbe;
+    VSwitchMacEntry_t * pxEntry;
+
+    taskENTER_CRITICAL();
+    prvLock( &( pxSwitch->xTableLock ) );
+
+    for( uxProbe = 0; uxProbe < niVSWITCH_MAC_TABLE_SIZE; uxProbe++ )
+    {
+        pxEntry = &( pxSwitch->xTable[ ( uxSlot + uxProbe ) & ( niVSWITCH_MAC_TABLE_SIZE - 1U ) ] );
+
+        if( pxEntry->sPort == niVSWITCH_NO_PORT )
+        {
+            memcpy( pxEntry->ucMAC, pucMAC, ipMAC_ADDRESS_LENGTH_BYTES );
+            pxEntry->sPort = ( int16_t ) xPort;
+            break;
+        }
+
+        if( memcmp( pxEntry->ucMAC, pucMAC, ipMAC_ADDRESS_LENGTH_BYTES ) == 0 )
+        {
+            pxEntry->sPort = ( int16_t ) xPort;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock( &( pxSwitch->xTableLock ) );
+    taskEXIT_CRITICAL();
+}
+
+/*!
+ * @returns the port pucMAC was learnt on, or niVSWITCH_NO_PORT
+ */
+static BaseType_t prvLookup( const uint8_t * pucMAC )
+{
+    UBaseType_t uxSlot = prvMACHash( pucMAC );
+    UBaseType_t uxProbe;
+    const VSwitchMacEntry_t * pxEntry;
+    BaseType_t xPort = niVSWITCH_NO_PORT;
+
+    taskENTER_CRITICAL();
+    prvLock( &( pxSwitch->xTableLock ) );
+
+    for( uxProbe = 0; uxProbe < niVSWITCH_MAC_TABLE_SIZE; uxProbe++ )
+    {
+        pxEntry = &( pxSwitch->xTable[ ( uxSlot + uxProbe ) & ( niVSWITCH_MAC_TABLE_SIZE - 1U ) ] );
+
+        if( pxEntry->sPort == niVSWITCH_NO_PORT )
+        {
+            break;
+        }
+
+        if( memcmp( pxEntry->ucMAC, pucMAC, ipMAC_ADDRESS_LENGTH_BYTES ) == 0 )
+        {
+            xPort = pxEntry->sPort;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock( &( pxSwitch->xTableLock ) );
+    taskEXIT_CRITICAL();
+
+    return xPort;
+}
+
+/*!
+ * @brief shape a frame and queue a copy of it on xPort's ring
+ */
+static void prvQueue( BaseType_t xPort,
+                      const uint8_t * pucData,
+                      uint32_t ulLength,
+                      uint64_t ullNowNs )
+{
+    VSwitchPort_t * pxPort = &( pxSwitch->xPorts[ xPort ] );
+    uint32_t ulLossPermille = __atomic_load_n( &( pxSwitch->xShaping.ulLossPermille ), __ATOMIC_RELAXED );
+    uint32_t ulKbps = __atomic_load_n( &( pxSwitch->xShaping.ulBandwidthKbps ), __ATOMIC_RELAXED );
+    uint64_t ullLatencyNs = ( uint64_t ) __atomic_load_n( &( pxSwitch->xShaping.ulLatencyUs ), __ATOMIC_RELAXED ) * 1000U;
+    VSwitchSlot_t * pxSlot;
+    uint64_t ullSentNs;
+
+    if( __atomic_load_n( &( pxPort->ulLinkUp ), __ATOMIC_RELAXED ) == 0U )
+    {
+        __atomic_add_fetch( &( pxPort->xStats.ullDropLink ), 1U, __ATOMIC_RELAXED );
+        return;
+    }
+
+    if( ( ulLossPermille != 0U ) && ( ( ipconfigRAND32() % 1000U ) < ulLossPermille ) )
+    {
+        __atomic_add_fetch( &( pxPort->xStats.ullDropLoss ), 1U, __ATOMIC_RELAXED );
+        return;
+    }
+
+    taskENTER_CRITICAL();
+    prvLock( &( pxPort->xLock ) );
+
+    if( pxPort->ulCount == niVSWITCH_RING_FRAMES )
+    {
+        __atomic_add_fetch( &( pxPort->xStats.ullDropFull ), 1U, __ATOMIC_RELAXED );
+    }
+    else
+    {
+        /* The frame goes onto the link once the frames ahead of it are sent,
+         * and takes its length in bits at ulKbps to send. */
+        ullSentNs = ( pxPort->ullLinkFreeNs > ullNowNs ) ? pxPort->ullLinkFreeNs : ullNowNs;
+
+        if( ulKbps != 0U )
+        {
+            ullSentNs += ( ( uint64_t ) ulLength * 8000000ULL ) / ulKbps;
+        }
+
+        pxPort->ullLinkFreeNs = ullSentNs;
+
+        pxSlot = &( pxPort->xSlots[ ( pxPort->ulHead + pxPort->ulCount ) % niVSWITCH_RING_FRAMES ] );
+        memcpy( pxSlot->ucData, pucData, ulLength );
+        pxSlot->ulLength = ulLength;
+        pxSlot->ullDueNs = ullSentNs + ullLatencyNs;
+        pxPort->ulCount++;
+    }
+
+    pthread_mutex_unlock( &( pxPort->xLock ) );
+    taskEXIT_CRITICAL();
+
+    /* Pairs with prvWaitForFrames(): either the node sees the frame when it
+     * looks again after setting ulRxWaiting, or this sees ulRxWaiting. */
+    if( __atomic_exchange_n( &( pxPort->ulRxWaiting ), 0U, __ATOMIC_SEQ_CST ) != 0U )
+    {
+        ( void ) kill( ( pid_t ) pxPort->lPid, niVSWITCH_RX_SIGNAL );
+    }
+}
+
+/*!
+ * @brief the node's "MAC interrupt" - wakes the RX task
+ */
+static void prvRxSignalHandler( int iSignal )
+{
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+    ( void ) iSignal;
+
+    vTaskNotifyGiveFromISR( xRxTask, &xHigherPriorityTaskWoken );
+    portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+}
+
+/*!
+ * @brief move the frame at the head of the port's ring into pxBuffer, if it
+ *        is due
+ * @returns 0 if it was taken, the ticks until it is due if it isn't, or
+ *          portMAX_DELAY with the ring empty
+ */
+static TickType_t prvTakeFrame( VSwitchPort_t * pxPort,
+                                NetworkBufferDescriptor_t * pxBuffer )
+{
+    VSwitchSlot_t * pxSlot = &( pxPort->xSlots[ pxPort->ulHead ] );
+    const uint64_t ullTickNs = 1000000000ULL / configTICK_RATE_HZ;
+    TickType_t xDue = portMAX_DELAY;
+    uint64_t ullNowNs;
+
+    taskENTER_CRITICAL();
+    prvLock( &( pxPort->xLock ) );
+
+    if( pxPort->ulCount != 0U )
+    {
+        ullNowNs = prvNowNs();
+
+        if( pxSlot->ullDueNs <= ullNowNs )
+        {
+            memcpy( pxBuffer->pucEthernetBuffer, pxSlot->ucData, pxSlot->ulLength );
+            pxBuffer->xDataLength = ( size_t ) pxSlot->ulLength;
+            pxPort->ulHead = ( pxPort->ulHead + 1U ) % niVSWITCH_RING_FRAMES;
+            pxPort->ulCount--;
+            xDue = 0;
+        }
+        else
+        {
+            xDue = ( TickType_t ) ( ( pxSlot->ullDueNs - ullNowNs + ullTickNs - 1U ) / ullTickNs );
+        }
+    }
+
+    pthread_mutex_unlock( &( pxPort->xLock ) );
+    taskEXIT_CRITICAL();
+
+    return xDue;
+}
+
+/*!
+ * @brief sleep until the first queued frame is due, or with none queued
+ *        until a sender signals one has been
+ */
+static void prvWaitForFrames( VSwitchPort_t * pxPort,
+                              TickType_t xDue )
+{
+    if( xDue != portMAX_DELAY )
+    {
+        vTaskDelay( xDue );
+    }
+    else
+    {
+        __atomic_store_n( &( pxPort->ulRxWaiting ), 1U, __ATOMIC_SEQ_CST );
+
+        taskENTER_CRITICAL();
+        prvLock( &( pxPort->xLock ) );
+        xDue = ( pxPort->ulCount != 0U ) ? 0 : portMAX_DELAY;
+        pthread_mutex_unlock( &( pxPort->xLock ) );
+        taskEXIT_CRITICAL();
+
+        if( xDue == portMAX_DELAY )
+        {
+            ( void ) ulTaskNotifyTake( pdTRUE, pdMS_TO_TICKS( niVSWITCH_RX_IDLE_MS ) );
+        }
+
+        __atomic_store_n( &( pxPort->ulRxWaiting ), 0U, __ATOMIC_SEQ_CST );
+    }
+}
+
+/*!
+ * @brief FreeRTOS task that stands in for the MAC interrupt - passes the
+ *        frames on the port's ring that are due to the IP task, sleeping a
+ *        tick whenever none are
+ * @param [in] pvParameters not used
+ */
+static void prvRxTask( void * pvParameters )
+{
+    VSwitchPort_t * pxPort = &( pxSwitch->xPorts[ xOurPort ] );
+    NetworkBufferDescriptor_t * pxBuffer = NULL;
+    UBaseType_t uxFrames;
+    TickType_t xDue;
+
+    #if ( ipconfigUSE_LINKED_RX_MESSAGES != 0 )
+        NetworkBufferDescriptor_t * pxFirst;
+        NetworkBufferDescriptor_t * pxLast;
+    #endif
+
+    ( void ) pvParameters;
+
+    for( ; ; )
+    {
+        #if ( ipconfigUSE_LINKED_RX_MESSAGES != 0 )
+            pxFirst = NULL;
+            pxLast = NULL;
+        #endif
+
+        /* Out of buffers, try again next tick. */
+        xDue = 1;
+
+        for( uxFrames = 0; uxFrames < niVSWITCH_RX_BATCH; uxFrames++ )
+        {
+            /* A buffer is taken before looking at the ring, and kept for the
+             * next frame if nothing is due. */
+            if( pxBuffer == NULL )
+            {
+                pxBuffer = pxGetNetworkBufferWithDescriptor( niVSWITCH_FRAME_SIZE, 0 );
+
+                if( pxBuffer == NULL )
+                {
+                    break;
+                }
+            }
+
+            xDue = prvTakeFrame( pxPort, pxBuffer );
+
+            if( xDue != 0 )
+            {
+                break;
+            }
+
+            iptraceNETWORK_INTERFACE_RECEIVE();
+
+            /* Flooded frames reach every node. */
+            if( ipCONSIDER_FRAME_FOR_PROCESSING( pxBuffer->pucEthernetBuffer ) != eProcessBuffer )
+            {
+                continue;
+            }
+
+            __atomic_add_fetch( &( pxPort->xStats.ullRxFrames ), 1U, __ATOMIC_RELAXED );
+
+            #if ( ipconfigUSE_LINKED_RX_MESSAGES != 0 )
+                {
+                    pxBuffer->pxNextBuffer = NULL;
+
+                    if( pxLast == NULL )
+                    {
+                        pxFirst = pxBuffer;
+                    }
+                    else
+                    {
+                        pxLast->pxNextBuffer = pxBuffer;
+                    }
+
+                    pxLast = pxBuffer;
+                }
+            #else
+                {
+                    prvPassToIPTask( pxBuffer );
+                }
+            #endif
+
+            pxBuffer = NULL;
+        }
+
+        #if ( ipconfigUSE_LINKED_RX_MESSAGES != 0 )
+            {
+                if( pxFirst != NULL )
+                {
+                    prvPassToIPTask( pxFirst );
+                }
+            }
+        #endif
+
+        /* Carry straight on after a full batch, there may be more due. */
+        if( uxFrames < niVSWITCH_RX_BATCH )
+        {
+            prvWaitForFrames( pxPort, xDue );
+        }
+    }
+}
+
+/*!
+ * @brief send a received buffer (or chain of them) to the IP task, releasing
+ *        it if the IP task's queue is full
+ * @param [in] pxBuffer the first buffer
+ */
+static void prvPassToIPTask( NetworkBufferDescriptor_t * pxBuffer )
+{
+    IPStackEvent_t xRxEvent = { eNetworkRxEvent, NULL };
+
+    xRxEvent.pvData = ( void * ) pxBuffer;
+
+    if( xSendEventStructToIPTask( &xRxEvent, ( TickType_t ) 0 ) == pdFAIL )
+    {
+        #if ( ipconfigUSE_LINKED_RX_MESSAGES != 0 )
+            {
+                NetworkBufferDescriptor_t * pxNext;
+
+                while( pxBuffer != NULL )
+                {
+                    pxNext = pxBuffer->pxNextBuffer;
+                    vReleaseNetworkBufferAndDescriptor( pxBuffer );
+                    pxBuffer = pxNext;
+                }
+            }
+        #else
+            {
+                vReleaseNetworkBufferAndDescriptor( pxBuffer );
+            }
+        #endif
+
+        iptraceETHERNET_RX_EVENT_LOST();
+    }
+}
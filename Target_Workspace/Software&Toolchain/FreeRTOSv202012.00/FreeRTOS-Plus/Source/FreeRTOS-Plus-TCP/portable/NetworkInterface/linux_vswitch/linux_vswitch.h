@@ -0,0 +1,86 @@
+/*
+ * FreeRTOS+TCP V2.3.2
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://aws.amazon.com/freertos
+ * http://www.FreeRTOS.org
+ */
+
+#ifndef LINUX_VSWITCH_H
+#define LINUX_VSWITCH_H
+
+/* A virtual Ethernet switch in POSIX shared memory, connecting simulated
+ * FreeRTOS+TCP nodes that each run in their own process (linux_vswitch/
+ * NetworkInterface.c).  One process creates the switch, each node attaches
+ * to a port of it before calling FreeRTOS_IPInit(), and any attached or
+ * creating process can shape the links, take ports down and read the
+ * counters. */
+
+#include <stdint.h>
+#include "FreeRTOS.h"
+
+/* Impairments applied to every frame on its way to the port it is switched
+ * to.  Changing them takes effect for the next frame sent. */
+typedef struct xVSWITCH_SHAPING
+{
+    uint32_t ulLatencyUs;     /* One way delay added to every frame. */
+    uint32_t ulLossPermille;  /* Frames dropped at random, per thousand. */
+    uint32_t ulBandwidthKbps; /* Rate of each port's link, 0 for unlimited. */
+} VSwitchShaping_t;
+
+typedef struct xVSWITCH_PORT_STATS
+{
+    uint64_t ullTxFrames;  /* Frames the node on this port sent. */
+    uint64_t ullFlooded;   /* Of those, frames sent to every other port. */
+    uint64_t ullRxFrames;  /* Frames passed to the node's IP task. */
+    uint64_t ullDropLoss;  /* Frames to this port dropped by ulLossPermille. */
+    uint64_t ullDropFull;  /* Frames to this port dropped with its queue full. */
+    uint64_t ullDropLink;  /* Frames to or from this port while it was down. */
+} VSwitchPortStats_t;
+
+/* Create the switch as the shared memory object pcName ("/name") with
+ * xPorts ports, all of them up, and map it into this process.  Processes
+ * forked afterwards inherit the mapping. */
+BaseType_t xVSwitchCreate( const char * pcName,
+                           BaseType_t xPorts,
+                           const VSwitchShaping_t * pxShaping );
+
+/* Attach this process's node to xPort, emptying anything still queued for
+ * the port.  Maps the switch first if the process hasn't got it already. */
+BaseType_t xVSwitchAttach( const char * pcName,
+                           BaseType_t xPort );
+
+/* Unmap the switch and remove its name.  Processes that still have it
+ * mapped keep working. */
+void vVSwitchDestroy( const char * pcName );
+
+void vVSwitchSetShaping( const VSwitchShaping_t * pxShaping );
+
+/* Take a port's link down (every frame to or from it is dropped) or bring
+ * it back up, as unplugging a cable would. */
+void vVSwitchSetLink( BaseType_t xPort,
+                      BaseType_t xUp );
+
+/* Copy out a port's counters.  They are updated atomically but copied one
+ * at a time, so a copy taken while traffic flows can be a few frames out. */
+BaseType_t xVSwitchGetStats( BaseType_t xPort,
+                             VSwitchPortStats_t * pxStats );
+
+#endif /* LINUX_VSWITCH_H */
@@ -32,12 +32,22 @@
  * running are blocked in sigwait().
  *
  * Task switch is done by resuming the thread for the next task by
- * signaling the condition variable and then waiting on a condition variable
- * with the current thread.
+ * signaling its event and then waiting on the current thread's event.
+ * On Linux the events are futexes (see utils/wait_for_event.c).
  *
  * The timer interrupt uses SIGALRM and care is taken to ensure that
  * the signal handler runs only on the thread for the current task.
  *
+ * With configUSE_VIRTUAL_TIME the tick is decoupled from the host clock,
+ * see portmacro.h.  SIGALRM then only looks for a busy waiting task.
+ *
+ * With configUSE_TICKLESS_IDLE the idle task stops the tick and waits for
+ * a one-shot SIGALRM with sigwaitinfo(), see vPortSuppressTicksAndSleep(),
+ * or for one of the signals vPortAddInterruptSignal() names.
+ *
+ * With configUSE_CRITICAL_SECTION_TIMING the longest time signals stay
+ * masked by a critical section or the tick handler is recorded.
+ *
  * Use of part of the standard C library requires care as some
  * functions can take pthread mutexes internally which can result in
  * deadlocks as the FreeRTOS kernel can switch tasks while they're
@@ -67,13 +77,46 @@
 
 #define SIG_RESUME SIGUSR1
 
+#if ( configUSE_VIRTUAL_TIME == 1 )
+    /* How often SIGALRM checks for a busy waiting task.  A task is only
+     * considered busy after using a whole period of CPU time without a
+     * switch or a call into the kernel, so this is also how long a busy
+     * wait takes to see time move on. */
+    #ifndef portVIRTUAL_TIME_BUSY_PERIOD_US
+        #define portVIRTUAL_TIME_BUSY_PERIOD_US    100
+    #endif
+
+    /* The most ticks one jump covers, so a system where nothing will ever
+     * unblock still returns to the idle task (or the busy task) now and
+     * again. */
+    #ifndef portVIRTUAL_TIME_MAX_JUMP
+        #define portVIRTUAL_TIME_MAX_JUMP    100000
+    #endif
+
+    #if ( INCLUDE_xTaskGetSchedulerState == 0 ) && ( configUSE_TIMERS == 0 )
+        #error configUSE_VIRTUAL_TIME needs xTaskGetSchedulerState(), set INCLUDE_xTaskGetSchedulerState to 1
+    #endif
+#endif
+
+#if ( configUSE_TICKLESS_IDLE == 1 )
+    #if ( configUSE_VIRTUAL_TIME == 1 )
+        #error configUSE_VIRTUAL_TIME already skips idle time, set configUSE_TICKLESS_IDLE to 0
+    #endif
+
+    /* The longest single sleep, an hour.  A system where nothing is due to
+     * unblock wakes up this often. */
+    #ifndef portTICKLESS_MAX_SLEEP_TICKS
+        #define portTICKLESS_MAX_SLEEP_TICKS    ( ( TickType_t ) configTICK_RATE_HZ * 3600 )
+    #endif
+#endif
+
 typedef struct THREAD
 {
     pthread_t pthread;
     pdTASK_CODE pxCode;
     void *pvParams;
     BaseType_t xDying;
-    struct event *ev;
+    struct event ev;
 } Thread_t;
 
 /*
@@ -95,11 +138,38 @@ static sigset_t xAllSignals;
 static sigset_t xSchedulerOriginalSignalMask;
 static pthread_t hMainThread = ( pthread_t )NULL;
 static volatile portBASE_TYPE uxCriticalNesting;
+static sigset_t xInterruptSignals;
+static BaseType_t xInterruptSignalsInitialised = pdFALSE;
 /*-----------------------------------------------------------*/
 
 static portBASE_TYPE xSchedulerEnd = pdFALSE;
 /*-----------------------------------------------------------*/
 
+#if ( configUSE_VIRTUAL_TIME == 1 )
+    /* Counts critical sections and thread switches, SIGALRM finding it
+     * unchanged since the last period means the running task may be busy
+     * waiting. */
+    static volatile uint32_t ulKernelActivity = 0;
+    static uint32_t ulKernelActivityAtLastCheck = 0;
+
+    /* The running thread's CPU time when ulKernelActivity last changed. */
+    static uint64_t ullIdleSinceCpuNs = 0;
+#endif
+
+#if ( configUSE_CRITICAL_SECTION_TIMING == 1 )
+    /* When the running task last masked signals (0 while they are not
+     * masked), and the longest they have stayed masked. */
+    static uint64_t ullMaskedSinceNs = 0;
+    static uint64_t ullLongestMaskedNs = 0;
+
+    static void prvCriticalTimingStart( void );
+    static void prvCriticalTimingStop( void );
+#else
+    #define prvCriticalTimingStart()
+    #define prvCriticalTimingStop()
+#endif
+/*-----------------------------------------------------------*/
+
 static void prvSetupSignalsAndSchedulerPolicy( void );
 static void prvSetupTimerInterrupt( void );
 static void *prvWaitForStart( void * pvParams );
@@ -145,7 +215,7 @@ int iRet;
     pthread_attr_init( &xThreadAttributes );
     pthread_attr_setstack( &xThreadAttributes, pxEndOfStack, ulStackSize );
 
-    thread->ev = event_create();
+    event_init( &thread->ev );
 
     vPortEnterCritical();
 
@@ -245,9 +315,14 @@ Thread_t *xCurrentThread;
 
 void vPortEnterCritical( void )
 {
+#if ( configUSE_VIRTUAL_TIME == 1 )
+    ulKernelActivity++;
+#endif
+
     if ( uxCriticalNesting == 0 )
     {
         vPortDisableInterrupts();
+        prvCriticalTimingStart();
     }
     uxCriticalNesting++;
 }
@@ -260,6 +335,7 @@ void vPortExitCritical( void )
     /* If we have reached 0 then re-enable the interrupts. */
     if( uxCriticalNesting == 0 )
     {
+        prvCriticalTimingStop();
         vPortEnableInterrupts();
     }
 }
@@ -325,6 +401,60 @@ struct timespec t;
 }
 
 static uint64_t prvStartTimeNs;
+
+#if ( configUSE_CRITICAL_SECTION_TIMING == 1 )
+
+static void prvCriticalTimingStart( void )
+{
+    ullMaskedSinceNs = prvGetTimeNs();
+}
+
+static void prvCriticalTimingStop( void )
+{
+uint64_t ullMaskedNs;
+
+    if( ullMaskedSinceNs != 0 )
+    {
+        ullMaskedNs = prvGetTimeNs() - ullMaskedSinceNs;
+        if( ullMaskedNs > ullLongestMaskedNs )
+        {
+            ullLongestMaskedNs = ullMaskedNs;
+        }
+        ullMaskedSinceNs = 0;
+    }
+}
+
+uint64_t ullPortGetLongestCriticalSectionNs( void )
+{
+    return ullLongestMaskedNs;
+}
+
+void vPortResetCriticalSectionTiming( void )
+{
+    vPortEnterCritical();
+    ullLongestMaskedNs = 0;
+    vPortExitCritical();
+}
+
+#endif /* configUSE_CRITICAL_SECTION_TIMING */
+
+#if ( configUSE_TICKLESS_IDLE == 1 )
+    #define portTICK_PERIOD_NS    ( ( uint64_t ) portTICK_RATE_MICROSECONDS * 1000ull )
+
+static void prvNsToTimeval( uint64_t ullNs, struct timeval *pxTime )
+{
+    /* Round up, a zero it_value would stop the timer rather than fire it. */
+    uint64_t ullUs = ( ullNs + 999 ) / 1000;
+
+    if( ullUs == 0 )
+    {
+        ullUs = 1;
+    }
+
+    pxTime->tv_sec = ullUs / 1000000;
+    pxTime->tv_usec = ullUs % 1000000;
+}
+#endif
 /* commented as part of the code below in vPortSystemTickHandler,
  * to adjust timing according to full demo requirements */
 /* static uint64_t prvTickCount; */
@@ -345,6 +475,13 @@ int iRet;
         prvFatalError( "getitimer", errno );
     }
 
+#if ( configUSE_VIRTUAL_TIME == 1 )
+    /* Only a busy waiting task is looked for, see vPortSystemTickHandler. */
+    itimer.it_interval.tv_sec = 0;
+    itimer.it_interval.tv_usec = portVIRTUAL_TIME_BUSY_PERIOD_US;
+    itimer.it_value.tv_sec = 0;
+    itimer.it_value.tv_usec = portVIRTUAL_TIME_BUSY_PERIOD_US;
+#else
     /* Set the interval between timer events. */
     itimer.it_interval.tv_sec = 0;
     itimer.it_interval.tv_usec = portTICK_RATE_MICROSECONDS;
@@ -352,6 +489,7 @@ int iRet;
     /* Set the current count-down. */
     itimer.it_value.tv_sec = 0;
     itimer.it_value.tv_usec = portTICK_RATE_MICROSECONDS;
+#endif
 
     /* Set-up the timer interrupt. */
     iRet = setitimer( ITIMER_REAL, &itimer, NULL );
@@ -364,6 +502,286 @@ int iRet;
 }
 /*-----------------------------------------------------------*/
 
+void vPortAddInterruptSignal( int iSignal )
+{
+    if( xInterruptSignalsInitialised == pdFALSE )
+    {
+        sigemptyset( &xInterruptSignals );
+        xInterruptSignalsInitialised = pdTRUE;
+    }
+
+    sigaddset( &xInterruptSignals, iSignal );
+}
+/*-----------------------------------------------------------*/
+
+#if ( configUSE_TICKLESS_IDLE == 1 )
+
+static BaseType_t prvInterruptSignalPending( const sigset_t *pxPending )
+{
+int iSignal;
+
+    if( xInterruptSignalsInitialised == pdFALSE )
+    {
+        return pdFALSE;
+    }
+
+    for( iSignal = 1; iSignal < NSIG; iSignal++ )
+    {
+        if( ( sigismember( &xInterruptSignals, iSignal ) == 1 ) &&
+            ( sigismember( pxPending, iSignal ) == 1 ) )
+        {
+            return pdTRUE;
+        }
+    }
+
+    return pdFALSE;
+}
+
+/* SIGALRM and the interrupt signals. */
+static void prvGetWakeSignals( sigset_t *pxSignals )
+{
+    if( xInterruptSignalsInitialised == pdFALSE )
+    {
+        sigemptyset( pxSignals );
+    }
+    else
+    {
+        *pxSignals = xInterruptSignals;
+    }
+
+    sigaddset( pxSignals, SIGALRM );
+}
+
+/*
+ * Called by the idle task with the scheduler suspended.  The next tick is
+ * at ullNextTickNs, the task to unblock is due xExpectedIdleTime ticks after
+ * the last one, so sleep until then with a one-shot timer.  Whatever ticks
+ * went by are then stepped on, keeping the tick in phase with the host
+ * clock by restarting the periodic timer at the next tick boundary.
+ */
+void vPortSuppressTicksAndSleep( TickType_t xExpectedIdleTime )
+{
+struct itimerval itimer;
+sigset_t xPending;
+sigset_t xTickSignal;
+TickType_t xModifiableIdleTime;
+TickType_t xCompleteTicks;
+uint64_t ullNowNs;
+uint64_t ullNextTickNs;
+const struct timespec xNoWait = { 0, 0 };
+int iSignal;
+
+    if( xExpectedIdleTime > portTICKLESS_MAX_SLEEP_TICKS )
+    {
+        xExpectedIdleTime = portTICKLESS_MAX_SLEEP_TICKS;
+    }
+
+    /* Masking SIGALRM is the host's equivalent of disabling interrupts
+     * before deciding whether to sleep - a tick already pending, or a task
+     * readied since the idle task looked, means not sleeping at all. */
+    vPortDisableInterrupts();
+
+    sigpending( &xPending );
+    if( ( sigismember( &xPending, SIGALRM ) == 1 ) ||
+        ( prvInterruptSignalPending( &xPending ) == pdTRUE ) ||
+        ( eTaskConfirmSleepModeStatus() == eAbortSleep ) )
+    {
+        vPortEnableInterrupts();
+        return;
+    }
+
+    xModifiableIdleTime = xExpectedIdleTime;
+    configPRE_SLEEP_PROCESSING( xModifiableIdleTime );
+    if( xModifiableIdleTime == 0 )
+    {
+        vPortEnableInterrupts();
+        return;
+    }
+
+    /* The periodic timer's count-down is the time left to the next tick. */
+    if( getitimer( ITIMER_REAL, &itimer ) )
+    {
+        prvFatalError( "getitimer", errno );
+    }
+    ullNowNs = prvGetTimeNs();
+    ullNextTickNs = ullNowNs + itimer.it_value.tv_sec * 1000000000ull +
+                    itimer.it_value.tv_usec * 1000ull;
+
+    prvNsToTimeval( ullNextTickNs + ( xExpectedIdleTime - 1 ) * portTICK_PERIOD_NS - ullNowNs,
+                    &itimer.it_value );
+    itimer.it_interval.tv_sec = 0;
+    itimer.it_interval.tv_usec = 0;
+    if( setitimer( ITIMER_REAL, &itimer, NULL ) )
+    {
+        prvFatalError( "setitimer", errno );
+    }
+
+    /* SIGALRM is blocked on every thread, so it stays pending until taken
+     * here rather than running vPortSystemTickHandler().  An interrupt
+     * signal ends the sleep early; it is taken here too, so it is raised
+     * again to run its handler once interrupts are enabled. */
+    prvGetWakeSignals( &xTickSignal );
+    while( sigwait( &xTickSignal, &iSignal ) != 0 )
+    {
+    }
+    if( iSignal != SIGALRM )
+    {
+        /* The one-shot SIGALRM is still armed, and may have fired since.
+         * The tick boundaries are counted from the clock below, so disarm
+         * it and take a SIGALRM already pending - left pending, the tick
+         * it ran once interrupts are enabled would count a boundary
+         * twice. */
+        memset( &itimer, 0, sizeof( itimer ) );
+        if( setitimer( ITIMER_REAL, &itimer, NULL ) )
+        {
+            prvFatalError( "setitimer", errno );
+        }
+        sigemptyset( &xTickSignal );
+        sigaddset( &xTickSignal, SIGALRM );
+        ( void ) sigtimedwait( &xTickSignal, NULL, &xNoWait );
+
+        ( void ) pthread_kill( pthread_self(), iSignal );
+    }
+
+    configPOST_SLEEP_PROCESSING( xExpectedIdleTime );
+
+    /* Count the tick boundaries crossed.  The host may have run the thread
+     * late, so this can be more than xExpectedIdleTime. */
+    ullNowNs = prvGetTimeNs();
+    if( ullNowNs < ullNextTickNs )
+    {
+        xCompleteTicks = 0;
+    }
+    else
+    {
+        xCompleteTicks = ( TickType_t ) ( ( ullNowNs - ullNextTickNs ) / portTICK_PERIOD_NS ) + 1;
+    }
+
+    prvNsToTimeval( ullNextTickNs + xCompleteTicks * portTICK_PERIOD_NS - ullNowNs,
+                    &itimer.it_value );
+    itimer.it_interval.tv_sec = 0;
+    itimer.it_interval.tv_usec = portTICK_RATE_MICROSECONDS;
+    if( setitimer( ITIMER_REAL, &itimer, NULL ) )
+    {
+        prvFatalError( "setitimer", errno );
+    }
+
+    if( xCompleteTicks < xExpectedIdleTime )
+    {
+        /* Woken early, no task is due yet. */
+        vTaskStepTick( xCompleteTicks );
+    }
+    else
+    {
+        /* vTaskStepTick() can't unblock anything, so the tick that wakes
+         * the task (and any after it) go through xTaskIncrementTick().  The
+         * scheduler is suspended, so they are held as pended ticks until
+         * the idle task resumes it. */
+        vTaskStepTick( xExpectedIdleTime - 1 );
+        for( xCompleteTicks -= xExpectedIdleTime - 1; xCompleteTicks > 0; xCompleteTicks-- )
+        {
+            ( void ) xTaskIncrementTick();
+        }
+    }
+
+    vPortEnableInterrupts();
+}
+
+#endif /* configUSE_TICKLESS_IDLE */
+/*-----------------------------------------------------------*/
+
+#if ( configUSE_VIRTUAL_TIME == 1 )
+
+/*
+ * Step the tick until a task has to switch in (one with at least the running
+ * task's priority unblocked, or time slicing) or portVIRTUAL_TIME_MAX_JUMP
+ * ticks have gone by.  Called with interrupts (signals) masked.
+ */
+static BaseType_t prvAdvanceVirtualTime( void )
+{
+BaseType_t xSwitchRequired = pdFALSE;
+TickType_t xTicks;
+
+    for( xTicks = 0; ( xSwitchRequired == pdFALSE ) && ( xTicks < portVIRTUAL_TIME_MAX_JUMP ); xTicks++ )
+    {
+        xSwitchRequired = xTaskIncrementTick();
+    }
+
+    return xSwitchRequired;
+}
+/*-----------------------------------------------------------*/
+
+void vPortVirtualTimeIdle( void )
+{
+    vPortEnterCritical();
+
+    if( prvAdvanceVirtualTime() != pdFALSE )
+    {
+        vPortYieldFromISR();
+    }
+
+    vPortExitCritical();
+}
+/*-----------------------------------------------------------*/
+
+static uint64_t prvGetThreadCpuTimeNs( void )
+{
+struct timespec t;
+
+    clock_gettime( CLOCK_THREAD_CPUTIME_ID, &t );
+
+    return t.tv_sec * 1000000000ull + t.tv_nsec;
+}
+/*-----------------------------------------------------------*/
+
+static void vPortSystemTickHandler( int sig )
+{
+Thread_t *pxThreadToSuspend;
+Thread_t *pxThreadToResume;
+
+    /* The running task used the kernel during the last period, or is
+     * using it now, leave time alone. */
+    if( ( ulKernelActivity != ulKernelActivityAtLastCheck ) ||
+        ( xTaskGetSchedulerState() != taskSCHEDULER_RUNNING ) )
+    {
+        ulKernelActivityAtLastCheck = ulKernelActivity;
+        ullIdleSinceCpuNs = prvGetThreadCpuTimeNs();
+        return;
+    }
+
+    /* The host clock moved on, but the host may have run something else
+     * rather than this task - only CPU time this task used counts. */
+    if( prvGetThreadCpuTimeNs() - ullIdleSinceCpuNs < portVIRTUAL_TIME_BUSY_PERIOD_US * 1000ull )
+    {
+        return;
+    }
+
+    uxCriticalNesting++; /* Signals are blocked in this signal handler. */
+    prvCriticalTimingStart();
+
+    /* Busy waiting - only time moving on (or a task it unblocks) can end
+     * it. */
+    pxThreadToSuspend = prvGetThreadFromTask( xTaskGetCurrentTaskHandle() );
+
+    if( ( prvAdvanceVirtualTime() != pdFALSE ) && ( configUSE_PREEMPTION == 1 ) )
+    {
+        vTaskSwitchContext();
+
+        pxThreadToResume = prvGetThreadFromTask( xTaskGetCurrentTaskHandle() );
+
+        prvSwitchThread( pxThreadToResume, pxThreadToSuspend );
+    }
+
+    /* A jump can take longer than a period, start counting afresh so the
+     * task gets a whole period of its own CPU time before the next one. */
+    ullIdleSinceCpuNs = prvGetThreadCpuTimeNs();
+
+    prvCriticalTimingStop();
+    uxCriticalNesting--;
+}
+
+#else /* configUSE_VIRTUAL_TIME */
+
 static void vPortSystemTickHandler( int sig )
 {
 Thread_t *pxThreadToSuspend;
@@ -371,6 +789,7 @@ Thread_t *pxThreadToResume;
 /* uint64_t xExpectedTicks; */
 
     uxCriticalNesting++; /* Signals are blocked in this signal handler. */
+    prvCriticalTimingStart();
 
 #if ( configUSE_PREEMPTION == 1 )
     pxThreadToSuspend = prvGetThreadFromTask( xTaskGetCurrentTaskHandle() );
@@ -397,8 +816,11 @@ Thread_t *pxThreadToResume;
     prvSwitchThread(pxThreadToResume, pxThreadToSuspend);
 #endif
 
+    prvCriticalTimingStop();
     uxCriticalNesting--;
 }
+
+#endif /* configUSE_VIRTUAL_TIME */
 /*-----------------------------------------------------------*/
 
 void vPortThreadDying( void *pxTaskToDelete, volatile BaseType_t *pxPendYield )
@@ -411,13 +833,22 @@ Thread_t *pxThread = prvGetThreadFromTask( pxTaskToDelete );
 void vPortCancelThread( void *pxTaskToDelete )
 {
 Thread_t *pxThreadToCancel = prvGetThreadFromTask( pxTaskToDelete );
+sigset_t xSavedSignals;
 
     /*
      * The thread has already been suspended so it can be safely cancelled.
+     *
+     * The first pthread_cancel() loads libgcc_s, and the cancel and the join
+     * take glibc's loader and thread stack locks.  A tick (or a virtual time
+     * jump) switching the calling task out part way through would leave them
+     * held by a suspended thread, for every other thread to block on, so
+     * signals stay blocked until they are done with.
      */
-    pthread_cancel( pxThreadToCancel->pthread );
+    (void)pthread_sigmask( SIG_BLOCK, &xAllSignals, &xSavedSignals );
+    event_cancel( pxThreadToCancel->pthread, &pxThreadToCancel->ev );
     pthread_join( pxThreadToCancel->pthread, NULL );
-    event_delete( pxThreadToCancel->ev );
+    event_destroy( &pxThreadToCancel->ev );
+    (void)pthread_sigmask( SIG_SETMASK, &xSavedSignals, NULL );
 }
 /*-----------------------------------------------------------*/
 
@@ -461,6 +892,14 @@ BaseType_t uxSavedCriticalNesting;
          */
         uxSavedCriticalNesting = uxCriticalNesting;
 
+#if ( configUSE_VIRTUAL_TIME == 1 )
+        ulKernelActivity++;
+#endif
+
+        /* Time switched out doesn't count towards this task's critical
+         * section, the task switched in times its own. */
+        prvCriticalTimingStop();
+
         prvResumeThread( pxThreadToResume );
         if ( pxThreadToSuspend->xDying )
         {
@@ -469,6 +908,7 @@ BaseType_t uxSavedCriticalNesting;
         prvSuspendSelf( pxThreadToSuspend );
 
         uxCriticalNesting = uxSavedCriticalNesting;
+        prvCriticalTimingStart();
     }
 }
 /*-----------------------------------------------------------*/
@@ -476,7 +916,7 @@ BaseType_t uxSavedCriticalNesting;
 static void prvSuspendSelf( Thread_t *thread )
 {
     /*
-     * Suspend this thread by waiting for a pthread_cond_signal event.
+     * Suspend this thread by waiting for its event to be signalled.
      *
      * A suspended thread must not handle signals (interrupts) so
      * all signals must be blocked by calling this from:
@@ -488,7 +928,7 @@ static void prvSuspendSelf( Thread_t *thread )
      *
      * - A thread with all signals blocked with pthread_sigmask().
         */
-    event_wait(thread->ev);
+    event_wait(&thread->ev);
 }
 
 /*-----------------------------------------------------------*/
@@ -497,7 +937,7 @@ static void prvResumeThread( Thread_t *xThreadId )
 {
     if ( pthread_self() != xThreadId->pthread )
     {
-        event_signal(xThreadId->ev);
+        event_signal(&xThreadId->ev);
     }
 }
 /*-----------------------------------------------------------*/
@@ -525,7 +965,7 @@ int iRet;
      * will be unblocked.
      */
     (void)pthread_sigmask( SIG_SETMASK, &xAllSignals,
-                           *&xSchedulerOriginalSignalMask );
+                           &xSchedulerOriginalSignalMask );
 
     /* SIG_RESUME is only used with sigwait() so doesn't need a
        handler. */
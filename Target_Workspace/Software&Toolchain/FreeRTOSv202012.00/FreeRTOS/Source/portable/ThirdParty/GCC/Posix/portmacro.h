@@ -123,6 +123,73 @@ extern void vPortCancelThread( void *pxTaskToDelete );
  */
 #define portMEMORY_BARRIER() __asm volatile( "" ::: "memory" )
 
+/* For traceMALLOC_FROM. */
+#define portGET_CALLER_ADDRESS() __builtin_return_address( 0 )
+
+/*
+ * Virtual time.  With configUSE_VIRTUAL_TIME set to 1 the tick no longer
+ * follows the host clock.  It only moves on when nothing else can happen:
+ * when every task is blocked, or when the running task has not switched out
+ * for a whole host tick period (it is busy waiting).  Time then jumps tick by
+ * tick, without running anything, until a task needs to switch in.  Runs
+ * that only wait on the kernel take as long as their tasks compute, and
+ * produce the same sequence of events every time.
+ *
+ * vPortVirtualTimeIdle() moves time on from the idle task, so a blocked
+ * system doesn't wait for the host tick to notice.  Call it from
+ * vApplicationIdleHook().
+ */
+#ifndef configUSE_VIRTUAL_TIME
+	#define configUSE_VIRTUAL_TIME 0
+#endif
+
+#if( configUSE_VIRTUAL_TIME == 1 )
+	extern void vPortVirtualTimeIdle( void );
+#endif
+
+/*
+ * Tickless idle.  With configUSE_TICKLESS_IDLE set to 1 the idle task stops
+ * the periodic SIGALRM and sleeps the host thread until the next task is due
+ * to unblock, then steps the tick count on by the time that went by.  An idle
+ * simulated system then costs next to no host CPU.  The tick stays in phase
+ * with the host clock across sleeps, so long delays are as accurate as they
+ * are with the periodic tick.
+ *
+ * Virtual time already skips over idle time, the two can't be used together.
+ */
+#if( configUSE_TICKLESS_IDLE == 1 )
+	extern void vPortSuppressTicksAndSleep( TickType_t xExpectedIdleTime );
+	#define portSUPPRESS_TICKS_AND_SLEEP( xExpectedIdleTime ) vPortSuppressTicksAndSleep( xExpectedIdleTime )
+#endif
+
+/*
+ * Host signals that stand in for peripheral interrupts (a simulated driver's
+ * receive signal, say) other than the tick.  The tickless idle sleep waits
+ * for these as well as SIGALRM, so their handlers run as soon as they arrive
+ * rather than when the idle task next wakes on its own.  Without tickless
+ * idle there is nothing to do, the call is harmless either way.
+ */
+extern void vPortAddInterruptSignal( int iSignal );
+
+/*
+ * Critical section timing.  With configUSE_CRITICAL_SECTION_TIMING set to 1
+ * the port records the longest time signals (interrupts) have stayed masked
+ * by a critical section or the tick handler, in host nanoseconds, which is
+ * the simulated system's worst case interrupt latency.  A task switched out
+ * inside a critical section isn't counted while it is out.  The host can
+ * preempt the process at any time too, so one long section can be noise -
+ * compare longest values over a few runs.
+ */
+#ifndef configUSE_CRITICAL_SECTION_TIMING
+	#define configUSE_CRITICAL_SECTION_TIMING 0
+#endif
+
+#if( configUSE_CRITICAL_SECTION_TIMING == 1 )
+	extern uint64_t ullPortGetLongestCriticalSectionNs( void );
+	extern void vPortResetCriticalSectionTiming( void );
+#endif
+/*-----------------------------------------------------------*/
+
 extern unsigned long ulPortGetRunTime( void );
 #define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS() /* no-op */
 #define portGET_RUN_TIME_COUNTER_VALUE()         ulPortGetRunTime()
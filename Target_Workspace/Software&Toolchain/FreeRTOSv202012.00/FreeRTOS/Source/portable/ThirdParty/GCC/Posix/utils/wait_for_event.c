@@ -1,31 +1,144 @@
-#include <pthread.h>
-#include <stdlib.h>
 #include <errno.h>
 
 #include "wait_for_event.h"
 
-struct event
+#if ( EVENT_USE_FUTEX == 1 )
+
+#include <linux/futex.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define EVENT_IDLE         0U
+#define EVENT_TRIGGERED    1U
+#define EVENT_WAITING      2U
+
+static int prvFutex( uint32_t * word,
+                     int op,
+                     uint32_t val,
+                     const struct timespec * timeout )
 {
-    pthread_mutex_t mutex;
-    pthread_cond_t cond;
-    bool event_triggered;
-};
+    return ( int ) syscall( SYS_futex, word, op, val, timeout, NULL, 0 );
+}
+
+void event_init( struct event * ev )
+{
+    __atomic_store_n( &ev->state, EVENT_IDLE, __ATOMIC_RELAXED );
+}
+
+void event_destroy( struct event * ev )
+{
+    ( void ) ev;
+}
+
+/*
+ * Consume a trigger if there is one, otherwise mark the event as having a
+ * waiter so event_signal() knows to wake it.  Returns true once triggered.
+ */
+static bool prvConsumeOrMarkWaiting( struct event * ev )
+{
+uint32_t expected = EVENT_TRIGGERED;
+
+    if( __atomic_compare_exchange_n( &ev->state, &expected, EVENT_IDLE, false,
+                                     __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE ) )
+    {
+        return true;
+    }
 
-struct event * event_create()
+    if( expected == EVENT_IDLE )
+    {
+        /* Fails harmlessly if event_signal() got in first, the next pass
+         * consumes the trigger. */
+        ( void ) __atomic_compare_exchange_n( &ev->state, &expected, EVENT_WAITING, false,
+                                              __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE );
+    }
+
+    return false;
+}
+
+bool event_wait( struct event * ev )
+{
+    while( prvConsumeOrMarkWaiting( ev ) == false )
+    {
+        /* Returns straight away if the state is no longer EVENT_WAITING. */
+        ( void ) prvFutex( &ev->state, FUTEX_WAIT_PRIVATE, EVENT_WAITING, NULL );
+    }
+
+    /* FUTEX_WAIT is not a cancellation point, see event_cancel(). */
+    pthread_testcancel();
+
+    return true;
+}
+
+bool event_wait_timed( struct event * ev,
+                       time_t ms )
 {
-    struct event * ev = malloc( sizeof( struct event ) );
+struct timespec now, deadline, remaining;
 
+    clock_gettime( CLOCK_MONOTONIC, &deadline );
+    deadline.tv_sec += ms / 1000;
+    deadline.tv_nsec += ( ms % 1000 ) * 1000000;
+    if( deadline.tv_nsec >= 1000000000 )
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    while( prvConsumeOrMarkWaiting( ev ) == false )
+    {
+        /* FUTEX_WAIT takes a relative timeout. */
+        clock_gettime( CLOCK_MONOTONIC, &now );
+        remaining.tv_sec = deadline.tv_sec - now.tv_sec;
+        remaining.tv_nsec = deadline.tv_nsec - now.tv_nsec;
+        if( remaining.tv_nsec < 0 )
+        {
+            remaining.tv_sec--;
+            remaining.tv_nsec += 1000000000;
+        }
+
+        if( remaining.tv_sec < 0 )
+        {
+            return false;
+        }
+
+        ( void ) prvFutex( &ev->state, FUTEX_WAIT_PRIVATE, EVENT_WAITING, &remaining );
+    }
+
+    pthread_testcancel();
+
+    return true;
+}
+
+void event_cancel( pthread_t thread,
+                   struct event * ev )
+{
+    /* Wake the thread so event_wait() acts on the pending cancel, whether it
+     * is already blocked or hasn't got there yet. */
+    pthread_cancel( thread );
+    event_signal( ev );
+}
+
+void event_signal( struct event * ev )
+{
+    if( __atomic_exchange_n( &ev->state, EVENT_TRIGGERED, __ATOMIC_RELEASE ) == EVENT_WAITING )
+    {
+        ( void ) prvFutex( &ev->state, FUTEX_WAKE_PRIVATE, 1, NULL );
+    }
+}
+
+#else /* EVENT_USE_FUTEX */
+
+void event_init( struct event * ev )
+{
     ev->event_triggered = false;
     pthread_mutex_init( &ev->mutex, NULL );
     pthread_cond_init( &ev->cond, NULL );
-    return ev;
 }
 
-void event_delete( struct event * ev )
+void event_destroy( struct event * ev )
 {
     pthread_mutex_destroy( &ev->mutex );
     pthread_cond_destroy( &ev->cond );
-    free( ev );
 }
 
 bool event_wait( struct event * ev )
@@ -67,6 +180,15 @@ bool event_wait_timed( struct event * ev,
     return true;
 }
 
+void event_cancel( pthread_t thread,
+                   struct event * ev )
+{
+    /* pthread_cond_wait() is a cancellation point, and the thread exits
+     * holding the mutex, so it must not be signalled afterwards. */
+    ( void ) ev;
+    pthread_cancel( thread );
+}
+
 void event_signal( struct event * ev )
 {
     pthread_mutex_lock( &ev->mutex );
@@ -74,3 +196,5 @@ void event_signal( struct event * ev )
     pthread_cond_signal( &ev->cond );
     pthread_mutex_unlock( &ev->mutex );
 }
+
+#endif /* EVENT_USE_FUTEX */
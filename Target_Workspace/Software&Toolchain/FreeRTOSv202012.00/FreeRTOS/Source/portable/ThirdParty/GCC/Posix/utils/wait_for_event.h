@@ -1,18 +1,52 @@
 #ifndef _WAIT_FOR_EVENT_H_
 #define _WAIT_FOR_EVENT_H_
 
+#include <pthread.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <time.h>
 
-struct event;
+/*
+ * On Linux an event is a single futex word, so signalling a thread is one
+ * FUTEX_WAKE system call (none if it isn't waiting yet) and waiting is one
+ * FUTEX_WAIT.  Elsewhere, or with EVENT_USE_PTHREAD_COND defined, it falls
+ * back to a pthread mutex and condition variable.
+ *
+ * The event is embedded in its owner (the port's Thread_t) and set up with
+ * event_init(), so creating a task doesn't call malloc().
+ */
+#if defined( __linux__ ) && !defined( EVENT_USE_PTHREAD_COND )
+    #define EVENT_USE_FUTEX    1
+#else
+    #define EVENT_USE_FUTEX    0
+#endif
 
-struct event * event_create();
-void event_delete( struct event * );
+#if ( EVENT_USE_FUTEX == 1 )
+    struct event
+    {
+        /* EVENT_IDLE, EVENT_TRIGGERED or EVENT_WAITING. */
+        uint32_t state;
+    };
+#else
+    struct event
+    {
+        pthread_mutex_t mutex;
+        pthread_cond_t cond;
+        bool event_triggered;
+    };
+#endif
+
+void event_init( struct event * ev );
+void event_destroy( struct event * ev );
 bool event_wait( struct event * ev );
 bool event_wait_timed( struct event * ev,
                        time_t ms );
 void event_signal( struct event * ev );
 
+/* Cancel a thread that is blocked in event_wait() on ev. */
+void event_cancel( pthread_t thread,
+                   struct event * ev );
+
 
 
 #endif /* ifndef _WAIT_FOR_EVENT_H_ */